@@ -0,0 +1,73 @@
+//  anim_clock.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include "anim_clock.h"
+#include "scene.h"
+
+Uint32 AnimationClock::ticks = 0;
+unsigned int AnimationClock::stamp = 1;
+
+/**
+ * Takes the time for the next frame.
+ */
+void AnimationClock::tick()
+{
+  ticks = SDL_GetTicks();
+  if (++stamp == 0)
+  {
+    stamp = 1;
+  }
+}
+
+/**
+ * Computes the frame of a sprite animation at the time of the last tick().
+ * @param frame_delay Duration of one frame in ms.
+ * @param frame_count Number of frames of the animation.
+ * @return The index of the frame to show.
+ */
+int AnimationClock::get_sprite_frame(float frame_delay, int frame_count)
+{
+  if (frame_count <= 1 || frame_delay <= 0)
+  {
+    return 0;
+  }
+
+  // A single division, the fmod of the old code isn't needed
+  unsigned int frame = static_cast<unsigned int>(ticks / frame_delay);
+  return frame % frame_count;
+}
+
+/**
+ * Computes the frame of a tile animation for the current global_frame_counter.
+ * @param anim_speed Speed of the animation, as in the tileset.
+ * @param frame_count Number of frames of the animation.
+ * @return The index of the frame to show.
+ */
+int AnimationClock::get_tile_frame(int anim_speed, int frame_count)
+{
+  if (frame_count <= 1 || anim_speed <= 0)
+  {
+    return 0;
+  }
+  return ((global_frame_counter * 25) / anim_speed) % frame_count;
+}
+
+// EOF
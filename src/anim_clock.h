@@ -0,0 +1,61 @@
+//  anim_clock.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_ANIM_CLOCK_H
+#define SUPERTUX_ANIM_CLOCK_H
+
+#include <SDL.h>
+
+/** The time base shared by all animations. The time is read once per
+    frame, in flipscreen(), and every frame stamp handed out until the
+    next tick() is the same. Sprites and tiles use the stamp to work out
+    their current frame only the first time they are drawn in a frame,
+    instead of for every badguy or tile cell drawn. */
+class AnimationClock
+{
+public:
+  /** Start the next frame */
+  static void tick();
+
+  /** SDL_GetTicks() as of the last tick() */
+  static Uint32 get_ticks() { return ticks; }
+
+  /** Changes with every tick(), never 0 */
+  static unsigned int get_stamp() { return stamp; }
+
+  /** Frame of a sprite animation at the current time
+      @param frame_delay Duration of one frame in ms
+      @param frame_count Number of frames, at least 1 */
+  static int get_sprite_frame(float frame_delay, int frame_count);
+
+  /** Frame of a tile animation, tiles are driven by global_frame_counter
+      @param anim_speed Speed of the animation, as in the tileset
+      @param frame_count Number of frames, at least 1 */
+  static int get_tile_frame(int anim_speed, int frame_count);
+
+private:
+  static Uint32 ticks;
+  static unsigned int stamp;
+};
+
+#endif /*SUPERTUX_ANIM_CLOCK_H*/
+
+// EOF
@@ -0,0 +1,504 @@
+//  asset_archive.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <SDL.h>
+#include <zlib.h>
+#include "asset_archive.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Bump whenever the layout of the archive changes
+const uint32_t FORMAT_VERSION = 1;
+
+// "STPK", the version, the number of entries and the offset of the index
+const size_t HEADER_SIZE = 16;
+
+const uint32_t FLAG_ZLIB = 1;
+
+typedef std::vector<unsigned char> Bytes;
+
+struct Entry
+{
+  uint32_t offset;
+  uint32_t stored_size;
+  uint32_t size;
+  uint32_t flags;
+};
+
+typedef std::map<std::string, Entry> Entries;
+
+// The index doesn't change while the archive is open, only reading the
+// contents is guarded by mutex
+Entries entries;
+std::string root;        // normalized data directory
+FILE* archive = nullptr;
+int64_t archive_mtime = 0;
+SDL_mutex* mutex = nullptr;
+
+void put_u32(Bytes& out, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    out.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+uint32_t get_u32(const unsigned char* in)
+{
+  return in[0] | (in[1] << 8) | (in[2] << 16) | (uint32_t(in[3]) << 24);
+}
+
+/**
+ * Turns a path into the name of its archive entry.
+ * @param file The path of a file below the data directory.
+ * @return The path relative to the data directory, empty if the file
+ * isn't below it.
+ */
+std::string entry_name(const std::string& file)
+{
+  std::string path = fs::path(file).lexically_normal().generic_string();
+  if (path.size() <= root.size() + 1 || path.compare(0, root.size(), root) != 0 ||
+      path[root.size()] != '/')
+  {
+    return std::string();
+  }
+  return path.substr(root.size() + 1);
+}
+
+/**
+ * Finds the entry of a file.
+ * @param file The path of a file below the data directory.
+ * @return The entry, nullptr if the archive doesn't have the file.
+ */
+const Entry* find_entry(const std::string& file)
+{
+  if (archive == nullptr)
+  {
+    return nullptr;
+  }
+
+  Entries::const_iterator i = entries.find(entry_name(file));
+  return i != entries.end() ? &i->second : nullptr;
+}
+
+/**
+ * Reads the index of an archive.
+ * @param file The open archive.
+ * @return False if the archive is broken.
+ */
+bool read_index(FILE* file)
+{
+  unsigned char header[HEADER_SIZE];
+  if (fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE ||
+      memcmp(header, "STPK", 4) != 0 || get_u32(header + 4) != FORMAT_VERSION)
+  {
+    return false;
+  }
+
+  uint32_t count = get_u32(header + 8);
+  uint32_t index_offset = get_u32(header + 12);
+
+  if (fseek(file, 0, SEEK_END) != 0)
+  {
+    return false;
+  }
+  long file_size = ftell(file);
+  if (file_size < long(index_offset) || fseek(file, index_offset, SEEK_SET) != 0)
+  {
+    return false;
+  }
+
+  Bytes index(file_size - index_offset);
+  if (!index.empty() && fread(&index[0], 1, index.size(), file) != index.size())
+  {
+    return false;
+  }
+
+  size_t pos = 0;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    if (index.size() - pos < 4)
+    {
+      return false;
+    }
+    uint32_t name_size = get_u32(&index[pos]);
+    pos += 4;
+    if (index.size() - pos < name_size + 16)
+    {
+      return false;
+    }
+    std::string name(reinterpret_cast<const char*>(&index[pos]), name_size);
+    pos += name_size;
+
+    Entry entry;
+    entry.offset = get_u32(&index[pos]);
+    entry.stored_size = get_u32(&index[pos + 4]);
+    entry.size = get_u32(&index[pos + 8]);
+    entry.flags = get_u32(&index[pos + 12]);
+    pos += 16;
+
+    if (uint64_t(entry.offset) + entry.stored_size > index_offset)
+    {
+      return false;
+    }
+    entries[name] = entry;
+  }
+  return true;
+}
+
+/**
+ * Collects all regular files below a directory.
+ * @param dir The directory.
+ * @param skip A file to leave out, the archive being written.
+ * @param files Receives the paths of the files.
+ */
+void collect_files(const fs::path& dir, const fs::path& skip, std::vector<fs::path>* files)
+{
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(dir, ec); !ec && it != fs::recursive_directory_iterator();
+       it.increment(ec))
+  {
+    std::error_code type_ec;
+    if (!it->is_regular_file(type_ec) || it->path().filename() == AssetArchive::FILE_NAME ||
+        fs::equivalent(it->path(), skip, type_ec))
+    {
+      continue;
+    }
+    files->push_back(it->path());
+  }
+}
+
+} // namespace
+
+const char* const AssetArchive::FILE_NAME = "data.stpk";
+std::string AssetArchive::pack_file;
+
+/**
+ * Opens the archive of a data directory.
+ * @param datadir The data directory.
+ * @return True if the archive is used from now on.
+ */
+bool AssetArchive::open(const std::string& datadir)
+{
+  close();
+
+  fs::path path = fs::path(datadir) / FILE_NAME;
+  FILE* file = fopen(path.string().c_str(), "rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  if (!read_index(file))
+  {
+    std::cerr << "Warning: Ignoring broken archive " << path << std::endl;
+    entries.clear();
+    fclose(file);
+    return false;
+  }
+
+  if (mutex == nullptr)
+  {
+    mutex = SDL_CreateMutex();
+  }
+
+  std::error_code ec;
+  archive_mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+  root = fs::path(datadir).lexically_normal().generic_string();
+  while (root.size() > 1 && root[root.size() - 1] == '/')
+  {
+    root.erase(root.size() - 1);
+  }
+  archive = file;
+  return true;
+}
+
+/**
+ * Stops using the archive.
+ */
+void AssetArchive::close()
+{
+  if (archive)
+  {
+    fclose(archive);
+    archive = nullptr;
+  }
+  entries.clear();
+}
+
+bool AssetArchive::is_open()
+{
+  return archive != nullptr;
+}
+
+/**
+ * Tells whether a file is in the archive.
+ * @param file The path of the file below the data directory.
+ * @return True if read() can load it.
+ */
+bool AssetArchive::contains(const std::string& file)
+{
+  return find_entry(file) != nullptr;
+}
+
+/**
+ * Reads a file out of the archive.
+ * @param file The path of the file below the data directory.
+ * @param data Receives the uncompressed contents.
+ * @return False if the file isn't in the archive or can't be read.
+ */
+bool AssetArchive::read(const std::string& file, std::string* data)
+{
+  const Entry* entry = find_entry(file);
+  if (entry == nullptr)
+  {
+    return false;
+  }
+
+  std::string stored(entry->stored_size, '\0');
+
+  if (mutex)
+  {
+    SDL_LockMutex(mutex);
+  }
+  bool ok = fseek(archive, entry->offset, SEEK_SET) == 0 &&
+            (stored.empty() || fread(&stored[0], 1, stored.size(), archive) == stored.size());
+  if (mutex)
+  {
+    SDL_UnlockMutex(mutex);
+  }
+
+  if (!ok)
+  {
+    std::cerr << "Warning: Couldn't read " << file << " from the archive" << std::endl;
+    return false;
+  }
+
+  if ((entry->flags & FLAG_ZLIB) == 0)
+  {
+    data->swap(stored);
+    return true;
+  }
+
+  data->resize(entry->size);
+  uLongf size = entry->size;
+  if (uncompress(reinterpret_cast<Bytef*>(&(*data)[0]), &size,
+                 reinterpret_cast<const Bytef*>(stored.data()), stored.size()) != Z_OK ||
+      size != entry->size)
+  {
+    std::cerr << "Warning: " << file << " is broken in the archive" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Gets the size of a file in the archive and the age of the archive.
+ * @param file The path of the file below the data directory.
+ * @param size Receives the uncompressed size.
+ * @param mtime Receives the modification time of the archive.
+ * @return False if the file isn't in the archive.
+ */
+bool AssetArchive::get_info(const std::string& file, uint64_t* size, int64_t* mtime)
+{
+  const Entry* entry = find_entry(file);
+  if (entry == nullptr)
+  {
+    return false;
+  }
+  *size = entry->size;
+  *mtime = archive_mtime;
+  return true;
+}
+
+/**
+ * Collects what the archive has in a directory, without descending into
+ * its subdirectories.
+ * @param dir The directory below the data directory.
+ * @param files Receives the names of the files.
+ * @param dirs Receives the names of the subdirectories, once each.
+ */
+void AssetArchive::list(const std::string& dir, std::vector<std::string>* files,
+                        std::vector<std::string>* dirs)
+{
+  if (archive == nullptr)
+  {
+    return;
+  }
+
+  std::string prefix;
+  std::string path = fs::path(dir).lexically_normal().generic_string();
+  while (path.size() > 1 && path[path.size() - 1] == '/')
+  {
+    path.erase(path.size() - 1);
+  }
+  if (path != root)
+  {
+    prefix = entry_name(path);
+    if (prefix.empty())
+    {
+      return;
+    }
+    prefix += '/';
+  }
+
+  // Entries are sorted, so everything inside dir follows the prefix
+  for (Entries::const_iterator i = entries.lower_bound(prefix);
+       i != entries.end() && i->first.compare(0, prefix.size(), prefix) == 0; ++i)
+  {
+    std::string rest = i->first.substr(prefix.size());
+    size_t slash = rest.find('/');
+    if (slash == std::string::npos)
+    {
+      files->push_back(rest);
+    }
+    else
+    {
+      std::string sub = rest.substr(0, slash);
+      if (dirs->empty() || dirs->back() != sub)
+      {
+        dirs->push_back(sub);
+      }
+    }
+  }
+}
+
+/**
+ * Writes an archive of all files below a data directory.
+ * @param datadir The data directory.
+ * @param archive_file The archive to write.
+ * @return False if the archive couldn't be written.
+ */
+bool AssetArchive::pack(const std::string& datadir, const std::string& archive_file)
+{
+  std::vector<fs::path> files;
+  collect_files(datadir, archive_file, &files);
+
+  FILE* out = fopen(archive_file.c_str(), "wb");
+  if (out == nullptr)
+  {
+    perror(archive_file.c_str());
+    return false;
+  }
+
+  // The header is written again once the index offset is known
+  Bytes header(HEADER_SIZE, 0);
+  Bytes index;
+  uint32_t offset = HEADER_SIZE;
+  uint32_t count = 0;
+  uint64_t total_size = 0;
+  bool ok = fwrite(&header[0], 1, header.size(), out) == header.size();
+
+  for (const fs::path& path : files)
+  {
+    FILE* in = fopen(path.string().c_str(), "rb");
+    if (in == nullptr)
+    {
+      perror(path.string().c_str());
+      ok = false;
+      break;
+    }
+
+    Bytes contents;
+    unsigned char buffer[16 * 1024];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+      contents.insert(contents.end(), buffer, buffer + got);
+    }
+    fclose(in);
+
+    // Images and music are mostly compressed already, storing them as
+    // they are saves uncompressing them on load
+    uLongf packed_size = compressBound(contents.size());
+    Bytes packed(packed_size);
+    uint32_t flags = 0;
+    if (!contents.empty() &&
+        compress2(&packed[0], &packed_size, &contents[0], contents.size(), Z_BEST_COMPRESSION) == Z_OK &&
+        packed_size < contents.size() - contents.size() / 10)
+    {
+      packed.resize(packed_size);
+      flags = FLAG_ZLIB;
+    }
+    const Bytes& stored = flags ? packed : contents;
+
+    if (!stored.empty() && fwrite(&stored[0], 1, stored.size(), out) != stored.size())
+    {
+      ok = false;
+      break;
+    }
+
+    std::string name = path.lexically_relative(datadir).generic_string();
+    put_u32(index, name.size());
+    index.insert(index.end(), name.begin(), name.end());
+    put_u32(index, offset);
+    put_u32(index, stored.size());
+    put_u32(index, contents.size());
+    put_u32(index, flags);
+
+    offset += stored.size();
+    total_size += contents.size();
+    ++count;
+  }
+
+  if (ok)
+  {
+    header.clear();
+    header.insert(header.end(), "STPK", "STPK" + 4);
+    put_u32(header, FORMAT_VERSION);
+    put_u32(header, count);
+    put_u32(header, offset);
+
+    ok = (index.empty() || fwrite(&index[0], 1, index.size(), out) == index.size()) &&
+         fseek(out, 0, SEEK_SET) == 0 &&
+         fwrite(&header[0], 1, header.size(), out) == header.size();
+  }
+
+  if (fclose(out) != 0 || !ok)
+  {
+    std::cerr << "Couldn't write the archive " << archive_file << std::endl;
+    remove(archive_file.c_str());
+    return false;
+  }
+
+  printf("Packed %u files, %llu bytes into %u bytes\n", count,
+         static_cast<unsigned long long>(total_size), offset + uint32_t(index.size()));
+  return true;
+}
+
+/**
+ * Packs the data directory into the requested archive.
+ * @param datadir The data directory.
+ * @return The exit code of the program.
+ */
+int AssetArchive::run_pack(const std::string& datadir)
+{
+  return pack(datadir, pack_file) ? 0 : 1;
+}
+
+// EOF
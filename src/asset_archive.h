@@ -0,0 +1,86 @@
+//  asset_archive.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_ASSET_ARCHIVE_H
+#define SUPERTUX_ASSET_ARCHIVE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Serves the game data from a single archive file, datadir/data.stpk,
+    instead of thousands of loose files. Opening and looking up files on
+    FAT formatted SD cards takes far longer than reading them, so the
+    loaders ask the archive first and only fall back to the disk for
+    files it doesn't contain.
+
+    The archive starts with the magic "STPK", the format version, the
+    number of entries and the offset of the index, followed by the file
+    contents and the index. Every index entry holds the path relative to
+    the data directory, the offset and stored size of the contents, the
+    original size and whether the contents are zlib compressed. All
+    numbers are 32 bit little endian. */
+class AssetArchive
+{
+public:
+  /** Name of the archive inside the data directory */
+  static const char* const FILE_NAME;
+
+  /** Use the archive of a data directory if it has one, returns false
+      if it doesn't or the archive is broken */
+  static bool open(const std::string& datadir);
+  static void close();
+  static bool is_open();
+
+  /** Tell whether a file (a path below the data directory) is in the
+      archive */
+  static bool contains(const std::string& file);
+
+  /** Read and uncompress a file, returns false if it isn't in the
+      archive. Can be called from any thread. */
+  static bool read(const std::string& file, std::string* data);
+
+  /** Get the size of a file and the modification time of the archive,
+      for validating caches built from the file */
+  static bool get_info(const std::string& file, uint64_t* size, int64_t* mtime);
+
+  /** Collect the names of the files and directories the archive has in
+      a directory */
+  static void list(const std::string& dir, std::vector<std::string>* files,
+                   std::vector<std::string>* dirs);
+
+  /** Pack all files below datadir into an archive, compressing the ones
+      that get noticeably smaller */
+  static bool pack(const std::string& datadir, const std::string& archive);
+
+  /** Request packing the data directory instead of running the game */
+  static void request_pack(const std::string& archive) { pack_file = archive; }
+  static bool is_pack_requested() { return !pack_file.empty(); }
+
+  /** Pack the data directory as requested, returns the exit code */
+  static int run_pack(const std::string& datadir);
+
+private:
+  static std::string pack_file;
+};
+
+#endif /*SUPERTUX_ASSET_ARCHIVE_H*/
+
+// EOF
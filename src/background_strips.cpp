@@ -0,0 +1,181 @@
+//  background_strips.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <math.h>
+#include <algorithm>
+#include "background_strips.h"
+#include "texture.h"
+#include "globals.h"
+#include "setup.h"
+
+/**
+ * Constructor for BackgroundStrips, no strip is converted yet.
+ * @param image_ The decoded background image, owned from now on.
+ */
+BackgroundStrips::BackgroundStrips(SDL_Surface* image_)
+  : image(image_), frame(0)
+{
+  int count = (image->w + STRIP_WIDTH - 1) / STRIP_WIDTH;
+  strips.resize(count, nullptr);
+  last_used.resize(count, 0);
+}
+
+/**
+ * Destructor for BackgroundStrips.
+ */
+BackgroundStrips::~BackgroundStrips()
+{
+  for (Surface* strip : strips)
+  {
+    delete strip;
+  }
+  SDL_FreeSurface(image);
+}
+
+int BackgroundStrips::get_width() const
+{
+  return image->w;
+}
+
+int BackgroundStrips::get_height() const
+{
+  return image->h;
+}
+
+/**
+ * Maps a column onto the image, which repeats horizontally.
+ * @param column Any column, may be negative.
+ * @return The column inside the image.
+ */
+int BackgroundStrips::wrap(int column) const
+{
+  column %= image->w;
+  return column < 0 ? column + image->w : column;
+}
+
+/**
+ * Fills the screen with the image and frees the strips that went out of
+ * view.
+ * @param offset The scroll position of the background in pixels.
+ */
+void BackgroundStrips::draw(float offset)
+{
+  ++frame;
+  draw_part(offset, 0, 0, 0, screen->w, std::min(image->h, screen->h));
+
+  // Prepare the strips next to the screen, so scrolling in either
+  // direction finds them ready
+  int first = wrap(static_cast<int>(floorf(offset))) / STRIP_WIDTH;
+  int last = wrap(static_cast<int>(floorf(offset)) + screen->w - 1) / STRIP_WIDTH;
+  int count = strips.size();
+  get_strip((first + count - 1) % count);
+  get_strip((last + 1) % count);
+
+  evict();
+}
+
+/**
+ * Draws a part of the image, splitting it at the strip borders.
+ * @param sx The source x position, wrapped around the image width.
+ * @param sy The source y position.
+ * @param x The destination x position.
+ * @param y The destination y position.
+ * @param w The width of the part.
+ * @param h The height of the part.
+ */
+void BackgroundStrips::draw_part(float sx, float sy, float x, float y, float w, float h)
+{
+  int column = wrap(static_cast<int>(floorf(sx)));
+  int done = 0;
+  int width = static_cast<int>(w);
+
+  while (done < width)
+  {
+    int index = column / STRIP_WIDTH;
+    int inside = column - index * STRIP_WIDTH;
+    Surface* strip = get_strip(index);
+    int part = std::min(strip->w - inside, width - done);
+
+    strip->draw_part(inside, sy, x + done, y, part, h);
+
+    done += part;
+    column = wrap(column + part);
+  }
+}
+
+/**
+ * Finds a strip, converting it from the image if it isn't prepared.
+ * @param index The number of the strip.
+ * @return The drawable strip.
+ */
+Surface* BackgroundStrips::get_strip(int index)
+{
+  last_used[index] = frame;
+  if (strips[index])
+  {
+    return strips[index];
+  }
+
+  int x = index * STRIP_WIDTH;
+  int w = std::min(STRIP_WIDTH, image->w - x);
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, w, image->h, 32,
+                                           0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, w, image->h, 32,
+                                           0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+  if (temp == nullptr)
+  {
+    st_abort("No memory left.", "");
+  }
+
+  // Backgrounds are opaque, copy the pixels as they are
+  SDL_SetAlpha(image, 0, 0);
+  SDL_Rect src;
+  src.x = x;
+  src.y = 0;
+  src.w = w;
+  src.h = image->h;
+  SDL_BlitSurface(image, &src, temp, NULL);
+
+  strips[index] = new Surface(temp, IGNORE_ALPHA);
+  SDL_FreeSurface(temp);
+  return strips[index];
+}
+
+/**
+ * Frees the strips that weren't used during the current frame.
+ */
+void BackgroundStrips::evict()
+{
+  for (size_t i = 0; i < strips.size(); ++i)
+  {
+    if (strips[i] && last_used[i] != frame)
+    {
+      delete strips[i];
+      strips[i] = nullptr;
+    }
+  }
+}
+
+// EOF
@@ -0,0 +1,69 @@
+//  background_strips.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_BACKGROUND_STRIPS_H
+#define SUPERTUX_BACKGROUND_STRIPS_H
+
+#include <SDL.h>
+#include <vector>
+
+class Surface;
+
+/** Draws a background image that is wider than the screen. The decoded
+    image is kept in its compact file format, and only the vertical strips
+    of STRIP_WIDTH pixels that are in view (plus one on either side) are
+    converted into drawable surfaces. Strips that scroll out of view are
+    freed again. The image repeats after its full width. */
+class BackgroundStrips
+{
+public:
+  static const int STRIP_WIDTH = 64;
+
+  /** Use a decoded image, which is freed by the BackgroundStrips */
+  BackgroundStrips(SDL_Surface* image);
+  ~BackgroundStrips();
+
+  int get_width() const;
+  int get_height() const;
+
+  /** Fill the screen with the image, scrolled by offset pixels */
+  void draw(float offset);
+
+  /** Draw a part of the image, sx is wrapped around the image width */
+  void draw_part(float sx, float sy, float x, float y, float w, float h);
+
+private:
+  SDL_Surface* image;
+  std::vector<Surface*> strips;        // nullptr for strips not converted
+  std::vector<unsigned int> last_used;
+  unsigned int frame;
+
+  int wrap(int column) const;
+  Surface* get_strip(int index);
+  void evict();
+
+  BackgroundStrips(const BackgroundStrips&);
+  BackgroundStrips& operator=(const BackgroundStrips&);
+};
+
+#endif /*SUPERTUX_BACKGROUND_STRIPS_H*/
+
+// EOF
@@ -68,6 +68,95 @@ Sprite* img_snowball_squished_right;
 
 #define BADGUY_WALK_SPEED 0.8f
 
+// Horizontal distance at which a stalactite notices Tux
+static const int STALACTITE_RANGE = 40;
+
+// Distance off the screen at which sleeping bad guys wake up
+static const int WAKE_DISTANCE = 32;
+
+/** What a kind of bad guy does. Code shared by all kinds looks the kind
+    up here instead of switching on it, and its flags tell which parts
+    of that code apply to the kind. */
+struct BadGuy::Behavior
+{
+  enum Flags
+  {
+    GRAVITY  = 1 << 0,  /**< Falls from the start */
+    UNSTICK  = 1 << 1,  /**< Is moved up out of a wall it starts in */
+    BUMPABLE = 1 << 2,  /**< Is knocked out by a brick bumped from below */
+    KILLABLE = 1 << 3,  /**< Can be knocked out at all */
+    OBSTACLE = 1 << 4,  /**< Makes other bad guys turn around */
+    CRUSHER  = 1 << 5,  /**< Knocks out the bad guys it runs into */
+    EXPLODES = 1 << 6   /**< Turns into a bomb when a crusher hits it */
+  };
+
+  const char* name;           /**< As in level files, nullptr if levels can't place it */
+  const char* old_name;       /**< As in old level files, or nullptr */
+  const char* sprite_prefix;  /**< All its sprites start with this */
+  void (*run_batch)(BadGuy* const* badguys, size_t count, double frame_ratio);
+  void (BadGuy::*squish)(Player* player);  /**< nullptr if it can't be squished */
+  Sprite** sprite_left;
+  Sprite** sprite_right;
+  Sprite** squished_left;     /**< Used by squish_snowball() */
+  Sprite** squished_right;
+  float walk_speed;           /**< Speed to the left it starts with */
+  unsigned int flags;
+};
+
+/** Indexed by BadGuyKind */
+const BadGuy::Behavior BadGuy::behaviors[] =
+{
+  { "mriceblock", "laptop", "mriceblock",
+    &BadGuy::run_batch<&BadGuy::action_mriceblock>, &BadGuy::squish_mriceblock,
+    &img_mriceblock_left, &img_mriceblock_right, nullptr, nullptr, BADGUY_WALK_SPEED,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE | Behavior::OBSTACLE },
+  { "jumpy", "money", "jumpy",
+    &BadGuy::run_batch<&BadGuy::action_jumpy>, nullptr,
+    &img_jumpy_left_up, &img_jumpy_left_up, nullptr, nullptr, 0,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE },
+  { "mrbomb", nullptr, "mrbomb",
+    &BadGuy::run_batch<&BadGuy::action_mrbomb>, &BadGuy::squish_mrbomb,
+    &img_mrbomb_left, &img_mrbomb_right, nullptr, nullptr, BADGUY_WALK_SPEED,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE | Behavior::OBSTACLE |
+    Behavior::EXPLODES },
+  // Only ever made out of a mrbomb
+  { nullptr, nullptr, "mrbomb",
+    &BadGuy::run_batch<&BadGuy::action_bomb>, nullptr,
+    &img_mrbomb_ticking_left, &img_mrbomb_ticking_right, nullptr, nullptr, 0,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::OBSTACLE | Behavior::CRUSHER },
+  { "stalactite", nullptr, "stalactite",
+    &BadGuy::run_batch<&BadGuy::action_stalactite>, nullptr,
+    &img_stalactite, &img_stalactite, nullptr, nullptr, 0,
+    Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::CRUSHER },
+  { "flame", nullptr, "flame",
+    &BadGuy::run_batch<&BadGuy::action_flame>, nullptr,
+    &img_flame, &img_flame, nullptr, nullptr, 0,
+    0 },
+  { "fish", nullptr, "fish",
+    &BadGuy::run_batch<&BadGuy::action_fish>, &BadGuy::squish_fish,
+    &img_fish, &img_fish, nullptr, nullptr, 0,
+    Behavior::GRAVITY | Behavior::KILLABLE },
+  { "bouncingsnowball", nullptr, "bouncingsnowball",
+    &BadGuy::run_batch<&BadGuy::action_bouncingsnowball>, &BadGuy::squish_snowball,
+    &img_bouncingsnowball_left, &img_bouncingsnowball_right,
+    &img_bouncingsnowball_squished, &img_bouncingsnowball_squished, 1.3f,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE | Behavior::OBSTACLE },
+  { "flyingsnowball", nullptr, "flyingsnowball",
+    &BadGuy::run_batch<&BadGuy::action_flyingsnowball>, &BadGuy::squish_snowball,
+    &img_flyingsnowball, &img_flyingsnowball,
+    &img_flyingsnowball_squished, &img_flyingsnowball_squished, 0,
+    Behavior::UNSTICK | Behavior::KILLABLE | Behavior::OBSTACLE },
+  { "spiky", nullptr, "spiky",
+    &BadGuy::run_batch<&BadGuy::action_spiky>, nullptr,
+    &img_spiky_left, &img_spiky_right, nullptr, nullptr, BADGUY_WALK_SPEED,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE | Behavior::OBSTACLE },
+  { "snowball", "bsod", "snowball",
+    &BadGuy::run_batch<&BadGuy::action_snowball>, &BadGuy::squish_snowball,
+    &img_snowball_left, &img_snowball_right,
+    &img_snowball_squished_left, &img_snowball_squished_right, BADGUY_WALK_SPEED,
+    Behavior::GRAVITY | Behavior::UNSTICK | Behavior::BUMPABLE | Behavior::KILLABLE | Behavior::OBSTACLE }
+};
+
 /**
  * Converts a string to a BadGuyKind enumeration.
  * This function is used to map string identifiers from level data to specific bad guy types.
@@ -76,31 +165,18 @@ Sprite* img_snowball_squished_right;
  */
 BadGuyKind badguykind_from_string(const std::string& str)
 {
-  if (str == "money" || str == "jumpy") // was money in old maps
-    return BAD_JUMPY;
-  else if (str == "laptop" || str == "mriceblock") // was laptop in old maps
-    return BAD_MRICEBLOCK;
-  else if (str == "mrbomb")
-    return BAD_MRBOMB;
-  else if (str == "stalactite")
-    return BAD_STALACTITE;
-  else if (str == "flame")
-    return BAD_FLAME;
-  else if (str == "fish")
-    return BAD_FISH;
-  else if (str == "bouncingsnowball")
-    return BAD_BOUNCINGSNOWBALL;
-  else if (str == "flyingsnowball")
-    return BAD_FLYINGSNOWBALL;
-  else if (str == "spiky")
-    return BAD_SPIKY;
-  else if (str == "snowball" || str == "bsod") // was bsod in old maps
-    return BAD_SNOWBALL;
-  else
+  static_assert(sizeof(BadGuy::behaviors) / sizeof(BadGuy::behaviors[0]) == NUM_BadGuyKinds,
+                "Every BadGuyKind needs a behavior");
+
+  for (int kind = 0; kind < NUM_BadGuyKinds; ++kind)
   {
-    std::cerr << "Couldn't convert badguy: '" << str << "'" << std::endl;
-    return BAD_SNOWBALL;
+    const BadGuy::Behavior& behavior = BadGuy::behaviors[kind];
+    if ((behavior.name && str == behavior.name) || (behavior.old_name && str == behavior.old_name))
+      return static_cast<BadGuyKind>(kind);
   }
+
+  std::cerr << "Couldn't convert badguy: '" << str << "'" << std::endl;
+  return BAD_SNOWBALL;
 }
 
 /**
@@ -111,31 +187,9 @@ BadGuyKind badguykind_from_string(const std::string& str)
  */
 std::string badguykind_to_string(BadGuyKind kind)
 {
-  switch (kind)
-  {
-    case BAD_JUMPY:
-      return "jumpy";
-    case BAD_MRICEBLOCK:
-      return "mriceblock";
-    case BAD_MRBOMB:
-      return "mrbomb";
-    case BAD_STALACTITE:
-      return "stalactite";
-    case BAD_FLAME:
-      return "flame";
-    case BAD_FISH:
-      return "fish";
-    case BAD_BOUNCINGSNOWBALL:
-      return "bouncingsnowball";
-    case BAD_FLYINGSNOWBALL:
-      return "flyingsnowball";
-    case BAD_SPIKY:
-      return "spiky";
-    case BAD_SNOWBALL:
-      return "snowball";
-    default:
-      return "snowball";
-  }
+  if (kind < 0 || kind >= NUM_BadGuyKinds || !BadGuy::behaviors[kind].name)
+    return "snowball";
+  return BadGuy::behaviors[kind].name;
 }
 
 /**
@@ -155,6 +209,7 @@ BadGuy::BadGuy(float x, float y, BadGuyKind kind_, bool stay_on_platform_)
     stay_on_platform(stay_on_platform_),  // bool
     removable(false),                     // bool
     seen(false),                          // bool
+    sleeping(false),                      // bool
     squishcount(0),                       // int
     sprite_left(nullptr),                 // Sprite*
     sprite_right(nullptr),                // Sprite*
@@ -173,65 +228,18 @@ BadGuy::BadGuy(float x, float y, BadGuyKind kind_, bool stay_on_platform_)
   timer.init(true);
 
   // Set up the bad guy's specific properties based on its type
-  if (kind == BAD_MRBOMB)
-  {
-    physic.set_velocity(-BADGUY_WALK_SPEED, 0);
-    set_sprite(img_mrbomb_left, img_mrbomb_right);
-  }
-  else if (kind == BAD_MRICEBLOCK)
-  {
-    physic.set_velocity(-BADGUY_WALK_SPEED, 0);
-    set_sprite(img_mriceblock_left, img_mriceblock_right);
-  }
-  else if (kind == BAD_JUMPY)
-  {
-    set_sprite(img_jumpy_left_up, img_jumpy_left_up);
-  }
-  else if (kind == BAD_BOMB)
-  {
-    set_sprite(img_mrbomb_ticking_left, img_mrbomb_ticking_right);
-    // Hack so that the bomb doesn't hurt until it explodes...
+  const Behavior& behavior = behaviors[kind];
+  if (behavior.walk_speed != 0)
+    physic.set_velocity(-behavior.walk_speed, 0);
+  physic.enable_gravity((behavior.flags & Behavior::GRAVITY) != 0);
+  set_sprite(*behavior.sprite_left, *behavior.sprite_right);
+
+  // Hack so that the bomb doesn't hurt until it explodes...
+  if (kind == BAD_BOMB)
     dying = DYING_SQUISHED;
-  }
-  else if (kind == BAD_FLAME)
-  {
-    base.ym = 0; // We misuse base.ym as angle for the flame
-    physic.enable_gravity(false);
-    set_sprite(img_flame, img_flame);
-  }
-  else if (kind == BAD_BOUNCINGSNOWBALL)
-  {
-    physic.set_velocity(-1.3f, 0);
-    set_sprite(img_bouncingsnowball_left, img_bouncingsnowball_right);
-  }
-  else if (kind == BAD_STALACTITE)
-  {
-    physic.enable_gravity(false);
-    set_sprite(img_stalactite, img_stalactite);
-  }
-  else if (kind == BAD_FISH)
-  {
-    set_sprite(img_fish, img_fish);
-    physic.enable_gravity(true);
-  }
-  else if (kind == BAD_FLYINGSNOWBALL)
-  {
-    set_sprite(img_flyingsnowball, img_flyingsnowball);
-    physic.enable_gravity(false);
-  }
-  else if (kind == BAD_SPIKY)
-  {
-    physic.set_velocity(-BADGUY_WALK_SPEED, 0);
-    set_sprite(img_spiky_left, img_spiky_right);
-  }
-  else if (kind == BAD_SNOWBALL)
-  {
-    physic.set_velocity(-BADGUY_WALK_SPEED, 0);
-    set_sprite(img_snowball_left, img_snowball_right);
-  }
 
   // If we're in a solid tile at start, correct that now
-  if (kind != BAD_FLAME && kind != BAD_FISH && collision_object_map(base))
+  if ((behavior.flags & Behavior::UNSTICK) && collision_object_map(base))
   {
     std::cerr << "Warning: BadGuy started in wall: kind: " << badguykind_to_string(kind)
           << " pos: (" << base.x << ", " << base.y << ")" << std::endl;
@@ -276,7 +284,7 @@ void BadGuy::action_mriceblock(double frame_ratio)
       base.x = tux.base.x - 16;
       base.y = tux.base.y + tux.base.height / 1.5f - base.height;
     }
-    if (collision_object_map(base))
+    if (collision_object_map(base, tiles))
     {
       base.x = tux.base.x;
       base.y = tux.base.y + tux.base.height / 1.5f - base.height;
@@ -295,7 +303,7 @@ void BadGuy::action_mriceblock(double frame_ratio)
       tux.kick_timer.start(KICKING_TIME);
       set_sprite(img_mriceblock_flat_left, img_mriceblock_flat_right);
       physic.set_velocity_x((dir == LEFT) ? -3.5f : 3.5f);
-      play_sound(sounds[SND_KICK], SOUND_CENTER_SPEAKER);
+      play_sound(SND_KICK, base.x);
     }
   }
 
@@ -305,13 +313,8 @@ void BadGuy::action_mriceblock(double frame_ratio)
     check_horizontal_bump();
     if (mode == KICK && changed != dir)
     {
-      // Handle stereo sound (number 10 should be tweaked...)
-      if (base.x < scroll_x + screen->w / 2 - 10)
-        play_sound(sounds[SND_RICOCHET], SOUND_LEFT_SPEAKER);
-      else if (base.x > scroll_x + screen->w / 2 + 10)
-        play_sound(sounds[SND_RICOCHET], SOUND_RIGHT_SPEAKER);
-      else
-        play_sound(sounds[SND_RICOCHET], SOUND_CENTER_SPEAKER);
+      // Panned by where it bounced
+      play_sound(SND_RICOCHET, base.x);
     }
   }
 
@@ -335,7 +338,7 @@ void BadGuy::action_mriceblock(double frame_ratio)
 void BadGuy::check_horizontal_bump(bool checkcliff)
 {
   float halfheight = base.height / 2;
-  if (dir == LEFT && issolid(base.x, static_cast<int>(base.y) + halfheight))
+  if (dir == LEFT && tiles.issolid(base.x, static_cast<int>(base.y) + halfheight))
   {
     if (kind == BAD_MRICEBLOCK && mode == KICK)
       World::current()->trybreakbrick(base.x, base.y + halfheight, false, dir);
@@ -344,7 +347,7 @@ void BadGuy::check_horizontal_bump(bool checkcliff)
     physic.set_velocity(-physic.get_velocity_x(), physic.get_velocity_y());
     return;
   }
-  if (dir == RIGHT && issolid(base.x + base.width, static_cast<int>(base.y) + halfheight))
+  if (dir == RIGHT && tiles.issolid(base.x + base.width, static_cast<int>(base.y) + halfheight))
   {
     if (kind == BAD_MRICEBLOCK && mode == KICK)
       World::current()->trybreakbrick(base.x + base.width, static_cast<int>(base.y) + halfheight, false, dir);
@@ -357,16 +360,16 @@ void BadGuy::check_horizontal_bump(bool checkcliff)
   // Don't check for cliffs when we're falling
   if (!checkcliff)
     return;
-  if (!issolid(base.x + base.width / 2, base.y + base.height))
+  if (!tiles.issolid(base.x + base.width / 2, base.y + base.height))
     return;
 
-  if (dir == LEFT && !issolid(base.x, static_cast<int>(base.y) + base.height + halfheight))
+  if (dir == LEFT && !tiles.issolid(base.x, static_cast<int>(base.y) + base.height + halfheight))
   {
     dir = RIGHT;
     physic.set_velocity(-physic.get_velocity_x(), physic.get_velocity_y());
     return;
   }
-  if (dir == RIGHT && !issolid(base.x + base.width, static_cast<int>(base.y) + base.height + halfheight))
+  if (dir == RIGHT && !tiles.issolid(base.x + base.width, static_cast<int>(base.y) + base.height + halfheight))
   {
     dir = LEFT;
     physic.set_velocity(-physic.get_velocity_x(), physic.get_velocity_y());
@@ -384,7 +387,7 @@ void BadGuy::fall()
   /* Fall if we get off the ground: */
   if (dying != DYING_FALLING)
   {
-    if (!issolid(base.x + base.width / 2, base.y + base.height))
+    if (!tiles.issolid(base.x + base.width / 2, base.y + base.height))
     {
       // Not solid below us? Enable gravity
       physic.enable_gravity(true);
@@ -402,7 +405,7 @@ void BadGuy::fall()
 
       if (stay_on_platform && mode == NORMAL)
       {
-        if (!issolid(base.x + ((dir == LEFT) ? 0 : base.width), base.y + base.height))
+        if (!tiles.issolid(base.x + ((dir == LEFT) ? 0 : base.width), base.y + base.height))
         {
           if (dir == LEFT)
           {
@@ -457,7 +460,7 @@ void BadGuy::action_jumpy(double frame_ratio)
   fall();
 
   // Jump when on ground
-  if (dying == DYING_NOT && issolid(base.x, base.y + 32))
+  if (dying == DYING_NOT && tiles.issolid(base.x, base.y + 32))
   {
     physic.set_velocity_y(JUMPV);
     physic.enable_gravity(true);
@@ -524,12 +527,7 @@ void BadGuy::action_bomb(double frame_ratio)
       timer.start(EXPLODETIME);
 
       // Play explosion sound
-      if (base.x < scroll_x + screen->w / 2 - 10)
-        play_sound(sounds[SND_EXPLODE], SOUND_LEFT_SPEAKER);
-      else if (base.x > scroll_x + screen->w / 2 + 10)
-        play_sound(sounds[SND_EXPLODE], SOUND_RIGHT_SPEAKER);
-      else
-        play_sound(sounds[SND_EXPLODE], SOUND_CENTER_SPEAKER);
+      play_sound(SND_EXPLODE, base.x);
     }
     else if (mode == BOMB_EXPLODE)
     {
@@ -553,12 +551,11 @@ void BadGuy::action_stalactite(double frame_ratio)
   Player& tux = *World::current()->get_tux();
 
   static const int SHAKETIME = 800;
-  static const int RANGE = 40;
 
   if (mode == NORMAL)
   {
-    // Start shaking when Tux is below the stalactite and at least 40 pixels near
-    if (tux.base.x + 32 > base.x - RANGE && tux.base.x < base.x + 32 + RANGE && tux.base.y + tux.base.height > base.y)
+    // Start shaking when Tux is below the stalactite and near enough
+    if (tux_in_range() && tux.base.y + tux.base.height > base.y)
     {
       timer.start(SHAKETIME);
       mode = STALACTITE_SHAKING;
@@ -566,7 +563,7 @@ void BadGuy::action_stalactite(double frame_ratio)
   }
   if (mode == STALACTITE_SHAKING)
   {
-    base.x = old_base.x + (rand() % 6) - 3; // TODO: This could be done nicer...
+    base.x = old_base.x + (st_rand() % 6) - 3; // TODO: This could be done nicer...
     if (!timer.check())
     {
       mode = STALACTITE_FALL;
@@ -576,7 +573,7 @@ void BadGuy::action_stalactite(double frame_ratio)
   {
     fall();
     // Destroy if we collide with land
-    if (issolid(base.x + base.width / 2, base.y + base.height))
+    if (tiles.issolid(base.x + base.width / 2, base.y + base.height))
     {
       timer.start(2000);
       dying = DYING_SQUISHED;
@@ -662,7 +659,7 @@ void BadGuy::action_bouncingsnowball(double frame_ratio)
   fall();
 
   // Jump when on ground
-  if (dying == DYING_NOT && issolid(base.x, base.y + 32))
+  if (dying == DYING_NOT && tiles.issolid(base.x, base.y + 32))
   {
     physic.set_velocity_y(JUMPV);
     physic.enable_gravity(true);
@@ -772,24 +769,23 @@ void BadGuy::action_snowball(double frame_ratio)
 }
 
 /**
- * Determines the appropriate action for the bad guy based on its type.
- * This function handles the main game logic for the bad guy, including movement, collisions, and death.
- * @param frame_ratio The frame ratio used to adjust movement based on frame time.
+ * Does the part of an action that is the same for every kind of bad guy.
+ * @return True if the kind specific action should run as well.
  */
-void BadGuy::action(double frame_ratio)
+bool BadGuy::begin_action()
 {
   // Remove if it's far off the screen
   if (base.x < scroll_x - OFFSCREEN_DISTANCE)
   {
     remove_me();
-    return;
+    return false;
   }
 
   // Bad guy falls below the ground
   if (base.y > screen->h)
   {
     remove_me();
-    return;
+    return false;
   }
 
   // Once it's on screen, it's activated
@@ -797,57 +793,100 @@ void BadGuy::action(double frame_ratio)
     seen = true;
 
   if (!seen)
-    return;
+    return false;
 
-  switch (kind)
+  // An idle bad guy that nothing can reach falls asleep, so its action
+  // doesn't run. It sleeps until the camera or Tux comes near, or until
+  // it is hit or bumped, see wake().
+  if (sleeping)
   {
-    case BAD_MRICEBLOCK:
-      action_mriceblock(frame_ratio);
-      break;
-
-    case BAD_JUMPY:
-      action_jumpy(frame_ratio);
-      break;
-
-    case BAD_MRBOMB:
-      action_mrbomb(frame_ratio);
-      break;
+    if (!is_near())
+      return false;
+    sleeping = false;
+  }
+  else if (is_idle() && !is_near())
+  {
+    sleeping = true;
+    return false;
+  }
 
-    case BAD_BOMB:
-      action_bomb(frame_ratio);
-      break;
+  return true;
+}
 
-    case BAD_STALACTITE:
-      action_stalactite(frame_ratio);
-      break;
+/**
+ * Tells whether skipping the action of the bad guy changes nothing, which
+ * holds for stalactites hanging still. Bad guys that move, fall, die or
+ * wait for a timer are never idle.
+ * @return True if the bad guy may sleep.
+ */
+bool BadGuy::is_idle() const
+{
+  return dying == DYING_NOT && kind == BAD_STALACTITE && mode == NORMAL;
+}
 
-    case BAD_FLAME:
-      action_flame(frame_ratio);
-      break;
+/**
+ * Checks the proximity wake triggers of the bad guy.
+ * @return True if the bad guy is near the screen or Tux is within its range.
+ */
+bool BadGuy::is_near() const
+{
+  if (base.x + base.width >= scroll_x - WAKE_DISTANCE && base.x <= scroll_x + screen->w + WAKE_DISTANCE)
+    return true;
 
-    case BAD_FISH:
-      action_fish(frame_ratio);
-      break;
+  return kind == BAD_STALACTITE && tux_in_range();
+}
 
-    case BAD_BOUNCINGSNOWBALL:
-      action_bouncingsnowball(frame_ratio);
-      break;
+/**
+ * Tells whether Tux is horizontally near enough for a stalactite to
+ * notice him.
+ * @return True if Tux is within STALACTITE_RANGE.
+ */
+bool BadGuy::tux_in_range() const
+{
+  const Player& tux = *World::current()->get_tux();
+  return tux.base.x + 32 > base.x - STALACTITE_RANGE && tux.base.x < base.x + 32 + STALACTITE_RANGE;
+}
 
-    case BAD_FLYINGSNOWBALL:
-      action_flyingsnowball(frame_ratio);
-      break;
+/**
+ * Runs one kind specific action over a batch of bad guys.
+ * @param badguys The first bad guy of the batch.
+ * @param count The number of bad guys in the batch.
+ * @param frame_ratio The frame ratio used to adjust movement based on frame time.
+ */
+template<void (BadGuy::*ACTION)(double)>
+void BadGuy::run_batch(BadGuy* const* badguys, size_t count, double frame_ratio)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (badguys[i]->begin_action())
+      (badguys[i]->*ACTION)(frame_ratio);
+  }
+}
 
-    case BAD_SPIKY:
-      action_spiky(frame_ratio);
-      break;
+/**
+ * Determines the appropriate action for the bad guy based on its type.
+ * This function handles the main game logic for the bad guy, including movement, collisions, and death.
+ * @param frame_ratio The frame ratio used to adjust movement based on frame time.
+ */
+void BadGuy::action(double frame_ratio)
+{
+  BadGuy* self = this;
+  action_batch(&self, 1, frame_ratio);
+}
 
-    case BAD_SNOWBALL:
-      action_snowball(frame_ratio);
-      break;
+/**
+ * Runs the actions of several bad guys of the same kind. The kind is only
+ * looked up once, the batch then runs as a tight loop over its action.
+ * @param badguys The bad guys, all of them of the same kind.
+ * @param count The number of bad guys.
+ * @param frame_ratio The frame ratio used to adjust movement based on frame time.
+ */
+void BadGuy::action_batch(BadGuy* const* badguys, size_t count, double frame_ratio)
+{
+  if (count == 0)
+    return;
 
-    default:
-      break;
-  }
+  behaviors[badguys[0]->kind].run_batch(badguys, count, frame_ratio);
 }
 
 /**
@@ -920,8 +959,7 @@ void BadGuy::set_sprite(Sprite* left, Sprite* right)
  */
 void BadGuy::bump()
 {
-  // These can't be bumped
-  if (kind == BAD_FLAME || kind == BAD_BOMB || kind == BAD_FISH || kind == BAD_FLYINGSNOWBALL)
+  if (!(behaviors[kind].flags & Behavior::BUMPABLE))
     return;
 
   physic.set_velocity_y(3.0f);
@@ -938,7 +976,7 @@ void BadGuy::squish_me(Player* player)
   player->jump_of_badguy(this);
 
   World::current()->add_score(base.x - scroll_x, base.y, 50 * player_status.score_multiplier);
-  play_sound(sounds[SND_SQUISH], SOUND_CENTER_SPEAKER);
+  play_sound(SND_SQUISH, base.x);
   player_status.score_multiplier++;
 
   dying = DYING_SQUISHED;
@@ -948,105 +986,106 @@ void BadGuy::squish_me(Player* player)
 
 /**
  * Handles the squish action for different types of bad guys.
- * This function includes special handling for certain bad guys like MrBomb and MrIceBlock.
+ * Kinds that can't be squished ignore it.
  * @param player Pointer to the player that squished the bad guy.
  */
 void BadGuy::squish(Player* player)
+{
+  void (BadGuy::*squish_kind)(Player*) = behaviors[kind].squish;
+  if (squish_kind)
+    (this->*squish_kind)(player);
+}
+
+/**
+ * Squishes a MrBomb, which transforms into a bomb.
+ * @param player Pointer to the player that squished the bad guy.
+ */
+void BadGuy::squish_mrbomb(Player* player)
+{
+  World::current()->add_bad_guy(base.x, base.y, BAD_BOMB);
+
+  player->jump_of_badguy(this);
+  World::current()->add_score(base.x - scroll_x, base.y, 50 * player_status.score_multiplier);
+  play_sound(SND_SQUISH, base.x);
+  player_status.score_multiplier++;
+  remove_me();
+}
+
+/**
+ * Squishes a MrIceBlock, which gets flat first and is kicked after that.
+ * @param player Pointer to the player that squished the bad guy.
+ */
+void BadGuy::squish_mriceblock(Player* player)
 {
   static const int MAX_ICEBLOCK_SQUISHES = 10;
 
-  if (kind == BAD_MRBOMB)
+  if (mode == NORMAL || mode == KICK)
   {
-    // MrBomb transforms into a bomb now
-    World::current()->add_bad_guy(base.x, base.y, BAD_BOMB);
+    // Flatten
+    play_sound(SND_STOMP, base.x);
+    mode = FLAT;
+    set_sprite(img_mriceblock_flat_left, img_mriceblock_flat_right);
+    physic.set_velocity_x(0);
 
-    player->jump_of_badguy(this);
-    World::current()->add_score(base.x - scroll_x, base.y, 50 * player_status.score_multiplier);
-    play_sound(sounds[SND_SQUISH], SOUND_CENTER_SPEAKER);
-    player_status.score_multiplier++;
-    remove_me();
-    return;
+    timer.start(4000);
   }
-  else if (kind == BAD_MRICEBLOCK)
+  else if (mode == FLAT)
   {
-    if (mode == NORMAL || mode == KICK)
-    {
-      // Flatten
-      play_sound(sounds[SND_STOMP], SOUND_CENTER_SPEAKER);
-      mode = FLAT;
-      set_sprite(img_mriceblock_flat_left, img_mriceblock_flat_right);
-      physic.set_velocity_x(0);
+    // Kick
+    play_sound(SND_KICK, base.x);
 
-      timer.start(4000);
+    if (player->base.x < base.x + (base.width / 2))
+    {
+      physic.set_velocity_x(5);
+      dir = RIGHT;
     }
-    else if (mode == FLAT)
+    else
     {
-      // Kick
-      play_sound(sounds[SND_KICK], SOUND_CENTER_SPEAKER);
-
-      if (player->base.x < base.x + (base.width / 2))
-      {
-        physic.set_velocity_x(5);
-        dir = RIGHT;
-      }
-      else
-      {
-        physic.set_velocity_x(-5);
-        dir = LEFT;
-      }
-
-      mode = KICK;
-      player->kick_timer.start(KICKING_TIME);
-      set_sprite(img_mriceblock_flat_left, img_mriceblock_flat_right);
+      physic.set_velocity_x(-5);
+      dir = LEFT;
     }
 
-    player->jump_of_badguy(this);
+    mode = KICK;
+    player->kick_timer.start(KICKING_TIME);
+    set_sprite(img_mriceblock_flat_left, img_mriceblock_flat_right);
+  }
 
-    player_status.score_multiplier++;
+  player->jump_of_badguy(this);
 
-    // Check for maximum number of squishes
-    squishcount++;
-    if (squishcount >= MAX_ICEBLOCK_SQUISHES)
-    {
-      kill_me(50);
-      return;
-    }
+  player_status.score_multiplier++;
 
+  // Check for maximum number of squishes
+  squishcount++;
+  if (squishcount >= MAX_ICEBLOCK_SQUISHES)
+    kill_me(50);
+}
+
+/**
+ * Squishes a fish, which can only be killed when falling down.
+ * @param player Pointer to the player that squished the bad guy.
+ */
+void BadGuy::squish_fish(Player* player)
+{
+  if (physic.get_velocity_y() >= 0)
     return;
-  }
-  else if (kind == BAD_FISH)
-  {
-    // Fish can only be killed when falling down
-    if (physic.get_velocity_y() >= 0)
-      return;
 
-    player->jump_of_badguy(this);
+  player->jump_of_badguy(this);
 
-    World::current()->add_score(base.x - scroll_x, base.y, 25 * player_status.score_multiplier);
-    player_status.score_multiplier++;
+  World::current()->add_score(base.x - scroll_x, base.y, 25 * player_status.score_multiplier);
+  player_status.score_multiplier++;
 
-    // Simply remove the fish...
-    remove_me();
-    return;
-  }
-  else if (kind == BAD_BOUNCINGSNOWBALL)
-  {
-    squish_me(player);
-    set_sprite(img_bouncingsnowball_squished, img_bouncingsnowball_squished);
-    return;
-  }
-  else if (kind == BAD_FLYINGSNOWBALL)
-  {
-    squish_me(player);
-    set_sprite(img_flyingsnowball_squished, img_flyingsnowball_squished);
-    return;
-  }
-  else if (kind == BAD_SNOWBALL)
-  {
-    squish_me(player);
-    set_sprite(img_snowball_squished_left, img_snowball_squished_right);
-    return;
-  }
+  // Simply remove the fish...
+  remove_me();
+}
+
+/**
+ * Squishes one of the snowballs, which shows its squished sprites.
+ * @param player Pointer to the player that squished the bad guy.
+ */
+void BadGuy::squish_snowball(Player* player)
+{
+  squish_me(player);
+  set_sprite(*behaviors[kind].squished_left, *behaviors[kind].squished_right);
 }
 
 /**
@@ -1056,7 +1095,7 @@ void BadGuy::squish(Player* player)
  */
 void BadGuy::kill_me(int score)
 {
-  if (kind == BAD_BOMB || kind == BAD_STALACTITE || kind == BAD_FLAME)
+  if (!(behaviors[kind].flags & Behavior::KILLABLE))
     return;
 
   dying = DYING_FALLING;
@@ -1077,7 +1116,7 @@ void BadGuy::kill_me(int score)
   World::current()->add_score(base.x - scroll_x, base.y, score * player_status.score_multiplier);
 
   // Play death sound
-  play_sound(sounds[SND_FALL], SOUND_CENTER_SPEAKER);
+  play_sound(SND_FALL, base.x);
 }
 
 /**
@@ -1102,6 +1141,9 @@ void BadGuy::collision(void* p_c_object, int c_object, CollisionType type)
 {
   BadGuy* pbad_c = nullptr;
 
+  // Being hit is a wake trigger
+  wake();
+
   if (type == COLLISION_BUMP)
   {
     bump();
@@ -1138,25 +1180,11 @@ void BadGuy::collision(void* p_c_object, int c_object, CollisionType type)
         kill_me(0);
       }
 
-      // Kill bad guys that run into an exploding bomb
-      else if (kind == BAD_BOMB && dying == DYING_NOT)
+      // Kill bad guys that run into an exploding bomb or get hit by a
+      // stalactite
+      else if ((behaviors[kind].flags & Behavior::CRUSHER) && dying == DYING_NOT)
       {
-        if (pbad_c->kind == BAD_MRBOMB)
-        {
-          // MrBomb transforms into a bomb now
-          explode(pbad_c);
-          return;
-        }
-        else
-        {
-          pbad_c->kill_me(50);
-        }
-      }
-
-      // Kill any bad guys that get hit by a stalactite
-      else if (kind == BAD_STALACTITE && dying == DYING_NOT)
-      {
-        if (pbad_c->kind == BAD_MRBOMB)
+        if (behaviors[pbad_c->kind].flags & Behavior::EXPLODES)
         {
           // MrBomb transforms into a bomb now
           explode(pbad_c);
@@ -1172,7 +1200,7 @@ void BadGuy::collision(void* p_c_object, int c_object, CollisionType type)
       else
       {
         // Jumpy, fish, flame, stalactites are exceptions
-        if (pbad_c->kind == BAD_JUMPY || pbad_c->kind == BAD_FLAME || pbad_c->kind == BAD_STALACTITE || pbad_c->kind == BAD_FISH)
+        if (!(behaviors[pbad_c->kind].flags & Behavior::OBSTACLE))
           break;
 
         // Bounce off of other bad guy if we land on top of him
@@ -1193,25 +1221,22 @@ void BadGuy::collision(void* p_c_object, int c_object, CollisionType type)
         else if (base.y + base.height > pbad_c->base.y + pbad_c->base.height)
           break;
 
-        if (pbad_c->kind != BAD_FLAME)
+        if (dir == LEFT)
         {
-          if (dir == LEFT)
-          {
-            dir = RIGHT;
-            physic.set_velocity_x(std::fabs(physic.get_velocity_x()));
+          dir = RIGHT;
+          physic.set_velocity_x(std::fabs(physic.get_velocity_x()));
 
-            // in case badguys get "jammed"
-            if (physic.get_velocity_x() != 0)
-            {
-              base.x = pbad_c->base.x + pbad_c->base.width;
-            }
-          }
-          else if (dir == RIGHT)
+          // in case badguys get "jammed"
+          if (physic.get_velocity_x() != 0)
           {
-            dir = LEFT;
-            physic.set_velocity_x(-std::fabs(physic.get_velocity_x()));
+            base.x = pbad_c->base.x + pbad_c->base.width;
           }
         }
+        else if (dir == RIGHT)
+        {
+          dir = LEFT;
+          physic.set_velocity_x(-std::fabs(physic.get_velocity_x()));
+        }
       }
       break;
 
@@ -1220,7 +1245,7 @@ void BadGuy::collision(void* p_c_object, int c_object, CollisionType type)
       // Get kicked if flat
       if (mode == FLAT && !dying)
       {
-        play_sound(sounds[SND_KICK], SOUND_CENTER_SPEAKER);
+        play_sound(SND_KICK, base.x);
 
         // Hit from the left side
         if (player->base.x < base.x)
@@ -1283,6 +1308,15 @@ void load_badguy_gfx()
   img_snowball_squished_right = sprite_manager->load("snowball-squished-right");
 }
 
+/**
+ * Loads the sprites a kind of bad guy uses.
+ * @param kind The kind of bad guy.
+ */
+void preload_badguy_gfx(BadGuyKind kind)
+{
+  sprite_manager->preload(BadGuy::behaviors[kind].sprite_prefix);
+}
+
 /**
  * Frees all the bad guy graphics resources.
  * This function should be called to release the memory used by the bad guy sprites.
@@ -53,6 +53,9 @@ std::string badguykind_to_string(BadGuyKind kind);
 void load_badguy_gfx();
 void free_badguy_gfx();
 
+/** Load the graphics of a kind of badguy before it shows up */
+void preload_badguy_gfx(BadGuyKind kind);
+
 class Player;
 
 /* Badguy type: */
@@ -94,9 +97,11 @@ public:
 private:
   bool removable;
   bool seen;
+  bool sleeping; // see begin_action()
   int squishcount; // number of times this enemy was squished
   Timer timer;
   Physic physic;
+  TileNeighbourhood tiles; // the tiles around the badguy, for its probes
 
   Sprite*   sprite_left;
   Sprite*   sprite_right;
@@ -107,6 +112,8 @@ public:
   BadGuy(float x, float y, BadGuyKind kind, bool stay_on_platform);
 
   void action(double frame_ratio);
+  /** Run the actions of count badguys that are all of the same kind */
+  static void action_batch(BadGuy* const* badguys, size_t count, double frame_ratio);
   void draw();
   std::string type() { return "BadGuy"; };
 
@@ -127,7 +134,28 @@ public:
   void remove_me();
   bool is_removable() const { return removable; }
 
+  /** A sleeping badguy skips its action until a wake trigger fires: the
+   * camera or Tux coming close, or the badguy being hit or bumped.
+   */
+  bool is_sleeping() const { return sleeping; }
+  void wake() { sleeping = false; }
+
 private:
+  /** What a kind of bad guy does, one entry per BadGuyKind in badguy.cpp */
+  struct Behavior;
+  static const Behavior behaviors[];
+
+  friend BadGuyKind badguykind_from_string(const std::string& str);
+  friend std::string badguykind_to_string(BadGuyKind kind);
+  friend void preload_badguy_gfx(BadGuyKind kind);
+
+  bool begin_action();
+  bool is_idle() const;
+  bool is_near() const;
+  bool tux_in_range() const;
+  template<void (BadGuy::*ACTION)(double)>
+  static void run_batch(BadGuy* const* badguys, size_t count, double frame_ratio);
+
   void action_mriceblock(double frame_ratio);
   void action_jumpy(double frame_ratio);
   void action_bomb(double frame_ratio);
@@ -155,6 +183,10 @@ private:
   void bump();
   /** called when a player jumped on the badguy from above */
   void squish(Player* player);
+  void squish_mrbomb(Player* player);
+  void squish_mriceblock(Player* player);
+  void squish_fish(Player* player);
+  void squish_snowball(Player* player);
   /** squish ourself, give player score and set dying to DYING_SQICHED */
   void squish_me(Player* player);
   /** set image of the badguy */
@@ -0,0 +1,259 @@
+//  benchmark.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "benchmark.h"
+#include "gameloop.h"
+#include "player.h"
+#include "profiler.h"
+#include "scene.h"
+#include "setup.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+Clock::time_point frame_start;
+Clock::time_point run_start;
+
+// Steps played after the last event, when the file has no end marker
+const unsigned int TRAILING_STEPS = 100;
+
+const char* action_names[] = { "left", "right", "jump", "duck", "fire" };
+const int ACTION_COUNT = sizeof(action_names) / sizeof(action_names[0]);
+
+/**
+ * Picks a value from sorted frame times.
+ * @param sorted The frame times in ascending order.
+ * @param percentile The percentile to pick, 0 to 100.
+ * @return The frame time in milliseconds.
+ */
+float percentile_of(const std::vector<float>& sorted, int percentile)
+{
+  size_t index = (sorted.size() - 1) * percentile / 100;
+  return sorted[index];
+}
+
+} // namespace
+
+std::string Benchmark::level_file;
+std::string Benchmark::input_file;
+bool Benchmark::render = true;
+bool Benchmark::running = false;
+std::vector<Benchmark::Event> Benchmark::events;
+size_t Benchmark::next_event = 0;
+unsigned int Benchmark::step = 0;
+unsigned int Benchmark::last_step = 0;
+std::vector<float> Benchmark::frame_times;
+
+/**
+ * Requests a benchmark run, done by run() once the game is set up.
+ * @param level The level file to play.
+ * @param input The input file to play it with.
+ */
+void Benchmark::request(const std::string& level, const std::string& input)
+{
+  level_file = level;
+  input_file = input;
+}
+
+/**
+ * Chooses whether the frames of the benchmark are drawn.
+ * @param render_ False to only simulate.
+ */
+void Benchmark::set_render(bool render_)
+{
+  render = render_;
+}
+
+bool Benchmark::is_requested()
+{
+  return !level_file.empty();
+}
+
+/**
+ * Reads the input events.
+ * @param file The input file.
+ * @return False if the file can't be read or has an invalid line.
+ */
+bool Benchmark::load_input(const std::string& file)
+{
+  FILE* in = fopen(file.c_str(), "r");
+  if (in == nullptr)
+  {
+    perror(file.c_str());
+    return false;
+  }
+
+  events.clear();
+  last_step = 0;
+  bool has_end = false;
+
+  char line[128];
+  int line_number = 0;
+  while (fgets(line, sizeof(line), in))
+  {
+    ++line_number;
+    if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+    {
+      continue;
+    }
+
+    unsigned int event_step;
+    char action[16];
+    char state[16] = "";
+    int fields = sscanf(line, "%u %15s %15s", &event_step, action, state);
+
+    Event event;
+    event.step = event_step;
+    event.action = -2;
+    event.state = strcmp(state, "down") == 0 ? DOWN : UP;
+
+    if (fields >= 2 && strcmp(action, "end") == 0)
+    {
+      event.action = -1;
+      has_end = true;
+    }
+    else if (fields == 3 && (strcmp(state, "down") == 0 || strcmp(state, "up") == 0))
+    {
+      for (int i = 0; i < ACTION_COUNT; ++i)
+      {
+        if (strcmp(action, action_names[i]) == 0)
+        {
+          event.action = i;
+        }
+      }
+    }
+
+    if (event.action == -2)
+    {
+      fprintf(stderr, "%s:%d: invalid input event\n", file.c_str(), line_number);
+      fclose(in);
+      return false;
+    }
+
+    events.push_back(event);
+    last_step = std::max(last_step, event.step);
+  }
+  fclose(in);
+
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event& a, const Event& b) { return a.step < b.step; });
+
+  if (!has_end)
+  {
+    last_step += TRAILING_STEPS;
+  }
+  return true;
+}
+
+/**
+ * Plays the requested level and prints the report.
+ */
+void Benchmark::run()
+{
+  if (!load_input(input_file))
+  {
+    return;
+  }
+
+  // Same random numbers in every run
+  srand(0);
+
+  next_event = 0;
+  step = 0;
+  frame_times.clear();
+  frame_times.reserve(last_step + 1);
+  Profiler::enable(true);
+  running = true;
+
+  GameSession session(level_file, 1, ST_GL_LOAD_LEVEL_FILE);
+  run_start = frame_start = Clock::now();
+  session.run();
+
+  running = false;
+  report();
+}
+
+/**
+ * Applies the events of the current step.
+ * @param tux The player to control.
+ */
+void Benchmark::feed_input(Player& tux)
+{
+  const int keys[] = { keymap.left, keymap.right, keymap.jump, keymap.duck, keymap.fire };
+
+  while (next_event < events.size() && events[next_event].step <= step)
+  {
+    const Event& event = events[next_event++];
+    if (event.action >= 0)
+    {
+      tux.key_event(static_cast<SDLKey>(keys[event.action]), event.state);
+    }
+  }
+}
+
+/**
+ * Records the time of the frame that just ended.
+ * @return True once all steps of the input were played.
+ */
+bool Benchmark::end_frame()
+{
+  Clock::time_point now = Clock::now();
+  frame_times.push_back(std::chrono::duration<float, std::milli>(now - frame_start).count());
+  frame_start = now;
+
+  ++step;
+  return step > last_step;
+}
+
+/**
+ * Prints frames per second, frame time percentiles and the profiler
+ * sections.
+ */
+void Benchmark::report()
+{
+  if (frame_times.empty())
+  {
+    return;
+  }
+
+  float seconds = std::chrono::duration<float>(Clock::now() - run_start).count();
+
+  std::vector<float> sorted = frame_times;
+  std::sort(sorted.begin(), sorted.end());
+
+  printf("Benchmark of %s with %s%s\n", level_file.c_str(), input_file.c_str(),
+         render ? "" : " (not rendered)");
+  printf("  frames: %u of %u steps\n", (unsigned int)frame_times.size(), last_step + 1);
+  printf("  frames per second: %.1f\n", frame_times.size() / seconds);
+  printf("  frame time p50: %.3f ms  p99: %.3f ms  max: %.3f ms\n",
+         percentile_of(sorted, 50), percentile_of(sorted, 99), sorted.back());
+  printf("Mean time per frame:\n");
+  Profiler::print_summary(stdout);
+}
+
+// EOF
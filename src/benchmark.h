@@ -0,0 +1,86 @@
+//  benchmark.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_BENCHMARK_H
+#define SUPERTUX_BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+class Player;
+
+/** Plays a level with input read from a file, one logic step per frame
+    and as fast as possible, and reports how long the frames took.
+
+    The input file has one event per line, "STEP ACTION STATE", where
+    STEP is the logic step (10 ms each) the event happens at, ACTION one
+    of left, right, jump, duck and fire, and STATE up or down. A line
+    "STEP end" stops the benchmark, otherwise it ends one second after
+    the last event or when the level is over. Lines starting with # are
+    ignored. */
+class Benchmark
+{
+public:
+  /** Request a benchmark run instead of the normal game */
+  static void request(const std::string& level, const std::string& input);
+
+  /** Draw the frames of the benchmark or not, drawing is the default */
+  static void set_render(bool render);
+
+  static bool is_requested();
+  static bool is_running() { return running; }
+  static bool renders() { return render; }
+
+  /** Play the requested level and print the report */
+  static void run();
+
+  /** Apply the input events of the current step to tux */
+  static void feed_input(Player& tux);
+
+  /** Finish the current frame, returns true when the benchmark is over */
+  static bool end_frame();
+
+private:
+  struct Event
+  {
+    unsigned int step;
+    int action;   // -1 for the end marker
+    int state;
+  };
+
+  static bool load_input(const std::string& file);
+  static void report();
+
+  static std::string level_file;
+  static std::string input_file;
+  static bool render;
+  static bool running;
+
+  static std::vector<Event> events;
+  static size_t next_event;
+  static unsigned int step;
+  static unsigned int last_step;
+  static std::vector<float> frame_times;
+};
+
+#endif /*SUPERTUX_BENCHMARK_H*/
+
+// EOF
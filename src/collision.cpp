@@ -17,6 +17,8 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
+#include <math.h>
+#include <algorithm>
 #include "defines.h"
 #include "collision.h"
 #include "scene.h"
@@ -64,7 +66,6 @@ bool collision_object_map(const base_type& base)
   if (!World::current()) return false;
 
   const Level& level = *World::current()->get_level();
-  TileManager& tilemanager = *TileManager::instance();
 
   // we make the collision rectangle 1 pixel smaller
   int starttilex = int(base.x + 1) / 32;
@@ -76,8 +77,36 @@ bool collision_object_map(const base_type& base)
   {
     for (int y = starttiley; y * 32 < max_y; ++y)
     {
-      Tile* tile = tilemanager.get(level.get_tile_at(x, y));
-      if (tile && tile->solid)
+      if (level.get_tile_flags(x, y) & TILE_SOLID)
+        return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Checks for a collision between an object and the map's solid tiles,
+ * reading the tiles through a TileNeighbourhood.
+ * @param base The object's base rectangle.
+ * @param tiles The tiles around the object.
+ * @return bool True if there is a collision, false otherwise.
+ */
+bool collision_object_map(const base_type& base, TileNeighbourhood& tiles)
+{
+  if (!World::current()) return false;
+
+  // we make the collision rectangle 1 pixel smaller
+  int starttilex = int(base.x + 1) / 32;
+  int starttiley = int(base.y + 1) / 32;
+  int max_x = int(base.x + base.width);
+  int max_y = int(base.y + base.height);
+
+  for (int x = starttilex; x * 32 < max_x; ++x)
+  {
+    for (int y = starttiley; y * 32 < max_y; ++y)
+    {
+      if (tiles.get_tile_flags(x, y) & TILE_SOLID)
         return true;
     }
   }
@@ -87,6 +116,7 @@ bool collision_object_map(const base_type& base)
 
 /**
  * Performs a collision check using a custom function on each tile.
+ * Tiles without any attribute can't match and are skipped.
  * @param base The object's base rectangle.
  * @param function The function to apply to each tile.
  * @return void* A pointer to the tile if a collision is detected, otherwise 0.
@@ -105,6 +135,9 @@ void* collision_func(const base_type& base, tiletestfunction function)
   {
     for (int y = starttiley; y * 32 < max_y; ++y)
     {
+      if (level.get_tile_flags(x, y) == 0)
+        continue;
+
       Tile* tile = tilemanager.get(level.get_tile_at(x, y));
       void* result = function(tile);
       if (result != 0)
@@ -137,14 +170,92 @@ Tile* collision_goal(const base_type& base)
   return (Tile*)collision_func(base, test_goal_tile_function);
 }
 
+/**
+ * Computes the next step at which the row or column of tiles covered by
+ * an object may change, by the same rules as collision_object_map().
+ * The result may be one step early but is never late, which keeps
+ * rounding errors from letting an object slip past a tile.
+ * @param origin The coordinate of the object at step 0.
+ * @param size The width or height of the object.
+ * @param d The distance moved per step along this axis.
+ * @param k The current step.
+ * @param limit The step to return if nothing changes before it.
+ * @return int A step after k, no later than limit.
+ */
+static int next_tile_boundary(float origin, float size, float d, int k, int limit)
+{
+  if (d == 0)
+    return limit;
+
+  float pos = origin + k * d;
+
+  // int() rounds towards zero, so left of or above the level every step
+  // is tested, just like before
+  if (pos < 0)
+    return std::min(k + 1, limit);
+
+  int first = int(pos + 1) / 32;
+  int last = (int(pos + size) - 1) / 32;
+
+  // positions at which the first and the last covered tile change
+  float a, b;
+  if (d > 0)
+  {
+    a = (first + 1) * 32 - 1;
+    b = (last + 1) * 32 + 1 - size;
+  }
+  else
+  {
+    a = first * 32 - 1;
+    b = last * 32 + 1 - size;
+  }
+
+  float steps = floorf(std::min((a - origin) / d, (b - origin) / d));
+  if (steps >= limit)
+    return limit;
+  return std::max(int(steps), k + 1);
+}
+
+/**
+ * Moves an object in steps of (dx, dy) and finds the first step at which
+ * it hits a solid tile. The tiles covered by the object only change when
+ * it crosses a tile boundary, so only those steps are tested.
+ * @param base The object at step 0.
+ * @param dx The distance moved per step in x direction.
+ * @param dy The distance moved per step in y direction.
+ * @param first The first step to test.
+ * @param last The last step to test.
+ * @param tiles The tiles around the object.
+ * @return int The first colliding step, or -1 if there is none.
+ */
+static int first_collision_step(const base_type& base, float dx, float dy, int first, int last,
+                                TileNeighbourhood& tiles)
+{
+  base_type probe = base;
+
+  for (int k = first; k <= last; )
+  {
+    probe.x = base.x + k * dx;
+    probe.y = base.y + k * dy;
+    if (collision_object_map(probe, tiles))
+      return k;
+
+    k = std::min(next_tile_boundary(base.x, base.width, dx, k, last + 1),
+                 next_tile_boundary(base.y, base.height, dy, k, last + 1));
+  }
+
+  return -1;
+}
+
 /**
  * Performs swept collision detection for an object moving from an old to a new position.
+ * The object is stopped at the last free step before the first solid tile
+ * on its path; a diagonal move then slides along x or y if possible.
  * @param old The object's previous position.
  * @param current The object's current position.
  */
 void collision_swept_object_map(base_type* old, base_type* current)
 {
-  int steps; /* Used to speed up the collision tests, by stepping every 16pixels in the path. */
   int h;
   float lpath; /* Holds the longest path, which is either in X or Y direction. */
   float xd, yd; /* Hold the smallest steps in X and Y directions. */
@@ -203,73 +314,66 @@ void collision_swept_object_map(base_type* old, base_type* current)
     yd = (current->y - old->y) / lpath;
   }
 
-  steps = (int)(lpath / (float)16);
-
   float orig_x = old->x;
   float orig_y = old->y;
-  old->x += xd;
-  old->y += yd;
 
-  for (float i = 0; i <= lpath; old->x += xd, old->y += yd, ++i)
+  // The path is tested in steps of (xd, yd), from the first step after
+  // the old position up to one step past the new one
+  // Backing off and sliding keep probing the same tiles
+  TileNeighbourhood tiles;
+  int hit = first_collision_step(*old, xd, yd, 1, int(lpath) + 1, tiles);
+
+  if (hit >= 0)
   {
-    if (steps > 0)
-    {
-      old->y += yd * 16.;
-      old->x += xd * 16.;
-      steps--;
-    }
+    // last position on the path that was free
+    float free_x = orig_x + (hit - 1) * xd;
+    float free_y = orig_y + (hit - 1) * yd;
 
-    if (collision_object_map(*old))
+    switch (h)
     {
-      switch (h)
+    case 1:
+      current->y = free_y;
+      while (collision_object_map(*current, tiles))
+        current->y -= yd;
+      break;
+    case 2:
+      current->x = free_x;
+      while (collision_object_map(*current, tiles))
+        current->x -= xd;
+      break;
+    case 3:
+      xt = current->x;
+      yt = current->y;
+      current->x = free_x;
+      current->y = free_y;
+      while (collision_object_map(*current, tiles))
       {
-      case 1:
-        current->y = old->y - yd;
-        while (collision_object_map(*current))
-          current->y -= yd;
-        break;
-      case 2:
-        current->x = old->x - xd;
-        while (collision_object_map(*current))
-          current->x -= xd;
-        break;
-      case 3:
-        xt = current->x;
-        yt = current->y;
-        current->x = old->x - xd;
-        current->y = old->y - yd;
-        while (collision_object_map(*current))
-        {
-          current->x -= xd;
-          current->y -= yd;
-        }
-
-        temp = current->x;
-        current->x = xt;
-        if (!collision_object_map(*current))
-          break;
-        current->x = temp;
-        temp = current->y;
-        current->y = yt;
-
-        if (!collision_object_map(*current))
-        {
-          break;
-        }
-        else
-        {
-          current->y = temp;
-          while (!collision_object_map(*current))
-            current->y += yd;
-          current->y -= yd;
-          break;
-        }
+        current->x -= xd;
+        current->y -= yd;
+      }
 
+      temp = current->x;
+      current->x = xt;
+      if (!collision_object_map(*current, tiles))
         break;
-      default:
+      current->x = temp;
+      temp = current->y;
+      current->y = yt;
+
+      if (!collision_object_map(*current, tiles))
         break;
+
+      // Slide along y until the tile that stopped the object
+      {
+        base_type probe = *current;
+        probe.y = temp;
+        int last = int(fabsf((yt - temp) / yd)) + int(32 / fabsf(yd)) + 1;
+        int stop = first_collision_step(probe, 0, yd, 0, last, tiles);
+        current->y = (stop >= 0) ? temp + (stop - 1) * yd : temp;
       }
       break;
+    default:
+      break;
     }
   }
 
@@ -300,8 +404,7 @@ Tile* gettile(float x, float y)
  */
 bool issolid(float x, float y)
 {
-  Tile* tile = gettile(x, y);
-  return tile && tile->solid;
+  return World::current()->get_level()->gettileflags(x, y) & TILE_SOLID;
 }
 
 /**
@@ -312,8 +415,7 @@ bool issolid(float x, float y)
  */
 bool isbrick(float x, float y)
 {
-  Tile* tile = gettile(x, y);
-  return tile && tile->brick;
+  return World::current()->get_level()->gettileflags(x, y) & TILE_BRICK;
 }
 
 /**
@@ -324,8 +426,7 @@ bool isbrick(float x, float y)
  */
 bool isice(float x, float y)
 {
-  Tile* tile = gettile(x, y);
-  return tile && tile->ice;
+  return World::current()->get_level()->gettileflags(x, y) & TILE_ICE;
 }
 
 /**
@@ -336,8 +437,7 @@ bool isice(float x, float y)
  */
 bool isfullbox(float x, float y)
 {
-  Tile* tile = gettile(x, y);
-  return tile && tile->fullbox;
+  return World::current()->get_level()->gettileflags(x, y) & TILE_FULLBOX;
 }
 
 /**
@@ -348,8 +448,76 @@ bool isfullbox(float x, float y)
  */
 bool isdistro(float x, float y)
 {
-  Tile* tile = gettile(x, y);
-  return tile && tile->distro;
+  return World::current()->get_level()->gettileflags(x, y) & TILE_DISTRO;
+}
+
+/**
+ * Constructor for TileNeighbourhood, nothing is copied until the first
+ * probe.
+ */
+TileNeighbourhood::TileNeighbourhood()
+  : level(nullptr), version(0), left(0), top(0)
+{
+}
+
+/**
+ * Returns the TileFlags of a tile, copying the tiles around it first if
+ * the window doesn't hold it.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @return The TileFlags of the tile.
+ */
+unsigned char TileNeighbourhood::get_tile_flags(int x, int y)
+{
+  const Level& current = *World::current()->get_level();
+
+  if (&current != level || current.get_flags_version() != version)
+  {
+    fill(current, x - 1, y - 1);
+  }
+  else if (x < left || x >= left + SIZE || y < top || y >= top + SIZE)
+  {
+    // Move the window only as far as needed, so that probes which spread
+    // over the object settle on a window covering all of them
+    int new_left = std::min(std::max(left, x - SIZE + 1), x);
+    int new_top = std::min(std::max(top, y - SIZE + 1), y);
+    fill(current, new_left, new_top);
+  }
+
+  return flags[x - left][y - top];
+}
+
+/**
+ * Checks if a tile at the specified coordinates is solid.
+ * @param x The x-coordinate.
+ * @param y The y-coordinate.
+ * @return bool True if the tile is solid, false otherwise.
+ */
+bool TileNeighbourhood::issolid(float x, float y)
+{
+  return get_tile_flags(static_cast<int>(x) / 32, static_cast<int>(y) / 32) & TILE_SOLID;
+}
+
+/**
+ * Copies the TileFlags of the window.
+ * @param level_ The level to copy from.
+ * @param x The first column of the window.
+ * @param y The first row of the window.
+ */
+void TileNeighbourhood::fill(const Level& level_, int x, int y)
+{
+  level = &level_;
+  version = level_.get_flags_version();
+  left = x;
+  top = y;
+
+  for (int i = 0; i < SIZE; ++i)
+  {
+    for (int j = 0; j < SIZE; ++j)
+    {
+      flags[i][j] = level_.get_tile_flags(x + i, y + j);
+    }
+  }
 }
 
 // EOF
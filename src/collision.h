@@ -24,6 +24,7 @@
 
 class Tile;
 class World;
+class Level;
 
 // Collision objects
 enum
@@ -39,10 +40,41 @@ enum CollisionType {
   COLLISION_SQUISH
 };
 
+/** A copy of the TileFlags around an object. The tile probes of one
+    action() keep asking for the same few tiles, which then come from
+    here instead of from the World and its Level. The window slides along
+    when a probe falls outside of it, so it follows the object across
+    tile boundaries, and it is copied again when the level's flags
+    change. */
+class TileNeighbourhood
+{
+public:
+  TileNeighbourhood();
+
+  /** Return the TileFlags of the interactive tile at x,y (these are
+      logical and not pixel coordinates) */
+  unsigned char get_tile_flags(int x, int y);
+
+  /** Checks if the tile at the pixel position x/y is solid */
+  bool issolid(float x, float y);
+
+private:
+  enum { SIZE = 4 };
+
+  void fill(const Level& level, int x, int y);
+
+  const Level* level;     /**< The level copied from, nullptr if none yet */
+  unsigned int version;   /**< Level::get_flags_version() when copied */
+  int left;
+  int top;
+  unsigned char flags[SIZE][SIZE];
+};
+
 bool rectcollision(const base_type& one, const base_type& two); // Checks if two rectangles are colliding
 bool rectcollision_offset(const base_type& one, const base_type& two, float off_x, float off_y); // Checks if rectangles collide with an offset
 void collision_swept_object_map(base_type* old, base_type* current); // Swept collision detection for object movement
 bool collision_object_map(const base_type& object); // Checks for object collision with map tiles
+bool collision_object_map(const base_type& object, TileNeighbourhood& tiles); // The same, reading the tiles from a TileNeighbourhood
 Tile* gettile(float x, float y); // Gets tile at specific coordinates
 bool issolid(float x, float y); // Checks if the tile is solid
 bool isbrick(float x, float y); // Checks if the tile is a brick
@@ -0,0 +1,460 @@
+//  collision_bench.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "collision_bench.h"
+#include "collision.h"
+#include "dir_index.h"
+#include "globals.h"
+#include "level.h"
+#include "tile.h"
+#include "world.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// How far outside the level queries may start, in pixels
+const float MARGIN = 64;
+
+// Tries to find a free start position before a query is left out
+const int PLACE_TRIES = 16;
+
+struct Query
+{
+  base_type old;
+  base_type current;
+};
+
+/** Time spent by one function in its two versions */
+struct Timing
+{
+  const char* name;
+  double current;
+  double reference;
+  unsigned long count;
+};
+
+Timing timings[] = {
+  { "collision_swept_object_map", 0, 0, 0 },
+  { "collision_object_map", 0, 0, 0 },
+  { "collision_func", 0, 0, 0 }
+};
+
+/**
+ * Returns a random number for the queries.
+ * @param min The smallest number.
+ * @param max The largest number.
+ * @return A number from min to max.
+ */
+float random_range(float min, float max)
+{
+  return min + (max - min) * (st_rand() % 10001) / 10000.0f;
+}
+
+/**
+ * Reference for collision_object_map(), asking the tile of every cell.
+ */
+bool reference_object_map(const base_type& base)
+{
+  const Level& level = *World::current()->get_level();
+  TileManager& tilemanager = *TileManager::instance();
+
+  int starttilex = int(base.x + 1) / 32;
+  int starttiley = int(base.y + 1) / 32;
+  int max_x = int(base.x + base.width);
+  int max_y = int(base.y + base.height);
+
+  for (int x = starttilex; x * 32 < max_x; ++x)
+  {
+    for (int y = starttiley; y * 32 < max_y; ++y)
+    {
+      Tile* tile = tilemanager.get(level.get_tile_at(x, y));
+      if (tile && tile->solid)
+        return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Reference for collision_func(), calling the function for every cell.
+ */
+void* reference_func(const base_type& base, tiletestfunction function)
+{
+  const Level& level = *World::current()->get_level();
+  TileManager& tilemanager = *TileManager::instance();
+
+  int starttilex = int(base.x) / 32;
+  int starttiley = int(base.y) / 32;
+  int max_x = int(base.x + base.width);
+  int max_y = int(base.y + base.height);
+
+  for (int x = starttilex; x * 32 < max_x; ++x)
+  {
+    for (int y = starttiley; y * 32 < max_y; ++y)
+    {
+      Tile* tile = tilemanager.get(level.get_tile_at(x, y));
+      void* result = function(tile);
+      if (result != 0)
+        return result;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Reference for the path search of collision_swept_object_map(),
+ * testing every step.
+ */
+int reference_first_step(const base_type& base, float dx, float dy, int first, int last)
+{
+  base_type probe = base;
+  for (int k = first; k <= last; ++k)
+  {
+    probe.x = base.x + k * dx;
+    probe.y = base.y + k * dy;
+    if (reference_object_map(probe))
+      return k;
+  }
+  return -1;
+}
+
+/**
+ * Reference for collision_swept_object_map(), the same rules without the
+ * shortcuts.
+ */
+void reference_swept(base_type* old, base_type* current)
+{
+  float lpath;
+  float xd = 0;
+  float yd = 0;
+  int h;
+
+  if (old->x == current->x && old->y == current->y)
+    return;
+
+  if (old->x == current->x)
+  {
+    lpath = fabsf(current->y - old->y);
+    yd = current->y < old->y ? -1 : 1;
+    h = 1;
+  }
+  else if (old->y == current->y)
+  {
+    lpath = fabsf(current->x - old->x);
+    xd = current->x < old->x ? -1 : 1;
+    h = 2;
+  }
+  else
+  {
+    lpath = fabsf(current->x - old->x);
+    if (current->y - old->y > lpath || old->y - current->y > lpath)
+      lpath = fabsf(current->y - old->y);
+    h = 3;
+    xd = (current->x - old->x) / lpath;
+    yd = (current->y - old->y) / lpath;
+  }
+
+  float orig_x = old->x;
+  float orig_y = old->y;
+  int hit = reference_first_step(*old, xd, yd, 1, int(lpath) + 1);
+
+  if (hit >= 0)
+  {
+    float free_x = orig_x + (hit - 1) * xd;
+    float free_y = orig_y + (hit - 1) * yd;
+
+    if (h == 1)
+    {
+      current->y = free_y;
+      while (reference_object_map(*current))
+        current->y -= yd;
+    }
+    else if (h == 2)
+    {
+      current->x = free_x;
+      while (reference_object_map(*current))
+        current->x -= xd;
+    }
+    else
+    {
+      float xt = current->x;
+      float yt = current->y;
+      current->x = free_x;
+      current->y = free_y;
+      while (reference_object_map(*current))
+      {
+        current->x -= xd;
+        current->y -= yd;
+      }
+
+      float temp = current->x;
+      current->x = xt;
+      if (reference_object_map(*current))
+      {
+        current->x = temp;
+        temp = current->y;
+        current->y = yt;
+        if (reference_object_map(*current))
+        {
+          base_type probe = *current;
+          probe.y = temp;
+          int last = int(fabsf((yt - temp) / yd)) + int(32 / fabsf(yd)) + 1;
+          int stop = reference_first_step(probe, 0, yd, 0, last);
+          current->y = (stop >= 0) ? temp + (stop - 1) * yd : temp;
+        }
+      }
+    }
+  }
+
+  if ((xd > 0 && current->x < orig_x) || (xd < 0 && current->x > orig_x))
+    current->x = orig_x;
+  if ((yd > 0 && current->y < orig_y) || (yd < 0 && current->y > orig_y))
+    current->y = orig_y;
+
+  *old = *current;
+}
+
+void* test_goal(Tile* tile)
+{
+  if (tile && tile->goal)
+    return tile;
+  return 0;
+}
+
+bool same_position(const base_type& a, const base_type& b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+double seconds_since(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int CollisionBench::queries = 0;
+unsigned long CollisionBench::mismatches = 0;
+
+/**
+ * Requests a run, done by run() once the game is set up.
+ * @param queries_per_level The number of queries per function and level.
+ */
+void CollisionBench::request(int queries_per_level)
+{
+  queries = queries_per_level;
+}
+
+/**
+ * Collects the level files below a directory.
+ * @param dir The directory to search.
+ * @param levels Receives the level files.
+ */
+void CollisionBench::find_levels(const std::string& dir, std::vector<std::string>* levels)
+{
+  for (const DirIndex::Entry& entry : DirIndex::list(dir).entries)
+  {
+    if (entry.name[0] == '.')
+    {
+      continue;
+    }
+
+    std::string path = dir + "/" + entry.name;
+    if (entry.is_dir)
+    {
+      find_levels(path, levels);
+    }
+    else if (entry.name.size() > 4 && entry.name.compare(entry.name.size() - 4, 4, ".stl") == 0)
+    {
+      levels->push_back(path);
+    }
+  }
+}
+
+/**
+ * Runs the queries on one level.
+ * @param file The level file.
+ */
+void CollisionBench::test_level(const std::string& file)
+{
+  World world(file);
+  World::set_current(&world);
+  float width = world.get_level()->width * 32;
+  float height = 15 * 32;
+
+  // The same queries for every run, different ones for every level
+  unsigned int seed = 0;
+  for (char c : file)
+  {
+    seed = seed * 31 + c;
+  }
+  st_srand(seed);
+
+  std::vector<Query> set;
+  set.reserve(queries);
+  for (int i = 0; i < queries; ++i)
+  {
+    Query query;
+    memset(&query, 0, sizeof(query));
+    query.old.width = floorf(random_range(8, 64));
+    query.old.height = floorf(random_range(8, 64));
+
+    // Objects never start inside a wall
+    int tries = 0;
+    do
+    {
+      query.old.x = random_range(-MARGIN, width + MARGIN);
+      query.old.y = random_range(-MARGIN, height + MARGIN);
+    }
+    while (reference_object_map(query.old) && ++tries < PLACE_TRIES);
+    if (tries == PLACE_TRIES)
+    {
+      continue;
+    }
+
+    // Straight moves take other paths through the code than diagonal ones
+    query.current = query.old;
+    int kind = st_rand() % 4;
+    query.current.x += kind == 1 ? 0 : random_range(-48, 48);
+    query.current.y += kind == 2 ? 0 : random_range(-48, 48);
+    set.push_back(query);
+  }
+
+  std::vector<Query> current = set;
+  std::vector<Query> reference = set;
+  std::vector<char> current_hits(set.size());
+  std::vector<char> reference_hits(set.size());
+  std::vector<void*> current_tiles(set.size());
+  std::vector<void*> reference_tiles(set.size());
+
+  Clock::time_point start = Clock::now();
+  for (Query& query : current)
+  {
+    collision_swept_object_map(&query.old, &query.current);
+  }
+  timings[0].current += seconds_since(start);
+
+  start = Clock::now();
+  for (Query& query : reference)
+  {
+    reference_swept(&query.old, &query.current);
+  }
+  timings[0].reference += seconds_since(start);
+
+  start = Clock::now();
+  for (size_t i = 0; i < set.size(); ++i)
+  {
+    current_hits[i] = collision_object_map(set[i].current);
+  }
+  timings[1].current += seconds_since(start);
+
+  start = Clock::now();
+  for (size_t i = 0; i < set.size(); ++i)
+  {
+    reference_hits[i] = reference_object_map(set[i].current);
+  }
+  timings[1].reference += seconds_since(start);
+
+  start = Clock::now();
+  for (size_t i = 0; i < set.size(); ++i)
+  {
+    current_tiles[i] = collision_func(set[i].current, test_goal);
+  }
+  timings[2].current += seconds_since(start);
+
+  start = Clock::now();
+  for (size_t i = 0; i < set.size(); ++i)
+  {
+    reference_tiles[i] = reference_func(set[i].current, test_goal);
+  }
+  timings[2].reference += seconds_since(start);
+
+  for (Timing& timing : timings)
+  {
+    timing.count += set.size();
+  }
+
+  for (size_t i = 0; i < set.size(); ++i)
+  {
+    const base_type& from = set[i].old;
+    const base_type& to = set[i].current;
+
+    if (!same_position(current[i].current, reference[i].current) ||
+        !same_position(current[i].old, reference[i].old))
+    {
+      ++mismatches;
+      printf("%s: swept %gx%g from %g,%g to %g,%g ends at %g,%g instead of %g,%g\n",
+             file.c_str(), from.width, from.height, from.x, from.y, to.x, to.y,
+             current[i].current.x, current[i].current.y,
+             reference[i].current.x, reference[i].current.y);
+    }
+    if (current_hits[i] != reference_hits[i])
+    {
+      ++mismatches;
+      printf("%s: object_map %gx%g at %g,%g is %d instead of %d\n",
+             file.c_str(), to.width, to.height, to.x, to.y, current_hits[i], reference_hits[i]);
+    }
+    if (current_tiles[i] != reference_tiles[i])
+    {
+      ++mismatches;
+      printf("%s: func %gx%g at %g,%g finds another tile\n",
+             file.c_str(), to.width, to.height, to.x, to.y);
+    }
+  }
+}
+
+/**
+ * Runs the queries on every level and prints the report.
+ * @return True if both versions agreed on every query.
+ */
+bool CollisionBench::run()
+{
+  std::vector<std::string> levels;
+  find_levels(datadir + "/levels", &levels);
+
+  for (const std::string& level : levels)
+  {
+    test_level(level);
+  }
+
+  printf("Collision queries on %u levels, %lu mismatches\n", (unsigned int)levels.size(), mismatches);
+  for (const Timing& timing : timings)
+  {
+    if (timing.count == 0)
+    {
+      continue;
+    }
+    printf("  %-28s %12.0f queries/s  (reference %12.0f queries/s)\n", timing.name,
+           timing.current > 0 ? timing.count / timing.current : 0.0,
+           timing.reference > 0 ? timing.count / timing.reference : 0.0);
+  }
+  return mismatches == 0;
+}
+
+// EOF
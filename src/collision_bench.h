@@ -0,0 +1,55 @@
+//  collision_bench.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_COLLISION_BENCH_H
+#define SUPERTUX_COLLISION_BENCH_H
+
+#include <string>
+#include <vector>
+
+/** Checks the tile collision functions of collision.cpp against plain
+    reference versions that test every tile and every step, and measures
+    their speed. Every level below the levels directory is loaded in
+    turn and hit with random queries; any query where the two versions
+    disagree is printed, followed by the queries per second of both.
+    Run it before and after changing the collision code. */
+class CollisionBench
+{
+public:
+  /** Request a run instead of the normal game */
+  static void request(int queries_per_level);
+
+  static bool is_requested() { return queries > 0; }
+
+  /** Test all levels and print the report, returns false on mismatches */
+  static bool run();
+
+private:
+  static void find_levels(const std::string& dir, std::vector<std::string>* levels);
+  static void test_level(const std::string& file);
+
+  static int queries;
+  static unsigned long mismatches;
+};
+
+#endif /*SUPERTUX_COLLISION_BENCH_H*/
+
+// EOF
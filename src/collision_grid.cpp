@@ -0,0 +1,167 @@
+//  collision_grid.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <math.h>
+#include <algorithm>
+#include "collision_grid.h"
+#include "badguy.h"
+
+/**
+ * Constructor for CollisionGrid, starts out empty.
+ */
+CollisionGrid::CollisionGrid()
+  : origin(0), used(0)
+{
+}
+
+/**
+ * Computes the columns covered by an object.
+ * @param base The position and size of the object.
+ * @param first Receives the first column.
+ * @param last Receives the last column.
+ */
+void CollisionGrid::get_span(const base_type& base, int* first, int* last) const
+{
+  *first = static_cast<int>(floorf(base.x / COLUMN_WIDTH));
+  *last = static_cast<int>(floorf((base.x + base.width) / COLUMN_WIDTH));
+}
+
+/**
+ * Sorts the badguys into their columns. Dying badguys can't collide and
+ * are left out. The column vectors keep their memory between frames.
+ * @param bad_guys The badguys of the world.
+ */
+void CollisionGrid::rebuild(const std::vector<BadGuy*>& bad_guys)
+{
+  for (int i = 0; i < used; ++i)
+  {
+    columns[i].clear();
+  }
+  used = 0;
+
+  int min_column = 0;
+  int max_column = -1;
+  bool first = true;
+
+  for (BadGuy* badguy : bad_guys)
+  {
+    if (badguy->dying != DYING_NOT)
+    {
+      continue;
+    }
+
+    int a, b;
+    get_span(badguy->base, &a, &b);
+    if (first || a < min_column)
+    {
+      min_column = a;
+    }
+    if (first || b > max_column)
+    {
+      max_column = b;
+    }
+    first = false;
+  }
+
+  if (first)
+  {
+    return;
+  }
+
+  origin = min_column;
+  used = max_column - min_column + 1;
+  if (int(columns.size()) < used)
+  {
+    columns.resize(used);
+  }
+
+  for (BadGuy* badguy : bad_guys)
+  {
+    if (badguy->dying != DYING_NOT)
+    {
+      continue;
+    }
+
+    int a, b;
+    get_span(badguy->base, &a, &b);
+
+    Entry entry;
+    entry.badguy = badguy;
+    entry.first_column = a;
+    for (int c = a; c <= b; ++c)
+    {
+      columns[c - origin].push_back(entry);
+    }
+  }
+}
+
+/**
+ * Collects the badguys sharing a column with an object. A badguy that
+ * shares several columns with it is only reported in the first one.
+ * @param base The position and size of the object.
+ * @param result Receives the candidates, it is cleared first.
+ */
+void CollisionGrid::query(const base_type& base, std::vector<BadGuy*>* result) const
+{
+  result->clear();
+
+  int a, b;
+  get_span(base, &a, &b);
+  int first = std::max(a, origin);
+  int last = std::min(b, origin + used - 1);
+
+  for (int c = first; c <= last; ++c)
+  {
+    for (const Entry& entry : columns[c - origin])
+    {
+      if (std::max(a, entry.first_column) == c)
+      {
+        result->push_back(entry.badguy);
+      }
+    }
+  }
+}
+
+/**
+ * Collects all pairs of badguys that share a column, each pair only in
+ * the first column both of them cover.
+ * @param result Receives the candidate pairs, it is cleared first.
+ */
+void CollisionGrid::get_pairs(std::vector<std::pair<BadGuy*, BadGuy*> >* result) const
+{
+  result->clear();
+
+  for (int c = 0; c < used; ++c)
+  {
+    const Column& column = columns[c];
+    for (unsigned int i = 0; i < column.size(); ++i)
+    {
+      for (unsigned int j = i + 1; j < column.size(); ++j)
+      {
+        if (std::max(column[i].first_column, column[j].first_column) == c + origin)
+        {
+          result->push_back(std::make_pair(column[i].badguy, column[j].badguy));
+        }
+      }
+    }
+  }
+}
+
+// EOF
@@ -0,0 +1,69 @@
+//  collision_grid.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_COLLISION_GRID_H
+#define SUPERTUX_COLLISION_GRID_H
+
+#include <vector>
+#include <utility>
+#include "type.h"
+
+class BadGuy;
+
+/** Broadphase for the collision checks against badguys. Levels are only
+    15 tiles high, so badguys are sorted into columns of COLUMN_WIDTH
+    pixels and only objects sharing a column are tested against each
+    other. Every candidate is reported once, even if it spans several
+    columns. */
+class CollisionGrid
+{
+public:
+  static const int COLUMN_WIDTH = 64;
+
+  CollisionGrid();
+
+  /** Sort the given badguys into columns, call once per frame */
+  void rebuild(const std::vector<BadGuy*>& bad_guys);
+
+  /** Collect the badguys that share a column with base */
+  void query(const base_type& base, std::vector<BadGuy*>* result) const;
+
+  /** Collect all pairs of badguys that share a column */
+  void get_pairs(std::vector<std::pair<BadGuy*, BadGuy*> >* result) const;
+
+private:
+  struct Entry
+  {
+    BadGuy* badguy;
+    int first_column;
+  };
+
+  typedef std::vector<Entry> Column;
+
+  std::vector<Column> columns;
+  int origin;  // column number of columns[0]
+  int used;    // number of columns filled by the last rebuild()
+
+  void get_span(const base_type& base, int* first, int* last) const;
+};
+
+#endif /*SUPERTUX_COLLISION_GRID_H*/
+
+// EOF
@@ -42,6 +42,8 @@ static void defaults()
   use_fullscreen = true;
   show_fps = false;
   use_gl = false;
+  use_gl_shaders = false;
+  use_gx = false;
   use_sound = true;
   use_music = true;
 }
@@ -95,6 +97,10 @@ void loadconfig()
   std::string video;
   reader.read_string("video", &video);
   use_gl = (video == "opengl");
+#ifdef _WII_
+  use_gx = (video == "gx");
+#endif
+  reader.read_bool("gl-shaders", &use_gl_shaders);
 
   reader.read_int("joystick", &joystick_num);
   use_joystick = (joystick_num >= 0);
@@ -123,41 +129,40 @@ void loadconfig()
  */
 void saveconfig()
 {
-  // Open the config file for writing
-  FILE* config = opendata(config_filename, "w");
-
-  if (config)
-  {
-    fprintf(config, "(supertux-config\n");
-    fprintf(config, "\t;; the following options can be set to #t or #f:\n");
-    fprintf(config, "\t(fullscreen %s)\n", use_fullscreen ? "#t" : "#f");
-    fprintf(config, "\t(sound %s)\n", use_sound ? "#t" : "#f");
-    fprintf(config, "\t(music %s)\n", use_music ? "#t" : "#f");
-    fprintf(config, "\t(show_fps %s)\n", show_fps ? "#t" : "#f");
-
-    fprintf(config, "\n\t;; either \"opengl\" or \"sdl\"\n");
-    fprintf(config, "\t(video \"%s\")\n", use_gl ? "opengl" : "sdl");
-
-    fprintf(config, "\n\t;; joystick number (-1 means no joystick):\n");
-    fprintf(config, "\t(joystick %d)\n", use_joystick ? joystick_num : -1);
-
-    fprintf(config, "\t(joystick-x %d)\n", joystick_keymap.x_axis);
-    fprintf(config, "\t(joystick-y %d)\n", joystick_keymap.y_axis);
-    fprintf(config, "\t(joystick-a %d)\n", joystick_keymap.a_button);
-    fprintf(config, "\t(joystick-b %d)\n", joystick_keymap.b_button);
-    fprintf(config, "\t(joystick-start %d)\n", joystick_keymap.start_button);
-    fprintf(config, "\t(joystick-deadzone %d)\n", joystick_keymap.dead_zone);
-
-    fprintf(config, "\t(keyboard-jump %d)\n", keymap.jump);
-    fprintf(config, "\t(keyboard-duck %d)\n", keymap.duck);
-    fprintf(config, "\t(keyboard-left %d)\n", keymap.left);
-    fprintf(config, "\t(keyboard-right %d)\n", keymap.right);
-    fprintf(config, "\t(keyboard-fire %d)\n", keymap.fire);
-
-    fprintf(config, ")\n");
-
-    fclose(config);
-  }
+  LispWriter writer("supertux-config");
+  writer.write_comment("; the following options can be set to #t or #f:");
+  writer.write_boolean("fullscreen", use_fullscreen);
+  writer.write_boolean("sound", use_sound);
+  writer.write_boolean("music", use_music);
+  writer.write_boolean("show_fps", show_fps);
+
+#ifdef _WII_
+  writer.write_comment("; either \"gx\" or \"sdl\"");
+  writer.write_string("video", use_gx ? "gx" : "sdl");
+#else
+  writer.write_comment("; either \"opengl\" or \"sdl\"");
+  writer.write_string("video", use_gl ? "opengl" : "sdl");
+#endif
+  writer.write_comment("; draw with vertex buffers and shaders in opengl mode");
+  writer.write_boolean("gl-shaders", use_gl_shaders);
+
+  writer.write_comment("; joystick number (-1 means no joystick):");
+  writer.write_int("joystick", use_joystick ? joystick_num : -1);
+
+  writer.write_int("joystick-x", joystick_keymap.x_axis);
+  writer.write_int("joystick-y", joystick_keymap.y_axis);
+  writer.write_int("joystick-a", joystick_keymap.a_button);
+  writer.write_int("joystick-b", joystick_keymap.b_button);
+  writer.write_int("joystick-start", joystick_keymap.start_button);
+  writer.write_int("joystick-deadzone", joystick_keymap.dead_zone);
+
+  writer.write_int("keyboard-jump", keymap.jump);
+  writer.write_int("keyboard-duck", keymap.duck);
+  writer.write_int("keyboard-left", keymap.left);
+  writer.write_int("keyboard-right", keymap.right);
+  writer.write_int("keyboard-fire", keymap.fire);
+
+  writer.save(std::string(st_dir) + "/" + config_filename);
 }
 
 // EOF
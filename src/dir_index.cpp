@@ -0,0 +1,182 @@
+//  dir_index.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <filesystem>
+#include <map>
+#include "dir_index.h"
+#include "asset_archive.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+typedef std::map<std::string, DirIndex::Listing> Listings;
+Listings listings;
+
+/**
+ * Brings a path into the form used as key, without a trailing slash.
+ * @param path The path of a directory.
+ * @return The key.
+ */
+std::string make_key(const std::string& path)
+{
+  std::string key = fs::path(path).lexically_normal().string();
+  while (key.size() > 1 && key[key.size() - 1] == '/')
+  {
+    key.erase(key.size() - 1);
+  }
+  return key;
+}
+
+/**
+ * Adds entries of the asset archive to a listing.
+ * @param listing The listing of the directory.
+ * @param names The names the archive has in the directory.
+ * @param is_dir Whether the names are directories.
+ */
+void add_packed(DirIndex::Listing* listing, const std::vector<std::string>& names, bool is_dir)
+{
+  size_t loose = listing->entries.size();
+  for (const std::string& name : names)
+  {
+    bool found = false;
+    for (size_t i = 0; i < loose && !found; ++i)
+    {
+      found = listing->entries[i].name == name;
+    }
+    if (!found)
+    {
+      DirIndex::Entry entry;
+      entry.name = name;
+      entry.is_dir = is_dir;
+      listing->entries.push_back(entry);
+    }
+  }
+  if (!names.empty())
+  {
+    listing->exists = true;
+  }
+}
+
+} // namespace
+
+unsigned int DirIndex::generation_ = 0;
+
+/**
+ * Gets the contents of a directory, reading it if it isn't cached.
+ * @param path The directory.
+ * @return The listing, valid until the directory is invalidated.
+ */
+const DirIndex::Listing& DirIndex::list(const std::string& path)
+{
+  std::string key = make_key(path);
+  Listings::iterator i = listings.find(key);
+  if (i != listings.end())
+  {
+    return i->second;
+  }
+
+  Listing& listing = listings[key];
+  std::error_code ec;
+  fs::directory_iterator it(key, ec);
+  listing.exists = !ec;
+
+  // The entry type comes with the directory on most systems, so this
+  // doesn't need a stat() per entry
+  for (; !ec && it != fs::directory_iterator(); it.increment(ec))
+  {
+    std::error_code type_ec;
+    Entry entry;
+    entry.name = it->path().filename().string();
+    entry.is_dir = it->is_directory(type_ec);
+    if (!entry.is_dir && !it->is_regular_file(type_ec))
+    {
+      continue;
+    }
+    listing.entries.push_back(entry);
+  }
+
+  // Add what the asset archive has here, unless a loose file or
+  // directory of the same name exists
+  std::vector<std::string> files;
+  std::vector<std::string> dirs;
+  AssetArchive::list(key, &files, &dirs);
+  add_packed(&listing, files, false);
+  add_packed(&listing, dirs, true);
+
+  return listing;
+}
+
+/**
+ * Tells whether a regular file exists according to the listing of its
+ * directory.
+ * @param file The path of the file.
+ * @return True if the file exists.
+ */
+bool DirIndex::has_file(const std::string& file)
+{
+  fs::path path(file);
+  std::string name = path.filename().string();
+  std::string dir = path.parent_path().string();
+
+  const Listing& listing = list(dir.empty() ? "." : dir);
+  for (const Entry& entry : listing.entries)
+  {
+    if (!entry.is_dir && entry.name == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Drops cached listings, they are read again on the next use.
+ * @param path The directory to forget along with its subdirectories,
+ * everything if empty.
+ */
+void DirIndex::invalidate(const std::string& path)
+{
+  ++generation_;
+
+  if (path.empty())
+  {
+    listings.clear();
+    return;
+  }
+
+  std::string key = make_key(path);
+  Listings::iterator i = listings.lower_bound(key);
+  while (i != listings.end() && i->first.compare(0, key.size(), key) == 0)
+  {
+    // Siblings like "key-2" sort between key and its subdirectories
+    if (i->first.size() == key.size() || i->first[key.size()] == '/')
+    {
+      listings.erase(i++);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+}
+
+// EOF
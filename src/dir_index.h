@@ -0,0 +1,69 @@
+//  dir_index.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_DIR_INDEX_H
+#define SUPERTUX_DIR_INDEX_H
+
+#include <string>
+#include <vector>
+
+/** Remembers the contents of the directories the menus look at, so the
+    level subsets, worldmaps and savegame slots don't have to be
+    searched on the disk (slow on the Wii's SD and USB drives) every time
+    a menu opens. A directory is read once on first use and stays cached
+    until it is invalidated, which everything writing to the data or
+    save directories has to do. */
+class DirIndex
+{
+public:
+  struct Entry
+  {
+    std::string name;
+    bool is_dir;
+  };
+
+  struct Listing
+  {
+    bool exists;
+    std::vector<Entry> entries;  // in the order the disk reports them
+  };
+
+  /** Get the contents of a directory */
+  static const Listing& list(const std::string& path);
+
+  /** Tell whether a regular file exists, looks into the cached listing
+      of its directory */
+  static bool has_file(const std::string& file);
+
+  /** Forget a directory and the directories below it, everything if
+      path is empty */
+  static void invalidate(const std::string& path = "");
+
+  /** Counts the invalidations, menus built from the index only need to
+      be rebuilt when it changed */
+  static unsigned int generation() { return generation_; }
+
+private:
+  static unsigned int generation_;
+};
+
+#endif /*SUPERTUX_DIR_INDEX_H*/
+
+// EOF
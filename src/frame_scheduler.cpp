@@ -0,0 +1,173 @@
+//  frame_scheduler.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <chrono>
+#include <SDL.h>
+#include "frame_scheduler.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::duration PERIOD = std::chrono::microseconds(1000000 / 60);
+const int POWER_SAVE_DIVIDER = 2;
+
+// Below this SDL_Delay() isn't precise enough, the rest is spent yielding
+const Clock::duration SPIN_TIME = std::chrono::milliseconds(2);
+
+// A flip longer than this waited for the display
+const Clock::duration BLOCKING_FLIP = std::chrono::milliseconds(3);
+
+// Vsync is decided anew after every window of normal frames, it is on
+// when at least VSYNC_FLIPS of them blocked
+const int WINDOW = 32;
+const int VSYNC_FLIPS = WINDOW * 3 / 4;
+
+bool started = false;
+Clock::time_point deadline;
+Clock::time_point last_frame;
+int missed = 0;
+
+Clock::time_point flip_start;
+FrameScheduler::Mode last_mode = FrameScheduler::NORMAL;
+int window_flips = 0;
+int blocking_flips = 0;
+bool vsync = false;
+
+/**
+ * Sleeps until the given time.
+ * @param when The time to wake up at.
+ */
+void sleep_until(Clock::time_point when)
+{
+  for (;;)
+  {
+    Clock::duration left = when - Clock::now();
+    if (left <= Clock::duration::zero())
+    {
+      return;
+    }
+
+    if (left > SPIN_TIME)
+    {
+      SDL_Delay(std::chrono::duration_cast<std::chrono::milliseconds>(left - SPIN_TIME).count());
+    }
+    else
+    {
+      SDL_Delay(0);
+    }
+  }
+}
+
+} // namespace
+
+/**
+ * Starts the pacing over with the next frame.
+ */
+void FrameScheduler::reset()
+{
+  started = false;
+}
+
+/**
+ * Sleeps until the next frame is due. A frame that is already late starts
+ * the cadence over instead of having the following ones rush to catch up.
+ * @param mode How many frames per second are wanted.
+ */
+void FrameScheduler::wait(Mode mode)
+{
+  Clock::duration period = (mode == POWER_SAVE) ? PERIOD * POWER_SAVE_DIVIDER : PERIOD;
+  Clock::time_point now = Clock::now();
+
+  if (started && mode == last_mode && now - last_frame > period + period / 2)
+  {
+    ++missed;
+  }
+
+  if (!started || now >= deadline || (vsync && mode == NORMAL))
+  {
+    deadline = now + period;
+  }
+  else
+  {
+    sleep_until(deadline);
+    deadline += period;
+  }
+
+  last_frame = Clock::now();
+  last_mode = mode;
+  started = true;
+}
+
+/**
+ * Marks the start of presenting a frame.
+ */
+void FrameScheduler::begin_flip()
+{
+  flip_start = Clock::now();
+}
+
+/**
+ * Marks the end of presenting a frame and updates the vsync detection.
+ * In power save mode the frames are paced by sleeping, so those flips
+ * say nothing about the display.
+ */
+void FrameScheduler::end_flip()
+{
+  if (last_mode != NORMAL)
+  {
+    return;
+  }
+
+  ++window_flips;
+  if (Clock::now() - flip_start >= BLOCKING_FLIP)
+  {
+    ++blocking_flips;
+  }
+
+  if (window_flips == WINDOW)
+  {
+    vsync = blocking_flips >= VSYNC_FLIPS;
+    window_flips = 0;
+    blocking_flips = 0;
+  }
+}
+
+/**
+ * Tells whether presenting waits for the vertical blank.
+ * @return True if the display paces the frames.
+ */
+bool FrameScheduler::has_vsync()
+{
+  return vsync;
+}
+
+/**
+ * Returns the number of frames that came too late.
+ * @return The number of missed deadlines since the start.
+ */
+int FrameScheduler::get_missed()
+{
+  return missed;
+}
+
+// EOF
@@ -0,0 +1,64 @@
+//  frame_scheduler.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_FRAME_SCHEDULER_H
+#define SUPERTUX_FRAME_SCHEDULER_H
+
+/** Paces the main loops of the game, the title screen and the worldmap.
+    wait() is called once per frame after flipscreen() and sleeps until
+    the next frame is due, the last millisecond or two by yielding since
+    SDL_Delay() tends to oversleep.
+
+    flipscreen() reports how long presenting took; when most flips block
+    for a while the display is synced to the vertical blank and already
+    paces the loop, then wait() doesn't sleep at all. Frames that come
+    later than one and a half periods after the previous one are counted
+    as missed. */
+class FrameScheduler
+{
+public:
+  enum Mode
+  {
+    NORMAL,      // as many frames as the display shows, up to 60 per second
+    POWER_SAVE   // half of that, for menus and screens that barely move
+  };
+
+  /** Forget the last frame, call when a loop starts so that the time spent
+      loading doesn't count as a missed deadline */
+  static void reset();
+
+  /** Sleep until the next frame is due */
+  static void wait(Mode mode = NORMAL);
+
+  /** Called by flipscreen() around presenting a frame */
+  static void begin_flip();
+  static void end_flip();
+
+  /** Tell whether presenting seems to wait for the vertical blank */
+  static bool has_vsync();
+
+  /** Number of missed frame deadlines so far */
+  static int get_missed();
+};
+
+#endif /*SUPERTUX_FRAME_SCHEDULER_H*/
+
+// EOF
@@ -47,15 +47,29 @@
 #include "special.h"
 #include "player.h"
 #include "level.h"
+#include "background_strips.h"
+#include "profiler.h"
+#include "benchmark.h"
 #include "scene.h"
 #include "collision.h"
 #include "tile.h"
 #include "particlesystem.h"
 #include "resources.h"
 #include "music_manager.h"
+#include "savegame.h"
+#include "dir_index.h"
+#include "frame_scheduler.h"
+#include "input_sampler.h"
+#include "replay.h"
+#include "memory_budget.h"
+#include "hot_reload.h"
 
 GameSession* GameSession::current_ = nullptr;
 
+/* Most logic steps run before a frame is drawn, a machine that is slower
+   than that plays the game slowed down instead of skipping ever more */
+static const int MAX_LOGIC_STEPS = 5;
+
 /**
  * Constructor for GameSession.
  * Initializes the game session, sets the world, level, mode, and starts frame timers.
@@ -64,7 +78,7 @@ GameSession* GameSession::current_ = nullptr;
  * @param mode The game mode (e.g., demo, play).
  */
 GameSession::GameSession(const std::string& subset_, int levelnb_, int mode)
-  : world(nullptr), st_gl_mode(mode), levelnb(levelnb_), end_sequence(NO_ENDSEQUENCE),
+  : world(nullptr), st_gl_mode(mode), levelnb(levelnb_), draw_alpha(1.0f), end_sequence(NO_ENDSEQUENCE),
     subset(subset_)
 {
   current_ = this;
@@ -74,6 +88,8 @@ GameSession::GameSession(const std::string& subset_, int levelnb_, int mode)
   fps_timer.init(true);
   frame_timer.init(true);
 
+  Replay::begin_session(subset, levelnb, mode);
+  MemoryBudget::begin_level();
   restart_level();
 
 #ifdef TSCONTROL
@@ -102,7 +118,7 @@ void GameSession::restart_level()
     old_x_pos = world->get_tux()->base.x;
     world->get_tux()->init();
     world->deactivate_world();
-    get_level()->reload_bricks_and_coins();
+    get_level()->restore_snapshot();
     world->activate_world();
   }
   else
@@ -143,7 +159,8 @@ void GameSession::restart_level()
 
   if (st_gl_mode != ST_GL_DEMO_GAME)
   {
-    if (st_gl_mode == ST_GL_PLAY || st_gl_mode == ST_GL_LOAD_LEVEL_FILE)
+    if ((st_gl_mode == ST_GL_PLAY || st_gl_mode == ST_GL_LOAD_LEVEL_FILE) &&
+        !Benchmark::is_running() && !Replay::is_playing())
     {
       levelintro();
     }
@@ -176,9 +193,13 @@ void GameSession::levelintro(void)
   {
     get_level()->img_bkgd->draw(0, 0);
   }
+  else if (get_level()->bkgd_strips)
+  {
+    get_level()->bkgd_strips->draw(0);
+  }
   else
   {
-    drawgradient(get_level()->bkgd_top, get_level()->bkgd_bottom);
+    get_level()->draw_gradient();
   }
 
   snprintf(str.data(), str.size(), "%s", world->get_level()->name.c_str());
@@ -192,8 +213,13 @@ void GameSession::levelintro(void)
 
   flipscreen();
 
+  // Warm the level's resources while the intro is shown anyway
+  Uint32 start = SDL_GetTicks();
+  world->preload_resources();
+  Uint32 spent = SDL_GetTicks() - start;
+
   SDL_Event event;
-  wait_for_event(event, 1000, 3000, true);
+  wait_for_event(event, spent < 1000 ? 1000 - spent : 0, spent < 3000 ? 3000 - spent : 0, true);
 }
 
 /**
@@ -202,8 +228,9 @@ void GameSession::levelintro(void)
 void GameSession::start_timers()
 {
   st_pause_ticks_init();
+  timer_wheel.reset(st_get_latched_ticks());
   time_left.start(world->get_level()->time_left * 1000);
-  update_time = st_get_ticks();
+  last_update_time = update_time = st_get_wall_ticks();
 }
 
 /**
@@ -329,6 +356,9 @@ void GameSession::process_events()
       else
       {
         Player& tux = *world->get_tux();
+#ifdef TSCONTROL
+        player_input_type& pointer = *InputSampler::get_pointer_input();
+#endif
 
         switch (event.type)
         {
@@ -337,7 +367,11 @@ void GameSession::process_events()
             break;
 
           case SDL_KEYDOWN:
-            if (!tux.key_event(event.key.keysym.sym, DOWN))
+            if (InputSampler::handles_key(event.key.keysym.sym))
+            {
+              InputSampler::note_event();
+            }
+            else
             {
               switch (event.key.keysym.sym)
               {
@@ -352,7 +386,11 @@ void GameSession::process_events()
             break;
 
           case SDL_KEYUP:
-            if (!tux.key_event(event.key.keysym.sym, UP))
+            if (InputSampler::handles_key(event.key.keysym.sym))
+            {
+              InputSampler::note_event();
+            }
+            else
             {
               switch (event.key.keysym.sym)
               {
@@ -419,6 +457,20 @@ void GameSession::process_events()
                   debug_fps = !debug_fps;
                   break;
 
+                case SDLK_o:
+                  if (debug_mode)
+                  {
+                    Profiler::enable(!Profiler::is_enabled());
+                  }
+                  break;
+
+                case SDLK_m:
+                  if (debug_mode)
+                  {
+                    MemoryBudget::enable_overlay(!MemoryBudget::is_overlay_enabled());
+                  }
+                  break;
+
                 default:
                   break;
               }
@@ -427,21 +479,21 @@ void GameSession::process_events()
 
 #ifdef TSCONTROL
           case SDL_MOUSEBUTTONDOWN:
-            tux.input.fire = DOWN;
+            pointer.fire = DOWN;
             break;
 
           case SDL_MOUSEBUTTONUP:
-            tux.input.fire = UP;
+            pointer.fire = UP;
             break;
 
           case SDL_MOUSEMOTION:
             if (event.motion.y < old_mouse_y - 16)
             {
-              tux.input.up = DOWN;
+              pointer.up = DOWN;
             }
             else if (event.motion.y > old_mouse_y + 2)
             {
-              tux.input.up = UP;
+              pointer.up = UP;
             }
             old_mouse_y = event.motion.y;
 
@@ -449,132 +501,53 @@ void GameSession::process_events()
             if ((event.motion.x < (screen->w / 2) + (screen->w / 10)) &&
                 (event.motion.x > (screen->w / 2) - (screen->w / 10)))
             {
-              tux.input.fire = UP;
-              tux.input.left = UP;
-              tux.input.right = UP;
+              pointer.fire = UP;
+              pointer.left = UP;
+              pointer.right = UP;
             }
             // Run left
             else if ((event.motion.x > 0) && (event.motion.x < (screen->w / 8)))
             {
-              tux.input.fire = DOWN;
-              tux.input.left = DOWN;
-              tux.input.right = UP;
+              pointer.fire = DOWN;
+              pointer.left = DOWN;
+              pointer.right = UP;
             }
             // Walk left
             else if ((event.motion.x > (screen->w / 8)) && (event.motion.x < (screen->w / 2)))
             {
-              tux.input.fire = UP;
-              tux.input.right = UP;
-              tux.input.left = DOWN;
+              pointer.fire = UP;
+              pointer.right = UP;
+              pointer.left = DOWN;
             }
             // Walk right
             else if ((event.motion.x > (screen->w / 2)) && (event.motion.x < (7 * screen->w / 8)))
             {
-              tux.input.fire = UP;
-              tux.input.right = DOWN;
-              tux.input.left = UP;
+              pointer.fire = UP;
+              pointer.right = DOWN;
+              pointer.left = UP;
             }
             // Run right
             else if ((event.motion.x > (7 * screen->w / 8)) && (event.motion.x < screen->w))
             {
-              tux.input.fire = DOWN;
-              tux.input.right = DOWN;
-              tux.input.left = UP;
+              pointer.fire = DOWN;
+              pointer.right = DOWN;
+              pointer.left = UP;
             }
             break;
 #endif
-          case SDL_JOYHATMOTION:
-            if (event.jhat.value == SDL_HAT_RIGHT || event.jhat.value == SDL_HAT_RIGHTUP)
-            {
-              tux.input.left = UP;
-              tux.input.right = DOWN;
-            }
-            if (event.jhat.value == SDL_HAT_LEFT || event.jhat.value == SDL_HAT_LEFTUP)
-            {
-              tux.input.left = DOWN;
-              tux.input.right = UP;
-            }
-            if (event.jhat.value == SDL_HAT_CENTERED)
-            {
-              tux.input.left = DOWN;
-              tux.input.right = DOWN;
-            }
-
-            if (event.jhat.value == SDL_HAT_DOWN ||
-                event.jhat.value == SDL_HAT_LEFTDOWN ||
-                event.jhat.value == SDL_HAT_RIGHTDOWN)
-            {
-              tux.input.down = DOWN;
-            }
-
-            if (event.jhat.value != SDL_HAT_DOWN &&
-                event.jhat.value != SDL_HAT_LEFTDOWN &&
-                event.jhat.value != SDL_HAT_RIGHTDOWN)
-            {
-              tux.input.down = UP;
-            }
-            break;
-
-          case SDL_JOYAXISMOTION:
-            if (event.jaxis.axis == joystick_keymap.x_axis)
-            {
-              if (event.jaxis.value < -joystick_keymap.dead_zone)
-              {
-                tux.input.left = DOWN;
-                tux.input.right = UP;
-              }
-              else if (event.jaxis.value > joystick_keymap.dead_zone)
-              {
-                tux.input.left = UP;
-                tux.input.right = DOWN;
-              }
-              else
-              {
-                tux.input.left = DOWN;
-                tux.input.right = DOWN;
-              }
-            }
-            else if (event.jaxis.axis == joystick_keymap.y_axis)
-            {
-              if (event.jaxis.value > joystick_keymap.dead_zone)
-              {
-                tux.input.down = DOWN;
-              }
-              else if (event.jaxis.value < -joystick_keymap.dead_zone)
-              {
-                tux.input.down = UP;
-              }
-              else
-              {
-                tux.input.down = UP;
-              }
-            }
-            break;
-
           case SDL_JOYBUTTONDOWN:
-            if (event.jbutton.button == 3)
-            {
-              tux.input.up = DOWN;
-            }
-            else if (event.jbutton.button == 2)
-            {
-              tux.input.fire = DOWN;
-            }
-            else if (event.jbutton.button == 6)
+            if (event.jbutton.button == 6)
             {
               on_escape_press();
             }
+            InputSampler::note_event();
             break;
 
+          case SDL_JOYHATMOTION:
+          case SDL_JOYAXISMOTION:
           case SDL_JOYBUTTONUP:
-            if (event.jbutton.button == 3)
-            {
-              tux.input.up = UP;
-            }
-            else if (event.jbutton.button == 2)
-            {
-              tux.input.fire = UP;
-            }
+            // Read by InputSampler::sample() at the next logic step
+            InputSampler::note_event();
             break;
 
           default:
@@ -585,6 +558,15 @@ void GameSession::process_events()
   }
 }
 
+/**
+ * Finishes the level once the end sequence has played.
+ * @param session The GameSession the end sequence belongs to.
+ */
+void GameSession::on_end_sequence_over(void* session)
+{
+  static_cast<GameSession*>(session)->exit_status = ES_LEVEL_FINISHED;
+}
+
 /**
  * Checks whether end-of-level or game-over conditions are met
  * and triggers necessary actions, such as playing the end sequence
@@ -604,14 +586,9 @@ void GameSession::check_end_conditions()
     end_sequence = ENDSEQUENCE_WAITING;
     last_x_pos = -1;
     music_manager->play_music(level_end_song, 0);
-    endsequence_timer.start(7000);
+    timer_wheel.schedule(7000, on_end_sequence_over, this);
     tux->invincible_timer.start(7000); // FIXME: Implement a winning timer for the end sequence
   }
-  else if (end_sequence && !endsequence_timer.check())
-  {
-    exit_status = ES_LEVEL_FINISHED;
-    return;
-  }
   else if (end_sequence == ENDSEQUENCE_RUNNING && endtile && endtile->data >= 1)
   {
     end_sequence = ENDSEQUENCE_WAITING;
@@ -621,7 +598,7 @@ void GameSession::check_end_conditions()
     end_sequence = ENDSEQUENCE_RUNNING;
     last_x_pos = -1;
     music_manager->play_music(level_end_song, 0);
-    endsequence_timer.start(7000);
+    timer_wheel.schedule(7000, on_end_sequence_over, this);
     tux->invincible_timer.start(7000); // FIXME: Implement a winning timer for the end sequence
   }
   else if (!end_sequence && tux->is_dead())
@@ -649,6 +626,7 @@ void GameSession::action(double frame_ratio)
 {
   if (exit_status == ES_NONE)
   {
+    PROFILE_SCOPE("World::action");
     world->action(frame_ratio);
   }
 }
@@ -658,7 +636,12 @@ void GameSession::action(double frame_ratio)
  */
 void GameSession::draw()
 {
-  world->draw();
+  {
+    PROFILE_SCOPE("World::draw");
+    world->interpolate(draw_alpha);
+    world->draw();
+    world->end_interpolation();
+  }
   drawstatus();
 
   if (game_pause)
@@ -703,6 +686,10 @@ void GameSession::draw()
   fillrect(7 * screen->w / 8, y, screen->w / 8, h, 20, 20, 20, 60);
 #endif
 
+  Profiler::draw();
+  MemoryBudget::draw();
+
+  PROFILE_SCOPE("flipscreen");
   flipscreen();
 }
 
@@ -750,18 +737,35 @@ GameSession::ExitStatus GameSession::run()
   current_ = this;
 
   int fps_cnt = 0;
-  update_time = last_update_time = st_get_ticks();
+  update_time = last_update_time = st_get_wall_ticks();
 
   // Eat unneeded events
   SDL_Event event;
   while (SDL_PollEvent(&event)) {}
 
+  /* The world is simulated in steps of FRAME_RATE ms and drawn in between,
+     interpolated by the time that is left over */
+  unsigned int accumulator = 0;
+  draw_alpha = 1.0f;
   draw();
+  FrameScheduler::reset();
 
   while (exit_status == ES_NONE)
   {
-    /* Calculate the movement-factor */
-    double frame_ratio = static_cast<double>(update_time - last_update_time) / FRAME_RATE;
+    Profiler::next_frame();
+    st_ticks_latch();
+
+    update_time = st_get_wall_ticks();
+    accumulator += update_time - last_update_time;
+    last_update_time = update_time;
+
+    /* Benchmarks and replays run exactly one step per frame, as fast as
+       they can */
+    bool fast_forward = Replay::is_fast_forward();
+    if (Benchmark::is_running() || fast_forward)
+    {
+      accumulator = FRAME_RATE;
+    }
 
     if (!frame_timer.check())
     {
@@ -770,48 +774,95 @@ GameSession::ExitStatus GameSession::run()
     }
 
     /* Handle events: */
-    world->get_tux()->input.old_fire = world->get_tux()->input.fire;
-
-    process_events();
+    {
+      PROFILE_SCOPE("process_events");
+      process_events();
+    }
     process_menu();
+    HotReload::update(world);
 
+    int steps = 0;
     if (!game_pause && !Menu::current())
     {
-      check_end_conditions();
-      if (end_sequence == ENDSEQUENCE_RUNNING)
+      while (accumulator >= FRAME_RATE && steps < MAX_LOGIC_STEPS && exit_status == ES_NONE)
       {
-        action(frame_ratio / 2);
+        /* All timers of a step see the same time */
+        st_ticks_latch();
+        timer_wheel.advance(st_latched_ticks);
+        world->begin_step();
+
+        if (Benchmark::is_running())
+        {
+          Benchmark::feed_input(*world->get_tux());
+        }
+        else if (end_sequence == NO_ENDSEQUENCE)
+        {
+          InputSampler::sample(&world->get_tux()->input);
+          Replay::feed_input(*world);
+        }
+
+        check_end_conditions();
+        if (end_sequence == ENDSEQUENCE_RUNNING)
+        {
+          action(0.5);
+        }
+        else if (end_sequence == NO_ENDSEQUENCE)
+        {
+          action(1.0);
+        }
+
+        world->get_tux()->input.old_fire = world->get_tux()->input.fire;
+        if (Replay::end_step(*world) && exit_status == ES_NONE)
+        {
+          exit_status = ES_LEVEL_ABORT;
+        }
+        accumulator -= FRAME_RATE;
+        ++steps;
       }
-      else if (end_sequence == NO_ENDSEQUENCE)
+
+      /* Too slow to keep up, drop the backlog instead of spiraling */
+      if (steps == MAX_LOGIC_STEPS)
       {
-        action(frame_ratio);
+        accumulator %= FRAME_RATE;
       }
+      draw_alpha = static_cast<float>(accumulator) / FRAME_RATE;
     }
     else
     {
+      /* Time stops in pause mode */
       ++pause_menu_frame;
+      accumulator = 0;
     }
 
-    draw();
+    if ((!Benchmark::is_running() || Benchmark::renders()) && !fast_forward)
+    {
+      draw();
+      InputSampler::frame_presented();
+    }
 
-    /* Time stops in pause mode */
     if (game_pause || Menu::current())
     {
+      // A fade started before the pause still has to hand over
+      music_manager->update();
+      if (!Benchmark::is_running())
+      {
+        FrameScheduler::wait(FrameScheduler::POWER_SAVE);
+      }
       continue;
     }
 
-    /* Set the time of the last update and the time of the current update */
-    last_update_time = update_time;
-    update_time = st_get_ticks();
-
-#ifndef _WII_  // Wii runs too slow to need this
-    /* Pause till next frame */
-    if(last_update_time >= update_time - 12)
+    if (Benchmark::is_running())
+    {
+      if (Benchmark::end_frame() && exit_status == ES_NONE)
+      {
+        exit_status = ES_LEVEL_ABORT;
+      }
+    }
+    else if (!fast_forward)
     {
-      SDL_Delay(5);  // FIXME: Throttle hack as without it many things subtly break at higher framerates (default: 10; lowered to 5 for testing)
-      update_time = st_get_ticks();
+      /* Give the time until the next frame back instead of spinning */
+      FrameScheduler::wait();
     }
-#endif
 
     /* Handle time: */
     if (!time_left.check() && world->get_tux()->dying == DYING_NOT && !end_sequence)
@@ -833,6 +884,13 @@ GameSession::ExitStatus GameSession::run()
       world->play_music(LEVEL_MUSIC);
     }
 
+    if (time_left.get_left() < TIME_WARNING + MUSIC_PREFETCH_TIME && !end_sequence)
+    {
+      get_level()->prefetch_song_fast();
+    }
+    music_manager->update();
+    flush_sounds();
+
     /* Calculate frames per second */
     if (show_fps)
     {
@@ -847,6 +905,9 @@ GameSession::ExitStatus GameSession::run()
     }
   }
 
+  st_ticks_unlatch();
+  MemoryBudget::end_level(world->get_level()->name);
+  Replay::end_session(exit_status);
   return exit_status;
 }
 
@@ -860,7 +921,7 @@ void bumpbrick(float x, float y)
   World::current()->add_bouncy_brick(static_cast<int>((x + 1) / 32) * 32,
                                      static_cast<int>(y / 32) * 32);
 
-  play_sound(sounds[SND_BRICK], SOUND_CENTER_SPEAKER);
+  play_sound(SND_BRICK, x);
 }
 
 /**
@@ -928,9 +989,13 @@ void GameSession::drawresultscreen()
   {
     get_level()->img_bkgd->draw(0, 0);
   }
+  else if (get_level()->bkgd_strips)
+  {
+    get_level()->bkgd_strips->draw(0);
+  }
   else
   {
-    drawgradient(get_level()->bkgd_top, get_level()->bkgd_bottom);
+    get_level()->draw_gradient();
   }
 
   blue_text->drawf("Result:", 0, 200, A_HMIDDLE, A_TOP, 1);
@@ -959,12 +1024,24 @@ std::string slotinfo(int slot)
   std::string title;
   snprintf(slotfile, sizeof(slotfile), "%s/slot%d.stsg", st_save_dir, slot);
 
-  lisp_object_t* savegame = lisp_read_from_file(slotfile);
-  if (savegame)
+  SaveGameData data;
+  if (!DirIndex::has_file(slotfile))
   {
-    LispReader reader(lisp_cdr(savegame));
-    reader.read_string("title", &title);
-    lisp_free(savegame);
+    // Empty slot, nothing to read
+  }
+  else if (SaveGame::read(slotfile, &data))
+  {
+    title = data.title;
+  }
+  else
+  {
+    lisp_object_t* savegame = lisp_read_from_file(slotfile);
+    if (savegame)
+    {
+      LispReader reader(lisp_cdr(savegame));
+      reader.read_string("title", &title);
+      lisp_free(savegame);
+    }
   }
 
   if (!title.empty())
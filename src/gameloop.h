@@ -47,13 +47,14 @@ class GameSession
  private:
   Timer fps_timer;
   Timer frame_timer;
-  Timer endsequence_timer;
+  TimerWheel timer_wheel;  /**< Advanced with every logic step */
   World* world;
   int st_gl_mode;
   int levelnb;
   float fps_fps;
   unsigned int last_update_time;
   unsigned int update_time;
+  float draw_alpha;  // how far drawing is between the last two logic steps
   int pause_menu_frame;
   int debug_fps;
 #ifdef TSCONTROL
@@ -102,6 +103,7 @@ class GameSession
   void restart_level();
 
   void check_end_conditions();
+  static void on_end_sequence_over(void* session);
   void start_timers();
   void process_events();
 
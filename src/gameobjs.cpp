@@ -25,6 +25,8 @@
 #include "tile.h"
 #include "gameloop.h"
 #include "gameobjs.h"
+#include "background_strips.h"
+#include "globals.h"
 
 /**
  * Initializes a BouncyDistro object.
@@ -39,7 +41,7 @@ void BouncyDistro::init(float x, float y)
 }
 
 /**
- * Updates the position of the BouncyDistro and removes it when it reaches the ground.
+ * Updates the position of the BouncyDistro and marks it removable when it reaches the ground.
  * @param frame_ratio The ratio of the current frame.
  */
 void BouncyDistro::action(double frame_ratio)
@@ -49,12 +51,7 @@ void BouncyDistro::action(double frame_ratio)
 
   if (base.ym >= 0)
   {
-    std::vector<BouncyDistro*>::iterator i = std::find(
-        World::current()->bouncy_distros.begin(),
-        World::current()->bouncy_distros.end(),
-        this);
-    if (i != World::current()->bouncy_distros.end())
-      World::current()->bouncy_distros.erase(i);
+    removable = true;
   }
 }
 
@@ -82,15 +79,15 @@ void BrokenBrick::init(Tile* tile_, float x, float y, float xm, float ym)
   base.xm = xm;
   base.ym = ym;
 
-  random_offset_x = rand() % 16;  // Cache random value for x offset
-  random_offset_y = rand() % 16;  // Cache random value for y offset
+  random_offset_x = st_rand() % 16;  // Cache random value for x offset
+  random_offset_y = st_rand() % 16;  // Cache random value for y offset
 
   timer.init(true);
   timer.start(200);
 }
 
 /**
- * Updates the position of the BrokenBrick and removes it when the timer expires.
+ * Updates the position of the BrokenBrick and marks it removable when the timer expires.
  * @param frame_ratio The ratio of the current frame.
  */
 void BrokenBrick::action(double frame_ratio)
@@ -100,13 +97,7 @@ void BrokenBrick::action(double frame_ratio)
 
   if (!timer.check())
   {
-    auto& broken_bricks = World::current()->broken_bricks;
-    auto i = std::find(broken_bricks.begin(), broken_bricks.end(), this);
-    if (i != broken_bricks.end())
-    {
-      std::iter_swap(i, broken_bricks.end() - 1);  // Swap with the last element
-      broken_bricks.pop_back();  // Remove the last element
-    }
+    removable = true;
   }
 }
 
@@ -145,7 +136,7 @@ void BouncyBrick::init(float x, float y)
 }
 
 /**
- * Updates the bouncing behavior of the BouncyBrick and removes it when it stops bouncing.
+ * Updates the bouncing behavior of the BouncyBrick and marks it removable when it stops bouncing.
  * @param frame_ratio The ratio of the current frame.
  */
 void BouncyBrick::action(double frame_ratio)
@@ -159,13 +150,7 @@ void BouncyBrick::action(double frame_ratio)
   /* Stop bouncing? */
   if (offset >= 0)
   {
-    auto& bouncy_bricks = World::current()->bouncy_bricks;
-    auto i = std::find(bouncy_bricks.begin(), bouncy_bricks.end(), this);
-    if (i != bouncy_bricks.end())
-    {
-      std::iter_swap(i, bouncy_bricks.end() - 1);  // Swap with the last element
-      bouncy_bricks.pop_back();  // Remove the last element
-    }
+    removable = true;
   }
 }
 
@@ -192,11 +177,16 @@ void BouncyBrick::draw()
                plevel->bkgd_top.red, plevel->bkgd_top.green, plevel->bkgd_top.blue, 0);
       // FIXME: doesn't respect the gradient, furthermore is this necessary at all??
     }
-    else
+    else if (plevel->img_bkgd)
     {
       int s = static_cast<int>(scroll_x / 2) % 640;
       plevel->img_bkgd->draw_part(dest.x + s, dest.y, dest.x, dest.y, dest.w, dest.h);
     }
+    else if (plevel->bkgd_strips)
+    {
+      float s = scroll_x * (plevel->bkgd_speed / 100.0f);
+      plevel->bkgd_strips->draw_part(dest.x + s, dest.y, dest.x, dest.y, dest.w, dest.h);
+    }
 
     Tile::draw(base.x - scroll_x, base.y + offset, shape);
   }
@@ -219,7 +209,7 @@ void FloatingScore::init(float x, float y, int s)
 
 /**
  * Updates the position of FloatingScore, making it float upward.
- * Removes the object from the world when its timer expires.
+ * Marks the object removable when its timer expires.
  * @param frame_ratio Ratio of the current frame.
  */
 void FloatingScore::action(double frame_ratio)
@@ -228,13 +218,7 @@ void FloatingScore::action(double frame_ratio)
 
   if (!timer.check())
   {
-    auto& floating_scores = World::current()->floating_scores;
-    auto i = std::find(floating_scores.begin(), floating_scores.end(), this);
-    if (i != floating_scores.end())
-    {
-      std::iter_swap(i, floating_scores.end() - 1);  // Swap with the last element
-      floating_scores.pop_back();  // Remove the last element
-    }
+    removable = true;
   }
 }
 
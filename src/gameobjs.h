@@ -39,6 +39,9 @@ class BouncyDistro : public GameObject
   void action(double frame_ratio);
   void draw();
   std::string type() { return "BouncyDistro"; };
+
+  /** Set by action() when the object is done, World then releases it */
+  bool removable = false;
 };
 
 extern Surface* img_distro[4];
@@ -62,6 +65,8 @@ class BrokenBrick : public GameObject
   void action(double frame_ratio);
   void draw();
   std::string type() { return "BrokenBrick"; };
+
+  bool removable = false;
 };
 
 class BouncyBrick : public GameObject
@@ -75,6 +80,8 @@ class BouncyBrick : public GameObject
   void action(double frame_ratio);
   void draw();
   std::string type() { return "BouncyBrick"; };
+
+  bool removable = false;
 };
 
 class FloatingScore : public GameObject
@@ -87,6 +94,8 @@ class FloatingScore : public GameObject
   void action(double frame_ratio);
   void draw();
   std::string type() { return "FloatingScore"; };
+
+  bool removable = false;
 };
 
 #endif
@@ -0,0 +1,711 @@
+//  gl_shader.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include "gl_shader.h"
+#include "globals.h"
+
+#ifndef NOOPENGL
+
+namespace
+{
+
+// The entry points beyond OpenGL 1.1 are fetched at runtime, with our own
+// types so that old GL headers (like the one shipped by SDL 1.2) don't
+// need to know about them
+typedef void* SyncHandle;
+
+typedef GLuint (APIENTRY* CreateShaderFunc)(GLenum type);
+typedef void (APIENTRY* ShaderSourceFunc)(GLuint shader, GLsizei count, const char* const* string, const GLint* length);
+typedef void (APIENTRY* CompileShaderFunc)(GLuint shader);
+typedef void (APIENTRY* GetShaderivFunc)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY* GetInfoLogFunc)(GLuint object, GLsizei size, GLsizei* length, char* log);
+typedef void (APIENTRY* DeleteObjectFunc)(GLuint object);
+typedef GLuint (APIENTRY* CreateProgramFunc)();
+typedef void (APIENTRY* AttachShaderFunc)(GLuint program, GLuint shader);
+typedef void (APIENTRY* BindAttribLocationFunc)(GLuint program, GLuint index, const char* name);
+typedef void (APIENTRY* LinkProgramFunc)(GLuint program);
+typedef void (APIENTRY* UseProgramFunc)(GLuint program);
+typedef GLint (APIENTRY* GetUniformLocationFunc)(GLuint program, const char* name);
+typedef void (APIENTRY* Uniform1iFunc)(GLint location, GLint v0);
+typedef void (APIENTRY* Uniform2fFunc)(GLint location, GLfloat v0, GLfloat v1);
+typedef void (APIENTRY* GenObjectsFunc)(GLsizei n, GLuint* objects);
+typedef void (APIENTRY* DeleteObjectsFunc)(GLsizei n, const GLuint* objects);
+typedef void (APIENTRY* BindObjectFunc)(GLenum target, GLuint object);
+typedef void (APIENTRY* BindVertexArrayFunc)(GLuint array);
+typedef void (APIENTRY* BufferDataFunc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (APIENTRY* BufferSubDataFunc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+typedef void (APIENTRY* BufferStorageFunc)(GLenum target, ptrdiff_t size, const void* data, GLbitfield flags);
+typedef void* (APIENTRY* MapBufferRangeFunc)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+typedef void (APIENTRY* VertexAttribArrayFunc)(GLuint index);
+typedef void (APIENTRY* VertexAttribPointerFunc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef SyncHandle (APIENTRY* FenceSyncFunc)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY* ClientWaitSyncFunc)(SyncHandle sync, GLbitfield flags, Uint64 timeout);
+typedef void (APIENTRY* DeleteSyncFunc)(SyncHandle sync);
+
+struct Functions
+{
+  CreateShaderFunc CreateShader;
+  ShaderSourceFunc ShaderSource;
+  CompileShaderFunc CompileShader;
+  GetShaderivFunc GetShaderiv;
+  GetInfoLogFunc GetShaderInfoLog;
+  DeleteObjectFunc DeleteShader;
+  CreateProgramFunc CreateProgram;
+  AttachShaderFunc AttachShader;
+  BindAttribLocationFunc BindAttribLocation;
+  LinkProgramFunc LinkProgram;
+  GetShaderivFunc GetProgramiv;
+  GetInfoLogFunc GetProgramInfoLog;
+  DeleteObjectFunc DeleteProgram;
+  UseProgramFunc UseProgram;
+  GetUniformLocationFunc GetUniformLocation;
+  Uniform1iFunc Uniform1i;
+  Uniform2fFunc Uniform2f;
+  GenObjectsFunc GenBuffers;
+  DeleteObjectsFunc DeleteBuffers;
+  BindObjectFunc BindBuffer;
+  BufferDataFunc BufferData;
+  BufferSubDataFunc BufferSubData;
+  VertexAttribArrayFunc EnableVertexAttribArray;
+  VertexAttribArrayFunc DisableVertexAttribArray;
+  VertexAttribPointerFunc VertexAttribPointer;
+
+  // Optional, null if the driver doesn't have them
+  GenObjectsFunc GenVertexArrays;
+  DeleteObjectsFunc DeleteVertexArrays;
+  BindVertexArrayFunc BindVertexArray;
+  BufferStorageFunc BufferStorage;
+  MapBufferRangeFunc MapBufferRange;
+  FenceSyncFunc FenceSync;
+  ClientWaitSyncFunc ClientWaitSync;
+  DeleteSyncFunc DeleteSync;
+};
+
+// Enums of newer GL versions, under our own names for the same reason
+const GLenum VERTEX_SHADER = 0x8B31;
+const GLenum FRAGMENT_SHADER = 0x8B30;
+const GLenum COMPILE_STATUS = 0x8B81;
+const GLenum LINK_STATUS = 0x8B82;
+const GLenum ARRAY_BUFFER = 0x8892;
+const GLenum ELEMENT_ARRAY_BUFFER = 0x8893;
+const GLenum STREAM_DRAW = 0x88E0;
+const GLenum STATIC_DRAW = 0x88E4;
+const GLenum CONTEXT_PROFILE_MASK = 0x9126;
+const GLint CONTEXT_CORE_PROFILE_BIT = 0x0001;
+const GLbitfield MAP_WRITE_BIT = 0x0002;
+const GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+const GLbitfield MAP_COHERENT_BIT = 0x0080;
+const GLenum SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+const GLbitfield SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+const GLenum WAIT_FAILED = 0x911D;
+
+// Attribute locations, bound before linking
+const GLuint ATTRIB_POSITION = 0;
+const GLuint ATTRIB_TEXCOORD = 1;
+const GLuint ATTRIB_COLOR = 2;
+
+// Number of regions of the persistently mapped buffer, the CPU fills one
+// while the GPU may still be reading the others
+const int REGIONS = 3;
+const int REGION_VERTICES = ShaderRenderer::MAX_QUADS * 4;
+
+const char* vertex_source =
+  "uniform vec2 screen_size;\n"
+  "attribute vec2 position;\n"
+  "attribute vec2 texcoord;\n"
+  "attribute vec4 color;\n"
+  "varying vec2 v_texcoord;\n"
+  "varying vec4 v_color;\n"
+  "void main()\n"
+  "{\n"
+  "  v_texcoord = texcoord;\n"
+  "  v_color = color;\n"
+  "  gl_Position = vec4(position.x * 2.0 / screen_size.x - 1.0,\n"
+  "                     1.0 - position.y * 2.0 / screen_size.y, 0.0, 1.0);\n"
+  "}\n";
+
+const char* fragment_source =
+  "#ifdef GL_ES\n"
+  "precision mediump float;\n"
+  "#endif\n"
+  "uniform sampler2D image;\n"
+  "varying vec2 v_texcoord;\n"
+  "varying vec4 v_color;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = texture2D(image, v_texcoord) * v_color;\n"
+  "}\n";
+
+Functions gl;
+bool active = false;
+
+GLuint program = 0;
+GLuint vertex_array = 0;
+GLuint vertex_buffer = 0;
+GLuint index_buffer = 0;
+GLuint white_texture = 0;
+GLint screen_location = -1;
+float screen_w = 0;
+float screen_h = 0;
+
+// Persistent mapping, null when the buffer is orphaned instead
+ShaderRenderer::Vertex* persistent = nullptr;
+SyncHandle fences[REGIONS];
+int region = 0;
+int region_used = 0;  // vertices
+
+// Current upload
+std::vector<ShaderRenderer::Vertex> staging;
+int upload_base = 0;  // first vertex in the buffer
+int upload_vertices = 0;
+
+/**
+ * Looks up an OpenGL entry point.
+ * @param name The name of the function.
+ * @param function Receives the function, null if it isn't there.
+ * @return True if the function was found.
+ */
+template<typename T>
+bool get_function(const char* name, T* function)
+{
+  *function = reinterpret_cast<T>(SDL_GL_GetProcAddress(name));
+  return *function != nullptr;
+}
+
+/**
+ * Fetches the entry points the backend depends on.
+ * @return False if one of the required ones is missing.
+ */
+bool load_functions()
+{
+  bool ok = get_function("glCreateShader", &gl.CreateShader) &&
+            get_function("glShaderSource", &gl.ShaderSource) &&
+            get_function("glCompileShader", &gl.CompileShader) &&
+            get_function("glGetShaderiv", &gl.GetShaderiv) &&
+            get_function("glGetShaderInfoLog", &gl.GetShaderInfoLog) &&
+            get_function("glDeleteShader", &gl.DeleteShader) &&
+            get_function("glCreateProgram", &gl.CreateProgram) &&
+            get_function("glAttachShader", &gl.AttachShader) &&
+            get_function("glBindAttribLocation", &gl.BindAttribLocation) &&
+            get_function("glLinkProgram", &gl.LinkProgram) &&
+            get_function("glGetProgramiv", &gl.GetProgramiv) &&
+            get_function("glGetProgramInfoLog", &gl.GetProgramInfoLog) &&
+            get_function("glDeleteProgram", &gl.DeleteProgram) &&
+            get_function("glUseProgram", &gl.UseProgram) &&
+            get_function("glGetUniformLocation", &gl.GetUniformLocation) &&
+            get_function("glUniform1i", &gl.Uniform1i) &&
+            get_function("glUniform2f", &gl.Uniform2f) &&
+            get_function("glGenBuffers", &gl.GenBuffers) &&
+            get_function("glDeleteBuffers", &gl.DeleteBuffers) &&
+            get_function("glBindBuffer", &gl.BindBuffer) &&
+            get_function("glBufferData", &gl.BufferData) &&
+            get_function("glBufferSubData", &gl.BufferSubData) &&
+            get_function("glEnableVertexAttribArray", &gl.EnableVertexAttribArray) &&
+            get_function("glDisableVertexAttribArray", &gl.DisableVertexAttribArray) &&
+            get_function("glVertexAttribPointer", &gl.VertexAttribPointer);
+
+  get_function("glGenVertexArrays", &gl.GenVertexArrays);
+  get_function("glDeleteVertexArrays", &gl.DeleteVertexArrays);
+  get_function("glBindVertexArray", &gl.BindVertexArray);
+  get_function("glBufferStorage", &gl.BufferStorage);
+  get_function("glMapBufferRange", &gl.MapBufferRange);
+  get_function("glFenceSync", &gl.FenceSync);
+  get_function("glClientWaitSync", &gl.ClientWaitSync);
+  get_function("glDeleteSync", &gl.DeleteSync);
+
+  return ok;
+}
+
+/**
+ * Tells whether the extension string of the driver names an extension.
+ * @param name The extension to look for.
+ * @return True if the extension is supported.
+ */
+bool has_extension(const char* name)
+{
+  const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!extensions)
+  {
+    return false;
+  }
+
+  std::size_t length = strlen(name);
+  for (const char* p = strstr(extensions, name); p; p = strstr(p + length, name))
+  {
+    if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Compiles one stage of the sprite shader, the header picks the GLSL
+ * dialect of the context.
+ * @param type The shader stage.
+ * @param header Lines to put in front of the source.
+ * @param source The GLSL source.
+ * @return The shader, 0 if it didn't compile.
+ */
+GLuint compile(GLenum type, const std::string& header, const char* source)
+{
+  const char* sources[2] = { header.c_str(), source };
+  GLuint shader = gl.CreateShader(type);
+  gl.ShaderSource(shader, 2, sources, nullptr);
+  gl.CompileShader(shader);
+
+  GLint status = 0;
+  gl.GetShaderiv(shader, COMPILE_STATUS, &status);
+  if (!status)
+  {
+    char log[512];
+    gl.GetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    fprintf(stderr, "Warning: Couldn't compile shader: %s\n", log);
+    gl.DeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+/**
+ * Builds the sprite shader program.
+ * @param es Whether the context is OpenGL ES.
+ * @param core Whether the context is a core profile without the old GLSL keywords.
+ * @return True if the program is ready.
+ */
+bool build_program(bool es, bool core)
+{
+  std::string vertex_header;
+  std::string fragment_header;
+  if (es)
+  {
+    vertex_header = fragment_header = "#version 100\n";
+  }
+  else if (core)
+  {
+    vertex_header = "#version 150\n"
+                    "#define attribute in\n"
+                    "#define varying out\n";
+    fragment_header = "#version 150\n"
+                      "#define varying in\n"
+                      "#define texture2D texture\n"
+                      "#define gl_FragColor frag_color\n"
+                      "out vec4 frag_color;\n";
+  }
+
+  GLuint vertex_shader = compile(VERTEX_SHADER, vertex_header, vertex_source);
+  GLuint fragment_shader = compile(FRAGMENT_SHADER, fragment_header, fragment_source);
+  if (!vertex_shader || !fragment_shader)
+  {
+    if (vertex_shader)
+    {
+      gl.DeleteShader(vertex_shader);
+    }
+    if (fragment_shader)
+    {
+      gl.DeleteShader(fragment_shader);
+    }
+    return false;
+  }
+
+  program = gl.CreateProgram();
+  gl.AttachShader(program, vertex_shader);
+  gl.AttachShader(program, fragment_shader);
+  gl.BindAttribLocation(program, ATTRIB_POSITION, "position");
+  gl.BindAttribLocation(program, ATTRIB_TEXCOORD, "texcoord");
+  gl.BindAttribLocation(program, ATTRIB_COLOR, "color");
+  gl.LinkProgram(program);
+
+  // The program keeps the shaders alive as long as it needs them
+  gl.DeleteShader(vertex_shader);
+  gl.DeleteShader(fragment_shader);
+
+  GLint status = 0;
+  gl.GetProgramiv(program, LINK_STATUS, &status);
+  if (!status)
+  {
+    char log[512];
+    gl.GetProgramInfoLog(program, sizeof(log), nullptr, log);
+    fprintf(stderr, "Warning: Couldn't link shader: %s\n", log);
+    gl.DeleteProgram(program);
+    program = 0;
+    return false;
+  }
+
+  screen_location = gl.GetUniformLocation(program, "screen_size");
+  gl.UseProgram(program);
+  gl.Uniform1i(gl.GetUniformLocation(program, "image"), 0);
+  gl.UseProgram(0);
+  return true;
+}
+
+/**
+ * Creates the vertex buffer, persistently mapped if the driver can.
+ * @param persistent_ok Whether glBufferStorage() may be used.
+ */
+void create_vertex_buffer(bool persistent_ok)
+{
+  gl.GenBuffers(1, &vertex_buffer);
+  gl.BindBuffer(ARRAY_BUFFER, vertex_buffer);
+
+  persistent = nullptr;
+  if (persistent_ok && gl.BufferStorage && gl.MapBufferRange &&
+      gl.FenceSync && gl.ClientWaitSync && gl.DeleteSync)
+  {
+    ptrdiff_t size = REGIONS * REGION_VERTICES * sizeof(ShaderRenderer::Vertex);
+    GLbitfield flags = MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+    gl.BufferStorage(ARRAY_BUFFER, size, nullptr, flags);
+    persistent = static_cast<ShaderRenderer::Vertex*>(gl.MapBufferRange(ARRAY_BUFFER, 0, size, flags));
+    if (!persistent)
+    {
+      // Storage is immutable, start over with a buffer that can be orphaned
+      gl.BindBuffer(ARRAY_BUFFER, 0);
+      gl.DeleteBuffers(1, &vertex_buffer);
+      gl.GenBuffers(1, &vertex_buffer);
+      gl.BindBuffer(ARRAY_BUFFER, vertex_buffer);
+    }
+  }
+
+  for (int i = 0; i < REGIONS; ++i)
+  {
+    fences[i] = nullptr;
+  }
+  region = 0;
+  region_used = 0;
+
+  gl.BindBuffer(ARRAY_BUFFER, 0);
+}
+
+/**
+ * Creates the index buffer turning each quad into two triangles.
+ */
+void create_index_buffer()
+{
+  std::vector<GLushort> indices(ShaderRenderer::MAX_QUADS * 6);
+  for (int q = 0; q < ShaderRenderer::MAX_QUADS; ++q)
+  {
+    GLushort* i = &indices[q * 6];
+    GLushort base = static_cast<GLushort>(q * 4);
+    i[0] = base;
+    i[1] = base + 1;
+    i[2] = base + 2;
+    i[3] = base + 2;
+    i[4] = base + 3;
+    i[5] = base;
+  }
+
+  gl.GenBuffers(1, &index_buffer);
+  gl.BindBuffer(ELEMENT_ARRAY_BUFFER, index_buffer);
+  gl.BufferData(ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], STATIC_DRAW);
+  gl.BindBuffer(ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/**
+ * Creates the 1x1 white texture used for plain colored quads.
+ */
+void create_white_texture()
+{
+  const GLubyte white[4] = { 255, 255, 255, 255 };
+  glGenTextures(1, &white_texture);
+  glBindTexture(GL_TEXTURE_2D, white_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/**
+ * Points the vertex attributes at the current upload.
+ */
+void set_attributes()
+{
+  typedef ShaderRenderer::Vertex Vertex;
+  const char* base = reinterpret_cast<const char*>(upload_base * sizeof(Vertex));
+  gl.VertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, x));
+  gl.VertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), base + offsetof(Vertex, u));
+  gl.VertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), base + offsetof(Vertex, color));
+}
+
+} // namespace
+
+/**
+ * Sets up the backend for the current OpenGL context.
+ * @param width, height The size of the screen in pixels.
+ * @return True if the backend can be used.
+ */
+bool ShaderRenderer::init(int width, int height)
+{
+  // A new context doesn't know the objects of the old one anymore
+  active = false;
+  program = vertex_array = vertex_buffer = index_buffer = white_texture = 0;
+  persistent = nullptr;
+
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (!version || !load_functions())
+  {
+    return false;
+  }
+
+  bool es = strstr(version, "OpenGL ES") != nullptr;
+  int major = 0;
+  int minor = 0;
+  sscanf(es ? strstr(version, "OpenGL ES") + 9 : version, " %d.%d", &major, &minor);
+  if (major < 2)
+  {
+    return false;
+  }
+
+  bool core = false;
+  if (!es && (major > 3 || (major == 3 && minor >= 2)))
+  {
+    GLint mask = 0;
+    glGetIntegerv(CONTEXT_PROFILE_MASK, &mask);
+    core = (mask & CONTEXT_CORE_PROFILE_BIT) != 0;
+  }
+
+  if (!build_program(es, core))
+  {
+    return false;
+  }
+
+  bool persistent_ok = !es && (major > 4 || (major == 4 && minor >= 4) ||
+                               (!core && has_extension("GL_ARB_buffer_storage")));
+  create_vertex_buffer(persistent_ok);
+  create_index_buffer();
+  create_white_texture();
+
+  // Core profiles draw nothing without a vertex array object
+  if (gl.GenVertexArrays && gl.BindVertexArray && gl.DeleteVertexArrays && (core || major >= 3))
+  {
+    gl.GenVertexArrays(1, &vertex_array);
+  }
+
+  screen_w = static_cast<float>(width);
+  screen_h = static_cast<float>(height);
+  active = true;
+  return true;
+}
+
+/**
+ * Frees the GL objects of the backend.
+ */
+void ShaderRenderer::shutdown()
+{
+  if (!active)
+  {
+    return;
+  }
+
+  for (int i = 0; i < REGIONS; ++i)
+  {
+    if (fences[i])
+    {
+      gl.DeleteSync(fences[i]);
+      fences[i] = nullptr;
+    }
+  }
+
+  // Deleting the buffer unmaps it as well
+  gl.DeleteBuffers(1, &vertex_buffer);
+  gl.DeleteBuffers(1, &index_buffer);
+  if (vertex_array)
+  {
+    gl.DeleteVertexArrays(1, &vertex_array);
+  }
+  glDeleteTextures(1, &white_texture);
+  gl.DeleteProgram(program);
+
+  program = vertex_array = vertex_buffer = index_buffer = white_texture = 0;
+  persistent = nullptr;
+  active = false;
+}
+
+/**
+ * Binds the shader, the buffers and the vertex attributes.
+ */
+void ShaderRenderer::begin()
+{
+  if (vertex_array)
+  {
+    gl.BindVertexArray(vertex_array);
+  }
+
+  gl.UseProgram(program);
+  gl.Uniform2f(screen_location, screen_w, screen_h);
+  gl.BindBuffer(ARRAY_BUFFER, vertex_buffer);
+  gl.BindBuffer(ELEMENT_ARRAY_BUFFER, index_buffer);
+  gl.EnableVertexAttribArray(ATTRIB_POSITION);
+  gl.EnableVertexAttribArray(ATTRIB_TEXCOORD);
+  gl.EnableVertexAttribArray(ATTRIB_COLOR);
+
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/**
+ * Unbinds everything begin() bound.
+ */
+void ShaderRenderer::end()
+{
+  gl.DisableVertexAttribArray(ATTRIB_COLOR);
+  gl.DisableVertexAttribArray(ATTRIB_TEXCOORD);
+  gl.DisableVertexAttribArray(ATTRIB_POSITION);
+  gl.BindBuffer(ELEMENT_ARRAY_BUFFER, 0);
+  gl.BindBuffer(ARRAY_BUFFER, 0);
+  gl.UseProgram(0);
+
+  if (vertex_array)
+  {
+    gl.BindVertexArray(0);
+  }
+
+  glDisable(GL_BLEND);
+}
+
+/**
+ * Reserves room for the vertices of the next upload. With a persistent
+ * mapping this is the buffer itself: once the current region is full the
+ * next one is used, after waiting until the GPU is done reading it.
+ * @param quads The number of quads, at most MAX_QUADS.
+ * @return Where to write 4 * quads vertices.
+ */
+ShaderRenderer::Vertex* ShaderRenderer::map(int quads)
+{
+  upload_vertices = quads * 4;
+
+  if (!persistent)
+  {
+    staging.resize(upload_vertices);
+    upload_base = 0;
+    return &staging[0];
+  }
+
+  if (region_used + upload_vertices > REGION_VERTICES)
+  {
+    fences[region] = gl.FenceSync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % REGIONS;
+    region_used = 0;
+
+    if (fences[region])
+    {
+      // One second is a stalled driver, rather risk a glitch than hang
+      gl.ClientWaitSync(fences[region], SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+      gl.DeleteSync(fences[region]);
+      fences[region] = nullptr;
+    }
+  }
+
+  upload_base = region * REGION_VERTICES + region_used;
+  return persistent + upload_base;
+}
+
+/**
+ * Makes the vertices written since map() available for drawing. Without
+ * a persistent mapping the buffer is orphaned first, so the driver never
+ * has to wait for draws still using the old contents.
+ */
+void ShaderRenderer::unmap()
+{
+  if (persistent)
+  {
+    // The mapping is coherent, nothing to copy or flush
+    region_used += upload_vertices;
+  }
+  else
+  {
+    ptrdiff_t size = upload_vertices * sizeof(Vertex);
+    gl.BufferData(ARRAY_BUFFER, size, nullptr, STREAM_DRAW);
+    gl.BufferSubData(ARRAY_BUFFER, 0, size, &staging[0]);
+  }
+
+  set_attributes();
+}
+
+/**
+ * Draws quads of the last upload.
+ * @param texture The texture to draw from, 0 for plain color.
+ * @param blend Whether alpha blending should be enabled.
+ * @param first_quad The first quad of the upload to draw.
+ * @param quads The number of quads.
+ */
+void ShaderRenderer::draw(GLuint texture, bool blend, int first_quad, int quads)
+{
+  if (blend)
+  {
+    glEnable(GL_BLEND);
+  }
+  else
+  {
+    glDisable(GL_BLEND);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, texture ? texture : white_texture);
+  glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT,
+                 reinterpret_cast<const void*>(first_quad * 6 * sizeof(GLushort)));
+}
+
+/**
+ * Draws a line, between begin() and end() like the quads.
+ * @param x1, y1 Starting point of the line.
+ * @param x2, y2 End point of the line.
+ * @param color The RGBA color of the line.
+ */
+void ShaderRenderer::draw_line(float x1, float y1, float x2, float y2, const GLubyte color[4])
+{
+  Vertex* v = map(1);
+  v[0].x = x1;
+  v[0].y = y1;
+  v[1].x = x2;
+  v[1].y = y2;
+  for (int i = 0; i < 2; ++i)
+  {
+    v[i].u = 0;
+    v[i].v = 0;
+    memcpy(v[i].color, color, 4);
+  }
+  unmap();
+
+  glEnable(GL_BLEND);
+  glBindTexture(GL_TEXTURE_2D, white_texture);
+  glDrawArrays(GL_LINES, 0, 2);
+}
+
+#endif
+
+/**
+ * Tells whether the shader backend draws the batches.
+ * @return True if OpenGL is used and the backend was set up.
+ */
+bool ShaderRenderer::is_active()
+{
+#ifndef NOOPENGL
+  return use_gl && active;
+#else
+  return false;
+#endif
+}
+
+// EOF
@@ -0,0 +1,89 @@
+//  gl_shader.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_GL_SHADER_H
+#define SUPERTUX_GL_SHADER_H
+
+#include <SDL.h>
+#ifndef NOOPENGL
+#include <SDL_opengl.h>
+#endif
+
+/** Optional OpenGL backend for RenderBatch that avoids the fixed function
+    pipeline: vertices are streamed into a vertex buffer object and drawn
+    as indexed triangles with a single sprite shader, the color (and thus
+    the alpha of a quad) being a vertex attribute. Where the driver offers
+    glBufferStorage() the vertex buffer is mapped persistently, otherwise
+    it is orphaned and refilled on every upload.
+
+    The shader only uses the common subset of GLSL 1.10 and GLSL ES 1.00,
+    so the same code works on desktop, core and ES style drivers. If
+    anything is missing, init() fails and the fixed function path is used. */
+class ShaderRenderer
+{
+public:
+#ifndef NOOPENGL
+  /** Interleaved layout of a vertex in the vertex buffer */
+  struct Vertex
+  {
+    GLfloat x, y;
+    GLfloat u, v;
+    GLubyte color[4];
+  };
+
+  /** Quads that fit into one upload, limited by the 16 bit indices */
+  static const int MAX_QUADS = 16384;
+
+  /** Set up the shader and the buffers for the current GL context. Call
+      after every SDL_SetVideoMode(), objects of an older context are
+      forgotten without being deleted.
+      @return false if the driver lacks what the backend needs */
+  static bool init(int width, int height);
+
+  /** Free all GL objects of the backend */
+  static void shutdown();
+
+  /** Make the shader current and set up the vertex attributes */
+  static void begin();
+  /** Restore the state expected by the fixed function code */
+  static void end();
+
+  /** Get room for the vertices of up to MAX_QUADS quads, four vertices
+      per quad. Only valid until the matching unmap(). */
+  static Vertex* map(int quads);
+  /** Hand the vertices written since map() to OpenGL */
+  static void unmap();
+
+  /** Draw a range of the quads uploaded by the last map()/unmap(),
+      texture 0 draws in plain color */
+  static void draw(GLuint texture, bool blend, int first_quad, int quads);
+
+  /** Draw a blended line of one pixel width */
+  static void draw_line(float x1, float y1, float x2, float y2, const GLubyte color[4]);
+#endif
+
+  /** Tell whether the batches are drawn by this backend */
+  static bool is_active();
+};
+
+#endif /*SUPERTUX_GL_SHADER_H*/
+
+// EOF
@@ -48,6 +48,8 @@ Text* white_big_text;
 MouseCursor * mouse_cursor;
 
 bool use_gl;
+bool use_gl_shaders;
+bool use_gx;
 bool use_joystick;
 bool use_fullscreen;
 bool debug_mode;
@@ -121,4 +123,26 @@ int wait_for_event(SDL_Event& event,unsigned int min_delay, unsigned int max_del
   return 0;
 }
 
+static unsigned int st_rand_state = 1;
+
+/**
+ * Seeds the random numbers of the simulation.
+ * @param seed The seed, replays store it to play the same game again.
+ */
+void st_srand(unsigned int seed)
+{
+  st_rand_state = seed;
+}
+
+/**
+ * Returns the next random number of the simulation. The generator is the
+ * one of the C standard, so results are the same on every platform.
+ * @return A number from 0 to 32767.
+ */
+int st_rand()
+{
+  st_rand_state = st_rand_state * 1103515245 + 12345;
+  return (st_rand_state / 65536) % 32768;
+}
+
 // EOF
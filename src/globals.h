@@ -60,6 +60,10 @@ extern Text* blue_text;
 extern MouseCursor * mouse_cursor;
 
 extern bool use_gl;
+/** Whether OpenGL mode draws through the shader backend, if the driver can */
+extern bool use_gl_shaders;
+/** Whether the Wii build draws with GX instead of SDL, always false elsewhere */
+extern bool use_gx;
 extern bool use_joystick;
 extern bool use_fullscreen;
 extern bool debug_mode;
@@ -80,6 +84,11 @@ extern SDL_Joystick * js;
 
 int wait_for_event(SDL_Event& event,unsigned int min_delay = 0, unsigned int max_delay = 0, bool empty_events = false);
 
+/** Random numbers for the simulation. Drawing code keeps using rand(), so
+    a seeded game plays the same no matter what was drawn in between. */
+void st_srand(unsigned int seed);
+int st_rand();
+
 #endif /* SUPERTUX_GLOBALS_H */
 
 // EOF
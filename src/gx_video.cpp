@@ -0,0 +1,537 @@
+//  gx_video.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifdef _WII_
+
+#include <malloc.h>
+#include <string.h>
+#include <vector>
+#include "gx_video.h"
+#include "virtual_screen.h"
+#include "globals.h"
+
+namespace
+{
+
+const u32 FIFO_SIZE = 256 * 1024;
+
+// Largest texture GX can sample from
+const int MAX_TEXTURE_SIZE = 1024;
+
+bool active = false;
+
+GXRModeObj* rmode = nullptr;
+void* fifo = nullptr;
+void* framebuffers[2] = { nullptr, nullptr };
+int current_framebuffer = 0;
+
+// State of the last quad, so that consecutive quads skip redundant setup
+const GXVideo::Texture* bound_texture = nullptr;
+bool textured = false;
+bool blending = false;
+
+// Textures freed during the current frame, still referenced by the FIFO
+std::vector<GXVideo::Texture*> garbage;
+
+// Target of capture_texture()
+GXVideo::Texture capture = { nullptr };
+
+/**
+ * Switches between textured and plain colored drawing.
+ * @param texture The texture to draw from, null for plain color.
+ */
+void set_texture(const GXVideo::Texture* texture)
+{
+  if (texture)
+  {
+    if (!textured)
+    {
+      GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+      GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+      textured = true;
+    }
+    if (texture != bound_texture)
+    {
+      GX_LoadTexObj(const_cast<GXTexObj*>(&texture->obj), GX_TEXMAP0);
+      bound_texture = texture;
+    }
+  }
+  else if (textured)
+  {
+    GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
+    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+    textured = false;
+  }
+}
+
+/**
+ * Enables or disables alpha blending.
+ * @param blend Whether to blend.
+ */
+void set_blend(bool blend)
+{
+  if (blend != blending)
+  {
+    GX_SetBlendMode(blend ? GX_BM_BLEND : GX_BM_NONE, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
+    blending = blend;
+  }
+}
+
+/**
+ * Sets up the vertex format, the projection and the render state, which
+ * GX_Init() resets.
+ */
+void setup_state()
+{
+  GX_ClearVtxDesc();
+  GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
+  GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+  GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+  GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_POS, GX_POS_XY, GX_F32, 0);
+  GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+  GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
+
+  GX_SetNumChans(1);
+  GX_SetNumTexGens(1);
+  GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
+  GX_SetChanCtrl(GX_COLOR0A0, GX_DISABLE, GX_SRC_REG, GX_SRC_VTX, GX_LIGHTNULL, GX_DF_NONE, GX_AF_NONE);
+
+  // The game works in 640x480, whatever the size of the EFB is
+  Mtx44 projection;
+  guOrtho(projection, 0, screen->h, 0, screen->w, 0, 1);
+  GX_LoadProjectionMtx(projection, GX_ORTHOGRAPHIC);
+
+  // Vertices have no depth, move them between the near and far plane
+  Mtx view;
+  guMtxIdentity(view);
+  guMtxTransApply(view, view, 0, 0, -0.5f);
+  GX_LoadPosMtxImm(view, GX_PNMTX0);
+
+  GX_SetZMode(GX_FALSE, GX_ALWAYS, GX_FALSE);
+  GX_SetCullMode(GX_CULL_NONE);
+  GX_SetClipMode(GX_CLIP_DISABLE);
+  GX_SetColorUpdate(GX_TRUE);
+  GX_SetAlphaUpdate(GX_FALSE);
+
+  GX_SetBlendMode(GX_BM_NONE, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
+  blending = false;
+  GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORDNULL, GX_TEXMAP_NULL, GX_COLOR0A0);
+  GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+  textured = false;
+  bound_texture = nullptr;
+}
+
+/**
+ * Copies a surface into a 32 bit RGBA surface padded to the given size.
+ * @param surf The source surface.
+ * @param width, height The size of the copy.
+ * @return The copy, nullptr if there wasn't enough memory.
+ */
+SDL_Surface* to_rgba(SDL_Surface* surf, int width, int height)
+{
+  SDL_Surface* conv = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+                                           0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+  if (conv == nullptr)
+  {
+    return nullptr;
+  }
+  SDL_FillRect(conv, NULL, 0);
+
+  // Copy the alpha channel instead of blending with it
+  Uint32 saved_flags = surf->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
+  Uint8 saved_alpha = surf->format->alpha;
+  if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+  {
+    SDL_SetAlpha(surf, 0, 0);
+  }
+
+  SDL_BlitSurface(surf, 0, conv, 0);
+
+  if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+  {
+    SDL_SetAlpha(surf, saved_flags, saved_alpha);
+  }
+
+  return conv;
+}
+
+/**
+ * Tells whether every pixel of an RGBA surface is opaque.
+ * @param conv A surface created by to_rgba().
+ * @param w, h The size of the image inside the surface.
+ * @return True if the alpha channel can be dropped.
+ */
+bool is_opaque(SDL_Surface* conv, int w, int h)
+{
+  for (int y = 0; y < h; ++y)
+  {
+    const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<Uint8*>(conv->pixels) + y * conv->pitch);
+    for (int x = 0; x < w; ++x)
+    {
+      if ((row[x] & 0xff) != 0xff)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Reorders RGBA pixels into GX_TF_RGBA8 tiles: each 4x4 tile holds 32
+ * bytes of alpha/red pairs followed by 32 bytes of green/blue pairs.
+ * @param conv The source, its size a multiple of 4.
+ * @param dest Receives width * height * 4 bytes.
+ */
+void tile_rgba8(SDL_Surface* conv, Uint8* dest)
+{
+  for (int ty = 0; ty < conv->h; ty += 4)
+  {
+    for (int tx = 0; tx < conv->w; tx += 4)
+    {
+      for (int y = 0; y < 4; ++y)
+      {
+        const Uint8* row = static_cast<Uint8*>(conv->pixels) + (ty + y) * conv->pitch + tx * 4;
+        for (int x = 0; x < 4; ++x)
+        {
+          // Big endian RGBA in memory
+          const Uint8* p = row + x * 4;
+          int i = (y * 4 + x) * 2;
+          dest[i] = p[3];
+          dest[i + 1] = p[0];
+          dest[32 + i] = p[1];
+          dest[32 + i + 1] = p[2];
+        }
+      }
+      dest += 64;
+    }
+  }
+}
+
+/**
+ * Reorders RGBA pixels into GX_TF_RGB565 tiles of 4x4 pixels.
+ * @param conv The source, its size a multiple of 4.
+ * @param dest Receives width * height * 2 bytes.
+ */
+void tile_rgb565(SDL_Surface* conv, Uint8* dest)
+{
+  u16* out = reinterpret_cast<u16*>(dest);
+  for (int ty = 0; ty < conv->h; ty += 4)
+  {
+    for (int tx = 0; tx < conv->w; tx += 4)
+    {
+      for (int y = 0; y < 4; ++y)
+      {
+        const Uint8* row = static_cast<Uint8*>(conv->pixels) + (ty + y) * conv->pitch + tx * 4;
+        for (int x = 0; x < 4; ++x)
+        {
+          const Uint8* p = row + x * 4;
+          *out++ = static_cast<u16>(((p[0] & 0xf8) << 8) | ((p[1] & 0xfc) << 3) | (p[2] >> 3));
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Sends one vertex to the FIFO.
+ */
+inline void vertex(float x, float y, const Uint8 color[4], float u, float v)
+{
+  GX_Position2f32(x, y);
+  GX_Color4u8(color[0], color[1], color[2], color[3]);
+  GX_TexCoord2f32(u, v);
+}
+
+} // namespace
+
+/**
+ * Sets up GX with its own FIFO and two external framebuffers.
+ * @return True if GX draws from now on.
+ */
+bool GXVideo::init()
+{
+  if (active)
+  {
+    // A new SDL video mode doesn't change what GX needs
+    setup_state();
+    return true;
+  }
+
+  rmode = VIDEO_GetPreferredMode(NULL);
+
+  fifo = memalign(32, FIFO_SIZE);
+  if (fifo == nullptr)
+  {
+    return false;
+  }
+  memset(fifo, 0, FIFO_SIZE);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    framebuffers[i] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(rmode));
+    VIDEO_ClearFrameBuffer(rmode, framebuffers[i], COLOR_BLACK);
+  }
+  current_framebuffer = 0;
+
+  VIDEO_Configure(rmode);
+  VIDEO_SetNextFramebuffer(framebuffers[0]);
+  VIDEO_SetBlack(FALSE);
+  VIDEO_Flush();
+  VIDEO_WaitVSync();
+  if (rmode->viTVMode & VI_NON_INTERLACE)
+  {
+    VIDEO_WaitVSync();
+  }
+
+  GX_Init(fifo, FIFO_SIZE);
+
+  GXColor background = { 0, 0, 0, 0xff };
+  GX_SetCopyClear(background, 0x00ffffff);
+
+  GX_SetViewport(0, 0, rmode->fbWidth, rmode->efbHeight, 0, 1);
+  f32 yscale = GX_GetYScaleFactor(rmode->efbHeight, rmode->xfbHeight);
+  u32 xfb_height = GX_SetDispCopyYScale(yscale);
+  GX_SetScissor(0, 0, rmode->fbWidth, rmode->efbHeight);
+  GX_SetDispCopySrc(0, 0, rmode->fbWidth, rmode->efbHeight);
+  GX_SetDispCopyDst(rmode->fbWidth, xfb_height);
+  // The copy to the XFB scales to the TV mode, nearest filtering leaves
+  // out its vertical blur
+  static u8 no_filter[7] = { 0, 0, 21, 22, 21, 0, 0 };
+  bool nearest = VirtualScreen::get_filter() == VirtualScreen::FILTER_NEAREST;
+  GX_SetCopyFilter(rmode->aa, rmode->sample_pattern, GX_TRUE, nearest ? no_filter : rmode->vfilter);
+  GX_SetFieldMode(rmode->field_rendering,
+                  (rmode->viHeight == 2 * rmode->xfbHeight) ? GX_ENABLE : GX_DISABLE);
+  GX_SetPixelFmt(rmode->aa ? GX_PF_RGB565_Z16 : GX_PF_RGB8_Z24, GX_ZC_LINEAR);
+  GX_SetDispCopyGamma(GX_GM_1_0);
+
+  setup_state();
+  GX_InvalidateTexAll();
+
+  active = true;
+  return true;
+}
+
+/**
+ * Converts a surface into a GX texture.
+ * @param surf The surface to upload.
+ * @return The texture, nullptr if it is too big or memory ran out.
+ */
+GXVideo::Texture* GXVideo::create_texture(SDL_Surface* surf)
+{
+  int width = (surf->w + 3) & ~3;
+  int height = (surf->h + 3) & ~3;
+  if (width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE)
+  {
+    return nullptr;
+  }
+
+  SDL_Surface* conv = to_rgba(surf, width, height);
+  if (conv == nullptr)
+  {
+    return nullptr;
+  }
+
+  bool opaque = is_opaque(conv, surf->w, surf->h);
+  u32 size = width * height * (opaque ? 2 : 4);
+
+  Texture* texture = new Texture;
+  texture->data = memalign(32, size);
+  texture->width = width;
+  texture->height = height;
+  if (texture->data == nullptr)
+  {
+    SDL_FreeSurface(conv);
+    delete texture;
+    return nullptr;
+  }
+
+  if (opaque)
+  {
+    tile_rgb565(conv, static_cast<Uint8*>(texture->data));
+  }
+  else
+  {
+    tile_rgba8(conv, static_cast<Uint8*>(texture->data));
+  }
+  SDL_FreeSurface(conv);
+
+  DCFlushRange(texture->data, size);
+  GX_InitTexObj(&texture->obj, texture->data, width, height,
+                opaque ? GX_TF_RGB565 : GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+  GX_InitTexObjLOD(&texture->obj, GX_LINEAR, GX_LINEAR, 0, 0, 0, GX_FALSE, GX_FALSE, GX_ANISO_1);
+
+  // The texture cache may still hold whatever lived at this address before
+  GX_InvalidateTexAll();
+  return texture;
+}
+
+/**
+ * Queues a texture for freeing at the end of the frame.
+ * @param texture The texture, may be null.
+ */
+void GXVideo::free_texture(Texture* texture)
+{
+  if (texture == nullptr)
+  {
+    return;
+  }
+
+  if (texture == bound_texture)
+  {
+    bound_texture = nullptr;
+  }
+  garbage.push_back(texture);
+}
+
+/**
+ * Draws a textured quad.
+ * @param texture The texture to draw from.
+ * @param blend Whether alpha blending should be enabled for the quad.
+ * @param alpha The alpha value, also used to darken the color.
+ * @param x1, y1 Upper left corner on the screen.
+ * @param x2, y2 Lower right corner on the screen.
+ * @param u1, v1 Upper left texture coordinate.
+ * @param u2, v2 Lower right texture coordinate.
+ */
+void GXVideo::draw_quad(const Texture* texture, bool blend, Uint8 alpha,
+                        float x1, float y1, float x2, float y2,
+                        float u1, float v1, float u2, float v2)
+{
+  const Uint8 color[4] = { alpha, alpha, alpha, alpha };
+
+  set_texture(texture);
+  set_blend(blend);
+
+  GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+  vertex(x1, y1, color, u1, v1);
+  vertex(x2, y1, color, u2, v1);
+  vertex(x2, y2, color, u2, v2);
+  vertex(x1, y2, color, u1, v2);
+  GX_End();
+}
+
+/**
+ * Draws an untextured quad.
+ * @param blend Whether alpha blending should be enabled for the quad.
+ * @param top The RGBA color of the upper corners.
+ * @param bottom The RGBA color of the lower corners.
+ * @param x1, y1 Upper left corner on the screen.
+ * @param x2, y2 Lower right corner on the screen.
+ */
+void GXVideo::fill_rect(bool blend, const Uint8 top[4], const Uint8 bottom[4],
+                        float x1, float y1, float x2, float y2)
+{
+  set_texture(nullptr);
+  set_blend(blend);
+
+  GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+  vertex(x1, y1, top, 0, 0);
+  vertex(x2, y1, top, 0, 0);
+  vertex(x2, y2, bottom, 0, 0);
+  vertex(x1, y2, bottom, 0, 0);
+  GX_End();
+}
+
+/**
+ * Draws a blended line.
+ * @param x1, y1 Starting point of the line.
+ * @param x2, y2 End point of the line.
+ * @param color The RGBA color of the line.
+ */
+void GXVideo::draw_line(float x1, float y1, float x2, float y2, const Uint8 color[4])
+{
+  set_texture(nullptr);
+  set_blend(true);
+
+  GX_Begin(GX_LINES, GX_VTXFMT0, 2);
+  vertex(x1, y1, color, 0, 0);
+  vertex(x2, y2, color, 0, 0);
+  GX_End();
+}
+
+/**
+ * Copies the EFB into a texture the GPU draws from directly. The texture
+ * is allocated by the first call and reused by all later ones.
+ * @return The texture, nullptr if memory ran out.
+ */
+const GXVideo::Texture* GXVideo::capture_texture()
+{
+  int width = rmode->fbWidth;
+  int height = rmode->efbHeight;
+
+  if (capture.data == nullptr)
+  {
+    capture.data = memalign(32, width * height * 2);
+    if (capture.data == nullptr)
+    {
+      return nullptr;
+    }
+    capture.width = width;
+    capture.height = height;
+  }
+
+  GX_DrawDone();
+  GX_SetTexCopySrc(0, 0, width, height);
+  GX_SetTexCopyDst(width, height, GX_TF_RGB565, GX_FALSE);
+  GX_CopyTex(capture.data, GX_FALSE);
+  GX_PixModeSync();
+
+  GX_InitTexObj(&capture.obj, capture.data, width, height, GX_TF_RGB565, GX_CLAMP, GX_CLAMP, GX_FALSE);
+  GX_InitTexObjLOD(&capture.obj, GX_LINEAR, GX_LINEAR, 0, 0, 0, GX_FALSE, GX_FALSE, GX_ANISO_1);
+
+  // The texels changed behind the back of the texture cache
+  GX_InvalidateTexAll();
+  bound_texture = nullptr;
+  return &capture;
+}
+
+/**
+ * Copies the finished frame into the next external framebuffer and
+ * shows it at the coming vertical blank. Textures freed during the frame
+ * are released once the GPU is done with it.
+ */
+void GXVideo::flip()
+{
+  GX_DrawDone();
+
+  for (Texture* texture : garbage)
+  {
+    free(texture->data);
+    delete texture;
+  }
+  garbage.clear();
+
+  current_framebuffer ^= 1;
+  GX_SetColorUpdate(GX_TRUE);
+  // Every frame covers the whole screen anyway, so the EFB isn't cleared
+  // and keeps the frame for capture_texture() until the next one is drawn
+  GX_CopyDisp(framebuffers[current_framebuffer], GX_FALSE);
+  GX_Flush();
+
+  VIDEO_SetNextFramebuffer(framebuffers[current_framebuffer]);
+  VIDEO_Flush();
+  VIDEO_WaitVSync();
+}
+
+#endif
+
+// EOF
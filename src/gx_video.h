@@ -0,0 +1,85 @@
+//  gx_video.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_GX_VIDEO_H
+#define SUPERTUX_GX_VIDEO_H
+
+#include <SDL.h>
+#ifdef _WII_
+#include <gccore.h>
+#endif
+
+/** Native rendering on the Wii: surfaces are converted into the tiled
+    texture formats of the GPU and drawn as quads through the GX FIFO,
+    so blending and scaling no longer cost Broadway time.
+
+    SDL still opens the video mode (input and the screen surface depend
+    on it), but once init() succeeded GX owns the display: frames are
+    copied from the EFB into our own external framebuffers and SDL_Flip()
+    isn't used anymore. Like in OpenGL mode every frame is drawn from
+    scratch; the EFB isn't cleared, so it still holds the last frame
+    until the next one is drawn. */
+#ifdef _WII_
+class GXVideo
+{
+public:
+  /** A surface uploaded into GPU memory */
+  struct Texture
+  {
+    void* data;      // tiled texels, 32 byte aligned
+    GXTexObj obj;
+    int width;       // padded to the 4x4 tiles of the formats
+    int height;
+  };
+
+  /** Set up GX and the framebuffers.
+      @return false if there isn't enough memory */
+  static bool init();
+
+  /** Convert a surface into a texture. Opaque images are stored as
+      RGB565, everything else as RGBA8. */
+  static Texture* create_texture(SDL_Surface* surf);
+  /** Free a texture after the GPU is done with the current frame */
+  static void free_texture(Texture* texture);
+
+  /** Draw a textured quad, coordinates are in screen pixels and texture
+      coordinates in the 0..1 range of the texture */
+  static void draw_quad(const Texture* texture, bool blend, Uint8 alpha,
+                        float x1, float y1, float x2, float y2,
+                        float u1, float v1, float u2, float v2);
+  /** Draw an untextured quad with the given RGBA colors along its top
+      and bottom edge */
+  static void fill_rect(bool blend, const Uint8 top[4], const Uint8 bottom[4],
+                        float x1, float y1, float x2, float y2);
+  static void draw_line(float x1, float y1, float x2, float y2, const Uint8 color[4]);
+
+  /** Copy the EFB, what was drawn since the last flip or else the last
+      frame, into a texture of GXVideo that is reused by every call */
+  static const Texture* capture_texture();
+
+  /** Finish the frame and show it at the next vertical blank */
+  static void flip();
+};
+#endif
+
+#endif /*SUPERTUX_GX_VIDEO_H*/
+
+// EOF
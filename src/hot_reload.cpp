@@ -0,0 +1,224 @@
+//  hot_reload.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <SDL.h>
+#include "hot_reload.h"
+#include "globals.h"
+#include "world.h"
+#include "level.h"
+#include "tile.h"
+#include "resources.h"
+#include "sprite_manager.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+enum WatchKind
+{
+  WATCH_TILESET,
+  WATCH_LEVEL,
+  WATCH_SPRITES,
+  WATCH_KINDS
+};
+
+struct WatchedFile
+{
+  std::string path;
+  WatchKind kind;
+  fs::file_time_type mtime;
+};
+
+bool enabled = false;
+Uint32 last_check = 0;
+
+std::vector<WatchedFile> files;
+const World* watched_world = nullptr;
+std::string watched_level;
+
+/**
+ * Returns the modification time of a file.
+ * @param path The file.
+ * @return The time, or the epoch if the file doesn't exist.
+ */
+fs::file_time_type get_mtime(const std::string& path)
+{
+  std::error_code ec;
+  fs::file_time_type mtime = fs::last_write_time(path, ec);
+  return ec ? fs::file_time_type() : mtime;
+}
+
+/**
+ * Adds a file to the watched ones.
+ * @param path The file.
+ * @param kind What to reload when the file changes.
+ */
+void watch(const std::string& path, WatchKind kind)
+{
+  WatchedFile file;
+  file.path = path;
+  file.kind = kind;
+  file.mtime = get_mtime(path);
+  files.push_back(file);
+}
+
+/**
+ * Starts watching the files of a world as they are now.
+ * @param world The world being played.
+ */
+void watch_world(World* world)
+{
+  files.clear();
+  watched_world = world;
+  watched_level = world->get_level()->level_file;
+
+  for (const std::string& file : TileManager::instance()->get_tileset_files())
+  {
+    watch(file, WATCH_TILESET);
+  }
+  if (!watched_level.empty())
+  {
+    watch(watched_level, WATCH_LEVEL);
+  }
+  watch(datadir + "/supertux.strf", WATCH_SPRITES);
+}
+
+/**
+ * Reloads what a kind of file holds.
+ * @param world The world being played.
+ * @param kind The kind of the changed file.
+ * @return True if the file could be read.
+ */
+bool reload(World* world, WatchKind kind)
+{
+  switch (kind)
+  {
+    case WATCH_TILESET:
+      return world->reload_tileset();
+
+    case WATCH_LEVEL:
+      return world->reload_level();
+
+    case WATCH_SPRITES:
+      return sprite_manager->reload(datadir + "/supertux.strf");
+
+    default:
+      return false;
+  }
+}
+
+} // namespace
+
+/**
+ * Turns the reloading on or off.
+ * @param enable True to watch the files.
+ */
+void HotReload::enable(bool enable)
+{
+  enabled = enable;
+  watched_world = nullptr;
+}
+
+/**
+ * Tells whether files are watched.
+ * @return True if update() reloads changed files.
+ */
+bool HotReload::is_enabled()
+{
+  return enabled;
+}
+
+/**
+ * Checks the files of a world, the tileset is reloaded before the level
+ * so the level's tile flags come from the new tiles.
+ * @param world The world being played.
+ */
+void HotReload::update(World* world)
+{
+  if (!enabled || !world)
+  {
+    return;
+  }
+
+  // A new level was started, its files are the ones to watch now
+  if (world != watched_world || world->get_level()->level_file != watched_level)
+  {
+    watch_world(world);
+    return;
+  }
+
+  Uint32 now = SDL_GetTicks();
+  if (now - last_check < CHECK_INTERVAL)
+  {
+    return;
+  }
+  last_check = now;
+
+  bool changed[WATCH_KINDS] = { false };
+  bool any = false;
+  for (WatchedFile& file : files)
+  {
+    fs::file_time_type mtime = get_mtime(file.path);
+    if (mtime != file.mtime)
+    {
+      file.mtime = mtime;
+      changed[file.kind] = true;
+      any = true;
+    }
+  }
+
+  if (!any)
+  {
+    return;
+  }
+
+  static const char* const names[WATCH_KINDS] = { "tileset", "level", "sprites" };
+  for (int kind = 0; kind < WATCH_KINDS; ++kind)
+  {
+    if (!changed[kind])
+    {
+      continue;
+    }
+
+    Uint32 start = SDL_GetTicks();
+    if (reload(world, static_cast<WatchKind>(kind)))
+    {
+      printf("HotReload: Reloaded %s in %u ms\n", names[kind], SDL_GetTicks() - start);
+    }
+    else
+    {
+      printf("HotReload: Couldn't reload %s, keeping the old one\n", names[kind]);
+    }
+  }
+
+  // The tileset may include other files now
+  if (changed[WATCH_TILESET])
+  {
+    watch_world(world);
+  }
+}
+
+// EOF
@@ -0,0 +1,50 @@
+//  hot_reload.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_HOT_RELOAD_H
+#define SUPERTUX_HOT_RELOAD_H
+
+class World;
+
+/** Reads the files of the level being played again when they change, so
+    edits of the level, its tileset and the sprite definitions show up
+    without restarting the game.
+
+    SDL can't watch files, so their modification times are polled every
+    CHECK_INTERVAL ms. Only what changed is read again and swapped into
+    the running world: Tux, the awake badguys and the effects stay where
+    they are. A file that doesn't parse, e.g. one being saved, is ignored
+    until it changes again. */
+class HotReload
+{
+public:
+  static const unsigned int CHECK_INTERVAL = 500;
+
+  static void enable(bool enable);
+  static bool is_enabled();
+
+  /** Check the files of world and reload the changed ones, once per frame */
+  static void update(World* world);
+};
+
+#endif /*SUPERTUX_HOT_RELOAD_H*/
+
+// EOF
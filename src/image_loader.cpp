@@ -0,0 +1,288 @@
+//  image_loader.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include "image_loader.h"
+#include "asset_archive.h"
+
+namespace
+{
+
+enum JobState
+{
+  JOB_QUEUED,
+  JOB_DECODING,
+  JOB_DONE,
+  JOB_TAKEN     // handed over or cancelled
+};
+
+struct Job
+{
+  std::string file;
+  SDL_Surface* surface;
+  JobState state;
+};
+
+// Everything below is guarded by mutex. Jobs are never removed until
+// flush(), so workers can refer to them by index.
+SDL_mutex* mutex = nullptr;
+SDL_cond* decoded = nullptr;
+std::deque<Job> jobs;
+std::map<std::string, size_t> job_of_file;
+size_t next_job = 0;
+SDL_Thread* threads[ImageLoader::WORKERS];
+bool busy[ImageLoader::WORKERS];
+
+/**
+ * Decodes an image file, out of the asset archive if it has the file.
+ * @param file The image file.
+ * @return The decoded image, nullptr on errors.
+ */
+SDL_Surface* decode(const std::string& file)
+{
+  std::string data;
+  if (AssetArchive::read(file, &data))
+  {
+    return IMG_Load_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
+  }
+  return IMG_Load(file.c_str());
+}
+
+/**
+ * Body of a worker thread, decodes queued files until there are none
+ * left.
+ * @param data The slot of the worker.
+ * @return Always 0.
+ */
+int worker(void* data)
+{
+  int slot = static_cast<int>(reinterpret_cast<intptr_t>(data));
+
+  SDL_LockMutex(mutex);
+  while (next_job < jobs.size())
+  {
+    size_t index = next_job++;
+    if (jobs[index].state != JOB_QUEUED)
+    {
+      continue;
+    }
+
+    jobs[index].state = JOB_DECODING;
+    std::string file = jobs[index].file;
+    SDL_UnlockMutex(mutex);
+
+    SDL_Surface* surface = decode(file);
+
+    SDL_LockMutex(mutex);
+    jobs[index].surface = surface;
+    jobs[index].state = JOB_DONE;
+    SDL_CondBroadcast(decoded);
+  }
+  busy[slot] = false;
+  SDL_UnlockMutex(mutex);
+
+  return 0;
+}
+
+/**
+ * Starts the workers that aren't running, the caller must hold the
+ * mutex.
+ */
+void start_workers()
+{
+  for (int i = 0; i < ImageLoader::WORKERS; ++i)
+  {
+    if (busy[i])
+    {
+      continue;
+    }
+
+    // A worker that isn't busy anymore doesn't need the mutex, so it
+    // can be waited for here
+    if (threads[i])
+    {
+      SDL_WaitThread(threads[i], nullptr);
+    }
+    threads[i] = SDL_CreateThread(worker, reinterpret_cast<void*>(intptr_t(i)));
+    busy[i] = threads[i] != nullptr;
+  }
+}
+
+/**
+ * Adds a file to the queue, the caller must hold the mutex.
+ * @param file The image file.
+ */
+void add_job(const std::string& file)
+{
+  std::map<std::string, size_t>::iterator i = job_of_file.find(file);
+  if (i != job_of_file.end() && jobs[i->second].state != JOB_TAKEN)
+  {
+    return;
+  }
+
+  Job job;
+  job.file = file;
+  job.surface = nullptr;
+  job.state = JOB_QUEUED;
+  jobs.push_back(job);
+  job_of_file[file] = jobs.size() - 1;
+}
+
+/**
+ * Creates the mutex and the condition on first use.
+ * @return False if threads can't be used.
+ */
+bool init()
+{
+  if (mutex == nullptr)
+  {
+    mutex = SDL_CreateMutex();
+    decoded = SDL_CreateCond();
+  }
+  return mutex != nullptr && decoded != nullptr;
+}
+
+} // namespace
+
+/**
+ * Starts decoding a file in the background.
+ * @param file The image file.
+ */
+void ImageLoader::queue(const std::string& file)
+{
+  queue(std::vector<std::string>(1, file));
+}
+
+/**
+ * Starts decoding files in the background, in the given order.
+ * @param files The image files.
+ */
+void ImageLoader::queue(const std::vector<std::string>& files)
+{
+  if (files.empty() || !init())
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  for (const std::string& file : files)
+  {
+    add_job(file);
+  }
+  start_workers();
+  SDL_UnlockMutex(mutex);
+}
+
+/**
+ * Gets the decoded image of a file. A file that isn't queued, or that
+ * no worker started on, is decoded right here instead of waiting.
+ * @param file The image file.
+ * @return The decoded image owned by the caller, nullptr on errors.
+ */
+SDL_Surface* ImageLoader::load(const std::string& file)
+{
+  if (mutex == nullptr)
+  {
+    return decode(file);
+  }
+
+  SDL_LockMutex(mutex);
+  std::map<std::string, size_t>::iterator i = job_of_file.find(file);
+  if (i == job_of_file.end())
+  {
+    SDL_UnlockMutex(mutex);
+    return decode(file);
+  }
+
+  Job& job = jobs[i->second];
+  job_of_file.erase(i);
+
+  while (job.state == JOB_DECODING)
+  {
+    SDL_CondWait(decoded, mutex);
+  }
+
+  SDL_Surface* surface = nullptr;
+  bool decode_here = job.state != JOB_DONE;
+  if (!decode_here)
+  {
+    surface = job.surface;
+    job.surface = nullptr;
+  }
+  job.state = JOB_TAKEN;
+  job.file.clear();
+  SDL_UnlockMutex(mutex);
+
+  if (decode_here)
+  {
+    surface = decode(file);
+  }
+  return surface;
+}
+
+/**
+ * Cancels the queued files, waits for the workers and frees the decoded
+ * images nobody took.
+ */
+void ImageLoader::flush()
+{
+  if (mutex == nullptr)
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  for (Job& job : jobs)
+  {
+    if (job.state == JOB_QUEUED)
+    {
+      job.state = JOB_TAKEN;
+    }
+  }
+  SDL_UnlockMutex(mutex);
+
+  for (int i = 0; i < WORKERS; ++i)
+  {
+    if (threads[i])
+    {
+      SDL_WaitThread(threads[i], nullptr);
+      threads[i] = nullptr;
+    }
+  }
+
+  SDL_LockMutex(mutex);
+  for (Job& job : jobs)
+  {
+    if (job.surface)
+    {
+      SDL_FreeSurface(job.surface);
+    }
+  }
+  jobs.clear();
+  job_of_file.clear();
+  next_job = 0;
+  SDL_UnlockMutex(mutex);
+}
+
+// EOF
@@ -0,0 +1,58 @@
+//  image_loader.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_IMAGE_LOADER_H
+#define SUPERTUX_IMAGE_LOADER_H
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+/** Reads and decodes image files on a few worker threads, so the main
+    thread only has to convert them into surfaces. Files are queued
+    ahead of time and handed over by load() in any order; files that
+    weren't queued, or that no worker got to yet, are decoded by the
+    caller itself.
+
+    The workers never touch the screen, SDL and GL surfaces are only
+    created on the main thread. */
+class ImageLoader
+{
+public:
+  /** Number of worker threads */
+  static const int WORKERS = 2;
+
+  /** Start decoding files in the background */
+  static void queue(const std::string& file);
+  static void queue(const std::vector<std::string>& files);
+
+  /** Get the decoded image of a file, waits for a worker that is busy
+      with it. Returns nullptr if it can't be loaded, the caller owns the
+      returned surface. */
+  static SDL_Surface* load(const std::string& file);
+
+  /** Drop the queue, wait for the workers and free the images nobody
+      asked for */
+  static void flush();
+};
+
+#endif /*SUPERTUX_IMAGE_LOADER_H*/
+
+// EOF
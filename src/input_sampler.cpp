@@ -0,0 +1,209 @@
+//  input_sampler.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <chrono>
+#include "input_sampler.h"
+#include "globals.h"
+#include "defines.h"
+#include "player.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// Latencies averaged for get_latency()
+const int HISTORY = 16;
+
+// Joystick buttons that jump and fire, the same the events used to check
+const int JUMP_BUTTON = 3;
+const int FIRE_BUTTON = 2;
+
+// The oldest event not looked at by sample() yet
+bool event_pending = false;
+Clock::time_point event_time;
+
+// An input change waiting for the frame that shows it
+bool change_pending = false;
+Clock::time_point change_time;
+
+player_input_type pointer = { UP, UP, UP, UP, UP, UP, UP };
+
+float latencies[HISTORY];
+int latency_count = 0;
+int latency_pos = 0;
+
+/**
+ * Looks up a key in the keyboard state.
+ * @param keys The state from SDL_GetKeyState().
+ * @param key The key, may be out of range when the keymap is broken.
+ * @return True if the key is pressed.
+ */
+bool pressed(const Uint8* keys, int key)
+{
+  return key > SDLK_UNKNOWN && key < SDLK_LAST && keys[key];
+}
+
+} // namespace
+
+/**
+ * Tells whether a key controls tux and is thus handled by sample().
+ * @param key The key.
+ * @return True for the keys of the keymap.
+ */
+bool InputSampler::handles_key(SDLKey key)
+{
+  return key == keymap.left || key == keymap.right || key == keymap.jump ||
+         key == keymap.duck || key == keymap.fire;
+}
+
+/**
+ * Remembers when the first input event since the last sample() came in.
+ */
+void InputSampler::note_event()
+{
+  if (!event_pending)
+  {
+    event_pending = true;
+    event_time = Clock::now();
+  }
+}
+
+/**
+ * Reads keyboard, joystick and pointer into the controls of tux.
+ * Directions and buttons are DOWN if any of the devices presses them.
+ * @param input The controls to update, old_up and old_fire are kept
+ *              except for releasing fire, like Player::key_event() does.
+ */
+void InputSampler::sample(player_input_type* input)
+{
+  const Uint8* keys = SDL_GetKeyState(NULL);
+  bool left = pressed(keys, keymap.left);
+  bool right = pressed(keys, keymap.right);
+  bool up = pressed(keys, keymap.jump);
+  bool down = pressed(keys, keymap.duck);
+  bool fire = pressed(keys, keymap.fire);
+
+  if (use_joystick && js)
+  {
+    int dead_zone = joystick_keymap.dead_zone;
+    if (joystick_keymap.x_axis < SDL_JoystickNumAxes(js))
+    {
+      Sint16 x = SDL_JoystickGetAxis(js, joystick_keymap.x_axis);
+      left = left || x < -dead_zone;
+      right = right || x > dead_zone;
+    }
+    if (joystick_keymap.y_axis < SDL_JoystickNumAxes(js))
+    {
+      down = down || SDL_JoystickGetAxis(js, joystick_keymap.y_axis) > dead_zone;
+    }
+    if (SDL_JoystickNumHats(js) > 0)
+    {
+      Uint8 hat = SDL_JoystickGetHat(js, 0);
+      left = left || (hat & SDL_HAT_LEFT);
+      right = right || (hat & SDL_HAT_RIGHT);
+      down = down || (hat & SDL_HAT_DOWN);
+    }
+    if (SDL_JoystickNumButtons(js) > JUMP_BUTTON)
+    {
+      up = up || SDL_JoystickGetButton(js, JUMP_BUTTON);
+      fire = fire || SDL_JoystickGetButton(js, FIRE_BUTTON);
+    }
+  }
+
+  left = left || pointer.left == DOWN;
+  right = right || pointer.right == DOWN;
+  up = up || pointer.up == DOWN;
+  down = down || pointer.down == DOWN;
+  fire = fire || pointer.fire == DOWN;
+
+  player_input_type sampled = *input;
+  sampled.left = left ? DOWN : UP;
+  sampled.right = right ? DOWN : UP;
+  sampled.up = up ? DOWN : UP;
+  sampled.down = down ? DOWN : UP;
+  sampled.fire = fire ? DOWN : UP;
+  if (sampled.fire == UP)
+  {
+    sampled.old_fire = UP;
+  }
+
+  bool changed = sampled.left != input->left || sampled.right != input->right ||
+                 sampled.up != input->up || sampled.down != input->down ||
+                 sampled.fire != input->fire;
+  if (changed && event_pending && !change_pending)
+  {
+    change_pending = true;
+    change_time = event_time;
+  }
+  event_pending = false;
+
+  *input = sampled;
+}
+
+/**
+ * Returns the controls set by pointer events.
+ * @return The controls, all UP unless a pointer set them.
+ */
+player_input_type* InputSampler::get_pointer_input()
+{
+  return &pointer;
+}
+
+/**
+ * Records the latency of the last input change once it is on screen.
+ */
+void InputSampler::frame_presented()
+{
+  if (!change_pending)
+  {
+    return;
+  }
+
+  change_pending = false;
+  latencies[latency_pos] = std::chrono::duration<float, std::milli>(Clock::now() - change_time).count();
+  latency_pos = (latency_pos + 1) % HISTORY;
+  if (latency_count < HISTORY)
+  {
+    ++latency_count;
+  }
+}
+
+/**
+ * Returns the mean of the last measured latencies.
+ * @return The latency in milliseconds.
+ */
+float InputSampler::get_latency()
+{
+  if (latency_count == 0)
+  {
+    return 0;
+  }
+
+  float sum = 0;
+  for (int i = 0; i < latency_count; ++i)
+  {
+    sum += latencies[i];
+  }
+  return sum / latency_count;
+}
+
+// EOF
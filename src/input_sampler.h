@@ -0,0 +1,65 @@
+//  input_sampler.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_INPUT_SAMPLER_H
+#define SUPERTUX_INPUT_SAMPLER_H
+
+#include <SDL.h>
+
+struct player_input_type;
+
+/** Reads the controls of tux from the state of the keyboard and the
+    joystick (which the Wiimote is on the Wii) once per logic step, instead
+    of reacting to every single event, so handling input costs the same
+    every frame.
+
+    It also measures the input latency: the time from polling an event
+    that changed the controls until the frame showing its effect was
+    presented. Events have no timestamps in SDL 1.2, so this starts when
+    the event was polled and is a lower bound. */
+class InputSampler
+{
+public:
+  /** Tell whether a key is one of the keys controlling tux */
+  static bool handles_key(SDLKey key);
+
+  /** Note that an input event was polled just now */
+  static void note_event();
+
+  /** Update the controls from the current state of the devices */
+  static void sample(player_input_type* input);
+
+  /** Controls set from pointer events (the touch screen controls of
+      TSCONTROL builds), merged into every sample */
+  static player_input_type* get_pointer_input();
+
+  /** Called after flipscreen(), closes the latency measurement of an input
+      change sampled before */
+  static void frame_presented();
+
+  /** Mean latency of the last input changes in milliseconds, 0 if there
+      wasn't any yet */
+  static float get_latency();
+};
+
+#endif /*SUPERTUX_INPUT_SAMPLER_H*/
+
+// EOF
@@ -0,0 +1,202 @@
+//  job_system.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <SDL.h>
+#include <vector>
+#ifndef _WII_
+#include <thread>
+#endif
+#include "job_system.h"
+
+namespace
+{
+
+std::vector<JobSystem::Job> queued;
+
+// Everything below is guarded by mutex. jobs only changes while no run()
+// is in progress, so it can be read without the mutex meanwhile.
+SDL_mutex* mutex = nullptr;
+SDL_cond* work_ready = nullptr;
+SDL_cond* work_done = nullptr;
+std::vector<JobSystem::Job> jobs;
+size_t next_job = 0;
+size_t unfinished = 0;
+bool quitting = false;
+std::vector<SDL_Thread*> threads;
+
+/**
+ * Takes jobs of the current run() until there are none left, the caller
+ * must hold the mutex.
+ */
+void take_jobs()
+{
+  while (next_job < jobs.size())
+  {
+    const JobSystem::Job& job = jobs[next_job++];
+    SDL_UnlockMutex(mutex);
+
+    job();
+
+    SDL_LockMutex(mutex);
+    if (--unfinished == 0)
+    {
+      SDL_CondBroadcast(work_done);
+    }
+  }
+}
+
+/**
+ * Body of a worker thread, runs jobs until shutdown().
+ * @return Always 0.
+ */
+int worker(void*)
+{
+  SDL_LockMutex(mutex);
+  while (!quitting)
+  {
+    take_jobs();
+    if (!quitting)
+    {
+      SDL_CondWait(work_ready, mutex);
+    }
+  }
+  SDL_UnlockMutex(mutex);
+
+  return 0;
+}
+
+/**
+ * Starts the workers on first use.
+ * @return False if there are none, so jobs run on the calling thread.
+ */
+bool start_workers()
+{
+  if (!threads.empty())
+  {
+    return true;
+  }
+
+#ifdef _WII_
+  return false;
+#else
+  int count = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+  if (count > JobSystem::MAX_WORKERS)
+  {
+    count = JobSystem::MAX_WORKERS;
+  }
+  if (count <= 0)
+  {
+    return false;
+  }
+
+  if (mutex == nullptr)
+  {
+    mutex = SDL_CreateMutex();
+    work_ready = SDL_CreateCond();
+    work_done = SDL_CreateCond();
+    if (mutex == nullptr || work_ready == nullptr || work_done == nullptr)
+    {
+      return false;
+    }
+  }
+
+  quitting = false;
+  for (int i = 0; i < count; ++i)
+  {
+    SDL_Thread* thread = SDL_CreateThread(worker, nullptr);
+    if (thread == nullptr)
+    {
+      break;
+    }
+    threads.push_back(thread);
+  }
+  return !threads.empty();
+#endif
+}
+
+} // namespace
+
+/**
+ * Queues a job for the next run().
+ * @param job The job, it must only change state no other job uses.
+ */
+void JobSystem::add(const Job& job)
+{
+  queued.push_back(job);
+}
+
+/**
+ * Runs the queued jobs on the workers and the calling thread. A single
+ * job isn't worth waking the workers for.
+ */
+void JobSystem::run()
+{
+  if (queued.size() < 2 || !start_workers())
+  {
+    for (const Job& job : queued)
+    {
+      job();
+    }
+    queued.clear();
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  jobs.swap(queued);
+  next_job = 0;
+  unfinished = jobs.size();
+  SDL_CondBroadcast(work_ready);
+
+  take_jobs();
+  while (unfinished > 0)
+  {
+    SDL_CondWait(work_done, mutex);
+  }
+
+  jobs.clear();
+  next_job = 0;
+  SDL_UnlockMutex(mutex);
+
+  queued.clear();
+}
+
+/**
+ * Stops the worker threads and waits for them.
+ */
+void JobSystem::shutdown()
+{
+  if (threads.empty())
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  quitting = true;
+  SDL_CondBroadcast(work_ready);
+  SDL_UnlockMutex(mutex);
+
+  for (SDL_Thread* thread : threads)
+  {
+    SDL_WaitThread(thread, nullptr);
+  }
+  threads.clear();
+}
+
+// EOF
@@ -0,0 +1,55 @@
+//  job_system.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_JOB_SYSTEM_H
+#define SUPERTUX_JOB_SYSTEM_H
+
+#include <functional>
+
+/** Runs small independent jobs on a few worker threads, one per
+    additional core. Jobs are queued with add() and run() returns once
+    all of them are done, the calling thread takes jobs as well. Without
+    workers, e.g. on the single core Wii, run() simply calls the jobs in
+    the order they were added.
+
+    Jobs must not touch any state another job or the main thread uses
+    meanwhile, which leaves out tiles, sounds, the screen and spawning
+    objects. */
+class JobSystem
+{
+public:
+  typedef std::function<void()> Job;
+
+  /** Highest number of worker threads */
+  static const int MAX_WORKERS = 7;
+
+  /** Queue a job for the next run(), only done by the main thread */
+  static void add(const Job& job);
+
+  /** Run the queued jobs and wait until all of them are done */
+  static void run();
+
+  /** Stop the worker threads, they start again on the next run() */
+  static void shutdown();
+};
+
+#endif /*SUPERTUX_JOB_SYSTEM_H*/
+
+// EOF
@@ -19,18 +19,25 @@
 //  02111-1307, USA.
 
 #include <map>
+#include <atomic>
 #include <iostream>
 #include <filesystem>
+#include <SDL_image.h>
 #include "globals.h"
 #include "setup.h"
 #include "screen.h"
 #include "level.h"
+#include "level_cache.h"
+#include "dir_index.h"
+#include "image_loader.h"
+#include "background_strips.h"
 #include "physic.h"
 #include "scene.h"
 #include "tile.h"
 #include "lispreader.h"
 #include "resources.h"
 #include "music_manager.h"
+#include "memory_budget.h"
 
 namespace fs = std::filesystem;  // Alias for ease of use
 using namespace std;
@@ -40,16 +47,15 @@ using namespace std;
  * Initializes the image and levels to null and zero respectively.
  */
 LevelSubset::LevelSubset()
-  : image(nullptr), levels(0)
+  : levels(0)
 {
 }
 
 /**
- * Destructor for LevelSubset. Deletes the image if it was allocated.
+ * Destructor for LevelSubset.
  */
 LevelSubset::~LevelSubset()
 {
-  delete image;
 }
 
 /**
@@ -117,7 +123,7 @@ void LevelSubset::load(char* subset)
 
   // Construct the filename path using std::filesystem for better safety and clarity
   fs::path filename = fs::path(st_dir) / "levels" / subset / "info";
-  if (!faccessible(filename.string().c_str()))
+  if (!DirIndex::has_file(filename.string()))
   {
     filename = fs::path(datadir) / "levels" / subset / "info";
   }
@@ -129,19 +135,16 @@ void LevelSubset::load(char* subset)
     return;
   }
 
-  if (faccessible(filename.string().c_str()))
+  if (DirIndex::has_file(filename.string()))
   {
-    FILE* fi = fopen(filename.string().c_str(), "r");
-    if (fi == nullptr)
+    // Read through lisp_read_from_file(), which knows the asset archive
+    lisp_object_t* root_obj = lisp_read_from_file(filename.string());
+    if (root_obj == nullptr)
     {
       perror(filename.string().c_str());  // System-generated error message
       return;
     }
 
-    lisp_stream_t stream;
-    lisp_stream_init_file(&stream, fi);
-    lisp_object_t* root_obj = lisp_read(&stream);
-
     if (root_obj->type == LISP_TYPE_EOF || root_obj->type == LISP_TYPE_PARSE_ERROR)
     {
       printf("World: Parse Error in file %s\n", filename.string().c_str());
@@ -160,19 +163,16 @@ void LevelSubset::load(char* subset)
     }
 
     lisp_free(root_obj);
-    fclose(fi);
 
     fs::path image_file = filename.string() + ".png";
-    if (faccessible(image_file.string().c_str()))
+    if (DirIndex::has_file(image_file.string()))
     {
-      delete image;
-      image = new Surface(image_file.string().c_str(), IGNORE_ALPHA);
+      image = surface_manager->load_surface(image_file.string(), IGNORE_ALPHA);
     }
     else
     {
       filename = fs::path(datadir) / "images/status/level-subset-info.png";
-      delete image;
-      image = new Surface(filename.string().c_str(), IGNORE_ALPHA);
+      image = surface_manager->load_surface(filename.string(), IGNORE_ALPHA);
     }
   }
 
@@ -182,10 +182,10 @@ void LevelSubset::load(char* subset)
   {
     // Get the number of levels in this subset
     filename = fs::path(st_dir) / "levels" / subset / ("level" + to_string(i) + ".stl");
-    if (!faccessible(filename.string().c_str()))
+    if (!DirIndex::has_file(filename.string()))
     {
       filename = fs::path(datadir) / "levels" / subset / ("level" + to_string(i) + ".stl");
-      if (!faccessible(filename.string().c_str()))
+      if (!DirIndex::has_file(filename.string()))
       {
         break;
       }
@@ -212,33 +212,51 @@ void LevelSubset::save()
 
   if (fwriteable(filename.string().c_str()))
   {
-    FILE* fi = fopen(filename.string().c_str(), "w");
-    if (fi == nullptr)
-    {
-      perror(filename.string().c_str());
-    }
+    LispWriter writer;
+    writer.write_comment("SuperTux-Level-Subset");
+    writer.start_list("supertux-level-subset");
+    writer.write_string("title", title.c_str());
+    writer.write_string("description", description.c_str());
+    writer.end_list();
+    writer.save(filename.string());
+  }
 
-    // Write header:
-    fprintf(fi, ";SuperTux-Level-Subset\n");
-    fprintf(fi, "(supertux-level-subset\n");
+  // The subset may be new, so its parent has to be read again as well
+  DirIndex::invalidate(filename.parent_path().parent_path().string());
+}
 
-    // Save title info:
-    fprintf(fi, "  (title \"%s\")\n", title.c_str());
+/**
+ * Looks up the flags of every cell of a layer.
+ * @param layer The interactive tiles.
+ * @param flags Receives the flags, laid out like the cells of layer.
+ */
+static void compute_tile_flags(const TileLayer& layer, std::vector<unsigned char>& flags)
+{
+  TileManager& tilemanager = *TileManager::instance();
+  const std::vector<unsigned int>& cells = layer.get_cells();
 
-    // Save the description:
-    fprintf(fi, "  (description \"%s\")\n", description.c_str());
+  flags.assign(cells.size(), 0);
 
-    fprintf(fi, ")");
-    fclose(fi);
+  for (size_t i = 0; i < cells.size(); ++i)
+  {
+    Tile* tile = tilemanager.get(cells[i]);
+    if (tile)
+    {
+      flags[i] = tile->get_flags();
+    }
   }
 }
 
+// Counts the changes of the flags of all levels, so a version is never
+// handed out twice. Levels are also loaded by the LevelPreloader thread.
+static std::atomic<unsigned int> flags_changes(0);
+
 /**
  * Constructs a Level object.
  * Initializes the level by setting default values.
  */
 Level::Level()
-  : img_bkgd(nullptr)
+  : bkgd_strips(nullptr), memory_bytes(0)
 {
   init_defaults();
 }
@@ -249,7 +267,7 @@ Level::Level()
  * @param level The level number to load.
  */
 Level::Level(const std::string& subset, int level)
-  : img_bkgd(nullptr)
+  : bkgd_strips(nullptr), memory_bytes(0)
 {
   if (load(subset, level) < 0)
   {
@@ -262,7 +280,7 @@ Level::Level(const std::string& subset, int level)
  * @param filename The filename of the level to load.
  */
 Level::Level(const std::string& filename)
-  : img_bkgd(nullptr)
+  : bkgd_strips(nullptr), memory_bytes(0)
 {
   if (load(filename) < 0)
   {
@@ -272,11 +290,11 @@ Level::Level(const std::string& filename)
 
 /**
  * Destructor for Level.
- * Cleans up allocated resources by deleting the background image.
  */
 Level::~Level()
 {
-  delete img_bkgd;
+  delete bkgd_strips;
+  MemoryBudget::add(MEM_LEVELS, -memory_bytes);
 }
 
 /**
@@ -306,30 +324,13 @@ void Level::init_defaults()
   bkgd_bottom.green = 255;
   bkgd_bottom.blue = 255;
 
-  for (int i = 0; i < 15; ++i)
-  {
-    ia_tiles[i].resize(width + 1, 0);
-    ia_tiles[i][width] = '\0';
+  // cleanup() emptied the layers, so this leaves them all 0
+  ia_tiles.resize(width + 1);
+  bg_tiles.resize(width + 1);
+  fg_tiles.resize(width + 1);
 
-    for (int y = 0; y < width; ++y)
-    {
-      ia_tiles[i][y] = 0;
-    }
-
-    bg_tiles[i].resize(width + 1, 0);
-    bg_tiles[i][width] = '\0';
-    for (int y = 0; y < width; ++y)
-    {
-      bg_tiles[i][y] = 0;
-    }
-
-    fg_tiles[i].resize(width + 1, 0);
-    fg_tiles[i][width] = '\0';
-    for (int y = 0; y < width; ++y)
-    {
-      fg_tiles[i][y] = 0;
-    }
-  }
+  update_tile_flags();
+  account_memory();
 }
 
 /**
@@ -358,6 +359,14 @@ int Level::load(const std::string& subset, int level)
 int Level::load(const std::string& filename)
 {
   init_defaults();
+  level_file = filename;
+
+  if (LevelCache::load(*this, filename))
+  {
+    update_tile_flags();
+    save_snapshot();
+    return 0;
+  }
 
   lisp_object_t* root_obj = lisp_read_from_file(filename.c_str());
   if (!root_obj)
@@ -476,6 +485,35 @@ int Level::load(const std::string& filename)
       }
     }
 
+    // Read particle emitters
+    cur = nullptr;
+    if (reader.read_lisp("emitters", &cur))
+    {
+      while (!lisp_nil_p(cur))
+      {
+        lisp_object_t* data = lisp_car(cur);
+
+        EmitterData emitter;
+        emitter.kind = emitterkind_from_string(lisp_symbol(lisp_car(data)));
+        LispReader reader(lisp_cdr(data));
+        reader.read_int("x", &emitter.x);
+        reader.read_int("y", &emitter.y);
+        reader.read_int("width", &emitter.width);
+        reader.read_int("height", &emitter.height);
+
+        if (emitter.kind != EMITTER_INVALID)
+        {
+          emitter_data.push_back(emitter);
+        }
+        else
+        {
+          printf("Warning: unknown emitter '%s' in level\n", lisp_symbol(lisp_car(data)));
+        }
+
+        cur = lisp_cdr(cur);
+      }
+    }
+
     // Convert old levels to the new tile numbers
     if (version == 0)
     {
@@ -549,12 +587,9 @@ int Level::load(const std::string& filename)
     }
   }
 
-  for (int i = 0; i < 15; ++i)
-  {
-    ia_tiles[i].resize(width + 1, 0);
-    bg_tiles[i].resize(width + 1, 0);
-    fg_tiles[i].resize(width + 1, 0);
-  }
+  ia_tiles.resize(width + 1);
+  bg_tiles.resize(width + 1);
+  fg_tiles.resize(width + 1);
 
   // Place interactive tiles
   int i = 0;
@@ -569,7 +604,7 @@ int Level::load(const std::string& filename)
       break;
     }
 
-    ia_tiles[j][i] = tile;
+    ia_tiles.set(i, j, tile);
 
     switch (tile)
     {
@@ -616,7 +651,7 @@ int Level::load(const std::string& filename)
       break;
     }
 
-    bg_tiles[j][i] = tile;
+    bg_tiles.set(i, j, tile);
     ++i;
     if (i >= width)
     {
@@ -636,7 +671,7 @@ int Level::load(const std::string& filename)
       break;
     }
 
-    fg_tiles[j][i] = tile;
+    fg_tiles.set(i, j, tile);
     ++i;
     if (i >= width)
     {
@@ -645,10 +680,65 @@ int Level::load(const std::string& filename)
     }
   }
 
+  update_tile_flags();
+
   lisp_free(root_obj);
+
+  LevelCache::save(*this, filename);
+  save_snapshot();
   return 0;
 }
 
+/**
+ * Loads level_file into a new level and moves its map over, the objects
+ * the world created from the old map stay as they are.
+ * @return True if the file was loaded.
+ */
+bool Level::reload()
+{
+  Level fresh;
+  if (level_file.empty() || fresh.load(level_file) < 0)
+  {
+    return false;
+  }
+
+  bg_tiles = std::move(fresh.bg_tiles);
+  ia_tiles = std::move(fresh.ia_tiles);
+  fg_tiles = std::move(fresh.fg_tiles);
+  ia_flags = std::move(fresh.ia_flags);
+  flag_columns = fresh.flag_columns;
+  flags_version = ++flags_changes;
+  width = fresh.width;
+
+  badguy_data = std::move(fresh.badguy_data);
+  reset_points = std::move(fresh.reset_points);
+  original_tiles = std::move(fresh.original_tiles);
+  snapshot = std::move(fresh.snapshot);
+
+  name = fresh.name;
+  author = fresh.author;
+  start_pos_x = fresh.start_pos_x;
+  start_pos_y = fresh.start_pos_y;
+  gravity = fresh.gravity;
+  back_scrolling = fresh.back_scrolling;
+  hor_autoscroll_speed = fresh.hor_autoscroll_speed;
+  bkgd_speed = fresh.bkgd_speed;
+  bkgd_top = fresh.bkgd_top;
+  bkgd_bottom = fresh.bkgd_bottom;
+
+  if (bkgd_image != fresh.bkgd_image)
+  {
+    bkgd_image = fresh.bkgd_image;
+    img_bkgd = SurfaceRef();
+    delete bkgd_strips;
+    bkgd_strips = nullptr;
+    load_gfx();
+  }
+
+  account_memory();
+  return true;
+}
+
 /**
  * Reloads bricks and coins in the level.
  * Resets interactive tiles to their original state.
@@ -657,8 +747,49 @@ void Level::reload_bricks_and_coins()
 {
   for (auto& tile_info : original_tiles)
   {
-    ia_tiles[tile_info.y][tile_info.x] = tile_info.tile;
+    ia_tiles.set(tile_info.x, tile_info.y, tile_info.tile);
   }
+
+  update_tile_flags();
+}
+
+/**
+ * Remembers the mutable state of the level, so a restart can return to it
+ * without reloading or rebuilding anything.
+ */
+void Level::save_snapshot()
+{
+  snapshot.valid = true;
+  snapshot.bg_tiles = bg_tiles;
+  snapshot.ia_tiles = ia_tiles;
+  snapshot.fg_tiles = fg_tiles;
+  snapshot.ia_flags = ia_flags;
+  snapshot.flag_columns = flag_columns;
+  snapshot.badguy_data = badguy_data;
+  snapshot.reset_points = reset_points;
+  account_memory();
+}
+
+/**
+ * Returns the level to its last snapshot. The buffers already have the
+ * right size, so this comes down to copying memory.
+ */
+void Level::restore_snapshot()
+{
+  if (!snapshot.valid)
+  {
+    reload_bricks_and_coins();
+    return;
+  }
+
+  bg_tiles = snapshot.bg_tiles;
+  ia_tiles = snapshot.ia_tiles;
+  fg_tiles = snapshot.fg_tiles;
+  ia_flags = snapshot.ia_flags;
+  flag_columns = snapshot.flag_columns;
+  flags_version = ++flags_changes;
+  badguy_data = snapshot.badguy_data;
+  reset_points = snapshot.reset_points;
 }
 
 /**
@@ -676,100 +807,95 @@ void Level::save(const std::string& subset, int level)
     filename = fs::path(datadir) / "levels" / subset / ("level" + to_string(level) + ".stl");
   }
 
-  FILE* fi = fopen(filename.string().c_str(), "w");
-  if (fi == nullptr)
+  // Streamed layers read their cells from the cache that goes away now
+  bg_tiles.make_resident();
+  fg_tiles.make_resident();
+  LevelCache::remove(filename.string());
+
+  LispWriter writer;
+  writer.write_comment("SuperTux-Level");
+  writer.start_list("supertux-level");
+
+  writer.write_int("version", 1);
+  writer.write_string("name", name.c_str());
+  writer.write_string("author", author.c_str());
+  writer.write_string("music", song_title.c_str());
+  writer.write_string("background", bkgd_image.c_str());
+  writer.write_string("particle_system", particle_system.c_str());
+  writer.write_int("bkgd_speed", bkgd_speed);
+  writer.write_int("bkgd_red_top", bkgd_top.red);
+  writer.write_int("bkgd_green_top", bkgd_top.green);
+  writer.write_int("bkgd_blue_top", bkgd_top.blue);
+  writer.write_int("bkgd_red_bottom", bkgd_bottom.red);
+  writer.write_int("bkgd_green_bottom", bkgd_bottom.green);
+  writer.write_int("bkgd_blue_bottom", bkgd_bottom.blue);
+  writer.write_int("time", time_left);
+  writer.write_int("width", width);
+  writer.write_boolean("back_scrolling", back_scrolling);
+  writer.write_float("hor_autoscroll_speed", hor_autoscroll_speed);
+  writer.write_float("gravity", gravity);
+
+  // The files list the tiles row by row, one row per line
+  const char* const layer_names[] = { "background-tm", "interactive-tm", "foreground-tm" };
+  const TileLayer* layers[] = { &bg_tiles, &ia_tiles, &fg_tiles };
+  for (int layer = 0; layer < 3; ++layer)
   {
-    perror(filename.string().c_str());
-    st_shutdown();
-    exit(-1);
-  }
-
-  // Write header:
-  fprintf(fi, ";SuperTux-Level\n");
-  fprintf(fi, "(supertux-level\n");
-
-  fprintf(fi, "  (version %d)\n", 1);
-  fprintf(fi, "  (name \"%s\")\n", name.c_str());
-  fprintf(fi, "  (author \"%s\")\n", author.c_str());
-  fprintf(fi, "  (music \"%s\")\n", song_title.c_str());
-  fprintf(fi, "  (background \"%s\")\n", bkgd_image.c_str());
-  fprintf(fi, "  (particle_system \"%s\")\n", particle_system.c_str());
-  fprintf(fi, "  (bkgd_speed %d)\n", bkgd_speed);
-  fprintf(fi, "  (bkgd_red_top %d)\n", bkgd_top.red);
-  fprintf(fi, "  (bkgd_green_top %d)\n", bkgd_top.green);
-  fprintf(fi, "  (bkgd_blue_top %d)\n", bkgd_top.blue);
-  fprintf(fi, "  (bkgd_red_bottom %d)\n", bkgd_bottom.red);
-  fprintf(fi, "  (bkgd_green_bottom %d)\n", bkgd_bottom.green);
-  fprintf(fi, "  (bkgd_blue_bottom %d)\n", bkgd_bottom.blue);
-  fprintf(fi, "  (time %d)\n", time_left);
-  fprintf(fi, "  (width %d)\n", width);
-  if (back_scrolling)
-  {
-    fprintf(fi, "  (back_scrolling #t)\n");
-  }
-  else
-  {
-    fprintf(fi, "  (back_scrolling #f)\n");
-  }
-  fprintf(fi, "  (hor_autoscroll_speed %2.1f)\n", hor_autoscroll_speed);
-  fprintf(fi, "  (gravity %2.1f)\n", gravity);
-  fprintf(fi, "  (background-tm ");
-
-  for (int y = 0; y < 15; ++y)
-  {
-    for (int i = 0; i < width; ++i)
+    writer.start_list(layer_names[layer]);
+    for (int y = 0; y < 15; ++y)
     {
-      fprintf(fi, " %d ", bg_tiles[y][i]);
+      writer.new_line();
+      for (int i = 0; i < width; ++i)
+      {
+        writer.write_value(layers[layer]->get(i, y));
+      }
     }
+    writer.end_list();
   }
 
-  fprintf(fi, ")\n");
-  fprintf(fi, "  (interactive-tm ");
-
-  for (int y = 0; y < 15; ++y)
+  writer.start_list("reset-points");
+  for (auto& reset_point : reset_points)
   {
-    for (int i = 0; i < width; ++i)
-    {
-      fprintf(fi, " %d ", ia_tiles[y][i]);
-    }
+    writer.start_list("point");
+    writer.write_int("x", reset_point.x);
+    writer.write_int("y", reset_point.y);
+    writer.end_list();
   }
+  writer.end_list();
 
-  fprintf(fi, ")\n");
-  fprintf(fi, "  (foreground-tm ");
-
-  for (int y = 0; y < 15; ++y)
+  writer.start_list("objects");
+  for (auto& badguy : badguy_data)
   {
-    for (int i = 0; i < width; ++i)
-    {
-      fprintf(fi, " %d ", fg_tiles[y][i]);
-    }
+    writer.start_list(badguykind_to_string(badguy.kind).c_str());
+    writer.write_int("x", badguy.x);
+    writer.write_int("y", badguy.y);
+    writer.write_boolean("stay-on-platform", badguy.stay_on_platform);
+    writer.end_list();
   }
+  writer.end_list();
 
-  fprintf(fi, ")\n");
-
-  fprintf(fi, "(reset-points\n");
-  for (auto& reset_point : reset_points)
+  if (!emitter_data.empty())
   {
-    fprintf(fi, "(point (x %d) (y %d))\n", reset_point.x, reset_point.y);
+    writer.start_list("emitters");
+    for (auto& emitter : emitter_data)
+    {
+      writer.start_list(emitterkind_to_string(emitter.kind).c_str());
+      writer.write_int("x", emitter.x);
+      writer.write_int("y", emitter.y);
+      writer.write_int("width", emitter.width);
+      writer.write_int("height", emitter.height);
+      writer.end_list();
+    }
+    writer.end_list();
   }
-  fprintf(fi, ")\n");
 
-  fprintf(fi, "(objects\n");
+  writer.end_list();
 
-  for (auto& badguy : badguy_data)
+  if (!writer.save(filename.string()))
   {
-    fprintf(fi, "(%s (x %d) (y %d) (stay-on-platform %s))\n",
-      badguykind_to_string(badguy.kind).c_str(),
-      badguy.x,
-      badguy.y,
-      badguy.stay_on_platform ? "#t" : "#f");
+    st_shutdown();
+    exit(-1);
   }
-
-  fprintf(fi, ")\n");
-
-  fprintf(fi, ")\n");
-
-  fclose(fi);
+  DirIndex::invalidate(filename.parent_path().string());
 }
 
 /**
@@ -778,12 +904,15 @@ void Level::save(const std::string& subset, int level)
  */
 void Level::cleanup()
 {
-  for (int i = 0; i < 15; ++i)
-  {
-    bg_tiles[i].clear();
-    ia_tiles[i].clear();
-    fg_tiles[i].clear();
-  }
+  bg_tiles.clear();
+  ia_tiles.clear();
+  fg_tiles.clear();
+
+  ia_flags.clear();
+  flag_columns = 0;
+  flags_version = ++flags_changes;
+
+  snapshot.valid = false;
 
   original_tiles.clear();
   reset_points.clear();
@@ -792,6 +921,8 @@ void Level::cleanup()
   song_title = "";
   bkgd_image = "";
   badguy_data.clear();
+  emitter_data.clear();
+  account_memory();
 }
 
 /**
@@ -802,21 +933,115 @@ void Level::load_gfx()
 {
   if (!bkgd_image.empty())
   {
-    fs::path fname = fs::path(st_dir) / "background" / bkgd_image;
-    if (!faccessible(fname.string().c_str()))
+    if (!img_bkgd && !bkgd_strips)
     {
-      fname = fs::path(datadir) / "images/background" / bkgd_image;
-    }
-    if (!img_bkgd)
-    {
-      img_bkgd = new Surface(fname.string().c_str(), IGNORE_ALPHA);
+      std::string filename = get_bkgd_filename();
+      img_bkgd = surface_manager->find_surface(filename, IGNORE_ALPHA);
+      if (!img_bkgd)
+      {
+        SDL_Surface* image = ImageLoader::load(filename);
+        if (image == nullptr)
+        {
+          st_abort("Can't load", filename);
+        }
+        set_bkgd_surface(image);
+      }
     }
   }
   else
   {
-    delete img_bkgd;
-    img_bkgd = nullptr;
+    img_bkgd = SurfaceRef();
+    delete bkgd_strips;
+    bkgd_strips = nullptr;
+    load_gradient();
+  }
+}
+
+/**
+ * Gets the image of the background gradient in software mode, the other
+ * modes draw gradients in one go anyway.
+ */
+void Level::load_gradient()
+{
+  bkgd_gradient = SurfaceRef();
+  if (use_gl || use_gx)
+  {
+    return;
+  }
+
+  char key[64];
+  snprintf(key, sizeof(key), "gradient:%d,%d,%d:%d,%d,%d", bkgd_top.red, bkgd_top.green, bkgd_top.blue,
+           bkgd_bottom.red, bkgd_bottom.green, bkgd_bottom.blue);
+  bkgd_gradient = surface_manager->find_surface(key, IGNORE_ALPHA);
+  if (!bkgd_gradient)
+  {
+    bkgd_gradient = surface_manager->add_surface(key, create_gradient_surface(bkgd_top, bkgd_bottom), IGNORE_ALPHA);
+  }
+  gradient_top = bkgd_top;
+  gradient_bottom = bkgd_bottom;
+}
+
+/**
+ * Draws the background gradient, from the image of load_gradient() in
+ * software mode. The image is replaced if the colours were changed.
+ */
+void Level::draw_gradient()
+{
+  if (use_gl || use_gx)
+  {
+    drawgradient(bkgd_top, bkgd_bottom);
+    return;
+  }
+
+  if (!bkgd_gradient ||
+      gradient_top.red != bkgd_top.red || gradient_top.green != bkgd_top.green ||
+      gradient_top.blue != bkgd_top.blue || gradient_bottom.red != bkgd_bottom.red ||
+      gradient_bottom.green != bkgd_bottom.green || gradient_bottom.blue != bkgd_bottom.blue)
+  {
+    load_gradient();
+  }
+  bkgd_gradient->draw(0, 0);
+}
+
+/**
+ * Sets up the background from a decoded image. Images wider than the
+ * screen are drawn from strips, which are only converted while in view.
+ * @param image The decoded image, owned by the level from now on.
+ */
+void Level::set_bkgd_surface(SDL_Surface* image)
+{
+  img_bkgd = SurfaceRef();
+  delete bkgd_strips;
+  bkgd_strips = nullptr;
+
+  if (image->w > screen->w)
+  {
+    bkgd_strips = new BackgroundStrips(image);
+  }
+  else
+  {
+    img_bkgd = surface_manager->add_surface(get_bkgd_filename(), image, IGNORE_ALPHA);
+  }
+}
+
+/**
+ * Finds the file of the level's background image, a custom background
+ * below st_dir takes precedence over the data directory.
+ * @return The path of the image, or an empty string if there is none.
+ */
+std::string Level::get_bkgd_filename() const
+{
+  if (bkgd_image.empty())
+  {
+    return std::string();
+  }
+
+  fs::path fname = fs::path(st_dir) / "background" / bkgd_image;
+  if (!faccessible(fname.string().c_str()))
+  {
+    fname = fs::path(datadir) / "images/background" / bkgd_image;
   }
+  return fname.string();
 }
 
 /**
@@ -837,6 +1062,22 @@ void Level::load_image(Surface** ptexture, string theme, const char* file, int u
   *ptexture = new Surface(fname.string().c_str(), use_alpha);
 }
 
+/**
+ * Lets the streamed layers drop the columns that are far from the camera.
+ * @param scroll_x The horizontal scroll position in pixels.
+ * @param visible_columns The number of columns on the screen.
+ */
+void Level::stream_around(float scroll_x, int visible_columns)
+{
+  int first = static_cast<int>(scroll_x) / 32;
+  bool dropped = bg_tiles.trim(first, first + visible_columns);
+  dropped = fg_tiles.trim(first, first + visible_columns) || dropped;
+  if (dropped)
+  {
+    account_memory();
+  }
+}
+
 /**
  * Changes the size (width) of the level.
  * @param new_width The new width of the level
@@ -849,14 +1090,33 @@ void Level::change_size(int new_width)
     new_width = 21;
   }
 
-  for (int y = 0; y < 15; ++y)
+  ia_tiles.resize(new_width + 1);
+  bg_tiles.resize(new_width + 1);
+  fg_tiles.resize(new_width + 1);
+
+  width = new_width;
+  update_tile_flags();
+  account_memory();
+}
+
+/**
+ * Recomputes the memory held by the tilemaps, badguys and the snapshot
+ * and reports the difference to MemoryBudget.
+ */
+void Level::account_memory()
+{
+  long bytes = 0;
+  const TileLayer* layers[] = {&bg_tiles, &ia_tiles, &fg_tiles,
+                               &snapshot.bg_tiles, &snapshot.ia_tiles, &snapshot.fg_tiles};
+  for (const TileLayer* layer : layers)
   {
-    ia_tiles[y].resize(new_width, 0);
-    bg_tiles[y].resize(new_width, 0);
-    fg_tiles[y].resize(new_width, 0);
+    bytes += layer->memory_bytes();
   }
+  bytes += ia_flags.capacity() + snapshot.ia_flags.capacity();
+  bytes += (badguy_data.capacity() + snapshot.badguy_data.capacity()) * sizeof(BadGuyData);
 
-  width = new_width;
+  MemoryBudget::add(MEM_LEVELS, bytes - memory_bytes);
+  memory_bytes = bytes;
 }
 
 /**
@@ -876,37 +1136,64 @@ void Level::change(float x, float y, int tm, unsigned int c)
     switch (tm)
     {
       case TM_BG:
-        bg_tiles[yy][xx] = c;
+        bg_tiles.set(xx, yy, c);
         break;
       case TM_IA:
-        ia_tiles[yy][xx] = c;
+        ia_tiles.set(xx, yy, c);
+        if (xx < flag_columns)
+        {
+          Tile* tile = TileManager::instance()->get(c);
+          ia_flags[xx * TileLayer::ROWS + yy] = tile ? tile->get_flags() : 0;
+          flags_version = ++flags_changes;
+        }
         break;
       case TM_FG:
-        fg_tiles[yy][xx] = c;
+        fg_tiles.set(xx, yy, c);
         break;
     }
   }
 }
 
+/**
+ * Rebuilds the flags of all interactive tiles from the tile manager.
+ * The flags are laid out like the cells of ia_tiles.
+ */
+void Level::update_tile_flags()
+{
+  flag_columns = ia_tiles.get_columns();
+  compute_tile_flags(ia_tiles, ia_flags);
+  flags_version = ++flags_changes;
+}
+
+/**
+ * Rebuilds the flags of the interactive tiles and of the snapshot, the
+ * tiles themselves stay as they are.
+ */
+void Level::refresh_tile_flags()
+{
+  update_tile_flags();
+  if (snapshot.valid)
+  {
+    compute_tile_flags(snapshot.ia_tiles, snapshot.ia_flags);
+  }
+}
+
 /**
  * Loads the level's background music.
- * Loads the standard and fast versions of the level's music based on the current level attributes.
+ * Only the standard version is loaded, the fast version waits until it
+ * is played and can be read ahead with prefetch_song_fast().
  */
 void Level::load_song()
 {
-  std::string song_path;
   std::string song_subtitle = song_title.substr(0, song_title.find_last_of('.'));
 
   level_song = music_manager->load_music(datadir + "/music/" + song_title);
+  level_song_fast = MusicRef();
 
-  song_path = datadir + "/music/" + song_subtitle + "-fast" + song_title.substr(song_title.find_last_of('.'));
-  if (!music_manager->exists_music(song_path))
+  song_fast_path = datadir + "/music/" + song_subtitle + "-fast" + song_title.substr(song_title.find_last_of('.'));
+  if (!faccessible(song_fast_path.c_str()))
   {
-    level_song_fast = level_song;
-  }
-  else
-  {
-    level_song_fast = music_manager->load_music(song_path);
+    song_fast_path.clear();
   }
 }
 
@@ -918,6 +1205,7 @@ void Level::free_song()
 {
   level_song = level_end_song;
   level_song_fast = level_end_song;
+  song_fast_path.clear();
 }
 
 /**
@@ -930,12 +1218,28 @@ MusicRef Level::get_level_music() const
 }
 
 /**
- * Gets the fast version of the level music.
- * @return A reference to the fast version of the level music.
+ * Gets the fast version of the level music, loading it if needed.
+ * @return A reference to the fast version of the level music, or the
+ *         standard version if the level has no fast one.
+ */
+MusicRef Level::get_level_music_fast()
+{
+  if (!level_song_fast && !song_fast_path.empty() && music_manager->exists_music(song_fast_path))
+  {
+    level_song_fast = music_manager->load_music(song_fast_path);
+  }
+  return level_song_fast ? level_song_fast : level_song;
+}
+
+/**
+ * Reads the fast version of the level music into memory in the background.
  */
-MusicRef Level::get_level_music_fast() const
+void Level::prefetch_song_fast()
 {
-  return level_song_fast;
+  if (!level_song_fast && !song_fast_path.empty())
+  {
+    music_manager->prefetch_music(song_fast_path);
+  }
 }
 
 /**
@@ -949,14 +1253,7 @@ unsigned int Level::gettileid(float x, float y) const
   int xx = static_cast<int>(x) / 32;
   int yy = static_cast<int>(y) / 32;
 
-  if (yy >= 0 && yy < 15 && xx >= 0 && xx <= width)
-  {
-    return ia_tiles[yy][xx];
-  }
-  else
-  {
-    return 0;
-  }
+  return get_tile_at(xx, yy);
 }
 
 /**
@@ -967,12 +1264,7 @@ unsigned int Level::gettileid(float x, float y) const
  */
 unsigned int Level::get_tile_at(int x, int y) const
 {
-  if (x < 0 || x > width || y < 0 || y > 14)
-  {
-    return 0;
-  }
-
-  return ia_tiles[y][x];
+  return ia_tiles.get(x, y);
 }
 
 // EOF
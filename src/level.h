@@ -24,8 +24,11 @@
 #include <string>
 #include "texture.h"
 #include "badguy.h"
+#include "particle_emitters.h"
 #include "lispreader.h"
 #include "musicref.h"
+#include "surfaceref.h"
+#include "tile_layer.h"
 
 class Tile;
 
@@ -44,7 +47,7 @@ class LevelSubset
     std::string name;        /**< The name of the subset */
     std::string title;       /**< The title of the subset */
     std::string description; /**< The description of the subset */
-    Surface* image;          /**< The image associated with the subset */
+    SurfaceRef image;        /**< The image associated with the subset */
     int levels;              /**< The number of levels in the subset */
 
   private:
@@ -74,21 +77,27 @@ struct OriginalTileInfo
   int tile;
 };
 
+class BackgroundStrips;
+
 class Level 
 {
  public:
-  Surface* img_bkgd;                      /**< The background image of the level */
+  SurfaceRef img_bkgd;                    /**< The background image of the level */
+  BackgroundStrips* bkgd_strips;          /**< Used instead of img_bkgd for backgrounds wider than the screen */
+  SurfaceRef bkgd_gradient;               /**< The gradient rendered once, for software mode */
   MusicRef level_song;                    /**< The music for the level */
-  MusicRef level_song_fast;               /**< The fast version of the level's music */
+  MusicRef level_song_fast;               /**< The fast version of the level's music, loaded on first use */
+  std::string song_fast_path;             /**< The file of the fast version, empty if there is none */
 
   std::string name;                       /**< The name of the level */
+  std::string level_file;                 /**< The file the level was loaded from */
   std::string author;                     /**< The author of the level */
   std::string song_title;                 /**< The title of the level's song */
   std::string bkgd_image;                 /**< The background image name */
   std::string particle_system;            /**< The particle system used in the level */
-  std::vector<unsigned int> bg_tiles[15]; /**< Tiles in the background */
-  std::vector<unsigned int> ia_tiles[15]; /**< Tiles which can interact in the game (solids, etc.) */
-  std::vector<unsigned int> fg_tiles[15]; /**< Tiles in the foreground */
+  TileLayer bg_tiles;                     /**< Tiles in the background */
+  TileLayer ia_tiles;                     /**< Tiles which can interact in the game (solids, etc.) */
+  TileLayer fg_tiles;                     /**< Tiles in the foreground */
   int time_left;                          /**< The time left in the level */
   Color bkgd_top;
   Color bkgd_bottom;
@@ -102,12 +111,46 @@ class Level
 
   std::vector<BadGuyData> badguy_data;
 
+  /** Particle emitters placed in the level, e.g. waterfalls */
+  std::vector<EmitterData> emitter_data;
+
   /** A collection of points to which Tux can be reset after a lost live */
   std::vector<ResetPoint> reset_points;  /**< Collection of reset points */
 
   // collection of original brick/coin/bonus block tile positions
   std::vector<OriginalTileInfo> original_tiles;
 
+ private:
+  /** TileFlags of the interactive tiles, laid out like ia_tiles */
+  std::vector<unsigned char> ia_flags;
+  int flag_columns;
+
+  /** Changes whenever ia_flags does, see get_flags_version() */
+  unsigned int flags_version = 0;
+
+  /** The state a restart returns to, see save_snapshot() */
+  struct Snapshot
+  {
+    bool valid;
+    TileLayer bg_tiles;
+    TileLayer ia_tiles;
+    TileLayer fg_tiles;
+    std::vector<unsigned char> ia_flags;
+    int flag_columns;
+    std::vector<BadGuyData> badguy_data;
+    std::vector<ResetPoint> reset_points;
+  };
+  Snapshot snapshot;
+
+  /** The bytes reported to MemoryBudget, see account_memory() */
+  long memory_bytes;
+  void account_memory();
+
+  /** The colours bkgd_gradient was rendered with */
+  Color gradient_top;
+  Color gradient_bottom;
+  void load_gradient();
+
  public:
   Level();
   Level(const std::string& subset, int level);
@@ -130,15 +173,46 @@ class Level
 
   void reload_bricks_and_coins();
 
+  /** Remember the tilemaps, badguys and reset points as they are now,
+      done at the end of load() */
+  void save_snapshot();
+
+  /** Return the tilemaps, badguys and reset points to the last snapshot,
+      falls back to reload_bricks_and_coins() if there is none */
+  void restore_snapshot();
+
+  /** Read level_file again and take over its tilemaps, badguys and looks,
+      for editing a level while it is played. Returns false and keeps the
+      level as it is if the file can't be loaded. */
+  bool reload();
+
   void load_gfx();
 
+  /** Draw the background gradient, levels sharing colours share the
+      image that software mode draws it from */
+  void draw_gradient();
+
+  /** Path of the background image, empty if the level has none */
+  std::string get_bkgd_filename() const;
+
+  /** Use a decoded background image, takes ownership of image */
+  void set_bkgd_surface(SDL_Surface* image);
+
   void load_song();
   void free_song();
   MusicRef get_level_music() const;
-  MusicRef get_level_music_fast() const;
+  MusicRef get_level_music_fast();
+
+  /** Start reading the fast version of the music, some time before it
+      is needed */
+  void prefetch_song_fast();
 
   void save(const std::string& subset, int level);
 
+  /** Keep only the background and foreground columns near the camera
+      in memory, for levels whose layers are streamed from the cache */
+  void stream_around(float scroll_x, int visible_columns);
+
   /** Edit a piece of the map! */
   void change(float x, float y, int tm, unsigned int c);
 
@@ -153,6 +227,35 @@ class Level
    */
   unsigned int get_tile_at(int x, int y) const;
 
+  /** Recompute the flags of all interactive tiles, needed whenever
+      ia_tiles is modified without going through change() */
+  void update_tile_flags();
+
+  /** Recompute the flags of all interactive tiles and of the snapshot,
+      needed after the tileset was reloaded */
+  void refresh_tile_flags();
+
+  /** A number that changes whenever any of the TileFlags do, and that no
+      other level uses, so copies of them know when to refresh */
+  unsigned int get_flags_version() const { return flags_version; }
+
+  /** Return the TileFlags of the interactive tile at position x/y */
+  unsigned char gettileflags(float x, float y) const
+  {
+    return get_tile_flags(static_cast<int>(x) / 32, static_cast<int>(y) / 32);
+  }
+
+  /** Return the TileFlags of the interactive tile at x,y (these are
+      logical and not pixel coordinates) */
+  unsigned char get_tile_flags(int x, int y) const
+  {
+    if (x < 0 || x >= flag_columns || y < 0 || y >= TileLayer::ROWS)
+    {
+      return 0;
+    }
+    return ia_flags[x * TileLayer::ROWS + y];
+  }
+
   void load_image(Surface** ptexture, std::string theme, const char* file, int use_alpha);
 };
 
@@ -0,0 +1,536 @@
+//  level_cache.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include <filesystem>
+#include "level_cache.h"
+#include "asset_archive.h"
+#include "level.h"
+#include "globals.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Bump whenever the layout of the payload changes
+const uint32_t FORMAT_VERSION = 4;
+
+// Background and foreground layers at least this wide are streamed from
+// the cache file instead of being read at once
+const int STREAM_COLUMNS = 4 * TileLayer::PAGE_COLUMNS;
+
+struct Header
+{
+  char magic[4];           // "STLC"
+  uint32_t version;        // FORMAT_VERSION
+  uint64_t source_size;    // size of the .stl file
+  int64_t source_mtime;    // modification time of the .stl file
+  uint32_t payload_size;   // bytes following the header
+  uint32_t tiles_offset;   // where the tilemaps start, they come last
+};
+
+/** Appends values to the payload of a cache file */
+class Writer
+{
+public:
+  std::vector<char> data;
+
+  void write(const void* src, size_t size)
+  {
+    const char* bytes = static_cast<const char*>(src);
+    data.insert(data.end(), bytes, bytes + size);
+  }
+
+  void write_int(int value)
+  {
+    int32_t v = value;
+    write(&v, sizeof(v));
+  }
+
+  void write_float(float value)
+  {
+    write(&value, sizeof(value));
+  }
+
+  void write_string(const std::string& str)
+  {
+    write_int(str.size());
+    write(str.data(), str.size());
+  }
+
+  void write_tiles(const TileLayer& layer)
+  {
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "tile ids are stored as 32 bit");
+
+    write_int(layer.get_columns());
+    if (!layer.is_streamed())
+    {
+      const std::vector<unsigned int>& cells = layer.get_cells();
+      write(cells.data(), cells.size() * sizeof(uint32_t));
+      return;
+    }
+
+    for (int x = 0; x < layer.get_columns(); ++x)
+    {
+      write(layer.get_column(x), TileLayer::ROWS * sizeof(uint32_t));
+    }
+  }
+};
+
+/** Reads values back from the payload of a cache file, stops at the end
+    of the data instead of reading past it */
+class Reader
+{
+public:
+  const char* pos;
+  const char* end;
+  bool ok;
+
+  Reader(const char* data, size_t size)
+    : pos(data), end(data + size), ok(true)
+  {
+  }
+
+  bool read(void* dest, size_t size)
+  {
+    if (!ok || size_t(end - pos) < size)
+    {
+      ok = false;
+      return false;
+    }
+    memcpy(dest, pos, size);
+    pos += size;
+    return true;
+  }
+
+  int read_int()
+  {
+    int32_t v = 0;
+    read(&v, sizeof(v));
+    return v;
+  }
+
+  float read_float()
+  {
+    float v = 0;
+    read(&v, sizeof(v));
+    return v;
+  }
+
+  std::string read_string()
+  {
+    int size = read_int();
+    if (!ok || size < 0 || end - pos < size)
+    {
+      ok = false;
+      return std::string();
+    }
+    std::string str(pos, size);
+    pos += size;
+    return str;
+  }
+
+  int read_count(size_t element_size)
+  {
+    int count = read_int();
+    if (!ok || count < 0 || size_t(end - pos) / element_size < size_t(count))
+    {
+      ok = false;
+      return 0;
+    }
+    return count;
+  }
+};
+
+/**
+ * Computes where the cache of a level is kept.
+ * @param filename The .stl file of the level.
+ * @return The path of the cache file.
+ */
+fs::path cache_path(const std::string& filename)
+{
+  // FNV-1a, the full name is stored in the file to rule out collisions
+  uint32_t hash = 2166136261u;
+  for (char c : filename)
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), "%08x.stlc", hash);
+  return fs::path(st_dir) / "cache" / "levels" / name;
+}
+
+/**
+ * Fills in the header fields describing the current state of a level file.
+ * @param filename The .stl file of the level.
+ * @param header Receives the size and modification time.
+ * @return False if the level file can't be examined.
+ */
+bool get_source_info(const std::string& filename, Header* header)
+{
+  memcpy(header->magic, "STLC", 4);
+  header->version = FORMAT_VERSION;
+  header->payload_size = 0;
+  header->tiles_offset = 0;
+
+  // Levels in the asset archive count as changed whenever the archive is
+  uint64_t packed_size;
+  int64_t packed_mtime;
+  if (AssetArchive::get_info(filename, &packed_size, &packed_mtime))
+  {
+    header->source_size = packed_size;
+    header->source_mtime = packed_mtime;
+    return true;
+  }
+
+  std::error_code ec;
+  uintmax_t size = fs::file_size(filename, ec);
+  if (ec)
+  {
+    return false;
+  }
+  fs::file_time_type mtime = fs::last_write_time(filename, ec);
+  if (ec)
+  {
+    return false;
+  }
+
+  header->source_size = size;
+  header->source_mtime = mtime.time_since_epoch().count();
+  return true;
+}
+
+/**
+ * Reads one tilemap of a cache file, or lets it stream from the file if
+ * it is wide enough and may be streamed.
+ * @param file The cache file, positioned at the layer.
+ * @param path The path of the cache file.
+ * @param stamp The header of the cache file.
+ * @param end The size of the cache file.
+ * @param may_stream Whether the layer can be streamed.
+ * @param layer Receives the cells.
+ * @return False if the file is broken.
+ */
+bool read_tiles(FILE* file, const std::string& path, const std::string& stamp, long end,
+                bool may_stream, TileLayer* layer)
+{
+  int32_t columns;
+  if (fread(&columns, sizeof(columns), 1, file) != 1 || columns < 0)
+  {
+    return false;
+  }
+
+  long offset = ftell(file);
+  long size = static_cast<long>(columns) * TileLayer::ROWS * sizeof(uint32_t);
+  if (offset < 0 || end - offset < size)
+  {
+    return false;
+  }
+
+  if (may_stream && columns >= STREAM_COLUMNS)
+  {
+    layer->stream(path, offset, columns, stamp);
+    return fseek(file, size, SEEK_CUR) == 0;
+  }
+
+  layer->resize(columns);
+  std::vector<unsigned int>& cells = layer->get_cells();
+  return fread(cells.data(), sizeof(uint32_t), cells.size(), file) == cells.size();
+}
+
+} // namespace
+
+/**
+ * Loads a level from its cache file, if it matches the level file.
+ * @param level The level to fill, expected to hold the defaults.
+ * @param filename The .stl file of the level.
+ * @return True if the level was loaded, false if it has to be parsed.
+ */
+bool LevelCache::load(Level& level, const std::string& filename)
+{
+  Header expected;
+  if (!get_source_info(filename, &expected))
+  {
+    return false;
+  }
+
+  std::string path = cache_path(filename).string();
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  Header header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               memcmp(header.magic, expected.magic, 4) == 0 &&
+               header.version == expected.version &&
+               header.source_size == expected.source_size &&
+               header.source_mtime == expected.source_mtime &&
+               header.tiles_offset >= sizeof(header) &&
+               header.tiles_offset - sizeof(header) <= header.payload_size;
+
+  // Everything but the tilemaps, which are read by themselves below
+  std::vector<char> payload;
+  if (valid)
+  {
+    payload.resize(header.tiles_offset - sizeof(header));
+    valid = fread(payload.data(), 1, payload.size(), file) == payload.size();
+  }
+
+  if (!valid)
+  {
+    fclose(file);
+    return false;
+  }
+
+  Reader in(payload.data(), payload.size());
+  if (in.read_string() != filename || !in.ok)
+  {
+    fclose(file);
+    return false;
+  }
+
+  Level result;
+  result.name = in.read_string();
+  result.author = in.read_string();
+  result.song_title = in.read_string();
+  result.bkgd_image = in.read_string();
+  result.particle_system = in.read_string();
+  result.width = in.read_int();
+  result.start_pos_x = in.read_int();
+  result.start_pos_y = in.read_int();
+  result.time_left = in.read_int();
+  result.bkgd_speed = in.read_int();
+  result.back_scrolling = in.read_int() != 0;
+  result.bkgd_top.red = in.read_int();
+  result.bkgd_top.green = in.read_int();
+  result.bkgd_top.blue = in.read_int();
+  result.bkgd_bottom.red = in.read_int();
+  result.bkgd_bottom.green = in.read_int();
+  result.bkgd_bottom.blue = in.read_int();
+  result.hor_autoscroll_speed = in.read_float();
+  result.gravity = in.read_float();
+
+  int count = in.read_count(2 * sizeof(int32_t));
+  for (int i = 0; i < count; ++i)
+  {
+    ResetPoint point;
+    point.x = in.read_int();
+    point.y = in.read_int();
+    result.reset_points.push_back(point);
+  }
+
+  count = in.read_count(4 * sizeof(int32_t));
+  for (int i = 0; i < count; ++i)
+  {
+    BadGuyData data;
+    data.kind = static_cast<BadGuyKind>(in.read_int());
+    data.x = in.read_int();
+    data.y = in.read_int();
+    data.stay_on_platform = in.read_int() != 0;
+    result.badguy_data.push_back(data);
+  }
+
+  count = in.read_count(5 * sizeof(int32_t));
+  for (int i = 0; i < count; ++i)
+  {
+    EmitterData data;
+    data.kind = static_cast<EmitterKind>(in.read_int());
+    data.x = in.read_int();
+    data.y = in.read_int();
+    data.width = in.read_int();
+    data.height = in.read_int();
+    result.emitter_data.push_back(data);
+  }
+
+  count = in.read_count(3 * sizeof(int32_t));
+  for (int i = 0; i < count; ++i)
+  {
+    OriginalTileInfo info;
+    info.x = in.read_int();
+    info.y = in.read_int();
+    info.tile = in.read_int();
+    result.original_tiles.push_back(info);
+  }
+
+  // The interactive tiles are needed all over the level, only the
+  // background and foreground are streamed
+  long end = sizeof(header) + static_cast<long>(header.payload_size);
+  std::string stamp(reinterpret_cast<const char*>(&header), sizeof(header));
+  valid = in.ok && in.pos == in.end && result.width >= 1 &&
+          read_tiles(file, path, stamp, end, true, &result.bg_tiles) &&
+          read_tiles(file, path, stamp, end, false, &result.ia_tiles) &&
+          read_tiles(file, path, stamp, end, true, &result.fg_tiles) &&
+          ftell(file) == end && fgetc(file) == EOF;
+  fclose(file);
+
+  if (!valid)
+  {
+    return false;
+  }
+
+  level.name = result.name;
+  level.author = result.author;
+  level.song_title = result.song_title;
+  level.bkgd_image = result.bkgd_image;
+  level.particle_system = result.particle_system;
+  level.width = result.width;
+  level.start_pos_x = result.start_pos_x;
+  level.start_pos_y = result.start_pos_y;
+  level.time_left = result.time_left;
+  level.bkgd_speed = result.bkgd_speed;
+  level.back_scrolling = result.back_scrolling;
+  level.bkgd_top = result.bkgd_top;
+  level.bkgd_bottom = result.bkgd_bottom;
+  level.hor_autoscroll_speed = result.hor_autoscroll_speed;
+  level.gravity = result.gravity;
+  std::swap(level.bg_tiles, result.bg_tiles);
+  std::swap(level.ia_tiles, result.ia_tiles);
+  std::swap(level.fg_tiles, result.fg_tiles);
+  level.reset_points.swap(result.reset_points);
+  level.badguy_data.swap(result.badguy_data);
+  level.emitter_data.swap(result.emitter_data);
+  level.original_tiles.swap(result.original_tiles);
+
+  return true;
+}
+
+/**
+ * Writes the cache file of a level that was just parsed.
+ * @param level The loaded level.
+ * @param filename The .stl file the level was loaded from.
+ */
+void LevelCache::save(const Level& level, const std::string& filename)
+{
+  Header header;
+  if (!get_source_info(filename, &header))
+  {
+    return;
+  }
+
+  Writer out;
+  out.write_string(filename);
+  out.write_string(level.name);
+  out.write_string(level.author);
+  out.write_string(level.song_title);
+  out.write_string(level.bkgd_image);
+  out.write_string(level.particle_system);
+  out.write_int(level.width);
+  out.write_int(level.start_pos_x);
+  out.write_int(level.start_pos_y);
+  out.write_int(level.time_left);
+  out.write_int(level.bkgd_speed);
+  out.write_int(level.back_scrolling);
+  out.write_int(level.bkgd_top.red);
+  out.write_int(level.bkgd_top.green);
+  out.write_int(level.bkgd_top.blue);
+  out.write_int(level.bkgd_bottom.red);
+  out.write_int(level.bkgd_bottom.green);
+  out.write_int(level.bkgd_bottom.blue);
+  out.write_float(level.hor_autoscroll_speed);
+  out.write_float(level.gravity);
+
+  out.write_int(level.reset_points.size());
+  for (const ResetPoint& point : level.reset_points)
+  {
+    out.write_int(point.x);
+    out.write_int(point.y);
+  }
+
+  out.write_int(level.badguy_data.size());
+  for (const BadGuyData& data : level.badguy_data)
+  {
+    out.write_int(data.kind);
+    out.write_int(data.x);
+    out.write_int(data.y);
+    out.write_int(data.stay_on_platform);
+  }
+
+  out.write_int(level.emitter_data.size());
+  for (const EmitterData& data : level.emitter_data)
+  {
+    out.write_int(data.kind);
+    out.write_int(data.x);
+    out.write_int(data.y);
+    out.write_int(data.width);
+    out.write_int(data.height);
+  }
+
+  out.write_int(level.original_tiles.size());
+  for (const OriginalTileInfo& info : level.original_tiles)
+  {
+    out.write_int(info.x);
+    out.write_int(info.y);
+    out.write_int(info.tile);
+  }
+
+  header.tiles_offset = sizeof(header) + out.data.size();
+  out.write_tiles(level.bg_tiles);
+  out.write_tiles(level.ia_tiles);
+  out.write_tiles(level.fg_tiles);
+
+  header.payload_size = out.data.size();
+
+  fs::path path = cache_path(filename);
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+
+  // Write to a temporary file first, a cut off cache must never be used
+  fs::path temp = path;
+  temp += ".tmp";
+
+  FILE* file = fopen(temp.string().c_str(), "wb");
+  if (file == nullptr)
+  {
+    return;
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(out.data.data(), 1, out.data.size(), file) == out.data.size();
+  written = (fclose(file) == 0) && written;
+
+  if (written)
+  {
+    fs::rename(temp, path, ec);
+  }
+  if (!written || ec)
+  {
+    fs::remove(temp, ec);
+  }
+}
+
+/**
+ * Deletes the cache file of a level, if there is one.
+ * @param filename The .stl file of the level.
+ */
+void LevelCache::remove(const std::string& filename)
+{
+  std::error_code ec;
+  fs::remove(cache_path(filename), ec);
+}
+
+// EOF
@@ -0,0 +1,54 @@
+//  level_cache.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_LEVEL_CACHE_H
+#define SUPERTUX_LEVEL_CACHE_H
+
+#include <string>
+
+class Level;
+
+/** Compiled copies of .stl files, kept below st_dir/cache/levels.
+
+    The first time a level is loaded its parsed contents are written to a
+    binary file, which later loads read with a single fread() instead of
+    parsing the level again. A cached level is only used as long as the
+    size and modification time of its .stl file didn't change.
+
+    The tilemaps are stored last. The background and foreground of very
+    wide levels aren't read at all, they stream from the cache file while
+    the level is played, see TileLayer::stream(). */
+class LevelCache
+{
+public:
+  /** Fill level from the cache of filename, returns false if there is no
+      valid cache and the level has to be parsed */
+  static bool load(Level& level, const std::string& filename);
+
+  /** Write the cache of filename, failures are silently ignored */
+  static void save(const Level& level, const std::string& filename);
+
+  /** Throw away the cache of filename, e.g. because it is being saved */
+  static void remove(const std::string& filename);
+};
+
+#endif /*SUPERTUX_LEVEL_CACHE_H*/
+
+// EOF
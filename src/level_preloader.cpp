@@ -0,0 +1,283 @@
+//  level_preloader.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include "level_preloader.h"
+#include "image_loader.h"
+#include "level.h"
+#include "texture.h"
+#include "tile.h"
+#include "setup.h"
+
+namespace
+{
+
+// Everything below is guarded by mutex
+SDL_mutex* mutex = nullptr;
+SDL_Thread* thread = nullptr;
+bool running = false;
+std::string wanted;              // level the worldmap asked for, empty if none
+std::string loaded_name;         // level held by loaded
+Level* loaded = nullptr;
+SDL_Surface* loaded_bkgd = nullptr;
+std::string failed_name;         // level whose loading hit st_abort()
+AbortError failure;
+
+/**
+ * Frees the preloaded level, the caller must hold the mutex.
+ */
+void discard_loaded()
+{
+  delete loaded;
+  loaded = nullptr;
+  if (loaded_bkgd)
+  {
+    SDL_FreeSurface(loaded_bkgd);
+    loaded_bkgd = nullptr;
+  }
+  loaded_name.clear();
+  failed_name.clear();
+}
+
+/**
+ * Body of the worker thread, loads the wanted level until the request
+ * stops changing.
+ * @param data Unused.
+ * @return Always 0.
+ */
+int worker(void* data)
+{
+  (void) data;
+
+  // A broken level is reported by take(), on the main thread
+  st_defer_abort(true);
+
+  SDL_LockMutex(mutex);
+  while (!wanted.empty() && wanted != loaded_name && wanted != failed_name)
+  {
+    std::string name = wanted;
+    SDL_UnlockMutex(mutex);
+
+    Level* level = new Level();
+    SDL_Surface* bkgd = nullptr;
+    bool aborted = false;
+    AbortError error;
+    try
+    {
+      if (level->load(name) == 0)
+      {
+        std::string bkgd_file = level->get_bkgd_filename();
+        if (!bkgd_file.empty())
+        {
+          bkgd = ImageLoader::load(bkgd_file);
+        }
+      }
+      else
+      {
+        // Leave the error handling to the main thread
+        delete level;
+        level = nullptr;
+      }
+    }
+    catch (const AbortError& e)
+    {
+      delete level;
+      level = nullptr;
+      aborted = true;
+      error = e;
+    }
+
+    SDL_LockMutex(mutex);
+    discard_loaded();
+    if (level)
+    {
+      loaded = level;
+      loaded_bkgd = bkgd;
+      loaded_name = name;
+    }
+    else if (aborted)
+    {
+      failed_name = name;
+      failure = error;
+    }
+    else if (wanted == name)
+    {
+      wanted.clear();
+    }
+  }
+  running = false;
+  SDL_UnlockMutex(mutex);
+
+  st_defer_abort(false);
+
+  return 0;
+}
+
+/**
+ * Waits for a worker that is finished or about to finish.
+ */
+void join_worker()
+{
+  SDL_LockMutex(mutex);
+  SDL_Thread* finished = running ? nullptr : thread;
+  if (finished)
+  {
+    thread = nullptr;
+  }
+  SDL_UnlockMutex(mutex);
+
+  if (finished)
+  {
+    SDL_WaitThread(finished, nullptr);
+  }
+}
+
+} // namespace
+
+/**
+ * Starts loading a level in the background.
+ * @param filename The .stl file of the level.
+ */
+void LevelPreloader::request(const std::string& filename)
+{
+  if (mutex == nullptr)
+  {
+    mutex = SDL_CreateMutex();
+    if (mutex == nullptr)
+    {
+      return;
+    }
+  }
+
+  // Make sure the tileset is loaded here, the worker only reads it
+  TileManager::instance();
+
+  SDL_LockMutex(mutex);
+  SDL_Thread* finished = nullptr;
+  if (wanted != filename)
+  {
+    wanted = filename;
+    if (!running && loaded_name != filename)
+    {
+      // A worker that is done still has to be waited for
+      finished = thread;
+      thread = SDL_CreateThread(worker, nullptr);
+      running = thread != nullptr;
+    }
+  }
+  SDL_UnlockMutex(mutex);
+
+  if (finished)
+  {
+    SDL_WaitThread(finished, nullptr);
+  }
+}
+
+/**
+ * Hands over a preloaded level.
+ * @param filename The .stl file of the level.
+ * @return The loaded level, or nullptr if it has to be loaded normally.
+ */
+Level* LevelPreloader::take(const std::string& filename)
+{
+  if (mutex == nullptr)
+  {
+    return nullptr;
+  }
+
+  SDL_LockMutex(mutex);
+  bool wait = running && wanted == filename;
+  if (!wait)
+  {
+    wanted.clear();
+  }
+  SDL_Thread* busy = wait ? thread : nullptr;
+  if (busy)
+  {
+    thread = nullptr;
+  }
+  SDL_UnlockMutex(mutex);
+
+  if (busy)
+  {
+    SDL_WaitThread(busy, nullptr);
+  }
+  join_worker();
+
+  Level* level = nullptr;
+  SDL_Surface* bkgd = nullptr;
+
+  SDL_LockMutex(mutex);
+  bool aborted = failed_name == filename;
+  AbortError error = failure;
+  failed_name.clear();
+  if (loaded_name == filename)
+  {
+    level = loaded;
+    bkgd = loaded_bkgd;
+    loaded = nullptr;
+    loaded_bkgd = nullptr;
+    loaded_name.clear();
+  }
+  wanted.clear();
+  SDL_UnlockMutex(mutex);
+
+  if (aborted)
+  {
+    st_abort(error.reason, error.details);
+  }
+
+  if (level && bkgd)
+  {
+    // Surfaces have to be created on the main thread
+    level->set_bkgd_surface(bkgd);
+  }
+  return level;
+}
+
+/**
+ * Drops the current request and the preloaded level.
+ */
+void LevelPreloader::cancel()
+{
+  if (mutex == nullptr)
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  wanted.clear();
+  SDL_Thread* busy = thread;
+  thread = nullptr;
+  SDL_UnlockMutex(mutex);
+
+  if (busy)
+  {
+    SDL_WaitThread(busy, nullptr);
+  }
+
+  SDL_LockMutex(mutex);
+  discard_loaded();
+  SDL_UnlockMutex(mutex);
+}
+
+// EOF
@@ -0,0 +1,56 @@
+//  level_preloader.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_LEVEL_PRELOADER_H
+#define SUPERTUX_LEVEL_PRELOADER_H
+
+#include <string>
+
+class Level;
+
+/** Loads the level tux is standing on in the worldmap on a background
+    thread, so entering it doesn't have to wait for the parser and the
+    background image. Only one level is preloaded at a time, asking for
+    another one replaces the previous request.
+
+    The worker only parses the level and decodes the background image,
+    everything touching the screen or the sound system stays on the main
+    thread. */
+class LevelPreloader
+{
+public:
+  /** Start loading a level in the background, unless it is already
+      loaded or being loaded */
+  static void request(const std::string& filename);
+
+  /** Hand over the preloaded level, waits for the worker if it is still
+      busy with it. Returns nullptr if filename wasn't requested, the
+      caller owns the returned level. A level whose loading called
+      st_abort() on the worker aborts here, on the main thread. */
+  static Level* take(const std::string& filename);
+
+  /** Forget the current request and free whatever was preloaded */
+  static void cancel();
+};
+
+#endif /*SUPERTUX_LEVEL_PRELOADER_H*/
+
+// EOF
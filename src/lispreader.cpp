@@ -27,8 +27,16 @@
 #include <cstdlib>
 #include <cerrno>
 #include <cstring>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <charconv>
+#include <SDL.h>
 #include "setup.h"
+#include "asset_archive.h"
+#include "memory_budget.h"
 #include "lispreader.h"
+#include "utils.h"
 
 #define TOKEN_ERROR                   -1
 #define TOKEN_EOF                     0
@@ -45,8 +53,17 @@
 
 #define MAX_TOKEN_LENGTH              1024
 
-static char token_string[MAX_TOKEN_LENGTH + 1] = "";
-static int token_length = 0;
+typedef struct _lisp_arena_t lisp_arena_t;
+
+/* The state of one read: the token being scanned and the arena the tree
+   goes to. Each read has its own, so levels can be read in the
+   background. */
+struct ReadState
+{
+  lisp_arena_t *arena;  // 0 to malloc() the objects one by one
+  char token_string[MAX_TOKEN_LENGTH + 1];
+  int token_length;
+};
 
 static lisp_object_t end_marker = { LISP_TYPE_EOF, {{0, 0}} };
 static lisp_object_t error_object = { LISP_TYPE_PARSE_ERROR , {{0, 0}} };
@@ -57,23 +74,25 @@ static int _match_pattern (lisp_object_t *pattern, lisp_object_t *obj, lisp_obje
 
 /**
  * Clears the current token.
+ * @param state The read the token belongs to.
  */
-static void _token_clear(void)
+static void _token_clear(ReadState& state)
 {
-  token_string[0] = '\0';
-  token_length = 0;
+  state.token_string[0] = '\0';
+  state.token_length = 0;
 }
 
 /**
- * Appends a character to the current token.
+ * Appends a character to the current token. The token is terminated once
+ * it is complete, see _scan().
+ * @param state The read the token belongs to.
  * @param c The character to append.
  */
-static void _token_append(char c)
+static inline void _token_append(ReadState& state, char c)
 {
-  assert(token_length < MAX_TOKEN_LENGTH);
+  assert(state.token_length < MAX_TOKEN_LENGTH);
 
-  token_string[token_length++] = c;
-  token_string[token_length] = '\0';
+  state.token_string[state.token_length++] = c;
 }
 
 /**
@@ -140,21 +159,61 @@ static void _unget_char(char c, lisp_stream_t *stream)
   }
 }
 
+/* Character sources for the scanner. BufferSource walks through a block
+   of memory with a plain pointer, StreamSource goes through _next_char()
+   for streams that can't be read in one go. */
+struct BufferSource
+{
+  const char *pos;
+  const char *end;
+
+  int next()
+  {
+    if (pos >= end || *pos == '\0')
+    {
+      return EOF;
+    }
+    return (unsigned char)*pos++;
+  }
+
+  void unget(int)
+  {
+    --pos;
+  }
+};
+
+struct StreamSource
+{
+  lisp_stream_t *stream;
+
+  int next()
+  {
+    return _next_char(stream);
+  }
+
+  void unget(int c)
+  {
+    _unget_char(c, stream);
+  }
+};
+
 /**
- * Scans the input stream for the next token.
- * @param stream The Lisp stream to scan.
+ * Scans the input for the next token.
+ * @param stream The character source to scan.
+ * @param state Receives the text of the token.
  * @return The type of token found.
  */
-static int _scan(lisp_stream_t *stream)
+template<class Source>
+static int _scan_token(Source& stream, ReadState& state)
 {
   static const char *delims = "\"();";
   int c;
 
-  _token_clear();
+  _token_clear(state);
 
   do
   {
-    c = _next_char(stream);
+    c = stream.next();
     if (c == EOF)
     {
       return TOKEN_EOF;
@@ -163,7 +222,7 @@ static int _scan(lisp_stream_t *stream)
     {
       while (1)
       {
-        c = _next_char(stream);
+        c = stream.next();
         if (c == EOF)
         {
           return TOKEN_EOF;
@@ -187,7 +246,7 @@ static int _scan(lisp_stream_t *stream)
     case '"':
       while (1)
       {
-        c = _next_char(stream);
+        c = stream.next();
         if (c == EOF)
         {
           return TOKEN_ERROR;
@@ -198,7 +257,7 @@ static int _scan(lisp_stream_t *stream)
         }
         if (c == '\\')
         {
-          c = _next_char(stream);
+          c = stream.next();
           switch (c)
           {
             case EOF:
@@ -213,12 +272,12 @@ static int _scan(lisp_stream_t *stream)
               break;
           }
         }
-        _token_append(c);
+        _token_append(state, c);
       }
       return TOKEN_STRING;
 
     case '#':
-      c = _next_char(stream);
+      c = stream.next();
       if (c == EOF)
       {
         return TOKEN_ERROR;
@@ -233,7 +292,7 @@ static int _scan(lisp_stream_t *stream)
           return TOKEN_FALSE;
 
         case '?':
-          c = _next_char(stream);
+          c = stream.next();
           if (c == EOF)
           {
             return TOKEN_ERROR;
@@ -266,9 +325,9 @@ static int _scan(lisp_stream_t *stream)
           {
             have_floating_point++;
           }
-          _token_append(c);
+          _token_append(state, c);
 
-          c = _next_char(stream);
+          c = stream.next();
 
           if (c != EOF && !isdigit(c) && !isspace(c) && c != '.' && !strchr(delims, c))
           {
@@ -278,7 +337,7 @@ static int _scan(lisp_stream_t *stream)
 
         if (c != EOF)
         {
-          _unget_char(c, stream);
+          stream.unget(c);
         }
 
         if (have_nondigits || !have_digits || have_floating_point > 1)
@@ -298,27 +357,27 @@ static int _scan(lisp_stream_t *stream)
       {
         if (c == '.')
         {
-          c = _next_char(stream);
+          c = stream.next();
           if (c != EOF && !isspace(c) && !strchr(delims, c))
           {
-            _token_append('.');
+            _token_append(state, '.');
           }
           else
           {
-            _unget_char(c, stream);
+            stream.unget(c);
             return TOKEN_DOT;
           }
         }
 
         do
         {
-          _token_append(c);
-          c = _next_char(stream);
+          _token_append(state, c);
+          c = stream.next();
         } while (c != EOF && !isspace(c) && !strchr(delims, c));
 
         if (c != EOF)
         {
-          _unget_char(c, stream);
+          stream.unget(c);
         }
 
         return TOKEN_SYMBOL;
@@ -330,19 +389,226 @@ static int _scan(lisp_stream_t *stream)
 }
 
 /**
- * Allocates a new Lisp object.
+ * Scans the input for the next token and terminates its text.
+ * @param stream The character source to scan.
+ * @param state Receives the text of the token.
+ * @return The type of token found.
+ */
+template<class Source>
+static inline int _scan(Source& stream, ReadState& state)
+{
+  int token = _scan_token(stream, state);
+  state.token_string[state.token_length] = '\0';
+  return token;
+}
+
+/* Trees read by lisp_read() are allocated from an arena: objects and the
+   text of symbols and strings are carved out of big blocks, identical
+   texts are stored only once, and freeing the root of the tree releases
+   all of it at once. Objects created outside of lisp_read() are still
+   malloc()ed one by one. */
+
+#define ARENA_BLOCK_SIZE              (64 * 1024)
+#define ARENA_ALIGN                   8
+#define ARENA_STRINGS_SIZE            256
+
+typedef struct _lisp_arena_block_t lisp_arena_block_t;
+struct _lisp_arena_block_t
+{
+  lisp_arena_block_t *next;
+  size_t size;  // usable bytes behind the header
+  size_t used;
+};
+
+struct _lisp_arena_t
+{
+  lisp_arena_block_t *blocks;  // newest block first
+  lisp_object_t *root;         // tree owning the arena, 0 while reading
+  char **strings;              // interned texts, open addressing
+  int strings_size;            // always a power of two
+  int strings_count;
+};
+
+// blocks start with their header, padded to keep the data aligned
+#define ARENA_HEADER_SIZE ((sizeof(lisp_arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/**
+ * Returns the first usable byte of a block.
+ * @param block The arena block.
+ * @return The start of the block's data.
+ */
+static char* _arena_block_data(lisp_arena_block_t *block)
+{
+  return (char*)block + ARENA_HEADER_SIZE;
+}
+
+/**
+ * Creates an empty arena.
+ * @return The new arena.
+ */
+static lisp_arena_t* _arena_create(void)
+{
+  lisp_arena_t *arena = (lisp_arena_t*)calloc(1, sizeof(lisp_arena_t));
+  assert(arena);
+  return arena;
+}
+
+/**
+ * Frees an arena together with everything allocated from it.
+ * @param arena The arena to destroy.
+ */
+static void _arena_destroy(lisp_arena_t *arena)
+{
+  lisp_arena_block_t *block = arena->blocks;
+  while (block != 0)
+  {
+    lisp_arena_block_t *next = block->next;
+    MemoryBudget::add(MEM_LISP, -(long)(ARENA_HEADER_SIZE + block->size));
+    free(block);
+    block = next;
+  }
+
+  free(arena->strings);
+  free(arena);
+}
+
+/**
+ * Allocates memory from an arena, starting a new block if needed.
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes needed.
+ * @return The allocated memory, aligned to ARENA_ALIGN.
+ */
+static void* _arena_alloc(lisp_arena_t *arena, size_t size)
+{
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+  lisp_arena_block_t *block = arena->blocks;
+  if (block == 0 || block->used + size > block->size)
+  {
+    size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    block = (lisp_arena_block_t*)malloc(ARENA_HEADER_SIZE + block_size);
+    assert(block);
+
+    block->size = block_size;
+    block->used = 0;
+    MemoryBudget::add(MEM_LISP, ARENA_HEADER_SIZE + block_size);
+
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+
+  void *mem = _arena_block_data(block) + block->used;
+  block->used += size;
+  return mem;
+}
+
+/**
+ * Computes the FNV-1a hash of a string.
+ * @param str The string to hash.
+ * @return The hash value.
+ */
+static unsigned int _string_hash(const char *str)
+{
+  unsigned int hash = 2166136261u;
+  for (; *str != '\0'; ++str)
+  {
+    hash = (hash ^ (unsigned char)*str) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Returns the arena's copy of a text, creating it on first use.
+ * @param arena The arena to intern the text in.
+ * @param value The text.
+ * @return The interned copy, shared by all objects with the same text.
+ */
+static char* _arena_intern(lisp_arena_t *arena, const char *value)
+{
+  if (arena->strings_count * 2 >= arena->strings_size)
+  {
+    int old_size = arena->strings_size;
+    char **old_strings = arena->strings;
+
+    arena->strings_size = old_size ? old_size * 2 : ARENA_STRINGS_SIZE;
+    arena->strings = (char**)calloc(arena->strings_size, sizeof(char*));
+    assert(arena->strings);
+
+    for (int i = 0; i < old_size; ++i)
+    {
+      if (old_strings[i] != 0)
+      {
+        unsigned int slot = _string_hash(old_strings[i]) & (arena->strings_size - 1);
+        while (arena->strings[slot] != 0)
+        {
+          slot = (slot + 1) & (arena->strings_size - 1);
+        }
+        arena->strings[slot] = old_strings[i];
+      }
+    }
+    free(old_strings);
+  }
+
+  unsigned int slot = _string_hash(value) & (arena->strings_size - 1);
+  while (arena->strings[slot] != 0)
+  {
+    if (strcmp(arena->strings[slot], value) == 0)
+    {
+      return arena->strings[slot];
+    }
+    slot = (slot + 1) & (arena->strings_size - 1);
+  }
+
+  size_t len = strlen(value) + 1;
+  char *copy = (char*)_arena_alloc(arena, len);
+  memcpy(copy, value, len);
+
+  arena->strings[slot] = copy;
+  arena->strings_count += 1;
+  return copy;
+}
+
+/**
+ * Allocates a new Lisp object, from the arena of the tree being read if
+ * there is one.
+ * @param arena The arena of the tree being read, or 0.
  * @param type The type of the object.
  * @return A pointer to the allocated object.
  */
-static lisp_object_t* lisp_object_alloc(int type)
+static lisp_object_t* lisp_object_alloc(lisp_arena_t *arena, int type)
 {
-  lisp_object_t *obj = (lisp_object_t*)malloc(sizeof(lisp_object_t));
+  lisp_object_t *obj;
+
+  if (arena != 0)
+  {
+    obj = (lisp_object_t*)_arena_alloc(arena, sizeof(lisp_object_t));
+  }
+  else
+  {
+    obj = (lisp_object_t*)malloc(sizeof(lisp_object_t));
+  }
 
   obj->type = type;
+  obj->arena = arena;
 
   return obj;
 }
 
+/**
+ * Copies the text of a symbol or string object.
+ * @param arena The arena of the tree being read, or 0.
+ * @param value The text to copy.
+ * @return The copy, interned if a tree is being read.
+ */
+static char* lisp_string_dup(lisp_arena_t *arena, const char *value)
+{
+  if (arena != 0)
+  {
+    return _arena_intern(arena, value);
+  }
+  return strdup(value);
+}
+
 /**
  * Initializes a file-based Lisp stream.
  * @param stream The stream to initialize.
@@ -368,6 +634,7 @@ lisp_stream_t* lisp_stream_init_string(lisp_stream_t *stream, char *buf)
   stream->type = LISP_STREAM_STRING;
   stream->v.string.buf = buf;
   stream->v.string.pos = 0;
+  stream->v.string.len = strlen(buf);
 
   return stream;
 }
@@ -401,7 +668,7 @@ lisp_stream_t* lisp_stream_init_any(lisp_stream_t *stream, void *data,
  */
 lisp_object_t* lisp_make_integer(int value)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_INTEGER);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_INTEGER);
 
   obj->v.integer = value;
 
@@ -415,7 +682,7 @@ lisp_object_t* lisp_make_integer(int value)
  */
 lisp_object_t* lisp_make_real(float value)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_REAL);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_REAL);
 
   obj->v.real = value;
 
@@ -429,8 +696,8 @@ lisp_object_t* lisp_make_real(float value)
  */
 lisp_object_t* lisp_make_symbol(const char *value)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_SYMBOL);
-  obj->v.string = strdup(value);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_SYMBOL);
+  obj->v.string = lisp_string_dup(0, value);
   return obj;
 }
 
@@ -441,8 +708,8 @@ lisp_object_t* lisp_make_symbol(const char *value)
  */
 lisp_object_t* lisp_make_string(const char *value)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_STRING);
-  obj->v.string = strdup(value);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_STRING);
+  obj->v.string = lisp_string_dup(0, value);
   return obj;
 }
 
@@ -454,7 +721,7 @@ lisp_object_t* lisp_make_string(const char *value)
  */
 lisp_object_t* lisp_make_cons(lisp_object_t *car, lisp_object_t *cdr)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_CONS);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_CONS);
   obj->v.cons.car = car;
   obj->v.cons.cdr = cdr;
   return obj;
@@ -467,7 +734,7 @@ lisp_object_t* lisp_make_cons(lisp_object_t *car, lisp_object_t *cdr)
  */
 lisp_object_t* lisp_make_boolean(int value)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_BOOLEAN);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_BOOLEAN);
   obj->v.integer = value ? 1 : 0;
   return obj;
 }
@@ -480,7 +747,7 @@ lisp_object_t* lisp_make_boolean(int value)
  */
 static lisp_object_t* lisp_make_pattern_cons(lisp_object_t *car, lisp_object_t *cdr)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_PATTERN_CONS);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_PATTERN_CONS);
   obj->v.cons.car = car;
   obj->v.cons.cdr = cdr;
   return obj;
@@ -495,7 +762,7 @@ static lisp_object_t* lisp_make_pattern_cons(lisp_object_t *car, lisp_object_t *
  */
 static lisp_object_t* lisp_make_pattern_var(int type, int index, lisp_object_t *sub)
 {
-  lisp_object_t *obj = lisp_object_alloc(LISP_TYPE_PATTERN_VAR);
+  lisp_object_t *obj = lisp_object_alloc(0, LISP_TYPE_PATTERN_VAR);
   obj->v.pattern.type = type;
   obj->v.pattern.index = index;
   obj->v.pattern.sub = sub;
@@ -503,13 +770,16 @@ static lisp_object_t* lisp_make_pattern_var(int type, int index, lisp_object_t *
 }
 
 /**
- * Reads a Lisp object from the stream.
- * @param in The input stream.
+ * Reads a Lisp object from the input, allocating from the arena of the
+ * read if it has one.
+ * @param in The character source to read from.
+ * @param state The state of the read.
  * @return The Lisp object read.
  */
-lisp_object_t* lisp_read(lisp_stream_t *in)
+template<class Source>
+static lisp_object_t* _read(Source& in, ReadState& state)
 {
-  int token = _scan(in);
+  int token = _scan(in, state);
   lisp_object_t *obj = lisp_nil();
 
   if (token == TOKEN_EOF)
@@ -532,7 +802,7 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
 
       do
       {
-        car = lisp_read(in);
+        car = _read(in, state);
         if (car == &error_object || car == &end_marker)
         {
           lisp_free(obj);
@@ -546,7 +816,7 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
             return &error_object;
           }
 
-          car = lisp_read(in);
+          car = _read(in, state);
           if (car == &error_object || car == &end_marker)
           {
             lisp_free(obj);
@@ -556,7 +826,7 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
           {
             last->v.cons.cdr = car;
 
-            if (_scan(in) != TOKEN_CLOSE_PAREN)
+            if (_scan(in, state) != TOKEN_CLOSE_PAREN)
             {
               lisp_free(obj);
               return &error_object;
@@ -569,12 +839,14 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
         {
           if (lisp_nil_p(last))
           {
-            obj = last = (token == TOKEN_OPEN_PAREN ? lisp_make_cons(car, lisp_nil()) : lisp_make_pattern_cons(car, lisp_nil()));
+            obj = last = lisp_object_alloc(state.arena, token == TOKEN_OPEN_PAREN ? LISP_TYPE_CONS : LISP_TYPE_PATTERN_CONS);
           }
           else
           {
-            last = last->v.cons.cdr = lisp_make_cons(car, lisp_nil());
+            last = last->v.cons.cdr = lisp_object_alloc(state.arena, LISP_TYPE_CONS);
           }
+          last->v.cons.car = car;
+          last->v.cons.cdr = lisp_nil();
         }
       }
       while (car != &close_paren_marker);
@@ -585,22 +857,24 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
       return &close_paren_marker;
 
     case TOKEN_SYMBOL:
-      return lisp_make_symbol(token_string);
-
     case TOKEN_STRING:
-      return lisp_make_string(token_string);
+      obj = lisp_object_alloc(state.arena, token == TOKEN_SYMBOL ? LISP_TYPE_SYMBOL : LISP_TYPE_STRING);
+      obj->v.string = lisp_string_dup(state.arena, state.token_string);
+      return obj;
 
     case TOKEN_INTEGER:
     {
       // Convert string to long with error checking
       char* endptr;
       errno = 0;
-      long int_val = strtol(token_string, &endptr, 10);
+      long int_val = strtol(state.token_string, &endptr, 10);
       if (errno != 0 || *endptr != '\0' || int_val < INT_MIN || int_val > INT_MAX)
       {
         return &error_object;  // Handle conversion error
       }
-      return lisp_make_integer((int)int_val);
+      obj = lisp_object_alloc(state.arena, LISP_TYPE_INTEGER);
+      obj->v.integer = (int)int_val;
+      return obj;
     }
 
     case TOKEN_REAL:
@@ -608,22 +882,24 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
       // Convert string to float with error checking
       char* endptr;
       errno = 0;
-      float real_val = strtof(token_string, &endptr);
+      float real_val = strtof(state.token_string, &endptr);
       if (errno != 0 || *endptr != '\0')
       {
         return &error_object;  // Handle conversion error
       }
-      return lisp_make_real(real_val);
+      obj = lisp_object_alloc(state.arena, LISP_TYPE_REAL);
+      obj->v.real = real_val;
+      return obj;
     }
 
     case TOKEN_DOT:
       return &dot_marker;
 
     case TOKEN_TRUE:
-      return lisp_make_boolean(1);
-
     case TOKEN_FALSE:
-      return lisp_make_boolean(0);
+      obj = lisp_object_alloc(state.arena, LISP_TYPE_BOOLEAN);
+      obj->v.integer = token == TOKEN_TRUE ? 1 : 0;
+      return obj;
   }
 
   assert(0);
@@ -631,7 +907,97 @@ lisp_object_t* lisp_read(lisp_stream_t *in)
 }
 
 /**
- * Frees a Lisp object and its sub-objects.
+ * Reads a Lisp object from a stream, through a buffer where possible.
+ * Files are read in one go from the current position on, and put back to
+ * the end of the object afterwards, so further reads continue there.
+ * @param in The input stream.
+ * @param state The state of the read.
+ * @return The Lisp object read.
+ */
+static lisp_object_t* _read_stream(lisp_stream_t *in, ReadState& state)
+{
+  if (in->type == LISP_STREAM_STRING)
+  {
+    BufferSource source;
+    source.pos = in->v.string.buf + in->v.string.pos;
+    source.end = in->v.string.buf + in->v.string.len;
+
+    lisp_object_t *obj = _read(source, state);
+    in->v.string.pos = source.pos - in->v.string.buf;
+    return obj;
+  }
+
+  if (in->type == LISP_STREAM_FILE)
+  {
+    FILE *file = in->v.file;
+    long start = ftell(file);
+
+    if (start >= 0 && fseek(file, 0, SEEK_END) == 0)
+    {
+      long end = ftell(file);
+      fseek(file, start, SEEK_SET);
+
+      if (end >= start)
+      {
+        size_t size = end - start;
+        char *buf = (char*)malloc(size + 1);
+        assert(buf);
+
+        // Newline translation would break the offsets, don't buffer then
+        if (fread(buf, 1, size, file) == size)
+        {
+          BufferSource source;
+          source.pos = buf;
+          source.end = buf + size;
+
+          lisp_object_t *obj = _read(source, state);
+          fseek(file, start + (source.pos - buf), SEEK_SET);
+          free(buf);
+          return obj;
+        }
+
+        free(buf);
+        fseek(file, start, SEEK_SET);
+      }
+    }
+  }
+
+  // Pipes and custom streams are read character by character
+  StreamSource source;
+  source.stream = in;
+  return _read(source, state);
+}
+
+/**
+ * Reads a Lisp object from the stream. The whole tree is allocated from
+ * an arena of its own, which lisp_free() of the returned object releases.
+ * @param in The input stream.
+ * @return The Lisp object read.
+ */
+lisp_object_t* lisp_read(lisp_stream_t *in)
+{
+  lisp_arena_t *arena = _arena_create();
+
+  ReadState state;
+  state.arena = arena;
+  lisp_object_t *obj = _read_stream(in, state);
+
+  if (obj != 0 && obj->arena == arena)
+  {
+    arena->root = obj;
+  }
+  else
+  {
+    // nil, end of file or parse error, nothing to keep
+    _arena_destroy(arena);
+  }
+
+  return obj;
+}
+
+/**
+ * Frees a Lisp object and its sub-objects. For a tree returned by
+ * lisp_read() only freeing its root has an effect.
  * @param obj The Lisp object to free.
  */
 void lisp_free(lisp_object_t *obj)
@@ -645,6 +1011,17 @@ void lisp_free(lisp_object_t *obj)
     return;
   }
 
+  if (obj->arena != 0)
+  {
+    // Freeing the root of a tree read by lisp_read() releases all of it,
+    // freeing anything else in it does nothing
+    if (obj->arena->root == obj)
+    {
+      _arena_destroy(obj->arena);
+    }
+    return;
+  }
+
   switch (obj->type)
   {
     case LISP_TYPE_INTERNAL:
@@ -719,9 +1096,14 @@ void lisp_free(lisp_object_t *obj)
  */
 lisp_object_t* lisp_read_from_string(const char *buf)
 {
-  lisp_stream_t stream;
-  lisp_stream_init_string(&stream, (char*)buf);
-  return lisp_read(&stream);
+  BufferSource source;
+  source.pos = buf;
+  source.end = buf + strlen(buf);
+
+  // Not from an arena, lisp_compile_pattern() rewrites patterns in place
+  ReadState state;
+  state.arena = 0;
+  return _read(source, state);
 }
 
 /**
@@ -1022,7 +1404,8 @@ int lisp_match_pattern(lisp_object_t *pattern, lisp_object_t *obj, lisp_object_t
 }
 
 /**
- * Matches a string-based pattern against a Lisp object.
+ * Matches a string-based pattern against a Lisp object. The pattern is
+ * compiled on its first use and kept, see LispPattern::get().
  * @param pattern_string The pattern string.
  * @param obj The Lisp object to match against.
  * @param vars The array to store matched variables.
@@ -1030,27 +1413,80 @@ int lisp_match_pattern(lisp_object_t *pattern, lisp_object_t *obj, lisp_object_t
  */
 int lisp_match_string(const char *pattern_string, lisp_object_t *obj, lisp_object_t **vars)
 {
-  lisp_object_t *pattern;
-  int result;
-  int num_subs;
+  return LispPattern::get(pattern_string)->match(obj, vars) ? 1 : 0;
+}
 
-  pattern = lisp_read_from_string(pattern_string);
+/**
+ * Parses and compiles a pattern.
+ * @param pattern_string The pattern string.
+ */
+LispPattern::LispPattern(const char* pattern_string)
+  : pattern(0), num_subs(0)
+{
+  lisp_object_t* obj = lisp_read_from_string(pattern_string);
 
-  if (pattern != 0 && (lisp_type(pattern) == LISP_TYPE_EOF || lisp_type(pattern) == LISP_TYPE_PARSE_ERROR))
+  if (obj != 0 && (lisp_type(obj) == LISP_TYPE_EOF || lisp_type(obj) == LISP_TYPE_PARSE_ERROR))
   {
-    return 0;
+    lisp_free(obj);
+    return;
   }
 
-  if (!lisp_compile_pattern(&pattern, &num_subs))
+  if (!lisp_compile_pattern(&obj, &num_subs))
   {
-    lisp_free(pattern);
-    return 0;
+    lisp_free(obj);
+    num_subs = 0;
+    return;
   }
 
-  result = lisp_match_pattern(pattern, obj, vars, num_subs);
+  pattern = obj;
+}
+
+/**
+ * Frees the compiled pattern.
+ */
+LispPattern::~LispPattern()
+{
   lisp_free(pattern);
+}
 
-  return result;
+/**
+ * Returns the compiled pattern of a pattern string, compiling it the
+ * first time the string is seen. Patterns are never freed.
+ * @param pattern_string The pattern string.
+ * @return The pattern, possibly an invalid one.
+ */
+const LispPattern* LispPattern::get(const char* pattern_string)
+{
+  // Loaders may run on worker threads. The cache is never destroyed, so
+  // the patterns outlive everything that might still use them at exit.
+  static SDL_mutex* cache_mutex = SDL_CreateMutex();
+  static std::unordered_map<std::string, std::unique_ptr<LispPattern> >* cache =
+    new std::unordered_map<std::string, std::unique_ptr<LispPattern> >();
+
+  SDL_mutexP(cache_mutex);
+  std::unique_ptr<LispPattern>& entry = (*cache)[pattern_string];
+  if (!entry)
+  {
+    entry.reset(new LispPattern(pattern_string));
+  }
+  const LispPattern* pattern = entry.get();
+  SDL_mutexV(cache_mutex);
+  return pattern;
+}
+
+/**
+ * Matches the pattern against an object.
+ * @param obj The Lisp object to match against.
+ * @param vars The array to store matched variables, may be 0.
+ * @return True if the pattern matches.
+ */
+bool LispPattern::match(lisp_object_t* obj, lisp_object_t** vars) const
+{
+  if (pattern == 0)
+  {
+    return false;
+  }
+  return lisp_match_pattern(pattern, obj, vars, num_subs) != 0;
 }
 
 /**
@@ -1335,7 +1771,7 @@ void lisp_dump(lisp_object_t *obj, FILE *out)
  * @param l The Lisp object to be read.
  */
 LispReader::LispReader(lisp_object_t* l)
-  : lst(l)
+  : lst(l), indexed(false)
 {
   // std::cout << "LispReader: " << std::flush;
   // lisp_dump(lst, stdout);
@@ -1343,15 +1779,22 @@ LispReader::LispReader(lisp_object_t* l)
 }
 
 /**
- * Searches for a symbol in the Lisp list.
- * @param name The symbol name to search for.
- * @return The Lisp object associated with the symbol, or 0 if not found.
+ * Orders index entries by hash. Sorting is stable, so the first of
+ * several properties with the same name stays in front.
  */
-lisp_object_t* LispReader::search_for(const char* name)
+bool LispReader::index_less(const IndexEntry& a, const IndexEntry& b)
 {
-  lisp_object_t* cursor = lst;
+  return a.hash < b.hash;
+}
 
-  while (!lisp_nil_p(cursor))
+/**
+ * Collects the properties of the list into the lookup index.
+ */
+void LispReader::build_index()
+{
+  indexed = true;
+
+  for (lisp_object_t* cursor = lst; !lisp_nil_p(cursor); cursor = lisp_cdr(cursor))
   {
     lisp_object_t* cur = lisp_car(cursor);
 
@@ -1363,13 +1806,40 @@ lisp_object_t* LispReader::search_for(const char* name)
     }
     else
     {
-      if (strcmp(lisp_symbol(lisp_car(cur)), name) == 0)
-      {
-        return lisp_cdr(cur);
-      }
+      IndexEntry entry;
+      entry.name = lisp_symbol(lisp_car(cur));
+      entry.hash = _string_hash(entry.name);
+      entry.value = lisp_cdr(cur);
+      index.push_back(entry);
     }
+  }
+
+  std::stable_sort(index.begin(), index.end(), index_less);
+}
+
+/**
+ * Searches for a symbol in the Lisp list.
+ * @param name The symbol name to search for.
+ * @return The Lisp object associated with the symbol, or 0 if not found.
+ */
+lisp_object_t* LispReader::search_for(const char* name)
+{
+  if (!indexed)
+  {
+    build_index();
+  }
 
-    cursor = lisp_cdr(cursor);
+  IndexEntry key;
+  key.hash = _string_hash(name);
+
+  std::vector<IndexEntry>::const_iterator i =
+    std::lower_bound(index.begin(), index.end(), key, index_less);
+  for (; i != index.end() && i->hash == key.hash; ++i)
+  {
+    if (strcmp(i->name, name) == 0)
+    {
+      return i->value;
+    }
   }
   return 0;
 }
@@ -1546,45 +2016,164 @@ bool LispReader::read_bool(const char* name, bool* b)
   return false;
 }
 
+/**
+ * Constructor for LispWriter, starts with an empty text.
+ */
+LispWriter::LispWriter()
+  : depth(0)
+{
+  // Most files fit without growing the buffer
+  buffer.reserve(64 * 1024);
+}
+
 /**
  * Constructor for LispWriter.
- * @param name The name of the symbol to start the writer with.
+ * @param name The name of the list to start the writer with.
  */
 LispWriter::LispWriter(const char* name)
+  : LispWriter()
 {
-  lisp_objs.push_back(lisp_make_symbol(name));
+  start_list(name);
 }
 
 /**
- * Appends a Lisp object to the writer.
- * @param obj The Lisp object to append.
+ * Moves to the start of a new line, indented by the open lists.
  */
-void LispWriter::append(lisp_object_t* obj)
+void LispWriter::begin_line()
 {
-  lisp_objs.push_back(obj);
+  if (!buffer.empty() && buffer.back() != '\n')
+  {
+    buffer += '\n';
+  }
+  buffer.append(depth * 2, ' ');
 }
 
 /**
- * Creates a Lisp list with three elements.
- * @param a The first element.
- * @param b The second element.
- * @param c The third element.
- * @return A Lisp cons list containing the three elements.
+ * Appends the decimal digits of an integer.
+ * @param i The integer.
  */
-lisp_object_t* LispWriter::make_list3(lisp_object_t* a, lisp_object_t* b, lisp_object_t* c)
+void LispWriter::append_int(int i)
 {
-  return lisp_make_cons(a, lisp_make_cons(b, lisp_make_cons(c, lisp_nil())));
+  char digits[16];
+  char* end = std::to_chars(digits, digits + sizeof(digits), i).ptr;
+  buffer.append(digits, end);
 }
 
 /**
- * Creates a Lisp list with two elements.
- * @param a The first element.
- * @param b The second element.
- * @return A Lisp cons list containing the two elements.
+ * Appends a string in quotes, escaping quotes and backslashes.
+ * @param str The string.
  */
-lisp_object_t* LispWriter::make_list2(lisp_object_t* a, lisp_object_t* b)
+void LispWriter::append_string(const char* str)
 {
-  return lisp_make_cons(a, lisp_make_cons(b, lisp_nil()));
+  buffer += '"';
+  for (const char* p = str; *p != 0; ++p)
+  {
+    if (*p == '"' || *p == '\\')
+    {
+      buffer += '\\';
+    }
+    buffer += *p;
+  }
+  buffer += '"';
+}
+
+/**
+ * Appends a Lisp object on a single line, like lisp_dump() does.
+ * @param obj The Lisp object.
+ */
+void LispWriter::append_lisp(lisp_object_t* obj)
+{
+  if (obj == 0)
+  {
+    buffer += "()";
+    return;
+  }
+
+  char number[32];
+  switch (lisp_type(obj))
+  {
+    case LISP_TYPE_INTEGER:
+      append_int(lisp_integer(obj));
+      break;
+
+    case LISP_TYPE_REAL:
+      snprintf(number, sizeof(number), "%f", lisp_real(obj));
+      buffer += number;
+      break;
+
+    case LISP_TYPE_SYMBOL:
+      buffer += lisp_symbol(obj);
+      break;
+
+    case LISP_TYPE_STRING:
+      append_string(lisp_string(obj));
+      break;
+
+    case LISP_TYPE_BOOLEAN:
+      buffer += lisp_boolean(obj) ? "#t" : "#f";
+      break;
+
+    case LISP_TYPE_CONS:
+      buffer += '(';
+      while (obj != 0)
+      {
+        append_lisp(lisp_car(obj));
+        obj = lisp_cdr(obj);
+        if (obj != 0)
+        {
+          if (lisp_type(obj) != LISP_TYPE_CONS)
+          {
+            buffer += " . ";
+            append_lisp(obj);
+            break;
+          }
+          buffer += ' ';
+        }
+      }
+      buffer += ')';
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Opens a list, the following values are its elements.
+ * @param name The name of the list.
+ */
+void LispWriter::start_list(const char* name)
+{
+  begin_line();
+  buffer += '(';
+  buffer += name;
+  ++depth;
+}
+
+/**
+ * Closes the innermost open list.
+ */
+void LispWriter::end_list()
+{
+  assert(depth > 0);
+  --depth;
+  buffer += ')';
+  if (depth == 0)
+  {
+    buffer += '\n';
+  }
+}
+
+/**
+ * Writes a comment line.
+ * @param text The comment, without the leading ;
+ */
+void LispWriter::write_comment(const char* text)
+{
+  begin_line();
+  buffer += ';';
+  buffer += text;
+  buffer += '\n';
 }
 
 /**
@@ -1594,7 +2183,26 @@ lisp_object_t* LispWriter::make_list2(lisp_object_t* a, lisp_object_t* b)
  */
 void LispWriter::write_float(const char* name, float f)
 {
-  append(make_list2(lisp_make_symbol(name), lisp_make_real(f)));
+  // The shortest form that reads back as the same float, 9 digits always do
+  char number[32];
+  for (int precision = 6; precision <= 9; ++precision)
+  {
+    snprintf(number, sizeof(number), "%.*g", precision, f);
+    if (strtof(number, nullptr) == f)
+    {
+      break;
+    }
+  }
+
+  start_list(name);
+  buffer += ' ';
+  buffer += number;
+  // Keep it a real when read back
+  if (strpbrk(number, ".en") == nullptr)
+  {
+    buffer += ".0";
+  }
+  end_list();
 }
 
 /**
@@ -1604,7 +2212,9 @@ void LispWriter::write_float(const char* name, float f)
  */
 void LispWriter::write_int(const char* name, int i)
 {
-  append(make_list2(lisp_make_symbol(name), lisp_make_integer(i)));
+  start_list(name);
+  write_value(i);
+  end_list();
 }
 
 /**
@@ -1614,7 +2224,10 @@ void LispWriter::write_int(const char* name, int i)
  */
 void LispWriter::write_string(const char* name, const char* str)
 {
-  append(make_list2(lisp_make_symbol(name), lisp_make_string(str)));
+  start_list(name);
+  buffer += ' ';
+  append_string(str);
+  end_list();
 }
 
 /**
@@ -1624,7 +2237,10 @@ void LispWriter::write_string(const char* name, const char* str)
  */
 void LispWriter::write_symbol(const char* name, const char* symname)
 {
-  append(make_list2(lisp_make_symbol(name), lisp_make_symbol(symname)));
+  start_list(name);
+  buffer += ' ';
+  buffer += symname;
+  end_list();
 }
 
 /**
@@ -1634,7 +2250,10 @@ void LispWriter::write_symbol(const char* name, const char* symname)
  */
 void LispWriter::write_lisp_obj(const char* name, lisp_object_t* lst)
 {
-  append(make_list2(lisp_make_symbol(name), lst));
+  start_list(name);
+  buffer += ' ';
+  append_lisp(lst);
+  end_list();
 }
 
 /**
@@ -1644,25 +2263,44 @@ void LispWriter::write_lisp_obj(const char* name, lisp_object_t* lst)
  */
 void LispWriter::write_boolean(const char* name, bool b)
 {
-  append(make_list2(lisp_make_symbol(name), lisp_make_boolean(b)));
+  start_list(name);
+  buffer += b ? " #t" : " #f";
+  end_list();
 }
 
 /**
- * Creates a Lisp object from the list of written objects.
- * @return The created Lisp object.
+ * Adds an integer to the open list without a name, e.g. a tile of a
+ * tilemap.
+ * @param i The integer value.
  */
-lisp_object_t* LispWriter::create_lisp()
+void LispWriter::write_value(int i)
 {
-  lisp_object_t* lisp_obj = lisp_nil();
+  buffer += ' ';
+  append_int(i);
+}
 
-  for (std::vector<lisp_object_t*>::reverse_iterator i = lisp_objs.rbegin();
-       i != lisp_objs.rend(); ++i)
+/**
+ * Continues the open list on a new line, e.g. for the next row of a
+ * tilemap.
+ */
+void LispWriter::new_line()
+{
+  buffer += '\n';
+  buffer.append(depth * 2, ' ');
+}
+
+/**
+ * Closes the lists still open and writes the text to a file.
+ * @param filename The file to write.
+ * @return True if the file was written completely.
+ */
+bool LispWriter::save(const std::string& filename)
+{
+  while (depth > 0)
   {
-    lisp_obj = lisp_make_cons(*i, lisp_obj);
+    end_list();
   }
-
-  lisp_objs.clear();
-  return lisp_obj;
+  return write_file_atomic(filename, buffer.data(), buffer.size());
 }
 
 #if 0
@@ -1695,41 +2333,46 @@ lisp_stream_t* lisp_stream_init_gzfile(lisp_stream_t *stream, gzFile file)
  */
 lisp_object_t* lisp_read_from_gzfile(const char* filename)
 {
-  bool done = false;
-  lisp_object_t* root_obj = 0;
-  int chunk_size = 128 * 1024;
-  int buf_pos = 0;
-  int try_number = 1;
-  char* buf = static_cast<char*>(malloc(chunk_size));
-  assert(buf);
+  const int chunk_size = 64 * 1024;
 
   gzFile in = gzopen(filename, "r");
+  if (in == 0)
+  {
+    return 0;
+  }
 
-  while (!done)
+  int capacity = chunk_size;
+  int len = 0;
+  char* buf = static_cast<char*>(malloc(capacity + 1));
+  assert(buf);
+
+  while (1)
   {
-    int ret = gzread(in, buf + buf_pos, chunk_size);
+    if (capacity - len < chunk_size)
+    {
+      capacity *= 2;
+      buf = static_cast<char*>(realloc(buf, capacity + 1));
+      assert(buf);
+    }
+
+    int ret = gzread(in, buf + len, chunk_size);
     if (ret == -1)
     {
       free(buf);
       assert(!"Error while reading from file");
     }
-    else if (ret == chunk_size) // buffer got full, resize if EOF not yet reached
-    {
-      buf_pos = chunk_size * try_number;
-      try_number += 1;
-      buf = static_cast<char*>(realloc(buf, chunk_size * try_number));
-      assert(buf);
-    }
-    else
+    else if (ret == 0)
     {
       // Everything fine, encountered EOF
-      done = true;
+      break;
     }
+    len += ret;
   }
+  buf[len] = '\0';
 
   lisp_stream_t stream;
   lisp_stream_init_string(&stream, buf);
-  root_obj = lisp_read(&stream);
+  lisp_object_t* root_obj = lisp_read(&stream);
 
   free(buf);
   gzclose(in);
@@ -1777,20 +2420,26 @@ lisp_object_t* lisp_read_from_file(const std::string& filename)
   {
     return lisp_read_from_gzfile(filename.c_str());
   }
-  else
+
+  // Files in the asset archive are parsed straight from memory
+  std::string data;
+  if (AssetArchive::read(filename, &data))
   {
-    lisp_object_t* obj = 0;
-    FILE* in = fopen(filename.c_str(), "r");
+    lisp_stream_init_string(&stream, &data[0]);
+    return lisp_read(&stream);
+  }
 
-    if (in)
-    {
-      lisp_stream_init_file(&stream, in);
-      obj = lisp_read(&stream);
-      fclose(in);
-    }
+  lisp_object_t* obj = 0;
+  FILE* in = fopen(filename.c_str(), "r");
 
-    return obj;
+  if (in)
+  {
+    lisp_stream_init_file(&stream, in);
+    obj = lisp_read(&stream);
+    fclose(in);
   }
+
+  return obj;
 }
 
 // EOF
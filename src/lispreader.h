@@ -107,6 +107,8 @@ struct _lisp_object_t
       struct _lisp_object_t *sub;
     } pattern;
   } v;
+
+  struct _lisp_arena_t *arena;  // Arena of a tree read by lisp_read(), 0 if malloc()ed
 };
 
 // Stream initialization functions
@@ -167,12 +169,53 @@ void lisp_dump(lisp_object_t *obj, FILE *out);
 #define lisp_cons_p(obj)     (lisp_type((obj)) == LISP_TYPE_CONS)
 #define lisp_boolean_p(obj)  (lisp_type((obj)) == LISP_TYPE_BOOLEAN)
 
+/** A pattern like those of lisp_match_string(), parsed and compiled once
+    to be matched against any number of objects. */
+class LispPattern
+{
+  private:
+    lisp_object_t* pattern;  // The compiled pattern, 0 if it is invalid
+    int num_subs;            // Variables the pattern binds
+
+    LispPattern(const LispPattern&) = delete;
+    LispPattern& operator=(const LispPattern&) = delete;
+
+  public:
+    LispPattern(const char* pattern_string);
+    ~LispPattern();
+
+    /** The compiled pattern of pattern_string, kept for the lifetime of
+        the program. Loaders checking the same pattern over and over
+        compile it only once. */
+    static const LispPattern* get(const char* pattern_string);
+
+    bool is_valid() const { return pattern != 0; }
+    int get_num_subs() const { return num_subs; }
+
+    /** Match obj, vars receives get_num_subs() objects if not 0. An
+        invalid pattern matches nothing. */
+    bool match(lisp_object_t* obj, lisp_object_t** vars = 0) const;
+};
+
 // LispReader class for reading Lisp objects
 class LispReader
 {
   private:
     lisp_object_t* lst;  // List of Lisp objects
 
+    // Properties of lst sorted by the hash of their name, built on the
+    // first lookup
+    struct IndexEntry
+    {
+      unsigned int hash;
+      const char* name;
+      lisp_object_t* value;
+    };
+    std::vector<IndexEntry> index;
+    bool indexed;
+
+    static bool index_less(const IndexEntry& a, const IndexEntry& b);
+    void build_index();
     lisp_object_t* search_for(const char* name);  // Search for a symbol in the list
   public:
     LispReader(lisp_object_t* l);
@@ -187,17 +230,27 @@ class LispReader
     bool read_lisp(const char* name, lisp_object_t** b);
 };
 
-// LispWriter class for writing Lisp objects
+/** Formats lisp data straight into a text buffer, which save() writes
+    to a file in one go. Each value and list starts on a line of its own,
+    indented by how deep it is nested. */
 class LispWriter
 {
   private:
-    std::vector<lisp_object_t*> lisp_objs;  // List of objects to write
+    std::string buffer;  // The text written so far
+    int depth;           // Lists that are open
+
+    void begin_line();   // Start a new, indented line unless at one
+    void append_int(int i);
+    void append_string(const char* str);
+    void append_lisp(lisp_object_t* obj);
 
-    void append(lisp_object_t* obj);  // Append a Lisp object to the list
-    lisp_object_t* make_list3(lisp_object_t*, lisp_object_t*, lisp_object_t*);
-    lisp_object_t* make_list2(lisp_object_t*, lisp_object_t*);
   public:
-    LispWriter(const char* name);  // Constructor initializing writer with a symbol
+    LispWriter();
+    LispWriter(const char* name);  // Starts with an open list name
+
+    void start_list(const char* name);  // Open the list (name ...
+    void end_list();                    // Close the last open list
+    void write_comment(const char* text);  // A line starting with ;
 
     void write_float(const char* name, float f);
     void write_int(const char* name, int i);
@@ -206,7 +259,16 @@ class LispWriter
     void write_symbol(const char* name, const char* symname);
     void write_lisp_obj(const char* name, lisp_object_t* lst);
 
-    lisp_object_t* create_lisp();  // Create a Lisp object from the written data
+    /** Add a bare integer to the open list, on the current line */
+    void write_value(int i);
+    /** Continue the open list on a new line */
+    void new_line();
+
+    const std::string& get_text() const { return buffer; }
+
+    /** Close the open lists and write the text to filename, through a
+        temporary file that replaces it once complete */
+    bool save(const std::string& filename);
 };
 
 #endif // __LISPREADER_H__
@@ -0,0 +1,209 @@
+//  memory_budget.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <stdio.h>
+#include <atomic>
+#include "memory_budget.h"
+#include "globals.h"
+#include "screen.h"
+#include "text.h"
+
+namespace
+{
+
+const char* const names[MEM_CATEGORIES] = {
+  "surfaces", "textures", "sounds", "music", "lisp", "levels", "tiles"
+};
+
+std::atomic<long> current[MEM_CATEGORIES];
+std::atomic<long> peak[MEM_CATEGORIES];
+
+bool report = false;
+bool overlay = false;
+
+/**
+ * Formats a number of bytes for the overlay and the report.
+ * @param bytes The number of bytes.
+ * @param buffer Receives the text.
+ * @param size The size of buffer.
+ */
+void format_bytes(long bytes, char* buffer, size_t size)
+{
+  if (bytes >= 10 * 1024 * 1024)
+  {
+    snprintf(buffer, size, "%7.1f MB", bytes / (1024.0f * 1024.0f));
+  }
+  else
+  {
+    snprintf(buffer, size, "%7.1f KB", bytes / 1024.0f);
+  }
+}
+
+} // namespace
+
+/**
+ * Accounts memory a subsystem allocated or freed.
+ * @param category The subsystem.
+ * @param bytes The change, negative when memory was freed.
+ */
+void MemoryBudget::add(MemoryCategory category, long bytes)
+{
+  long value = current[category].fetch_add(bytes) + bytes;
+
+  long highest = peak[category].load();
+  while (value > highest && !peak[category].compare_exchange_weak(highest, value))
+  {
+  }
+}
+
+/**
+ * Returns the bytes a subsystem holds right now.
+ * @param category The subsystem.
+ * @return The number of bytes.
+ */
+long MemoryBudget::get(MemoryCategory category)
+{
+  return current[category].load();
+}
+
+/**
+ * Returns the most bytes a subsystem held since begin_level().
+ * @param category The subsystem.
+ * @return The number of bytes.
+ */
+long MemoryBudget::get_peak(MemoryCategory category)
+{
+  return peak[category].load();
+}
+
+/**
+ * Returns the name of a subsystem for the overlay and the report.
+ * @param category The subsystem.
+ * @return The name.
+ */
+const char* MemoryBudget::get_name(MemoryCategory category)
+{
+  return names[category];
+}
+
+/**
+ * Lets the high-water marks start over from the current values.
+ */
+void MemoryBudget::begin_level()
+{
+  for (int i = 0; i < MEM_CATEGORIES; ++i)
+  {
+    peak[i].store(current[i].load());
+  }
+}
+
+/**
+ * Prints the high-water marks of a level to stdout.
+ * @param name The name of the level.
+ */
+void MemoryBudget::end_level(const std::string& name)
+{
+  if (!report)
+  {
+    return;
+  }
+
+  char text[32];
+  long total = 0;
+  printf("Memory high-water marks of %s:\n", name.c_str());
+  for (int i = 0; i < MEM_CATEGORIES; ++i)
+  {
+    format_bytes(peak[i].load(), text, sizeof(text));
+    printf("  %-10s %s\n", names[i], text);
+    total += peak[i].load();
+  }
+  // Categories peak at different times, so this is an upper bound
+  format_bytes(total, text, sizeof(text));
+  printf("  %-10s %s\n", "all", text);
+}
+
+/**
+ * Turns the report at the end of each level on or off.
+ * @param enable True to print reports.
+ */
+void MemoryBudget::enable_report(bool enable)
+{
+  report = enable;
+}
+
+/**
+ * Turns the overlay on or off.
+ * @param enable True to show the overlay.
+ */
+void MemoryBudget::enable_overlay(bool enable)
+{
+  overlay = enable;
+}
+
+/**
+ * Tells whether the overlay is shown.
+ * @return True if draw() draws it.
+ */
+bool MemoryBudget::is_overlay_enabled()
+{
+  return overlay;
+}
+
+/**
+ * Draws the current bytes and the high-water mark of each subsystem in
+ * the top right corner of the screen.
+ */
+void MemoryBudget::draw()
+{
+  if (!overlay)
+  {
+    return;
+  }
+
+  const int width = 260;
+  const int line_height = white_small_text->h + 1;
+  int x = screen->w - width - 10;
+  int y = 60;
+
+  fillrect(x - 4, y - 4, width + 8, (MEM_CATEGORIES + 2) * line_height + 8, 0, 0, 0, 128);
+
+  white_small_text->draw("memory        now      peak", x, y, 1);
+  y += line_height;
+
+  long total = 0;
+  char line[64];
+  char now_text[16];
+  char peak_text[16];
+  for (int i = 0; i < MEM_CATEGORIES; ++i)
+  {
+    format_bytes(current[i].load(), now_text, sizeof(now_text));
+    format_bytes(peak[i].load(), peak_text, sizeof(peak_text));
+    snprintf(line, sizeof(line), "%-8s %s %s", names[i], now_text, peak_text);
+    white_small_text->draw(line, x, y, 1);
+    y += line_height;
+    total += current[i].load();
+  }
+
+  format_bytes(total, now_text, sizeof(now_text));
+  snprintf(line, sizeof(line), "%-8s %s", "all", now_text);
+  white_small_text->draw(line, x, y, 1);
+}
+
+// EOF
@@ -0,0 +1,73 @@
+//  memory_budget.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_MEMORY_BUDGET_H
+#define SUPERTUX_MEMORY_BUDGET_H
+
+#include <stddef.h>
+#include <string>
+
+/** The subsystems whose memory is accounted */
+enum MemoryCategory
+{
+  MEM_SURFACES,   /**< Pixel data of surfaces kept in main memory */
+  MEM_TEXTURES,   /**< Textures of the GL and GX renderers, estimated */
+  MEM_SOUNDS,     /**< Samples of the loaded sound effects */
+  MEM_MUSIC,      /**< Music files kept in memory for the decoder */
+  MEM_LISP,       /**< Arenas of the lisp trees that were read */
+  MEM_LEVELS,     /**< Tilemaps and object lists of the loaded levels */
+  MEM_TILES,      /**< The tiles of the TileManager */
+  MEM_CATEGORIES
+};
+
+/** Counts the bytes each subsystem holds. The subsystems report what
+    they allocate and free, the counters keep the current value and the
+    highest one since the level started. Reports may come from any
+    thread.
+
+    debug_mode shows the counters as an overlay, --memory-report prints
+    the high-water marks of every level played. */
+class MemoryBudget
+{
+public:
+  /** Change the bytes of a category, negative for memory freed */
+  static void add(MemoryCategory category, long bytes);
+
+  static long get(MemoryCategory category);
+  static long get_peak(MemoryCategory category);
+  static const char* get_name(MemoryCategory category);
+
+  /** Start the high-water marks over from the current values */
+  static void begin_level();
+
+  /** Print the high-water marks since begin_level(), if reports are on */
+  static void end_level(const std::string& name);
+  static void enable_report(bool enable);
+
+  static void enable_overlay(bool enable);
+  static bool is_overlay_enabled();
+
+  /** Draw the overlay, if it is enabled */
+  static void draw();
+};
+
+#endif /*SUPERTUX_MEMORY_BUDGET_H*/
+
+// EOF
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
 
 #include "defines.h"
 #include "globals.h"
@@ -36,7 +37,9 @@
 #include "sound.h"
 #include "scene.h"
 #include "timer.h"
+#include "transition.h"
 #include "utils.h"
+#include "virtual_screen.h"
 
 #define FLICK_CURSOR_TIME 500
 
@@ -67,7 +70,8 @@ Menu* Menu::current_ = 0;
  */
 bool confirm_dialog(std::string text)
 {
-  Surface* cap_screen = Surface::CaptureScreen();
+  // The dialog is drawn over the frame on screen
+  Transition::capture();
 
   Menu* dialog = new Menu;
   dialog->additem(MN_DEACTIVE, text, 0, 0);
@@ -87,7 +91,7 @@ bool confirm_dialog(std::string text)
       dialog->event(event);
     }
 
-    cap_screen->draw(0, 0);
+    Transition::draw_captured();
 
     dialog->draw();
     dialog->action();
@@ -95,13 +99,11 @@ bool confirm_dialog(std::string text)
     switch (dialog->check())
     {
       case true:
-        delete cap_screen;
         Menu::set_current(0);
         delete dialog;
         return true;
         break;
       case false:
-        delete cap_screen;
         Menu::set_current(0);
         delete dialog;
         return false;
@@ -406,6 +408,7 @@ Menu::~Menu()
       string_list_free(item[i].list);
     }
   }
+  delete background;
 }
 
 /**
@@ -423,6 +426,11 @@ Menu::Menu()
   arrange_left = 0;
   active_item = 0;
   effect.init(false);
+
+  pass = PASS_ALL;
+  background = nullptr;
+  background_x = background_y = 0;
+  layout_key = 0;
 }
 
 /**
@@ -696,6 +704,13 @@ void Menu::draw_item(int index, int menu_width, int menu_height)
     text_font = blue_text;
   }
 
+  // Only the field backgrounds and lines contribute boxes
+  if (pass == PASS_BOXES && pitem.kind != MN_HL && pitem.kind != MN_TEXTFIELD &&
+      pitem.kind != MN_NUMFIELD && pitem.kind != MN_CONTROLFIELD && pitem.kind != MN_STRINGSELECT)
+  {
+    return;
+  }
+
   switch (pitem.kind)
   {
     case MN_DEACTIVE:
@@ -709,8 +724,8 @@ void Menu::draw_item(int index, int menu_width, int menu_height)
       int x = pos_x - menu_width / 2;
       int y = y_pos - 12 - effect_offset;
       /* Draw a horizontal line with a little 3D effect */
-      fillrect(x, y + 6, menu_width, 4, 150, 200, 255, 225);
-      fillrect(x, y + 6, menu_width, 2, 255, 255, 255, 255);
+      box(x, y + 6, menu_width, 4, 150, 200, 255, 225);
+      box(x, y + 6, menu_width, 2, 255, 255, 255, 255);
       break;
     }
 
@@ -727,8 +742,12 @@ void Menu::draw_item(int index, int menu_width, int menu_height)
       int input_pos = input_width / 2;
       int text_pos  = (text_width + font_width) / 2;
 
-      fillrect(x_pos - input_pos + text_pos - 1, y_pos - 10, input_width + font_width + 2, 20, 255, 255, 255, 255);
-      fillrect(x_pos - input_pos + text_pos, y_pos - 9, input_width + font_width, 18, 0, 0, 0, 128);
+      box(x_pos - input_pos + text_pos - 1, y_pos - 10, input_width + font_width + 2, 20, 255, 255, 255, 255);
+      box(x_pos - input_pos + text_pos, y_pos - 9, input_width + font_width, 18, 0, 0, 0, 128);
+      if (pass == PASS_BOXES)
+      {
+        break;
+      }
 
       if (pitem.kind == MN_CONTROLFIELD)
       {
@@ -766,8 +785,12 @@ void Menu::draw_item(int index, int menu_width, int menu_height)
       //arrow_right->draw(x_pos - list_pos + text_pos - 1 + list_pos_2, y_pos - 8);
 
       /* Draw input background */
-      fillrect(x_pos - list_pos + text_pos - 1, y_pos - 10, list_pos_2 + 2, 20, 255, 255, 255, 255);
-      fillrect(x_pos - list_pos + text_pos, y_pos - 9, list_pos_2, 18, 0, 0, 0, 128);
+      box(x_pos - list_pos + text_pos - 1, y_pos - 10, list_pos_2 + 2, 20, 255, 255, 255, 255);
+      box(x_pos - list_pos + text_pos, y_pos - 9, list_pos_2, 18, 0, 0, 0, 128);
+      if (pass == PASS_BOXES)
+      {
+        break;
+      }
 
       gold_text->draw_align(string_list_active(pitem.list), x_pos + text_pos, y_pos, A_HMIDDLE, A_VMIDDLE, 2);
 
@@ -839,22 +862,172 @@ int Menu::get_height() const
   return item.size() * 24;
 }
 
+/**
+ * Draws a box of a menu item, right away or into the retained background,
+ * depending on the current pass.
+ */
+void Menu::box(int x, int y, int w, int h, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+  if (pass == PASS_ALL)
+  {
+    fillrect(x, y, w, h, r, g, b, a);
+  }
+  else if (pass == PASS_BOXES)
+  {
+    Box box = { x, y, w, h, r, g, b, a };
+    boxes.push_back(box);
+  }
+}
+
+/**
+ * Sums up everything the layout of the menu depends on: the position, the
+ * kinds of the items and the lengths of their strings.
+ * @return A hash of the layout.
+ */
+unsigned int Menu::get_layout_key() const
+{
+  // FNV-1a over the values that move boxes around
+  unsigned int hash = 2166136261u;
+  auto mix = [&hash](unsigned int value)
+  {
+    hash = (hash ^ value) * 16777619u;
+  };
+
+  mix(pos_x);
+  mix(pos_y);
+  mix(arrange_left);
+  mix(item.size());
+  for (const MenuItem& pitem : item)
+  {
+    mix(pitem.kind);
+    mix(strnlen(pitem.text, 1024));
+    mix(pitem.input ? strnlen(pitem.input, 1024) + 1 : 0);
+    mix(strnlen(string_list_active(pitem.list), 1024));
+  }
+  return hash;
+}
+
+/**
+ * Composites the menu background and the boxes of all items into one
+ * surface.
+ * @param menu_width The width of the menu.
+ * @param menu_height The height of the menu.
+ */
+void Menu::update_background(int menu_width, int menu_height)
+{
+  delete background;
+  background = nullptr;
+
+  boxes.clear();
+  Box back_box = { pos_x - menu_width / 2, pos_y - 24 * static_cast<int>(item.size()) / 2 - 10,
+                   menu_width, menu_height + 20, 150, 180, 200, 125 };
+  boxes.push_back(back_box);
+
+  pass = PASS_BOXES;
+  for (unsigned int i = 0; i < item.size(); ++i)
+  {
+    draw_item(i, menu_width, menu_height);
+  }
+  pass = PASS_ALL;
+
+  int x1 = back_box.x, y1 = back_box.y;
+  int x2 = back_box.x + back_box.w, y2 = back_box.y + back_box.h;
+  for (const Box& b : boxes)
+  {
+    x1 = std::min(x1, b.x);
+    y1 = std::min(y1, b.y);
+    x2 = std::max(x2, b.x + b.w);
+    y2 = std::max(y2, b.y + b.h);
+  }
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, x2 - x1, y2 - y1, 32,
+                                           0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, x2 - x1, y2 - y1, 32,
+                                           0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+  if (temp == nullptr)
+  {
+    return;
+  }
+  SDL_FillRect(temp, NULL, 0);
+
+  // Blend the boxes over each other like fillrect() blends them over the screen
+  SDL_LockSurface(temp);
+  for (const Box& b : boxes)
+  {
+    for (int y = std::max(b.y, y1); y < b.y + b.h; ++y)
+    {
+      Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(temp->pixels) + (y - y1) * temp->pitch);
+      for (int x = std::max(b.x, x1); x < b.x + b.w; ++x)
+      {
+        Uint8 dr, dg, db, da;
+        SDL_GetRGBA(row[x - x1], temp->format, &dr, &dg, &db, &da);
+
+        int rest = da * (255 - b.a) / 255;
+        int out_a = b.a + rest;
+        if (out_a == 0)
+        {
+          continue;
+        }
+        row[x - x1] = SDL_MapRGBA(temp->format,
+                                  (b.r * b.a + dr * rest) / out_a,
+                                  (b.g * b.a + dg * rest) / out_a,
+                                  (b.b * b.a + db * rest) / out_a,
+                                  out_a);
+      }
+    }
+  }
+  SDL_UnlockSurface(temp);
+
+  background = new Surface(temp, USE_ALPHA);
+  background_x = x1;
+  background_y = y1;
+  SDL_FreeSurface(temp);
+}
+
 /**
  * Draws the current menu on the screen.
- * Renders all menu items and their backgrounds.
+ * The background and the boxes of the items come from a retained image
+ * that is only rebuilt when the layout changes. While the menu slides in,
+ * everything is drawn directly.
  */
 void Menu::draw()
 {
   int menu_height = get_height();
   int menu_width  = get_width();
 
-  /* Draw a transparent background */
-  fillrect(pos_x - menu_width / 2, pos_y - 24 * item.size() / 2 - 10, menu_width, menu_height + 20, 150, 180, 200, 125);
+  if (effect.check())
+  {
+    /* Draw a transparent background */
+    fillrect(pos_x - menu_width / 2, pos_y - 24 * item.size() / 2 - 10, menu_width, menu_height + 20, 150, 180, 200, 125);
+
+    for (unsigned int i = 0; i < item.size(); ++i)
+    {
+      draw_item(i, menu_width, menu_height);
+    }
+    return;
+  }
+
+  unsigned int key = get_layout_key();
+  if (background == nullptr || key != layout_key)
+  {
+    update_background(menu_width, menu_height);
+    layout_key = key;
+  }
+
+  if (background)
+  {
+    background->draw(background_x, background_y);
+    pass = PASS_CONTENT;
+  }
 
   for (unsigned int i = 0; i < item.size(); ++i)
   {
     draw_item(i, menu_width, menu_height);
   }
+  pass = PASS_ALL;
 }
 
 /**
@@ -1014,6 +1187,7 @@ void Menu::event(SDL_Event& event)
     case SDL_MOUSEBUTTONDOWN:
       x = event.motion.x;
       y = event.motion.y;
+      VirtualScreen::to_virtual(&x, &y);
       if (x > pos_x - get_width() / 2 && x < pos_x + get_width() / 2 && y > pos_y - get_height() / 2 && y < pos_y + get_height() / 2)
       {
         menuaction = MENU_ACTION_HIT;
@@ -1023,6 +1197,7 @@ void Menu::event(SDL_Event& event)
     case SDL_MOUSEMOTION:
       x = event.motion.x;
       y = event.motion.y;
+      VirtualScreen::to_virtual(&x, &y);
       if (x > pos_x - get_width() / 2 && x < pos_x + get_width() / 2 && y > pos_y - get_height() / 2 && y < pos_y + get_height() / 2)
       {
         active_item = (y - (pos_y - get_height() / 2)) / 24;
@@ -143,6 +143,34 @@ private:
   int delete_character;
   char mn_input_char;
 
+  /** What draw_item() draws: everything, only the boxes (the field
+      backgrounds and lines that go into the retained background) or
+      everything except them */
+  enum DrawPass {
+    PASS_ALL,
+    PASS_BOXES,
+    PASS_CONTENT
+  };
+  DrawPass pass;
+
+  struct Box
+  {
+    int x, y, w, h;
+    Uint8 r, g, b, a;
+  };
+  std::vector<Box> boxes;  // collected by PASS_BOXES
+
+  /** The translucent menu background with all boxes composited into one
+      image, rebuilt only when layout_key changes */
+  Surface* background;
+  int background_x;
+  int background_y;
+  unsigned int layout_key;
+
+  unsigned int get_layout_key() const;
+  void update_background(int menu_width, int menu_height);
+  void box(int x, int y, int w, int h, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
 public:
   Timer effect;
   int arrange_left;
@@ -17,10 +17,18 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
+#include <string.h>
+#include <algorithm>
 #include "screen.h"
 #include "mousecursor.h"
+#include "virtual_screen.h"
+#include "image_loader.h"
+#include "globals.h"
 
 MouseCursor* MouseCursor::current_ = nullptr;  // Initialize static member to nullptr
+MouseCursor* MouseCursor::drawn_ = nullptr;
+
+static bool system_cursor_shown = false;  // Whether SDL_ShowCursor() is on
 
 /**
  * Constructs a MouseCursor object.
@@ -29,7 +37,8 @@ MouseCursor* MouseCursor::current_ = nullptr;  // Initialize static member to nu
  * Loads the cursor image and initializes its state and position.
  */
 MouseCursor::MouseCursor(std::string cursor_file, int frames)
-  : mid_x(0), mid_y(0), cur_state(MC_NORMAL), cur_frame(0), tot_frames(frames)
+  : mid_x(0), mid_y(0), cur_state(MC_NORMAL), cur_frame(0), tot_frames(frames),
+    default_cursor(SDL_GetCursor()), drawn_x(0), drawn_y(0), file(cursor_file)
 {
   cursor = new Surface(cursor_file, USE_ALPHA);
   if (!cursor) {
@@ -41,7 +50,10 @@ MouseCursor::MouseCursor(std::string cursor_file, int frames)
   timer.init(false);  // Initialize the timer without starting it
   timer.start(MC_FRAME_PERIOD);  // Start the timer with the frame period
 
+  create_system_cursors();
+
   SDL_ShowCursor(SDL_DISABLE);  // Disable the default SDL cursor
+  system_cursor_shown = false;
 }
 
 /**
@@ -51,8 +63,126 @@ MouseCursor::MouseCursor(std::string cursor_file, int frames)
 MouseCursor::~MouseCursor()
 {
   delete cursor;  // Free the cursor surface memory
+  free_system_cursors();
+
+  if (drawn_ == this)
+  {
+    drawn_ = nullptr;
+  }
 
   SDL_ShowCursor(SDL_ENABLE);  // Re-enable the default SDL cursor
+  system_cursor_shown = true;
+}
+
+/**
+ * Creates a platform cursor for each state and frame of the sprite sheet.
+ * Platform cursors have two colours: dark pixels become black, light ones
+ * white and mostly transparent ones transparent.
+ * Nothing is created if the frames can't be used as a platform cursor.
+ */
+void MouseCursor::create_system_cursors()
+{
+#ifndef _WII_
+  SDL_Surface* image = ImageLoader::load(file);
+  if (image == nullptr)
+  {
+    return;
+  }
+
+  int w = image->w / tot_frames;
+  int h = image->h / MC_STATES_NB;
+
+  // The rows of a cursor are whole bytes, and the hot spot is inside it
+  if (w <= 0 || h <= 0 || w % 8 != 0 || mid_x < 0 || mid_x >= w || mid_y < 0 || mid_y >= h)
+  {
+    SDL_FreeSurface(image);
+    return;
+  }
+
+  if (SDL_MUSTLOCK(image))
+  {
+    SDL_LockSurface(image);
+  }
+
+  std::vector<Uint8> data(w / 8 * h);
+  std::vector<Uint8> mask(w / 8 * h);
+  const int bpp = image->format->BytesPerPixel;
+
+  for (int state = 0; state < MC_STATES_NB; ++state)
+  {
+    for (int frame = 0; frame < tot_frames; ++frame)
+    {
+      std::fill(data.begin(), data.end(), 0);
+      std::fill(mask.begin(), mask.end(), 0);
+
+      for (int y = 0; y < h; ++y)
+      {
+        const Uint8* row = static_cast<const Uint8*>(image->pixels) +
+                           (state * h + y) * image->pitch + frame * w * bpp;
+        for (int x = 0; x < w; ++x)
+        {
+          Uint32 pixel = 0;
+          memcpy(&pixel, row + x * bpp, bpp);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+          pixel >>= 8 * (4 - bpp);
+#endif
+          Uint8 r, g, b, a;
+          SDL_GetRGBA(pixel, image->format, &r, &g, &b, &a);
+          if (a < 128)
+          {
+            continue;
+          }
+
+          Uint8 bit = 0x80 >> (x % 8);
+          mask[y * w / 8 + x / 8] |= bit;
+          if (r * 3 + g * 6 + b < 1280)
+          {
+            data[y * w / 8 + x / 8] |= bit;
+          }
+        }
+      }
+
+      system_cursors.push_back(SDL_CreateCursor(&data[0], &mask[0], w, h, mid_x, mid_y));
+    }
+  }
+
+  if (SDL_MUSTLOCK(image))
+  {
+    SDL_UnlockSurface(image);
+  }
+  SDL_FreeSurface(image);
+
+  // All or nothing, present() indexes them by state and frame
+  for (SDL_Cursor* system_cursor : system_cursors)
+  {
+    if (system_cursor == nullptr)
+    {
+      free_system_cursors();
+      break;
+    }
+  }
+#endif
+}
+
+/**
+ * Frees the platform cursors, going back to the default one first.
+ */
+void MouseCursor::free_system_cursors()
+{
+  if (system_cursors.empty())
+  {
+    return;
+  }
+
+  SDL_SetCursor(default_cursor);
+  for (SDL_Cursor* system_cursor : system_cursors)
+  {
+    if (system_cursor)
+    {
+      SDL_FreeCursor(system_cursor);
+    }
+  }
+  system_cursors.clear();
 }
 
 /**
@@ -81,23 +211,29 @@ void MouseCursor::set_state(int nstate)
  */
 void MouseCursor::set_mid(int x, int y)
 {
+  if (x == mid_x && y == mid_y)
+  {
+    return;
+  }
+
   mid_x = x;
   mid_y = y;
+
+  // The hot spot is part of a platform cursor
+  free_system_cursors();
+  create_system_cursors();
 }
 
 /**
- * Draws the cursor on the screen.
- * The cursor is drawn based on its current state and position.
+ * Shows the cursor in the frame being drawn, present() puts it on the
+ * screen once the frame is finished.
  * The cursor's frame is updated periodically based on a timer.
  */
 void MouseCursor::draw()
 {
-  int x, y, w, h;
+  int x, y;
   Uint8 ispressed = SDL_GetMouseState(&x, &y);  // Get the mouse position and button state
-
-  // Calculate the width and height of the cursor frame
-  w = cursor->w / tot_frames;
-  h = cursor->h / MC_STATES_NB;
+  VirtualScreen::to_virtual(&x, &y);
 
   // Check if any mouse button is pressed
   if(ispressed & SDL_BUTTON(1) || ispressed & SDL_BUTTON(2))
@@ -124,8 +260,45 @@ void MouseCursor::draw()
     timer.start(MC_FRAME_PERIOD);  // Restart the timer for the next frame
   }
 
-  // Draw the appropriate part of the cursor based on the current state and frame
-  cursor->draw_part(w * cur_frame, h * cur_state, x - mid_x, y - mid_y, w, h);
+  drawn_ = this;
+  drawn_x = x;
+  drawn_y = y;
+}
+
+/**
+ * Puts the cursor drawn in this frame on the screen, or hides it if
+ * draw() wasn't called. The SDL renderer switches the platform cursor,
+ * otherwise the current state and frame are drawn over the frame.
+ */
+void MouseCursor::present()
+{
+  MouseCursor* mc = drawn_;
+  drawn_ = nullptr;
+
+  bool use_system = mc && !use_gl && !use_gx && !mc->system_cursors.empty();
+  if (use_system)
+  {
+    SDL_Cursor* system_cursor = mc->system_cursors[mc->cur_state * mc->tot_frames + mc->cur_frame];
+    if (SDL_GetCursor() != system_cursor)
+    {
+      SDL_SetCursor(system_cursor);
+    }
+  }
+
+  if (use_system != system_cursor_shown)
+  {
+    SDL_ShowCursor(use_system ? SDL_ENABLE : SDL_DISABLE);
+    system_cursor_shown = use_system;
+  }
+
+  if (mc && !use_system)
+  {
+    // Draw the appropriate part of the cursor based on the current state and frame
+    int w = mc->cursor->w / mc->tot_frames;
+    int h = mc->cursor->h / MC_STATES_NB;
+    mc->cursor->draw_part(w * mc->cur_frame, h * mc->cur_state,
+                          mc->drawn_x - mc->mid_x, mc->drawn_y - mc->mid_y, w, h);
+  }
 }
 
 // EOF
@@ -21,6 +21,7 @@
 #define SUPERTUX_MOUSECURSOR_H
 
 #include <string>
+#include <vector>
 #include "timer.h"
 #include "texture.h"
 
@@ -33,6 +34,14 @@ enum {
   MC_LINK
 };
 
+/** The mouse pointer of the menus, animated from a sprite sheet with a
+    row of frames per state.
+
+    draw() only marks the cursor as visible in the frame being drawn,
+    flipscreen() puts it on the screen with present(). The SDL renderer
+    uses the platform's cursor, made from the frames, so moving it
+    doesn't redraw anything. OpenGL and GX draw the frame over the
+    finished picture instead. */
 class MouseCursor
 {
 public:
@@ -42,7 +51,11 @@ public:
   int state() const; // Returns the current state of the cursor
   void set_state(int nstate); // Sets the cursor's state
   void set_mid(int x, int y); // Sets the midpoint of the cursor
-  void draw(); // Draws the cursor on the screen
+  void draw(); // Shows the cursor in the frame being drawn
+
+  /** Show the cursor drawn since the last call, or hide it, right before
+      the frame is presented */
+  static void present();
 
   static MouseCursor* current() { return current_; };
   static void set_current(MouseCursor* pcursor) { current_ = pcursor; };
@@ -55,6 +68,19 @@ private:
   int cur_frame, tot_frames;
   Surface* cursor;
   Timer timer;
+
+  /** Platform cursors, one per state and frame, empty if the platform
+      has none */
+  std::vector<SDL_Cursor*> system_cursors;
+  SDL_Cursor* default_cursor;
+  void create_system_cursors();
+  void free_system_cursors();
+
+  /** The cursor draw() was called on in this frame, and its position */
+  static MouseCursor* drawn_;
+  int drawn_x, drawn_y;
+
+  std::string file;
 };
 
 #endif /*SUPERTUX_MOUSECURSOR_H*/
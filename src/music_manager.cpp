@@ -18,18 +18,22 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <cassert>
+#include <cstdio>
 #include <stdexcept>
 #include "music_manager.h"
 #include "musicref.h"
 #include "sound.h"
 #include "setup.h"
+#include "asset_archive.h"
+#include "memory_budget.h"
 
 /**
  * Constructs a MusicManager.
  * Initializes the current_music to nullptr and sets music_enabled to true.
  */
 MusicManager::MusicManager()
-  : current_music(nullptr), music_enabled(true)
+  : current_music(nullptr), music_enabled(true), fading(false), fade_loops(-1), fade_time(0),
+    prefetch_thread(nullptr)
 {
 }
 
@@ -39,6 +43,8 @@ MusicManager::MusicManager()
  */
 MusicManager::~MusicManager()
 {
+  wait_prefetch();
+
   if (audio_device)
     Mix_HaltMusic();  // Stop any currently playing music on destruction
 }
@@ -73,7 +79,48 @@ bool MusicManager::exists_music(const std::string& file)
   if (i != musics.end())
     return true;
 
-  Mix_Music* song = Mix_LoadMUS(file.c_str());
+  std::vector<char> data;
+  SDL_RWops* rw = nullptr;
+  Mix_Music* song = nullptr;
+
+  if (!prefetch_file.empty() && prefetch_file == file)
+  {
+    // Usually the thread is long done, the decoder reads from memory
+    wait_prefetch();
+    data.swap(prefetch_data);
+    prefetch_file.clear();
+
+    if (!data.empty())
+    {
+      rw = SDL_RWFromConstMem(data.data(), data.size());
+      song = rw ? Mix_LoadMUS_RW(rw) : nullptr;
+      if (!song && rw)
+      {
+        SDL_FreeRW(rw);
+        rw = nullptr;
+      }
+    }
+  }
+
+  std::string packed;
+  if (!song && AssetArchive::read(file, &packed))
+  {
+    // The decoder keeps reading from memory while the music plays
+    data.assign(packed.begin(), packed.end());
+    rw = SDL_RWFromConstMem(data.data(), data.size());
+    song = rw ? Mix_LoadMUS_RW(rw) : nullptr;
+    if (!song && rw)
+    {
+      SDL_FreeRW(rw);
+      rw = nullptr;
+    }
+  }
+
+  if (!song)
+  {
+    data.clear();
+    song = Mix_LoadMUS(file.c_str());
+  }
   if (!song)
     return false;  // Return false if the music file couldn't be loaded
 
@@ -81,6 +128,9 @@ bool MusicManager::exists_music(const std::string& file)
   MusicResource& resource = result.first->second;
   resource.manager = this;
   resource.music = song;
+  resource.data.swap(data);
+  resource.rw = rw;
+  MemoryBudget::add(MEM_MUSIC, resource.data.size());
 
   return true;
 }
@@ -93,6 +143,9 @@ bool MusicManager::exists_music(const std::string& file)
 void MusicManager::free_music(MusicResource* music)
 {
   Mix_FreeMusic(music->music);  // Free the music resource using SDL_mixer
+  if (music->rw)
+    SDL_FreeRW(music->rw);  // The music read from it until now
+  MemoryBudget::add(MEM_MUSIC, -static_cast<long>(music->data.size()));
 
   for (auto i = musics.begin(); i != musics.end(); ++i)
   {
@@ -108,9 +161,11 @@ void MusicManager::free_music(MusicResource* music)
  * Plays the specified music resource.
  * @param musicref Reference to the music resource to play.
  * @param loops Number of times to loop the music (-1 for infinite loops).
+ * @param fade_ms Fade the old music out and the new one in over this many
+ *                milliseconds, 0 to switch right away.
  * If the specified music is already playing, the method does nothing.
  */
-void MusicManager::play_music(const MusicRef& musicref, int loops)
+void MusicManager::play_music(const MusicRef& musicref, int loops, int fade_ms)
 {
   if (!audio_device)
     return;
@@ -123,9 +178,101 @@ void MusicManager::play_music(const MusicRef& musicref, int loops)
 
   current_music = musicref.music;
   current_music->refcount++;
+  fading = false;
+
+  if (!music_enabled)
+    return;
 
-  if (music_enabled)
+  // SDL_mixer plays one music at a time, so the new music has to wait
+  // until the old one is faded out, see update()
+  if (fade_ms > 0 && Mix_PlayingMusic() && Mix_FadeOutMusic(fade_ms))
+  {
+    fading = true;
+    fade_loops = loops;
+    fade_time = fade_ms;
+  }
+  else
+  {
     Mix_PlayMusic(current_music->music, loops);
+  }
+}
+
+/**
+ * Starts the current music once the previous music has faded out.
+ */
+void MusicManager::update()
+{
+  if (!audio_device || !fading || Mix_PlayingMusic())
+    return;
+
+  fading = false;
+  if (current_music && music_enabled)
+    Mix_FadeInMusic(current_music->music, fade_loops, fade_time);
+}
+
+/**
+ * Starts reading a music file into memory on a background thread.
+ * @param file The name of the music file.
+ * Does nothing if the file is already loaded or being read.
+ */
+void MusicManager::prefetch_music(const std::string& file)
+{
+  if (!audio_device || file == prefetch_file || musics.find(file) != musics.end())
+    return;
+
+  // Only a single file is read ahead at a time, drop the older one
+  wait_prefetch();
+  prefetch_data.clear();
+  prefetch_file = file;
+
+  prefetch_thread = SDL_CreateThread(prefetch_worker, this);
+  if (!prefetch_thread)
+    prefetch_file.clear();
+}
+
+/**
+ * Waits until the prefetch thread has finished reading its file.
+ */
+void MusicManager::wait_prefetch()
+{
+  if (prefetch_thread)
+  {
+    SDL_WaitThread(prefetch_thread, nullptr);
+    prefetch_thread = nullptr;
+  }
+}
+
+/**
+ * Body of the prefetch thread, reads prefetch_file into prefetch_data.
+ * The main thread doesn't touch either until it waited for the thread.
+ * @param data The MusicManager.
+ * @return Always 0.
+ */
+int MusicManager::prefetch_worker(void* data)
+{
+  MusicManager* manager = static_cast<MusicManager*>(data);
+
+  std::string packed;
+  if (AssetArchive::read(manager->prefetch_file, &packed))
+  {
+    manager->prefetch_data.assign(packed.begin(), packed.end());
+    return 0;
+  }
+
+  FILE* file = fopen(manager->prefetch_file.c_str(), "rb");
+  if (file == nullptr)
+    return 0;
+
+  char buffer[16384];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    manager->prefetch_data.insert(manager->prefetch_data.end(), buffer, buffer + count);
+
+  if (ferror(file))
+    manager->prefetch_data.clear();  // Let load_music() read it the usual way
+  fclose(file);
+
+  return 0;
 }
 
 /**
@@ -138,6 +285,7 @@ void MusicManager::halt_music()
     return;
 
   Mix_HaltMusic();  // Stop the current music
+  fading = false;
 
   if (current_music) {
     current_music->refcount--;
@@ -161,6 +309,7 @@ void MusicManager::enable_music(bool enable)
     return;
 
   music_enabled = enable;
+  fading = false;
   if (!music_enabled) {
     Mix_HaltMusic();  // Stop music if disabling
   } else {
@@ -21,8 +21,10 @@
 #ifndef HEADER_MUSIC_MANAGER_H
 #define HEADER_MUSIC_MANAGER_H
 
+#include <SDL.h>
 #include <SDL_mixer.h>
 #include <string>
+#include <vector>
 #include <map>
 
 class MusicRef;
@@ -36,10 +38,18 @@ public:
 
   MusicRef load_music(const std::string& file);  // Load a music file
   bool exists_music(const std::string& filename);  // Check if music file exists
-  void play_music(const MusicRef& music, int loops = -1);  // Play the loaded music
+  void play_music(const MusicRef& music, int loops = -1, int fade_ms = 0);  // Play the loaded music
   void halt_music();  // Stop currently playing music
   void enable_music(bool enable);  // Enable or disable music playback
 
+  /** Read a music file into memory on a background thread, so a later
+      load_music() of it doesn't wait for the disk */
+  void prefetch_music(const std::string& file);
+
+  /** Start music that waits for the previous one to fade out, call once
+      per frame */
+  void update();
+
 private:
   friend class MusicRef;
 
@@ -51,13 +61,25 @@ private:
     MusicManager* manager;  // Manager handling this resource
     Mix_Music* music;       // SDL music resource
     int refcount;           // Reference count for the music
+    std::vector<char> data; // File contents for music loaded from a prefetch
+    SDL_RWops* rw;          // Reads data, nullptr for music loaded from disk
   };
 
   void free_music(MusicResource* music);  // Free a music resource
+  void wait_prefetch();                   // Wait for the prefetch thread
+  static int prefetch_worker(void* data);
 
   std::map<std::string, MusicResource> musics;  // Map to hold music resources
   MusicResource* current_music;  // Currently playing music
   bool music_enabled;            // Flag to enable or disable music
+
+  bool fading;                   // current_music waits for the old music to fade out
+  int fade_loops;
+  int fade_time;
+
+  SDL_Thread* prefetch_thread;    // Reads prefetch_file into prefetch_data
+  std::string prefetch_file;
+  std::vector<char> prefetch_data;
 };
 
 #endif // HEADER_MUSIC_MANAGER_H
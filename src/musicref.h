@@ -32,6 +32,8 @@ public:
 
   MusicRef& operator=(const MusicRef& other);
 
+  explicit operator bool() const { return music != nullptr; }
+
 private:
   friend class MusicManager;
   MusicRef(MusicManager::MusicResource* music);  // Private constructor used by MusicManager
@@ -0,0 +1,279 @@
+//  object_pool.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_OBJECT_POOL_H
+#define SUPERTUX_OBJECT_POOL_H
+
+#include <stddef.h>
+#include <vector>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+/** A fixed number of objects of one type, allocated once. allocate() and
+    release() only move slots from and to a free list, so short lived
+    objects don't go through the heap. Released objects are reset to a
+    default constructed T on their next allocation. */
+template<class T>
+class ObjectPool
+{
+public:
+  explicit ObjectPool(size_t capacity)
+    : slots(capacity)
+  {
+    free_slots.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i)
+    {
+      free_slots.push_back(&slots[i - 1]);
+    }
+  }
+
+  /** Get an unused object, or nullptr if all of them are in use */
+  T* allocate()
+  {
+    if (free_slots.empty())
+    {
+      return nullptr;
+    }
+    T* object = free_slots.back();
+    free_slots.pop_back();
+    *object = T();
+    return object;
+  }
+
+  /** Give an object from allocate() back */
+  void release(T* object)
+  {
+    free_slots.push_back(object);
+  }
+
+  size_t capacity() const { return slots.size(); }
+
+private:
+  std::vector<T> slots;
+  std::vector<T*> free_slots;
+
+  ObjectPool(const ObjectPool&);
+  ObjectPool& operator=(const ObjectPool&);
+};
+
+/** Growing storage for objects that live for a while and are created
+    and destroyed in arbitrary order. Objects are constructed in place in
+    blocks of BLOCK_SIZE, so they sit next to each other in memory and never
+    move: the returned pointers stay valid until destroy(). Freed slots are
+    reused by the next create(). */
+template<class T>
+class SlabPool
+{
+public:
+  static const size_t BLOCK_SIZE = 64;
+
+  SlabPool() {}
+
+  ~SlabPool()
+  {
+    // Objects still alive are owned by the caller, only the blocks are freed
+    for (Slot* block : blocks)
+    {
+      delete[] block;
+    }
+  }
+
+  /** Construct a new object from the given arguments */
+  template<class... Args>
+  T* create(Args&&... args)
+  {
+    if (free_slots.empty())
+    {
+      Slot* block = new Slot[BLOCK_SIZE];
+      blocks.push_back(block);
+      for (size_t i = BLOCK_SIZE; i > 0; --i)
+      {
+        free_slots.push_back(&block[i - 1]);
+      }
+    }
+    Slot* slot = free_slots.back();
+    T* object = new (slot) T(std::forward<Args>(args)...);
+    free_slots.pop_back();
+    return object;
+  }
+
+  /** Destroy an object from create() and give its slot back */
+  void destroy(T* object)
+  {
+    object->~T();
+    free_slots.push_back(reinterpret_cast<Slot*>(object));
+  }
+
+private:
+  struct Slot
+  {
+    alignas(T) unsigned char data[sizeof(T)];
+  };
+
+  std::vector<Slot*> blocks;
+  std::vector<Slot*> free_slots;
+
+  SlabPool(const SlabPool&);
+  SlabPool& operator=(const SlabPool&);
+};
+
+/** Refers to an object of a SwapList. Kept outside of the template so
+    the stored type can hold the handle to itself. */
+struct SwapHandle
+{
+  unsigned int slot;
+  unsigned int generation;
+};
+
+/** Objects stored by value one after another, for lists that are walked
+    every frame and lose objects in arbitrary order. remove() only marks
+    an object, so nothing moves while the list is iterated by index, and
+    flush() fills each gap with the last object, which makes removal O(1).
+    Handles carry the generation of their slot, which changes when the
+    object is removed, so a stale handle is noticed instead of finding
+    the object that took its place. */
+template<class T>
+class SwapList
+{
+public:
+  typedef SwapHandle Handle;
+
+  /** Append a copy of an object */
+  Handle add(const T& object)
+  {
+    unsigned int slot;
+    if (free_slots.empty())
+    {
+      slot = slots.size();
+      slots.push_back(Slot());
+      slots.back().generation = 0;
+    }
+    else
+    {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+
+    slots[slot].index = objects.size();
+    objects.push_back(object);
+    owners.push_back(slot);
+    removed.push_back(false);
+
+    Handle handle = { slot, slots[slot].generation };
+    return handle;
+  }
+
+  /** Get the object of a handle, nullptr once it was removed */
+  T* get(Handle handle)
+  {
+    if (handle.slot >= slots.size() || slots[handle.slot].generation != handle.generation)
+    {
+      return nullptr;
+    }
+    unsigned int index = slots[handle.slot].index;
+    return removed[index] ? nullptr : &objects[index];
+  }
+
+  /** Mark the object of a handle for removal by the next flush(). Stale
+      handles are ignored. */
+  void remove(Handle handle)
+  {
+    if (get(handle) != nullptr)
+    {
+      mark(slots[handle.slot].index);
+    }
+  }
+
+  bool is_removed(size_t index) const { return removed[index]; }
+
+  /** Take the marked objects out. The highest indices go first, so the
+      last object that moves into a gap is never marked itself. */
+  void flush()
+  {
+    std::sort(pending.begin(), pending.end(), std::greater<unsigned int>());
+    for (unsigned int index : pending)
+    {
+      unsigned int slot = owners[index];
+      ++slots[slot].generation;
+      free_slots.push_back(slot);
+
+      unsigned int last = objects.size() - 1;
+      if (index != last)
+      {
+        objects[index] = std::move(objects[last]);
+        owners[index] = owners[last];
+        removed[index] = false;
+        slots[owners[index]].index = index;
+      }
+      objects.pop_back();
+      owners.pop_back();
+      removed.pop_back();
+    }
+    pending.clear();
+  }
+
+  /** Remove all objects right away */
+  void clear()
+  {
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+      mark(i);
+    }
+    flush();
+  }
+
+  size_t size() const { return objects.size(); }
+
+  /** Number of objects that aren't marked for removal */
+  size_t live_size() const { return objects.size() - pending.size(); }
+
+  T& operator[](size_t index) { return objects[index]; }
+  const T& operator[](size_t index) const { return objects[index]; }
+
+private:
+  void mark(size_t index)
+  {
+    if (!removed[index])
+    {
+      removed[index] = true;
+      pending.push_back(index);
+    }
+  }
+
+  struct Slot
+  {
+    unsigned int index;       // of the object in objects
+    unsigned int generation;
+  };
+
+  std::vector<T> objects;
+  std::vector<unsigned int> owners;   // slot of each object
+  std::vector<bool> removed;
+  std::vector<unsigned int> pending;  // indices marked by remove()
+  std::vector<Slot> slots;
+  std::vector<unsigned int> free_slots;
+};
+
+#endif /*SUPERTUX_OBJECT_POOL_H*/
+
+// EOF
@@ -0,0 +1,158 @@
+//  object_registry.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <algorithm>
+#include "object_registry.h"
+#include "job_system.h"
+#include "scene.h"
+#include "globals.h"
+
+/**
+ * Runs the action of every object that is alive. Objects added meanwhile
+ * are appended and run in the same step.
+ * @param elapsed_time The length of the step.
+ */
+void ObjectGroup::update(float elapsed_time)
+{
+  for (size_t i = 0; i < size(); ++i)
+  {
+    if (is_alive(i))
+    {
+      get(i).action(elapsed_time);
+    }
+  }
+}
+
+/**
+ * Draws the objects of the group that are alive and on the screen.
+ */
+void ObjectGroup::draw()
+{
+  for (size_t i = 0; i < size(); ++i)
+  {
+    if (is_alive(i) && is_visible(get(i)))
+    {
+      get(i).draw();
+    }
+  }
+}
+
+/**
+ * Tells whether an object reaches into the screen horizontally.
+ * @param object The object to check.
+ * @return True if the object has to be drawn.
+ */
+bool ObjectGroup::is_visible(const GameObject& object) const
+{
+  float left = screen_space ? 0 : scroll_x;
+  float width = cull_width > 0 ? cull_width : object.base.width;
+  return object.base.x + width >= left && object.base.x <= left + screen->w;
+}
+
+/**
+ * Destructor for ObjectRegistry, the objects themselves belong to the
+ * containers of the groups.
+ */
+ObjectRegistry::~ObjectRegistry()
+{
+  for (ObjectGroup* group : groups)
+  {
+    delete group;
+  }
+}
+
+/**
+ * Adds a group to the registry.
+ * @param group The group, deleted with the registry.
+ * @param independent_ True if the group can be updated on another thread.
+ */
+void ObjectRegistry::add(ObjectGroup* group, bool independent_)
+{
+  groups.push_back(group);
+  independent.push_back(independent_);
+  draw_order.push_back(group);
+  std::stable_sort(draw_order.begin(), draw_order.end(),
+                   [](const ObjectGroup* lhs, const ObjectGroup* rhs)
+                   {
+                     return lhs->layer < rhs->layer;
+                   });
+}
+
+/**
+ * Runs one phase of a logic step.
+ * @param phase The phase to run.
+ * @param elapsed_time The length of the step.
+ */
+void ObjectRegistry::update(UpdatePhase phase, float elapsed_time)
+{
+  if (phase == PHASE_CLEANUP)
+  {
+    for (ObjectGroup* group : groups)
+    {
+      group->cleanup();
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < groups.size(); ++i)
+  {
+    if (independent[i] && groups[i]->phase == phase)
+    {
+      ObjectGroup* group = groups[i];
+      JobSystem::add([group, elapsed_time]()
+                     {
+                       group->update(elapsed_time);
+                     });
+    }
+  }
+  JobSystem::run();
+
+  for (size_t i = 0; i < groups.size(); ++i)
+  {
+    if (!independent[i] && groups[i]->phase == phase)
+    {
+      groups[i]->update(elapsed_time);
+    }
+  }
+}
+
+/**
+ * Takes out the objects of all groups.
+ */
+void ObjectRegistry::clear()
+{
+  for (ObjectGroup* group : groups)
+  {
+    group->clear();
+  }
+}
+
+/**
+ * Draws all groups, from the back layer to the front one.
+ */
+void ObjectRegistry::draw()
+{
+  for (ObjectGroup* group : draw_order)
+  {
+    group->draw();
+  }
+}
+
+// EOF
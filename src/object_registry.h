@@ -0,0 +1,220 @@
+//  object_registry.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_OBJECT_REGISTRY_H
+#define SUPERTUX_OBJECT_REGISTRY_H
+
+#include <stddef.h>
+#include <vector>
+#include "type.h"
+#include "object_pool.h"
+
+/** The phases of a logic step, in the order they run */
+enum UpdatePhase
+{
+  PHASE_THINK,    /**< Objects that are controlled, everything else reacts to them */
+  PHASE_PHYSICS,  /**< Objects that move by themselves */
+  PHASE_COLLIDE,  /**< Collisions between the objects */
+  PHASE_CLEANUP   /**< Objects that are done are taken out */
+};
+
+/** Where the objects of a group are drawn, from back to front */
+enum DrawLayer
+{
+  LAYER_BLOCKS,
+  LAYER_BADGUYS,
+  LAYER_PLAYER,
+  LAYER_BULLETS,
+  LAYER_SCORES,
+  LAYER_UPGRADES,
+  LAYER_COINS,
+  LAYER_DEBRIS
+};
+
+/** All objects of one type. The objects stay in the dense container of
+    their type, a group only tells the registry how to walk it, when it is
+    updated and where it is drawn. */
+class ObjectGroup
+{
+public:
+  /**
+   * @param phase The phase update() runs in.
+   * @param layer The layer the objects are drawn in.
+   * @param cull_width Objects are only drawn if this much to their right
+   *                   is on the screen, 0 uses their own width.
+   * @param screen_space True if the objects are placed in screen
+   *                     coordinates instead of level coordinates.
+   */
+  ObjectGroup(UpdatePhase phase_, DrawLayer layer_, float cull_width_ = 0, bool screen_space_ = false)
+    : phase(phase_), layer(layer_), cull_width(cull_width_), screen_space(screen_space_)
+  {}
+  virtual ~ObjectGroup() {}
+
+  virtual size_t size() const = 0;
+  virtual GameObject& get(size_t index) = 0;
+
+  /** Is the object still part of the game? Removed objects keep their
+      index until cleanup(). */
+  virtual bool is_alive(size_t) const { return true; }
+
+  /** Run the action of every object */
+  virtual void update(float elapsed_time);
+
+  /** Take out the objects that are done */
+  virtual void cleanup() = 0;
+
+  /** Take out all objects */
+  virtual void clear() = 0;
+
+  /** Draw the objects that are on the screen */
+  virtual void draw();
+
+  const UpdatePhase phase;
+  const DrawLayer layer;
+
+protected:
+  /** Is the object inside the screen? */
+  bool is_visible(const GameObject& object) const;
+
+private:
+  float cull_width;
+  bool screen_space;
+};
+
+/** A group of objects from an ObjectPool, marked by their removable flag */
+template<class T>
+class PooledGroup : public ObjectGroup
+{
+public:
+  PooledGroup(std::vector<T*>& objects_, ObjectPool<T>& pool_,
+              UpdatePhase phase_, DrawLayer layer_, float cull_width_ = 0, bool screen_space_ = false)
+    : ObjectGroup(phase_, layer_, cull_width_, screen_space_), objects(objects_), pool(pool_)
+  {}
+
+  size_t size() const { return objects.size(); }
+  GameObject& get(size_t index) { return *objects[index]; }
+  bool is_alive(size_t index) const { return !objects[index]->removable; }
+
+  /** Release the removable objects, by moving the last object into their place */
+  void cleanup()
+  {
+    for (size_t i = 0; i < objects.size(); )
+    {
+      if (objects[i]->removable)
+      {
+        pool.release(objects[i]);
+        objects[i] = objects.back();
+        objects.pop_back();
+      }
+      else
+      {
+        ++i;
+      }
+    }
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+      pool.release(objects[i]);
+    }
+    objects.clear();
+  }
+
+private:
+  std::vector<T*>& objects;
+  ObjectPool<T>& pool;
+};
+
+/** A group of objects stored in a SwapList */
+template<class T>
+class ListGroup : public ObjectGroup
+{
+public:
+  ListGroup(SwapList<T>& list_, UpdatePhase phase_, DrawLayer layer_, float cull_width_ = 0)
+    : ObjectGroup(phase_, layer_, cull_width_), list(list_)
+  {}
+
+  size_t size() const { return list.size(); }
+  GameObject& get(size_t index) { return list[index]; }
+  bool is_alive(size_t index) const { return !list.is_removed(index); }
+  void cleanup() { list.flush(); }
+  void clear() { list.clear(); }
+
+private:
+  SwapList<T>& list;
+};
+
+/** All game objects of a World, by type. Updating, drawing and cleaning
+    up goes over the groups in a fixed order, so every type of object is
+    treated the same way. */
+class ObjectRegistry
+{
+public:
+  ObjectRegistry() {}
+  ~ObjectRegistry();
+
+  /** Add a group, takes ownership. Groups are updated in the order they
+      were added and drawn by their layer. The objects of an independent
+      group only change themselves, so the group can be updated as a job
+      of the JobSystem. */
+  void add(ObjectGroup* group, bool independent = false);
+
+  /** Update the groups of a phase, PHASE_CLEANUP cleans up all of them.
+      The independent groups run as jobs first, together with the jobs the
+      caller queued, then the others follow on the calling thread. */
+  void update(UpdatePhase phase, float elapsed_time);
+
+  /** Take out all objects of all groups */
+  void clear();
+
+  void draw();
+
+  /** Call func for every object that is alive */
+  template<class F>
+  void for_each(F func)
+  {
+    for (ObjectGroup* group : groups)
+    {
+      for (size_t i = 0; i < group->size(); ++i)
+      {
+        if (group->is_alive(i))
+        {
+          func(group->get(i));
+        }
+      }
+    }
+  }
+
+private:
+  std::vector<ObjectGroup*> groups;
+  std::vector<bool> independent;
+
+  /** groups sorted by layer */
+  std::vector<ObjectGroup*> draw_order;
+
+  ObjectRegistry(const ObjectRegistry&);
+  ObjectRegistry& operator=(const ObjectRegistry&);
+};
+
+#endif /*SUPERTUX_OBJECT_REGISTRY_H*/
+
+// EOF
@@ -0,0 +1,325 @@
+//  particle_emitters.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "particle_emitters.h"
+#include "globals.h"
+#include "resources.h"
+#include "texture.h"
+
+namespace
+{
+
+/** How each kind of emitter spawns its particles, speeds are in pixels
+    and times in the units of the elapsed time passed to simulate() */
+struct EmitterType
+{
+  const char* name;
+  const char* image;
+  float rate;       // particles per time unit and 32x32 pixels of area
+  float gravity;
+  float life;
+};
+
+const EmitterType emitter_types[NUM_EMITTER_KINDS] = {
+  { "waterfall", "/images/shared/snow1.png",  0.08f,  0.10f,   0.0f },
+  { "lava",      "/images/shared/bullet-1.png", 0.01f, 0.08f,  60.0f },
+  { "dust",      "/images/shared/snow1.png",  0.005f, 0.002f, 150.0f }
+};
+
+float random_float(float min, float max)
+{
+  return min + (max - min) * (st_rand() % 1000) / 1000.0f;
+}
+
+} // namespace
+
+/**
+ * Converts the name used in level files to an emitter kind.
+ * @param str The name of the kind.
+ * @return The kind, EMITTER_INVALID for unknown names.
+ */
+EmitterKind emitterkind_from_string(const std::string& str)
+{
+  for (int i = 0; i < NUM_EMITTER_KINDS; ++i)
+  {
+    if (str == emitter_types[i].name)
+    {
+      return static_cast<EmitterKind>(i);
+    }
+  }
+  return EMITTER_INVALID;
+}
+
+/**
+ * Converts an emitter kind to the name used in level files.
+ * @param kind The kind.
+ * @return The name of the kind.
+ */
+std::string emitterkind_to_string(EmitterKind kind)
+{
+  if (kind < 0 || kind >= NUM_EMITTER_KINDS)
+  {
+    return "invalid";
+  }
+  return emitter_types[kind].name;
+}
+
+/**
+ * Constructor for ParticleEmitters, starts without any emitter.
+ */
+ParticleEmitters::ParticleEmitters()
+{
+  x.reserve(PARTICLE_CAP);
+  y.reserve(PARTICLE_CAP);
+  xm.reserve(PARTICLE_CAP);
+  ym.reserve(PARTICLE_CAP);
+  gravity.reserve(PARTICLE_CAP);
+  life.reserve(PARTICLE_CAP);
+  owner.reserve(PARTICLE_CAP);
+}
+
+/**
+ * Destructor for ParticleEmitters.
+ */
+ParticleEmitters::~ParticleEmitters()
+{
+}
+
+/**
+ * Adds an emitter, its image is loaded with the first emitter of its kind.
+ * @param data The emitter as read from the level.
+ */
+void ParticleEmitters::add(const EmitterData& data)
+{
+  if (data.kind < 0 || data.kind >= NUM_EMITTER_KINDS || data.width <= 0 || data.height <= 0)
+  {
+    return;
+  }
+
+  if (!images[data.kind])
+  {
+    images[data.kind] = surface_manager->load_surface(datadir + emitter_types[data.kind].image, USE_ALPHA);
+  }
+
+  Emitter emitter;
+  emitter.kind = data.kind;
+  emitter.x = data.x;
+  emitter.y = data.y;
+  emitter.width = data.width;
+  emitter.height = data.height;
+  emitter.spawn_credit = 0;
+  emitter.active = false;
+  emitters.push_back(emitter);
+}
+
+/**
+ * Removes all emitters and their particles.
+ */
+void ParticleEmitters::clear()
+{
+  emitters.clear();
+  x.clear();
+  y.clear();
+  xm.clear();
+  ym.clear();
+  gravity.clear();
+  life.clear();
+  owner.clear();
+}
+
+/**
+ * Creates a particle of an emitter, the pool must not be full.
+ * @param index The index of the emitter.
+ */
+void ParticleEmitters::spawn(unsigned short index)
+{
+  const Emitter& emitter = emitters[index];
+  const EmitterType& type = emitter_types[emitter.kind];
+
+  float px = emitter.x + random_float(0, emitter.width);
+  float py, pxm, pym, plife;
+
+  switch (emitter.kind)
+  {
+    case EMITTER_WATERFALL:
+      // Falls from the top to the bottom of the emitter
+      py = emitter.y;
+      pxm = 0;
+      pym = random_float(1.0f, 2.0f);
+      plife = (sqrtf(pym * pym + 2 * type.gravity * emitter.height) - pym) / type.gravity;
+      break;
+
+    case EMITTER_LAVA:
+      // Jumps out of the lava at the bottom of the emitter
+      py = emitter.y + emitter.height;
+      pxm = random_float(-0.5f, 0.5f);
+      pym = -random_float(0.5f, 1.0f) * sqrtf(2 * type.gravity * emitter.height);
+      plife = type.life;
+      break;
+
+    default:
+      py = emitter.y + random_float(0, emitter.height);
+      pxm = random_float(-0.2f, 0.2f);
+      pym = random_float(0.05f, 0.2f);
+      plife = type.life;
+      break;
+  }
+
+  x.push_back(px);
+  y.push_back(py);
+  xm.push_back(pxm);
+  ym.push_back(pym);
+  gravity.push_back(type.gravity);
+  life.push_back(plife);
+  owner.push_back(index);
+}
+
+/**
+ * Removes a particle by moving the last one into its place.
+ * @param i The index of the particle.
+ */
+void ParticleEmitters::remove(size_t i)
+{
+  x[i] = x.back();
+  y[i] = y.back();
+  xm[i] = xm.back();
+  ym[i] = ym.back();
+  gravity[i] = gravity.back();
+  life[i] = life.back();
+  owner[i] = owner.back();
+
+  x.pop_back();
+  y.pop_back();
+  xm.pop_back();
+  ym.pop_back();
+  gravity.pop_back();
+  life.pop_back();
+  owner.pop_back();
+}
+
+/**
+ * Activates the emitters near the camera, spawns their particles and
+ * moves all particles.
+ * @param elapsed_time The time passed since the last simulation update.
+ * @param scroll_x The horizontal scroll position in pixels.
+ */
+void ParticleEmitters::simulate(float elapsed_time, float scroll_x)
+{
+  if (emitters.empty())
+  {
+    return;
+  }
+
+  float left = scroll_x - ACTIVE_DISTANCE;
+  float right = scroll_x + screen->w + ACTIVE_DISTANCE;
+  for (Emitter& emitter : emitters)
+  {
+    emitter.active = emitter.x + emitter.width >= left && emitter.x <= right;
+  }
+
+  // Age and drop the particles of expired or inactive emitters
+  for (size_t i = 0; i < x.size(); )
+  {
+    life[i] -= elapsed_time;
+    if (life[i] <= 0 || !emitters[owner[i]].active)
+    {
+      remove(i);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+  float* px = x.data();
+  float* py = y.data();
+  float* pym = ym.data();
+  const float* pxm = xm.data();
+  const float* pgravity = gravity.data();
+  size_t count = x.size();
+  for (size_t i = 0; i < count; ++i)
+  {
+    px[i] += pxm[i] * elapsed_time;
+    py[i] += pym[i] * elapsed_time;
+    pym[i] += pgravity[i] * elapsed_time;
+  }
+
+  for (unsigned short i = 0; i < emitters.size(); ++i)
+  {
+    Emitter& emitter = emitters[i];
+    if (!emitter.active)
+    {
+      emitter.spawn_credit = 0;
+      continue;
+    }
+
+    const float area = (emitter.width / 32) * (emitter.height / 32);
+    emitter.spawn_credit += emitter_types[emitter.kind].rate * std::max(area, 1.0f) * elapsed_time;
+    while (emitter.spawn_credit >= 1)
+    {
+      if (x.size() >= PARTICLE_CAP)
+      {
+        // Don't let the debt grow while the pool is full
+        emitter.spawn_credit = 0;
+        break;
+      }
+      spawn(i);
+      emitter.spawn_credit -= 1;
+    }
+  }
+}
+
+/**
+ * Draws the particles, all particles of one kind after another so that
+ * their quads share a texture.
+ * @param scroll_x The horizontal scroll position in pixels.
+ */
+void ParticleEmitters::draw(float scroll_x)
+{
+  for (int kind = 0; kind < NUM_EMITTER_KINDS; ++kind)
+  {
+    Surface* image = images[kind].get();
+    if (image == nullptr)
+    {
+      continue;
+    }
+
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+      if (emitters[owner[i]].kind != kind)
+      {
+        continue;
+      }
+
+      float sx = x[i] - scroll_x;
+      if (sx + image->w < 0 || sx >= screen->w)
+      {
+        continue;
+      }
+      image->draw(sx, y[i]);
+    }
+  }
+}
+
+// EOF
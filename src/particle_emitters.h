@@ -0,0 +1,113 @@
+//  particle_emitters.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_PARTICLE_EMITTERS_H
+#define SUPERTUX_PARTICLE_EMITTERS_H
+
+#include <string>
+#include <vector>
+#include "surfaceref.h"
+
+enum EmitterKind {
+  EMITTER_WATERFALL,
+  EMITTER_LAVA,
+  EMITTER_DUST,
+  NUM_EMITTER_KINDS,
+  EMITTER_INVALID = NUM_EMITTER_KINDS
+};
+
+EmitterKind emitterkind_from_string(const std::string& str);
+std::string emitterkind_to_string(EmitterKind kind);
+
+/** An emitter as it is stored in the level:
+    (emitters (waterfall (x 320) (y 64) (width 32) (height 256)) ...) */
+struct EmitterData
+{
+  EmitterKind kind;
+  int x;
+  int y;
+  int width;
+  int height;
+
+  EmitterData()
+    : kind(EMITTER_DUST), x(0), y(0), width(32), height(32) {}
+};
+
+/** The particle effects placed in a level, like waterfalls or lava
+    sparks. Each emitter covers a rectangle of the level and only spawns
+    and simulates particles while that rectangle is near the camera, the
+    particles of an emitter that goes out of range are dropped.
+
+    All emitters share one pool of at most PARTICLE_CAP particles, stored
+    as one array per attribute like in ParticleSystem. An emitter that
+    finds the pool full simply spawns nothing until there is room. */
+class ParticleEmitters
+{
+public:
+  static const size_t PARTICLE_CAP = 512;
+
+  /** Distance from the screen within which emitters are active */
+  static const int ACTIVE_DISTANCE = 64;
+
+  ParticleEmitters();
+  ~ParticleEmitters();
+
+  void add(const EmitterData& data);
+  void clear();
+
+  /** Spawn and move the particles of the emitters near scroll_x */
+  void simulate(float elapsed_time, float scroll_x);
+  void draw(float scroll_x);
+
+  size_t get_particle_count() const { return x.size(); }
+
+private:
+  struct Emitter
+  {
+    EmitterKind kind;
+    float x, y, width, height;
+    float spawn_credit;   // particles owed by the spawn rate
+    bool active;
+  };
+
+  std::vector<Emitter> emitters;
+
+  // Particle attributes, index i of every array belongs to particle i
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> xm;
+  std::vector<float> ym;
+  std::vector<float> gravity;
+  std::vector<float> life;
+  std::vector<unsigned short> owner;
+
+  SurfaceRef images[NUM_EMITTER_KINDS];
+
+  void spawn(unsigned short index);
+  void remove(size_t i);
+
+  ParticleEmitters(const ParticleEmitters&);
+  ParticleEmitters& operator=(const ParticleEmitters&);
+};
+
+#endif /*SUPERTUX_PARTICLE_EMITTERS_H*/
+
+// EOF
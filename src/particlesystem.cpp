@@ -21,6 +21,8 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
+#include <functional>
 #include "globals.h"
 #include "world.h"
 #include "level.h"
@@ -39,17 +41,122 @@ ParticleSystem::ParticleSystem()
 
 /**
  * Destroys the ParticleSystem object.
- * Cleans up any dynamically allocated memory associated with particles.
  */
 ParticleSystem::~ParticleSystem()
 {
-  // Delete all particles to free up memory
-  for (auto* particle : particles)
+}
+
+/**
+ * Adds a particle, sort_particles() has to be called once all of them are added.
+ * @param px Horizontal position inside the virtual rectangle.
+ * @param py Vertical position inside the virtual rectangle.
+ * @param player The layer in which the particle is drawn.
+ * @param ptexture The image of the particle.
+ * @param pspeed The speed of the particle, its meaning is up to the subclass.
+ */
+void ParticleSystem::add_particle(float px, float py, int player, Surface* ptexture, float pspeed)
+{
+  x.push_back(px);
+  y.push_back(py);
+  layer.push_back(player);
+  texture.push_back(ptexture);
+  speed.push_back(pspeed);
+}
+
+/**
+ * Sorts the particles by layer and texture and finds the runs of particles
+ * that draw() handles at once.
+ */
+void ParticleSystem::sort_particles()
+{
+  std::vector<size_t> order(x.size());
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    order[i] = i;
+  }
+
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+  {
+    if (layer[a] != layer[b])
+    {
+      return layer[a] < layer[b];
+    }
+    return std::less<Surface*>()(texture[a], texture[b]);
+  });
+
+  std::vector<float> sorted_x, sorted_y, sorted_speed;
+  std::vector<int> sorted_layer;
+  std::vector<Surface*> sorted_texture;
+  for (size_t i : order)
+  {
+    sorted_x.push_back(x[i]);
+    sorted_y.push_back(y[i]);
+    sorted_speed.push_back(speed[i]);
+    sorted_layer.push_back(layer[i]);
+    sorted_texture.push_back(texture[i]);
+  }
+  x.swap(sorted_x);
+  y.swap(sorted_y);
+  speed.swap(sorted_speed);
+  layer.swap(sorted_layer);
+  texture.swap(sorted_texture);
+
+  groups.clear();
+  for (size_t i = 0; i < x.size(); ++i)
+  {
+    if (groups.empty() || groups.back().layer != layer[i] || groups.back().texture != texture[i])
+    {
+      Group group;
+      group.layer = layer[i];
+      group.texture = texture[i];
+      group.first = i;
+      group.count = 0;
+      groups.push_back(group);
+    }
+    ++groups.back().count;
+  }
+}
+
+/**
+ * Moves coordinates that left the virtual rectangle by less than its size
+ * back into it.
+ * @param coords The x or y array.
+ * @param size virtual_width or virtual_height.
+ */
+void ParticleSystem::wrap(std::vector<float>& coords, float size)
+{
+  float* c = coords.data();
+  size_t count = coords.size();
+  for (size_t i = 0; i < count; ++i)
+  {
+    float v = c[i];
+    v += (v < 0) ? size : 0.0f;
+    v -= (v >= size) ? size : 0.0f;
+    c[i] = v;
+  }
+}
+
+namespace
+{
+
+/**
+ * Maps a coordinate into 0..size, it must not be further off than one size.
+ */
+inline float remap(float v, float size)
+{
+  if (v < 0)
+  {
+    v += size;
+  }
+  else if (v >= size)
   {
-    delete particle;
+    v -= size;
   }
+  return v;
 }
 
+} // namespace
+
 /**
  * Draws the particles on the screen.
  * This function remaps particle coordinates based on the scrolling offsets
@@ -60,49 +167,53 @@ ParticleSystem::~ParticleSystem()
  */
 void ParticleSystem::draw(float scrollx, float scrolly, int layer)
 {
-  for (auto* particle : particles)
+  // Particles stay inside the virtual rectangle, so only the scroll
+  // offsets need a real modulo
+  float offset_x = std::fmod(scrollx, virtual_width);
+  float offset_y = std::fmod(scrolly, virtual_height);
+
+  for (const Group& group : groups)
   {
-    if (particle->layer != layer)
+    if (group.layer != layer)
     {
       continue;
     }
 
-    // Remap x,y coordinates onto screen coordinates
-    float x = std::fmod(particle->x - scrollx, virtual_width);
-    if (x < 0)
-    {
-      x += virtual_width;
-    }
+    Surface* image = group.texture;
+    float width = image->w;
+    float height = image->h;
+    const float* px = &x[group.first];
+    const float* py = &y[group.first];
 
-    float y = std::fmod(particle->y - scrolly, virtual_height);
-    if (y < 0)
+    for (size_t i = 0; i < group.count; ++i)
     {
-      y += virtual_height;
-    }
+      // Remap x,y coordinates onto screen coordinates
+      float sx = remap(px[i] - offset_x, virtual_width);
+      float sy = remap(py[i] - offset_y, virtual_height);
+      float xmax = remap(sx + width, virtual_width);
+      float ymax = remap(sy + height, virtual_height);
 
-    float xmax = std::fmod(x + particle->texture->w, virtual_width);
-    float ymax = std::fmod(y + particle->texture->h, virtual_height);
+      // Particle on screen
+      if (sx >= screen->w && xmax >= screen->w)
+      {
+        continue;
+      }
+      if (sy >= screen->h && ymax >= screen->h)
+      {
+        continue;
+      }
 
-    // Particle on screen
-    if (x >= screen->w && xmax >= screen->w)
-    {
-      continue;
-    }
-    if (y >= screen->h && ymax >= screen->h)
-    {
-      continue;
-    }
+      if (sx > screen->w)
+      {
+        sx -= virtual_width;
+      }
+      if (sy > screen->h)
+      {
+        sy -= virtual_height;
+      }
 
-    if (x > screen->w)
-    {
-      x -= virtual_width;
+      image->draw(sx, sy);
     }
-    if (y > screen->h)
-    {
-      y -= virtual_height;
-    }
-
-    particle->texture->draw(x, y);
   }
 }
 
@@ -119,31 +230,27 @@ SnowParticleSystem::SnowParticleSystem()
   snowimages[2] = new Surface(datadir + "/images/shared/snow2.png", USE_ALPHA);
 
   virtual_width = screen->w * 2;
-
-  // Reserve space in the vector to avoid reallocations
-  particles.reserve(static_cast<size_t>(virtual_width / 10.0));
+  rand_state = rand();
 
   // Create some random snowflakes
   size_t snowflakecount = static_cast<size_t>(virtual_width / 10.0);
+  float gravity = World::current()->get_level()->gravity;
   for (size_t i = 0; i < snowflakecount; ++i)
   {
-    SnowParticle* particle = new SnowParticle;
-    particle->x = rand() % static_cast<int>(virtual_width);
-    particle->y = rand() % screen->h;
-    particle->layer = i % 2;
+    float px = rand() % static_cast<int>(virtual_width);
+    float py = rand() % screen->h;
     int snowsize = rand() % 3;
-    particle->texture = snowimages[snowsize];
 
+    float pspeed;
     do
     {
-      particle->speed = snowsize / 60.0f + (static_cast<float>(rand() % 10) / 300.0f);
+      pspeed = snowsize / 60.0f + (static_cast<float>(rand() % 10) / 300.0f);
     }
-    while (particle->speed < 0.01f);
+    while (pspeed < 0.01f);
 
-    particle->speed *= World::current()->get_level()->gravity;
-
-    particles.push_back(particle);
+    add_particle(px, py, i % 2, snowimages[snowsize], pspeed * gravity);
   }
+  sort_particles();
 }
 
 /**
@@ -157,8 +264,6 @@ SnowParticleSystem::~SnowParticleSystem()
   {
     delete snowimages[i];
   }
-
-  // Delete particles, handled by base class destructor
 }
 
 /**
@@ -169,18 +274,38 @@ SnowParticleSystem::~SnowParticleSystem()
  */
 void SnowParticleSystem::simulate(float elapsed_time)
 {
-  for (auto* particle : particles)
+  float* py = y.data();
+  const float* pspeed = speed.data();
+  size_t count = y.size();
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    py[i] += pspeed[i] * elapsed_time;
+  }
+
+  // Only a few flakes reach the bottom in one frame
+  float bottom = screen->h;
+  for (size_t i = 0; i < count; ++i)
   {
-    SnowParticle* snow_particle = static_cast<SnowParticle*>(particle);
-    snow_particle->y += snow_particle->speed * elapsed_time;
-    if (snow_particle->y > screen->h)
+    if (py[i] > bottom)
     {
-      snow_particle->y = std::fmod(snow_particle->y, virtual_height);
-      snow_particle->x = rand() % static_cast<int>(virtual_width);
+      py[i] = std::fmod(py[i], virtual_height);
+      x[i] = next_rand() % static_cast<int>(virtual_width);
     }
   }
 }
 
+/**
+ * Returns the next random number of the snow, from the same generator
+ * as st_rand() but with a state of its own.
+ * @return A number from 0 to 32767.
+ */
+int SnowParticleSystem::next_rand()
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state / 65536) % 32768;
+}
+
 /**
  * Constructs a CloudParticleSystem object.
  * Initializes cloud particles with random positions and speeds.
@@ -193,21 +318,14 @@ CloudParticleSystem::CloudParticleSystem()
 
   virtual_width = 2000.0f;
 
-  // Reserve space in the vector to avoid reallocations
-  particles.reserve(15);
-
   // Create some random clouds
   for (size_t i = 0; i < 15; ++i)
   {
-    CloudParticle* particle = new CloudParticle;
-    particle->x = rand() % static_cast<int>(virtual_width);
-    particle->y = rand() % static_cast<int>(virtual_height);
-    particle->layer = 0;
-    particle->texture = cloudimage;
-    particle->speed = -static_cast<float>(250 + rand() % 200) / 1000.0f;
-
-    particles.push_back(particle);
+    float px = rand() % static_cast<int>(virtual_width);
+    float py = rand() % static_cast<int>(virtual_height);
+    add_particle(px, py, 0, cloudimage, -static_cast<float>(250 + rand() % 200) / 1000.0f);
   }
+  sort_particles();
 }
 
 /**
@@ -218,8 +336,6 @@ CloudParticleSystem::~CloudParticleSystem()
 {
   // Delete cloud texture
   delete cloudimage;
-
-  // Delete particles, handled by base class destructor
 }
 
 /**
@@ -229,11 +345,15 @@ CloudParticleSystem::~CloudParticleSystem()
  */
 void CloudParticleSystem::simulate(float elapsed_time)
 {
-  for (auto* particle : particles)
+  float* px = x.data();
+  const float* pspeed = speed.data();
+  size_t count = x.size();
+
+  for (size_t i = 0; i < count; ++i)
   {
-    CloudParticle* cloud_particle = static_cast<CloudParticle*>(particle);
-    cloud_particle->x += cloud_particle->speed * elapsed_time;
+    px[i] += pspeed[i] * elapsed_time;
   }
+  wrap(x, virtual_width);
 }
 
 // EOF
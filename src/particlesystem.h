@@ -30,13 +30,17 @@
  * The coordinate system used here is a virtual one. It would be a bad idea to
  * populate whole levels with particles. So we're using a virtual rectangle
  * here that is tiled onto the level when drawing. This rectangle has the size
- * (virtual_width, virtual_height). We're using modulo on the particle
- * coordinates, so when a particle leaves left, it'll reenter at the right
- * side.
+ * (virtual_width, virtual_height). Particle coordinates are kept inside of
+ * it, so when a particle leaves left, it'll reenter at the right side.
+ *
+ * Particles are stored as one array per attribute, so simulate() can run
+ * over plain float arrays. They are sorted by layer and texture, draw()
+ * walks one run of particles per texture and lets consecutive quads of the
+ * same texture end up in one batch.
  *
  * Classes that implement a particle system should subclass from this class,
- * initialize particles in the constructor and move them in the simulate
- * function.
+ * add particles with add_particle() and call sort_particles() in the
+ * constructor, and move them in the simulate function.
  */
 class ParticleSystem
 {
@@ -49,19 +53,35 @@ public:
     virtual void simulate(float elapsed_time) = 0;
 
 protected:
-    class Particle
-    {
-    public:
-        virtual ~Particle()
-        { }
+    // Particle attributes, index i of every array belongs to particle i
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> speed;
+    std::vector<int> layer;
+    std::vector<Surface*> texture;
+
+    float virtual_width, virtual_height;
+
+    void add_particle(float x, float y, int layer, Surface* texture, float speed);
 
-        float x, y;
+    /** Sort the particles by layer and texture, call after adding them */
+    void sort_particles();
+
+    /** Bring coordinates back into the virtual rectangle, for particles
+        that moved less than one rectangle since the last call */
+    void wrap(std::vector<float>& coords, float size);
+
+private:
+    // A run of particles sharing layer and texture
+    struct Group
+    {
         int layer;
         Surface* texture;
+        size_t first;
+        size_t count;
     };
 
-    std::vector<Particle*> particles;
-    float virtual_width, virtual_height;
+    std::vector<Group> groups;
 };
 
 class SnowParticleSystem : public ParticleSystem
@@ -73,13 +93,12 @@ public:
     virtual void simulate(float elapsed_time);
 
 private:
-    class SnowParticle : public Particle
-    {
-    public:
-        float speed;
-    };
-
     Surface* snowimages[3];
+
+    // simulate() runs as a job, so respawned flakes don't draw from the
+    // shared rand() but from a generator of their own
+    unsigned int rand_state;
+    int next_rand();
 };
 
 class CloudParticleSystem : public ParticleSystem
@@ -91,12 +110,6 @@ public:
     virtual void simulate(float elapsed_time);
 
 private:
-    class CloudParticle : public Particle
-    {
-    public:
-        float speed;
-    };
-
     Surface* cloudimage;
 };
 
@@ -24,11 +24,11 @@
 #include "defines.h"
 #include "physic.h"
 #include "timer.h"
-#include "world.h"
-#include "level.h"
+
+float Physic::gravity = 10 / 100.0;
 
 Physic::Physic()
-    : ax(0), ay(0), vx(0), vy(0), gravity_enabled(true)
+    : ax(0), ay(0), vx(0), vy(0), gravity_scale(1)
 {
 }
 
@@ -40,7 +40,7 @@ void
 Physic::reset()
 {
     ax = ay = vx = vy = 0;
-    gravity_enabled = true;
+    gravity_scale = 1;
 }
 
 void
@@ -118,23 +118,13 @@ Physic::get_acceleration_y()
 void
 Physic::enable_gravity(bool enable_gravity)
 {
-  gravity_enabled = enable_gravity;
+  gravity_scale = enable_gravity ? 1 : 0;
 }
 
 void
-Physic::apply(float frame_ratio, float &x, float &y)
-{
-  float gravity = World::current()->get_level()->gravity;
-  float grav;
-  if(gravity_enabled)
-    grav = gravity / 100.0;
-  else
-    grav = 0;
-
-  x += vx * frame_ratio + ax * frame_ratio * frame_ratio;
-  y += vy * frame_ratio + (ay + grav) * frame_ratio * frame_ratio;
-  vx += ax * frame_ratio;
-  vy += (ay + grav) * frame_ratio;
+Physic::set_gravity(float level_gravity)
+{
+  gravity = level_gravity / 100.0;
 }
 
 // EOF
@@ -61,17 +61,38 @@ public:
     void enable_gravity(bool gravity_enabled);
 
     /** applies the physical simulation to given x and y coordinates */
-    void apply(float frame_ratio, float &x, float &y); 
+    void apply(float frame_ratio, float &x, float &y);
+
+    /** sets the gravity of the current level for all objects, the World
+     * does this before its objects move
+     */
+    static void set_gravity(float level_gravity);
 
 private:
     // horizontal and vertical acceleration
     float ax, ay;
     // horizontal and vertical velocity
     float vx, vy;
-    // should we respect gravity in out calculations?
-    bool gravity_enabled;
+    // 1 if we respect gravity in our calculations, 0 if not
+    float gravity_scale;
+
+    // gravity of the current level, in the units of ay
+    static float gravity;
 };
 
+/* Inline, so the action code of every object gets it without a call or a
+   lookup of the level */
+inline void
+Physic::apply(float frame_ratio, float &x, float &y)
+{
+  float grav = gravity * gravity_scale;
+
+  x += vx * frame_ratio + ax * frame_ratio * frame_ratio;
+  y += vy * frame_ratio + (ay + grav) * frame_ratio * frame_ratio;
+  vx += ax * frame_ratio;
+  vy += (ay + grav) * frame_ratio;
+}
+
 #endif /*SUPERTUX_PHYSIC_H*/
 
 // EOF
@@ -190,7 +190,7 @@ Player::action(double frame_ratio)
       // special exception for cases where we're stuck under tiles after
       // being ducked. In this case we drift out
       if(!duck && on_ground() && old_base.x == base.x && old_base.y == base.y
-         && collision_object_map(base))
+         && collision_object_map(base, tiles))
         {
           base.x += frame_ratio * WALK_SPEED * (dir ? 1 : -1);
           previous_base = old_base = base;
@@ -275,17 +275,17 @@ Player::action(double frame_ratio)
 bool
 Player::on_ground()
 {
-  return ( issolid(base.x + base.width / 2, base.y + base.height) ||
-           issolid(base.x + 1, base.y + base.height) ||
-           issolid(base.x + base.width - 1, base.y + base.height)  );
+  return ( tiles.issolid(base.x + base.width / 2, base.y + base.height) ||
+           tiles.issolid(base.x + 1, base.y + base.height) ||
+           tiles.issolid(base.x + base.width - 1, base.y + base.height)  );
 }
 
 bool
 Player::under_solid()
 {
-  return ( issolid(base.x + base.width / 2, base.y) ||
-           issolid(base.x + 1, base.y) ||
-           issolid(base.x + base.width - 1, base.y)  );
+  return ( tiles.issolid(base.x + base.width / 2, base.y) ||
+           tiles.issolid(base.x + 1, base.y) ||
+           tiles.issolid(base.x + base.width - 1, base.y)  );
 }
 
 void
@@ -338,7 +338,7 @@ Player::handle_horizontal_input()
   if(on_ground() && ((vx < 0 && dirsign >0) || (vx>0 && dirsign<0))) {
       if(fabs(vx)>SKID_XM && !skidding_timer.check()) {
           skidding_timer.start(SKID_TIME);
-          play_sound(sounds[SND_SKID], SOUND_CENTER_SPEAKER);
+          play_sound(SND_SKID);
           ax *= 2.5;
       } else {
           ax *= 2;
@@ -392,9 +392,9 @@ Player::handle_vertical_input()
           jumping = true;
           can_jump = false;
           if (size == SMALL)
-            play_sound(sounds[SND_JUMP], SOUND_CENTER_SPEAKER);
+            play_sound(SND_JUMP);
           else
-            play_sound(sounds[SND_BIGJUMP], SOUND_CENTER_SPEAKER);
+            play_sound(SND_BIGJUMP);
         }
     }
   // Let go of jump key
@@ -534,7 +534,7 @@ Player::grabdistros()
       if(player_status.lives < MAX_LIVES)
         ++player_status.lives;
       /*We want to hear the sound even, if MAX_LIVES is reached*/
-      play_sound(sounds[SND_LIFEUP], SOUND_CENTER_SPEAKER);
+      play_sound(SND_LIFEUP);
     }
 }
 
@@ -666,7 +666,7 @@ Player::collision(void* p_c_object, int c_object)
               else
                 {
                    pbad_c->dying = DYING_FALLING;
-                   play_sound(sounds[SND_FALL], SOUND_CENTER_SPEAKER);
+                   play_sound(SND_FALL);
                    World::current()->add_score(pbad_c->base.x - scroll_x,
                                                pbad_c->base.y,
                                                25 * player_status.score_multiplier);
@@ -697,7 +697,7 @@ Player::collision(void* p_c_object, int c_object)
 void
 Player::kill(HurtMode mode)
 {
-  play_sound(sounds[SND_HURT], SOUND_CENTER_SPEAKER);
+  play_sound(SND_HURT);
 
   physic.set_velocity_x(0);
 
@@ -772,7 +772,7 @@ Player::check_bounds(bool back_scrolling, bool hor_autoscroll)
   if(hor_autoscroll)
     {
     if(base.x == scroll_x)
-      if((issolid(base.x+32, base.y) || (size != SMALL && !duck && issolid(base.x+32, base.y+32))) && (dying == DYING_NOT))
+      if((tiles.issolid(base.x+32, base.y) || (size != SMALL && !duck && tiles.issolid(base.x+32, base.y+32))) && (dying == DYING_NOT))
         kill(KILL);
 
     if(base.x + base.width > scroll_x + screen->w)
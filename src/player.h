@@ -34,6 +34,7 @@
 #define TUX_INVINCIBLE_TIME 10000
 #define TUX_INVINCIBLE_TIME_WARNING 2000
 #define TIME_WARNING 20000     /* When to alert player they're low on time! */
+#define MUSIC_PREFETCH_TIME 10000  /* How long before TIME_WARNING to read the hurry up music */
 
 /* One-ups... */
 
@@ -131,6 +132,7 @@ public:
   Timer frame_timer;
   Timer kick_timer;
   Physic physic;
+  TileNeighbourhood tiles;  // the tiles around Tux, for on_ground() and friends
 
 public:
   void init();
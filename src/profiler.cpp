@@ -0,0 +1,379 @@
+//  profiler.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "profiler.h"
+#include "globals.h"
+#include "screen.h"
+#include "text.h"
+#include "frame_scheduler.h"
+#include "input_sampler.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct Section
+{
+  const char* name;
+  int parent;                       // -1 for top level sections
+  int depth;
+  Clock::time_point start;
+  long long frame_us;               // time spent in the current frame
+  long long total_us;               // time spent since enable()
+  float history[Profiler::HISTORY]; // milliseconds per frame
+};
+
+struct BarColor
+{
+  int r, g, b;
+};
+
+const BarColor colors[] = {
+  { 230,  80,  80 }, {  80, 200,  80 }, {  80, 130, 240 }, { 230, 200,  60 },
+  { 200,  90, 220 }, {  70, 210, 210 }, { 240, 150,  60 }, { 160, 160, 160 }
+};
+const int COLOR_COUNT = sizeof(colors) / sizeof(colors[0]);
+
+// Pixels per millisecond in the graph
+const float GRAPH_SCALE = 4.0f;
+// Frames averaged for the table
+const int AVERAGE_FRAMES = 32;
+
+std::vector<Section> sections;
+std::vector<int> stack;
+float frame_history[Profiler::HISTORY];
+int history_pos = 0;
+unsigned int frame_number = 0;
+unsigned int frames_since_enable = 0;
+Clock::time_point frame_start;
+FILE* csv = nullptr;
+
+/**
+ * Finds a section, creating it on first use.
+ * @param name The name of the section.
+ * @param parent The enclosing section, -1 for none.
+ * @return The index of the section.
+ */
+int find_section(const char* name, int parent)
+{
+  for (size_t i = 0; i < sections.size(); ++i)
+  {
+    if (sections[i].parent == parent &&
+        (sections[i].name == name || strcmp(sections[i].name, name) == 0))
+    {
+      return i;
+    }
+  }
+
+  Section section;
+  section.name = name;
+  section.parent = parent;
+  section.depth = parent < 0 ? 0 : sections[parent].depth + 1;
+  section.frame_us = 0;
+  section.total_us = 0;
+  for (float& value : section.history)
+  {
+    value = 0;
+  }
+  sections.push_back(section);
+  return sections.size() - 1;
+}
+
+/**
+ * Averages the last frames of a history.
+ * @param history The history to average.
+ * @return The mean in milliseconds.
+ */
+float average(const float* history)
+{
+  float sum = 0;
+  for (int i = 1; i <= AVERAGE_FRAMES; ++i)
+  {
+    sum += history[(history_pos - i + Profiler::HISTORY) % Profiler::HISTORY];
+  }
+  return sum / AVERAGE_FRAMES;
+}
+
+/**
+ * Draws the table rows of a section and its children.
+ * @param parent The section whose children are drawn, -1 for the top level.
+ * @param y The position of the next row, advanced for every row.
+ */
+void draw_rows(int parent, int* y)
+{
+  char line[64];
+  int top_level = 0;
+
+  for (size_t i = 0; i < sections.size(); ++i)
+  {
+    const Section& section = sections[i];
+    if (section.parent != parent)
+    {
+      continue;
+    }
+
+    if (parent < 0)
+    {
+      const BarColor& color = colors[top_level++ % COLOR_COUNT];
+      fillrect(10, *y + 2, 8, 8, color.r, color.g, color.b, 255);
+    }
+
+    snprintf(line, sizeof(line), "%6.2f %s", average(section.history), section.name);
+    white_small_text->draw(line, 22 + section.depth * 12, *y, 1);
+    *y += white_small_text->h + 1;
+
+    draw_rows(i, y);
+  }
+}
+
+} // namespace
+
+bool Profiler::enabled = false;
+
+/**
+ * Turns measuring on or off, starting over with empty timings.
+ * @param enable True to measure.
+ */
+void Profiler::enable(bool enable)
+{
+  enabled = enable;
+  sections.clear();
+  stack.clear();
+  for (float& value : frame_history)
+  {
+    value = 0;
+  }
+  history_pos = 0;
+  frames_since_enable = 0;
+  frame_start = Clock::now();
+}
+
+/**
+ * Starts writing the timings to a CSV file.
+ * @param file The file to write.
+ */
+void Profiler::open_csv(const std::string& file)
+{
+  close_csv();
+  csv = fopen(file.c_str(), "w");
+  if (csv == nullptr)
+  {
+    perror(file.c_str());
+    return;
+  }
+  fprintf(csv, "frame,section,parent,ms\n");
+}
+
+/**
+ * Stops writing the CSV file.
+ */
+void Profiler::close_csv()
+{
+  if (csv)
+  {
+    fclose(csv);
+    csv = nullptr;
+  }
+}
+
+/**
+ * Stores the timings of the current frame and starts a new one.
+ */
+void Profiler::next_frame()
+{
+  if (!enabled)
+  {
+    return;
+  }
+
+  // Sections left open, e.g. by a jump out of the game loop, are dropped
+  stack.clear();
+
+  Clock::time_point now = Clock::now();
+  float total = std::chrono::duration<float, std::milli>(now - frame_start).count();
+  frame_history[history_pos] = total;
+
+  if (csv)
+  {
+    fprintf(csv, "%u,frame,,%.3f\n", frame_number, total);
+  }
+
+  for (Section& section : sections)
+  {
+    float ms = section.frame_us / 1000.0f;
+    section.history[history_pos] = ms;
+    section.total_us += section.frame_us;
+    section.frame_us = 0;
+
+    if (csv)
+    {
+      fprintf(csv, "%u,%s,%s,%.3f\n", frame_number, section.name,
+              section.parent < 0 ? "" : sections[section.parent].name, ms);
+    }
+  }
+
+  history_pos = (history_pos + 1) % HISTORY;
+  frame_start = now;
+  ++frame_number;
+  ++frames_since_enable;
+}
+
+/**
+ * Opens a section inside the currently open one.
+ * @param name The name of the section.
+ */
+void Profiler::begin(const char* name)
+{
+  int parent = stack.empty() ? -1 : stack.back();
+  int index = find_section(name, parent);
+  stack.push_back(index);
+  sections[index].start = Clock::now();
+}
+
+/**
+ * Closes the section opened last.
+ */
+void Profiler::end()
+{
+  if (stack.empty())
+  {
+    return;
+  }
+
+  Section& section = sections[stack.back()];
+  stack.pop_back();
+  section.frame_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - section.start).count();
+}
+
+/**
+ * Draws the graph of the last frames and the table of all sections.
+ */
+void Profiler::draw()
+{
+  if (!enabled)
+  {
+    return;
+  }
+
+  // The overlay isn't measured, its Text::draw() calls must not add sections
+  // while they are listed
+  enabled = false;
+
+  const int column_width = 2;
+  const int graph_x = 10;
+  const int graph_bottom = screen->h - 10;
+
+  // Graph, one column per frame with the top level sections stacked and
+  // the rest of the frame on top
+  fillrect(graph_x, graph_bottom - 34 * GRAPH_SCALE, HISTORY * column_width, 34 * GRAPH_SCALE, 0, 0, 0, 128);
+
+  for (int i = 0; i < HISTORY; ++i)
+  {
+    int frame = (history_pos + i) % HISTORY;
+    float x = graph_x + i * column_width;
+    float y = graph_bottom;
+    int top_level = 0;
+
+    for (const Section& section : sections)
+    {
+      if (section.parent >= 0)
+      {
+        continue;
+      }
+      const BarColor& color = colors[top_level++ % COLOR_COUNT];
+      float h = section.history[frame] * GRAPH_SCALE;
+      y -= h;
+      fillrect(x, y, column_width, h, color.r, color.g, color.b, 255);
+    }
+
+    float rest = frame_history[frame] * GRAPH_SCALE - (graph_bottom - y);
+    if (rest > 0)
+    {
+      fillrect(x, y - rest, column_width, rest, 255, 255, 255, 96);
+    }
+  }
+
+  // Lines at 60 and 30 frames per second
+  fillrect(graph_x, graph_bottom - 16.7f * GRAPH_SCALE, HISTORY * column_width, 1, 255, 255, 0, 160);
+  fillrect(graph_x, graph_bottom - 33.3f * GRAPH_SCALE, HISTORY * column_width, 1, 255, 0, 0, 160);
+
+  // Table of the average times
+  int y = 100;
+  char line[64];
+  snprintf(line, sizeof(line), "%6.2f frame", average(frame_history));
+  white_small_text->draw(line, 22, y, 1);
+  y += white_small_text->h + 1;
+  snprintf(line, sizeof(line), "%6d missed%s", FrameScheduler::get_missed(),
+           FrameScheduler::has_vsync() ? " vsync" : "");
+  white_small_text->draw(line, 22, y, 1);
+  y += white_small_text->h + 1;
+  snprintf(line, sizeof(line), "%6.2f input lag", InputSampler::get_latency());
+  white_small_text->draw(line, 22, y, 1);
+  y += white_small_text->h + 1;
+  draw_rows(-1, &y);
+
+  enabled = true;
+}
+
+/**
+ * Prints the mean time per frame of all sections, children indented
+ * below their parents.
+ * @param out The stream to print to.
+ */
+void Profiler::print_summary(FILE* out)
+{
+  if (frames_since_enable == 0)
+  {
+    return;
+  }
+
+  // Parents are always created before their children, so walking the
+  // sections recursively from the top level keeps the tree order
+  struct Printer
+  {
+    FILE* out;
+
+    void print(int parent)
+    {
+      for (size_t i = 0; i < sections.size(); ++i)
+      {
+        if (sections[i].parent != parent)
+        {
+          continue;
+        }
+        fprintf(out, "%*s%-24s %8.3f ms\n", sections[i].depth * 2, "", sections[i].name,
+                sections[i].total_us / 1000.0 / frames_since_enable);
+        print(i);
+      }
+    }
+  };
+
+  Printer printer = { out };
+  printer.print(-1);
+}
+
+// EOF
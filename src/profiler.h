@@ -0,0 +1,96 @@
+//  profiler.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_PROFILER_H
+#define SUPERTUX_PROFILER_H
+
+#include <stdio.h>
+#include <string>
+
+/** Measures how long the parts of a frame take. Sections are opened and
+    closed with PROFILE_SCOPE, sections opened inside others become their
+    children. Profiler::draw() shows the last frames as stacked bars of
+    the top level sections with a table of all sections; a CSV file with
+    one line per section and frame can be written as well.
+
+    Nothing is measured until the profiler is enabled. */
+class Profiler
+{
+public:
+  /** Frames kept for the graph */
+  static const int HISTORY = 128;
+
+  static void enable(bool enable);
+  static bool is_enabled() { return enabled; }
+
+  /** Write the timings of every frame to file, until close_csv() */
+  static void open_csv(const std::string& file);
+  static void close_csv();
+
+  /** Close the current frame and start the next one */
+  static void next_frame();
+
+  /** Open and close a section, name has to stay valid (a literal) */
+  static void begin(const char* name);
+  static void end();
+
+  /** Draw the overlay */
+  static void draw();
+
+  /** Print the mean time per frame of every section since enable() */
+  static void print_summary(FILE* out);
+
+private:
+  static bool enabled;
+};
+
+/** Measures the time until the end of the enclosing block */
+class ProfileScope
+{
+public:
+  ProfileScope(const char* name)
+    : active(Profiler::is_enabled())
+  {
+    if (active)
+    {
+      Profiler::begin(name);
+    }
+  }
+
+  ~ProfileScope()
+  {
+    if (active)
+    {
+      Profiler::end();
+    }
+  }
+
+private:
+  bool active;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+#endif /*SUPERTUX_PROFILER_H*/
+
+// EOF
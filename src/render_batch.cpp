@@ -0,0 +1,366 @@
+//  render_batch.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include "render_batch.h"
+#include "gl_shader.h"
+#include "globals.h"
+
+#ifndef NOOPENGL
+
+namespace
+{
+
+// A single queued quad, texture 0 means plain color
+struct BatchQuad
+{
+  GLuint texture;
+  bool blend;
+  GLubyte top[4];     // RGBA of the upper corners
+  GLubyte bottom[4];  // RGBA of the lower corners
+  GLfloat x1, y1, x2, y2;
+  GLfloat u1, v1, u2, v2;
+};
+
+std::vector<BatchQuad> queue;
+std::vector<GLfloat> vertices;
+std::vector<GLfloat> texcoords;
+std::vector<GLubyte> colors;
+
+// Index into the queue where the currently open layer starts
+std::size_t layer_start = 0;
+float layer_cell_size = 0;
+bool in_layer = false;
+
+int draw_calls = 0;
+
+/**
+ * Orders quads by blend state first and texture second, which gives the
+ * longest possible runs of quads that can share one draw call.
+ */
+bool quad_less(const BatchQuad& lhs, const BatchQuad& rhs)
+{
+  if (lhs.blend != rhs.blend)
+  {
+    return lhs.blend < rhs.blend;
+  }
+  return lhs.texture < rhs.texture;
+}
+
+/**
+ * Finds the end of the run of quads that can share a draw call.
+ * @param start The first quad of the run.
+ * @param end Where to stop looking.
+ * @return The index after the last quad of the run.
+ */
+std::size_t run_end(std::size_t start, std::size_t end)
+{
+  const BatchQuad& first = queue[start];
+  std::size_t i = start + 1;
+  while (i < end && queue[i].texture == first.texture && queue[i].blend == first.blend)
+  {
+    ++i;
+  }
+  return i;
+}
+
+/**
+ * Submits the queue through the shader backend, in uploads of at most
+ * ShaderRenderer::MAX_QUADS quads.
+ */
+void flush_shader()
+{
+  typedef ShaderRenderer::Vertex Vertex;
+
+  ShaderRenderer::begin();
+
+  std::size_t count = queue.size();
+  for (std::size_t upload = 0; upload < count; upload += ShaderRenderer::MAX_QUADS)
+  {
+    std::size_t end = std::min(count, upload + ShaderRenderer::MAX_QUADS);
+    Vertex* v = ShaderRenderer::map(static_cast<int>(end - upload));
+
+    for (std::size_t i = upload; i < end; ++i, v += 4)
+    {
+      const BatchQuad& q = queue[i];
+      v[0].x = q.x1; v[0].y = q.y1; v[0].u = q.u1; v[0].v = q.v1;
+      v[1].x = q.x2; v[1].y = q.y1; v[1].u = q.u2; v[1].v = q.v1;
+      v[2].x = q.x2; v[2].y = q.y2; v[2].u = q.u2; v[2].v = q.v2;
+      v[3].x = q.x1; v[3].y = q.y2; v[3].u = q.u1; v[3].v = q.v2;
+      memcpy(v[0].color, q.top, 4);
+      memcpy(v[1].color, q.top, 4);
+      memcpy(v[2].color, q.bottom, 4);
+      memcpy(v[3].color, q.bottom, 4);
+    }
+    ShaderRenderer::unmap();
+
+    for (std::size_t start = upload; start < end; )
+    {
+      std::size_t stop = run_end(start, end);
+      ShaderRenderer::draw(queue[start].texture, queue[start].blend,
+                           static_cast<int>(start - upload), static_cast<int>(stop - start));
+      ++draw_calls;
+      start = stop;
+    }
+  }
+
+  ShaderRenderer::end();
+}
+
+/**
+ * Submits the queue as fixed function vertex arrays.
+ */
+void flush_fixed()
+{
+  std::size_t count = queue.size();
+  vertices.resize(count * 8);
+  texcoords.resize(count * 8);
+  colors.resize(count * 16);
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const BatchQuad& q = queue[i];
+    GLfloat* v = &vertices[i * 8];
+    GLfloat* t = &texcoords[i * 8];
+    GLubyte* c = &colors[i * 16];
+
+    v[0] = q.x1; v[1] = q.y1;
+    v[2] = q.x2; v[3] = q.y1;
+    v[4] = q.x2; v[5] = q.y2;
+    v[6] = q.x1; v[7] = q.y2;
+
+    t[0] = q.u1; t[1] = q.v1;
+    t[2] = q.u2; t[3] = q.v1;
+    t[4] = q.u2; t[5] = q.v2;
+    t[6] = q.u1; t[7] = q.v2;
+
+    memcpy(c, q.top, 4);
+    memcpy(c + 4, q.top, 4);
+    memcpy(c + 8, q.bottom, 4);
+    memcpy(c + 12, q.bottom, 4);
+  }
+
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(2, GL_FLOAT, 0, &vertices[0]);
+  glTexCoordPointer(2, GL_FLOAT, 0, &texcoords[0]);
+  glColorPointer(4, GL_UNSIGNED_BYTE, 0, &colors[0]);
+
+  for (std::size_t start = 0; start < count; )
+  {
+    const BatchQuad& first = queue[start];
+    std::size_t stop = run_end(start, count);
+
+    if (first.blend)
+    {
+      glEnable(GL_BLEND);
+    }
+    else
+    {
+      glDisable(GL_BLEND);
+    }
+
+    if (first.texture)
+    {
+      glEnable(GL_TEXTURE_2D);
+      glBindTexture(GL_TEXTURE_2D, first.texture);
+    }
+    else
+    {
+      glDisable(GL_TEXTURE_2D);
+    }
+
+    glDrawArrays(GL_QUADS, start * 4, (stop - start) * 4);
+    ++draw_calls;
+
+    start = stop;
+  }
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  glDisable(GL_BLEND);
+  glDisable(GL_TEXTURE_2D);
+}
+
+} // namespace
+
+/**
+ * Queues a textured quad for drawing.
+ * @param texture The OpenGL texture to draw from.
+ * @param blend Whether alpha blending should be enabled for the quad.
+ * @param alpha The alpha value, also used to darken the color.
+ * @param x1, y1 Upper left corner on the screen.
+ * @param x2, y2 Lower right corner on the screen.
+ * @param u1, v1 Upper left texture coordinate.
+ * @param u2, v2 Lower right texture coordinate.
+ */
+void RenderBatch::add_quad(GLuint texture, bool blend, Uint8 alpha,
+                           float x1, float y1, float x2, float y2,
+                           float u1, float v1, float u2, float v2)
+{
+  BatchQuad quad;
+  quad.texture = texture;
+  quad.blend = blend;
+  memset(quad.top, alpha, 4);
+  memset(quad.bottom, alpha, 4);
+  quad.x1 = x1;
+  quad.y1 = y1;
+  quad.x2 = x2;
+  quad.y2 = y2;
+  quad.u1 = u1;
+  quad.v1 = v1;
+  quad.u2 = u2;
+  quad.v2 = v2;
+  queue.push_back(quad);
+}
+
+/**
+ * Queues an untextured quad for drawing.
+ * @param blend Whether alpha blending should be enabled for the quad.
+ * @param top The RGBA color of the upper corners.
+ * @param bottom The RGBA color of the lower corners.
+ * @param x1, y1 Upper left corner on the screen.
+ * @param x2, y2 Lower right corner on the screen.
+ */
+void RenderBatch::add_rect(bool blend, const GLubyte top[4], const GLubyte bottom[4],
+                           float x1, float y1, float x2, float y2)
+{
+  BatchQuad quad;
+  quad.texture = 0;
+  quad.blend = blend;
+  memcpy(quad.top, top, 4);
+  memcpy(quad.bottom, bottom, 4);
+  quad.x1 = x1;
+  quad.y1 = y1;
+  quad.x2 = x2;
+  quad.y2 = y2;
+  quad.u1 = quad.v1 = quad.u2 = quad.v2 = 0;
+  queue.push_back(quad);
+}
+
+#endif
+
+/**
+ * Opens a layer, quads queued until end_layer() may be reordered by texture.
+ * @param cell_size The size of the cells the quads of the layer fit into.
+ */
+void RenderBatch::begin_layer(float cell_size)
+{
+#ifndef NOOPENGL
+  if (!use_gl)
+  {
+    return;
+  }
+
+  end_layer();
+  layer_start = queue.size();
+  layer_cell_size = cell_size;
+  in_layer = true;
+#endif
+}
+
+/**
+ * Closes the current layer and groups its quads by texture. Quads bigger
+ * than a cell may overlap others, so only the runs of quads between them
+ * are sorted. The sort is stable, so quads from the same texture keep
+ * their relative order.
+ */
+void RenderBatch::end_layer()
+{
+#ifndef NOOPENGL
+  if (!in_layer)
+  {
+    return;
+  }
+
+  in_layer = false;
+  std::size_t start = layer_start;
+  for (std::size_t i = layer_start; i <= queue.size(); ++i)
+  {
+    if (i == queue.size()
+        || queue[i].x2 - queue[i].x1 > layer_cell_size
+        || queue[i].y2 - queue[i].y1 > layer_cell_size)
+    {
+      std::stable_sort(queue.begin() + start, queue.begin() + i, quad_less);
+      start = i + 1;
+    }
+  }
+#endif
+}
+
+/**
+ * Submits all queued quads to OpenGL, one draw call per run of quads
+ * that share texture and blend state.
+ */
+void RenderBatch::flush()
+{
+#ifndef NOOPENGL
+  end_layer();
+
+  if (queue.empty())
+  {
+    return;
+  }
+
+  if (ShaderRenderer::is_active())
+  {
+    flush_shader();
+  }
+  else
+  {
+    flush_fixed();
+  }
+
+  queue.clear();
+  layer_start = 0;
+#endif
+}
+
+/**
+ * Returns the number of draw calls issued since the last reset_stats().
+ * @return The number of draw calls.
+ */
+int RenderBatch::get_draw_calls()
+{
+#ifndef NOOPENGL
+  return draw_calls;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Resets the draw call counter.
+ */
+void RenderBatch::reset_stats()
+{
+#ifndef NOOPENGL
+  draw_calls = 0;
+#endif
+}
+
+// EOF
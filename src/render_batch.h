@@ -0,0 +1,74 @@
+//  render_batch.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_RENDER_BATCH_H
+#define SUPERTUX_RENDER_BATCH_H
+
+#include <SDL.h>
+#ifndef NOOPENGL
+#include <SDL_opengl.h>
+#endif
+
+/** Collects the textured quads of the OpenGL surfaces and submits them
+    as vertex arrays, so that consecutive draws from the same texture
+    end up in a single draw call. Plain colored rectangles (fillrect,
+    drawgradient) are queued as well. When the ShaderRenderer backend is
+    active the quads go through it instead of the fixed function arrays.
+
+    Draw order is preserved, except inside a layer (see begin_layer()),
+    where quads are regrouped by texture. Everything queued is flushed
+    before any immediate mode drawing (drawline, ...) and at flipscreen().
+    In SDL mode all of this is a no-op. */
+class RenderBatch
+{
+public:
+#ifndef NOOPENGL
+  /** Queue a textured quad, coordinates are in screen pixels and
+      texture coordinates in the 0..1 range of the texture */
+  static void add_quad(GLuint texture, bool blend, Uint8 alpha,
+                       float x1, float y1, float x2, float y2,
+                       float u1, float v1, float u2, float v2);
+
+  /** Queue an untextured quad with the given RGBA colors along its top
+      and bottom edge */
+  static void add_rect(bool blend, const GLubyte top[4], const GLubyte bottom[4],
+                       float x1, float y1, float x2, float y2);
+#endif
+
+  /** Start a layer: quads added until end_layer() that fit into a cell of
+      \a cell_size pixels don't overlap each other (like the cells of a
+      tilemap) and may be sorted by texture. Bigger quads keep their
+      place, so they paint over and under the same quads as without
+      sorting */
+  static void begin_layer(float cell_size);
+  static void end_layer();
+
+  /** Submit all queued quads to OpenGL */
+  static void flush();
+
+  /** Number of draw calls (and thus texture binds) issued
+      since the last reset_stats(), useful for profiling */
+  static int get_draw_calls();
+  static void reset_stats();
+};
+
+#endif /*SUPERTUX_RENDER_BATCH_H*/
+
+// EOF
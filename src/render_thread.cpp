@@ -0,0 +1,390 @@
+//  render_thread.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <vector>
+#include "render_thread.h"
+#include "globals.h"
+
+namespace
+{
+
+enum CommandType
+{
+  CMD_BLIT,
+  CMD_STRETCH,
+  CMD_FILL
+};
+
+struct Command
+{
+  CommandType type;
+  SDL_Surface* surface;
+  SDL_Rect src;
+  bool has_src;
+  SDL_Rect dest;
+  int alpha;
+  Uint32 color;
+};
+
+typedef std::vector<Command> Commands;
+
+bool enabled = false;
+
+// The list of the frame being drawn, only used by the main thread
+Commands recording;
+
+// The areas of the frame the render thread draws or drew last, presented
+// by the next present() or finish()
+std::vector<SDL_Rect> pending_rects;
+bool pending_full = false;
+
+// Everything below is guarded by mutex. drawing is only touched by the
+// main thread while the render thread isn't busy.
+SDL_mutex* mutex = nullptr;
+SDL_cond* submitted = nullptr;
+SDL_cond* drawn = nullptr;
+Commands drawing;
+bool busy = false;
+bool quitting = false;
+SDL_Thread* thread = nullptr;
+bool failed = false;
+
+/**
+ * Does a single draw onto the screen.
+ * @param command The draw.
+ * @return The result of the SDL call.
+ */
+int execute(Command& command)
+{
+  switch (command.type)
+  {
+    case CMD_BLIT:
+      if (command.alpha != RenderThread::KEEP_ALPHA)
+      {
+        SDL_SetAlpha(command.surface, command.alpha != 255 ? SDL_SRCALPHA : 0, command.alpha);
+      }
+      return SDL_BlitSurface(command.surface, command.has_src ? &command.src : NULL,
+                             screen, &command.dest);
+
+    case CMD_STRETCH:
+      return SDL_SoftStretch(command.surface, NULL, screen, &command.dest);
+
+    case CMD_FILL:
+      if (command.alpha != 255)
+      {
+        SDL_Surface* temp = SDL_CreateRGBSurface(screen->flags, command.dest.w, command.dest.h,
+                                                 screen->format->BitsPerPixel,
+                                                 screen->format->Rmask, screen->format->Gmask,
+                                                 screen->format->Bmask, screen->format->Amask);
+        if (temp == nullptr)
+        {
+          return -1;
+        }
+        SDL_FillRect(temp, NULL, command.color);
+        SDL_SetAlpha(temp, SDL_SRCALPHA, command.alpha);
+        int ret = SDL_BlitSurface(temp, NULL, screen, &command.dest);
+        SDL_FreeSurface(temp);
+        return ret;
+      }
+      return SDL_FillRect(screen, &command.dest, command.color);
+  }
+  return 0;
+}
+
+/**
+ * Body of the render thread, draws the lists handed over until
+ * shutdown().
+ * @return Always 0.
+ */
+int worker(void*)
+{
+  SDL_LockMutex(mutex);
+  while (!quitting)
+  {
+    if (!busy)
+    {
+      SDL_CondWait(submitted, mutex);
+      continue;
+    }
+
+    SDL_UnlockMutex(mutex);
+    for (Command& command : drawing)
+    {
+      execute(command);
+    }
+    SDL_LockMutex(mutex);
+
+    busy = false;
+    SDL_CondBroadcast(drawn);
+  }
+  SDL_UnlockMutex(mutex);
+
+  return 0;
+}
+
+/**
+ * Starts the render thread on first use.
+ * @return False if there is none, so everything is drawn right away.
+ */
+bool start_thread()
+{
+#ifdef _WII_
+  return false;
+#else
+  if (thread != nullptr)
+  {
+    return true;
+  }
+  if (failed)
+  {
+    return false;
+  }
+
+  mutex = SDL_CreateMutex();
+  submitted = SDL_CreateCond();
+  drawn = SDL_CreateCond();
+  if (mutex != nullptr && submitted != nullptr && drawn != nullptr)
+  {
+    quitting = false;
+    thread = SDL_CreateThread(worker, nullptr);
+  }
+  failed = thread == nullptr;
+  return !failed;
+#endif
+}
+
+/**
+ * Waits until the render thread drew the list it was handed.
+ */
+void wait_idle()
+{
+  if (thread == nullptr)
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  while (busy)
+  {
+    SDL_CondWait(drawn, mutex);
+  }
+  SDL_UnlockMutex(mutex);
+}
+
+/**
+ * Presents the frame the render thread drew last, it must be idle.
+ */
+void present_pending()
+{
+  if (pending_full)
+  {
+    SDL_Flip(screen);
+  }
+  else if (!pending_rects.empty())
+  {
+    SDL_UpdateRects(screen, pending_rects.size(), &pending_rects[0]);
+  }
+  pending_rects.clear();
+  pending_full = false;
+}
+
+/**
+ * Adds a draw to the list, filling in the common fields.
+ * @param type The kind of draw.
+ * @param surface The surface to draw, if any.
+ * @param dest The area of the screen.
+ * @return The new command.
+ */
+Command& record(CommandType type, SDL_Surface* surface, const SDL_Rect* dest)
+{
+  recording.push_back(Command());
+  Command& command = recording.back();
+  command.type = type;
+  command.surface = surface;
+  command.has_src = false;
+  command.dest = *dest;
+  command.alpha = RenderThread::KEEP_ALPHA;
+  command.color = 0;
+  return command;
+}
+
+} // namespace
+
+/**
+ * Turns pipelined drawing on or off.
+ * @param enabled_ True to draw on the render thread.
+ */
+void RenderThread::set_enabled(bool enabled_)
+{
+  if (!enabled_)
+  {
+    finish();
+  }
+  enabled = enabled_;
+}
+
+/**
+ * Tells whether draws go into the list.
+ * @return True in SDL mode with the render thread running.
+ */
+bool RenderThread::is_recording()
+{
+  return enabled && !use_gl && !use_gx && start_thread();
+}
+
+/**
+ * Blits a surface onto the screen, or records the blit.
+ * @param surface The surface to draw.
+ * @param src The part of the surface, NULL for all of it.
+ * @param dest The position on the screen, clipped by SDL when drawn
+ *             right away.
+ * @param alpha The alpha to set on the surface, or KEEP_ALPHA.
+ * @return The result of SDL_BlitSurface(), 0 while recording.
+ */
+int RenderThread::blit(SDL_Surface* surface, SDL_Rect* src, SDL_Rect* dest, int alpha)
+{
+  if (!is_recording())
+  {
+    if (alpha != KEEP_ALPHA)
+    {
+      SDL_SetAlpha(surface, alpha != 255 ? SDL_SRCALPHA : 0, alpha);
+    }
+    return SDL_BlitSurface(surface, src, screen, dest);
+  }
+
+  Command& command = record(CMD_BLIT, surface, dest);
+  if (src)
+  {
+    command.src = *src;
+    command.has_src = true;
+  }
+  command.alpha = alpha;
+  return 0;
+}
+
+/**
+ * Stretches a surface onto the screen, or records it.
+ * @param surface The surface to draw, in the format of the screen.
+ * @param dest The area of the screen to cover.
+ * @return The result of SDL_SoftStretch(), 0 while recording.
+ */
+int RenderThread::stretch(SDL_Surface* surface, SDL_Rect* dest)
+{
+  if (!is_recording())
+  {
+    return SDL_SoftStretch(surface, NULL, screen, dest);
+  }
+
+  record(CMD_STRETCH, surface, dest);
+  return 0;
+}
+
+/**
+ * Fills a rectangle of the screen, or records it.
+ * @param rect The area to fill.
+ * @param color The color, mapped to the screen format.
+ * @param alpha The opacity of the fill.
+ */
+void RenderThread::fill(SDL_Rect* rect, Uint32 color, Uint8 alpha)
+{
+  Command command;
+  command.type = CMD_FILL;
+  command.surface = nullptr;
+  command.has_src = false;
+  command.dest = *rect;
+  command.alpha = alpha;
+  command.color = color;
+
+  if (!is_recording())
+  {
+    execute(command);
+    return;
+  }
+  recording.push_back(command);
+}
+
+/**
+ * Presents the frame drawn before and hands the recorded one to the
+ * render thread.
+ * @param rects The areas the recorded frame changed.
+ * @param count The number of areas.
+ * @param full True to present the whole screen instead.
+ */
+void RenderThread::present(const SDL_Rect* rects, int count, bool full)
+{
+  wait_idle();
+  present_pending();
+
+  pending_rects.assign(rects, rects + count);
+  pending_full = full;
+
+  SDL_LockMutex(mutex);
+  drawing.swap(recording);
+  busy = true;
+  SDL_CondSignal(submitted);
+  SDL_UnlockMutex(mutex);
+
+  // The render thread is done with the list that came back
+  recording.clear();
+}
+
+/**
+ * Waits for the render thread, presents what it drew and draws the rest
+ * of the list right here.
+ */
+void RenderThread::finish()
+{
+  if (thread == nullptr)
+  {
+    return;
+  }
+
+  wait_idle();
+  present_pending();
+
+  for (Command& command : recording)
+  {
+    execute(command);
+  }
+  recording.clear();
+}
+
+/**
+ * Stops the render thread after drawing everything recorded.
+ */
+void RenderThread::shutdown()
+{
+  if (thread == nullptr)
+  {
+    return;
+  }
+
+  finish();
+
+  SDL_LockMutex(mutex);
+  quitting = true;
+  SDL_CondSignal(submitted);
+  SDL_UnlockMutex(mutex);
+
+  SDL_WaitThread(thread, nullptr);
+  thread = nullptr;
+}
+
+// EOF
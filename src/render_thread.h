@@ -0,0 +1,79 @@
+//  render_thread.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_RENDER_THREAD_H
+#define SUPERTUX_RENDER_THREAD_H
+
+#include <SDL.h>
+
+/** Pipelined drawing for the SDL renderer. While it is on, the blits
+    and fills of a frame are recorded into a draw list instead of being
+    done right away. flipscreen() hands the list to a render thread,
+    which draws it onto the screen while the main thread runs the logic
+    of the next frame and records the next list. The frame is presented
+    when the next one is handed over, so the screen lags one frame behind.
+
+    The SDL surfaces in a list must stay unchanged until it was drawn.
+    Code that changes or frees a surface that may be drawn, or that
+    reads or writes the screen directly, calls finish() first.
+
+    OpenGL keeps drawing on the main thread, SDL 1.2 ties the context to
+    the thread that created it, and so does GX on the single core Wii. */
+class RenderThread
+{
+public:
+  /** Alpha for blit() that leaves the alpha of the surface as it is */
+  static const int KEEP_ALPHA = -1;
+
+  /** Turn pipelined drawing on or off, it only applies to the SDL
+      renderer */
+  static void set_enabled(bool enabled);
+
+  /** Are draws recorded instead of done right away? */
+  static bool is_recording();
+
+  /** Blit onto the screen like SDL_BlitSurface(). An alpha other than
+      KEEP_ALPHA is set on the surface first.
+      @return The result of SDL_BlitSurface(), 0 while recording */
+  static int blit(SDL_Surface* surface, SDL_Rect* src, SDL_Rect* dest, int alpha = KEEP_ALPHA);
+
+  /** Stretch the whole surface onto the screen like SDL_SoftStretch() */
+  static int stretch(SDL_Surface* surface, SDL_Rect* dest);
+
+  /** Fill a rectangle of the screen with a color in the screen format */
+  static void fill(SDL_Rect* rect, Uint32 color, Uint8 alpha);
+
+  /** Hand the recorded list to the render thread, after presenting the
+      frame it drew before. The areas are presented with the next call,
+      full presents the whole screen. */
+  static void present(const SDL_Rect* rects, int count, bool full);
+
+  /** Wait for the render thread and draw the rest of the list on the
+      calling thread. Until the next present() the screen holds
+      everything drawn so far and may be used directly. */
+  static void finish();
+
+  /** Finish and stop the render thread */
+  static void shutdown();
+};
+
+#endif /*SUPERTUX_RENDER_THREAD_H*/
+
+// EOF
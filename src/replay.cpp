@@ -0,0 +1,557 @@
+//  replay.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "replay.h"
+#include "gameloop.h"
+#include "globals.h"
+#include "badguy.h"
+#include "player.h"
+#include "scene.h"
+#include "timer.h"
+#include "world.h"
+
+namespace
+{
+
+// Bump whenever the layout of the file changes
+const uint32_t FORMAT_VERSION = 1;
+
+// Game ticks of the first step, timers take 0 for not started
+const Uint32 CLOCK_START = 1000;
+
+// mismatch_step while the playback matches
+const unsigned int NO_MISMATCH = UINT_MAX;
+
+typedef std::vector<unsigned char> Bytes;
+
+PlayerStatus start_status;
+Uint8 fed_input = 0;
+
+void put_u32(Bytes& out, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    out.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+void put_string(Bytes& out, const std::string& str)
+{
+  put_u32(out, str.size());
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+/** Reads values back, stops at the end of the data instead of reading
+    past it */
+class Reader
+{
+public:
+  const unsigned char* pos;
+  const unsigned char* end;
+  bool ok;
+
+  Reader(const unsigned char* data, size_t size)
+    : pos(data), end(data + size), ok(true)
+  {
+  }
+
+  unsigned char get_u8()
+  {
+    if (!ok || pos == end)
+    {
+      ok = false;
+      return 0;
+    }
+    return *pos++;
+  }
+
+  uint32_t get_u32()
+  {
+    if (!ok || end - pos < 4)
+    {
+      ok = false;
+      return 0;
+    }
+    uint32_t value = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (uint32_t(pos[3]) << 24);
+    pos += 4;
+    return value;
+  }
+
+  int get_int()
+  {
+    return static_cast<int32_t>(get_u32());
+  }
+
+  std::string get_string()
+  {
+    uint32_t size = get_u32();
+    if (!ok || uint32_t(end - pos) < size)
+    {
+      ok = false;
+      return std::string();
+    }
+    std::string str(reinterpret_cast<const char*>(pos), size);
+    pos += size;
+    return str;
+  }
+};
+
+/**
+ * Packs the controls of tux into the bits of a byte.
+ * @param input The controls.
+ * @return The packed controls.
+ */
+Uint8 pack_input(const player_input_type& input)
+{
+  return (input.left == DOWN) | (input.right == DOWN) << 1 | (input.up == DOWN) << 2 |
+         (input.down == DOWN) << 3 | (input.fire == DOWN) << 4 |
+         (input.old_up == DOWN) << 5 | (input.old_fire == DOWN) << 6;
+}
+
+/**
+ * Unpacks controls packed by pack_input().
+ * @param bits The packed controls.
+ * @param input Receives the controls.
+ */
+void unpack_input(Uint8 bits, player_input_type* input)
+{
+  input->left = (bits & 1) ? DOWN : UP;
+  input->right = (bits & 2) ? DOWN : UP;
+  input->up = (bits & 4) ? DOWN : UP;
+  input->down = (bits & 8) ? DOWN : UP;
+  input->fire = (bits & 16) ? DOWN : UP;
+  input->old_up = (bits & 32) ? DOWN : UP;
+  input->old_fire = (bits & 64) ? DOWN : UP;
+}
+
+/**
+ * Adds a value to an FNV-1a hash.
+ * @param hash The hash so far.
+ * @param data The value.
+ * @param size The size of the value.
+ * @return The new hash.
+ */
+uint32_t hash_bytes(uint32_t hash, const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+uint32_t hash_base(uint32_t hash, const base_type& base)
+{
+  float values[4] = { base.x, base.y, base.xm, base.ym };
+  return hash_bytes(hash, values, sizeof(values));
+}
+
+const char* exit_status_name(int exit_status)
+{
+  switch (exit_status)
+  {
+    case GameSession::ES_LEVEL_FINISHED:
+      return "level finished";
+    case GameSession::ES_GAME_OVER:
+      return "game over";
+    case GameSession::ES_LEVEL_ABORT:
+      return "level aborted";
+    default:
+      return "still running";
+  }
+}
+
+} // namespace
+
+std::string Replay::record_file;
+std::string Replay::playback_file;
+bool Replay::recording = false;
+bool Replay::playing = false;
+unsigned int Replay::step = 0;
+unsigned int Replay::seek_step = UINT_MAX;
+unsigned int Replay::mismatch_step = NO_MISMATCH;
+std::string Replay::subset;
+int Replay::levelnb = 0;
+int Replay::mode = 0;
+uint32_t Replay::seed = 0;
+std::vector<Uint8> Replay::inputs;
+std::vector<uint32_t> Replay::checks;
+int Replay::exit_status = GameSession::ES_NONE;
+int Replay::playback_exit_status = GameSession::ES_NONE;
+
+/**
+ * Requests the recording of the next game session.
+ * @param file The file to save the recording to.
+ */
+void Replay::request_record(const std::string& file)
+{
+  record_file = file;
+}
+
+/**
+ * Requests the playback of a recording, done by run() once the game is
+ * set up.
+ * @param file The recording.
+ */
+void Replay::request_playback(const std::string& file)
+{
+  playback_file = file;
+}
+
+/**
+ * Makes the playback stop fast forwarding at the given time.
+ * @param seconds The time into the recording.
+ */
+void Replay::set_seek(float seconds)
+{
+  seek_step = static_cast<unsigned int>(seconds * 1000 / FRAME_RATE);
+}
+
+/**
+ * Reads a recording.
+ * @param file The recording.
+ * @return False if the file can't be read or is no valid recording.
+ */
+bool Replay::load(const std::string& file)
+{
+  FILE* in = fopen(file.c_str(), "rb");
+  if (in == nullptr)
+  {
+    perror(file.c_str());
+    return false;
+  }
+
+  Bytes data;
+  unsigned char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+  {
+    data.insert(data.end(), buffer, buffer + count);
+  }
+  fclose(in);
+
+  Reader reader(data.data(), data.size());
+  bool valid = data.size() >= 4 && memcmp(data.data(), "STRP", 4) == 0;
+  reader.pos += valid ? 4 : 0;
+  valid = valid && reader.get_u32() == FORMAT_VERSION;
+  if (!valid)
+  {
+    fprintf(stderr, "%s: not a replay of this version\n", file.c_str());
+    return false;
+  }
+
+  subset = reader.get_string();
+  levelnb = reader.get_int();
+  mode = reader.get_int();
+  seed = reader.get_u32();
+  start_status.score = reader.get_int();
+  start_status.distros = reader.get_int();
+  start_status.lives = reader.get_int();
+  start_status.bonus = static_cast<PlayerStatus::BonusType>(reader.get_int());
+  start_status.score_multiplier = reader.get_int();
+
+  // The controls are stored as runs of equal steps
+  uint32_t steps = reader.get_u32();
+  inputs.clear();
+  while (reader.ok && inputs.size() < steps)
+  {
+    uint32_t length = reader.get_u32();
+    Uint8 bits = reader.get_u8();
+    if (length == 0 || length > steps - inputs.size())
+    {
+      reader.ok = false;
+    }
+    else
+    {
+      inputs.insert(inputs.end(), length, bits);
+    }
+  }
+
+  uint32_t check_count = reader.get_u32();
+  checks.clear();
+  for (uint32_t i = 0; reader.ok && i < check_count; ++i)
+  {
+    checks.push_back(reader.get_u32());
+  }
+  exit_status = reader.get_int();
+
+  if (!reader.ok || reader.pos != reader.end)
+  {
+    fprintf(stderr, "%s: broken replay\n", file.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Writes the recording.
+ * @param file The file to write.
+ * @return False if the file can't be written.
+ */
+bool Replay::save(const std::string& file)
+{
+  Bytes data;
+  data.insert(data.end(), "STRP", "STRP" + 4);
+  put_u32(data, FORMAT_VERSION);
+  put_string(data, subset);
+  put_u32(data, levelnb);
+  put_u32(data, mode);
+  put_u32(data, seed);
+  put_u32(data, start_status.score);
+  put_u32(data, start_status.distros);
+  put_u32(data, start_status.lives);
+  put_u32(data, start_status.bonus);
+  put_u32(data, start_status.score_multiplier);
+
+  put_u32(data, inputs.size());
+  for (size_t i = 0; i < inputs.size();)
+  {
+    size_t length = 1;
+    while (i + length < inputs.size() && inputs[i + length] == inputs[i])
+    {
+      ++length;
+    }
+    put_u32(data, length);
+    data.push_back(inputs[i]);
+    i += length;
+  }
+
+  put_u32(data, checks.size());
+  for (uint32_t check : checks)
+  {
+    put_u32(data, check);
+  }
+  put_u32(data, exit_status);
+
+  FILE* out = fopen(file.c_str(), "wb");
+  if (out == nullptr)
+  {
+    perror(file.c_str());
+    return false;
+  }
+  bool written = fwrite(data.data(), 1, data.size(), out) == data.size();
+  written = fclose(out) == 0 && written;
+  if (!written)
+  {
+    fprintf(stderr, "%s: couldn't write the replay\n", file.c_str());
+  }
+  return written;
+}
+
+/**
+ * Plays the requested recording as fast as possible and prints whether
+ * the game went the same way.
+ */
+void Replay::run()
+{
+  if (!load(playback_file))
+  {
+    return;
+  }
+
+  playing = true;
+  {
+    GameSession session(subset, levelnb, mode);
+    session.run();
+  }
+  playing = false;
+  st_ticks_stop_stepped();
+
+  if (seek_step != UINT_MAX)
+  {
+    return;
+  }
+
+  printf("Replay of %s, %u steps\n", playback_file.c_str(), (unsigned int)inputs.size());
+  if (mismatch_step != NO_MISMATCH)
+  {
+    printf("  diverged between steps %u and %u\n",
+           mismatch_step < CHECK_INTERVAL ? 0 : mismatch_step - CHECK_INTERVAL, mismatch_step);
+  }
+  if (step != inputs.size() || playback_exit_status != exit_status)
+  {
+    printf("  recorded: %s after %u steps\n", exit_status_name(exit_status), (unsigned int)inputs.size());
+    printf("  played:   %s after %u steps\n", exit_status_name(playback_exit_status), step);
+  }
+  if (mismatch_step == NO_MISMATCH && step == inputs.size() && playback_exit_status == exit_status)
+  {
+    printf("  matches the recording\n");
+  }
+}
+
+/**
+ * Seeds the simulation and starts the step clock if the session is
+ * recorded or played back. The demo on the title screen is never
+ * recorded.
+ * @param subset_ The subset or level file of the session.
+ * @param levelnb_ The level number of the session.
+ * @param mode_ The game mode of the session.
+ */
+void Replay::begin_session(const std::string& subset_, int levelnb_, int mode_)
+{
+  if (playing)
+  {
+    player_status = start_status;
+    step = 0;
+    mismatch_step = NO_MISMATCH;
+  }
+  else if (!record_file.empty() && mode_ != ST_GL_DEMO_GAME)
+  {
+    recording = true;
+    subset = subset_;
+    levelnb = levelnb_;
+    mode = mode_;
+    seed = rand();
+    start_status = player_status;
+    inputs.clear();
+    checks.clear();
+    step = 0;
+    fed_input = 0;
+  }
+  else
+  {
+    st_srand(rand());
+    return;
+  }
+
+  st_srand(seed);
+  st_ticks_start_stepped(CLOCK_START);
+}
+
+/**
+ * Records the controls of tux for the current step or, while playing,
+ * replaces them by the recorded ones.
+ * @param world The world of the session.
+ */
+void Replay::feed_input(World& world)
+{
+  player_input_type& input = world.get_tux()->input;
+  if (recording)
+  {
+    fed_input = pack_input(input);
+  }
+  else if (playing && step < inputs.size())
+  {
+    unpack_input(inputs[step], &input);
+  }
+}
+
+/**
+ * Advances the step clock and compares or records the checksum of the
+ * world every CHECK_INTERVAL steps. A playback that is only fast
+ * forwarding hands tux over to the player once the recording is used up.
+ * @param world The world of the session.
+ * @return True once a playback to the end has played all steps.
+ */
+bool Replay::end_step(World& world)
+{
+  if (!recording && !playing)
+  {
+    return false;
+  }
+
+  if (recording)
+  {
+    inputs.push_back(fed_input);
+  }
+
+  if (step % CHECK_INTERVAL == 0)
+  {
+    uint32_t sum = checksum(world);
+    if (recording)
+    {
+      checks.push_back(sum);
+    }
+    else if (step / CHECK_INTERVAL < checks.size() && checks[step / CHECK_INTERVAL] != sum &&
+             mismatch_step == NO_MISMATCH)
+    {
+      mismatch_step = step;
+    }
+  }
+
+  ++step;
+  st_ticks_step(FRAME_RATE);
+
+  if (playing && step >= inputs.size())
+  {
+    if (seek_step == UINT_MAX)
+    {
+      return true;
+    }
+    playing = false;
+    st_ticks_stop_stepped();
+  }
+  return false;
+}
+
+/**
+ * Saves the recording, or remembers how the played session ended.
+ * @param exit_status_ How the session ended.
+ */
+void Replay::end_session(int exit_status_)
+{
+  if (playing)
+  {
+    playback_exit_status = exit_status_;
+  }
+  else if (recording)
+  {
+    recording = false;
+    exit_status = exit_status_;
+    st_ticks_stop_stepped();
+    if (save(record_file))
+    {
+      printf("Recorded %u steps into %s\n", (unsigned int)inputs.size(), record_file.c_str());
+    }
+    record_file.clear();
+  }
+}
+
+/**
+ * Computes the checksum of the state a replay has to reproduce: tux, the
+ * player status and the active badguys.
+ * @param world The world of the session.
+ * @return The FNV-1a hash of the state.
+ */
+uint32_t Replay::checksum(World& world)
+{
+  uint32_t hash = 2166136261u;
+  Player* tux = world.get_tux();
+  hash = hash_base(hash, tux->base);
+
+  int values[6] = { tux->dying, tux->size, player_status.score, player_status.distros,
+                    player_status.lives, static_cast<int>(world.bad_guys.size()) };
+  hash = hash_bytes(hash, values, sizeof(values));
+
+  for (BadGuy* badguy : world.bad_guys)
+  {
+    hash = hash_base(hash, badguy->base);
+    hash = hash_bytes(hash, &badguy->dying, sizeof(badguy->dying));
+  }
+  return hash;
+}
+
+// EOF
@@ -0,0 +1,106 @@
+//  replay.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_REPLAY_H
+#define SUPERTUX_REPLAY_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <SDL.h>
+
+class World;
+
+/** Records the input of a game session and plays it back.
+
+    A recording holds the level, the player status and the random seed
+    the session started with, the controls of tux for every logic step
+    and a checksum of the world every CHECK_INTERVAL steps. While a
+    session is recorded or played, the game ticks follow the logic steps
+    and the simulation draws its random numbers from st_rand(), so the
+    playback runs the same game as long as the game logic is unchanged.
+
+    Playback runs one step per frame without drawing. It either runs to
+    the end and reports whether the game went the same way, which is how
+    rewrites of the collision and physics code are checked, or stops
+    fast forwarding at a given time and lets the player go on from
+    there once the recorded input is used up. */
+class Replay
+{
+public:
+  static const unsigned int CHECK_INTERVAL = 100;
+
+  /** Record the next game session into the given file */
+  static void request_record(const std::string& file);
+
+  /** Play a recording back instead of the normal game */
+  static void request_playback(const std::string& file);
+
+  /** Only fast forward to the given time into the recording */
+  static void set_seek(float seconds);
+
+  static bool is_requested() { return !playback_file.empty(); }
+  static bool is_playing() { return playing; }
+  static bool is_fast_forward() { return playing && step < seek_step; }
+
+  /** Play the requested recording and print whether it matched */
+  static void run();
+
+  /** Start the recording or playback of a session that is being created */
+  static void begin_session(const std::string& subset, int levelnb, int mode);
+
+  /** Record the controls of tux, or replace them by the recorded ones */
+  static void feed_input(World& world);
+
+  /** Finish a logic step, returns true when the recording is played */
+  static bool end_step(World& world);
+
+  /** Save the recording or remember how the playback ended */
+  static void end_session(int exit_status);
+
+private:
+  static bool load(const std::string& file);
+  static bool save(const std::string& file);
+  static uint32_t checksum(World& world);
+
+  static std::string record_file;
+  static std::string playback_file;
+  static bool recording;
+  static bool playing;
+
+  static unsigned int step;
+  static unsigned int seek_step;
+  static unsigned int mismatch_step;
+
+  // The recording
+  static std::string subset;
+  static int levelnb;
+  static int mode;
+  static uint32_t seed;
+  static std::vector<Uint8> inputs;
+  static std::vector<uint32_t> checks;
+  static int exit_status;
+  static int playback_exit_status;
+};
+
+#endif /*SUPERTUX_REPLAY_H*/
+
+// EOF
@@ -25,6 +25,8 @@
 #include "special.h"
 #include "resources.h"
 #include "sprite_manager.h"
+#include "surface_manager.h"
+#include "image_loader.h"
 #include "setup.h"
 
 Surface* img_waves[3];
@@ -39,10 +41,33 @@ MusicRef level_end_song;
 
 SpriteManager* sprite_manager = 0;
 MusicManager* music_manager = 0;
+SurfaceManager* surface_manager = 0;
+
+/* Images loaded by loadshared(), decoded in the background while the
+   sprites are parsed */
+static const char* const shared_images[] = {
+  "shared/water.png", "shared/waves-0.png", "shared/waves-1.png",
+  "shared/waves-2.png", "shared/pole.png", "shared/poletop.png",
+  "shared/flag-0.png", "shared/flag-1.png",
+  "shared/cloud-00.png", "shared/cloud-01.png", "shared/cloud-02.png",
+  "shared/cloud-03.png", "shared/cloud-10.png", "shared/cloud-11.png",
+  "shared/cloud-12.png", "shared/cloud-13.png",
+  "tilesets/coin1.png", "tilesets/coin2.png", "tilesets/coin3.png",
+  "shared/tux-life.png"
+};
 
 /* Load graphics/sounds shared between all levels: */
 void loadshared()
 {
+  std::vector<std::string> files;
+  for (const char* image : shared_images)
+  {
+    files.push_back(datadir + "/images/" + image);
+  }
+  ImageLoader::queue(files);
+
+  surface_manager = new SurfaceManager();
+
   sprite_manager = new SpriteManager(datadir + "/supertux.strf");
   music_manager = new MusicManager();
   music_manager->enable_music(use_music);
@@ -175,9 +200,7 @@ void loadshared()
   tux_life = new Surface(datadir + "/images/shared/tux-life.png",
                          USE_ALPHA);
 
-  /* Sound effects: */
-
-  //loadsounds();
+  /* Sound effects are loaded when they are played first */
 
   /* Herring song */
   herring_song = music_manager->load_music(datadir + "/music/salcon.mod");
@@ -222,21 +245,13 @@ void unloadshared(void)
 
   delete music_manager;
   music_manager = nullptr;
-}
 
-void loadsounds()
-{
-  /* if (use_sound) // this will introduce SERIOUS bugs here ! because "load_sound"
-                    // initialize sounds[i] with the correct pointer's value:
-                    // NULL or something else. And it will be dangerous to
-                    // play with not-initialized pointers.
-                    // This is also true with if (use_music)
-                    Send a mail to me: neoneurone@users.sf.net, if you have another opinion. :)
-  */
-  for (int i = 0; i < NUM_SOUNDS; i++)
-    sounds[i] = load_sound(datadir + soundfilenames[i]);
+  // Images still referenced, e.g. by the tiles, are freed by their owners
+  delete surface_manager;
+  surface_manager = nullptr;
 }
 
+/* Free the sound effects, they are loaded again when played */
 void unloadsounds()
 {
   for (int i = 0; i < NUM_SOUNDS; i++)
@@ -24,6 +24,7 @@
 
 class SpriteManager;
 class MusicManager;
+class SurfaceManager;
 
 extern Surface* img_waves[3]; 
 extern Surface* img_water;
@@ -39,10 +40,10 @@ extern MusicRef level_end_song;
 
 extern SpriteManager* sprite_manager;
 extern MusicManager* music_manager;
+extern SurfaceManager* surface_manager;
 
 void loadshared();
 void unloadshared();
-void loadsounds();
 void unloadsounds();
 
 #endif
@@ -0,0 +1,382 @@
+//  savegame.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include <SDL.h>
+#include "savegame.h"
+#include "dir_index.h"
+#include "utils.h"
+
+namespace
+{
+
+// Bump whenever the layout of the payload changes
+const uint32_t FORMAT_VERSION = 1;
+
+// "STSG", the version, the payload size and the checksum of the payload
+const size_t HEADER_SIZE = 16;
+
+typedef std::vector<unsigned char> Bytes;
+
+// Everything below is guarded by mutex
+SDL_mutex* mutex = nullptr;
+SDL_Thread* thread = nullptr;
+bool running = false;
+std::vector<std::pair<std::string, Bytes> > pending;  // files waiting to be written
+
+/**
+ * Appends a 32 bit value in little endian byte order, so slots can be
+ * moved between machines.
+ */
+void put_u32(Bytes& out, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    out.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+void put_string(Bytes& out, const std::string& str)
+{
+  put_u32(out, str.size());
+  out.insert(out.end(), str.begin(), str.end());
+}
+
+/** Reads values back, stops at the end of the data instead of reading
+    past it */
+class Reader
+{
+public:
+  const unsigned char* pos;
+  const unsigned char* end;
+  bool ok;
+
+  Reader(const unsigned char* data, size_t size)
+    : pos(data), end(data + size), ok(true)
+  {
+  }
+
+  uint32_t get_u32()
+  {
+    if (!ok || end - pos < 4)
+    {
+      ok = false;
+      return 0;
+    }
+    uint32_t value = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (uint32_t(pos[3]) << 24);
+    pos += 4;
+    return value;
+  }
+
+  int get_int()
+  {
+    return static_cast<int32_t>(get_u32());
+  }
+
+  std::string get_string()
+  {
+    uint32_t size = get_u32();
+    if (!ok || uint32_t(end - pos) < size)
+    {
+      ok = false;
+      return std::string();
+    }
+    std::string str(reinterpret_cast<const char*>(pos), size);
+    pos += size;
+    return str;
+  }
+};
+
+/**
+ * Computes the checksum of a payload.
+ * @param data The first byte of the payload.
+ * @param size The size of the payload.
+ * @return The FNV-1a hash of the payload.
+ */
+uint32_t checksum(const unsigned char* data, size_t size)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Writes a slot file through a temporary file that replaces it once it
+ * is complete.
+ * @param filename The slot file.
+ * @param data The contents of the file.
+ */
+void write_file(const std::string& filename, const Bytes& data)
+{
+  write_file_atomic(filename, data.data(), data.size());
+}
+
+/**
+ * Body of the writer thread, writes queued files until there are none
+ * left.
+ * @param data Unused.
+ * @return Always 0.
+ */
+int worker(void* data)
+{
+  (void) data;
+
+  SDL_LockMutex(mutex);
+  while (!pending.empty())
+  {
+    std::pair<std::string, Bytes> job;
+    job.swap(pending.front());
+    pending.erase(pending.begin());
+    SDL_UnlockMutex(mutex);
+
+    write_file(job.first, job.second);
+
+    SDL_LockMutex(mutex);
+  }
+  running = false;
+  SDL_UnlockMutex(mutex);
+
+  return 0;
+}
+
+} // namespace
+
+/**
+ * Constructor for SaveGameData, describes a new game.
+ */
+SaveGameData::SaveGameData()
+  : lives(-1), score(0), distros(0), bonus(0), tux_x(0), tux_y(0), back_direction(0)
+{
+}
+
+/**
+ * Reads a binary slot file.
+ * @param filename The slot file.
+ * @param data Receives the progress, left alone if false is returned.
+ * @return True if the file was read.
+ */
+bool SaveGame::read(const std::string& filename, SaveGameData* data)
+{
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  unsigned char header[HEADER_SIZE];
+  bool valid = fread(header, 1, HEADER_SIZE, file) == HEADER_SIZE && memcmp(header, "STSG", 4) == 0;
+
+  Bytes payload;
+  uint32_t sum = 0;
+  if (valid)
+  {
+    Reader in(header + 4, HEADER_SIZE - 4);
+    uint32_t version = in.get_u32();
+    uint32_t size = in.get_u32();
+    sum = in.get_u32();
+
+    // Slots are tiny, anything big is garbage
+    valid = version == FORMAT_VERSION && size < 1024 * 1024;
+    if (valid)
+    {
+      payload.resize(size);
+      valid = fread(payload.data(), 1, size, file) == size;
+    }
+  }
+  fclose(file);
+
+  if (!valid || checksum(payload.data(), payload.size()) != sum)
+  {
+    return false;
+  }
+
+  Reader in(payload.data(), payload.size());
+  SaveGameData result;
+  result.title = in.get_string();
+  result.lives = in.get_int();
+  result.score = in.get_int();
+  result.distros = in.get_int();
+  result.bonus = in.get_int();
+  result.tux_x = in.get_int();
+  result.tux_y = in.get_int();
+  result.back_direction = in.get_int();
+
+  uint32_t count = in.get_u32();
+  if (!in.ok || uint32_t(in.end - in.pos) / 4 < count)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    result.level_hashes.push_back(in.get_u32());
+  }
+
+  if (uint32_t(in.end - in.pos) != (count + 7) / 8)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    result.solved.push_back((in.pos[i / 8] >> (i % 8)) & 1);
+  }
+
+  *data = result;
+  return true;
+}
+
+/**
+ * Queues a slot file for writing on the background thread. Writes
+ * synchronously if no thread can be started.
+ * @param filename The slot file.
+ * @param data The progress to save.
+ */
+void SaveGame::write(const std::string& filename, const SaveGameData& data)
+{
+  Bytes payload;
+  put_string(payload, data.title);
+  put_u32(payload, data.lives);
+  put_u32(payload, data.score);
+  put_u32(payload, data.distros);
+  put_u32(payload, data.bonus);
+  put_u32(payload, data.tux_x);
+  put_u32(payload, data.tux_y);
+  put_u32(payload, data.back_direction);
+
+  put_u32(payload, data.level_hashes.size());
+  for (uint32_t hash : data.level_hashes)
+  {
+    put_u32(payload, hash);
+  }
+
+  size_t bits = payload.size();
+  payload.resize(bits + (data.level_hashes.size() + 7) / 8, 0);
+  for (size_t i = 0; i < data.level_hashes.size(); ++i)
+  {
+    if (i < data.solved.size() && data.solved[i])
+    {
+      payload[bits + i / 8] |= 1 << (i % 8);
+    }
+  }
+
+  Bytes file;
+  file.insert(file.end(), "STSG", "STSG" + 4);
+  put_u32(file, FORMAT_VERSION);
+  put_u32(file, payload.size());
+  put_u32(file, checksum(payload.data(), payload.size()));
+  file.insert(file.end(), payload.begin(), payload.end());
+
+  // Menus read the slot again after they flush()ed the queue
+  size_t slash = filename.rfind('/');
+  DirIndex::invalidate(slash == std::string::npos ? "." : filename.substr(0, slash));
+
+  if (mutex == nullptr)
+  {
+    mutex = SDL_CreateMutex();
+    if (mutex == nullptr)
+    {
+      write_file(filename, file);
+      return;
+    }
+  }
+
+  SDL_LockMutex(mutex);
+  bool queued = false;
+  for (std::pair<std::string, Bytes>& job : pending)
+  {
+    if (job.first == filename)
+    {
+      job.second.swap(file);
+      queued = true;
+    }
+  }
+  if (!queued)
+  {
+    pending.push_back(std::make_pair(filename, Bytes()));
+    pending.back().second.swap(file);
+  }
+  SDL_Thread* finished = nullptr;
+  if (!running)
+  {
+    // A worker that is done still has to be waited for
+    finished = thread;
+    thread = SDL_CreateThread(worker, nullptr);
+    running = thread != nullptr;
+  }
+  bool threaded = running;
+  SDL_UnlockMutex(mutex);
+
+  if (finished)
+  {
+    SDL_WaitThread(finished, nullptr);
+  }
+
+  if (!threaded)
+  {
+    // Write it right away instead, while nobody else touches the queue
+    std::vector<std::pair<std::string, Bytes> > jobs;
+    SDL_LockMutex(mutex);
+    jobs.swap(pending);
+    SDL_UnlockMutex(mutex);
+
+    for (const std::pair<std::string, Bytes>& job : jobs)
+    {
+      write_file(job.first, job.second);
+    }
+  }
+}
+
+/**
+ * Waits until the background thread has written all queued files.
+ */
+void SaveGame::flush()
+{
+  if (mutex == nullptr)
+  {
+    return;
+  }
+
+  SDL_LockMutex(mutex);
+  SDL_Thread* busy = thread;
+  thread = nullptr;
+  SDL_UnlockMutex(mutex);
+
+  if (busy)
+  {
+    SDL_WaitThread(busy, nullptr);
+  }
+}
+
+/**
+ * Hashes the file name of a level.
+ * @param name The file name of the level.
+ * @return The FNV-1a hash of the name.
+ */
+uint32_t SaveGame::hash_name(const std::string& name)
+{
+  return checksum(reinterpret_cast<const unsigned char*>(name.data()), name.size());
+}
+
+// EOF
@@ -0,0 +1,76 @@
+//  savegame.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_SAVEGAME_H
+#define SUPERTUX_SAVEGAME_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** The progress of a game, as kept in a slot file */
+struct SaveGameData
+{
+  std::string title;
+  int lives;
+  int score;
+  int distros;
+  int bonus;                           // a PlayerStatus::BonusType
+  int tux_x;
+  int tux_y;
+  int back_direction;                  // a WorldMapNS::Direction
+
+  /** SaveGame::hash_name() of every level of the worldmap, in the order
+      of the worldmap, and whether it was solved */
+  std::vector<uint32_t> level_hashes;
+  std::vector<bool> solved;
+
+  SaveGameData();
+};
+
+/** Reads and writes slot files in a small versioned binary format:
+    a header with a checksum, the player status and one bit per level.
+
+    Writing happens on a background thread. The data is written to a
+    temporary file first and then renamed over the slot file, so a slot
+    is never left half written. Files in the old S-expression format are
+    not understood by read() and have to be imported by the caller. */
+class SaveGame
+{
+public:
+  /** Read a binary slot file, returns false if the file is missing,
+      damaged or not in the binary format */
+  static bool read(const std::string& filename, SaveGameData* data);
+
+  /** Queue a slot file for writing, replacing an older write of the same
+      file that didn't happen yet */
+  static void write(const std::string& filename, const SaveGameData& data);
+
+  /** Wait until all queued files are written */
+  static void flush();
+
+  /** Identify levels by their file names */
+  static uint32_t hash_name(const std::string& name);
+};
+
+#endif /*SUPERTUX_SAVEGAME_H*/
+
+// EOF
@@ -18,6 +18,7 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <iostream>
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,6 +37,15 @@
 #include "screen.h"
 #include "setup.h"
 #include "type.h"
+#include "render_batch.h"
+#include "gl_shader.h"
+#include "gx_video.h"
+#include "anim_clock.h"
+#include "frame_scheduler.h"
+#include "transition.h"
+#include "render_thread.h"
+#include "virtual_screen.h"
+#include "mousecursor.h"
 
 // Utility macros for sign and absolute value
 #define SGN(x) ((x) > 0 ? 1 : ((x) == 0 ? 0 : (-1)))
@@ -52,6 +62,7 @@
  */
 void clearOpenGLScreen(float r, float g, float b)
 {
+  RenderBatch::flush();
   glClearColor(r, g, b, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -64,14 +75,11 @@ void clearOpenGLScreen(float r, float g, float b)
  */
 void drawOpenGLGradient(const Color& top_clr, const Color& bot_clr)
 {
-  glBegin(GL_QUADS);
-  glColor3ub(top_clr.red, top_clr.green, top_clr.blue);
-  glVertex2f(0, 0);
-  glVertex2f(640, 0);
-  glColor3ub(bot_clr.red, bot_clr.green, bot_clr.blue);
-  glVertex2f(640, 480);
-  glVertex2f(0, 480);
-  glEnd();
+  const GLubyte top[4] = { static_cast<GLubyte>(top_clr.red), static_cast<GLubyte>(top_clr.green),
+                           static_cast<GLubyte>(top_clr.blue), 255 };
+  const GLubyte bottom[4] = { static_cast<GLubyte>(bot_clr.red), static_cast<GLubyte>(bot_clr.green),
+                              static_cast<GLubyte>(bot_clr.blue), 255 };
+  RenderBatch::add_rect(false, top, bottom, 0, 0, screen->w, screen->h);
 }
 
 /**
@@ -84,6 +92,19 @@ void drawOpenGLGradient(const Color& top_clr, const Color& bot_clr)
  */
 void drawOpenGLLine(int x1, int y1, int x2, int y2, int r, int g, int b, int a)
 {
+  RenderBatch::flush();
+
+  if (ShaderRenderer::is_active())
+  {
+    const GLubyte color[4] = { static_cast<GLubyte>(r), static_cast<GLubyte>(g),
+                               static_cast<GLubyte>(b), static_cast<GLubyte>(a) };
+    ShaderRenderer::begin();
+    ShaderRenderer::draw_line(static_cast<float>(x1), static_cast<float>(y1),
+                              static_cast<float>(x2), static_cast<float>(y2), color);
+    ShaderRenderer::end();
+    return;
+  }
+
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glColor4ub(r, g, b, a);
@@ -105,18 +126,9 @@ void drawOpenGLLine(int x1, int y1, int x2, int y2, int r, int g, int b, int a)
  */
 void fillOpenGLRect(float x, float y, float w, float h, int r, int g, int b, int a)
 {
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glColor4ub(r, g, b, a);
-
-  glBegin(GL_POLYGON);
-  glVertex2f(x, y);
-  glVertex2f(x + w, y);
-  glVertex2f(x + w, y + h);
-  glVertex2f(x, y + h);
-  glEnd();
-
-  glDisable(GL_BLEND);
+  const GLubyte color[4] = { static_cast<GLubyte>(r), static_cast<GLubyte>(g),
+                             static_cast<GLubyte>(b), static_cast<GLubyte>(a) };
+  RenderBatch::add_rect(true, color, color, x, y, x + w, y + h);
 }
 
 /**
@@ -124,11 +136,129 @@ void fillOpenGLRect(float x, float y, float w, float h, int r, int g, int b, int
  */
 void swapOpenGLBuffers()
 {
+  RenderBatch::flush();
+  VirtualScreen::present_gl();
   SDL_GL_SwapBuffers();
+  VirtualScreen::begin_frame_gl();
 }
 
 #endif // NOOPENGL
 
+/* --- DIRTY RECTANGLES --- */
+#define MAX_DIRTY_RECTS 64
+
+static SDL_Rect dirty_rects[MAX_DIRTY_RECTS];
+static int dirty_count = 0;
+static bool dirty_full = false;
+
+/**
+ * Tells whether the SDL screen can be presented in parts. With hardware
+ * page flipping the back buffer has to be flipped as a whole.
+ * @return True if SDL_UpdateRects() can be used.
+ */
+static bool can_update_rects()
+{
+  return !use_gl && !use_gx && screen != nullptr &&
+         !((screen->flags & SDL_HWSURFACE) && (screen->flags & SDL_DOUBLEBUF));
+}
+
+/**
+ * Marks an area of the screen as changed, so that the next flipscreen()
+ * presents it. Overlapping areas are merged as long as that doesn't
+ * make the update bigger, too many areas turn into a full update.
+ * @param x, y Coordinates of the top-left corner of the area
+ * @param w, h Width and height of the area
+ */
+void add_dirty_rect(int x, int y, int w, int h)
+{
+  if (dirty_full || screen == nullptr)
+  {
+    return;
+  }
+
+  // Clip to the screen
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > screen->w)
+  {
+    w = screen->w - x;
+  }
+  if (y + h > screen->h)
+  {
+    h = screen->h - y;
+  }
+  if (w <= 0 || h <= 0)
+  {
+    return;
+  }
+
+  if (w == screen->w && h == screen->h)
+  {
+    dirty_full = true;
+    return;
+  }
+
+  for (int i = 0; i < dirty_count; ++i)
+  {
+    SDL_Rect& rect = dirty_rects[i];
+    int x1 = std::min(x, static_cast<int>(rect.x));
+    int y1 = std::min(y, static_cast<int>(rect.y));
+    int x2 = std::max(x + w, rect.x + rect.w);
+    int y2 = std::max(y + h, rect.y + rect.h);
+
+    if ((x2 - x1) * (y2 - y1) <= w * h + rect.w * rect.h)
+    {
+      rect.x = x1;
+      rect.y = y1;
+      rect.w = x2 - x1;
+      rect.h = y2 - y1;
+      return;
+    }
+  }
+
+  if (dirty_count == MAX_DIRTY_RECTS)
+  {
+    dirty_full = true;
+    return;
+  }
+
+  SDL_Rect& rect = dirty_rects[dirty_count++];
+  rect.x = x;
+  rect.y = y;
+  rect.w = w;
+  rect.h = h;
+}
+
+/**
+ * Presents the areas changed since the last call and forgets them.
+ */
+static void present_dirty_rects()
+{
+  if (RenderThread::is_recording())
+  {
+    RenderThread::present(dirty_rects, dirty_count, !can_update_rects() || dirty_full);
+  }
+  else if (!can_update_rects() || dirty_full)
+  {
+    SDL_Flip(screen);
+  }
+  else if (dirty_count > 0)
+  {
+    SDL_UpdateRects(screen, dirty_count, dirty_rects);
+  }
+
+  dirty_count = 0;
+  dirty_full = false;
+}
+
 /* --- CLEAR SCREEN --- */
 /**
  * Clears the screen with a given color.
@@ -145,7 +275,31 @@ void clearscreen(int r, int g, int b)
     return;
   }
 #endif
-  SDL_FillRect(screen, NULL, SDL_MapRGB(screen->format, r, g, b));
+#ifdef _WII_
+  if (use_gx)
+  {
+    const Uint8 color[4] = { static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), 255 };
+    GXVideo::fill_rect(false, color, color, 0, 0, screen->w, screen->h);
+    return;
+  }
+#endif
+  SDL_Rect rect = { 0, 0, static_cast<Uint16>(screen->w), static_cast<Uint16>(screen->h) };
+  RenderThread::fill(&rect, SDL_MapRGB(screen->format, r, g, b), 255);
+  add_dirty_rect(0, 0, screen->w, screen->h);
+}
+
+/**
+ * Computes the colour of a band of a vertical gradient.
+ * @param top_clr The color at the top of the screen
+ * @param bot_clr The color at the bottom of the screen
+ * @param y The first line of the band
+ * @return The colour of the band
+ */
+static Color gradient_color(const Color& top_clr, const Color& bot_clr, float y)
+{
+  return Color(static_cast<int>(((top_clr.red - bot_clr.red) / -static_cast<float>(screen->h)) * y + top_clr.red),
+               static_cast<int>(((top_clr.green - bot_clr.green) / -static_cast<float>(screen->h)) * y + top_clr.green),
+               static_cast<int>(((top_clr.blue - bot_clr.blue) / -static_cast<float>(screen->h)) * y + top_clr.blue));
 }
 
 /* --- DRAWS A VERTICAL GRADIENT --- */
@@ -165,49 +319,71 @@ void drawgradient(Color top_clr, Color bot_clr)
     return;
   }
 #endif
-  for (float y = 0; y < 480; y += 2)
+#ifdef _WII_
+  if (use_gx)
+  {
+    const Uint8 top[4] = { static_cast<Uint8>(top_clr.red), static_cast<Uint8>(top_clr.green),
+                           static_cast<Uint8>(top_clr.blue), 255 };
+    const Uint8 bottom[4] = { static_cast<Uint8>(bot_clr.red), static_cast<Uint8>(bot_clr.green),
+                              static_cast<Uint8>(bot_clr.blue), 255 };
+    GXVideo::fill_rect(false, top, bottom, 0, 0, screen->w, screen->h);
+    return;
+  }
+#endif
+  for (float y = 0; y < screen->h; y += 2)
   {
     // Linear interpolation to calculate the color at each line
-    fillrect(0, static_cast<int>(y), 640, 2,
-             static_cast<int>(((top_clr.red - bot_clr.red) / -480.0f) * y + top_clr.red),
-             static_cast<int>(((top_clr.green - bot_clr.green) / -480.0f) * y + top_clr.green),
-             static_cast<int>(((top_clr.blue - bot_clr.blue) / -480.0f) * y + top_clr.blue),
-             255);
+    Color color = gradient_color(top_clr, bot_clr, y);
+    fillrect(0, static_cast<int>(y), screen->w, 2, color.red, color.green, color.blue, 255);
+  }
+}
+
+/**
+ * Renders the gradient drawgradient() draws into a new surface in the
+ * format of the screen, so software mode can blit it instead of drawing
+ * it line by line every frame.
+ * @param top_clr The color at the top of the screen
+ * @param bot_clr The color at the bottom of the screen
+ * @return The surface, owned by the caller
+ */
+SDL_Surface* create_gradient_surface(Color top_clr, Color bot_clr)
+{
+  SDL_PixelFormat* format = screen->format;
+  SDL_Surface* surface = SDL_CreateRGBSurface(SDL_SWSURFACE, screen->w, screen->h, format->BitsPerPixel,
+                                              format->Rmask, format->Gmask, format->Bmask, 0);
+  if (surface == nullptr)
+  {
+    st_abort("No memory left.", "");
+  }
+
+  for (int y = 0; y < screen->h; y += 2)
+  {
+    Color color = gradient_color(top_clr, bot_clr, y);
+    SDL_Rect band = { 0, static_cast<Sint16>(y), static_cast<Uint16>(screen->w), 2 };
+    SDL_FillRect(surface, &band, SDL_MapRGB(surface->format, color.red, color.green, color.blue));
   }
+  return surface;
 }
 
 /* --- FADE IN/OUT --- */
 /**
- * Fades the given surface to/from black over a specified number of seconds.
+ * Fades the given surface in, over what is on screen or from black.
  * @param surface The surface to fade.
- * @param seconds The duration of the fade effect.
- * @param fade_out If true, the surface fades out; otherwise, it fades in.
+ * @param seconds The duration of the fade effect, which has always been
+ *                taken as milliseconds.
+ * @param fade_out If true, the surface fades in over the frame on screen;
+ *                 otherwise it fades in from black.
  */
 void fade(Surface *surface, int seconds, bool fade_out)
 {
-  float alpha = fade_out ? 0.0f : 255.0f;  // Initialize alpha based on fade direction
-
-  int cur_time = SDL_GetTicks();
-  int old_time = cur_time;
-
-  // Fade loop: adjust alpha based on elapsed time
-  while ((fade_out && alpha < 256.0f) || (!fade_out && alpha >= 0.0f))
+  if (fade_out)
   {
-    surface->draw(0, 0, static_cast<int>(alpha));  // Draw the surface with the current alpha
-    flipscreen();  // Update the screen
-
-    old_time = cur_time;
-    cur_time = SDL_GetTicks();
-
-    float calc = static_cast<float>(cur_time - old_time) / seconds;
-    if (fade_out)
-    {
-      alpha += 255.0f * calc;  // Increase alpha for fade out
-    }
-    else
-    {
-      alpha -= 255.0f * calc;  // Decrease alpha for fade in
-    }
+    Transition::capture();
+    Transition::run(Transition::CROSSFADE, seconds, surface);
+  }
+  else
+  {
+    Transition::run(Transition::FADE_IN, seconds, surface);
   }
 }
 
@@ -269,6 +445,9 @@ void putpixel(SDL_Surface *surface, int x, int y, Uint32 pixel)
  */
 void drawpixel(int x, int y, Uint32 pixel)
 {
+  // Pixels aren't worth a place in the draw list
+  RenderThread::finish();
+
   if (SDL_MUSTLOCK(screen))
   {
     if (SDL_LockSurface(screen) < 0)
@@ -287,7 +466,7 @@ void drawpixel(int x, int y, Uint32 pixel)
   {
     SDL_UnlockSurface(screen);
   }
-  SDL_Flip(screen);
+  add_dirty_rect(x, y, 1, 1);
 }
 
 /* --- DRAW LINE --- */
@@ -308,6 +487,14 @@ void drawline(int x1, int y1, int x2, int y2, int r, int g, int b, int a)
     drawOpenGLLine(x1, y1, x2, y2, r, g, b, a);
     return;
   }
+#endif
+#ifdef _WII_
+  if (use_gx)
+  {
+    const Uint8 color[4] = { static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), static_cast<Uint8>(a) };
+    GXVideo::draw_line(x1, y1, x2, y2, color);
+    return;
+  }
 #endif
   int lg_delta = x2 - x1;
   int sh_delta = y2 - y1;
@@ -390,31 +577,24 @@ void fillrect(float x, float y, float w, float h, int r, int g, int b, int a)
     return;
   }
 #endif
-  SDL_Rect rect = {static_cast<Sint16>(ix), static_cast<Sint16>(iy), static_cast<Uint16>(iw), static_cast<Uint16>(ih)};
-  SDL_Surface *temp = nullptr;
-
-  if (a != 255)
-  {
-    temp = SDL_CreateRGBSurface(screen->flags, rect.w, rect.h, screen->format->BitsPerPixel,
-                                screen->format->Rmask, screen->format->Gmask, screen->format->Bmask, screen->format->Amask);
-
-    SDL_FillRect(temp, NULL, SDL_MapRGB(screen->format, r, g, b));
-    SDL_SetAlpha(temp, SDL_SRCALPHA, a);
-    SDL_BlitSurface(temp, NULL, screen, &rect);
-    SDL_FreeSurface(temp);
-  }
-  else
+#ifdef _WII_
+  if (use_gx)
   {
-    SDL_FillRect(screen, &rect, SDL_MapRGB(screen->format, r, g, b));
+    const Uint8 color[4] = { static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), static_cast<Uint8>(a) };
+    GXVideo::fill_rect(true, color, color, ix, iy, ix + iw, iy + ih);
+    return;
   }
+#endif
+  SDL_Rect rect = {static_cast<Sint16>(ix), static_cast<Sint16>(iy), static_cast<Uint16>(iw), static_cast<Uint16>(ih)};
+  RenderThread::fill(&rect, SDL_MapRGB(screen->format, r, g, b), a);
+  add_dirty_rect(ix, iy, iw, ih);
 }
 
 /* --- FLIP SCREEN --- */
 /**
- * Flips the screen to update the display.
- * Uses SDL_GL_SwapBuffers for OpenGL, SDL_Flip otherwise.
+ * Presents the frame with whatever renderer is in use.
  */
-void flipscreen()
+static void present_frame()
 {
 #ifndef NOOPENGL
   if (use_gl)
@@ -423,7 +603,33 @@ void flipscreen()
     return;
   }
 #endif
-  SDL_Flip(screen);
+#ifdef _WII_
+  if (use_gx)
+  {
+    GXVideo::flip();
+    return;
+  }
+#endif
+  present_dirty_rects();
+}
+
+/**
+ * Flips the screen to update the display.
+ * Uses SDL_GL_SwapBuffers for OpenGL. In SDL mode only the areas drawn
+ * to since the last flip are presented, when the screen allows it.
+ */
+void flipscreen()
+{
+  // The mouse pointer goes over everything else of the frame
+  MouseCursor::present();
+
+  // Everything drawn from now on belongs to the next frame
+  AnimationClock::tick();
+
+  // The time presenting takes tells the scheduler whether vsync is on
+  FrameScheduler::begin_flip();
+  present_frame();
+  FrameScheduler::end_flip();
 }
 
 /* --- FADE OUT SCREEN --- */
@@ -440,14 +646,48 @@ void fadeout()
 
 /* --- UPDATE A RECTANGLE ON SCREEN --- */
 /**
- * Updates a specific rectangle on the screen.
- * Uses SDL_Flip for non-OpenGL rendering.
+ * Presents a specific rectangle of the screen right away.
+ * Falls back to SDL_Flip when the screen can't be updated in parts,
+ * does nothing for OpenGL and GX rendering.
  */
 void update_rect(SDL_Surface *scr, Sint32 x, Sint32 y, Sint32 w, Sint32 h)
 {
-  if (!use_gl)
+  if (use_gl || use_gx)
   {
-    SDL_Flip(screen);
+    return;
+  }
+
+  // Whatever is to be presented has to be on the screen
+  RenderThread::finish();
+
+  if (!can_update_rects())
+  {
+    SDL_Flip(scr);
+    return;
+  }
+
+  // Clip to the screen, SDL_UpdateRect() doesn't like areas outside of it
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > scr->w)
+  {
+    w = scr->w - x;
+  }
+  if (y + h > scr->h)
+  {
+    h = scr->h - y;
+  }
+  if (w > 0 && h > 0)
+  {
+    SDL_UpdateRect(scr, x, y, w, h);
   }
 }
 
@@ -44,11 +44,13 @@ struct Color
 void drawline(int x1, int y1, int x2, int y2, int r, int g, int b, int a); // Draws a line on the screen
 void clearscreen(int r, int g, int b); // Clears the entire screen with a solid color
 void drawgradient(Color top_clr, Color bot_clr); // Draws a vertical gradient
+SDL_Surface* create_gradient_surface(Color top_clr, Color bot_clr); // Renders the gradient into a new surface
 void fillrect(float x, float y, float w, float h, int r, int g, int b, int a); // Fills a rectangle with a solid color
 void fade(const std::string& surface, int seconds, bool fade_out); // Fades the screen in or out using a surface
 void updatescreen(void); // Updates the screen
 void flipscreen(void); // Flips the screen buffers
 void update_rect(SDL_Surface *scr, Sint32 x, Sint32 y, Sint32 w, Sint32 h); // Updates a rectangular area of the screen
+void add_dirty_rect(int x, int y, int w, int h); // Marks an area as changed for the next flipscreen() (SDL mode)
 void fadeout(); // Fades the screen out to black
 
 #endif /* SUPERTUX_SCREEN_H */
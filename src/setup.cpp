@@ -38,6 +38,8 @@
 #endif
 
 #include <cctype>
+#include <vector>
+#include <algorithm>
 
 #include "defines.h"
 #include "globals.h"
@@ -54,6 +56,24 @@
 #include "title.h"
 #include "music_manager.h"
 #include "player.h"
+#include "profiler.h"
+#include "dir_index.h"
+#include "asset_archive.h"
+#include "benchmark.h"
+#include "replay.h"
+#include "collision_bench.h"
+#include "transition.h"
+#include "savegame.h"
+#include "image_loader.h"
+#include "startup_trace.h"
+#include "job_system.h"
+#include "render_thread.h"
+#include "memory_budget.h"
+#include "hot_reload.h"
+#include "virtual_screen.h"
+#include "sound_bank.h"
+#include "gl_shader.h"
+#include "gx_video.h"
 
 #ifdef WIN32
 #define mkdir(dir, mode)    mkdir(dir)
@@ -63,8 +83,8 @@
 
 /* Screen properties: */
 /* Don't use this to test for the actual screen sizes. Use screen->w/h instead! */
-#define SCREEN_W 640
-#define SCREEN_H 480
+#define SCREEN_W VirtualScreen::WIDTH
+#define SCREEN_H VirtualScreen::HEIGHT
 
 /* Stores whether we're loading from and saving to SD or USB (Wii Only) */
 int selecteddevice;
@@ -79,12 +99,17 @@ void usage(char * prog, int ret);
 namespace fs = std::filesystem;
 
 /**
- * Checks if the given file exists and is accessible.
+ * Checks if the given file exists and is accessible, either in the asset
+ * archive or on disk.
  * @param filename Path to the file.
  * @return true if the file exists and is accessible, false otherwise.
  */
 bool faccessible(const char *filename)
 {
+  if (AssetArchive::contains(filename))
+  {
+    return true;
+  }
   return fs::exists(filename) && fs::is_regular_file(filename);
 }
 
@@ -150,7 +175,8 @@ FILE * opendata(const char * rel_filename, const char * mode)
 
 /**
  * Function to process both directories and files.
- * This function handles the logic for scanning a directory (or subdirectory).
+ * This function handles the logic for scanning a directory (or subdirectory),
+ * the contents come from the DirIndex and are only read from disk once.
  * @param base_path Base path to the directory.
  * @param rel_path Relative path to the directory.
  * @param expected_file The expected file to be found in the directory (optional).
@@ -170,7 +196,8 @@ static void process_directory(const std::string &base_path, const std::string &r
 #endif
 
   // Check if the path exists
-  if (!fs::exists(path))
+  const DirIndex::Listing& listing = DirIndex::list(path.string());
+  if (!listing.exists)
   {
     // Suppress error message if the path is optional
     if (glob != nullptr || exception_str != nullptr) {
@@ -184,35 +211,35 @@ static void process_directory(const std::string &base_path, const std::string &r
   }
 
   // Iterate through directory entries
-  for (const auto& entry : fs::directory_iterator(path))
+  for (const DirIndex::Entry& entry : listing.entries)
   {
     // Check if entry matches directory or file based on is_subdir flag
-    if ((is_subdir && entry.is_directory()) || (!is_subdir && entry.is_regular_file()))
+    if (entry.is_dir == is_subdir)
     {
+      fs::path entry_path = path / entry.name;
 
       // If expected_file is provided, check if it exists in the directory
       if (expected_file != nullptr)
       {
-        fs::path expected_path = entry.path() / expected_file;
-        if (!faccessible(expected_path.c_str()))
+        if (!DirIndex::has_file((entry_path / expected_file).string()))
         {
           continue;
         }
       }
 
       // Apply optional filters
-      if (exception_str != nullptr && entry.path().string().find(exception_str) != std::string::npos)
+      if (exception_str != nullptr && entry_path.string().find(exception_str) != std::string::npos)
       {
         continue;
       }
 
-      if (glob != nullptr && entry.path().string().find(glob) == std::string::npos)
+      if (glob != nullptr && entry_path.string().find(glob) == std::string::npos)
       {
         continue;
       }
 
       // Add the item to the list (only filename, not full path)
-      string_list_add_item(sdirs, entry.path().filename().string().c_str());
+      string_list_add_item(sdirs, entry.name.c_str());
     }
   }
 }
@@ -254,6 +281,22 @@ string_list_type dfiles(const char *rel_path, const char* glob, const char* exce
 
 #ifdef _WII_
 
+/**
+ * Opens the file telling that a directory holds the game data, either the
+ * sprite definitions or the asset archive containing them.
+ * @param dir The data directory to check.
+ * @return The opened file, nullptr if the data isn't there.
+ */
+static std::FILE* open_data_marker(const std::string& dir)
+{
+  std::FILE* fp = std::fopen((dir + "/supertux.strf").c_str(), "rb");
+  if (!fp)
+  {
+    fp = std::fopen((dir + "/" + AssetArchive::FILE_NAME).c_str(), "rb");
+  }
+  return fp;
+}
+
 /**
  * Set SuperTux configuration and save directories (HBC Wii specific)
  * This sets up the directory structure, including the save directory.
@@ -264,7 +307,7 @@ void st_directory_setup(void)
   std::FILE *fp = nullptr;
 
   // SD Card
-  fp = std::fopen("sd:/apps/supertux/data/supertux.strf", "rb");
+  fp = open_data_marker("sd:/apps/supertux/data");
 
   if (fp)
   {
@@ -285,7 +328,7 @@ void st_directory_setup(void)
   if (!deviceselection)
   {
     // USB Flash Drive
-    fp = std::fopen("usb:/apps/supertux/data/supertux.strf", "rb");
+    fp = open_data_marker("usb:/apps/supertux/data");
 
     if (fp)
     {
@@ -307,7 +350,7 @@ void st_directory_setup(void)
   if (!deviceselection)
   {
     // Fallback
-    fp = std::fopen("/apps/supertux/data/supertux.strf", "rb");
+    fp = open_data_marker("/apps/supertux/data");
 
     if (fp)
     {
@@ -526,6 +569,10 @@ void st_menu(void)
 
 void update_load_save_game_menu(Menu* pmenu)
 {
+  // The slots are looked up in the DirIndex, a pending save has to be on
+  // the disk before the save directory is read again
+  SaveGame::flush();
+
   for (int i = 2; i < 7; ++i)
   {
     // FIXME: Insert a real savegame struct/class here instead of doing string vodoo
@@ -665,6 +712,20 @@ void st_general_setup(void)
   /* Unicode needed for input handling: */
   SDL_EnableUNICODE(1);
 
+  /* Decode the global images in the background, they are converted and
+     handed out in the order below */
+  static const char* const global_images[] = {
+    "letters-black.png", "letters-gold.png", "letters-blue.png",
+    "letters-white.png", "letters-white-small.png", "letters-white-big.png",
+    "checkbox.png", "checkbox-checked.png", "back.png", "mousecursor.png"
+  };
+  std::vector<std::string> files;
+  for (const char* image : global_images)
+  {
+    files.push_back(datadir + "/images/status/" + image);
+  }
+  ImageLoader::queue(files);
+
   /* Load global images: */
   black_text = new Text(datadir + "/images/status/letters-black.png", TEXT_TEXT, 16, 18);
   gold_text = new Text(datadir + "/images/status/letters-gold.png", TEXT_TEXT, 16, 18);
@@ -726,6 +787,9 @@ void st_general_free(void)
  */
 void st_video_setup(void)
 {
+  // The render thread draws onto the screen that is about to be replaced
+  RenderThread::finish();
+
   /* Init SDL Video: */
   if (SDL_Init(SDL_INIT_VIDEO) < 0)
   {
@@ -749,6 +813,19 @@ void st_video_setup(void)
 #endif
     st_video_setup_sdl();  // Call SDL setup function otherwise
 
+#ifdef _WII_
+  if (use_gx && !GXVideo::init())
+  {
+    fprintf(stderr, "Warning: Could not set up GX, drawing with SDL.\n");
+    use_gx = false;
+  }
+#endif
+
+#ifndef NOOPENGL
+  // Atlas pages of a previous GL context can't be packed into anymore
+  TextureAtlas::invalidate();
+#endif
+  Transition::invalidate();
   Surface::reload_all();
 
 #ifndef _WII_ /* Skip window manager setup for Wii builds */
@@ -813,25 +890,36 @@ void st_video_setup_gl(void)
   SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 5);
   SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+  // Ask for vsync, the frame scheduler notices whether the driver obliged
+  SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);
+
+  // The window may be larger than the game, VirtualScreen scales to it
+  int output_w, output_h;
+  SDL_Surface* output = nullptr;
 
   if (use_fullscreen)
   {
-    screen = SDL_SetVideoMode(SCREEN_W, SCREEN_H, 16, SDL_FULLSCREEN | SDL_OPENGL);
-    if (screen == nullptr)
+    VirtualScreen::get_output_size(true, &output_w, &output_h);
+    output = SDL_SetVideoMode(output_w, output_h, 16, SDL_FULLSCREEN | SDL_OPENGL);
+    if (output == nullptr)
     {
-      std::string error_msg = "Warning: Could not set up fullscreen video for 640x480 mode.\n"
+      std::string error_msg = "Warning: Could not set up fullscreen video for " +
+                              std::to_string(output_w) + "x" + std::to_string(output_h) + " mode.\n"
                               "The Simple DirectMedia error that occurred was:\n";
       error_msg += SDL_GetError();
       fprintf(stderr, "%s\n\n", error_msg.c_str());
       use_fullscreen = false;
     }
   }
-  else
+
+  if (!use_fullscreen)
   {
-    screen = SDL_SetVideoMode(SCREEN_W, SCREEN_H, 16, SDL_OPENGL);
-    if (screen == nullptr)
+    VirtualScreen::get_output_size(false, &output_w, &output_h);
+    output = SDL_SetVideoMode(output_w, output_h, 16, SDL_OPENGL);
+    if (output == nullptr)
     {
-      std::string error_msg = "Error: Could not set up video for 640x480 mode.\n"
+      std::string error_msg = "Error: Could not set up video for " +
+                              std::to_string(output_w) + "x" + std::to_string(output_h) + " mode.\n"
                               "The Simple DirectMedia error that occurred was:\n";
       error_msg += SDL_GetError();
       st_abort("Video Setup Failed", error_msg);
@@ -844,7 +932,9 @@ void st_video_setup_gl(void)
   glDisable(GL_DEPTH_TEST);
   glDisable(GL_CULL_FACE);
 
-  glViewport(0, 0, screen->w, screen->h);
+  // Sets the viewport as well
+  screen = VirtualScreen::init_gl(output);
+
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glOrtho(0, screen->w, screen->h, 0, -1.0, 1.0);
@@ -852,6 +942,11 @@ void st_video_setup_gl(void)
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
   glTranslatef(0.0f, 0.0f, 0.0f);
+
+  if (use_gl_shaders && !ShaderRenderer::init(screen->w, screen->h))
+  {
+    fprintf(stderr, "Warning: OpenGL shaders are not supported, using the fixed function pipeline.\n");
+  }
 }
 #endif
 
@@ -962,6 +1057,11 @@ void st_audio_setup(void)
       use_music = false;
       audio_device = false;
     }
+    else
+    {
+      // The effects, converted to the format that was just opened
+      SoundBank::open();
+    }
   }
 }
 
@@ -972,21 +1072,69 @@ void st_audio_setup(void)
  */
 void st_shutdown(void)
 {
+  // Finish writing the savegame before anything goes away
+  SaveGame::flush();
+
+  JobSystem::shutdown();
+  RenderThread::shutdown();
+
   // Close the audio system and free resources
   close_audio();
 
+#ifndef NOOPENGL
+  ShaderRenderer::shutdown();
+#endif
+
   // Quit SDL subsystems
   SDL_Quit();
 
   // Save the current game configuration
   saveconfig();
 
+  Profiler::close_csv();
+  AssetArchive::close();
+
 #ifdef _WII_
   // Reset the system and return to the system menu
   SYS_ResetSystem(SYS_RETURNTOMENU, 0, 0);
 #endif
 }
 
+/**
+ * Returns the mutex guarding the threads of st_defer_abort().
+ * @return The mutex, created on first use.
+ */
+static SDL_mutex* defer_abort_mutex()
+{
+  static SDL_mutex* mutex = SDL_CreateMutex();
+  return mutex;
+}
+
+static std::vector<Uint32> deferring_threads;
+
+/**
+ * Lets st_abort() on the calling thread throw an AbortError, which the
+ * thread catches and hands to the main thread, instead of shutting the
+ * game down underneath it.
+ * @param defer True to throw, false to go back to aborting.
+ */
+void st_defer_abort(bool defer)
+{
+  Uint32 id = SDL_ThreadID();
+
+  SDL_mutexP(defer_abort_mutex());
+  std::vector<Uint32>::iterator it = std::find(deferring_threads.begin(), deferring_threads.end(), id);
+  if (defer && it == deferring_threads.end())
+  {
+    deferring_threads.push_back(id);
+  }
+  else if (!defer && it != deferring_threads.end())
+  {
+    deferring_threads.erase(it);
+  }
+  SDL_mutexV(defer_abort_mutex());
+}
+
 /**
  * Aborts the program with an error message, performing a graceful shutdown
  * before terminating the application. This function is used to handle critical
@@ -997,6 +1145,16 @@ void st_shutdown(void)
  */
 void st_abort(const std::string& reason, const std::string& details)
 {
+  // Worker threads leave the shutdown to the main thread
+  SDL_mutexP(defer_abort_mutex());
+  bool deferred = std::find(deferring_threads.begin(), deferring_threads.end(), SDL_ThreadID()) !=
+                  deferring_threads.end();
+  SDL_mutexV(defer_abort_mutex());
+  if (deferred)
+  {
+    throw AbortError{reason, details};
+  }
+
   // Construct the error message
   std::string errmsg = "\nError: " + reason + "\n" + details + "\n";
 
@@ -1118,6 +1276,111 @@ void parseargs(int argc, char* argv[])
       /* Show FPS */
       show_fps = true;
     }
+    else if (strcmp(argv[i], "--benchmark") == 0)
+    {
+      /* Play a level with recorded input and report the frame times */
+      if (i + 2 < argc)
+      {
+        Benchmark::request(argv[i + 1], argv[i + 2]);
+        i += 2;
+      }
+      else
+      {
+        usage(argv[0], 1);
+      }
+    }
+    else if (strcmp(argv[i], "--collision-bench") == 0)
+    {
+      /* Compare the collision functions against the reference versions */
+      int queries = 20000;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+      {
+        queries = atoi(argv[++i]);
+      }
+      CollisionBench::request(queries > 0 ? queries : 1);
+    }
+    else if (strcmp(argv[i], "--record") == 0)
+    {
+      /* Record the input of the next level played */
+      if (i + 1 < argc)
+      {
+        Replay::request_record(argv[++i]);
+      }
+      else
+      {
+        usage(argv[0], 1);
+      }
+    }
+    else if (strcmp(argv[i], "--replay") == 0)
+    {
+      /* Play a recording back and check that it plays the same */
+      if (i + 1 < argc)
+      {
+        Replay::request_playback(argv[++i]);
+      }
+      else
+      {
+        usage(argv[0], 1);
+      }
+    }
+    else if (strcmp(argv[i], "--seek") == 0)
+    {
+      /* Fast forward a replay only up to the given second */
+      if (i + 1 < argc)
+      {
+        Replay::set_seek(atof(argv[++i]));
+      }
+      else
+      {
+        usage(argv[0], 1);
+      }
+    }
+    else if (strcmp(argv[i], "--no-render") == 0)
+    {
+      /* Don't draw during benchmarks */
+      Benchmark::set_render(false);
+    }
+    else if (strcmp(argv[i], "--pack-data") == 0)
+    {
+      /* Pack the data directory into an asset archive and quit */
+      if (i + 1 < argc)
+      {
+        AssetArchive::request_pack(argv[++i]);
+      }
+      else
+      {
+        usage(argv[0], 1);
+      }
+    }
+    else if (strcmp(argv[i], "--trace-startup") == 0)
+    {
+      /* Print how long the phases of the startup took */
+      StartupTrace::enable(true);
+    }
+    else if (strcmp(argv[i], "--profile") == 0)
+    {
+      /* Show the frame time profiler */
+      Profiler::enable(true);
+    }
+    else if (strcmp(argv[i], "--profile-csv") == 0)
+    {
+      /* Write the frame timings to a file */
+      if (i + 1 < argc)
+      {
+        Profiler::enable(true);
+        Profiler::open_csv(argv[++i]);
+      }
+    }
+    else if (strcmp(argv[i], "--hot-reload") == 0)
+    {
+      /* Read edited levels, tilesets and sprites again while playing */
+      HotReload::enable(true);
+    }
+    else if (strcmp(argv[i], "--memory-report") == 0)
+    {
+      /* Print the peak memory use of each level played */
+      MemoryBudget::enable_report(true);
+    }
     else if (strcmp(argv[i], "--opengl") == 0 || strcmp(argv[i], "-gl") == 0)
     {
 #ifndef NOOPENGL
@@ -1125,11 +1388,54 @@ void parseargs(int argc, char* argv[])
       use_gl = true;
 #endif
     }
+    else if (strcmp(argv[i], "--gl-shaders") == 0)
+    {
+#ifndef NOOPENGL
+      /* Use OpenGL, drawing through vertex buffers and shaders */
+      use_gl = true;
+      use_gl_shaders = true;
+#endif
+    }
+    else if (strcmp(argv[i], "--geometry") == 0)
+    {
+      /* Size of the OpenGL window, the game is scaled to it */
+      int width, height;
+      if (i + 1 < argc && sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+      {
+        VirtualScreen::set_output_size(width, height);
+      }
+      else
+      {
+        puts("Warning: Invalid geometry, should be: 'WIDTHxHEIGHT'");
+      }
+    }
+    else if (strcmp(argv[i], "--filter") == 0)
+    {
+      /* How frames are scaled to the display */
+      if (i + 1 < argc && strcmp(argv[i + 1], "nearest") == 0)
+      {
+        VirtualScreen::set_filter(VirtualScreen::FILTER_NEAREST);
+      }
+      else if (i + 1 < argc && strcmp(argv[i + 1], "linear") == 0)
+      {
+        VirtualScreen::set_filter(VirtualScreen::FILTER_LINEAR);
+      }
+      else
+      {
+        puts("Warning: Unknown filter, should be 'nearest' or 'linear'");
+      }
+      ++i;
+    }
     else if (strcmp(argv[i], "--sdl") == 0)
     {
       /* Use SDL (non-OpenGL) */
       use_gl = false;
     }
+    else if (strcmp(argv[i], "--pipeline") == 0)
+    {
+      /* Draw SDL frames on a render thread while the next one is run */
+      RenderThread::set_enabled(true);
+    }
     else if (strcmp(argv[i], "--usage") == 0)
     {
       /* Show usage */
@@ -1170,7 +1476,16 @@ void parseargs(int argc, char* argv[])
            "  -f, --fullscreen    Run in fullscreen mode.\n"
            "  -gl, --opengl       If opengl support was compiled in, this will enable\n"
            "                      the OpenGL mode.\n"
+           "  --gl-shaders        Like above, but draw with vertex buffers and shaders\n"
+           "                      if the driver supports them.\n"
            "  --sdl               Use non-opengl renderer\n"
+           "  --pipeline          Draw the frames of the non-opengl renderer on a thread\n"
+           "                      of their own, one frame behind the game.\n"
+           "  --geometry WxH      Open the OpenGL window with this size, the game is\n"
+           "                      scaled to it (default: 640x480, the desktop size\n"
+           "                      in fullscreen).\n"
+           "  --filter FILTER     Scale with 'nearest' (whole numbers only) or 'linear'\n"
+           "                      filtering (default: linear).\n"
            "\n"
            "Sound Options:\n"
            "  --disable-sound     If sound support was compiled in,  this will\n"
@@ -1183,6 +1498,25 @@ void parseargs(int argc, char* argv[])
            "                      Define how joystick buttons and axis should be mapped\n"
            "  -d, --datadir DIR   Load Game data from DIR (default: automatic)\n"
            "  --debug-mode        Enables the debug-mode, which is useful for developers.\n"
+           "  --benchmark LEVEL INPUT\n"
+           "                      Play LEVEL with the input events from INPUT as fast as\n"
+           "                      possible and report the frame times.\n"
+           "  --no-render         Don't draw the frames of a benchmark.\n"
+           "  --collision-bench [QUERIES]\n"
+           "                      Check the collision functions on every level with\n"
+           "                      QUERIES random queries each and report their speed.\n"
+           "  --record FILE       Record the input of the next level played into FILE.\n"
+           "  --replay FILE       Play the recording FILE as fast as possible and report\n"
+           "                      whether the game went the same way.\n"
+           "  --seek SECONDS      Fast forward a replay only to SECONDS into it and play\n"
+           "                      on from there.\n"
+           "  --profile           Show how long the parts of each frame take.\n"
+           "  --profile-csv FILE  Like above, and write the timings of every frame to FILE.\n"
+           "  --memory-report     Print the peak memory use of each level played.\n"
+           "  --hot-reload        Show edits of the level, tileset and sprites while\n"
+           "                      playing, without restarting the game.\n"
+           "  --trace-startup     Print how long the phases of the startup take.\n"
+           "  --pack-data FILE    Pack the game data into the asset archive FILE and quit.\n"
            "  --help              Display a help message summarizing command-line\n"
            "                      options, license and game controls.\n"
            "  --usage             Display a brief message summarizing command-line options.\n"
@@ -45,6 +45,17 @@ void st_shutdown(void); // Shuts down the game and frees resources
 void st_menu(void); // Displays the main menu
 void st_abort(const std::string& reason, const std::string& details); // Aborts the game with a reason and details
 
+/** What st_abort() throws on a thread that defers its errors */
+struct AbortError
+{
+  std::string reason;
+  std::string details;
+};
+
+// Makes st_abort() on the calling thread throw AbortError instead of shutting
+// down, for worker threads that hand their errors to the main thread
+void st_defer_abort(bool defer);
+
 void process_options_menu(void); // Processes the options menu
 bool process_load_game_menu(); // Returns true if the game loop was entered
 void update_load_save_game_menu(Menu* pmenu); // Updates the load/save game menu
@@ -18,11 +18,16 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
+#include <algorithm>
 #include <SDL_mixer.h>
 #include "defines.h"
 #include "globals.h"
 #include "sound.h"
 #include "setup.h"
+#include "scene.h"
+#include "asset_archive.h"
+#include "memory_budget.h"
+#include "sound_bank.h"
 
 /* Global variables */
 bool use_sound = true;    /* handle sound on/off menu and command-line option */
@@ -57,8 +62,49 @@ const char * soundfilenames[NUM_SOUNDS] =
   "/sounds/warp.wav"
 };
 
+const Sound_Priority sound_priorities[NUM_SOUNDS] =
+{
+  SOUND_PRIORITY_NORMAL,  /* jump */
+  SOUND_PRIORITY_NORMAL,  /* bigjump */
+  SOUND_PRIORITY_LOW,     /* skid */
+  SOUND_PRIORITY_LOW,     /* distro */
+  SOUND_PRIORITY_HIGH,    /* herring */
+  SOUND_PRIORITY_LOW,     /* brick */
+  SOUND_PRIORITY_HIGH,    /* hurt */
+  SOUND_PRIORITY_NORMAL,  /* squish */
+  SOUND_PRIORITY_HIGH,    /* fall */
+  SOUND_PRIORITY_LOW,     /* ricochet */
+  SOUND_PRIORITY_NORMAL,  /* upgrade */
+  SOUND_PRIORITY_HIGH,    /* excellent */
+  SOUND_PRIORITY_HIGH,    /* coffee */
+  SOUND_PRIORITY_LOW,     /* shoot */
+  SOUND_PRIORITY_HIGH,    /* lifeup */
+  SOUND_PRIORITY_NORMAL,  /* stomp */
+  SOUND_PRIORITY_NORMAL,  /* kick */
+  SOUND_PRIORITY_NORMAL,  /* explode */
+  SOUND_PRIORITY_HIGH     /* warp */
+};
+
 Mix_Chunk * sounds[NUM_SOUNDS];
 
+/* What each channel is playing, to decide which one to cut off */
+struct Voice {
+  Sound_Priority priority;
+  unsigned int started;   /* value of voice_counter when it started */
+};
+
+static Voice voices[TOTAL_CHANNELS];
+static unsigned int voice_counter = 0;
+
+/* Positioned sounds requested in this frame */
+struct Sound_Request {
+  int count;
+  float pan_sum;
+};
+
+static Sound_Request requests[NUM_SOUNDS];
+static bool requests_pending = false;
+
 /**
  * Open the audio device and allocate a fixed number of channels.
  * @param frequency Frequency to be set for audio.
@@ -80,16 +126,6 @@ int open_audio(int frequency, Uint16 format, int channels, int chunksize)
     return -2;
   }
 
-  /* Reserve some channels and register panning effects */
-  if (Mix_ReserveChannels(SOUND_RESERVED_CHANNELS) != SOUND_RESERVED_CHANNELS)
-  {
-    return -3;
-  }
-
-  /* Prepare the spanning effects */
-  Mix_SetPanning(SOUND_LEFT_SPEAKER, 230, 24);
-  Mix_SetPanning(SOUND_RIGHT_SPEAKER, 24, 230);
-
   return 0;
 }
 
@@ -100,9 +136,12 @@ void close_audio(void)
 {
   if (audio_device)
   {
-    Mix_UnregisterAllEffects(SOUND_LEFT_SPEAKER);
-    Mix_UnregisterAllEffects(SOUND_RIGHT_SPEAKER);
+    for (int channel = 0; channel < TOTAL_CHANNELS; ++channel)
+    {
+      Mix_UnregisterAllEffects(channel);
+    }
     Mix_CloseAudio();
+    SoundBank::close();
   }
 }
 
@@ -118,54 +157,170 @@ Mix_Chunk* load_sound(const std::string& file)
     return nullptr;
   }
 
-  Mix_Chunk* snd = Mix_LoadWAV(file.c_str());
+  // Mix_LoadWAV_RW() copies the samples, so the data can go right away
+  Mix_Chunk* snd;
+  std::string data;
+  if (AssetArchive::read(file, &data))
+  {
+    snd = Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
+  }
+  else
+  {
+    snd = Mix_LoadWAV(file.c_str());
+  }
 
   if (snd == nullptr)
   {
     st_abort("Can't load", file);
   }
 
+  MemoryBudget::add(MEM_SOUNDS, snd->alen);
   return snd;
 }
 
 /**
- * Play a sound on the specified speaker and check if all channels are full (debug mode).
- * @param snd Sound chunk to be played.
- * @param whichSpeaker Enum specifying left, right, or center speaker.
+ * Find a channel for a new sound: a free one, or else the oldest of the
+ * least important sounds, if it isn't more important than the new one.
+ * @param priority The priority of the new sound.
+ * @return The channel, or -1 if the sound has to be dropped.
  */
-void play_sound(Mix_Chunk* snd, enum Sound_Speaker whichSpeaker)
+static int allocate_voice(Sound_Priority priority)
 {
-  /* This won't call the function if the user has disabled sound
-   * either via menu or via command-line option
-   */
-  if (!audio_device || !use_sound)
+  int victim = -1;
+
+  for (int channel = 0; channel < TOTAL_CHANNELS; ++channel)
   {
-    return;
+    if (!Mix_Playing(channel))
+    {
+      return channel;
+    }
+
+    const Voice& voice = voices[channel];
+    if (voice.priority <= priority &&
+        (victim == -1 || voice.priority < voices[victim].priority ||
+         (voice.priority == voices[victim].priority && voice.started < voices[victim].started)))
+    {
+      victim = channel;
+    }
   }
 
+  if (victim != -1)
+  {
+    Mix_HaltChannel(victim);
+  }
 #ifdef DEBUG
-  // Check if all channels are full
-  if (Mix_Playing(-1) >= TOTAL_CHANNELS)
+  else
   {
-    printf("Warning: Exceeded available channels! Sound may not play.\n");
+    printf("Warning: All channels busy with more important sounds, dropping one.\n");
   }
 #endif
 
-  Mix_PlayChannel(whichSpeaker, snd, 0);
+  return victim;
+}
+
+/**
+ * Start a sound on a channel of its own.
+ * @param sound The sound, one of the SND_ constants.
+ * @param pan -1 for fully left, 0 for centered, 1 for fully right.
+ */
+static void start_voice(int sound, float pan)
+{
+  if (!audio_device || !use_sound)
+  {
+    return;
+  }
+  preload_sound(sound);
+
+  int channel = allocate_voice(sound_priorities[sound]);
+  if (channel == -1)
+  {
+    return;
+  }
+
+  // The far side never goes fully silent, like the old left/right speakers
+  Uint8 left = 255, right = 255;
+  if (pan > 0)
+  {
+    left = static_cast<Uint8>(255 - 231 * std::min(pan, 1.0f));
+  }
+  else if (pan < 0)
+  {
+    right = static_cast<Uint8>(255 - 231 * std::min(-pan, 1.0f));
+  }
+  Mix_SetPanning(channel, left, right);  // 255/255 removes the effect again
+
+  if (Mix_PlayChannel(channel, sounds[sound], 0) == channel)
+  {
+    voices[channel].priority = sound_priorities[sound];
+    voices[channel].started = ++voice_counter;
+  }
+}
 
-  /* Prepare for panning effects for next call */
-  switch (whichSpeaker)
+/**
+ * Load a sound effect unless it is loaded already, it comes from the
+ * sound bank if that is open.
+ * @param sound The sound, one of the SND_ constants.
+ */
+void preload_sound(int sound)
+{
+  if (audio_device && sounds[sound] == nullptr)
   {
-    case SOUND_LEFT_SPEAKER:
-      Mix_SetPanning(SOUND_LEFT_SPEAKER, 230, 24);
-      break;
+    sounds[sound] = SoundBank::get(sound);
+    if (sounds[sound] == nullptr)
+    {
+      sounds[sound] = load_sound(datadir + soundfilenames[sound]);
+    }
+  }
+}
 
-    case SOUND_RIGHT_SPEAKER:
-      Mix_SetPanning(SOUND_RIGHT_SPEAKER, 24, 230);
-      break;
+/**
+ * Play a sound right away, centered.
+ * @param sound The sound, one of the SND_ constants.
+ */
+void play_sound(int sound)
+{
+  start_voice(sound, 0);
+}
 
-    default:  // Keep the compiler happy
-      break;
+/**
+ * Request a sound made at a position in the level for this frame.
+ * @param sound The sound, one of the SND_ constants.
+ * @param x The position in the level the sound comes from.
+ */
+void play_sound(int sound, float x)
+{
+  if (!audio_device || !use_sound)
+  {
+    return;
+  }
+
+  float half_width = screen->w / 2;
+  requests[sound].count++;
+  requests[sound].pan_sum += (x - scroll_x - half_width) / half_width;
+  requests_pending = true;
+}
+
+/**
+ * Play the sounds requested since the last call, each of them once, from
+ * the average position of its requests.
+ */
+void flush_sounds()
+{
+  if (!requests_pending)
+  {
+    return;
+  }
+  requests_pending = false;
+
+  for (int sound = 0; sound < NUM_SOUNDS; ++sound)
+  {
+    Sound_Request& request = requests[sound];
+    if (request.count > 0)
+    {
+      start_voice(sound, request.pan_sum / request.count);
+      request.count = 0;
+      request.pan_sum = 0;
+    }
   }
 }
 
@@ -175,6 +330,16 @@ void play_sound(Mix_Chunk* snd, enum Sound_Speaker whichSpeaker)
  */
 void free_chunk(Mix_Chunk* chunk)
 {
+  // The samples of the sound bank are freed all at once by close_audio()
+  if (SoundBank::owns(chunk))
+  {
+    return;
+  }
+
+  if (chunk)
+  {
+    MemoryBudget::add(MEM_SOUNDS, -static_cast<long>(chunk->alen));
+  }
   Mix_FreeChunk(chunk);
 }
 
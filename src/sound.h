@@ -36,12 +36,11 @@ enum Music_Type {
   HERRING_MUSIC
 };
 
-/* panning effects: terrible :-) ! */
-enum Sound_Speaker {
-  SOUND_LEFT_SPEAKER = 0,
-  SOUND_RIGHT_SPEAKER = 1,
-  SOUND_RESERVED_CHANNELS = 2, // 2 channels reserved for left/right speaker
-  SOUND_CENTER_SPEAKER = -1
+/* Which sounds may cut off which when all channels are busy */
+enum Sound_Priority {
+  SOUND_PRIORITY_LOW,     /* coins, bricks, shots: plenty of them */
+  SOUND_PRIORITY_NORMAL,  /* jumps, stomps, kicks */
+  SOUND_PRIORITY_HIGH     /* hurting, dying, extra lives */
 };
 
 /* Sound files: */
@@ -82,7 +81,20 @@ void close_audio( void );
 
 Mix_Chunk * load_sound(const std::string& file);
 void free_chunk(Mix_Chunk*chunk);
-void play_sound(Mix_Chunk * snd, enum Sound_Speaker whichSpeaker);
+
+/* Load a sound before it is played, sounds load on first use otherwise */
+void preload_sound(int sound);
+
+/* Play a sound right away, centered */
+void play_sound(int sound);
+
+/* Play a sound made at world position x, panned relative to scroll_x.
+   Requests are collected until flush_sounds(), a sound requested several
+   times in one frame plays only once. */
+void play_sound(int sound, float x);
+
+/* Play the sounds requested since the last call, once per frame */
+void flush_sounds();
 
 #endif /*SUPERTUX_SOUND_H*/
 
@@ -0,0 +1,339 @@
+//  sound_bank.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <filesystem>
+#include "sound_bank.h"
+#include "sound.h"
+#include "asset_archive.h"
+#include "memory_budget.h"
+#include "globals.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Bump whenever the layout of the file changes
+const uint32_t FORMAT_VERSION = 1;
+
+// Samples of each effect start at a multiple of this
+const uint32_t ALIGNMENT = 8;
+
+struct Header
+{
+  char magic[4];           // "STSB"
+  uint32_t version;        // FORMAT_VERSION
+  int32_t frequency;       // of the audio device
+  uint32_t format;         // AUDIO_ sample format of the audio device
+  int32_t channels;        // of the audio device
+  uint32_t count;          // NUM_SOUNDS
+};
+
+struct Entry
+{
+  uint64_t source_size;    // size of the .wav file
+  int64_t source_mtime;    // modification time of the .wav file
+  uint32_t offset;         // of the samples, from the start of the file
+  uint32_t length;         // of the samples in bytes
+};
+
+/** The whole bank file, the chunks point into it */
+std::vector<Uint8> bank;
+Mix_Chunk chunks[NUM_SOUNDS];
+bool is_open = false;
+
+/**
+ * Computes where the bank is kept, every data directory has its own.
+ * @return The path of the bank file.
+ */
+fs::path bank_path()
+{
+  // FNV-1a, like the level cache
+  uint32_t hash = 2166136261u;
+  for (char c : datadir)
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+
+  char name[32];
+  snprintf(name, sizeof(name), "%08x.stsb", hash);
+  return fs::path(st_dir) / "cache" / "sounds" / name;
+}
+
+/**
+ * Fills in the size and modification time of a sound file.
+ * @param filename The .wav file.
+ * @param entry Receives the size and modification time.
+ * @return False if the file can't be examined.
+ */
+bool get_source_info(const std::string& filename, Entry* entry)
+{
+  uint64_t packed_size;
+  int64_t packed_mtime;
+  if (AssetArchive::get_info(filename, &packed_size, &packed_mtime))
+  {
+    entry->source_size = packed_size;
+    entry->source_mtime = packed_mtime;
+    return true;
+  }
+
+  std::error_code ec;
+  uintmax_t size = fs::file_size(filename, ec);
+  if (ec)
+  {
+    return false;
+  }
+  fs::file_time_type mtime = fs::last_write_time(filename, ec);
+  if (ec)
+  {
+    return false;
+  }
+
+  entry->source_size = size;
+  entry->source_mtime = mtime.time_since_epoch().count();
+  return true;
+}
+
+/**
+ * Fills in what the bank has to look like for the current audio device
+ * and sound files.
+ * @param header Receives the audio format.
+ * @param entries Receives the state of each sound file.
+ * @return False if the audio device or one of the files can't be examined.
+ */
+bool get_expected(Header* header, Entry* entries)
+{
+  int frequency, channels;
+  Uint16 format;
+  if (Mix_QuerySpec(&frequency, &format, &channels) == 0)
+  {
+    return false;
+  }
+
+  memcpy(header->magic, "STSB", 4);
+  header->version = FORMAT_VERSION;
+  header->frequency = frequency;
+  header->format = format;
+  header->channels = channels;
+  header->count = NUM_SOUNDS;
+
+  for (int i = 0; i < NUM_SOUNDS; ++i)
+  {
+    if (!get_source_info(datadir + soundfilenames[i], &entries[i]))
+    {
+      return false;
+    }
+    entries[i].offset = 0;
+    entries[i].length = 0;
+  }
+  return true;
+}
+
+/**
+ * Reads the bank file if it matches the expected state.
+ * @param expected The header the file must have.
+ * @param expected_entries The sound files the file must have been built from.
+ * @return True if bank holds a valid bank.
+ */
+bool read_bank(const Header& expected, const Entry* expected_entries)
+{
+  FILE* file = fopen(bank_path().string().c_str(), "rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  bool valid = fseek(file, 0, SEEK_END) == 0;
+  long size = valid ? ftell(file) : -1;
+  valid = size >= static_cast<long>(sizeof(Header) + NUM_SOUNDS * sizeof(Entry)) &&
+          fseek(file, 0, SEEK_SET) == 0;
+  if (valid)
+  {
+    bank.resize(size);
+    valid = fread(bank.data(), 1, size, file) == static_cast<size_t>(size);
+  }
+  fclose(file);
+
+  const Header* header = reinterpret_cast<const Header*>(bank.data());
+  valid = valid && memcmp(header, &expected, sizeof(Header)) == 0;
+
+  const Entry* entries = reinterpret_cast<const Entry*>(bank.data() + sizeof(Header));
+  for (int i = 0; valid && i < NUM_SOUNDS; ++i)
+  {
+    valid = entries[i].source_size == expected_entries[i].source_size &&
+            entries[i].source_mtime == expected_entries[i].source_mtime &&
+            entries[i].offset <= static_cast<unsigned long>(size) &&
+            entries[i].length <= size - entries[i].offset;
+  }
+
+  if (!valid)
+  {
+    std::vector<Uint8>().swap(bank);
+  }
+  return valid;
+}
+
+/**
+ * Decodes all sound files into bank and writes it to disk, failing to
+ * write it only means it is built again next time.
+ * @param expected The header of the bank.
+ * @param expected_entries The state of the sound files.
+ * @return False if one of the sounds can't be decoded.
+ */
+bool build_bank(const Header& expected, const Entry* expected_entries)
+{
+  std::vector<Entry> entries(expected_entries, expected_entries + NUM_SOUNDS);
+  std::vector<Uint8> result(sizeof(Header) + NUM_SOUNDS * sizeof(Entry));
+
+  for (int i = 0; i < NUM_SOUNDS; ++i)
+  {
+    // Mix_LoadWAV_RW() converts to the format of the audio device
+    std::string filename = datadir + soundfilenames[i];
+    Mix_Chunk* chunk;
+    std::string data;
+    if (AssetArchive::read(filename, &data))
+    {
+      chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), data.size()), 1);
+    }
+    else
+    {
+      chunk = Mix_LoadWAV(filename.c_str());
+    }
+
+    if (chunk == nullptr)
+    {
+      return false;
+    }
+
+    result.resize((result.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    entries[i].offset = result.size();
+    entries[i].length = chunk->alen;
+    result.insert(result.end(), chunk->abuf, chunk->abuf + chunk->alen);
+    Mix_FreeChunk(chunk);
+  }
+
+  memcpy(result.data(), &expected, sizeof(Header));
+  memcpy(result.data() + sizeof(Header), entries.data(), NUM_SOUNDS * sizeof(Entry));
+  bank.swap(result);
+
+  fs::path path = bank_path();
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+
+  // Write to a temporary file first, a cut off bank must never be used
+  fs::path temp = path;
+  temp += ".tmp";
+
+  FILE* file = fopen(temp.string().c_str(), "wb");
+  if (file == nullptr)
+  {
+    return true;
+  }
+
+  bool written = fwrite(bank.data(), 1, bank.size(), file) == bank.size();
+  written = (fclose(file) == 0) && written;
+
+  if (written)
+  {
+    fs::rename(temp, path, ec);
+  }
+  if (!written || ec)
+  {
+    fs::remove(temp, ec);
+  }
+  return true;
+}
+
+} // namespace
+
+/**
+ * Reads the bank, or builds it, and points the chunks into it.
+ * @return False if the sounds have to be loaded one by one.
+ */
+bool SoundBank::open()
+{
+  close();
+
+  Header expected;
+  Entry expected_entries[NUM_SOUNDS];
+  if (!get_expected(&expected, expected_entries))
+  {
+    return false;
+  }
+
+  if (!read_bank(expected, expected_entries) && !build_bank(expected, expected_entries))
+  {
+    return false;
+  }
+
+  const Entry* entries = reinterpret_cast<const Entry*>(bank.data() + sizeof(Header));
+  for (int i = 0; i < NUM_SOUNDS; ++i)
+  {
+    // Not allocated, Mix_FreeChunk() would leave the samples alone
+    chunks[i].allocated = 0;
+    chunks[i].abuf = bank.data() + entries[i].offset;
+    chunks[i].alen = entries[i].length;
+    chunks[i].volume = MIX_MAX_VOLUME;
+  }
+
+  MemoryBudget::add(MEM_SOUNDS, bank.size());
+  is_open = true;
+  return true;
+}
+
+/**
+ * Frees the buffer of the bank.
+ */
+void SoundBank::close()
+{
+  if (is_open)
+  {
+    MemoryBudget::add(MEM_SOUNDS, -static_cast<long>(bank.size()));
+    std::vector<Uint8>().swap(bank);
+    is_open = false;
+  }
+}
+
+/**
+ * Returns the chunk of a sound.
+ * @param sound The sound, one of the SND_ constants.
+ * @return The chunk, or nullptr if the bank isn't open.
+ */
+Mix_Chunk* SoundBank::get(int sound)
+{
+  return is_open ? &chunks[sound] : nullptr;
+}
+
+/**
+ * Tells whether a chunk belongs to the bank.
+ * @param chunk The chunk to check.
+ * @return True if the chunk came from get().
+ */
+bool SoundBank::owns(const Mix_Chunk* chunk)
+{
+  return chunk >= chunks && chunk < chunks + NUM_SOUNDS;
+}
+
+// EOF
@@ -0,0 +1,55 @@
+//  sound_bank.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_SOUND_BANK_H
+#define SUPERTUX_SOUND_BANK_H
+
+#include <SDL_mixer.h>
+
+/** All sound effects in one file below st_dir/cache, already converted
+    to the format the audio device was opened with.
+
+    The first run decodes every effect once and writes the bank, later
+    runs read it with a single fread() into one buffer that the chunks of
+    all effects point into. The bank is rebuilt when the audio format or
+    any of the sound files changes. */
+class SoundBank
+{
+public:
+  /** Read the bank, or build it if it is missing or out of date, must be
+      called after the audio device was opened. Returns false if effects
+      have to be loaded one by one. */
+  static bool open();
+
+  /** Free the buffer, after which no chunk of the bank may be played */
+  static void close();
+
+  /** The chunk of a sound, one of the SND_ constants, or nullptr if the
+      bank isn't open. The chunk belongs to the bank. */
+  static Mix_Chunk* get(int sound);
+
+  /** Whether chunk is one of get(), those are never freed on their own */
+  static bool owns(const Mix_Chunk* chunk);
+};
+
+#endif /*SUPERTUX_SOUND_BANK_H*/
+
+// EOF
@@ -17,7 +17,6 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
-#include <assert.h>
 #include <iostream>
 #include "SDL.h"
 #include "defines.h"
@@ -72,22 +71,11 @@ void Bullet::init(float x, float y, float xm, Direction dir)
 }
 
 /**
- * Removes the bullet from the bullet list.
+ * Marks the bullet for removal from the bullet list.
  */
 void Bullet::remove_me()
 {
-  std::vector<Bullet>& bullets = World::current()->bullets;
-  for (std::vector<Bullet>::iterator i = bullets.begin();
-       i != bullets.end(); ++i)
-  {
-    if (&(*i) == this)
-    {
-      bullets.erase(i);
-      return;
-    }
-  }
-
-  assert(false);
+  World::current()->bullets.remove(handle);
 }
 
 /**
@@ -199,22 +187,11 @@ void Upgrade::init(float x_, float y_, Direction dir_, UpgradeKind kind_)
 }
 
 /**
- * Removes the upgrade from the upgrade list.
+ * Marks the upgrade for removal from the upgrade list.
  */
 void Upgrade::remove_me()
 {
-  std::vector<Upgrade>& upgrades = World::current()->upgrades;
-  for (std::vector<Upgrade>::iterator i = upgrades.begin();
-       i != upgrades.end(); ++i)
-  {
-    if (&(*i) == this)
-    {
-      upgrades.erase(i);
-      return;
-    }
-  }
-
-  assert(false);
+  World::current()->upgrades.remove(handle);
 }
 
 /**
@@ -368,7 +345,7 @@ void Upgrade::bump(Player*)
     return;
   }
 
-  //play_sound(sounds[SND_BUMP_UPGRADE], SOUND_CENTER_SPEAKER);
+  //play_sound(SND_BUMP_UPGRADE);
 
   // do a little jump and change direction
   physic.set_velocity(-physic.get_velocity_x(), 3);
@@ -403,18 +380,18 @@ void Upgrade::collision(void* p_c_object, int c_object, CollisionType type)
 
       if (kind == UPGRADE_GROWUP)
       {
-        play_sound(sounds[SND_EXCELLENT], SOUND_CENTER_SPEAKER);
+        play_sound(SND_EXCELLENT);
         pplayer->grow();
       }
       else if (kind == UPGRADE_ICEFLOWER)
       {
-        play_sound(sounds[SND_COFFEE], SOUND_CENTER_SPEAKER);
+        play_sound(SND_COFFEE);
         pplayer->grow();
         pplayer->got_coffee = true;
       }
       else if (kind == UPGRADE_HERRING)
       {
-        play_sound(sounds[SND_HERRING], SOUND_CENTER_SPEAKER);
+        play_sound(SND_HERRING);
         pplayer->invincible_timer.start(TUX_INVINCIBLE_TIME);
         World::current()->play_music(HERRING_MUSIC);
       }
@@ -423,7 +400,7 @@ void Upgrade::collision(void* p_c_object, int c_object, CollisionType type)
         if (player_status.lives < MAX_LIVES)
         {
           player_status.lives++;
-          play_sound(sounds[SND_LIFEUP], SOUND_CENTER_SPEAKER);
+          play_sound(SND_LIFEUP);
         }
       }
 
@@ -445,6 +422,30 @@ void load_special_gfx()
   img_bullet = sprite_manager->load("bullet");
 }
 
+/**
+ * Loads the sprites an upgrade uses.
+ * @param kind The kind of upgrade.
+ */
+void preload_special_gfx(UpgradeKind kind)
+{
+  switch (kind)
+  {
+    case UPGRADE_GROWUP:
+      img_growup->preload();
+      break;
+    case UPGRADE_ICEFLOWER:
+      img_iceflower->preload();
+      img_bullet->preload();
+      break;
+    case UPGRADE_HERRING:
+      img_star->preload();
+      break;
+    case UPGRADE_1UP:
+      img_1up->preload();
+      break;
+  }
+}
+
 /**
  * Frees special graphics resources (empty for now).
  */
@@ -26,6 +26,7 @@
 #include "collision.h"
 #include "player.h"
 #include "physic.h"
+#include "object_pool.h"
 
 // Upgrade types
 enum UpgradeKind {
@@ -38,12 +39,16 @@ enum UpgradeKind {
 void load_special_gfx();
 void free_special_gfx();
 
+/** Load the graphics of an upgrade before it shows up */
+void preload_special_gfx(UpgradeKind kind);
+
 class Upgrade : public GameObject
 {
 public:
   UpgradeKind kind;
   Direction dir;
   Physic physic;
+  SwapHandle handle;  // In the world's upgrade list
 
   void init(float x, float y, Direction dir, UpgradeKind kind);
   void action(double frame_ratio);
@@ -54,7 +59,7 @@ public:
   ~Upgrade() {};
 
 private:
-  // Removes the upgrade from the global upgrade list, class does not exist afterward
+  // Marks the upgrade for removal from the global upgrade list at the end of World::action()
   void remove_me();
   void bump(Player* player);
 };
@@ -65,6 +70,7 @@ class Bullet : public GameObject
   int life_count;
   base_type base;
   base_type old_base;
+  SwapHandle handle;  // In the world's bullet list
 
   void init(float x, float y, float xm, Direction dir);
   void action(double frame_ratio);
@@ -73,7 +79,7 @@ class Bullet : public GameObject
   std::string type() { return "Bullet"; };
 
 private:
-  // Removes the bullet from the global bullet list, class does not exist afterward
+  // Marks the bullet for removal from the global bullet list at the end of World::action()
   void remove_me();
 };
 
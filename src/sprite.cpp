@@ -22,6 +22,8 @@
 #include "globals.h"
 #include "sprite.h"
 #include "setup.h"
+#include "resources.h"
+#include "anim_clock.h"
 
 /**
  * Constructs a Sprite object.
@@ -40,27 +42,36 @@ Sprite::Sprite(lisp_object_t* cur)
   reader.read_int("y-hotspot", &y_hotspot);
   reader.read_float("fps", &fps);
 
-  std::vector<std::string> images;
-  if (!reader.read_string_vector("images", &images))
+  if (!reader.read_string_vector("images", &images) || images.empty())
     st_abort("Sprite contains no images: ", name.c_str());
 
+  frame_delay = 1000.0f / fps;
+}
+
+/**
+ * Loads the frames of the sprite, which otherwise happens the first time
+ * it is drawn or measured.
+ */
+void Sprite::preload() const
+{
+  if (!surfaces.empty())
+    return;
+
+  // All frames go into shared atlas pages
+  TextureAtlas::begin();
   for (const auto& image : images)
   {
     surfaces.push_back(
-        new Surface(datadir + "/images/" + image, USE_ALPHA));
+        surface_manager->load_surface(datadir + "/images/" + image, USE_ALPHA));
   }
-
-  frame_delay = 1000.0f / fps;
+  TextureAtlas::end();
 }
 
 /**
- * Destroys the Sprite object.
- * Frees the memory allocated for the surfaces associated with the sprite.
+ * Destroys the Sprite object, the surfaces go back to the SurfaceManager.
  */
 Sprite::~Sprite()
 {
-  for (auto* surface : surfaces)
-    delete surface;
 }
 
 /**
@@ -72,7 +83,8 @@ void Sprite::init_defaults()
   x_hotspot = 0;
   y_hotspot = 0;
   fps = 10;
-  time = 0;
+  frame_stamp = 0;
+  current_frame = 0;
   frame_delay = 1000.0f / fps;
 }
 
@@ -95,7 +107,6 @@ void Sprite::update(float /*delta*/)
  */
 void Sprite::draw(float x, float y)
 {
-  time = SDL_GetTicks();
   unsigned int frame = get_current_frame();
 
   if (frame < surfaces.size())
@@ -114,7 +125,6 @@ void Sprite::draw(float x, float y)
  */
 void Sprite::draw_part(float sx, float sy, float x, float y, float w, float h)
 {
-  time = SDL_GetTicks();
   unsigned int frame = get_current_frame();
 
   if (frame < surfaces.size())
@@ -123,22 +133,29 @@ void Sprite::draw_part(float sx, float sy, float x, float y, float w, float h)
 
 /**
  * Resets the sprite's animation timer.
- * This function resets the internal time to 0, restarting the animation from the first frame.
+ * Sprites follow the shared AnimationClock, so this only drops the cached frame.
  */
 void Sprite::reset()
 {
-  time = 0;
+  frame_stamp = 0;
 }
 
 /**
- * Gets the current frame of the sprite based on the elapsed time.
- * Calculates the current frame to display based on the time and frame delay.
+ * Gets the current frame of the sprite based on the AnimationClock.
+ * The frame is only computed once per drawn frame, all badguys sharing
+ * this sprite get the cached value.
  * @return int The index of the current frame to display.
  */
 int Sprite::get_current_frame() const
 {
-  unsigned int frame = static_cast<int>(std::fmod(time, surfaces.size() * frame_delay) / frame_delay);
-  return frame % surfaces.size();
+  preload();
+
+  if (frame_stamp != AnimationClock::get_stamp())
+  {
+    current_frame = AnimationClock::get_sprite_frame(frame_delay, surfaces.size());
+    frame_stamp = AnimationClock::get_stamp();
+  }
+  return current_frame;
 }
 
 /**
@@ -24,6 +24,7 @@
 #include <vector>
 #include "lispreader.h"
 #include "texture.h"
+#include "surfaceref.h"
 
 // Represents a 2D sprite with animation
 class Sprite
@@ -33,9 +34,11 @@ class Sprite
   int x_hotspot;                 // X coordinate of the hotspot
   int y_hotspot;                 // Y coordinate of the hotspot
   float fps;                     // Frames per second for animation
-  float frame_delay;             // Frame duration in seconds
-  float time;                    // Time elapsed for current animation
-  std::vector<Surface*> surfaces; // Surfaces representing sprite frames
+  float frame_delay;             // Frame duration in milliseconds
+  mutable unsigned int frame_stamp; // AnimationClock stamp of current_frame
+  mutable int current_frame;     // Frame index cached for the current frame
+  std::vector<std::string> images; // Image files of the frames
+  mutable std::vector<SurfaceRef> surfaces; // Surfaces representing sprite frames, loaded on first use
 
   void init_defaults();          // Initialize default values for the sprite
 
@@ -43,6 +46,7 @@ class Sprite
   Sprite(lisp_object_t* cur);    // Constructs a Sprite from Lisp data
   ~Sprite();                     // Destructor
 
+  void preload() const;          // Loads the frames unless they are loaded already
   void reset();                  // Resets animation timer
   void update(float delta);      // Updates the animation
 
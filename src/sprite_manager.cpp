@@ -21,6 +21,54 @@
 #include <cstring>
 #include "lispreader.h"
 #include "sprite_manager.h"
+#include "globals.h"
+#include "setup.h"
+
+/**
+ * Checks that a resource file can be loaded without aborting: it parses,
+ * and each of its sprites has a name and images that exist.
+ * @param root_obj The parsed resource file.
+ * @return True if load_resfile() can take it.
+ */
+static bool is_valid_resfile(lisp_object_t* root_obj)
+{
+  if (!root_obj || root_obj->type == LISP_TYPE_EOF || root_obj->type == LISP_TYPE_PARSE_ERROR ||
+      !lisp_cons_p(root_obj) || !lisp_symbol_p(lisp_car(root_obj)) ||
+      std::strcmp(lisp_symbol(lisp_car(root_obj)), "supertux-resources") != 0)
+  {
+    return false;
+  }
+
+  for (lisp_object_t* cur = lisp_cdr(root_obj); cur; cur = lisp_cdr(cur))
+  {
+    lisp_object_t* el = lisp_car(cur);
+    if (!lisp_cons_p(el) || !lisp_symbol_p(lisp_car(el)))
+    {
+      return false;
+    }
+    if (std::strcmp(lisp_symbol(lisp_car(el)), "sprite") != 0)
+    {
+      continue;
+    }
+
+    LispReader reader(lisp_cdr(el));
+    std::string name;
+    std::vector<std::string> images;
+    if (!reader.read_string("name", &name) ||
+        !reader.read_string_vector("images", &images) || images.empty())
+    {
+      return false;
+    }
+    for (const std::string& image : images)
+    {
+      if (!faccessible((datadir + "/images/" + image).c_str()))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
 /**
  * Constructs a SpriteManager and loads sprites from a resource file.
@@ -95,6 +143,42 @@ void SpriteManager::load_resfile(const std::string& filename)
   lisp_free(root_obj);
 }
 
+/**
+ * Reads a resource file again after it was edited. The new definitions
+ * are copied into the existing sprites, so pointers to them stay valid.
+ * A file that doesn't parse or is incomplete leaves the sprites alone.
+ * @param filename The path to the resource file.
+ * @return False if the file couldn't be used.
+ */
+bool SpriteManager::reload(const std::string& filename)
+{
+  lisp_object_t* root_obj = lisp_read_from_file(filename);
+  bool valid = is_valid_resfile(root_obj);
+  lisp_free(root_obj);
+  if (!valid)
+  {
+    std::cerr << "SpriteManager: Couldn't read " << filename << ", keeping the old sprites" << std::endl;
+    return false;
+  }
+
+  SpriteManager fresh(filename);
+
+  for (auto& pair : fresh.sprites)
+  {
+    auto it = sprites.find(pair.first);
+    if (it != sprites.end())
+    {
+      *it->second = *pair.second;
+    }
+    else
+    {
+      sprites.insert(pair);
+      pair.second = nullptr; // Now owned by this manager
+    }
+  }
+  return true;
+}
+
 /**
  * Retrieves a Sprite by name.
  * @param name The name of the sprite to retrieve.
@@ -114,4 +198,17 @@ Sprite* SpriteManager::load(const std::string& name)
   }
 }
 
+/**
+ * Loads the frames of a group of sprites before they are used.
+ * @param prefix The start of the names of the sprites, e.g. "smalltux".
+ */
+void SpriteManager::preload(const std::string& prefix)
+{
+  for (auto it = sprites.lower_bound(prefix);
+       it != sprites.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    it->second->preload();
+  }
+}
+
 // EOF
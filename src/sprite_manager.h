@@ -37,8 +37,15 @@ class SpriteManager
 
   void load_resfile(const std::string& filename); // Loads sprite definitions from a resource file
 
+  // Reads a resource file again, sprites returned by load() stay valid and change in place.
+  // Returns false and keeps the sprites if the file can't be used.
+  bool reload(const std::string& filename);
+
   // Retrieves a Sprite by name, do not delete the returned object
   Sprite* load(const std::string& name);
+
+  // Loads the frames of all sprites whose name starts with prefix
+  void preload(const std::string& prefix);
 };
 
 #endif
@@ -0,0 +1,129 @@
+//  startup_trace.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <chrono>
+#include <vector>
+#include "startup_trace.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct Phase
+{
+  const char* name;
+  float ms;
+};
+
+// SDL isn't initialized during the first phases, so SDL_GetTicks()
+// can't be used here
+Clock::time_point start_time = Clock::now();
+Clock::time_point phase_start = start_time;
+Clock::time_point finish_time;
+const char* current = nullptr;
+bool finished = false;
+std::vector<Phase> phases;
+
+/**
+ * Closes the current phase, if any.
+ * @param now The time the phase ends.
+ */
+void close_phase(Clock::time_point now)
+{
+  if (current)
+  {
+    Phase phase;
+    phase.name = current;
+    phase.ms = std::chrono::duration<float, std::milli>(now - phase_start).count();
+    phases.push_back(phase);
+    current = nullptr;
+  }
+}
+
+} // namespace
+
+bool StartupTrace::enabled = false;
+
+/**
+ * Turns printing the report on or off.
+ * @param enable Whether finish() prints the phases.
+ */
+void StartupTrace::enable(bool enable)
+{
+  enabled = enable;
+}
+
+/**
+ * Closes the current phase and opens the next one.
+ * @param name The name of the new phase, has to stay valid.
+ */
+void StartupTrace::begin(const char* name)
+{
+  if (finished)
+  {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  close_phase(now);
+  current = name;
+  phase_start = now;
+}
+
+/**
+ * Closes the last phase and prints the report if the trace is enabled.
+ */
+void StartupTrace::finish()
+{
+  if (finished)
+  {
+    return;
+  }
+
+  finish_time = Clock::now();
+  close_phase(finish_time);
+  finished = true;
+
+  if (enabled)
+  {
+    print(stdout);
+  }
+}
+
+/**
+ * Prints the recorded phases and the time from the start of the program
+ * until finish().
+ * @param out The file to print to.
+ */
+void StartupTrace::print(FILE* out)
+{
+  fprintf(out, "Startup trace:\n");
+  for (const Phase& phase : phases)
+  {
+    fprintf(out, "  %-24s %8.2f ms\n", phase.name, phase.ms);
+  }
+
+  Clock::time_point end = finished ? finish_time : Clock::now();
+  fprintf(out, "  %-24s %8.2f ms\n", "total",
+          std::chrono::duration<float, std::milli>(end - start_time).count());
+}
+
+// EOF
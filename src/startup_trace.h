@@ -0,0 +1,53 @@
+//  startup_trace.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_STARTUP_TRACE_H
+#define SUPERTUX_STARTUP_TRACE_H
+
+#include <stdio.h>
+
+/** Measures how long the phases of the startup take, from main() until
+    the title screen. A phase lasts from its begin() until the next one
+    or finish(). The phases are always recorded, they are only printed
+    when the trace is enabled. */
+class StartupTrace
+{
+public:
+  static void enable(bool enable);
+  static bool is_enabled() { return enabled; }
+
+  /** Close the current phase and open the next one, name has to stay
+      valid (a literal) */
+  static void begin(const char* name);
+
+  /** Close the last phase and print the report, only the first call
+      does anything */
+  static void finish();
+
+  /** Print the phases recorded so far */
+  static void print(FILE* out);
+
+private:
+  static bool enabled;
+};
+
+#endif /*SUPERTUX_STARTUP_TRACE_H*/
+
+// EOF
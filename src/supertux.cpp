@@ -32,6 +32,12 @@
 #include "resources.h"
 #include "texture.h"
 #include "tile.h"
+#include "benchmark.h"
+#include "replay.h"
+#include "collision_bench.h"
+#include "image_loader.h"
+#include "startup_trace.h"
+#include "asset_archive.h"
 #ifdef _WII_
     #include <wiiuse/wpad.h>
     #include <ogc/lwp_watchdog.h>
@@ -55,6 +61,7 @@ Surface* loading_surf = NULL;
  */
 int main(int argc, char ** argv)
 {
+  int exit_code = 0;
 
 #ifdef _WII_
   //IO::SD OurSD;
@@ -64,6 +71,7 @@ int main(int argc, char ** argv)
   //OurUSB.Mount();
 
   // Wii-specific setup for FAT library and USB disk handling.
+  StartupTrace::begin("fat");
   sleep(1);  // Delay to allow USB disks behind hubs to initialize.
   bool res = fatInitDefault();
   if (res == 0)
@@ -74,33 +82,72 @@ int main(int argc, char ** argv)
 #endif
 
   // Setup directory paths and load configuration
+  StartupTrace::begin("directories");
   st_directory_setup();
+  StartupTrace::begin("config");
   load_config_file();  // Load configuration file
 
 #ifndef _WII_
   parseargs(argc, argv);  // Parse command-line arguments
+
+  if (AssetArchive::is_pack_requested())
+  {
+    return AssetArchive::run_pack(datadir);
+  }
 #endif
 
+  // Read the game data out of the asset archive if there is one
+  StartupTrace::begin("archive");
+  AssetArchive::open(datadir);
+
   // Setup audio and video
+  StartupTrace::begin("audio");
   st_audio_setup();
+  StartupTrace::begin("video");
   st_video_setup();
   SDL_ShowCursor(false);  // Hide SDL cursor (SuperTux has it's own cursor)
 
   // Initialize and show the loading screen
+  StartupTrace::begin("loading screen");
   clearscreen(0, 0, 0);
   loading_surf = new Surface(datadir + "/images/title/loading.png", USE_ALPHA);
   loading_surf->draw(160, 30);
   updatescreen();  // Refresh screen to show the loading screen
 
   // Initialize input systems, game settings, and menus
+  StartupTrace::begin("joystick");
   st_joystick_setup();
+  StartupTrace::begin("general setup");
   st_general_setup();
+  StartupTrace::begin("menus");
   st_menu();
+  StartupTrace::begin("shared resources");
   loadshared();  // Load shared game resources (graphics, sounds, etc.)
+  ImageLoader::flush();  // Free whatever was decoded but not used
 
   // Check if a level startup file is specified (start a game session), otherwise show the title screen
-  if (level_startup_file)
+  StartupTrace::begin("title screen");
+  if (Benchmark::is_requested())
+  {
+    StartupTrace::finish();
+    Benchmark::run();
+  }
+  else if (CollisionBench::is_requested())
+  {
+    StartupTrace::finish();
+    if (!CollisionBench::run())
+    {
+      exit_code = 1;
+    }
+  }
+  else if (Replay::is_requested())
+  {
+    StartupTrace::finish();
+    Replay::run();
+  }
+  else if (level_startup_file)
   {
+    StartupTrace::finish();
     GameSession session(level_startup_file, 1, ST_GL_LOAD_LEVEL_FILE);
     session.run();  // Run the specified game session
   }
@@ -124,7 +171,7 @@ int main(int argc, char ** argv)
   // Perform system shutdown and cleanup
   st_shutdown();
 
-  return 0;
+  return exit_code;
 }
 
 // EOF
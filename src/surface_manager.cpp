@@ -0,0 +1,208 @@
+//  surface_manager.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include "surface_manager.h"
+#include "surfaceref.h"
+#include "texture.h"
+
+/**
+ * Constructs a SurfaceManager with the default budget.
+ */
+SurfaceManager::SurfaceManager()
+  : budget(DEFAULT_BUDGET), unused_bytes(0), clock(0)
+{
+}
+
+/**
+ * Destructor for SurfaceManager. Images that are still referenced are
+ * left to their last SurfaceRef.
+ */
+SurfaceManager::~SurfaceManager()
+{
+  for (auto& pair : resources)
+  {
+    SurfaceResource* resource = pair.second;
+    if (resource->refcount == 0)
+    {
+      delete resource->surface;
+      delete resource;
+    }
+    else
+    {
+      resource->manager = nullptr;
+    }
+  }
+}
+
+/**
+ * Builds the cache key of an image, the same file loaded with and
+ * without alpha gives two different surfaces.
+ * @param file The image file.
+ * @param use_alpha Whether the alpha channel is used.
+ * @return The key.
+ */
+std::string SurfaceManager::make_key(const std::string& file, int use_alpha)
+{
+  return (use_alpha == USE_ALPHA ? "a:" : "o:") + file;
+}
+
+/**
+ * Gets the image of a file.
+ * @param file The image file.
+ * @param use_alpha Whether the alpha channel is used.
+ * @return A reference to the cached image.
+ */
+SurfaceRef SurfaceManager::load_surface(const std::string& file, int use_alpha)
+{
+  std::string key = make_key(file, use_alpha);
+  Resources::iterator i = resources.find(key);
+  if (i != resources.end())
+  {
+    return SurfaceRef(i->second);
+  }
+
+  return SurfaceRef(insert(key, new Surface(file, use_alpha)));
+}
+
+/**
+ * Gets the image of a file without loading it.
+ * @param file The image file.
+ * @param use_alpha Whether the alpha channel is used.
+ * @return A reference to the cached image, or an empty one.
+ */
+SurfaceRef SurfaceManager::find_surface(const std::string& file, int use_alpha)
+{
+  Resources::iterator i = resources.find(make_key(file, use_alpha));
+  if (i != resources.end())
+  {
+    return SurfaceRef(i->second);
+  }
+  return SurfaceRef();
+}
+
+/**
+ * Puts an already decoded image into the cache, if the file isn't
+ * cached yet.
+ * @param file The image file surf was decoded from.
+ * @param surf The decoded image, freed by this call.
+ * @param use_alpha Whether the alpha channel is used.
+ * @return A reference to the cached image.
+ */
+SurfaceRef SurfaceManager::add_surface(const std::string& file, SDL_Surface* surf, int use_alpha)
+{
+  std::string key = make_key(file, use_alpha);
+  Resources::iterator i = resources.find(key);
+  if (i != resources.end())
+  {
+    SDL_FreeSurface(surf);
+    return SurfaceRef(i->second);
+  }
+
+  Surface* surface = new Surface(surf, use_alpha);
+  SDL_FreeSurface(surf);
+  return SurfaceRef(insert(key, surface));
+}
+
+/**
+ * Adds a new image to the cache. It counts as unreferenced until the
+ * caller wraps it into a SurfaceRef.
+ * @param key The cache key.
+ * @param surface The image.
+ * @return The new resource.
+ */
+SurfaceManager::SurfaceResource* SurfaceManager::insert(const std::string& key, Surface* surface)
+{
+  SurfaceResource* resource = new SurfaceResource;
+  resource->manager = this;
+  resource->surface = surface;
+  resource->key = key;
+  resource->bytes = size_t(surface->w) * surface->h * 4;
+  resource->refcount = 0;
+  resource->last_used = ++clock;
+
+  resources[key] = resource;
+  unused_bytes += resource->bytes;
+  return resource;
+}
+
+/**
+ * Called when the last reference to an image is gone.
+ * @param resource The image that is no longer used.
+ */
+void SurfaceManager::release(SurfaceResource* resource)
+{
+  resource->last_used = ++clock;
+  unused_bytes += resource->bytes;
+  evict();
+}
+
+/**
+ * Frees the least recently used unreferenced images until they fit into
+ * the budget.
+ */
+void SurfaceManager::evict()
+{
+  while (unused_bytes > budget)
+  {
+    Resources::iterator oldest = resources.end();
+    for (Resources::iterator i = resources.begin(); i != resources.end(); ++i)
+    {
+      if (i->second->refcount == 0 &&
+          (oldest == resources.end() || i->second->last_used < oldest->second->last_used))
+      {
+        oldest = i;
+      }
+    }
+    if (oldest == resources.end())
+    {
+      break;
+    }
+
+    SurfaceResource* resource = oldest->second;
+    unused_bytes -= resource->bytes;
+    delete resource->surface;
+    delete resource;
+    resources.erase(oldest);
+  }
+}
+
+/**
+ * Sets the budget for unreferenced images.
+ * @param bytes The new budget in bytes.
+ */
+void SurfaceManager::set_budget(size_t bytes)
+{
+  budget = bytes;
+  evict();
+}
+
+/**
+ * Frees all images nobody refers to.
+ */
+void SurfaceManager::flush()
+{
+  size_t saved = budget;
+  set_budget(0);
+  budget = saved;
+}
+
+// EOF
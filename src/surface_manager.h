@@ -0,0 +1,91 @@
+//  surface_manager.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_SURFACE_MANAGER_H
+#define SUPERTUX_SURFACE_MANAGER_H
+
+#include <SDL.h>
+#include <string>
+#include <map>
+
+class Surface;
+class SurfaceRef;
+
+/** Shares images loaded from files, so that the same file is only decoded
+    once no matter how many levels, tiles or sprites use it.
+
+    Images stay cached when their last SurfaceRef goes away, until the
+    unreferenced images exceed the budget. Then the least recently used
+    are freed first. */
+class SurfaceManager
+{
+public:
+  /** Default budget for images nobody refers to, in bytes */
+  static const size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+
+  SurfaceManager();
+  ~SurfaceManager();
+
+  /** Get the image of a file, loading it if it isn't cached */
+  SurfaceRef load_surface(const std::string& file, int use_alpha);
+
+  /** Get the image of a file if it is cached, an empty reference if not */
+  SurfaceRef find_surface(const std::string& file, int use_alpha);
+
+  /** Put an image that was already decoded, e.g. on another thread, into
+      the cache. Takes ownership of surf. */
+  SurfaceRef add_surface(const std::string& file, SDL_Surface* surf, int use_alpha);
+
+  /** Set the budget for unreferenced images and evict down to it */
+  void set_budget(size_t bytes);
+
+  /** Free all images nobody refers to */
+  void flush();
+
+private:
+  friend class SurfaceRef;
+
+  class SurfaceResource
+  {
+  public:
+    SurfaceManager* manager;  // nullptr once the manager is gone
+    Surface* surface;
+    std::string key;
+    size_t bytes;             // estimated memory use
+    int refcount;
+    unsigned int last_used;
+  };
+
+  void release(SurfaceResource* resource);
+  void evict();
+  SurfaceResource* insert(const std::string& key, Surface* surface);
+  static std::string make_key(const std::string& file, int use_alpha);
+
+  typedef std::map<std::string, SurfaceResource*> Resources;
+  Resources resources;
+  size_t budget;
+  size_t unused_bytes;      // bytes of the images with a refcount of 0
+  unsigned int clock;
+};
+
+#endif /*SUPERTUX_SURFACE_MANAGER_H*/
+
+// EOF
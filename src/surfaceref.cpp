@@ -0,0 +1,109 @@
+//  surfaceref.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include "surfaceref.h"
+#include "texture.h"
+
+/**
+ * Constructs an empty reference.
+ */
+SurfaceRef::SurfaceRef()
+  : resource(nullptr)
+{
+}
+
+/**
+ * Constructs a reference to a cached image, used by the SurfaceManager.
+ * @param newresource The cached image.
+ */
+SurfaceRef::SurfaceRef(SurfaceManager::SurfaceResource* newresource)
+  : resource(newresource)
+{
+  if (resource && resource->refcount++ == 0 && resource->manager)
+  {
+    resource->manager->unused_bytes -= resource->bytes;
+  }
+}
+
+/**
+ * Copies a reference.
+ * @param other The reference to copy.
+ */
+SurfaceRef::SurfaceRef(const SurfaceRef& other)
+  : resource(other.resource)
+{
+  if (resource)
+  {
+    resource->refcount++;
+  }
+}
+
+/**
+ * Destructor for SurfaceRef, hands the image back to the manager when
+ * this was its last reference.
+ */
+SurfaceRef::~SurfaceRef()
+{
+  SurfaceRef empty;
+  *this = empty;
+}
+
+/**
+ * Assigns another reference.
+ * @param other The reference to copy.
+ * @return This reference.
+ */
+SurfaceRef& SurfaceRef::operator=(const SurfaceRef& other)
+{
+  SurfaceManager::SurfaceResource* oldresource = resource;
+  resource = other.resource;
+  if (resource)
+  {
+    resource->refcount++;
+  }
+
+  if (oldresource && --oldresource->refcount == 0)
+  {
+    if (oldresource->manager)
+    {
+      oldresource->manager->release(oldresource);
+    }
+    else
+    {
+      // The manager was destroyed already
+      delete oldresource->surface;
+      delete oldresource;
+    }
+  }
+
+  return *this;
+}
+
+/**
+ * Gets the referenced image.
+ * @return The image, or nullptr for an empty reference.
+ */
+Surface* SurfaceRef::get() const
+{
+  return resource ? resource->surface : nullptr;
+}
+
+// EOF
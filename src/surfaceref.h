@@ -0,0 +1,51 @@
+//  surfaceref.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_SURFACEREF_H
+#define SUPERTUX_SURFACEREF_H
+
+#include "surface_manager.h"
+
+/** Reference to an image shared through the SurfaceManager, used like a
+    Surface pointer */
+class SurfaceRef
+{
+public:
+  SurfaceRef();
+  SurfaceRef(const SurfaceRef& other);
+  ~SurfaceRef();
+
+  SurfaceRef& operator=(const SurfaceRef& other);
+
+  Surface* get() const;
+  Surface* operator->() const { return get(); }
+  explicit operator bool() const { return resource != nullptr; }
+
+private:
+  friend class SurfaceManager;
+  SurfaceRef(SurfaceManager::SurfaceResource* resource);
+
+  SurfaceManager::SurfaceResource* resource;
+};
+
+#endif /*SUPERTUX_SURFACEREF_H*/
+
+// EOF
@@ -20,24 +20,79 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
 #include "globals.h"
 #include "defines.h"
 #include "screen.h"
 #include "text.h"
+#include "profiler.h"
+#include "anim_clock.h"
+#include "asset_archive.h"
 
 #define MAX_TEXT_LEN 1024  // Define a maximum length for safety
 #define MAX_VEL     10      // Maximum velocity for scrolling text
 #define SPEED_INC   0.01    // Speed increment for scrolling
 #define SCROLL      60      // Fixed scroll amount when space/enter is pressed
 #define ITEMS_SPACE 4       // Space between lines of text
+#define MAX_CACHED_LEN 256  // Longer strings are always drawn glyph by glyph
 
 /**
  * Constructor for the Text class.
  * Initializes the font surface and applies a shadow effect.
  */
 Text::Text(const std::string& file, int kind_, int w_, int h_)
-  : kind(kind_), w(w_), h(h_)
+  : kind(kind_), w(w_), h(h_), cache_clock(0)
 {
+  // Work out where each character sits on the charset once.
+  // Do not replace the if-else statements with switch-case here, range-based
+  // case statements are mishandled by some compilers, such as GCC 14.
+  for (int c = 0; c < 128; ++c)
+  {
+    int column, row;
+    if (c >= ' ' && c <= '/')       // symbols (e.g., '!', '"', '#')
+    {
+      column = c - ' ';
+      row = 0;
+    }
+    else if (c >= '0' && c <= '?')  // numbers (0-9) and symbols
+    {
+      column = c - '0';
+      row = 1;
+    }
+    else if (c >= '@' && c <= 'O')  // uppercase letters A-O
+    {
+      column = c - '@';
+      row = 2;
+    }
+    else if (c >= 'P' && c <= '_')  // uppercase letters P-Z
+    {
+      column = c - 'P';
+      row = 3;
+    }
+    else if (c >= '`' && c <= 'o')  // lowercase letters a-o
+    {
+      column = c - '`';
+      row = 4;
+    }
+    else if (c >= 'p' && c <= '~')  // lowercase letters p-z
+    {
+      column = c - 'p';
+      row = 5;
+    }
+    else
+    {
+      glyph_x[c] = glyph_y[c] = -1;
+      continue;
+    }
+    glyph_x[c] = column * w;
+    glyph_y[c] = row * h;
+  }
+
+  // Both charsets go into shared atlas pages
+  TextureAtlas::begin();
+
   // Load the main font surface
   chars = new Surface(file, USE_ALPHA);
 
@@ -56,6 +111,7 @@ Text::Text(const std::string& file, int kind_, int w_, int h_)
   SDL_UnlockSurface(conv);
   SDL_SetAlpha(conv, SDL_SRCALPHA, 128);  // Set the alpha transparency level
   shadow_chars = new Surface(conv, USE_ALPHA);
+  TextureAtlas::end();
 
   // Clean up the temporary surface
   SDL_FreeSurface(conv);
@@ -68,6 +124,8 @@ Text::Text(const std::string& file, int kind_, int w_, int h_)
 Text::~Text()
 {
   // Free allocated memory
+  for (TextCache::iterator i = cache.begin(); i != cache.end(); ++i)
+    delete i->second.surface;
   delete chars;
   delete shadow_chars;
 }
@@ -83,8 +141,21 @@ Text::~Text()
  */
 void Text::draw(const char* text, int x, int y, int shadowsize, int update)
 {
+  PROFILE_SCOPE("Text::draw");
+
   if (text != nullptr)
   {
+    // Text that was drawn before comes from the cache in one piece
+    if (update == NO_UPDATE)
+    {
+      Surface* cached = find_cached(text, shadowsize);
+      if (cached)
+      {
+        cached->draw(x, y);
+        return;
+      }
+    }
+
     // Draw the shadow if needed
     if (shadowsize != 0)
       draw_chars(shadow_chars, text, x + shadowsize, y + shadowsize, update);
@@ -98,20 +169,15 @@ void Text::draw(const char* text, int x, int y, int shadowsize, int update)
  * Draw characters on a surface based on their ASCII values.
  *
  * This function takes a string of text and renders each character onto the provided surface.
- * It handles multiple types of characters, including symbols, numbers, uppercase and lowercase
- * letters. It also correctly handles newlines, ensuring that text is drawn across multiple lines
- * if necessary.
+ * The position of each character on the charset comes from the table built in the
+ * constructor. It also correctly handles newlines, ensuring that text is drawn across
+ * multiple lines if necessary.
  *
  * @param pchars Surface to draw the characters on.
  * @param text The string of text to be drawn.
  * @param x The starting x-coordinate on the surface.
  * @param y The starting y-coordinate on the surface.
  * @param update Whether the screen should be updated after drawing (0 = no update, 1 = update).
- *
- * @note Do not replace the if-else statements with switch-case here.
- * Range-based case statements can lead to unexpected behavior on some compilers,
- * such as GCC 14, which may mishandle these cases. Stick with if-else for reliability
- * and cross-platform compatibility.
  */
 void Text::draw_chars(Surface* pchars, const char* text, int x, int y, int update)
 {
@@ -121,56 +187,243 @@ void Text::draw_chars(Surface* pchars, const char* text, int x, int y, int updat
   // Loop through each character in the string
   for (int i = 0, j = 0; i < len; ++i, ++j)
   {
-    int offset_x = 0;  // Horizontal offset on the source surface (spritesheet)
-    int offset_y = 0;  // Vertical offset on the source surface (spritesheet)
+    unsigned char c = text[i];
 
-    // Determine the position of the character on the spritesheet based on its ASCII value
-    if (text[i] >= ' ' && text[i] <= '/')  // ASCII range for symbols (e.g., '!', '"', '#')
-    {
-      offset_x = (text[i] - ' ') * w;
-      offset_y = 0;
-    }
-    else if (text[i] >= '0' && text[i] <= '?')  // ASCII range for numbers (0-9) and symbols
-    {
-      offset_x = (text[i] - '0') * w;
-      offset_y = h * 1;
-    }
-    else if (text[i] >= '@' && text[i] <= 'O')  // ASCII range for uppercase letters A-O
-    {
-      offset_x = (text[i] - '@') * w;
-      offset_y = h * 2;
-    }
-    else if (text[i] >= 'P' && text[i] <= '_')  // ASCII range for uppercase letters P-Z
-    {
-      offset_x = (text[i] - 'P') * w;
-      offset_y = h * 3;
-    }
-    else if (text[i] >= '`' && text[i] <= 'o')  // ASCII range for lowercase letters a-o
-    {
-      offset_x = (text[i] - '`') * w;
-      offset_y = h * 4;
-    }
-    else if (text[i] >= 'p' && text[i] <= '~')  // ASCII range for lowercase letters p-z
-    {
-      offset_x = (text[i] - 'p') * w;
-      offset_y = h * 5;
-    }
-    else if (text[i] == '\n')  // Handle new line character
+    if (c == '\n')  // Handle new line character
     {
       y += h + 2;  // Move down to the next line
       j = 0;  // Reset column position for the next line
       continue;  // Skip to the next character without drawing
     }
-    else
+
+    if (c >= 128 || glyph_x[c] < 0)
     {
       continue;  // Ignore unsupported characters
     }
 
     // Draw the character from the appropriate position on the spritesheet
-    pchars->draw_part(offset_x, offset_y, x + (j * w), y, w, h, 255, update);
+    pchars->draw_part(glyph_x[c], glyph_y[c], x + (j * w), y, w, h, 255, update);
   }
 }
 
+/**
+ * Looks up the pre-rendered surface of a string, rendering it if the
+ * string was already drawn in an earlier frame.
+ * @param text The string.
+ * @param shadowsize Size of the shadow effect.
+ * @return The surface, or nullptr if the string is to be drawn glyph by glyph.
+ */
+Surface* Text::find_cached(const char* text, int shadowsize)
+{
+  if (shadowsize < 0 || text[0] == '\0' || strnlen(text, MAX_CACHED_LEN + 1) > MAX_CACHED_LEN)
+    return nullptr;
+
+  unsigned int stamp = AnimationClock::get_stamp();
+  std::pair<std::string, int> key(text, shadowsize);
+  TextCache::iterator i = cache.find(key);
+
+  if (i == cache.end())
+  {
+    if (cache.size() >= MAX_CACHED_TEXTS)
+      forget_oldest();
+
+    CachedText entry;
+    entry.surface = nullptr;
+    entry.first_stamp = stamp;
+    entry.last_used = ++cache_clock;
+    cache.insert(std::make_pair(key, entry));
+    return nullptr;
+  }
+
+  CachedText& entry = i->second;
+  entry.last_used = ++cache_clock;
+  if (entry.surface == nullptr && entry.first_stamp != stamp)
+    entry.surface = render(text, shadowsize);
+
+  return entry.surface;
+}
+
+/**
+ * Drops the least recently drawn string from the cache.
+ */
+void Text::forget_oldest()
+{
+  TextCache::iterator oldest = cache.begin();
+  for (TextCache::iterator i = cache.begin(); i != cache.end(); ++i)
+  {
+    if (i->second.last_used < oldest->second.last_used)
+      oldest = i;
+  }
+  if (oldest != cache.end())
+  {
+    delete oldest->second.surface;
+    cache.erase(oldest);
+  }
+}
+
+namespace
+{
+
+/**
+ * Puts one glyph of a charset over the pixels of a 32 bit RGBA surface.
+ * @param src The charset.
+ * @param sx Left edge of the glyph in the charset.
+ * @param sy Top edge of the glyph in the charset.
+ * @param dest The surface to draw on, locked.
+ * @param dx Left edge on dest.
+ * @param dy Top edge on dest.
+ * @param w Width of the glyph.
+ * @param h Height of the glyph.
+ */
+void blend_glyph(SDL_Surface* src, int sx, int sy, SDL_Surface* dest, int dx, int dy, int w, int h)
+{
+  int bpp = src->format->BytesPerPixel;
+  for (int y = 0; y < h; ++y)
+  {
+    if (sy + y >= src->h || dy + y >= dest->h)
+      break;
+    if (dy + y < 0)
+      continue;
+
+    const Uint8* srow = static_cast<const Uint8*>(src->pixels) + (sy + y) * src->pitch;
+    Uint32* drow = reinterpret_cast<Uint32*>(static_cast<Uint8*>(dest->pixels) + (dy + y) * dest->pitch);
+
+    for (int x = 0; x < w; ++x)
+    {
+      if (sx + x >= src->w || dx + x >= dest->w)
+        break;
+      if (dx + x < 0)
+        continue;
+
+      Uint32 pixel = 0;
+      memcpy(&pixel, srow + (sx + x) * bpp, bpp);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+      pixel >>= (4 - bpp) * 8;
+#endif
+
+      Uint8 sr, sg, sb, sa;
+      SDL_GetRGBA(pixel, src->format, &sr, &sg, &sb, &sa);
+      if (sa == 0)
+        continue;
+
+      Uint8 dr, dg, db, da;
+      SDL_GetRGBA(drow[dx + x], dest->format, &dr, &dg, &db, &da);
+
+      // Straight alpha "over"
+      int out_a = sa + da * (255 - sa) / 255;
+      int rest = da * (255 - sa) / 255;
+      Uint8 r = (sr * sa + dr * rest) / out_a;
+      Uint8 g = (sg * sa + dg * rest) / out_a;
+      Uint8 b = (sb * sa + db * rest) / out_a;
+      drow[dx + x] = SDL_MapRGBA(dest->format, r, g, b, out_a);
+    }
+  }
+}
+
+/**
+ * Creates a cleared 32 bit RGBA surface.
+ * @param width Width of the surface.
+ * @param height Height of the surface.
+ * @return The surface, nullptr if there is no memory left.
+ */
+SDL_Surface* create_rgba_surface(int width, int height)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  SDL_Surface* surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+                                              0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+  SDL_Surface* surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+                                              0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+  if (surface)
+    SDL_FillRect(surface, NULL, 0);
+  return surface;
+}
+
+} // namespace
+
+/**
+ * Draws text onto a 32 bit RGBA surface instead of the screen, blending
+ * it over what the surface already holds.
+ * @param dest The surface, e.g. from create_rgba_surface().
+ * @param text The text string to be drawn.
+ * @param x X-coordinate on dest.
+ * @param y Y-coordinate on dest.
+ * @param shadowsize Size of the shadow effect.
+ */
+void Text::draw_to_surface(SDL_Surface* dest, const char* text, int x, int y, int shadowsize)
+{
+  int len = strnlen(text, MAX_TEXT_LEN);
+  SDL_Surface* layers[2] = { shadow_chars->impl->get_sdl_surface(), chars->impl->get_sdl_surface() };
+  int offsets[2] = { shadowsize, 0 };
+
+  SDL_LockSurface(dest);
+  for (int layer = (shadowsize != 0) ? 0 : 1; layer < 2; ++layer)
+  {
+    SDL_Surface* src = layers[layer];
+    SDL_LockSurface(src);
+
+    int line_y = y + offsets[layer];
+    for (int i = 0, j = 0; i < len; ++i, ++j)
+    {
+      unsigned char c = text[i];
+      if (c == '\n')
+      {
+        line_y += h + 2;
+        j = 0;
+        continue;
+      }
+      if (c >= 128 || glyph_x[c] < 0)
+        continue;
+
+      blend_glyph(src, glyph_x[c], glyph_y[c], dest, x + offsets[layer] + j * w, line_y, w, h);
+    }
+
+    SDL_UnlockSurface(src);
+  }
+  SDL_UnlockSurface(dest);
+}
+
+/**
+ * Renders a string, shadow included, into a surface of its own.
+ * @param text The string.
+ * @param shadowsize Size of the shadow effect.
+ * @return The new surface.
+ */
+Surface* Text::render(const char* text, int shadowsize)
+{
+  int len = strnlen(text, MAX_TEXT_LEN);
+  int columns = 0;
+  int lines = 1;
+  // Same layout as draw_chars()
+  for (int i = 0, j = 0; i < len; ++i, ++j)
+  {
+    if (text[i] == '\n')
+    {
+      ++lines;
+      j = 0;
+      continue;
+    }
+    if (j + 1 > columns)
+      columns = j + 1;
+  }
+
+  int width = columns * w + shadowsize;
+  int height = lines * (h + 2) - 2 + shadowsize;
+  if (width <= 0)
+    width = 1;
+
+  SDL_Surface* temp = create_rgba_surface(width, height);
+  if (temp == nullptr)
+    return nullptr;
+
+  draw_to_surface(temp, text, 0, 0, shadowsize);
+
+  Surface* surface = new Surface(temp, USE_ALPHA);
+  SDL_FreeSurface(temp);
+  return surface;
+}
+
 /**
  * Draw aligned text on the screen.
  *
@@ -303,6 +556,136 @@ void Text::erasecenteredtext(const char* text, int y, Surface* ptexture, int upd
   erasetext(text, screen->w / 2 - (text_len * 8), y, ptexture, update, shadowsize);
 }
 
+namespace
+{
+
+/** A text document laid out once and drawn from pre-rendered strips of
+    STRIP_HEIGHT pixels. Only the strips on screen are kept, a strip is
+    rendered when it scrolls into view and freed when it leaves. */
+class TextPages
+{
+public:
+  static const int STRIP_HEIGHT = 128;
+
+  explicit TextPages(const std::vector<std::string>& names)
+    : height(0)
+  {
+    for (const std::string& name : names)
+    {
+      Line line;
+      line.shadowsize = 1;
+      switch (name.empty() ? '\0' : name[0])
+      {
+        case ' ':
+          line.font = white_small_text;
+          line.text = name.substr(1);
+          break;
+        case '\t':
+          line.font = white_text;
+          line.text = name.substr(1);
+          break;
+        case '-':
+          line.font = white_big_text;
+          line.text = name.substr(1);
+          line.shadowsize = 3;
+          break;
+        default:
+          line.font = blue_text;
+          line.text = name;
+          break;
+      }
+      line.y = height;
+      lines.push_back(line);
+      height += line.font->h + ITEMS_SPACE;
+    }
+  }
+
+  ~TextPages()
+  {
+    for (std::map<int, Surface*>::iterator i = strips.begin(); i != strips.end(); ++i)
+      delete i->second;
+  }
+
+  /** Height of the whole document in pixels */
+  int get_height() const { return height; }
+
+  /** Draw the document with its top at screen line top */
+  void draw(int top)
+  {
+    int first = floor_div(-top, STRIP_HEIGHT);
+    int last = floor_div(screen->h - 1 - top, STRIP_HEIGHT);
+
+    // Strips that scrolled out of view
+    for (std::map<int, Surface*>::iterator i = strips.begin(); i != strips.end(); )
+    {
+      if (i->first < first || i->first > last)
+      {
+        delete i->second;
+        strips.erase(i++);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    for (int index = std::max(first, 0); index <= last && index * STRIP_HEIGHT < height; ++index)
+    {
+      Surface*& strip = strips[index];
+      if (strip == nullptr)
+        strip = render_strip(index);
+      if (strip)
+        strip->draw(0, top + index * STRIP_HEIGHT);
+    }
+  }
+
+private:
+  struct Line
+  {
+    Text* font;
+    std::string text;
+    int shadowsize;
+    int y;
+  };
+
+  std::vector<Line> lines;
+  int height;
+  std::map<int, Surface*> strips;
+
+  static int floor_div(int a, int b)
+  {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+  }
+
+  Surface* render_strip(int index)
+  {
+    SDL_Surface* temp = create_rgba_surface(screen->w, STRIP_HEIGHT);
+    if (temp == nullptr)
+      return nullptr;
+
+    int strip_top = index * STRIP_HEIGHT;
+    for (const Line& line : lines)
+    {
+      // Shadows reach below the line itself
+      if (line.y >= strip_top + STRIP_HEIGHT || line.y + line.font->h + line.shadowsize <= strip_top)
+        continue;
+
+      // Centered like Text::drawf() does it
+      int x = screen->w / 2 - (strnlen(line.text.c_str(), MAX_TEXT_LEN) * line.font->w) / 2;
+      line.font->draw_to_surface(temp, line.text.c_str(), x, line.y - strip_top, line.shadowsize);
+    }
+
+    Surface* strip = new Surface(temp, USE_ALPHA);
+    SDL_FreeSurface(temp);
+    return strip;
+  }
+
+  TextPages(const TextPages&);
+  TextPages& operator=(const TextPages&);
+};
+
+} // namespace
+
 /**
  * Display a text file on the screen using a surface file.
  *
@@ -334,7 +717,6 @@ void display_text_file(const std::string& file, Surface* surface, float scroll_s
   float scroll = 0;
   float speed = scroll_speed / 50;
   int y;
-  int length;
   FILE* fi;
   char temp[1024];
   std::vector<std::string> names;  // Replaced string_list_type with std::vector<std::string>
@@ -343,7 +725,22 @@ void display_text_file(const std::string& file, Surface* surface, float scroll_s
   snprintf(filename, sizeof(filename), "%s/%s", datadir.c_str(), file.c_str());
 
   // Read file line by line
-  if ((fi = fopen(filename, "r")) != nullptr)
+  std::string data;
+  if (AssetArchive::read(filename, &data))
+  {
+    size_t start = 0;
+    while (start < data.size())
+    {
+      size_t end = data.find('\n', start);
+      if (end == std::string::npos)
+      {
+        end = data.size();
+      }
+      names.emplace_back(data.substr(start, end - start));
+      start = end + 1;
+    }
+  }
+  else if ((fi = fopen(filename, "r")) != nullptr)
   {
     while (fgets(temp, sizeof(temp), fi) != nullptr)
     {
@@ -362,7 +759,9 @@ void display_text_file(const std::string& file, Surface* surface, float scroll_s
     names.emplace_back("in your SuperTux distribution.");
   }
 
-  length = names.size();
+  // Everything is laid out once, scrolling only blits the visible strips
+  TextPages pages(names);
+  y = pages.get_height();
   SDL_EnableKeyRepeat(SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
 
   Uint32 lastticks = SDL_GetTicks();  // Declare ticks here, once per frame
@@ -412,33 +811,7 @@ void display_text_file(const std::string& file, Surface* surface, float scroll_s
     // Draw the background and the scrolling text
     surface->draw_bg();
 
-    y = 0;
-    for (int i = 0; i < length; ++i)
-    {
-      switch (names[i][0])  // Access vector elements using 'names[i]'
-      {
-        case ' ':
-          white_small_text->drawf(names[i].c_str() + 1, 0, screen->h + y - int(scroll),
-                                  A_HMIDDLE, A_TOP, 1);
-          y += white_small_text->h + ITEMS_SPACE;
-          break;
-        case '\t':
-          white_text->drawf(names[i].c_str() + 1, 0, screen->h + y - int(scroll),
-                            A_HMIDDLE, A_TOP, 1);
-          y += white_text->h + ITEMS_SPACE;
-          break;
-        case '-':
-          white_big_text->drawf(names[i].c_str() + 1, 0, screen->h + y - int(scroll),
-                                A_HMIDDLE, A_TOP, 3);
-          y += white_big_text->h + ITEMS_SPACE;
-          break;
-        default:
-          blue_text->drawf(names[i].c_str(), 0, screen->h + y - int(scroll),
-                           A_HMIDDLE, A_TOP, 1);
-          y += blue_text->h + ITEMS_SPACE;
-          break;
-      }
-    }
+    pages.draw(screen->h - int(scroll));
 
     flipscreen();
 
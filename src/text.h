@@ -22,6 +22,8 @@
 #define SUPERTUX_TEXT_H
 
 #include <string>
+#include <map>
+#include <utility>
 #include "texture.h"
 
 void display_text_file(const std::string& file, const std::string& surface, float scroll_speed);
@@ -64,6 +66,38 @@ class Text
   void draw_align(const char* text, int x, int y, TextHAlign halign, TextVAlign valign, int shadowsize = 1, int update = NO_UPDATE);
   void erasetext(const char * text, int x, int y, Surface* surf, int update, int shadowsize);
   void erasecenteredtext(const char * text, int y, Surface* surf, int update, int shadowsize);
+
+  /** Draw text onto a 32 bit RGBA SDL surface instead of the screen */
+  void draw_to_surface(SDL_Surface* dest, const char* text, int x, int y, int shadowsize = 1);
+
+  /** Strings kept pre-rendered, the least recently drawn is dropped first */
+  static const size_t MAX_CACHED_TEXTS = 64;
+
+ private:
+  // Position of each ASCII character in the charset, -1 if it has none
+  short glyph_x[128];
+  short glyph_y[128];
+
+  /** A string drawn over and over is rendered into a surface of its own,
+      shadow included, and then drawn with a single blit. Strings are only
+      rendered once they were drawn in two different frames, so text that
+      changes every frame doesn't create a surface each time. */
+  struct CachedText
+  {
+    Surface* surface;          // nullptr until the text is drawn again
+    unsigned int first_stamp;  // AnimationClock stamp of the first draw
+    unsigned int last_used;
+  };
+  typedef std::map<std::pair<std::string, int>, CachedText> TextCache;
+  TextCache cache;
+  unsigned int cache_clock;
+
+  Surface* find_cached(const char* text, int shadowsize);
+  Surface* render(const char* text, int shadowsize);
+  void forget_oldest();
+
+  Text(const Text&);
+  Text& operator=(const Text&);
 };
 
 #endif /*SUPERTUX_TEXT_H*/
@@ -21,11 +21,17 @@
 #include <assert.h>
 #include <iostream>
 #include <algorithm>
+#include <stdlib.h>
+#include <string.h>
 #include "SDL.h"
 #include "SDL_image.h"
 #include "texture.h"
 #include "globals.h"
 #include "setup.h"
+#include "render_batch.h"
+#include "image_loader.h"
+#include "render_thread.h"
+#include "memory_budget.h"
 
 Surface::Surfaces Surface::surfaces;
 
@@ -35,7 +41,8 @@ Surface::Surfaces Surface::surfaces;
  * @param use_alpha Whether to use alpha transparency.
  */
 SurfaceData::SurfaceData(SDL_Surface* temp, int use_alpha_)
-  : type(SURFACE), surface(nullptr), use_alpha(use_alpha_)
+  : type(SURFACE), surface(nullptr), use_alpha(use_alpha_),
+    atlas(TextureAtlas::is_active())
 {
   // Copy the given surface and make sure that it is not stored in
   // video memory
@@ -60,7 +67,8 @@ SurfaceData::SurfaceData(SDL_Surface* temp, int use_alpha_)
  * @param use_alpha Whether to use alpha transparency.
  */
 SurfaceData::SurfaceData(const std::string& file_, int use_alpha_)
-  : type(LOAD), surface(nullptr), file(file_), use_alpha(use_alpha_)
+  : type(LOAD), surface(nullptr), file(file_), use_alpha(use_alpha_),
+    atlas(TextureAtlas::is_active())
 {
 }
 
@@ -75,7 +83,7 @@ SurfaceData::SurfaceData(const std::string& file_, int use_alpha_)
  */
 SurfaceData::SurfaceData(const std::string& file_, int x_, int y_, int w_, int h_, int use_alpha_)
   : type(LOAD_PART), surface(nullptr), file(file_), use_alpha(use_alpha_),
-    x(x_), y(y_), w(w_), h(h_)
+    x(x_), y(y_), w(w_), h(h_), atlas(TextureAtlas::is_active())
 {
 }
 
@@ -93,6 +101,12 @@ SurfaceData::~SurfaceData()
  */
 SurfaceImpl* SurfaceData::create()
 {
+#ifdef _WII_
+  if (use_gx)
+  {
+    return create_SurfaceGX();
+  }
+#endif
 #ifndef NOOPENGL
   if (use_gl)
   {
@@ -127,6 +141,28 @@ SurfaceSDL* SurfaceData::create_SurfaceSDL()
   }
 }
 
+#ifdef _WII_
+/**
+ * Creates a SurfaceGX based on the type of surface.
+ * @return A pointer to the created SurfaceGX.
+ */
+SurfaceGX* SurfaceData::create_SurfaceGX()
+{
+  switch (type)
+  {
+    case LOAD:
+      return new SurfaceGX(file, use_alpha);
+    case LOAD_PART:
+      return new SurfaceGX(file, x, y, w, h, use_alpha);
+    case SURFACE:
+      return new SurfaceGX(surface, use_alpha);
+    default:
+      assert(0);
+      return nullptr;
+  }
+}
+#endif
+
 #ifndef NOOPENGL
 /**
  * Creates a SurfaceOpenGL based on the type of surface.
@@ -137,11 +173,11 @@ SurfaceOpenGL* SurfaceData::create_SurfaceOpenGL()
   switch (type)
   {
     case LOAD:
-      return new SurfaceOpenGL(file, use_alpha);
+      return new SurfaceOpenGL(file, use_alpha, atlas);
     case LOAD_PART:
-      return new SurfaceOpenGL(file, x, y, w, h, use_alpha);
+      return new SurfaceOpenGL(file, x, y, w, h, use_alpha, atlas);
     case SURFACE:
-      return new SurfaceOpenGL(surface, use_alpha);
+      return new SurfaceOpenGL(surface, use_alpha, atlas);
     default:
       assert(0);
       return nullptr;
@@ -162,6 +198,83 @@ inline int power_of_two(int input)
   }
   return value;
 }
+
+/**
+ * Tells whether the OpenGL context can use textures of any size, which
+ * OpenGL 2.0 made a core feature.
+ * @return True if textures don't need to be padded to powers of two.
+ */
+static bool has_npot_textures()
+{
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (version && atoi(version) >= 2)
+  {
+    return true;
+  }
+
+  const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  return extensions && strstr(extensions, "GL_ARB_texture_non_power_of_two") != nullptr;
+}
+
+// How much of the alpha channel of an image is really needed
+enum AlphaUse { ALPHA_NONE, ALPHA_KEY, ALPHA_FULL };
+
+/**
+ * Scans the alpha channel of an RGBA image.
+ * @param conv The image, 32 bit RGBA in byte order.
+ * @param w, h The size of the part to scan.
+ * @return ALPHA_NONE if every pixel is opaque, ALPHA_KEY if pixels are
+ *         either opaque or fully transparent, ALPHA_FULL otherwise.
+ */
+static AlphaUse classify_alpha(SDL_Surface* conv, int w, int h)
+{
+  AlphaUse use = ALPHA_NONE;
+  for (int y = 0; y < h; ++y)
+  {
+    const Uint8* row = static_cast<Uint8*>(conv->pixels) + y * conv->pitch;
+    for (int x = 0; x < w; ++x)
+    {
+      Uint8 a = row[x * 4 + 3];
+      if (a == SDL_ALPHA_TRANSPARENT)
+      {
+        use = ALPHA_KEY;
+      }
+      else if (a != SDL_ALPHA_OPAQUE)
+      {
+        return ALPHA_FULL;
+      }
+    }
+  }
+  return use;
+}
+
+/**
+ * Packs an RGBA image into 16 bit texels, RGB565 when alpha isn't used
+ * and RGBA5551 for color keyed images.
+ * @param conv The image, 32 bit RGBA in byte order.
+ * @param use ALPHA_NONE or ALPHA_KEY.
+ * @param texels Receives conv->w * conv->h texels.
+ */
+static void pack_16bit(SDL_Surface* conv, AlphaUse use, std::vector<GLushort>* texels)
+{
+  texels->resize(conv->w * conv->h);
+  GLushort* out = &(*texels)[0];
+  for (int y = 0; y < conv->h; ++y)
+  {
+    const Uint8* p = static_cast<Uint8*>(conv->pixels) + y * conv->pitch;
+    for (int x = 0; x < conv->w; ++x, p += 4)
+    {
+      if (use == ALPHA_NONE)
+      {
+        *out++ = static_cast<GLushort>(((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3));
+      }
+      else
+      {
+        *out++ = static_cast<GLushort>(((p[0] >> 3) << 11) | ((p[1] >> 3) << 6) | ((p[2] >> 3) << 1) | (p[3] >> 7));
+      }
+    }
+  }
+}
 #endif
 
 /**
@@ -178,7 +291,8 @@ Surface::Surface(SDL_Surface* surf, int use_alpha)
     w = impl->w;
     h = impl->h;
   }
-  surfaces.push_back(this);
+  register_surface();
+  update_memory();
 }
 
 /**
@@ -195,7 +309,8 @@ Surface::Surface(const std::string& file, int use_alpha)
     w = impl->w;
     h = impl->h;
   }
-  surfaces.push_back(this);
+  register_surface();
+  update_memory();
 }
 
 /**
@@ -216,9 +331,38 @@ Surface::Surface(const std::string& file, int x, int y, int w, int h, int use_al
     w = impl->w;
     h = impl->h;
   }
+  register_surface();
+  update_memory();
+}
+
+/**
+ * Adds the surface to the registry of all surfaces.
+ */
+void Surface::register_surface()
+{
+  registry_slot = surfaces.size();
   surfaces.push_back(this);
 }
 
+/**
+ * Removes the surface from the registry by moving the last surface into
+ * its slot, so this doesn't depend on the number of surfaces.
+ */
+void Surface::unregister_surface()
+{
+  if (registry_slot >= surfaces.size() || surfaces[registry_slot] != this)
+  {
+    printf("Error: Surface freed twice!!!\n");
+    return;
+  }
+
+  Surface* last = surfaces.back();
+  surfaces[registry_slot] = last;
+  last->registry_slot = registry_slot;
+  surfaces.pop_back();
+  registry_slot = size_t(-1);
+}
+
 /**
  * Reloads the surface, necessary in case of a mode switch.
  */
@@ -231,6 +375,7 @@ void Surface::reload()
     w = impl->w;
     h = impl->h;
   }
+  update_memory();
 }
 
 /**
@@ -238,23 +383,34 @@ void Surface::reload()
  */
 Surface::~Surface()
 {
-#ifdef DEBUG
-  bool found = false;
-  for (auto i = surfaces.begin(); i != surfaces.end(); ++i)
+  unregister_surface();
+  delete impl;
+  impl = nullptr;
+  update_memory();
+}
+
+/**
+ * Reports the change of the memory the surface holds, its own copy of
+ * the pixels included.
+ */
+void Surface::update_memory()
+{
+  long pixels = 0;
+  long texture = 0;
+  if (data.surface)
   {
-    if (*i == this)
-    {
-      found = true;
-      break;
-    }
+    pixels += data.surface->h * data.surface->pitch;
   }
-  if (!found)
+  if (impl)
   {
-    printf("Error: Surface freed twice!!!\n");
+    pixels += impl->get_pixel_bytes();
+    texture = impl->get_texture_bytes();
   }
-#endif
-  surfaces.remove(this);
-  delete impl;
+
+  MemoryBudget::add(MEM_SURFACES, pixels - pixel_bytes);
+  MemoryBudget::add(MEM_TEXTURES, texture - texture_bytes);
+  pixel_bytes = pixels;
+  texture_bytes = texture;
 }
 
 /**
@@ -370,61 +526,123 @@ void Surface::resize(int w_, int h_)
     {
       reload();
     }
+    update_memory();
   }
 }
 
 /**
- * Captures the current screen and returns it as a Surface.
- * @return A pointer to a Surface representing the captured screen.
+ * Converts an image with an alpha channel to the cheapest representation
+ * for software blitting. The pixels are scanned once: images without
+ * transparency become opaque, images with only fully transparent pixels
+ * become color keyed, everything else keeps its alpha channel. Color
+ * keyed and alpha surfaces are RLE accelerated.
+ * @param image The image, in display format with alpha (freed here).
+ * @return The converted surface, nullptr if the conversion failed.
  */
-Surface* Surface::CaptureScreen()
+static SDL_Surface* classify_display_format(SDL_Surface* image)
 {
-  Surface* cap_screen = nullptr;  // Ensure initialization
+  const Uint32 key = SDL_MapRGB(screen->format, 255, 0, 255);
+  const SDL_PixelFormat* fmt = image->format;
+  bool transparent = false;
+  bool translucent = false;
+  bool key_used = false;
+
+  SDL_LockSurface(image);
+  for (int y = 0; y < image->h && !translucent; ++y)
+  {
+    Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(image->pixels) + y * image->pitch);
+    for (int x = 0; x < image->w; ++x)
+    {
+      Uint8 r, g, b, a;
+      SDL_GetRGBA(row[x], fmt, &r, &g, &b, &a);
+      if (a == SDL_ALPHA_TRANSPARENT)
+      {
+        transparent = true;
+      }
+      else if (a != SDL_ALPHA_OPAQUE)
+      {
+        translucent = true;
+        break;
+      }
+      else if (!key_used && SDL_MapRGB(screen->format, r, g, b) == key)
+      {
+        key_used = true;
+      }
+    }
+  }
 
-  if (!(screen->flags & SDL_OPENGL))
+  if (translucent || (transparent && key_used))
   {
-    cap_screen = new Surface(SDL_GetVideoSurface(), false);
+    SDL_UnlockSurface(image);
+    SDL_SetAlpha(image, SDL_SRCALPHA | SDL_RLEACCEL, SDL_ALPHA_OPAQUE);
+    return image;
   }
 
-#ifndef NOOPENGL
-  if (use_gl)
+  if (transparent)
   {
-    SDL_Surface* temp;
-    unsigned char* pixels;
-    int i;
-    temp = SDL_CreateRGBSurface(SDL_SWSURFACE, screen->w, screen->h, 24,
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-                                0x000000FF, 0x0000FF00, 0x00FF0000, 0
-#else
-                                0x00FF0000, 0x0000FF00, 0x000000FF, 0
-#endif
-                               );
-    if (temp == nullptr)
+    // Paint the transparent pixels in the key color before dropping alpha
+    Uint32 fill = SDL_MapRGBA(image->format, 255, 0, 255, SDL_ALPHA_OPAQUE);
+    for (int y = 0; y < image->h; ++y)
     {
-      st_abort("Error while trying to capture the screen in OpenGL mode", "");
+      Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(image->pixels) + y * image->pitch);
+      for (int x = 0; x < image->w; ++x)
+      {
+        if ((row[x] & fmt->Amask) == 0)
+        {
+          row[x] = fill;
+        }
+      }
     }
+  }
+  SDL_UnlockSurface(image);
 
-    pixels = static_cast<unsigned char*>(malloc(3 * screen->w * screen->h));
-    if (pixels == nullptr)
-    {
-      SDL_FreeSurface(temp);
-      st_abort("Error while trying to capture the screen in OpenGL mode", "");
-    }
+  SDL_SetAlpha(image, 0, 0);
+  SDL_Surface* converted = SDL_DisplayFormat(image);
+  SDL_FreeSurface(image);
+  if (converted == NULL)
+  {
+    return NULL;
+  }
+
+  SDL_SetAlpha(converted, 0, 0);
+  if (transparent)
+  {
+    SDL_SetColorKey(converted, SDL_SRCCOLORKEY | SDL_RLEACCEL, key);
+  }
 
-    glReadPixels(0, 0, screen->w, screen->h, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+  return converted;
+}
+
+/**
+ * Converts a loaded image to the format of the screen, done once at load
+ * time so that blits never have to convert pixels.
+ * @param image The loaded image.
+ * @param use_alpha Whether to use alpha transparency.
+ * @return The converted surface, nullptr if the conversion failed.
+ */
+static SDL_Surface* to_display_format(SDL_Surface* image, int use_alpha)
+{
+  if (use_gl || use_gx)
+  {
+    return SDL_DisplayFormatAlpha(image);
+  }
 
-    for (i = 0; i < screen->h; i++)
+  if (use_alpha == IGNORE_ALPHA)
+  {
+    SDL_Surface* converted = SDL_DisplayFormat(image);
+    if (converted)
     {
-      memcpy(static_cast<char*>(temp->pixels) + temp->pitch * i, pixels + 3 * screen->w * (screen->h - i - 1), screen->w * 3);
+      SDL_SetAlpha(converted, 0, 0);
     }
-    free(pixels);
-
-    cap_screen = new Surface(temp, false);
-    SDL_FreeSurface(temp);
+    return converted;
   }
-#endif
 
-  return cap_screen;
+  SDL_Surface* converted = SDL_DisplayFormatAlpha(image);
+  if (converted == NULL)
+  {
+    return NULL;
+  }
+  return classify_display_format(converted);
 }
 
 /**
@@ -444,7 +662,7 @@ SDL_Surface* sdl_surface_part_from_file(const std::string& file, int x, int y, i
   SDL_Surface* temp;
   SDL_Surface* conv;
 
-  temp = IMG_Load(file.c_str());
+  temp = ImageLoader::load(file);
 
   if (temp == NULL)
   {
@@ -466,25 +684,13 @@ SDL_Surface* sdl_surface_part_from_file(const std::string& file, int x, int y, i
   SDL_SetAlpha(temp, 0, 0);
 
   SDL_BlitSurface(temp, &src, conv, NULL);
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
-  {
-    sdl_surface = SDL_DisplayFormat(conv);
-  }
-  else
-  {
-    sdl_surface = SDL_DisplayFormatAlpha(conv);
-  }
+  sdl_surface = to_display_format(conv, use_alpha);
 
   if (sdl_surface == NULL)
   {
     st_abort("Can't convert to display format (part)", file);
   }
 
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
-  {
-    SDL_SetAlpha(sdl_surface, 0, 0);
-  }
-
   SDL_FreeSurface(temp);
   SDL_FreeSurface(conv);
 
@@ -502,32 +708,20 @@ SDL_Surface* sdl_surface_from_file(const std::string& file, int use_alpha)
   SDL_Surface* sdl_surface;
   SDL_Surface* temp;
 
-  temp = IMG_Load(file.c_str());
+  temp = ImageLoader::load(file);
 
   if (temp == NULL)
   {
     st_abort("Can't load", file);
   }
 
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
-  {
-    sdl_surface = SDL_DisplayFormat(temp);
-  }
-  else
-  {
-    sdl_surface = SDL_DisplayFormatAlpha(temp);
-  }
+  sdl_surface = to_display_format(temp, use_alpha);
 
   if (sdl_surface == NULL)
   {
     st_abort("Can't convert to display format", file);
   }
 
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
-  {
-    SDL_SetAlpha(sdl_surface, 0, 0);
-  }
-
   SDL_FreeSurface(temp);
 
   return sdl_surface;
@@ -552,7 +746,7 @@ SDL_Surface* sdl_surface_from_sdl_surface(SDL_Surface* sdl_surf, int use_alpha)
     SDL_SetAlpha(sdl_surf, 0, 0);
   }
 
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
+  if (use_alpha == IGNORE_ALPHA && !use_gl && !use_gx)
   {
     sdl_surface = SDL_DisplayFormat(sdl_surf);
   }
@@ -571,7 +765,7 @@ SDL_Surface* sdl_surface_from_sdl_surface(SDL_Surface* sdl_surf, int use_alpha)
     SDL_SetAlpha(sdl_surface, saved_flags, saved_alpha);
   }
 
-  if (use_alpha == IGNORE_ALPHA && !use_gl)
+  if (use_alpha == IGNORE_ALPHA && !use_gl && !use_gx)
   {
     SDL_SetAlpha(sdl_surface, 0, 0);
   }
@@ -603,6 +797,15 @@ SDL_Surface* SurfaceImpl::get_sdl_surface() const
   return sdl_surface;
 }
 
+/**
+ * Returns the size of the pixel data kept in main memory.
+ * @return The number of bytes, 0 if the surface has no pixels.
+ */
+size_t SurfaceImpl::get_pixel_bytes() const
+{
+  return sdl_surface ? sdl_surface->h * sdl_surface->pitch : 0;
+}
+
 /**
  * Resizes the surface to the specified width and height.
  * @param w_ The new width.
@@ -627,11 +830,12 @@ int SurfaceImpl::resize(int w_, int h_)
  * Constructor for SurfaceOpenGL.
  * @param surf The SDL_Surface to wrap.
  * @param use_alpha Whether to use alpha transparency.
+ * @param atlas Whether to pack the surface into a TextureAtlas page.
  */
-SurfaceOpenGL::SurfaceOpenGL(SDL_Surface* surf, int use_alpha)
+SurfaceOpenGL::SurfaceOpenGL(SDL_Surface* surf, int use_alpha, bool atlas)
 {
   sdl_surface = sdl_surface_from_sdl_surface(surf, use_alpha);
-  create_gl(sdl_surface, &gl_texture);
+  create_gl(sdl_surface, atlas);
 
   w = sdl_surface->w;
   h = sdl_surface->h;
@@ -641,11 +845,12 @@ SurfaceOpenGL::SurfaceOpenGL(SDL_Surface* surf, int use_alpha)
  * Constructor for SurfaceOpenGL.
  * @param file The path to the image file.
  * @param use_alpha Whether to use alpha transparency.
+ * @param atlas Whether to pack the surface into a TextureAtlas page.
  */
-SurfaceOpenGL::SurfaceOpenGL(const std::string& file, int use_alpha)
+SurfaceOpenGL::SurfaceOpenGL(const std::string& file, int use_alpha, bool atlas)
 {
   sdl_surface = sdl_surface_from_file(file, use_alpha);
-  create_gl(sdl_surface, &gl_texture);
+  create_gl(sdl_surface, atlas);
 
   w = sdl_surface->w;
   h = sdl_surface->h;
@@ -659,44 +864,86 @@ SurfaceOpenGL::SurfaceOpenGL(const std::string& file, int use_alpha)
  * @param w The width of the part to load.
  * @param h The height of the part to load.
  * @param use_alpha Whether to use alpha transparency.
+ * @param atlas Whether to pack the surface into a TextureAtlas page.
  */
-SurfaceOpenGL::SurfaceOpenGL(const std::string& file, int x, int y, int w, int h, int use_alpha)
+SurfaceOpenGL::SurfaceOpenGL(const std::string& file, int x, int y, int w, int h, int use_alpha, bool atlas)
 {
   sdl_surface = sdl_surface_part_from_file(file, x, y, w, h, use_alpha);
-  create_gl(sdl_surface, &gl_texture);
+  create_gl(sdl_surface, atlas);
 
   w = sdl_surface->w;
   h = sdl_surface->h;
 }
 
+/**
+ * Returns the estimated size of the texture, from its dimensions and the
+ * bytes per texel of the format it was uploaded in.
+ * @return The number of bytes, 0 for surfaces packed into an atlas page,
+ *         the pages are accounted by the TextureAtlas.
+ */
+size_t SurfaceOpenGL::get_texture_bytes() const
+{
+  return packed ? 0 : static_cast<size_t>(tex_w * tex_h * texel_bytes);
+}
+
 /**
  * Destructor for SurfaceOpenGL.
  */
 SurfaceOpenGL::~SurfaceOpenGL()
 {
-  glDeleteTextures(1, &gl_texture);
+  // Queued quads may still reference this texture
+  RenderBatch::flush();
+  if (packed)
+  {
+    TextureAtlas::remove(region);
+  }
+  else
+  {
+    glDeleteTextures(1, &gl_texture);
+  }
 }
 
 /**
- * Creates an OpenGL texture from an SDL_Surface.
+ * Creates an OpenGL texture from an SDL_Surface, or packs the surface
+ * into an atlas page if requested and it is small enough.
  * @param surf The source SDL_Surface.
- * @param tex The OpenGL texture ID to create.
+ * @param atlas Whether to try packing the surface into a TextureAtlas page.
  */
-void SurfaceOpenGL::create_gl(SDL_Surface* surf, GLuint* tex)
+void SurfaceOpenGL::create_gl(SDL_Surface* surf, bool atlas)
 {
+  packed = atlas && TextureAtlas::add(surf, &region);
+  texel_bytes = 4;
+  if (packed)
+  {
+    gl_texture = region.texture;
+    tex_x = region.x;
+    tex_y = region.y;
+    tex_w = TextureAtlas::PAGE_SIZE;
+    tex_h = TextureAtlas::PAGE_SIZE;
+    return;
+  }
+
   Uint32 saved_flags;
   Uint8 saved_alpha;
   int w, h;
   SDL_Surface* conv;
 
-  w = power_of_two(surf->w);
-  h = power_of_two(surf->h);
+  if (has_npot_textures())
+  {
+    w = surf->w;
+    h = surf->h;
+  }
+  else
+  {
+    w = power_of_two(surf->w);
+    h = power_of_two(surf->h);
+  }
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-  conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, surf->format->BitsPerPixel,
+  conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
                               0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
 #else
-  conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, surf->format->BitsPerPixel,
+  conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
                               0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
 #endif
 
@@ -716,15 +963,43 @@ void SurfaceOpenGL::create_gl(SDL_Surface* surf, GLuint* tex)
     SDL_SetAlpha(surf, saved_flags, saved_alpha);
   }
 
-  glGenTextures(1, tex);
-  glBindTexture(GL_TEXTURE_2D, *tex);
+  tex_x = 0;
+  tex_y = 0;
+  tex_w = w;
+  tex_h = h;
+
+  glGenTextures(1, &gl_texture);
+  glBindTexture(GL_TEXTURE_2D, gl_texture);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, conv->pitch / conv->format->BytesPerPixel);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, conv->pixels);
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  // Only images with real translucency need 8 bits per channel, the
+  // others are uploaded as 16 bit texels, which halves memory and bandwidth
+  AlphaUse use = classify_alpha(conv, surf->w, surf->h);
+  if (use == ALPHA_FULL)
+  {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, conv->pitch / conv->format->BytesPerPixel);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, conv->pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+  else
+  {
+    texel_bytes = 2;
+    std::vector<GLushort> texels;
+    pack_16bit(conv, use, &texels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    if (use == ALPHA_NONE)
+    {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5, w, h, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, &texels[0]);
+    }
+    else
+    {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5_A1, w, h, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, &texels[0]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
 
   SDL_FreeSurface(conv);
 }
@@ -739,30 +1014,10 @@ void SurfaceOpenGL::create_gl(SDL_Surface* surf, GLuint* tex)
  */
 int SurfaceOpenGL::draw(float x, float y, Uint8 alpha, bool update)
 {
-  float pw = power_of_two(w);
-  float ph = power_of_two(h);
-
-  glEnable(GL_TEXTURE_2D);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glColor4ub(alpha, alpha, alpha, alpha);
-
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-
-  glBegin(GL_QUADS);
-  glTexCoord2f(0, 0);
-  glVertex2f(x, y);
-  glTexCoord2f(static_cast<float>(w) / pw, 0);
-  glVertex2f(static_cast<float>(w) + x, y);
-  glTexCoord2f(static_cast<float>(w) / pw, static_cast<float>(h) / ph);
-  glVertex2f(static_cast<float>(w) + x, static_cast<float>(h) + y);
-  glTexCoord2f(0, static_cast<float>(h) / ph);
-  glVertex2f(x, static_cast<float>(h) + y);
-  glEnd();
-
-  glDisable(GL_TEXTURE_2D);
-  glDisable(GL_BLEND);
+  RenderBatch::add_quad(gl_texture, true, alpha,
+                        x, y, static_cast<float>(w) + x, static_cast<float>(h) + y,
+                        tex_x / tex_w, tex_y / tex_h,
+                        (tex_x + w) / tex_w, (tex_y + h) / tex_h);
 
   (void)update;  // avoid compiler warning
 
@@ -777,26 +1032,10 @@ int SurfaceOpenGL::draw(float x, float y, Uint8 alpha, bool update)
  */
 int SurfaceOpenGL::draw_bg(Uint8 alpha, bool update)
 {
-  float pw = power_of_two(w);
-  float ph = power_of_two(h);
-
-  glColor3ub(alpha, alpha, alpha);
-
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-
-  glBegin(GL_QUADS);
-  glTexCoord2f(0, 0);
-  glVertex2f(0, 0);
-  glTexCoord2f(static_cast<float>(w) / pw, 0);
-  glVertex2f(screen->w, 0);
-  glTexCoord2f(static_cast<float>(w) / pw, static_cast<float>(h) / ph);
-  glVertex2f(screen->w, screen->h);
-  glTexCoord2f(0, static_cast<float>(h) / ph);
-  glVertex2f(0, screen->h);
-  glEnd();
-
-  glDisable(GL_TEXTURE_2D);
+  RenderBatch::add_quad(gl_texture, false, alpha,
+                        0, 0, screen->w, screen->h,
+                        tex_x / tex_w, tex_y / tex_h,
+                        (tex_x + w) / tex_w, (tex_y + h) / tex_h);
 
   (void)update;  // avoid compiler warning
 
@@ -817,31 +1056,10 @@ int SurfaceOpenGL::draw_bg(Uint8 alpha, bool update)
  */
 int SurfaceOpenGL::draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update)
 {
-  float pw = power_of_two(int(this->w));
-  float ph = power_of_two(int(this->h));
-
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
-
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glColor4ub(alpha, alpha, alpha, alpha);
-
-  glEnable(GL_TEXTURE_2D);
-
-  glBegin(GL_QUADS);
-  glTexCoord2f(sx / pw, sy / ph);
-  glVertex2f(x, y);
-  glTexCoord2f((sx + w) / pw, sy / ph);
-  glVertex2f(w + x, y);
-  glTexCoord2f((sx + w) / pw, (sy + h) / ph);
-  glVertex2f(w + x, h + y);
-  glTexCoord2f(sx / pw, (sy + h) / ph);
-  glVertex2f(x, h + y);
-  glEnd();
-
-  glDisable(GL_TEXTURE_2D);
-  glDisable(GL_BLEND);
+  RenderBatch::add_quad(gl_texture, true, alpha,
+                        x, y, w + x, h + y,
+                        (tex_x + sx) / tex_w, (tex_y + sy) / tex_h,
+                        (tex_x + sx + w) / tex_w, (tex_y + sy + h) / tex_h);
 
   (void)update;  // avoid warnings
   return 0;
@@ -859,31 +1077,180 @@ int SurfaceOpenGL::draw_part(float sx, float sy, float x, float y, float w, floa
  */
 int SurfaceOpenGL::draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bool update)
 {
-  float pw = power_of_two(int(this->w));
-  float ph = power_of_two(int(this->h));
+  RenderBatch::add_quad(gl_texture, true, alpha,
+                        x, y, sw + x, sh + y,
+                        tex_x / tex_w, tex_y / tex_h,
+                        (tex_x + w) / tex_w, (tex_y + h) / tex_h);
 
-  glBindTexture(GL_TEXTURE_2D, gl_texture);
+  (void)update;  // avoid warnings
+  return 0;
+}
+#endif
+
+#ifdef _WII_
+/**
+ * Constructor for SurfaceGX.
+ * @param surf The SDL_Surface to wrap.
+ * @param use_alpha Whether to use alpha transparency.
+ */
+SurfaceGX::SurfaceGX(SDL_Surface* surf, int use_alpha)
+{
+  sdl_surface = sdl_surface_from_sdl_surface(surf, use_alpha);
+  create_gx();
+}
+
+/**
+ * Constructor for SurfaceGX.
+ * @param file The path to the image file.
+ * @param use_alpha Whether to use alpha transparency.
+ */
+SurfaceGX::SurfaceGX(const std::string& file, int use_alpha)
+{
+  sdl_surface = sdl_surface_from_file(file, use_alpha);
+  create_gx();
+}
+
+/**
+ * Constructor for SurfaceGX.
+ * @param file The path to the image file.
+ * @param x The x-coordinate of the part to load.
+ * @param y The y-coordinate of the part to load.
+ * @param w The width of the part to load.
+ * @param h The height of the part to load.
+ * @param use_alpha Whether to use alpha transparency.
+ */
+SurfaceGX::SurfaceGX(const std::string& file, int x, int y, int w, int h, int use_alpha)
+{
+  sdl_surface = sdl_surface_part_from_file(file, x, y, w, h, use_alpha);
+  create_gx();
+}
+
+/**
+ * Returns the size of the GX texture.
+ * @return The number of bytes, RGB565 takes two per texel and RGBA8 four.
+ */
+size_t SurfaceGX::get_texture_bytes() const
+{
+  if (texture == nullptr)
+  {
+    return 0;
+  }
+  int texel_bytes = GX_GetTexObjFmt(&texture->obj) == GX_TF_RGB565 ? 2 : 4;
+  return texture->width * texture->height * texel_bytes;
+}
+
+/**
+ * Destructor for SurfaceGX.
+ */
+SurfaceGX::~SurfaceGX()
+{
+  // Quads of the current frame may still reference the texture
+  GXVideo::free_texture(texture);
+}
+
+/**
+ * Uploads the SDL surface into a GX texture.
+ */
+void SurfaceGX::create_gx()
+{
+  w = sdl_surface->w;
+  h = sdl_surface->h;
+
+  texture = GXVideo::create_texture(sdl_surface);
+  if (texture == nullptr)
+  {
+    fprintf(stderr, "Warning: Couldn't create a %dx%d GX texture.\n", w, h);
+  }
+}
+
+/**
+ * Draws the GX surface at the specified coordinates.
+ * @param x The x-coordinate.
+ * @param y The y-coordinate.
+ * @param alpha The alpha transparency.
+ * @param update Whether to update the screen after drawing.
+ * @return 0 on success, or -2 if the surface needs to be reloaded.
+ */
+int SurfaceGX::draw(float x, float y, Uint8 alpha, bool update)
+{
+  if (texture)
+  {
+    GXVideo::draw_quad(texture, true, alpha,
+                       x, y, static_cast<float>(w) + x, static_cast<float>(h) + y,
+                       0, 0,
+                       static_cast<float>(w) / texture->width, static_cast<float>(h) / texture->height);
+  }
 
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  (void)update;  // avoid compiler warning
+  return 0;
+}
 
-  glColor4ub(alpha, alpha, alpha, alpha);
+/**
+ * Draws the GX surface as a background.
+ * @param alpha The alpha transparency.
+ * @param update Whether to update the screen after drawing.
+ * @return 0 on success, or -2 if the surface needs to be reloaded.
+ */
+int SurfaceGX::draw_bg(Uint8 alpha, bool update)
+{
+  if (texture)
+  {
+    GXVideo::draw_quad(texture, false, alpha,
+                       0, 0, screen->w, screen->h,
+                       0, 0,
+                       static_cast<float>(w) / texture->width, static_cast<float>(h) / texture->height);
+  }
 
-  glEnable(GL_TEXTURE_2D);
+  (void)update;  // avoid compiler warning
+  return 0;
+}
 
-  glBegin(GL_QUADS);
-  glTexCoord2f(0, 0);
-  glVertex2f(x, y);
-  glTexCoord2f(static_cast<float>(w) / pw, 0);
-  glVertex2f(sw + x, y);
-  glTexCoord2f(static_cast<float>(w) / pw, static_cast<float>(h) / ph);
-  glVertex2f(sw + x, sh + y);
-  glTexCoord2f(0, static_cast<float>(h) / ph);
-  glVertex2f(x, sh + y);
-  glEnd();
+/**
+ * Draws a portion of the GX surface at the specified coordinates.
+ * @param sx The source x-coordinate.
+ * @param sy The source y-coordinate.
+ * @param x The destination x-coordinate.
+ * @param y The destination y-coordinate.
+ * @param w The width of the portion.
+ * @param h The height of the portion.
+ * @param alpha The alpha transparency.
+ * @param update Whether to update the screen after drawing.
+ * @return 0 on success, or -2 if the surface needs to be reloaded.
+ */
+int SurfaceGX::draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update)
+{
+  if (texture)
+  {
+    GXVideo::draw_quad(texture, true, alpha,
+                       x, y, w + x, h + y,
+                       sx / texture->width, sy / texture->height,
+                       (sx + w) / texture->width, (sy + h) / texture->height);
+  }
 
-  glDisable(GL_TEXTURE_2D);
-  glDisable(GL_BLEND);
+  (void)update;  // avoid warnings
+  return 0;
+}
+
+/**
+ * Draws the GX surface stretched to the specified width and height,
+ * the GPU does the scaling.
+ * @param x The x-coordinate.
+ * @param y The y-coordinate.
+ * @param sw The width to stretch to.
+ * @param sh The height to stretch to.
+ * @param alpha The alpha transparency.
+ * @param update Whether to update the screen after drawing.
+ * @return 0 on success, or -2 if the surface needs to be reloaded.
+ */
+int SurfaceGX::draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bool update)
+{
+  if (texture)
+  {
+    GXVideo::draw_quad(texture, true, alpha,
+                       x, y, sw + x, sh + y,
+                       0, 0,
+                       static_cast<float>(w) / texture->width, static_cast<float>(h) / texture->height);
+  }
 
   (void)update;  // avoid warnings
   return 0;
@@ -896,6 +1263,7 @@ int SurfaceOpenGL::draw_stretched(float x, float y, int sw, int sh, Uint8 alpha,
  * @param use_alpha Whether to use alpha transparency.
  */
 SurfaceSDL::SurfaceSDL(SDL_Surface* surf, int use_alpha)
+  : alpha_copy(nullptr), stretch_copy(nullptr)
 {
   sdl_surface = sdl_surface_from_sdl_surface(surf, use_alpha);
   w = sdl_surface->w;
@@ -908,6 +1276,7 @@ SurfaceSDL::SurfaceSDL(SDL_Surface* surf, int use_alpha)
  * @param use_alpha Whether to use alpha transparency.
  */
 SurfaceSDL::SurfaceSDL(const std::string& file, int use_alpha)
+  : alpha_copy(nullptr), stretch_copy(nullptr)
 {
   sdl_surface = sdl_surface_from_file(file, use_alpha);
   w = sdl_surface->w;
@@ -924,6 +1293,7 @@ SurfaceSDL::SurfaceSDL(const std::string& file, int use_alpha)
  * @param use_alpha Whether to use alpha transparency.
  */
 SurfaceSDL::SurfaceSDL(const std::string& file, int x, int y, int w, int h, int use_alpha)
+  : alpha_copy(nullptr), stretch_copy(nullptr)
 {
   sdl_surface = sdl_surface_part_from_file(file, x, y, w, h, use_alpha);
   w = sdl_surface->w;
@@ -949,38 +1319,25 @@ int SurfaceSDL::draw(float x, float y, Uint8 alpha, bool update)
 
   if (alpha != 255)
   {
-    /* Create a Surface, make it using colorkey, blit surface into temp, apply alpha
-     * to temp sur, blit the temp into the screen
-     * NOTE: this has to be done, since SDL doesn't allow to set alpha to surfaces that
-     * already have an alpha mask yet... */
-    SDL_Surface* sdl_surface_copy = SDL_CreateRGBSurface(sdl_surface->flags,
-                                    sdl_surface->w, sdl_surface->h, sdl_surface->format->BitsPerPixel,
-                                    sdl_surface->format->Rmask, sdl_surface->format->Gmask,
-                                    sdl_surface->format->Bmask,
-                                    0);
-    int colorkey = SDL_MapRGB(sdl_surface_copy->format, 255, 0, 255);
-    SDL_FillRect(sdl_surface_copy, NULL, colorkey);
-    SDL_SetColorKey(sdl_surface_copy, SDL_SRCCOLORKEY, colorkey);
-
-    SDL_BlitSurface(sdl_surface, NULL, sdl_surface_copy, NULL);
-    SDL_SetAlpha(sdl_surface_copy, SDL_SRCALPHA, alpha);
+    SDL_Surface* sdl_surface_copy = get_alpha_copy();
 
-    int ret = SDL_BlitSurface(sdl_surface_copy, NULL, screen, &dest);
+    int ret = RenderThread::blit(sdl_surface_copy, NULL, &dest, alpha);
+    add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
     if (update == UPDATE)
     {
-      SDL_Flip(screen);
+      update_rect(screen, dest.x, dest.y, dest.w, dest.h);
     }
 
-    SDL_FreeSurface(sdl_surface_copy);
     return ret;
   }
 
-  int ret = SDL_BlitSurface(sdl_surface, NULL, screen, &dest);
+  int ret = RenderThread::blit(sdl_surface, NULL, &dest);
+  add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
   if (update == UPDATE)
   {
-    SDL_Flip(screen);
+    update_rect(screen, dest.x, dest.y, dest.w, dest.h);
   }
 
   return ret;
@@ -1003,38 +1360,25 @@ int SurfaceSDL::draw_bg(Uint8 alpha, bool update)
 
   if (alpha != 255)
   {
-    /* Create a Surface, make it using colorkey, blit surface into temp, apply alpha
-     * to temp sur, blit the temp into the screen
-     * NOTE: this has to be done, since SDL doesn't allow to set alpha to surfaces that
-     * already have an alpha mask yet... */
-    SDL_Surface* sdl_surface_copy = SDL_CreateRGBSurface(sdl_surface->flags,
-                                    sdl_surface->w, sdl_surface->h, sdl_surface->format->BitsPerPixel,
-                                    sdl_surface->format->Rmask, sdl_surface->format->Gmask,
-                                    sdl_surface->format->Bmask,
-                                    0);
-    int colorkey = SDL_MapRGB(sdl_surface_copy->format, 255, 0, 255);
-    SDL_FillRect(sdl_surface_copy, NULL, colorkey);
-    SDL_SetColorKey(sdl_surface_copy, SDL_SRCCOLORKEY, colorkey);
+    SDL_Surface* sdl_surface_copy = get_alpha_copy();
 
-    SDL_BlitSurface(sdl_surface, NULL, sdl_surface_copy, NULL);
-    SDL_SetAlpha(sdl_surface_copy, SDL_SRCALPHA, alpha);
-
-    int ret = SDL_BlitSurface(sdl_surface_copy, NULL, screen, &dest);
+    int ret = RenderThread::blit(sdl_surface_copy, NULL, &dest, alpha);
+    add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
     if (update == UPDATE)
     {
-      SDL_Flip(screen);
+      update_rect(screen, dest.x, dest.y, dest.w, dest.h);
     }
 
-    SDL_FreeSurface(sdl_surface_copy);
     return ret;
   }
 
-  int ret = SDL_SoftStretch(sdl_surface, NULL, screen, &dest);
+  int ret = RenderThread::stretch(sdl_surface, &dest);
+  add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
   if (update == UPDATE)
   {
-    SDL_Flip(screen);
+    update_rect(screen, dest.x, dest.y, dest.w, dest.h);
   }
 
   return ret;
@@ -1068,34 +1412,21 @@ int SurfaceSDL::draw_part(float sx, float sy, float x, float y, float w, float h
 
   if (alpha != 255)
   {
-    /* Create a Surface, make it using colorkey, blit surface into temp, apply alpha
-     * to temp sur, blit the temp into the screen
-     * Note: this has to be done, since SDL doesn't allow to set alpha to surfaces that
-     * already have an alpha mask yet... */
-    SDL_Surface* sdl_surface_copy = SDL_CreateRGBSurface(sdl_surface->flags,
-                                    sdl_surface->w, sdl_surface->h, sdl_surface->format->BitsPerPixel,
-                                    sdl_surface->format->Rmask, sdl_surface->format->Gmask,
-                                    sdl_surface->format->Bmask,
-                                    0);
-    int colorkey = SDL_MapRGB(sdl_surface_copy->format, 255, 0, 255);
-    SDL_FillRect(sdl_surface_copy, NULL, colorkey);
-    SDL_SetColorKey(sdl_surface_copy, SDL_SRCCOLORKEY, colorkey);
+    SDL_Surface* sdl_surface_copy = get_alpha_copy();
 
-    SDL_BlitSurface(sdl_surface, NULL, sdl_surface_copy, NULL);
-    SDL_SetAlpha(sdl_surface_copy, SDL_SRCALPHA, alpha);
-
-    int ret = SDL_BlitSurface(sdl_surface_copy, NULL, screen, &dest);
+    int ret = RenderThread::blit(sdl_surface_copy, &src, &dest, alpha);
+    add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
     if (update == UPDATE)
     {
-      SDL_Flip(screen);
+      update_rect(screen, dest.x, dest.y, dest.w, dest.h);
     }
 
-    SDL_FreeSurface(sdl_surface_copy);
     return ret;
   }
 
-  int ret = SDL_BlitSurface(sdl_surface, &src, screen, &dest);
+  int ret = RenderThread::blit(sdl_surface, &src, &dest);
+  add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
   if (update == UPDATE)
   {
@@ -1124,22 +1455,38 @@ int SurfaceSDL::draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bo
   dest.w = static_cast<int>(sw);
   dest.h = static_cast<int>(sh);
 
+  // The scratch surface is changed right here
+  RenderThread::finish();
+
   if (alpha != 255)
   {
     SDL_SetAlpha(sdl_surface, SDL_SRCALPHA, alpha);
   }
 
-  SDL_Surface* sdl_surface_copy = SDL_CreateRGBSurface(sdl_surface->flags,
-                                  sw, sh, sdl_surface->format->BitsPerPixel,
-                                  sdl_surface->format->Rmask, sdl_surface->format->Gmask,
-                                  sdl_surface->format->Bmask,
-                                  0);
+  // Reuse the scratch surface of the last call if it has the right size
+  if (stretch_copy && (stretch_copy->w != sw || stretch_copy->h != sh))
+  {
+    SDL_FreeSurface(stretch_copy);
+    stretch_copy = nullptr;
+  }
+  if (!stretch_copy)
+  {
+    stretch_copy = SDL_CreateRGBSurface(sdl_surface->flags,
+                                        sw, sh, sdl_surface->format->BitsPerPixel,
+                                        sdl_surface->format->Rmask, sdl_surface->format->Gmask,
+                                        sdl_surface->format->Bmask,
+                                        0);
+  }
+  else
+  {
+    SDL_FillRect(stretch_copy, NULL, 0);
+  }
 
-  SDL_BlitSurface(sdl_surface, NULL, sdl_surface_copy, NULL);
-  SDL_SoftStretch(sdl_surface_copy, NULL, sdl_surface_copy, &dest);
+  SDL_BlitSurface(sdl_surface, NULL, stretch_copy, NULL);
+  SDL_SoftStretch(stretch_copy, NULL, stretch_copy, &dest);
 
-  int ret = SDL_BlitSurface(sdl_surface_copy, NULL, screen, &dest);
-  SDL_FreeSurface(sdl_surface_copy);
+  int ret = SDL_BlitSurface(stretch_copy, NULL, screen, &dest);
+  add_dirty_rect(dest.x, dest.y, dest.w, dest.h);
 
   if (update == UPDATE)
   {
@@ -1149,11 +1496,66 @@ int SurfaceSDL::draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bo
   return ret;
 }
 
+/**
+ * Returns the color keyed copy of the surface used for translucent
+ * draws, creating it on first use.
+ * NOTE: this has to be done, since SDL doesn't allow to set alpha to
+ * surfaces that already have an alpha mask yet. The copy doesn't depend
+ * on the alpha value, so it is kept and the alpha is set by the blit.
+ * @return The copy.
+ */
+SDL_Surface* SurfaceSDL::get_alpha_copy()
+{
+  if (!alpha_copy)
+  {
+    // Blitting from the surface changes its blit mapping, which the
+    // render thread may be using
+    RenderThread::finish();
+
+    alpha_copy = SDL_CreateRGBSurface(sdl_surface->flags,
+                                      sdl_surface->w, sdl_surface->h, sdl_surface->format->BitsPerPixel,
+                                      sdl_surface->format->Rmask, sdl_surface->format->Gmask,
+                                      sdl_surface->format->Bmask,
+                                      0);
+    int colorkey = SDL_MapRGB(alpha_copy->format, 255, 0, 255);
+    SDL_FillRect(alpha_copy, NULL, colorkey);
+    SDL_SetColorKey(alpha_copy, SDL_SRCCOLORKEY, colorkey);
+
+    SDL_BlitSurface(sdl_surface, NULL, alpha_copy, NULL);
+  }
+  return alpha_copy;
+}
+
+/**
+ * Frees the cached copies, they are recreated on demand.
+ */
+void SurfaceSDL::free_copies()
+{
+  RenderThread::finish();
+  SDL_FreeSurface(alpha_copy);
+  alpha_copy = nullptr;
+  SDL_FreeSurface(stretch_copy);
+  stretch_copy = nullptr;
+}
+
+/**
+ * Resizes the surface, the cached copies don't match it anymore.
+ * @param w_ The new width.
+ * @param h_ The new height.
+ * @return 0 on success, or -2 if the surface needs to be reloaded.
+ */
+int SurfaceSDL::resize(int w_, int h_)
+{
+  free_copies();
+  return SurfaceImpl::resize(w_, h_);
+}
+
 /**
  * Destructor for SurfaceSDL.
  */
 SurfaceSDL::~SurfaceSDL()
 {
+  free_copies();
 }
 
 // EOF
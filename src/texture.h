@@ -26,8 +26,10 @@
 #include <SDL_opengl.h>
 #endif
 
-#include <list>
+#include <vector>
 #include "screen.h"
+#include "texture_atlas.h"
+#include "gx_video.h"
 
 // Load part of an image into SDL_Surface
 SDL_Surface* sdl_surface_part_from_file(const std::string& file, int x, int y, int w, int h, int use_alpha);
@@ -45,6 +47,10 @@ class SurfaceSDL;
 class SurfaceOpenGL;
 #endif
 
+#ifdef _WII_
+class SurfaceGX;
+#endif
+
 // Holds data for constructing different surface types
 class SurfaceData
 {
@@ -58,6 +64,7 @@ public:
   int y;
   int w;
   int h;
+  bool atlas;  // pack into a TextureAtlas page in OpenGL mode
 
   SurfaceData(SDL_Surface* surf, int use_alpha_);
   SurfaceData(const std::string& file_, int use_alpha_);
@@ -70,10 +77,14 @@ public:
   SurfaceOpenGL* create_SurfaceOpenGL();
 #endif
 
+#ifdef _WII_
+  SurfaceGX* create_SurfaceGX();
+#endif
+
   SurfaceImpl* create();
 };
 
-// A container for surface data to support different implementations (OpenGL/SDL)
+// A container for surface data to support different implementations (OpenGL/GX/SDL)
 class Surface
 {
 public:
@@ -82,7 +93,9 @@ public:
   int w;
   int h;
 
-  typedef std::list<Surface*> Surfaces;
+  // All existing surfaces, each one knows its slot so that it can be
+  // removed in constant time
+  typedef std::vector<Surface*> Surfaces;
   static Surfaces surfaces;
 
   Surface(SDL_Surface* surf, int use_alpha);
@@ -90,7 +103,6 @@ public:
   Surface(const std::string& file, int x, int y, int w, int h, int use_alpha);
   ~Surface();
 
-  static Surface* CaptureScreen();
   void reload();
   void draw(float x, float y, Uint8 alpha = 255, bool update = false);
   void draw_bg(Uint8 alpha = 255, bool update = false);
@@ -100,6 +112,17 @@ public:
 
   static void reload_all();
   static void debug_check();
+
+private:
+  size_t registry_slot;
+
+  // What the surface reported to the MemoryBudget
+  long pixel_bytes = 0;
+  long texture_bytes = 0;
+  void update_memory();
+
+  void register_surface();
+  void unregister_surface();
 };
 
 // Base class for surface implementations
@@ -119,8 +142,12 @@ public:
   virtual int draw_bg(Uint8 alpha, bool update) = 0;
   virtual int draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update) = 0;
   virtual int draw_stretched(float x, float y, int w, int h, Uint8 alpha, bool update) = 0;
-  int resize(int w_, int h_);
+  virtual int resize(int w_, int h_);
   SDL_Surface* get_sdl_surface() const;  // Avoid usage whenever possible
+
+  /** Bytes of the pixel data in main memory and of the texture */
+  size_t get_pixel_bytes() const;
+  virtual size_t get_texture_bytes() const { return 0; }
 };
 
 #ifndef NOOPENGL
@@ -131,18 +158,55 @@ class SurfaceOpenGL : public SurfaceImpl
 public:
   unsigned gl_texture;
 
-  SurfaceOpenGL(SDL_Surface* surf, int use_alpha);
-  SurfaceOpenGL(const std::string& file, int use_alpha);
-  SurfaceOpenGL(const std::string& file, int x, int y, int w, int h, int use_alpha);
+  SurfaceOpenGL(SDL_Surface* surf, int use_alpha, bool atlas = false);
+  SurfaceOpenGL(const std::string& file, int use_alpha, bool atlas = false);
+  SurfaceOpenGL(const std::string& file, int x, int y, int w, int h, int use_alpha, bool atlas = false);
   virtual ~SurfaceOpenGL();
 
   int draw(float x, float y, Uint8 alpha, bool update);
   int draw_bg(Uint8 alpha, bool update);
   int draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update);
   int draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bool update);
+  size_t get_texture_bytes() const;
 
 private:
-  void create_gl(SDL_Surface* surf, GLuint* tex);
+  // Place of the image inside gl_texture and the size of the texture,
+  // all in pixels, so that atlas pages and own textures are handled alike
+  float tex_x;
+  float tex_y;
+  float tex_w;
+  float tex_h;
+  int texel_bytes;  // Bytes per texel of the format create_gl() uploaded
+  bool packed;
+  TextureAtlas::Region region;
+
+  void create_gl(SDL_Surface* surf, bool atlas);
+};
+
+#endif
+
+#ifdef _WII_
+
+// GX-specific surface implementation for the Wii
+class SurfaceGX : public SurfaceImpl
+{
+public:
+  SurfaceGX(SDL_Surface* surf, int use_alpha);
+  SurfaceGX(const std::string& file, int use_alpha);
+  SurfaceGX(const std::string& file, int x, int y, int w, int h, int use_alpha);
+  virtual ~SurfaceGX();
+
+  int draw(float x, float y, Uint8 alpha, bool update);
+  int draw_bg(Uint8 alpha, bool update);
+  int draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update);
+  int draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bool update);
+  size_t get_texture_bytes() const;
+
+private:
+  // Null if the surface didn't fit into a texture, it isn't drawn then
+  GXVideo::Texture* texture;
+
+  void create_gx();
 };
 
 #endif
@@ -160,6 +224,16 @@ public:
   int draw_bg(Uint8 alpha, bool update);
   int draw_part(float sx, float sy, float x, float y, float w, float h, Uint8 alpha, bool update);
   int draw_stretched(float x, float y, int sw, int sh, Uint8 alpha, bool update);
+  int resize(int w_, int h_);
+
+private:
+  // Color keyed copy used for translucent draws, created on first use
+  SDL_Surface* alpha_copy;
+  // Scratch surface of draw_stretched(), kept while the size stays the same
+  SDL_Surface* stretch_copy;
+
+  SDL_Surface* get_alpha_copy();
+  void free_copies();
 };
 
 #endif /*SUPERTUX_TEXTURE_H*/
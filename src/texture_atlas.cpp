@@ -0,0 +1,367 @@
+//  texture_atlas.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <string.h>
+#include <vector>
+#include "texture_atlas.h"
+#include "render_batch.h"
+#include "memory_budget.h"
+#include "globals.h"
+#include "setup.h"
+
+namespace
+{
+
+int active_depth = 0;
+
+#ifndef NOOPENGL
+
+// Border of repeated edge pixels around every packed surface, keeps
+// linear filtering from picking up texels of the neighbours
+const int GUTTER = 1;
+
+// Surfaces bigger than this (in either direction) are not worth packing
+const int MAX_PACKED_SIZE = TextureAtlas::PAGE_SIZE / 2;
+
+// GL_RGB10_A2 takes four bytes per texel
+const long PAGE_BYTES = TextureAtlas::PAGE_SIZE * TextureAtlas::PAGE_SIZE * 4L;
+
+// A row of surfaces inside a page, all no higher than the row itself
+struct Shelf
+{
+  int y;
+  int height;
+  int next_x;
+};
+
+struct Page
+{
+  GLuint texture;
+  int refs;
+  int next_y;
+  bool stale;  // texture belongs to a GL context that is gone
+  std::vector<Shelf> shelves;
+};
+
+std::vector<Page> pages;
+
+/**
+ * Looks for room of the given size in a page, opening a new shelf if
+ * none of the existing ones fits.
+ * @param page The page to search.
+ * @param w The width needed, gutter included.
+ * @param h The height needed, gutter included.
+ * @param x Receives the x-coordinate of the spot.
+ * @param y Receives the y-coordinate of the spot.
+ * @return True if a spot was found.
+ */
+bool find_spot(Page& page, int w, int h, int* x, int* y)
+{
+  Shelf* best = nullptr;
+  for (Shelf& shelf : page.shelves)
+  {
+    if (shelf.height >= h && shelf.next_x + w <= TextureAtlas::PAGE_SIZE &&
+        (best == nullptr || shelf.height < best->height))
+    {
+      best = &shelf;
+    }
+  }
+
+  if (best == nullptr)
+  {
+    if (page.next_y + h > TextureAtlas::PAGE_SIZE)
+    {
+      return false;
+    }
+
+    Shelf shelf;
+    shelf.y = page.next_y;
+    shelf.height = h;
+    shelf.next_x = 0;
+    page.next_y += h;
+    page.shelves.push_back(shelf);
+    best = &page.shelves.back();
+  }
+
+  *x = best->next_x;
+  *y = best->y;
+  best->next_x += w;
+  return true;
+}
+
+/**
+ * Creates an empty page texture.
+ * @param page The page to initialize.
+ */
+void create_page(Page& page)
+{
+  page.refs = 0;
+  page.next_y = 0;
+  page.stale = false;
+  page.shelves.clear();
+
+  glGenTextures(1, &page.texture);
+  glBindTexture(GL_TEXTURE_2D, page.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, TextureAtlas::PAGE_SIZE, TextureAtlas::PAGE_SIZE,
+               0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  MemoryBudget::add(MEM_TEXTURES, PAGE_BYTES);
+}
+
+/**
+ * Converts a surface to RGBA and surrounds it with a copy of its own
+ * edge pixels, ready to be uploaded into a page.
+ * @param surf The source surface.
+ * @return A new surface, GUTTER pixels larger on each side.
+ */
+SDL_Surface* create_padded(SDL_Surface* surf)
+{
+  int w = surf->w + 2 * GUTTER;
+  int h = surf->h + 2 * GUTTER;
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  SDL_Surface* conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
+                                           0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+  SDL_Surface* conv = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
+                                           0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+  if (conv == NULL)
+  {
+    st_abort("No memory left.", "");
+  }
+
+  /* Save the alpha blending attributes */
+  Uint32 saved_flags = surf->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
+  Uint8 saved_alpha = surf->format->alpha;
+  if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+  {
+    SDL_SetAlpha(surf, 0, 0);
+  }
+
+  SDL_Rect dest;
+  dest.x = GUTTER;
+  dest.y = GUTTER;
+  dest.w = surf->w;
+  dest.h = surf->h;
+  SDL_BlitSurface(surf, 0, conv, &dest);
+
+  /* Restore the alpha blending attributes */
+  if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+  {
+    SDL_SetAlpha(surf, saved_flags, saved_alpha);
+  }
+
+  SDL_LockSurface(conv);
+  int pitch = conv->pitch / 4;
+  Uint32* pixels = static_cast<Uint32*>(conv->pixels);
+  for (int y = GUTTER; y < h - GUTTER; ++y)
+  {
+    Uint32* row = pixels + y * pitch;
+    for (int i = 0; i < GUTTER; ++i)
+    {
+      row[i] = row[GUTTER];
+      row[w - 1 - i] = row[w - 1 - GUTTER];
+    }
+  }
+  for (int i = 0; i < GUTTER; ++i)
+  {
+    memcpy(pixels + i * pitch, pixels + GUTTER * pitch, w * 4);
+    memcpy(pixels + (h - 1 - i) * pitch, pixels + (h - 1 - GUTTER) * pitch, w * 4);
+  }
+  SDL_UnlockSurface(conv);
+
+  return conv;
+}
+
+#endif
+
+} // namespace
+
+#ifndef NOOPENGL
+
+/**
+ * Packs a surface into one of the atlas pages, creating a new page if
+ * all existing ones are full.
+ * @param surf The surface to pack.
+ * @param region Receives the place of the surface.
+ * @return True on success, false if the surface is too big to be packed.
+ */
+bool TextureAtlas::add(SDL_Surface* surf, Region* region)
+{
+  if (surf->w > MAX_PACKED_SIZE || surf->h > MAX_PACKED_SIZE)
+  {
+    return false;
+  }
+
+  int w = surf->w + 2 * GUTTER;
+  int h = surf->h + 2 * GUTTER;
+  int x = 0;
+  int y = 0;
+  int index = -1;
+
+  for (int i = 0; i < int(pages.size()) && index < 0; ++i)
+  {
+    if (pages[i].texture != 0 && !pages[i].stale && find_spot(pages[i], w, h, &x, &y))
+    {
+      index = i;
+    }
+  }
+
+  if (index < 0)
+  {
+    // Reuse the slot of a page that was given back, if any
+    for (int i = 0; i < int(pages.size()) && index < 0; ++i)
+    {
+      if (pages[i].texture == 0)
+      {
+        index = i;
+      }
+    }
+    if (index < 0)
+    {
+      index = pages.size();
+      pages.push_back(Page());
+    }
+
+    create_page(pages[index]);
+    find_spot(pages[index], w, h, &x, &y);
+  }
+
+  Page& page = pages[index];
+  SDL_Surface* conv = create_padded(surf);
+
+  RenderBatch::flush();
+  glBindTexture(GL_TEXTURE_2D, page.texture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, conv->pitch / conv->format->BytesPerPixel);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, conv->pixels);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  SDL_FreeSurface(conv);
+
+  page.refs += 1;
+
+  region->page = index;
+  region->texture = page.texture;
+  region->x = x + GUTTER;
+  region->y = y + GUTTER;
+  return true;
+}
+
+/**
+ * Releases the spot of a packed surface. Spots are not reused one by
+ * one, a page is recycled as a whole once it is empty.
+ * @param region The place of the surface, as returned by add().
+ */
+void TextureAtlas::remove(const Region& region)
+{
+  if (region.page < 0 || region.page >= int(pages.size()))
+  {
+    return;
+  }
+
+  Page& page = pages[region.page];
+  if (page.texture != region.texture || page.refs <= 0)
+  {
+    return;
+  }
+
+  page.refs -= 1;
+  if (page.refs == 0)
+  {
+    if (!page.stale)
+    {
+      RenderBatch::flush();
+      glDeleteTextures(1, &page.texture);
+    }
+    page.texture = 0;
+    page.stale = false;
+    MemoryBudget::add(MEM_TEXTURES, -PAGE_BYTES);
+    page.shelves.clear();
+  }
+}
+
+/**
+ * Marks all pages as belonging to a lost GL context. Their surfaces can
+ * still be removed, but nothing gets packed into them anymore and their
+ * texture names are not deleted, since the new context may reuse them.
+ */
+void TextureAtlas::invalidate()
+{
+  for (Page& page : pages)
+  {
+    page.stale = true;
+  }
+}
+
+#endif
+
+/**
+ * Starts packing newly created surfaces.
+ */
+void TextureAtlas::begin()
+{
+  active_depth += 1;
+}
+
+/**
+ * Stops packing newly created surfaces, once every begin() is matched.
+ */
+void TextureAtlas::end()
+{
+  if (active_depth > 0)
+  {
+    active_depth -= 1;
+  }
+}
+
+/**
+ * Tells whether newly created surfaces should be packed. This is
+ * remembered by the surface, so it also applies when it gets reloaded.
+ * @return True between begin() and end().
+ */
+bool TextureAtlas::is_active()
+{
+  return active_depth > 0;
+}
+
+/**
+ * Counts the page textures that hold at least one surface.
+ * @return The number of pages in use.
+ */
+int TextureAtlas::get_page_count()
+{
+  int count = 0;
+#ifndef NOOPENGL
+  for (const Page& page : pages)
+  {
+    if (page.texture != 0 && !page.stale)
+    {
+      count += 1;
+    }
+  }
+#endif
+  return count;
+}
+
+// EOF
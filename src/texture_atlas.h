@@ -0,0 +1,73 @@
+//  texture_atlas.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_TEXTURE_ATLAS_H
+#define SUPERTUX_TEXTURE_ATLAS_H
+
+#include <SDL.h>
+#ifndef NOOPENGL
+#include <SDL_opengl.h>
+#endif
+
+/** Packs many small OpenGL surfaces (tiles, sprite frames, fonts) into a
+    few large texture pages, instead of giving each its own power of two
+    texture. Surfaces created between begin() and end() are packed in
+    OpenGL mode, all others keep a texture of their own. */
+class TextureAtlas
+{
+public:
+  /** Size in pixels of a (square) atlas page */
+  static const int PAGE_SIZE = 1024;
+
+#ifndef NOOPENGL
+  /** Place of a packed surface inside an atlas page */
+  struct Region
+  {
+    int page;
+    GLuint texture;
+    int x;
+    int y;
+  };
+
+  /** Copy surf into a free spot of a page, returns false if it is too
+      big to be packed, in which case it needs a texture of its own */
+  static bool add(SDL_Surface* surf, Region* region);
+
+  /** Give the spot of a packed surface back, the page texture is freed
+      once its last surface got removed */
+  static void remove(const Region& region);
+
+  /** Forget all page textures, needed when the GL context got lost
+      (video mode switch) and all surfaces are about to be reloaded */
+  static void invalidate();
+#endif
+
+  /** Pack surfaces created from now on, calls may be nested */
+  static void begin();
+  static void end();
+  static bool is_active();
+
+  /** Number of page textures currently in use */
+  static int get_page_count();
+};
+
+#endif /*SUPERTUX_TEXTURE_ATLAS_H*/
+
+// EOF
@@ -20,8 +20,13 @@
 
 #include "tile.h"
 #include "scene.h"
+#include "resources.h"
+#include "anim_clock.h"
+#include "image_loader.h"
+#include "memory_budget.h"
 #include "assert.h"
 #include <cstring>
+#include <iostream>
 #include <filesystem>
 
 // Static member initialization
@@ -32,29 +37,30 @@ namespace fs = std::filesystem;  // Alias for ease of use
 
 /**
  * Constructor for Tile.
- * Initializes a Tile object.
+ * Initializes all properties to those of an empty tile.
  */
 Tile::Tile()
+  : id(-1), solid(false), brick(false), ice(false), water(false),
+    fullbox(false), distro(false), goal(false), data(0), next_tile(0),
+    anim_speed(25), first_image(0), anim_counter(0), anim_frame(0)
 {
-  // Constructor: Initializes a Tile object
 }
 
 /**
- * Destructor for Tile.
- * Cleans up allocated memory for image surfaces.
+ * Packs the attributes of the tile into a single byte.
+ * @return A combination of TileFlags.
  */
-Tile::~Tile()
+unsigned char Tile::get_flags() const
 {
-  // Destructor: Clean up allocated memory for image surfaces
-  for (Surface* image : images)
-  {
-    delete image;
-  }
-
-  for (Surface* editor_image : editor_images)
-  {
-    delete editor_image;
-  }
+  unsigned char flags = 0;
+  if (solid)   flags |= TILE_SOLID;
+  if (brick)   flags |= TILE_BRICK;
+  if (ice)     flags |= TILE_ICE;
+  if (water)   flags |= TILE_WATER;
+  if (fullbox) flags |= TILE_FULLBOX;
+  if (distro)  flags |= TILE_DISTRO;
+  if (goal)    flags |= TILE_GOAL;
+  return flags;
 }
 
 /**
@@ -62,6 +68,7 @@ Tile::~Tile()
  * Loads the initial tileset from the default location.
  */
 TileManager::TileManager()
+  : memory_bytes(0)
 {
   // Constructor: Load the initial tileset
   std::string filename = datadir + "/images/tilesets/supertux.stgt";
@@ -70,19 +77,49 @@ TileManager::TileManager()
 
 /**
  * Destructor for TileManager.
- * Cleans up allocated memory for tiles managed by this manager.
  */
 TileManager::~TileManager()
 {
-  // Destructor: Clean up allocated memory for tiles
-  for (Tile* tile : tiles)
+  MemoryBudget::add(MEM_TILES, -memory_bytes);
+}
+
+/**
+ * Queues the images of all tiles of a tileset that aren't cached yet, so
+ * they get decoded in the background while load_tileset() converts them
+ * one after the other.
+ * @param cur The elements of the tileset file.
+ */
+void TileManager::queue_images(lisp_object_t* cur)
+{
+  std::vector<std::string> files;
+
+  for (; !lisp_nil_p(cur); cur = lisp_cdr(cur))
   {
-    delete tile;
+    lisp_object_t* element = lisp_car(cur);
+    if (strcmp(lisp_symbol(lisp_car(element)), "tile") != 0)
+    {
+      continue;
+    }
+
+    std::vector<std::string> names;
+    LispReader reader(lisp_cdr(element));
+    reader.read_string_vector("images", &names);
+
+    for (const std::string& name : names)
+    {
+      std::string file = datadir + "/images/tilesets/" + name;
+      if (!surface_manager->find_surface(file, USE_ALPHA))
+      {
+        files.push_back(file);
+      }
+    }
   }
+
+  ImageLoader::queue(files);
 }
 
 /**
- * Loads a tileset from a file.
+ * Loads a tileset from a file, replacing the current one.
  * @param filename The path to the tileset file.
  * If the filename matches the currently loaded tileset, it does nothing.
  */
@@ -93,14 +130,66 @@ void TileManager::load_tileset(std::string filename)
     return;
   }
 
-  // Free old tiles to avoid memory leaks
-  for (Tile* tile : tiles)
+  tiles.clear();
+  images.clear();
+  editor_filenames.clear();
+  editor_images.clear();
+  tileset_files.clear();
+
+  parse_tileset(filename);
+
+  // The image table is complete, so the tiles can point into it now
+  for (Tile& tile : tiles)
   {
-    delete tile;
+    tile.images = TileImages(tile.images.empty() ? nullptr : &images[tile.first_image],
+                             tile.images.size());
   }
 
-  tiles.clear();
+  if (tiles.empty())
+  {
+    tiles.resize(1);
+  }
+
+  current_tileset = filename;
+
+  long bytes = tiles.capacity() * sizeof(Tile) + images.capacity() * sizeof(SurfaceRef);
+  MemoryBudget::add(MEM_TILES, bytes - memory_bytes);
+  memory_bytes = bytes;
+}
+
+/**
+ * Reads the current tileset from its files again, after they were edited.
+ * The files are checked first, since a tileset that doesn't parse aborts.
+ * @return True if the tileset was read again.
+ */
+bool TileManager::reload()
+{
+  for (const std::string& file : tileset_files)
+  {
+    lisp_object_t* root_obj = lisp_read_from_file(file);
+    bool valid = root_obj && root_obj->type != LISP_TYPE_EOF && root_obj->type != LISP_TYPE_PARSE_ERROR;
+    lisp_free(root_obj);
+    if (!valid)
+    {
+      std::cerr << "TileManager: Couldn't read " << file << ", keeping the old tileset" << std::endl;
+      return false;
+    }
+  }
 
+  std::string filename = current_tileset;
+  current_tileset.clear();
+  load_tileset(filename);
+  return true;
+}
+
+/**
+ * Adds the tiles of a tileset file, and of the tilesets it includes, to
+ * the tiles loaded so far.
+ * @param filename The path to the tileset file.
+ */
+void TileManager::parse_tileset(const std::string& filename)
+{
+  tileset_files.push_back(filename);
   lisp_object_t* root_obj = lisp_read_from_file(filename);
 
   if (!root_obj)
@@ -110,6 +199,8 @@ void TileManager::load_tileset(std::string filename)
 
   if (strcmp(lisp_symbol(lisp_car(root_obj)), "supertux-tiles") == 0)
   {
+    queue_images(lisp_cdr(root_obj));
+
     lisp_object_t* cur = lisp_cdr(root_obj);
     int tileset_id = 0;
 
@@ -119,82 +210,71 @@ void TileManager::load_tileset(std::string filename)
 
       if (strcmp(lisp_symbol(lisp_car(element)), "tile") == 0)
       {
-        Tile* tile = new Tile;
-
-        // Initialize all fields to safe defaults
-        tile->id = -1;
-        tile->solid = false;
-        tile->brick = false;
-        tile->ice = false;
-        tile->water = false;
-        tile->fullbox = false;
-        tile->distro = false;
-        tile->goal = false;
-        tile->data = 0;
-        tile->next_tile = 0;
-        tile->anim_speed = 25;
+        Tile tile;
 
         // Parse the tile properties from the file
         LispReader reader(lisp_cdr(element));
         #ifndef DDEBUG
-        void(reader.read_int("id", &tile->id));
+        void(reader.read_int("id", &tile.id));
         #else
-        assert(reader.read_int("id", &tile->id));
+        assert(reader.read_int("id", &tile.id));
         #endif
 
-        reader.read_bool("solid", &tile->solid);
-        reader.read_bool("brick", &tile->brick);
-        reader.read_bool("ice", &tile->ice);
-        reader.read_bool("water", &tile->water);
-        reader.read_bool("fullbox", &tile->fullbox);
-        reader.read_bool("distro", &tile->distro);
-        reader.read_bool("goal", &tile->goal);
-        reader.read_int("data", &tile->data);
-        reader.read_int("anim-speed", &tile->anim_speed);
-        reader.read_int("next-tile", &tile->next_tile);
-        reader.read_string_vector("images", &tile->filenames);
-        reader.read_string_vector("editor-images", &tile->editor_filenames);
-
-        // Load images and associate them with the tile
-        tile->images.reserve(tile->filenames.size());
-
-        for (const std::string& filename : tile->filenames)
+        reader.read_bool("solid", &tile.solid);
+        reader.read_bool("brick", &tile.brick);
+        reader.read_bool("ice", &tile.ice);
+        reader.read_bool("water", &tile.water);
+        reader.read_bool("fullbox", &tile.fullbox);
+        reader.read_bool("distro", &tile.distro);
+        reader.read_bool("goal", &tile.goal);
+        reader.read_int("data", &tile.data);
+        reader.read_int("anim-speed", &tile.anim_speed);
+        reader.read_int("next-tile", &tile.next_tile);
+
+        std::vector<std::string> filenames;
+        reader.read_string_vector("images", &filenames);
+
+        // Load the images into the image table, packing them into shared
+        // atlas pages. The tile gets pointed at them once the table is
+        // complete.
+        TextureAtlas::begin();
+        tile.first_image = images.size();
+        for (const std::string& name : filenames)
         {
-          Surface* cur_image = nullptr;  // Initialize the pointer to nullptr
-          tile->images.push_back(cur_image);
-          tile->images.back() = new Surface(
-            datadir + "/images/tilesets/" + filename, USE_ALPHA
-          );
+          images.push_back(surface_manager->load_surface(
+            datadir + "/images/tilesets/" + name, USE_ALPHA
+          ));
         }
+        TextureAtlas::end();
+        tile.images = TileImages(nullptr, filenames.size());
 
-        // Load editor images
-        tile->editor_images.reserve(tile->editor_filenames.size());
-
-        for (const std::string& filename : tile->editor_filenames)
+        int id = tile.id + tileset_id;
+        if (id >= 0)
         {
-          Surface* cur_image = nullptr;  // Initialize the pointer to nullptr
-          tile->editor_images.push_back(cur_image);
-          tile->editor_images.back() = new Surface(
-            datadir + "/images/tilesets/" + filename, USE_ALPHA
-          );
+          // The editor images are only read when the editor asks for them
+          std::vector<std::string> editor_files;
+          reader.read_string_vector("editor-images", &editor_files);
+          if (!editor_files.empty())
+          {
+            editor_filenames[id].swap(editor_files);
+          }
+
+          // Ensure the tiles vector is large enough
+          if (id >= int(tiles.size()))
+          {
+            tiles.resize(id + 1);
+          }
+
+          tiles[id] = tile;
         }
-
-        // Ensure the tiles vector is large enough
-        if (tile->id + tileset_id >= int(tiles.size()))
-        {
-          tiles.resize(tile->id + tileset_id + 1);
-        }
-
-        tiles[tile->id + tileset_id] = tile;
       }
       else if (strcmp(lisp_symbol(lisp_car(element)), "tileset") == 0)
       {
         // Load a nested tileset file
         LispReader reader(lisp_cdr(element));
-        std::string filename;
-        reader.read_string("file", &filename);
-        filename = datadir + "/images/tilesets/" + filename;
-        load_tileset(filename);
+        std::string nested;
+        reader.read_string("file", &nested);
+        parse_tileset(datadir + "/images/tilesets/" + nested);
       }
       else if (strcmp(lisp_symbol(lisp_car(element)), "tilegroup") == 0)
       {
@@ -232,7 +312,34 @@ void TileManager::load_tileset(std::string filename)
   }
 
   lisp_free(root_obj);
-  current_tileset = filename;
+}
+
+/**
+ * Gets the images the editor shows for a tile, loading them the first
+ * time they are asked for.
+ * @param id The tile id.
+ * @return The editor images, empty if the tile has none.
+ */
+const std::vector<SurfaceRef>& TileManager::get_editor_images(int id)
+{
+  std::map<int, std::vector<SurfaceRef> >::iterator i = editor_images.find(id);
+  if (i != editor_images.end())
+  {
+    return i->second;
+  }
+
+  std::vector<SurfaceRef>& result = editor_images[id];
+  std::map<int, std::vector<std::string> >::iterator files = editor_filenames.find(id);
+  if (files != editor_filenames.end())
+  {
+    for (const std::string& name : files->second)
+    {
+      result.push_back(surface_manager->load_surface(
+        datadir + "/images/tilesets/" + name, USE_ALPHA
+      ));
+    }
+  }
+  return result;
 }
 
 /**
@@ -256,8 +363,7 @@ void Tile::draw(float x, float y, unsigned int c, Uint8 alpha)
     return;
   }
 
-  int frame_index = ((global_frame_counter * 25) / ptile->anim_speed) % ptile->images.size();
-  ptile->images[frame_index]->draw(x, y, alpha);
+  ptile->images[ptile->get_frame()]->draw(x, y, alpha);
 }
 
 /**
@@ -283,8 +389,28 @@ void Tile::draw_stretched(float x, float y, int w, int h, unsigned int c, Uint8
     return;
   }
 
-  int frame_index = ((global_frame_counter * 25) / ptile->anim_speed) % ptile->images.size();
-  ptile->images[frame_index]->draw_stretched(x, y, w, h, alpha);
+  ptile->images[ptile->get_frame()]->draw_stretched(x, y, w, h, alpha);
+}
+
+/**
+ * Gets the frame of the tile animation to draw, cached per value of
+ * global_frame_counter.
+ * @return The index into images, images must not be empty.
+ */
+int Tile::get_frame()
+{
+  if (images.size() == 1)
+  {
+    return 0;
+  }
+
+  // anim_frame is 0 for a fresh tile, which is right for counter 0 too
+  if (anim_counter != global_frame_counter)
+  {
+    anim_frame = AnimationClock::get_tile_frame(anim_speed, images.size());
+    anim_counter = global_frame_counter;
+  }
+  return anim_frame;
 }
 
 // EOF
@@ -25,26 +25,58 @@
 #include <map>
 #include <vector>
 #include "texture.h"
+#include "surfaceref.h"
 #include "globals.h"
 #include "lispreader.h"
 #include "setup.h"
 
+/** Attributes of a tile packed into a single byte, as stored per cell by
+    Level::get_tile_flags() */
+enum TileFlags
+{
+  TILE_SOLID   = 0x01,
+  TILE_BRICK   = 0x02,
+  TILE_ICE     = 0x04,
+  TILE_WATER   = 0x08,
+  TILE_FULLBOX = 0x10,
+  TILE_DISTRO  = 0x20,
+  TILE_GOAL    = 0x40
+};
+
+/** The images of a tile, a range of the image table of the TileManager.
+    Works like a read-only std::vector<SurfaceRef>. */
+class TileImages
+{
+public:
+  TileImages() : first(nullptr), count(0) {}
+  TileImages(const SurfaceRef* first_, unsigned int count_) : first(first_), count(count_) {}
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  const SurfaceRef& operator[](size_t i) const { return first[i]; }
+  const SurfaceRef* begin() const { return first; }
+  const SurfaceRef* end() const { return first + count; }
+
+private:
+  const SurfaceRef* first;
+  unsigned int count;
+};
+
 /**
 Tile Class
+
+Plain properties of a tile, kept in one flat array indexed by the tile id
+so that looking a tile up touches a single cache line. The file names
+and editor images aren't kept here, see TileManager.
 */
 class Tile
 {
 public:
   Tile();
-  ~Tile();
 
   int id;
 
-  std::vector<Surface*> images;
-  std::vector<Surface*> editor_images;
-
-  std::vector<std::string>  filenames;
-  std::vector<std::string> editor_filenames;
+  TileImages images;
 
   /** solid tile that is indestructable by Tux */
   bool solid;
@@ -79,9 +111,26 @@ public:
 
   int anim_speed;
 
+  /** Returns the attributes of this tile as a combination of TileFlags */
+  unsigned char get_flags() const;
+
   /** Draw a tile on the screen: */
   static void draw(float x, float y, unsigned int c, Uint8 alpha = 255);
   static void draw_stretched(float x, float y, int w, int h, unsigned int c, Uint8 alpha = 255);
+
+private:
+  friend class TileManager;
+
+  /** Position of the images in the image table of the TileManager */
+  unsigned int first_image;
+
+  /** Frame of the animation for anim_counter, see get_frame() */
+  unsigned int anim_counter;
+  int anim_frame;
+
+  /** Index into images for the current global_frame_counter, only worked
+      out once per frame however many cells show this tile */
+  int get_frame();
 };
 
 struct TileGroup
@@ -101,13 +150,30 @@ class TileManager
   TileManager();
   ~TileManager();
 
-  std::vector<Tile*> tiles;
+  /** All tiles indexed by id, ids no tile uses hold a default tile */
+  std::vector<Tile> tiles;
+
+  /** The images of all tiles, each tile refers to a range of it */
+  std::vector<SurfaceRef> images;
+
+  /** The editor images are only loaded when asked for */
+  std::map<int, std::vector<std::string> > editor_filenames;
+  std::map<int, std::vector<SurfaceRef> > editor_images;
+
   static TileManager* instance_ ;
   static std::set<TileGroup>* tilegroups_;
   void load_tileset(std::string filename);
+  void parse_tileset(const std::string& filename);
+  void queue_images(lisp_object_t* cur);
 
   std::string current_tileset;
 
+  /** The tileset file and the files it includes, in parse order */
+  std::vector<std::string> tileset_files;
+
+  /** The bytes of tiles and images reported to MemoryBudget */
+  long memory_bytes;
+
  public:
   static TileManager* instance() { return instance_ ? instance_ : instance_ = new TileManager(); }
   static void destroy_instance() { delete instance_; instance_ = 0; }
@@ -116,16 +182,27 @@ class TileManager
   Tile* get(unsigned int id) {
     if(id < tiles.size())
       {
-        return tiles[id]; 
+        return &tiles[id];
       }
     else
       {
         // Never return 0, but return the 0th tile instead so that
         // user code doesn't have to check for NULL pointers all over
         // the place
-        return tiles[0]; 
+        return &tiles[0];
       }
   }
+
+  /** Get the images the editor shows for a tile, loading them on first
+      use */
+  const std::vector<SurfaceRef>& get_editor_images(int id);
+
+  /** The files the current tileset was read from */
+  const std::vector<std::string>& get_tileset_files() const { return tileset_files; }
+
+  /** Read the current tileset again. Pointers to tiles become invalid,
+      returns false and keeps the tiles if the tileset can't be read. */
+  bool reload();
 };
 
 #endif
@@ -0,0 +1,211 @@
+//  tile_layer.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <iostream>
+#include <algorithm>
+#include "tile_layer.h"
+
+/**
+ * Constructor for TileLayer, starts out without any column.
+ */
+TileLayer::TileLayer()
+  : columns(0), streamed(false), stream_offset(0)
+{
+}
+
+/**
+ * Changes the width of the layer. Columns are stored one after another,
+ * so this only appends or drops cells at the end.
+ * @param new_columns The new number of columns.
+ */
+void TileLayer::resize(int new_columns)
+{
+  if (new_columns < 0)
+  {
+    new_columns = 0;
+  }
+
+  make_resident();
+  cells.resize(new_columns * ROWS, 0);
+  columns = new_columns;
+}
+
+/**
+ * Removes all cells of the layer.
+ */
+void TileLayer::clear()
+{
+  cells.clear();
+  columns = 0;
+
+  streamed = false;
+  stream_file.clear();
+  stream_stamp.clear();
+  pages.clear();
+}
+
+/**
+ * Lets the layer read its cells from a file, page by page, as they are
+ * needed.
+ * @param file The file holding the cells.
+ * @param offset Where the cells start in the file.
+ * @param new_columns The number of columns in the file.
+ * @param stamp Bytes the file has to start with.
+ */
+void TileLayer::stream(const std::string& file, long offset, int new_columns, const std::string& stamp)
+{
+  clear();
+
+  streamed = true;
+  stream_file = file;
+  stream_offset = offset;
+  stream_stamp = stamp;
+  columns = new_columns > 0 ? new_columns : 0;
+
+  Page empty;
+  empty.changed = false;
+  pages.assign((columns + PAGE_COLUMNS - 1) / PAGE_COLUMNS, empty);
+}
+
+/**
+ * Drops the pages that are further than a page away from the given
+ * columns, they are read again when needed.
+ * @param first The first column to keep.
+ * @param last The last column to keep.
+ * @return True if a page was dropped.
+ */
+bool TileLayer::trim(int first, int last)
+{
+  if (!streamed)
+  {
+    return false;
+  }
+
+  int first_page = first / PAGE_COLUMNS - 1;
+  int last_page = last / PAGE_COLUMNS + 1;
+  bool dropped = false;
+
+  for (int page = 0; page < static_cast<int>(pages.size()); ++page)
+  {
+    Page& p = pages[page];
+    if ((page < first_page || page > last_page) && !p.changed && !p.cells.empty())
+    {
+      std::vector<unsigned int>().swap(p.cells);
+      dropped = true;
+    }
+  }
+
+  return dropped;
+}
+
+/**
+ * Reads all pages of a streamed layer into a single buffer, after which
+ * the layer no longer depends on its file.
+ */
+void TileLayer::make_resident()
+{
+  if (!streamed)
+  {
+    return;
+  }
+
+  std::vector<unsigned int> all(columns * ROWS, 0);
+  for (int page = 0; page < static_cast<int>(pages.size()); ++page)
+  {
+    const std::vector<unsigned int>& page_cells = page_in(page);
+    int count = page_columns(page) * ROWS;
+    std::copy(page_cells.begin(), page_cells.begin() + count, all.begin() + page * PAGE_COLUMNS * ROWS);
+  }
+
+  streamed = false;
+  stream_file.clear();
+  stream_stamp.clear();
+  pages.clear();
+  cells.swap(all);
+}
+
+/**
+ * Computes the memory taken by the cells that are loaded.
+ * @return The size in bytes.
+ */
+size_t TileLayer::memory_bytes() const
+{
+  size_t bytes = cells.capacity() * sizeof(unsigned int);
+  for (const Page& page : pages)
+  {
+    bytes += page.cells.capacity() * sizeof(unsigned int);
+  }
+  return bytes;
+}
+
+/**
+ * Tells how many columns of the layer a page holds, the last page may not
+ * be full.
+ * @param page The page number.
+ * @return The number of columns.
+ */
+int TileLayer::page_columns(int page) const
+{
+  int count = columns - page * PAGE_COLUMNS;
+  return count < PAGE_COLUMNS ? count : PAGE_COLUMNS;
+}
+
+/**
+ * Makes sure a page of a streamed layer is in memory. Pages that can't
+ * be read, e.g. because the file was written again, read as tile 0.
+ * @param page The page number.
+ * @return The cells of the page, PAGE_COLUMNS columns of them.
+ */
+std::vector<unsigned int>& TileLayer::page_in(int page) const
+{
+  Page& p = pages[page];
+  if (!p.cells.empty())
+  {
+    return p.cells;
+  }
+
+  static_assert(sizeof(unsigned int) == sizeof(uint32_t), "tile ids are stored as 32 bit");
+
+  p.cells.assign(PAGE_COLUMNS * ROWS, 0);
+  int count = page_columns(page) * ROWS;
+
+  bool ok = false;
+  FILE* file = fopen(stream_file.c_str(), "rb");
+  if (file)
+  {
+    std::string stamp(stream_stamp.size(), '\0');
+    ok = fread(&stamp[0], 1, stamp.size(), file) == stamp.size() && stamp == stream_stamp &&
+         fseek(file, stream_offset + static_cast<long>(page) * PAGE_COLUMNS * ROWS * sizeof(uint32_t), SEEK_SET) == 0 &&
+         fread(p.cells.data(), sizeof(uint32_t), count, file) == static_cast<size_t>(count);
+    fclose(file);
+  }
+
+  if (!ok)
+  {
+    std::cerr << "Warning: Couldn't read tiles from " << stream_file << std::endl;
+    std::fill(p.cells.begin(), p.cells.end(), 0);
+  }
+
+  return p.cells;
+}
+
+// EOF
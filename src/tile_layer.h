@@ -0,0 +1,154 @@
+//  tile_layer.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_TILE_LAYER_H
+#define SUPERTUX_TILE_LAYER_H
+
+#include <string>
+#include <vector>
+
+/** The tile ids of one tilemap layer in a single buffer. Cells are stored
+    column after column, since scrolling moves through the level one
+    column at a time. Cells outside of the layer read as tile 0.
+
+    Very wide layers can be streamed from a file instead, see stream().
+    The cells are then kept in pages of PAGE_COLUMNS columns, which are
+    read the first time one of their cells is asked for and dropped by
+    trim() once the camera is far away. */
+class TileLayer
+{
+public:
+  static const int ROWS = 15;
+  static const int PAGE_COLUMNS = 256;
+
+  TileLayer();
+
+  /** Change the number of columns, keeping the existing cells */
+  void resize(int new_columns);
+
+  /** Remove all cells */
+  void clear();
+
+  /** Read the cells from a file when they are needed instead of keeping
+      them all, the layer's current cells are dropped
+      @param file The file holding the cells, laid out like get_cells()
+      @param offset Where the cells start in the file
+      @param new_columns The number of columns in the file
+      @param stamp Bytes the file has to start with, so a rewritten file
+                   isn't read as if it still held these cells */
+  void stream(const std::string& file, long offset, int new_columns, const std::string& stamp);
+
+  bool is_streamed() const
+  {
+    return streamed;
+  }
+
+  /** Drop the pages of a streamed layer that are far from the columns
+      first to last, changed pages are kept
+      @return True if any page was dropped */
+  bool trim(int first, int last);
+
+  /** Read all pages of a streamed layer and keep them in a single buffer
+      from now on */
+  void make_resident();
+
+  /** The bytes taken by the cells that are in memory */
+  size_t memory_bytes() const;
+
+  int get_columns() const
+  {
+    return columns;
+  }
+
+  /** Return the tile id at column x and row y */
+  unsigned int get(int x, int y) const
+  {
+    if (x < 0 || x >= columns || y < 0 || y >= ROWS)
+    {
+      return 0;
+    }
+    if (streamed)
+    {
+      return page_in(x / PAGE_COLUMNS)[(x % PAGE_COLUMNS) * ROWS + y];
+    }
+    return cells[x * ROWS + y];
+  }
+
+  /** Set the tile id at column x and row y, ignored outside of the layer */
+  void set(int x, int y, unsigned int id)
+  {
+    if (x >= 0 && x < columns && y >= 0 && y < ROWS)
+    {
+      if (streamed)
+      {
+        page_in(x / PAGE_COLUMNS)[(x % PAGE_COLUMNS) * ROWS + y] = id;
+        pages[x / PAGE_COLUMNS].changed = true;
+        return;
+      }
+      cells[x * ROWS + y] = id;
+    }
+  }
+
+  /** Return the ROWS cells of column x, which must be inside the layer.
+      The cells of the following columns follow up to the end of the page
+      the column belongs to, and stay valid until the next trim() */
+  const unsigned int* get_column(int x) const
+  {
+    if (streamed)
+    {
+      return &page_in(x / PAGE_COLUMNS)[(x % PAGE_COLUMNS) * ROWS];
+    }
+    return &cells[x * ROWS];
+  }
+
+  /** All cells, get_columns() * ROWS of them, only for layers that
+      aren't streamed */
+  std::vector<unsigned int>& get_cells()
+  {
+    return cells;
+  }
+  const std::vector<unsigned int>& get_cells() const
+  {
+    return cells;
+  }
+
+private:
+  struct Page
+  {
+    std::vector<unsigned int> cells;  /**< Empty while not in memory */
+    bool changed;                     /**< Set cells can't be read again */
+  };
+
+  int page_columns(int page) const;
+  std::vector<unsigned int>& page_in(int page) const;
+
+  std::vector<unsigned int> cells;
+  int columns;
+
+  bool streamed;
+  std::string stream_file;
+  long stream_offset;
+  std::string stream_stamp;
+  mutable std::vector<Page> pages;
+};
+
+#endif /*SUPERTUX_TILE_LAYER_H*/
+
+// EOF
@@ -0,0 +1,295 @@
+//  tilemap_cache.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "tilemap_cache.h"
+#include "tile.h"
+#include "globals.h"
+#include "setup.h"
+#include "render_batch.h"
+#include "render_thread.h"
+
+namespace
+{
+
+const int TILE_SIZE = 32;
+const int ROWS = TileLayer::ROWS;
+
+// is_current() compares a chunk with the cells of one page
+static_assert(TileLayer::PAGE_COLUMNS % TileMapCache::CHUNK_COLUMNS == 0,
+              "chunks must not span pages of a streamed layer");
+
+/**
+ * Tells whether a tile can be baked into a chunk: it must not be
+ * animated and must not reach into neighbouring cells.
+ * @param tile The tile to check.
+ * @return True if the tile is static.
+ */
+bool is_static(const Tile* tile)
+{
+  return tile->images.size() == 1 &&
+         tile->images[0]->w <= TILE_SIZE && tile->images[0]->h <= TILE_SIZE;
+}
+
+} // namespace
+
+/**
+ * Constructor for TileMapCache, starts without any chunk.
+ */
+TileMapCache::TileMapCache()
+  : frame(0)
+{
+  for (Chunk& chunk : chunks)
+  {
+    chunk.first_column = -1;
+    chunk.surface = nullptr;
+    chunk.last_used = 0;
+  }
+}
+
+/**
+ * Destructor for TileMapCache.
+ */
+TileMapCache::~TileMapCache()
+{
+  clear();
+}
+
+/**
+ * Frees all chunks, they get rebuilt on demand.
+ */
+void TileMapCache::clear()
+{
+  for (Chunk& chunk : chunks)
+  {
+    delete chunk.surface;
+    chunk.surface = nullptr;
+    chunk.first_column = -1;
+    chunk.cells.clear();
+    chunk.live_cells.clear();
+  }
+}
+
+/**
+ * Draws the visible part of a tilemap layer. Each visible chunk is drawn
+ * as a single surface, followed by its animated and oversized tiles.
+ * @param layer The layer to draw.
+ * @param scroll_x The horizontal scroll position in pixels.
+ */
+void TileMapCache::draw(const TileLayer& layer, float scroll_x)
+{
+  ++frame;
+
+  int first_column = static_cast<int>(scroll_x / TILE_SIZE);
+  int last_column = first_column + screen->w / TILE_SIZE;
+
+  for (int c = first_column / CHUNK_COLUMNS; c <= last_column / CHUNK_COLUMNS; ++c)
+  {
+    Chunk& chunk = get_chunk(layer, c * CHUNK_COLUMNS);
+    float x = chunk.first_column * TILE_SIZE - scroll_x;
+
+    if (chunk.surface)
+    {
+      chunk.surface->draw(x, 0);
+    }
+
+    RenderBatch::begin_layer(TILE_SIZE);
+    for (const LiveCell& cell : chunk.live_cells)
+    {
+      if (cell.column >= first_column && cell.column <= last_column)
+      {
+        Tile::draw(x + (cell.column - chunk.first_column) * TILE_SIZE,
+                   cell.row * TILE_SIZE, cell.id);
+      }
+    }
+    RenderBatch::end_layer();
+  }
+}
+
+/**
+ * Finds the chunk starting at the given column, building it if it isn't
+ * cached or no longer matches the level. The least recently used chunk
+ * makes room for a new one.
+ * @param layer The layer the chunk belongs to.
+ * @param first_column The first column of the chunk.
+ * @return The up to date chunk.
+ */
+TileMapCache::Chunk& TileMapCache::get_chunk(const TileLayer& layer, int first_column)
+{
+  Chunk* found = nullptr;
+  Chunk* oldest = &chunks[0];
+
+  for (Chunk& chunk : chunks)
+  {
+    if (chunk.first_column == first_column)
+    {
+      found = &chunk;
+      break;
+    }
+    if (chunk.last_used < oldest->last_used)
+    {
+      oldest = &chunk;
+    }
+  }
+
+  if (!found)
+  {
+    found = oldest;
+    build(*found, layer, first_column);
+  }
+  else if (!is_current(*found, layer))
+  {
+    build(*found, layer, first_column);
+  }
+
+  found->last_used = frame;
+  return *found;
+}
+
+/**
+ * Compares a chunk against the cells of the level.
+ * @param chunk The chunk to check.
+ * @param layer The layer the chunk belongs to.
+ * @return True if no cell of the chunk was changed since it was built.
+ */
+bool TileMapCache::is_current(const Chunk& chunk, const TileLayer& layer) const
+{
+  // Chunks and layers both store their cells column by column
+  int inside = std::min(CHUNK_COLUMNS, layer.get_columns() - chunk.first_column);
+  if (inside > 0 &&
+      memcmp(&chunk.cells[0], layer.get_column(chunk.first_column), inside * ROWS * sizeof(unsigned int)) != 0)
+  {
+    return false;
+  }
+
+  for (int i = std::max(inside, 0) * ROWS; i < CHUNK_COLUMNS * ROWS; ++i)
+  {
+    if (chunk.cells[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Renders the static tiles of a chunk into a new surface and collects
+ * the tiles that have to be drawn each frame.
+ * @param chunk The chunk to (re)build.
+ * @param layer The layer the chunk belongs to.
+ * @param first_column The first column of the chunk.
+ */
+void TileMapCache::build(Chunk& chunk, const TileLayer& layer, int first_column)
+{
+  // Copying the tiles changes their blit mapping and alpha, which the
+  // render thread may be using
+  RenderThread::finish();
+
+  delete chunk.surface;
+  chunk.surface = nullptr;
+  chunk.first_column = first_column;
+  chunk.cells.resize(ROWS * CHUNK_COLUMNS);
+  chunk.live_cells.clear();
+
+  SDL_Surface* temp = nullptr;
+
+  for (int y = 0; y < ROWS; ++y)
+  {
+    for (int x = 0; x < CHUNK_COLUMNS; ++x)
+    {
+      unsigned int id = layer.get(first_column + x, y);
+      chunk.cells[x * ROWS + y] = id;
+
+      if (id == 0)
+      {
+        continue;
+      }
+
+      Tile* tile = TileManager::instance()->get(id);
+      if (!tile || tile->images.empty())
+      {
+        continue;
+      }
+
+      if (!is_static(tile))
+      {
+        LiveCell cell;
+        cell.column = first_column + x;
+        cell.row = y;
+        cell.id = id;
+        chunk.live_cells.push_back(cell);
+        continue;
+      }
+
+      if (temp == nullptr)
+      {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        temp = SDL_CreateRGBSurface(SDL_SWSURFACE, CHUNK_COLUMNS * TILE_SIZE, ROWS * TILE_SIZE, 32,
+                                    0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+        temp = SDL_CreateRGBSurface(SDL_SWSURFACE, CHUNK_COLUMNS * TILE_SIZE, ROWS * TILE_SIZE, 32,
+                                    0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+        if (temp == nullptr)
+        {
+          st_abort("No memory left.", "");
+        }
+        SDL_FillRect(temp, NULL, 0);
+      }
+
+      // Cells don't overlap, so the tile (alpha channel included) can
+      // simply be copied into place
+      SDL_Surface* image = tile->images[0]->impl->get_sdl_surface();
+      Uint32 saved_flags = image->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
+      Uint8 saved_alpha = image->format->alpha;
+      SDL_SetAlpha(image, 0, 0);
+
+      SDL_Rect dest;
+      dest.x = x * TILE_SIZE;
+      dest.y = y * TILE_SIZE;
+      dest.w = image->w;
+      dest.h = image->h;
+      SDL_BlitSurface(image, NULL, temp, &dest);
+
+      if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+      {
+        // Keep RLE acceleration of the tile, which SDL_RLEACCELOK stands for
+        Uint32 flags = SDL_SRCALPHA | ((saved_flags & SDL_RLEACCELOK) ? SDL_RLEACCEL : 0);
+        SDL_SetAlpha(image, flags, saved_alpha);
+      }
+    }
+  }
+
+  if (temp)
+  {
+    chunk.surface = new Surface(temp, USE_ALPHA);
+    SDL_FreeSurface(temp);
+
+    // Most of a chunk is usually transparent, which RLE skips for free
+    if (!use_gl && !use_gx)
+    {
+      SDL_SetAlpha(chunk.surface->impl->get_sdl_surface(), SDL_SRCALPHA | SDL_RLEACCEL, SDL_ALPHA_OPAQUE);
+    }
+  }
+}
+
+// EOF
@@ -0,0 +1,84 @@
+//  tilemap_cache.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+#ifndef SUPERTUX_TILEMAP_CACHE_H
+#define SUPERTUX_TILEMAP_CACHE_H
+
+#include <vector>
+#include "texture.h"
+#include "tile_layer.h"
+
+/** Draws one tilemap layer from pre-rendered chunks of CHUNK_COLUMNS
+    columns, instead of drawing every visible cell each frame.
+
+    Only static tiles (a single image, no bigger than a cell) are baked
+    into a chunk, animated and oversized tiles are remembered and drawn on
+    top of it each frame. A chunk keeps a copy of the cells it was built
+    from and is rebuilt as soon as the level differs from it, so edits
+    done through Level::change() show up in the next frame. */
+class TileMapCache
+{
+public:
+  static const int CHUNK_COLUMNS = 16;
+
+  /** Chunks kept per layer, enough for the screen plus one for scrolling */
+  static const int MAX_CHUNKS = 4;
+
+  TileMapCache();
+  ~TileMapCache();
+
+  /** Draw a tilemap layer, scrolled by scroll_x pixels */
+  void draw(const TileLayer& layer, float scroll_x);
+
+  /** Throw away all chunks, e.g. after the tileset changed */
+  void clear();
+
+private:
+  // A tile that can't be baked into a chunk
+  struct LiveCell
+  {
+    int column;
+    int row;
+    unsigned int id;
+  };
+
+  struct Chunk
+  {
+    int first_column;                  // -1 for unused chunks
+    std::vector<unsigned int> cells;   // the tiles this chunk was built from, column by column
+    std::vector<LiveCell> live_cells;
+    Surface* surface;                  // nullptr if no static tile was found
+    unsigned int last_used;
+  };
+
+  Chunk chunks[MAX_CHUNKS];
+  unsigned int frame;
+
+  Chunk& get_chunk(const TileLayer& layer, int first_column);
+  bool is_current(const Chunk& chunk, const TileLayer& layer) const;
+  void build(Chunk& chunk, const TileLayer& layer, int first_column);
+
+  TileMapCache(const TileMapCache&);
+  TileMapCache& operator=(const TileMapCache&);
+};
+
+#endif /*SUPERTUX_TILEMAP_CACHE_H*/
+
+// EOF
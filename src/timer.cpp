@@ -24,11 +24,45 @@
 
 Uint32 st_pause_ticks = 0, st_pause_count = 0;
 
+bool st_ticks_latched = false;
+Uint32 st_latched_ticks = 0;
+
+// While replays are recorded or played, game time only moves with the
+// logic steps, so timers expire at the same step every time
+static bool st_stepped = false;
+static Uint32 st_stepped_ticks = 0;
+
 /**
- * Get the current ticks, adjusting for paused time.
- * @return Adjusted SDL ticks.
+ * Take over a change of the game ticks into the latched value, so
+ * starting, stopping and pausing the clock are seen right away.
+ */
+static void st_ticks_relatch(void)
+{
+  if (st_ticks_latched)
+  {
+    st_latched_ticks = st_get_ticks();
+  }
+}
+
+/**
+ * Get the current game ticks, adjusting for paused time.
+ * @return Adjusted SDL ticks, or the step clock while it runs.
  */
 Uint32 st_get_ticks(void)
+{
+  if (st_stepped)
+  {
+    return st_stepped_ticks;
+  }
+  return st_get_wall_ticks();
+}
+
+/**
+ * Get the ticks adjusted for paused time, even while the step clock runs.
+ * The game loops measure their frames with these.
+ * @return Adjusted SDL ticks.
+ */
+Uint32 st_get_wall_ticks(void)
 {
   if (st_pause_count != 0)
   {
@@ -40,6 +74,42 @@ Uint32 st_get_ticks(void)
   }
 }
 
+/**
+ * Let the game ticks follow st_ticks_step() instead of the wall clock.
+ * @param start The game ticks to start at, never 0 as timers take that
+ *              for not started.
+ */
+void st_ticks_start_stepped(Uint32 start)
+{
+  st_stepped = true;
+  st_stepped_ticks = start;
+  st_ticks_relatch();
+}
+
+/**
+ * Go back to wall clock game ticks, continuing from the step clock.
+ */
+void st_ticks_stop_stepped(void)
+{
+  if (!st_stepped)
+  {
+    return;
+  }
+
+  st_stepped = false;
+  st_pause_ticks = (st_pause_count != 0 ? st_pause_count : SDL_GetTicks()) - st_stepped_ticks;
+  st_ticks_relatch();
+}
+
+/**
+ * Advance the step clock by one logic step.
+ * @param ms The length of the step in milliseconds.
+ */
+void st_ticks_step(Uint32 ms)
+{
+  st_stepped_ticks += ms;
+}
+
 /**
  * Initialize the paused ticks.
  */
@@ -47,6 +117,7 @@ void st_pause_ticks_init(void)
 {
   st_pause_ticks = 0;
   st_pause_count = 0;
+  st_ticks_relatch();
 }
 
 /**
@@ -58,6 +129,7 @@ void st_pause_ticks_start(void)
   {
     st_pause_count = SDL_GetTicks();
   }
+  st_ticks_relatch();
 }
 
 /**
@@ -72,6 +144,7 @@ void st_pause_ticks_stop(void)
 
   st_pause_ticks += SDL_GetTicks() - st_pause_count;
   st_pause_count = 0;
+  st_ticks_relatch();
 }
 
 /**
@@ -83,6 +156,24 @@ bool st_pause_ticks_started(void)
   return st_pause_count != 0;
 }
 
+/**
+ * Read the game ticks once for all timers, until the next call. The game
+ * session latches at each frame and logic step.
+ */
+void st_ticks_latch(void)
+{
+  st_ticks_latched = true;
+  st_latched_ticks = st_get_ticks();
+}
+
+/**
+ * Let timers read the game ticks directly again.
+ */
+void st_ticks_unlatch(void)
+{
+  st_ticks_latched = false;
+}
+
 /**
  * Constructor for Timer class.
  */
@@ -93,13 +184,13 @@ Timer::Timer()
 
 /**
  * Initialize the timer with either SDL or SuperTux ticks.
- * @param st_ticks True for SuperTux ticks, false for SDL ticks.
+ * @param st_ticks_ True for SuperTux ticks, false for SDL ticks.
  */
-void Timer::init(bool st_ticks)
+void Timer::init(bool st_ticks_)
 {
   period = 0;
   time = 0;
-  get_ticks = st_ticks ? st_get_ticks : SDL_GetTicks;
+  st_ticks = st_ticks_;
 }
 
 /**
@@ -117,82 +208,215 @@ void Timer::start(Uint32 period_)
  */
 void Timer::stop()
 {
-  init(get_ticks == st_get_ticks);
+  init(st_ticks);
 }
 
 /**
- * Check if the timer is still running.
- * @return True if running, false otherwise.
+ * Save the timer's current state to a file.
+ * @param fi The file pointer to write to.
  */
-int Timer::check()
+void Timer::fwrite(FILE* fi)
 {
-  if ((time != 0) && (time + period > get_ticks()))
-  {
-    return true;
-  }
-  else
-  {
-    time = 0;
-    return false;
-  }
+  Uint32 diff_ticks = (time != 0) ? (get_ticks() - time) : 0;
+  int tick_mode = st_ticks;
+
+  ::fwrite(&period, sizeof(Uint32), 1, fi);
+  ::fwrite(&diff_ticks, sizeof(Uint32), 1, fi);
+  ::fwrite(&tick_mode, sizeof(Uint32), 1, fi);
+}
+
+/**
+ * Load the timer's state from a file.
+ * @param fi The file pointer to read from.
+ */
+void Timer::fread(FILE* fi)
+{
+  Uint32 diff_ticks;
+  int tick_mode;
+
+  ::fread(&period, sizeof(Uint32), 1, fi);
+  ::fread(&diff_ticks, sizeof(Uint32), 1, fi);
+  ::fread(&tick_mode, sizeof(Uint32), 1, fi);
+
+  st_ticks = tick_mode != 0;
+  time = (diff_ticks != 0) ? (get_ticks() - diff_ticks) : 0;
 }
 
 /**
- * Check if the timer has been started.
- * @return True if started, false otherwise.
+ * Constructor for TimerWheel, starts empty at time 0.
  */
-int Timer::started()
+TimerWheel::TimerWheel()
+  : current(0), next_handle(1)
 {
-  return time != 0;
 }
 
 /**
- * Get the time remaining on the timer.
- * @return Time left in milliseconds, can be negative if expired.
+ * Drop all callbacks and continue from the given time.
+ * @param now The game ticks to continue from.
  */
-int Timer::get_left()
+void TimerWheel::reset(Uint32 now)
 {
-  return period - (get_ticks() - time);
+  for (int level = 0; level < LEVELS; ++level)
+  {
+    for (int slot = 0; slot < SLOTS; ++slot)
+    {
+      slots[level][slot].clear();
+    }
+  }
+  due.clear();
+  current = now / RESOLUTION;
 }
 
 /**
- * Get the time elapsed since the timer started.
- * @return Time elapsed in milliseconds.
+ * Call back after some time.
+ * @param delay The time in milliseconds.
+ * @param callback The function to call.
+ * @param data Handed to callback.
+ * @return The handle to cancel the callback with.
  */
-int Timer::get_gone()
+TimerWheel::Handle TimerWheel::schedule(Uint32 delay, Callback callback, void* data)
 {
-  return get_ticks() - time;
+  Entry entry;
+  entry.handle = next_handle++;
+  if (next_handle == 0)
+  {
+    next_handle = 1;
+  }
+
+  // The slot of the current tick is done already, so the earliest is
+  // the next tick
+  Uint32 ticks = (delay + RESOLUTION - 1) / RESOLUTION;
+  entry.expires = current + (ticks != 0 ? ticks : 1);
+  entry.callback = callback;
+  entry.data = data;
+
+  insert(entry);
+  return entry.handle;
 }
 
 /**
- * Save the timer's current state to a file.
- * @param fi The file pointer to write to.
+ * Forget a callback that didn't run yet.
+ * @param handle The handle returned by schedule().
  */
-void Timer::fwrite(FILE* fi)
+void TimerWheel::cancel(Handle handle)
 {
-  Uint32 diff_ticks = (time != 0) ? (get_ticks() - time) : 0;
-  int tick_mode = (get_ticks == st_get_ticks);
+  if (handle == 0)
+  {
+    return;
+  }
 
-  ::fwrite(&period, sizeof(Uint32), 1, fi);
-  ::fwrite(&diff_ticks, sizeof(Uint32), 1, fi);
-  ::fwrite(&tick_mode, sizeof(Uint32), 1, fi);
+  for (Entry& entry : due)
+  {
+    if (entry.handle == handle)
+    {
+      entry.callback = nullptr;
+      return;
+    }
+  }
+
+  for (int level = 0; level < LEVELS; ++level)
+  {
+    for (int slot = 0; slot < SLOTS; ++slot)
+    {
+      std::vector<Entry>& entries = slots[level][slot];
+      for (size_t i = 0; i < entries.size(); ++i)
+      {
+        if (entries[i].handle == handle)
+        {
+          entries[i] = entries.back();
+          entries.pop_back();
+          return;
+        }
+      }
+    }
+  }
 }
 
 /**
- * Load the timer's state from a file.
- * @param fi The file pointer to read from.
+ * Run the callbacks whose time has come, tick by tick.
+ * @param now The game ticks to advance to.
  */
-void Timer::fread(FILE* fi)
+void TimerWheel::advance(Uint32 now)
 {
-  Uint32 diff_ticks;
-  int tick_mode;
+  Uint32 target = now / RESOLUTION;
 
-  ::fread(&period, sizeof(Uint32), 1, fi);
-  ::fread(&diff_ticks, sizeof(Uint32), 1, fi);
-  ::fread(&tick_mode, sizeof(Uint32), 1, fi);
+  while (static_cast<Sint32>(target - current) > 0)
+  {
+    ++current;
 
-  get_ticks = tick_mode ? st_get_ticks : SDL_GetTicks;
-  time = (diff_ticks != 0) ? (get_ticks() - diff_ticks) : 0;
+    // Entering a new round of a level brings its next slot down
+    if ((current & (SLOTS - 1)) == 0)
+    {
+      cascade(1);
+      if (((current >> SLOT_BITS) & (SLOTS - 1)) == 0)
+      {
+        cascade(2);
+      }
+    }
+
+    std::vector<Entry>& slot = slots[0][current & (SLOTS - 1)];
+    if (slot.empty())
+    {
+      continue;
+    }
+
+    // Callbacks may schedule and cancel, which must not touch the slot
+    // being called back
+    due.swap(slot);
+    for (size_t i = 0; i < due.size(); ++i)
+    {
+      if (due[i].callback)
+      {
+        Callback callback = due[i].callback;
+        due[i].callback = nullptr;
+        callback(due[i].data);
+      }
+    }
+    due.clear();
+  }
+}
+
+/**
+ * Put an entry into the slot of the level that covers its time.
+ * @param entry The entry to insert.
+ */
+void TimerWheel::insert(const Entry& entry)
+{
+  Sint32 delta = static_cast<Sint32>(entry.expires - current);
+
+  if (delta < SLOTS)
+  {
+    // Entries that are due already run with the current tick
+    Uint32 expires = delta > 0 ? entry.expires : current;
+    slots[0][expires & (SLOTS - 1)].push_back(entry);
+  }
+  else if (delta < SLOTS * SLOTS)
+  {
+    slots[1][(entry.expires >> SLOT_BITS) & (SLOTS - 1)].push_back(entry);
+  }
+  else
+  {
+    // Further times wait in the last slot of the top level and are
+    // sorted again when it comes down
+    Uint32 expires = delta < SLOTS * SLOTS * SLOTS ? entry.expires
+                                                   : current + SLOTS * SLOTS * SLOTS - 1;
+    slots[2][(expires >> (2 * SLOT_BITS)) & (SLOTS - 1)].push_back(entry);
+  }
+}
+
+/**
+ * Move the entries of the level's slot for the current time to the
+ * levels below.
+ * @param level The level to take the entries from.
+ */
+void TimerWheel::cascade(int level)
+{
+  std::vector<Entry> entries;
+  entries.swap(slots[level][(current >> (level * SLOT_BITS)) & (SLOTS - 1)]);
+  for (const Entry& entry : entries)
+  {
+    insert(entry);
+  }
 }
 
 // EOF
@@ -21,20 +21,41 @@
 #ifndef SUPERTUX_TIMER_H
 #define SUPERTUX_TIMER_H
 
+#include <vector>
+#include <SDL.h>
+
 extern Uint32 st_pause_ticks, st_pause_count;
 
+/** Set by st_ticks_latch(), see st_get_latched_ticks() */
+extern bool st_ticks_latched;
+extern Uint32 st_latched_ticks;
+
 Uint32 st_get_ticks(void);
+Uint32 st_get_wall_ticks(void);
+void st_ticks_start_stepped(Uint32 start);
+void st_ticks_stop_stepped(void);
+void st_ticks_step(Uint32 ms);
 void st_pause_ticks_init(void);
 void st_pause_ticks_start(void);
 void st_pause_ticks_stop(void);
 bool st_pause_ticks_started(void);
+void st_ticks_latch(void);
+void st_ticks_unlatch(void);
+
+/** The game ticks all Timers read. While latched, this is the value
+    st_get_ticks() had at the last st_ticks_latch(), so every timer sees
+    the same time during one logic step, whatever the step costs. */
+inline Uint32 st_get_latched_ticks(void)
+{
+  return st_ticks_latched ? st_latched_ticks : st_get_ticks();
+}
 
 class Timer
 {
  public:
   Uint32 period;
   Uint32 time;
-  Uint32 (*get_ticks) (void);  
+  bool st_ticks;  /**< Game ticks if true, SDL ticks otherwise */
 
  public:
   Timer();
@@ -48,18 +69,97 @@ class Timer
     or it is over
     YES = otherwise
     ======================================================================*/
-  int check();
-  int started();
+  int check()
+  {
+    if ((time != 0) && (time + period > get_ticks()))
+    {
+      return true;
+    }
+    time = 0;
+    return false;
+  }
+
+  int started() { return time != 0; }
 
   /*======================================================================
     return: the time left (in millisecond)
     note  : the returned value can be negative
     ======================================================================*/
-  int get_left();
+  int get_left() { return period - (get_ticks() - time); }
 
-  int  get_gone();
+  int  get_gone() { return get_ticks() - time; }
   void fwrite(FILE* fi);
   void fread(FILE* fi);
+
+ private:
+  Uint32 get_ticks() const
+  {
+    return st_ticks ? st_get_latched_ticks() : SDL_GetTicks();
+  }
+};
+
+/** Calls back when a time has come, instead of the owner polling a
+    Timer every frame. The time only moves on in advance(), so callbacks
+    run from the logic step that calls it.
+
+    The wheel is hierarchical: the first level has a slot for each of
+    the next SLOTS ticks of RESOLUTION ms, every further level covers
+    SLOTS times the time of the one below. Entries cascade down a level
+    when their time comes closer, so scheduling, cancelling and firing
+    never look at more than one slot. */
+class TimerWheel
+{
+ public:
+  typedef void (*Callback)(void* data);
+
+  /** Identifies a scheduled callback, 0 is none */
+  typedef unsigned int Handle;
+
+  TimerWheel();
+
+  /** Drop all callbacks and continue from the given time
+      @param now Game ticks, usually st_get_latched_ticks() */
+  void reset(Uint32 now);
+
+  /** Call back after some time
+      @param delay The time in ms, rounded up to RESOLUTION
+      @param callback The function to call
+      @param data Handed to callback
+      @return The handle to cancel the callback with */
+  Handle schedule(Uint32 delay, Callback callback, void* data);
+
+  /** Forget a callback that didn't run yet
+      @param handle As returned by schedule(), 0 is ignored */
+  void cancel(Handle handle);
+
+  /** Run the callbacks whose time has come, earliest first
+      @param now Game ticks, usually st_get_latched_ticks() */
+  void advance(Uint32 now);
+
+ private:
+  enum
+  {
+    RESOLUTION = 10,
+    SLOT_BITS = 6,
+    SLOTS = 1 << SLOT_BITS,
+    LEVELS = 3
+  };
+
+  struct Entry
+  {
+    Handle handle;
+    Uint32 expires;  /**< In ticks of RESOLUTION ms */
+    Callback callback;
+    void* data;
+  };
+
+  void insert(const Entry& entry);
+  void cascade(int level);
+
+  std::vector<Entry> slots[LEVELS][SLOTS];
+  std::vector<Entry> due;  /**< The entries advance() is calling back */
+  Uint32 current;          /**< The last tick advance() went through */
+  Handle next_handle;
 };
 
 #endif /*SUPERTUX_TIMER_H*/
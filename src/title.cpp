@@ -49,7 +49,13 @@
 #include "math.h"
 #include "tile.h"
 #include "resources.h"
+#include "music_manager.h"
 #include "worldmap.h"
+#include "savegame.h"
+#include "image_loader.h"
+#include "startup_trace.h"
+#include "dir_index.h"
+#include "frame_scheduler.h"
 
 namespace fs = std::filesystem;  // Alias for ease of use
 
@@ -69,9 +75,13 @@ static std::string current_contrib_subset;         // Currently selected contrib
 
 static string_list_type worldmap_list;  // List of available world maps
 
-#ifdef _WII_
-  static double fractional_increment = 0.0; // Static variable to manage the fractional increment
-#endif
+/* The demo behind the menu is simulated in fixed steps of this many ms,
+   a third as many as a game takes, and drawn interpolated in between */
+static const unsigned int DEMO_STEP = 30;
+static const int DEMO_MAX_STEPS = 4;
+
+static unsigned int demo_accumulator;  // Time not simulated yet
+static Timer demo_frame_timer;         // Advances global_frame_counter
 
 GameSession* session = nullptr;  // Pointer to the current game session
 
@@ -117,8 +127,11 @@ void createDemo()
   // Create a new game session for the demo
   session = new GameSession(datadir + "/levels/misc/menu.stl", 0, ST_GL_DEMO_GAME);
 
+  // Nobody sees badguys colliding off the screen in the demo
+  session->get_world()->set_offscreen_collisions(false);
+
   // Set up the background image from the loaded level
-  bkg_title = session->get_level()->img_bkgd;
+  bkg_title = session->get_level()->img_bkgd.get();
 
   // Load the logo image with alpha transparency
   logo = new Surface(datadir + "/images/title/logo.png", USE_ALPHA);
@@ -148,6 +161,17 @@ void free_contrib_menu()
  */
 void generate_contrib_menu()
 {
+  // The menu only changes when something was written to the level
+  // directories, reuse it otherwise
+  static unsigned int built_generation = 0;
+  static int built_worldmaps = -1;
+  if (built_worldmaps == worldmap_list.num_items && built_generation == DirIndex::generation())
+  {
+    return;
+  }
+  built_worldmaps = worldmap_list.num_items;
+  built_generation = DirIndex::generation();
+
   // Get a list of level subsets from the directory
   string_list_type level_subsets = dsubdirs("levels", "info");
 
@@ -243,9 +267,8 @@ void check_contrib_menu()
     // Display the loaded world map
     worldmap.display();
 
-    // Recreate the demo session and reload sounds
+    // Recreate the demo session, sounds load again when played
     createDemo();
-    loadsounds();
     Menu::set_current(main_menu);
   }
 }
@@ -281,11 +304,10 @@ void draw_background()
 }
 
 /**
- * Draws the demo session, updating the world and handling character movements.
+ * Runs one step of the demo session, steering Tux through the level.
  * @param session Pointer to the current game session.
- * @param frame_ratio The ratio for frame timing, used to control animations.
  */
-void draw_demo(GameSession* session, double frame_ratio)
+static void step_demo(GameSession* session)
 {
   World* world  = session->get_world();
   World::set_current(world);
@@ -294,17 +316,6 @@ void draw_demo(GameSession* session, double frame_ratio)
 
   world->play_music(LEVEL_MUSIC);
 
-#ifdef _WII_ //FIXME: very hackish way to get our "?" blocks to animate approximate correctly
-  // Increment global_frame_counter by 1 every second call
-  fractional_increment += 0.5;
-  if (fractional_increment >= 1.0)
-  {
-    global_frame_counter++;
-    fractional_increment -= 1.0;
-  }
-#else // non-Wii builds
-  global_frame_counter++; //increment every call as per normal
-#endif
   tux->key_event((SDLKey) keymap.right, DOWN);
 
   // Check if the random timer has triggered an event
@@ -335,16 +346,37 @@ void draw_demo(GameSession* session, double frame_ratio)
 
   tux->can_jump = true;
   float last_tux_x_pos = tux->base.x;
-  world->action(frame_ratio);
+
+  // The demo moves at half the speed of a game
+  world->begin_step();
+  world->action(static_cast<float>(DEMO_STEP) / FRAME_RATE / 2);
 
   // Check if Tux is stuck behind a wall, and force a jump if necessary
   if (last_tux_x_pos == tux->base.x)
   {
     walking = false;
   }
+}
+
+/**
+ * Draws the demo session between its last two steps.
+ * @param session Pointer to the current game session.
+ * @param alpha How far drawing is from the second last step to the last.
+ */
+static void draw_demo(GameSession* session, float alpha)
+{
+  World* world = session->get_world();
+
+  // Tile animations follow the clock, however fast the screen is drawn
+  if (!demo_frame_timer.check())
+  {
+    demo_frame_timer.start(25);
+    global_frame_counter++;
+  }
 
-  // Draw the world
+  world->interpolate(alpha);
   world->draw();
+  world->end_interpolation();
 }
 
 /**
@@ -355,11 +387,17 @@ void title(void)
 {
   // Initialize the random timer
   random_timer.init(true);
+  demo_frame_timer.init(true);
+  demo_accumulator = 0;
 
   walking = true;
 
   st_pause_ticks_init();
 
+  // Decode the background and the logo while the demo level loads
+  ImageLoader::queue(datadir + "/images/title/background.jpg");
+  ImageLoader::queue(datadir + "/images/title/logo.png");
+
   // Create the demo session
   createDemo();
 
@@ -396,9 +434,8 @@ void title(void)
 
   // Set the current menu to the main menu
   Menu::set_current(main_menu);
-
-  // Load sounds for the title screen
-  loadsounds();
+  StartupTrace::finish();
+  FrameScheduler::reset();
 
   // Main loop for the title screen
   while (Menu::current())
@@ -409,13 +446,19 @@ void title(void)
       update_time = last_update_time = st_get_ticks();
     }
 
-    // Calculate the frame ratio for animation timing
-    double frame_ratio = ((double)(update_time - last_update_time)) / ((double)FRAME_RATE);
-    if (frame_ratio > 1.5)
+    // Simulate the demo up to now, dropping what it can't keep up with
+    demo_accumulator += update_time - last_update_time;
+    int steps = 0;
+    while (demo_accumulator >= DEMO_STEP && steps < DEMO_MAX_STEPS)
     {
-      frame_ratio = 1.5 + (frame_ratio - 1.5) * 0.85;
+      step_demo(session);
+      demo_accumulator -= DEMO_STEP;
+      ++steps;
+    }
+    if (steps == DEMO_MAX_STEPS)
+    {
+      demo_accumulator %= DEMO_STEP;
     }
-    frame_ratio /= 2;
 
     // Handle SDL events (input)
     SDL_Event event;
@@ -434,7 +477,7 @@ void title(void)
     }
 
     // Draw the demo session
-    draw_demo(session, frame_ratio);
+    draw_demo(session, static_cast<float>(demo_accumulator) / DEMO_STEP);
 
     // Draw the logo if on the main menu
     if (Menu::current() == main_menu)
@@ -503,7 +546,10 @@ void title(void)
 #ifdef DEBUG
             printf("Removing: %s\n", str);
 #endif
+            // Don't let a pending save bring the slot back
+            SaveGame::flush();
             remove(str);
+            DirIndex::invalidate(st_save_dir);
           }
 
           update_load_save_game_menu(load_game_menu);
@@ -513,9 +559,8 @@ void title(void)
         else if (process_load_game_menu())
         {
           createDemo();
-          loadsounds();
 #ifdef DEBUG
-          printf("loaded demo, load sounds\n");
+          printf("loaded demo\n");
 #endif
           // FIXME: shouldn't be needed if GameSession doesn't relay on global variables
           // reset tux
@@ -540,23 +585,17 @@ void title(void)
     // Update the screen
     flipscreen();
 
+    // Start the demo's music once the previous one has faded out
+    music_manager->update();
+
     // Set the time of the last update and the time of the current update
     last_update_time = update_time;
     update_time = st_get_ticks();
 
-    // Pause the loop for a short duration
+    // Pause the loop until the next frame is due. The title screen is
+    // mostly a menu, it doesn't need every frame
     frame++;
-#ifdef _WII_
-    /*FIXME: Gets 60fps now on Wii by removing SDL_Delay, but animation of "?" blocks are
-     * about 2x too fast unless we compensate by only incrementing global frame counter
-     * half as often in draw_demo when building for Wii. This is a very hackish; please fix!
-     */
-#else
-    /* FIXME: Default delay is 25 which should work as normal for non-Wii provided the machine
-     * is modern enough to actually handle this delay properly
-     */
-      SDL_Delay(25);
-#endif
+    FrameScheduler::wait(FrameScheduler::POWER_SAVE);
   }
 
   // Free surfaces and resources
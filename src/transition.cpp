@@ -0,0 +1,291 @@
+//  transition.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <math.h>
+#include <algorithm>
+#include <SDL.h>
+#ifndef NOOPENGL
+#include <SDL_opengl.h>
+#endif
+#include "transition.h"
+#include "globals.h"
+#include "screen.h"
+#include "texture.h"
+#include "render_batch.h"
+#include "gx_video.h"
+#include "frame_scheduler.h"
+#include "render_thread.h"
+
+namespace
+{
+
+// Height of the bands the iris is drawn with
+const int IRIS_BAND = 4;
+
+bool captured = false;
+
+// SDL mode: the screen, copied in its own format
+SDL_Surface* frame = nullptr;
+
+#ifndef NOOPENGL
+// OpenGL mode: the framebuffer, copied into the lower left corner
+GLuint frame_texture = 0;
+int texture_w = 0;
+int texture_h = 0;
+#endif
+
+#ifdef _WII_
+// GX mode: the EFB, the texture belongs to GXVideo
+const GXVideo::Texture* frame_gx = nullptr;
+#endif
+
+int power_of_two(int size)
+{
+  int result = 1;
+  while (result < size)
+  {
+    result *= 2;
+  }
+  return result;
+}
+
+/**
+ * Covers everything outside a circle around the middle of the screen
+ * with black.
+ * @param radius The radius of the circle in pixels.
+ */
+void draw_iris(float radius)
+{
+  float cx = screen->w / 2.0f;
+  float cy = screen->h / 2.0f;
+
+  for (int y = 0; y < screen->h; y += IRIS_BAND)
+  {
+    float dy = fabsf(y + IRIS_BAND / 2.0f - cy);
+    if (dy >= radius)
+    {
+      fillrect(0, y, screen->w, IRIS_BAND, 0, 0, 0, 255);
+      continue;
+    }
+
+    float half = sqrtf(radius * radius - dy * dy);
+    float left = std::max(0.0f, floorf(cx - half));
+    float right = std::min(static_cast<float>(screen->w), ceilf(cx + half));
+    if (left > 0)
+    {
+      fillrect(0, y, left, IRIS_BAND, 0, 0, 0, 255);
+    }
+    if (right < screen->w)
+    {
+      fillrect(right, y, screen->w - right, IRIS_BAND, 0, 0, 0, 255);
+    }
+  }
+}
+
+} // namespace
+
+/**
+ * Copies the frame into the texture or surface of the current mode,
+ * which is only created by the first capture.
+ */
+void Transition::capture()
+{
+#ifdef _WII_
+  if (use_gx)
+  {
+    frame_gx = GXVideo::capture_texture();
+    captured = frame_gx != nullptr;
+    return;
+  }
+#endif
+
+#ifndef NOOPENGL
+  if (use_gl)
+  {
+    // Everything queued so far belongs to the frame
+    RenderBatch::flush();
+
+    if (frame_texture == 0)
+    {
+      texture_w = power_of_two(screen->w);
+      texture_h = power_of_two(screen->h);
+      glGenTextures(1, &frame_texture);
+      glBindTexture(GL_TEXTURE_2D, frame_texture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_w, texture_h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    }
+    else
+    {
+      glBindTexture(GL_TEXTURE_2D, frame_texture);
+    }
+
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, screen->w, screen->h);
+    captured = true;
+    return;
+  }
+#endif
+
+  // The frame may still be drawn from, and the screen has to be complete
+  RenderThread::finish();
+
+  if (frame == nullptr)
+  {
+    SDL_PixelFormat* format = screen->format;
+    frame = SDL_CreateRGBSurface(SDL_SWSURFACE, screen->w, screen->h, format->BitsPerPixel,
+                                 format->Rmask, format->Gmask, format->Bmask, 0);
+    if (frame == nullptr)
+    {
+      return;
+    }
+  }
+  SDL_BlitSurface(screen, NULL, frame, NULL);
+  captured = true;
+}
+
+/**
+ * Draws the captured frame over the whole screen.
+ * @param alpha The opacity of the frame.
+ */
+void Transition::draw_captured(Uint8 alpha)
+{
+  if (!captured)
+  {
+    fillrect(0, 0, screen->w, screen->h, 0, 0, 0, alpha);
+    return;
+  }
+
+#ifdef _WII_
+  if (use_gx)
+  {
+    GXVideo::draw_quad(frame_gx, alpha != 255, alpha, 0, 0, screen->w, screen->h, 0, 0, 1, 1);
+    return;
+  }
+#endif
+
+#ifndef NOOPENGL
+  if (use_gl)
+  {
+    // The framebuffer is stored bottom up
+    RenderBatch::add_quad(frame_texture, alpha != 255, alpha, 0, 0, screen->w, screen->h,
+                          0, static_cast<float>(screen->h) / texture_h,
+                          static_cast<float>(screen->w) / texture_w, 0);
+    return;
+  }
+#endif
+
+  SDL_Rect dest = { 0, 0, static_cast<Uint16>(screen->w), static_cast<Uint16>(screen->h) };
+  RenderThread::blit(frame, NULL, &dest, alpha);
+  add_dirty_rect(0, 0, screen->w, screen->h);
+}
+
+/**
+ * Plays a transition, one frame per display refresh.
+ * @param type The kind of transition.
+ * @param ms The length of the transition in milliseconds.
+ * @param next The image to end with, needed by FADE_IN, CROSSFADE and
+ *             IRIS_IN.
+ */
+void Transition::run(Type type, int ms, Surface* next)
+{
+  float full_radius = sqrtf(screen->w * screen->w + screen->h * screen->h) / 2;
+  Uint32 start = SDL_GetTicks();
+  FrameScheduler::reset();
+
+  while (true)
+  {
+    float t = ms > 0 ? std::min(1.0f, static_cast<float>(SDL_GetTicks() - start) / ms) : 1.0f;
+    Uint8 alpha = static_cast<Uint8>(t * 255);
+
+    switch (type)
+    {
+      case FADE_OUT:
+        draw_captured();
+        fillrect(0, 0, screen->w, screen->h, 0, 0, 0, alpha);
+        break;
+
+      case FADE_IN:
+        clearscreen(0, 0, 0);
+        if (next)
+        {
+          next->draw(0, 0, alpha);
+        }
+        break;
+
+      case CROSSFADE:
+        draw_captured();
+        if (next)
+        {
+          next->draw(0, 0, alpha);
+        }
+        break;
+
+      case IRIS_OUT:
+        draw_captured();
+        draw_iris((1 - t) * full_radius);
+        break;
+
+      case IRIS_IN:
+        if (next)
+        {
+          next->draw(0, 0);
+        }
+        else
+        {
+          clearscreen(0, 0, 0);
+        }
+        draw_iris(t * full_radius);
+        break;
+    }
+
+    flipscreen();
+    if (t >= 1)
+    {
+      break;
+    }
+    FrameScheduler::wait();
+  }
+}
+
+/**
+ * Forgets the captured frame. The GL texture belongs to the old context
+ * and the surface may have the wrong format for the new mode.
+ */
+void Transition::invalidate()
+{
+  captured = false;
+#ifndef NOOPENGL
+  frame_texture = 0;
+#endif
+#ifdef _WII_
+  frame_gx = nullptr;
+#endif
+  if (frame)
+  {
+    RenderThread::finish();
+    SDL_FreeSurface(frame);
+    frame = nullptr;
+  }
+}
+
+// EOF
@@ -0,0 +1,69 @@
+//  transition.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_TRANSITION_H
+#define SUPERTUX_TRANSITION_H
+
+#include <SDL.h>
+
+class Surface;
+
+/** Screen transitions between the frame on screen and the next image.
+
+    capture() keeps the frame where the renderer can draw it from
+    without a detour through main memory: in OpenGL mode the
+    framebuffer is copied into a texture, with GX the EFB is copied into
+    a texture, and in SDL mode the screen is blitted into a surface in
+    its own format. The texture or surface is made once and reused by
+    every capture. */
+class Transition
+{
+public:
+  enum Type
+  {
+    FADE_OUT,   // the captured frame fades to black
+    FADE_IN,    // the next image fades in from black
+    CROSSFADE,  // the captured frame fades into the next image
+    IRIS_OUT,   // a shrinking circle closes the captured frame
+    IRIS_IN     // a growing circle opens onto the next image
+  };
+
+  /** Keep what was drawn since the last flip, or in SDL mode what is
+      on screen */
+  static void capture();
+
+  /** Draw the captured frame over the whole screen, black if nothing
+      was captured yet */
+  static void draw_captured(Uint8 alpha = 255);
+
+  /** Play a transition, blocking until it is over
+      @param ms The length of the transition
+      @param next The image to end with, only used by the types that
+                  end with one */
+  static void run(Type type, int ms, Surface* next = nullptr);
+
+  /** Forget the captured frame, the video mode is being changed */
+  static void invalidate();
+};
+
+#endif /*SUPERTUX_TRANSITION_H*/
+
+// EOF
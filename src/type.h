@@ -68,6 +68,12 @@ public:
 
   base_type base;
   base_type old_base;
+
+  /* Position at the start of the current logic step and the real position
+     while drawing interpolates between the two, see World::interpolate() */
+  base_type step_base;
+  base_type draw_base;
+  bool has_step_base = false;
 };
 
 struct string_list_type
@@ -19,6 +19,7 @@
 //  02111-1307, USA.
 
 #include "utils.h"
+#include <cstdio>
 #include <cstring> // For memcpy, memchr
 
 size_t strlcpy(char* dst, const char* src, size_t size)
@@ -48,4 +49,46 @@ size_t strlcpy(char* dst, const char* src, size_t size)
   return src_len;
 }
 
+/**
+ * Writes a file through a temporary file next to it, which is renamed
+ * over the file once it was written completely. A crash while saving
+ * leaves the old file in place instead of a cut off one.
+ * @param filename The file to write.
+ * @param data The contents of the file.
+ * @param size The size of data in bytes.
+ * @return True if the file was written.
+ */
+bool write_file_atomic(const std::string& filename, const void* data, size_t size)
+{
+  std::string temp = filename + ".tmp";
+
+  FILE* file = std::fopen(temp.c_str(), "wb");
+  if (file == nullptr)
+  {
+    std::perror(temp.c_str());
+    return false;
+  }
+  bool ok = std::fwrite(data, 1, size, file) == size;
+  ok = std::fflush(file) == 0 && ok;
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok)
+  {
+    std::perror(temp.c_str());
+    std::remove(temp.c_str());
+    return false;
+  }
+
+  // Not every filesystem lets rename() replace an existing file
+  if (std::rename(temp.c_str(), filename.c_str()) != 0)
+  {
+    std::remove(filename.c_str());
+    if (std::rename(temp.c_str(), filename.c_str()) != 0)
+    {
+      std::perror(filename.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
 // EOF
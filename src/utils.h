@@ -22,10 +22,14 @@
 #define UTILS_H
 
 #include <cstring> // For memcpy and strlen
+#include <string>
 
 // Declare the custom implementation of strlcpy
 size_t strlcpy(char* dst, const char* src, size_t size);
 
+// Write a file through a temporary file that replaces it once complete
+bool write_file_atomic(const std::string& filename, const void* data, size_t size);
+
 #endif // UTILS_H
 
 // EOF
@@ -0,0 +1,355 @@
+//  virtual_screen.cpp
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+#include <SDL.h>
+#ifndef NOOPENGL
+#include <SDL_opengl.h>
+#endif
+#include "virtual_screen.h"
+#include "render_batch.h"
+
+namespace
+{
+
+int requested_w = 0;
+int requested_h = 0;
+VirtualScreen::Filter filter = VirtualScreen::FILTER_LINEAR;
+
+// The size of the desktop before the first video mode was set
+int desktop_w = 0;
+int desktop_h = 0;
+
+// The display and the part of it the frame is scaled to, in the bottom
+// up coordinates of glViewport()
+int output_w = VirtualScreen::WIDTH;
+int output_h = VirtualScreen::HEIGHT;
+SDL_Rect viewport = { 0, 0, VirtualScreen::WIDTH, VirtualScreen::HEIGHT };
+
+// The screen surface of a scaled OpenGL mode, only its size and format
+// are used
+SDL_Surface* stand_in = nullptr;
+
+#ifndef NOOPENGL
+// Framebuffer objects are fetched at runtime like the shader functions,
+// with the ARB names first and the EXT ones of older drivers otherwise
+typedef void (APIENTRY* GenObjectsFunc)(GLsizei n, GLuint* objects);
+typedef void (APIENTRY* DeleteObjectsFunc)(GLsizei n, const GLuint* objects);
+typedef void (APIENTRY* BindObjectFunc)(GLenum target, GLuint object);
+typedef void (APIENTRY* FramebufferTexture2DFunc)(GLenum target, GLenum attachment, GLenum textarget,
+                                                  GLuint texture, GLint level);
+typedef GLenum (APIENTRY* CheckFramebufferStatusFunc)(GLenum target);
+
+const GLenum FRAMEBUFFER = 0x8D40;
+const GLenum COLOR_ATTACHMENT0 = 0x8CE0;
+const GLenum FRAMEBUFFER_COMPLETE = 0x8CD5;
+
+GenObjectsFunc GenFramebuffers = nullptr;
+DeleteObjectsFunc DeleteFramebuffers = nullptr;
+BindObjectFunc BindFramebuffer = nullptr;
+FramebufferTexture2DFunc FramebufferTexture2D = nullptr;
+CheckFramebufferStatusFunc CheckFramebufferStatus = nullptr;
+
+GLuint framebuffer = 0;
+GLuint frame_texture = 0;
+int texture_w = 0;
+int texture_h = 0;
+
+/**
+ * Looks up an OpenGL entry point, falling back to its EXT version.
+ * @param name The name of the function.
+ * @param function Receives the function, null if it isn't there.
+ * @return True if the function was found.
+ */
+template<typename T>
+bool get_function(const char* name, T* function)
+{
+  *function = reinterpret_cast<T>(SDL_GL_GetProcAddress(name));
+  if (*function == nullptr)
+  {
+    *function = reinterpret_cast<T>(SDL_GL_GetProcAddress((std::string(name) + "EXT").c_str()));
+  }
+  return *function != nullptr;
+}
+
+int power_of_two(int size)
+{
+  int result = 1;
+  while (result < size)
+  {
+    result *= 2;
+  }
+  return result;
+}
+
+/**
+ * Creates the framebuffer object the frames are drawn into.
+ * @return False if the driver can't render into textures.
+ */
+bool create_framebuffer()
+{
+  if (!get_function("glGenFramebuffers", &GenFramebuffers) ||
+      !get_function("glDeleteFramebuffers", &DeleteFramebuffers) ||
+      !get_function("glBindFramebuffer", &BindFramebuffer) ||
+      !get_function("glFramebufferTexture2D", &FramebufferTexture2D) ||
+      !get_function("glCheckFramebufferStatus", &CheckFramebufferStatus))
+  {
+    return false;
+  }
+
+  GLint gl_filter = filter == VirtualScreen::FILTER_NEAREST ? GL_NEAREST : GL_LINEAR;
+  texture_w = power_of_two(VirtualScreen::WIDTH);
+  texture_h = power_of_two(VirtualScreen::HEIGHT);
+  glGenTextures(1, &frame_texture);
+  glBindTexture(GL_TEXTURE_2D, frame_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_w, texture_h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+  GenFramebuffers(1, &framebuffer);
+  BindFramebuffer(FRAMEBUFFER, framebuffer);
+  FramebufferTexture2D(FRAMEBUFFER, COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_texture, 0);
+
+  if (CheckFramebufferStatus(FRAMEBUFFER) != FRAMEBUFFER_COMPLETE)
+  {
+    BindFramebuffer(FRAMEBUFFER, 0);
+    DeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &frame_texture);
+    framebuffer = frame_texture = 0;
+    return false;
+  }
+  return true;
+}
+#endif
+
+/**
+ * Works out where on the output the frame goes. The aspect ratio is kept,
+ * and nearest filtering only scales by whole numbers so that every pixel
+ * of the game gets the same size.
+ */
+void fit_viewport()
+{
+  float scale = std::min(static_cast<float>(output_w) / VirtualScreen::WIDTH,
+                         static_cast<float>(output_h) / VirtualScreen::HEIGHT);
+  if (filter == VirtualScreen::FILTER_NEAREST && scale >= 1.0f)
+  {
+    scale = static_cast<float>(static_cast<int>(scale));
+  }
+
+  viewport.w = static_cast<Uint16>(VirtualScreen::WIDTH * scale);
+  viewport.h = static_cast<Uint16>(VirtualScreen::HEIGHT * scale);
+  viewport.x = static_cast<Sint16>((output_w - viewport.w) / 2);
+  viewport.y = static_cast<Sint16>((output_h - viewport.h) / 2);
+}
+
+} // namespace
+
+/**
+ * Asks for the size of the output.
+ * @param width The width in pixels, 0 for the default.
+ * @param height The height in pixels, 0 for the default.
+ */
+void VirtualScreen::set_output_size(int width, int height)
+{
+  requested_w = width;
+  requested_h = height;
+}
+
+/**
+ * Chooses how the frame is scaled, before the video mode is set.
+ * @param new_filter The filter.
+ */
+void VirtualScreen::set_filter(Filter new_filter)
+{
+  filter = new_filter;
+}
+
+/**
+ * Returns how the frame is scaled.
+ * @return The filter.
+ */
+VirtualScreen::Filter VirtualScreen::get_filter()
+{
+  return filter;
+}
+
+/**
+ * Returns the video mode to open in OpenGL mode.
+ * @param fullscreen Whether the mode is a fullscreen one.
+ * @param width Receives the width.
+ * @param height Receives the height.
+ */
+void VirtualScreen::get_output_size(bool fullscreen, int* width, int* height)
+{
+  // Once a mode is set, SDL reports its size instead of the desktop's
+  if (desktop_w == 0)
+  {
+    const SDL_VideoInfo* info = SDL_GetVideoInfo();
+    if (info && info->current_w > 0 && info->current_h > 0)
+    {
+      desktop_w = info->current_w;
+      desktop_h = info->current_h;
+    }
+    else
+    {
+      desktop_w = WIDTH;
+      desktop_h = HEIGHT;
+    }
+  }
+
+  if (requested_w > 0 && requested_h > 0)
+  {
+    *width = requested_w;
+    *height = requested_h;
+  }
+  else if (fullscreen)
+  {
+    *width = desktop_w;
+    *height = desktop_h;
+  }
+  else
+  {
+    *width = WIDTH;
+    *height = HEIGHT;
+  }
+}
+
+#ifndef NOOPENGL
+/**
+ * Sets up scaling for a new OpenGL video mode. GL objects of an older
+ * context are forgotten without being deleted.
+ * @param output The surface SDL_SetVideoMode() returned.
+ * @return The surface the game uses as its screen.
+ */
+SDL_Surface* VirtualScreen::init_gl(SDL_Surface* output)
+{
+  framebuffer = frame_texture = 0;
+  output_w = output->w;
+  output_h = output->h;
+  fit_viewport();
+
+  if (!is_scaled())
+  {
+    SDL_FreeSurface(stand_in);
+    stand_in = nullptr;
+    glViewport(0, 0, WIDTH, HEIGHT);
+    return output;
+  }
+
+  if (stand_in == nullptr)
+  {
+    SDL_PixelFormat* format = output->format;
+    stand_in = SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HEIGHT, format->BitsPerPixel,
+                                    format->Rmask, format->Gmask, format->Bmask, 0);
+    if (stand_in == nullptr)
+    {
+      fprintf(stderr, "Warning: Could not set up the virtual screen, drawing at %dx%d.\n", output_w, output_h);
+      output_w = WIDTH;
+      output_h = HEIGHT;
+      fit_viewport();
+      return output;
+    }
+  }
+
+  if (!create_framebuffer())
+  {
+    fprintf(stderr, "Warning: OpenGL can't draw into textures, scaling every draw instead.\n");
+  }
+  begin_frame_gl();
+  return stand_in;
+}
+
+/**
+ * Draws the frame from the offscreen framebuffer onto the output, with
+ * black borders where the aspect ratio differs.
+ */
+void VirtualScreen::present_gl()
+{
+  if (framebuffer == 0)
+  {
+    return;
+  }
+
+  RenderBatch::flush();
+  BindFramebuffer(FRAMEBUFFER, 0);
+
+  glViewport(0, 0, output_w, output_h);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // The texture is stored bottom up
+  glViewport(viewport.x, viewport.y, viewport.w, viewport.h);
+  RenderBatch::add_quad(frame_texture, false, 255, 0, 0, WIDTH, HEIGHT,
+                        0, static_cast<float>(HEIGHT) / texture_h,
+                        static_cast<float>(WIDTH) / texture_w, 0);
+  RenderBatch::flush();
+}
+
+/**
+ * Points drawing at the virtual screen, the offscreen framebuffer or,
+ * without one, the part of the output the frame is scaled to.
+ */
+void VirtualScreen::begin_frame_gl()
+{
+  if (framebuffer != 0)
+  {
+    BindFramebuffer(FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, WIDTH, HEIGHT);
+  }
+  else
+  {
+    glViewport(viewport.x, viewport.y, viewport.w, viewport.h);
+  }
+}
+#endif
+
+/**
+ * Tells whether the output differs from the virtual screen.
+ * @return True if frames are scaled.
+ */
+bool VirtualScreen::is_scaled()
+{
+  return output_w != WIDTH || output_h != HEIGHT;
+}
+
+/**
+ * Converts a position on the output into one on the virtual screen,
+ * positions on the borders end up on the nearest edge.
+ * @param x The horizontal position, converted in place.
+ * @param y The vertical position, converted in place.
+ */
+void VirtualScreen::to_virtual(int* x, int* y)
+{
+  if (!is_scaled())
+  {
+    return;
+  }
+
+  int top = output_h - viewport.y - viewport.h;
+  *x = std::max(0, std::min(WIDTH - 1, (*x - viewport.x) * WIDTH / viewport.w));
+  *y = std::max(0, std::min(HEIGHT - 1, (*y - top) * HEIGHT / viewport.h));
+}
+
+// EOF
@@ -0,0 +1,85 @@
+//  virtual_screen.h
+//
+//  SuperTux
+//  Copyright (C) 2004 SuperTux Development Team, see AUTHORS for details
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+
+
+#ifndef SUPERTUX_VIRTUAL_SCREEN_H
+#define SUPERTUX_VIRTUAL_SCREEN_H
+
+#include <SDL.h>
+
+/** The game is laid out for a screen of WIDTH x HEIGHT pixels, and the
+    screen surface always has that size. The display may be larger:
+
+    - In OpenGL mode the window (or the desktop, in fullscreen) is the
+      output. Frames are drawn into an offscreen framebuffer of the
+      virtual size, which present_gl() scales onto the output once per
+      frame, keeping the aspect ratio. Without framebuffer objects the
+      viewport scales every draw instead.
+    - GX already copies the 640x480 EFB to the TV mode, only the filter
+      of that copy is chosen here.
+    - The SDL renderer doesn't scale, it always opens the virtual size.
+
+    Mouse positions of the output are converted with to_virtual(). */
+class VirtualScreen
+{
+public:
+  static const int WIDTH = 640;
+  static const int HEIGHT = 480;
+
+  enum Filter
+  {
+    FILTER_NEAREST,
+    FILTER_LINEAR
+  };
+
+  /** Ask for the size of the window, 0 uses the virtual size in a
+      window and the desktop size in fullscreen */
+  static void set_output_size(int width, int height);
+
+  static void set_filter(Filter filter);
+  static Filter get_filter();
+
+  /** The video mode OpenGL mode should open */
+  static void get_output_size(bool fullscreen, int* width, int* height);
+
+#ifndef NOOPENGL
+  /** Set up scaling after SDL_SetVideoMode() opened output, call with
+      the GL context current.
+      @return The surface the game draws to, of the virtual size */
+  static SDL_Surface* init_gl(SDL_Surface* output);
+
+  /** Scale the frame onto the output, right before swapping buffers */
+  static void present_gl();
+
+  /** Draw into the offscreen framebuffer again, after swapping buffers */
+  static void begin_frame_gl();
+#endif
+
+  /** Tell whether the output is larger or smaller than the game */
+  static bool is_scaled();
+
+  /** Convert a position on the output, e.g. of the mouse, into one on
+      the virtual screen */
+  static void to_virtual(int* x, int* y);
+};
+
+#endif /*SUPERTUX_VIRTUAL_SCREEN_H*/
+
+// EOF
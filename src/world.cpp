@@ -24,26 +24,56 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include "globals.h"
 #include "scene.h"
 #include "screen.h"
 #include "defines.h"
 #include "world.h"
 #include "level.h"
+#include "background_strips.h"
+#include "profiler.h"
 #include "tile.h"
 #include "resources.h"
+#include "sprite_manager.h"
+#include "level_preloader.h"
+#include "job_system.h"
 
 Surface* img_distro[4];
 
 World* World::current_ = 0;
 
+/* Badguys further ahead of the camera than this stay dormant */
+#define WAKE_DISTANCE (screen->w + OFFSCREEN_DISTANCE)
+
+/* Switching songs fades the old one out and the new one in, each this long */
+#define MUSIC_FADE_TIME 300
+
+static bool
+further_right(const BadGuyData& lhs, const BadGuyData& rhs)
+{
+  return lhs.x > rhs.x;
+}
+
+static bool
+lower_kind(const BadGuy* lhs, const BadGuy* rhs)
+{
+  return lhs->kind < rhs->kind;
+}
+
 World::World(const std::string& filename)
 {
   // FIXME: Move this to action and draw and everywhere else where the
   // world calls child functions
   current_ = this;
+  register_objects();
 
-  level = new Level(filename);
+  // The worldmap may already have loaded the level in the background
+  level = LevelPreloader::take(filename);
+  if (!level)
+  {
+    level = new Level(filename);
+  }
   tux.init();
 
   set_defaults();
@@ -63,6 +93,7 @@ World::World(const std::string& subset, int level_nr)
   // FIXME: Move this to action and draw and everywhere else where the
   // world calls child functions
   current_ = this;
+  register_objects();
 
   level = new Level(subset, level_nr);
   tux.init();
@@ -100,6 +131,11 @@ World::apply_bonuses()
     }
 }
 
+World::World()
+{
+  register_objects();
+}
+
 World::~World()
 {
   deactivate_world();
@@ -116,34 +152,126 @@ void World::activate_world()
 
 void World::deactivate_world()
 {
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end(); ++i)
-    delete *i;
-  bad_guys.clear();
+  objects.clear();
 
   for (ParticleSystems::iterator i = particle_systems.begin();
           i != particle_systems.end(); ++i)
     delete *i;
   particle_systems.clear();
+  emitters.clear();
+}
 
-  for (std::vector<BouncyDistro*>::iterator i = bouncy_distros.begin();
-       i != bouncy_distros.end(); ++i)
-    delete *i;
-  bouncy_distros.clear();
+/** Tux, who is updated before everything else and always drawn */
+class World::PlayerGroup : public ObjectGroup
+{
+public:
+  PlayerGroup(World& world_)
+    : ObjectGroup(PHASE_THINK, LAYER_PLAYER), world(world_)
+  {}
 
-  for (std::vector<BrokenBrick*>::iterator i = broken_bricks.begin();
-       i != broken_bricks.end(); ++i)
-    delete *i;
-  broken_bricks.clear();
+  size_t size() const { return 1; }
+  GameObject& get(size_t) { return world.tux; }
 
-  for (std::vector<BouncyBrick*>::iterator i = bouncy_bricks.begin();
-       i != bouncy_bricks.end(); ++i)
-    delete *i;
-  bouncy_bricks.clear();
+  void update(float elapsed_time)
+  {
+    world.tux.action(elapsed_time);
+    world.tux.check_bounds(world.level->back_scrolling, (bool)world.level->hor_autoscroll_speed);
+  }
 
-  for (std::vector<FloatingScore*>::iterator i = floating_scores.begin();
-       i != floating_scores.end(); ++i)
-    delete *i;
-  floating_scores.clear();
+  void cleanup() {}
+  void clear() {}
+  void draw() { world.tux.draw(); }
+
+private:
+  World& world;
+};
+
+/** The active badguys. They wake up when the camera comes close, their
+    actions run in one batch per kind and removal keeps them grouped. */
+class World::BadGuyGroup : public ObjectGroup
+{
+public:
+  BadGuyGroup(World& world_)
+    : ObjectGroup(PHASE_PHYSICS, LAYER_BADGUYS), world(world_)
+  {}
+
+  size_t size() const { return world.bad_guys.size(); }
+  GameObject& get(size_t index) { return *world.bad_guys[index]; }
+  bool is_alive(size_t index) const { return !world.bad_guys[index]->is_removable(); }
+
+  void update(float elapsed_time)
+  {
+    BadGuys& bad_guys = world.bad_guys;
+
+    /* Badguys far ahead stay dormant and cost nothing until they get close */
+    world.wake_bad_guys();
+    for (unsigned int first = 0; first < bad_guys.size(); )
+      {
+        unsigned int last = first + 1;
+        while (last < bad_guys.size() && bad_guys[last]->kind == bad_guys[first]->kind)
+          ++last;
+        BadGuy::action_batch(&bad_guys[first], last - first, elapsed_time);
+        first = last;
+      }
+    world.flush_bad_guys();
+  }
+
+  void cleanup()
+  {
+    BadGuys& bad_guys = world.bad_guys;
+
+    // Keep the others in their order
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < bad_guys.size(); ++i)
+      {
+        if (bad_guys[i]->is_removable())
+          world.bad_guy_slab.destroy(bad_guys[i]);
+        else
+          bad_guys[kept++] = bad_guys[i];
+      }
+    bad_guys.resize(kept);
+
+    // Badguys spawned by collisions, e.g. a squished MrBomb's bomb
+    world.flush_bad_guys();
+  }
+
+  void clear()
+  {
+    destroy(world.bad_guys);
+    destroy(world.bad_guys_to_add);
+    world.dormant_bad_guys.clear();
+  }
+
+private:
+  void destroy(BadGuys& list)
+  {
+    for (BadGuys::iterator i = list.begin(); i != list.end(); ++i)
+      world.bad_guy_slab.destroy(*i);
+    list.clear();
+  }
+
+  World& world;
+};
+
+/** Describe the object containers to the registry, in the order in
+    which they are updated. The effect objects only move themselves, so
+    they are independent. */
+void
+World::register_objects()
+{
+  objects.add(new PlayerGroup(*this));
+  objects.add(new PooledGroup<BouncyDistro>(bouncy_distros, bouncy_distro_pool,
+                                            PHASE_PHYSICS, LAYER_COINS, 32), true);
+  objects.add(new PooledGroup<BrokenBrick>(broken_bricks, broken_brick_pool,
+                                           PHASE_PHYSICS, LAYER_DEBRIS, 16), true);
+  objects.add(new PooledGroup<BouncyBrick>(bouncy_bricks, bouncy_brick_pool,
+                                           PHASE_PHYSICS, LAYER_BLOCKS, 32), true);
+  /* Floating scores are placed in screen coordinates */
+  objects.add(new PooledGroup<FloatingScore>(floating_scores, floating_score_pool,
+                                             PHASE_PHYSICS, LAYER_SCORES, 32, true), true);
+  objects.add(new ListGroup<Bullet>(bullets, PHASE_PHYSICS, LAYER_BULLETS));
+  objects.add(new ListGroup<Upgrade>(upgrades, PHASE_PHYSICS, LAYER_UPGRADES, 32));
+  objects.add(new BadGuyGroup(*this));
 }
 
 void
@@ -161,16 +289,171 @@ World::set_defaults()
   currentmusic = LEVEL_MUSIC;
 }
 
+/* The manifest of a level: Tux, the badguys it starts with and whatever
+   its boxes, bricks and coins can produce */
+void
+World::preload_resources()
+{
+  sprite_manager->preload("smalltux");
+  sprite_manager->preload("largetux");
+  sprite_manager->preload("firetux");
+  preload_sound(SND_JUMP);
+  preload_sound(SND_BIGJUMP);
+  preload_sound(SND_SKID);
+  preload_sound(SND_HURT);
+  preload_sound(SND_FALL);
+
+  bool kinds[NUM_BadGuyKinds] = { false };
+  for (const BadGuyData& data : level->badguy_data)
+    kinds[data.kind] = true;
+
+  for (int kind = 0; kind < NUM_BadGuyKinds; ++kind)
+    {
+      if (!kinds[kind])
+        continue;
+
+      preload_badguy_gfx(static_cast<BadGuyKind>(kind));
+      preload_sound(SND_SQUISH);
+      preload_sound(SND_STOMP);
+      preload_sound(SND_KICK);
+      if (kind == BAD_MRICEBLOCK)
+        preload_sound(SND_RICOCHET);
+      if (kind == BAD_MRBOMB || kind == BAD_BOMB)
+        preload_sound(SND_EXPLODE);
+    }
+
+  unsigned int last_id = 0;
+  for (unsigned int id : level->ia_tiles.get_cells())
+    {
+      // Lots of cells in a row hold the same tile
+      if (id == 0 || id == last_id)
+        continue;
+      last_id = id;
+
+      Tile* tile = TileManager::instance()->get(id);
+      if (!tile)
+        continue;
+
+      if (tile->distro || tile->brick)
+        preload_sound(SND_DISTRO);
+      if (tile->brick)
+        preload_sound(SND_BRICK);
+      if (tile->fullbox)
+        {
+          switch (tile->data)
+            {
+            case 1:
+              preload_sound(SND_DISTRO);
+              break;
+            case 2:
+              preload_special_gfx(UPGRADE_GROWUP);
+              preload_special_gfx(UPGRADE_ICEFLOWER);
+              preload_sound(SND_UPGRADE);
+              preload_sound(SND_EXCELLENT);
+              preload_sound(SND_COFFEE);
+              preload_sound(SND_SHOOT);
+              break;
+            case 3:
+              preload_special_gfx(UPGRADE_HERRING);
+              preload_sound(SND_HERRING);
+              break;
+            case 4:
+              preload_special_gfx(UPGRADE_1UP);
+              preload_sound(SND_LIFEUP);
+              break;
+            default:
+              break;
+            }
+        }
+    }
+}
+
 void
 World::activate_bad_guys()
 {
+  add_dormant_bad_guys();
   for (std::vector<BadGuyData>::iterator i = level->badguy_data.begin();
        i != level->badguy_data.end();
        ++i)
     {
-      printf("add bad guy %d\n", i->kind);
-      add_bad_guy(i->x, i->y, i->kind, i->stay_on_platform);
+      if (i->x <= scroll_x + WAKE_DISTANCE)
+        add_bad_guy(i->x, i->y, i->kind, i->stay_on_platform);
     }
+  flush_bad_guys();
+}
+
+/** Queue the badguys of the level that are far ahead of the camera, in
+    place of the ones queued so far */
+void
+World::add_dormant_bad_guys()
+{
+  dormant_bad_guys.clear();
+  for (std::vector<BadGuyData>::iterator i = level->badguy_data.begin();
+       i != level->badguy_data.end();
+       ++i)
+    {
+      if (i->x > scroll_x + WAKE_DISTANCE)
+        dormant_bad_guys.push_back(*i);
+    }
+  std::stable_sort(dormant_bad_guys.begin(), dormant_bad_guys.end(), further_right);
+}
+
+void
+World::wake_bad_guys()
+{
+  while (!dormant_bad_guys.empty() &&
+         dormant_bad_guys.back().x <= scroll_x + WAKE_DISTANCE)
+    {
+      const BadGuyData& data = dormant_bad_guys.back();
+      bad_guys_to_add.push_back(bad_guy_slab.create(data.x, data.y, data.kind, data.stay_on_platform));
+      dormant_bad_guys.pop_back();
+    }
+  flush_bad_guys();
+}
+
+/** Move the badguys created since the last call into bad_guys */
+void
+World::flush_bad_guys()
+{
+  if (bad_guys_to_add.empty())
+    return;
+
+  bad_guys.insert(bad_guys.end(), bad_guys_to_add.begin(), bad_guys_to_add.end());
+  bad_guys_to_add.clear();
+
+  // The kind of a badguy never changes, so this only has to be redone here
+  std::stable_sort(bad_guys.begin(), bad_guys.end(), lower_kind);
+}
+
+bool
+World::reload_level()
+{
+  if (!level->reload())
+    return false;
+
+  add_dormant_bad_guys();
+
+  // The tilemap caches notice the changed cells by themselves
+  return true;
+}
+
+bool
+World::reload_tileset()
+{
+  if (!TileManager::instance()->reload())
+    return false;
+
+  // Broken bricks point at the old tiles and are gone in a moment anyway
+  for (std::vector<BrokenBrick*>::iterator i = broken_bricks.begin();
+       i != broken_bricks.end(); ++i)
+    broken_brick_pool.release(*i);
+  broken_bricks.clear();
+
+  level->refresh_tile_flags();
+  bg_cache.clear();
+  ia_cache.clear();
+  fg_cache.clear();
+  return true;
 }
 
 void
@@ -188,13 +471,72 @@ World::activate_particle_systems()
     {
       st_abort("unknown particle system specified in level", "");
     }
+
+  for (std::vector<EmitterData>::iterator i = level->emitter_data.begin();
+       i != level->emitter_data.end(); ++i)
+    emitters.add(*i);
 }
 
 void
-World::draw()
+World::begin_step()
 {
-  int y,x;
+  step_scroll_x = scroll_x;
+  objects.for_each([](GameObject& object)
+    {
+      object.step_base = object.base;
+      object.has_step_base = true;
+    });
+}
 
+/* Objects that moved further than this during one step were teleported
+   and are drawn where they are */
+static const float MAX_INTERPOLATION = 64;
+
+static float
+lerp(float from, float to, float alpha)
+{
+  if (fabsf(to - from) > MAX_INTERPOLATION)
+    return to;
+  return from + (to - from) * alpha;
+}
+
+void
+World::interpolate(float alpha)
+{
+  if (alpha >= 1.0f)
+    return;
+
+  interpolating = true;
+  draw_scroll_x = scroll_x;
+  scroll_x = lerp(step_scroll_x, scroll_x, alpha);
+  objects.for_each([alpha](GameObject& object)
+    {
+      object.draw_base = object.base;
+      if (object.has_step_base)
+        {
+          object.base.x = lerp(object.step_base.x, object.base.x, alpha);
+          object.base.y = lerp(object.step_base.y, object.base.y, alpha);
+        }
+    });
+}
+
+void
+World::end_interpolation()
+{
+  if (!interpolating)
+    return;
+
+  interpolating = false;
+  scroll_x = draw_scroll_x;
+  objects.for_each([](GameObject& object)
+    {
+      object.base = object.draw_base;
+    });
+}
+
+void
+World::draw()
+{
   /* Draw the real background */
   if(level->img_bkgd)
     {
@@ -202,9 +544,13 @@ World::draw()
       level->img_bkgd->draw_part(s, 0,0,0,level->img_bkgd->w - s, level->img_bkgd->h);
       level->img_bkgd->draw_part(0, 0,screen->w - s ,0,s,level->img_bkgd->h);
     }
+  else if(level->bkgd_strips)
+    {
+      level->bkgd_strips->draw(scroll_x * (level->bkgd_speed/100.0f));
+    }
   else
     {
-      drawgradient(level->bkgd_top, level->bkgd_bottom);
+      level->draw_gradient();
     }
 
   /* Draw particle systems (background) */
@@ -215,58 +561,19 @@ World::draw()
     }
 
   /* Draw background: */
-  for (y = 0; y < 15; ++y)
-    {
-      for (x = 0; x < 21; ++x)
-        {
-          Tile::draw(32*x - fmodf(scroll_x, 32), y * 32,
-                     level->bg_tiles[(int)y][(int)x + (int)(scroll_x / 32)]);
-        }
-    }
+  level->stream_around(scroll_x, screen->w / 32 + 1);
+  bg_cache.draw(level->bg_tiles, scroll_x);
 
   /* Draw interactive tiles: */
-  for (y = 0; y < 15; ++y)
-    {
-      for (x = 0; x < 21; ++x)
-        {
-          Tile::draw(32*x - fmodf(scroll_x, 32), y * 32,
-                     level->ia_tiles[(int)y][(int)x + (int)(scroll_x / 32)]);
-        }
-    }
-
-  /* (Bouncy bricks): */
-  for (unsigned int i = 0; i < bouncy_bricks.size(); ++i)
-    bouncy_bricks[i]->draw();
-
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end(); ++i)
-    (*i)->draw();
+  ia_cache.draw(level->ia_tiles, scroll_x);
 
-  tux.draw();
+  /* Game objects outside of the screen are skipped */
+  objects.draw();
 
-  for (unsigned int i = 0; i < bullets.size(); ++i)
-    bullets[i].draw();
-
-  for (unsigned int i = 0; i < floating_scores.size(); ++i)
-    floating_scores[i]->draw();
-
-  for (unsigned int i = 0; i < upgrades.size(); ++i)
-    upgrades[i].draw();
-
-  for (unsigned int i = 0; i < bouncy_distros.size(); ++i)
-    bouncy_distros[i]->draw();
-
-  for (unsigned int i = 0; i < broken_bricks.size(); ++i)
-    broken_bricks[i]->draw();
+  emitters.draw(scroll_x);
 
   /* Draw foreground: */
-  for (y = 0; y < 15; ++y)
-    {
-      for (x = 0; x < 21; ++x)
-        {
-          Tile::draw(32*x - fmodf(scroll_x, 32), y * 32,
-                     level->fg_tiles[(int)y][(int)x + (int)(scroll_x / 32)]);
-        }
-    }
+  fg_cache.draw(level->fg_tiles, scroll_x);
 
   /* Draw particle systems (foreground) */
   for(p = particle_systems.begin(); p != particle_systems.end(); ++p)
@@ -278,54 +585,54 @@ World::draw()
 void
 World::action(float elapsed_time)
 {
-  tux.action(elapsed_time);
-  tux.check_bounds(level->back_scrolling, (bool)level->hor_autoscroll_speed);
-  scrolling(elapsed_time);
-
-  /* Handle bouncy distros: */
-  for (unsigned int i = 0; i < bouncy_distros.size(); i++)
-    bouncy_distros[i]->action(elapsed_time);
-
-  /* Handle broken bricks: */
-  for (unsigned int i = 0; i < broken_bricks.size(); i++)
-    broken_bricks[i]->action(elapsed_time);
-
-  // Handle all kinds of game objects
-  for (unsigned int i = 0; i < bouncy_bricks.size(); i++)
-    bouncy_bricks[i]->action(elapsed_time);
-
-  for (unsigned int i = 0; i < floating_scores.size(); i++)
-    floating_scores[i]->action(elapsed_time);
+  Physic::set_gravity(level->gravity);
 
-  for (unsigned int i = 0; i < bullets.size(); ++i)
-    bullets[i].action(elapsed_time);
-
-  for (unsigned int i = 0; i < upgrades.size(); i++)
-    upgrades[i].action(elapsed_time);
-
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end(); ++i)
-    (*i)->action(elapsed_time);
+  objects.update(PHASE_THINK, elapsed_time);
+  scrolling(elapsed_time);
 
-  /* update particle systems */
+  /* Particle systems only change themselves, they run as jobs next to
+     the independent objects. Badguys, bullets and upgrades touch tiles,
+     Tux and each other, their phase stays on this thread. */
   std::vector<ParticleSystem*>::iterator p;
   for(p = particle_systems.begin(); p != particle_systems.end(); ++p)
     {
-      (*p)->simulate(elapsed_time);
+      ParticleSystem* system = *p;
+      JobSystem::add([system, elapsed_time]()
+        {
+          system->simulate(elapsed_time);
+        });
     }
+  objects.update(PHASE_PHYSICS, elapsed_time);
 
-  /* Handle all possible collisions. */
-  collision_handler();
-
-  // Cleanup marked badguys
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end();
-      /* ++i handled at end of the loop */) {
-    if ((*i)->is_removable()) {
-      delete *i;
-      i =  bad_guys.erase(i);
-    } else {
-      ++i;
-    }
+  /* Emitters draw their random numbers from the simulation's generator,
+     which keeps replays deterministic only in a fixed order */
+  {
+    PROFILE_SCOPE("simulate");
+    emitters.simulate(elapsed_time, scroll_x);
   }
+
+  /* Handle all possible collisions, the collide phase of the objects */
+  {
+    PROFILE_SCOPE("collision_handler");
+    if (offscreen_collisions)
+      {
+        badguy_grid.rebuild(bad_guys);
+      }
+    else
+      {
+        visible_bad_guys.clear();
+        for (BadGuy* badguy : bad_guys)
+          {
+            if (badguy->base.x + badguy->base.width >= scroll_x - 32 &&
+                badguy->base.x <= scroll_x + screen->w + 32)
+              visible_bad_guys.push_back(badguy);
+          }
+        badguy_grid.rebuild(visible_bad_guys);
+      }
+    collision_handler();
+  }
+
+  objects.update(PHASE_CLEANUP, elapsed_time);
 }
 
 // the space that it takes for the screen to start scrolling, regarding
@@ -438,10 +745,17 @@ void World::scrolling(float elapsed_time)
 void
 World::collision_handler()
 {
+  /* Only badguys sharing a column of badguy_grid with an object are
+     tested against it, see CollisionGrid */
+
   // CO_BULLET & CO_BADGUY check
   for(unsigned int i = 0; i < bullets.size(); ++i)
     {
-      for (BadGuys::iterator j = bad_guys.begin(); j != bad_guys.end(); ++j)
+      if(bullets.is_removed(i))
+        continue;
+
+      badguy_grid.query(bullets[i].base, &candidates);
+      for (std::vector<BadGuy*>::iterator j = candidates.begin(); j != candidates.end(); ++j)
         {
           if((*j)->dying != DYING_NOT)
             continue;
@@ -454,38 +768,35 @@ World::collision_handler()
               // delete the bullet
               (*j)->collision(0, CO_BULLET);
               bullets[i].collision(CO_BADGUY);
-              break; // bullet is invalid now, so break
+              break; // bullet is removed now, so break
             }
         }
     }
 
   /* CO_BADGUY & CO_BADGUY check */
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end(); ++i)
+  badguy_grid.get_pairs(&candidate_pairs);
+  for (unsigned int p = 0; p < candidate_pairs.size(); ++p)
     {
-      if((*i)->dying != DYING_NOT)
+      BadGuy* first = candidate_pairs[p].first;
+      BadGuy* second = candidate_pairs[p].second;
+
+      if(first->dying != DYING_NOT || second->dying != DYING_NOT)
         continue;
 
-      BadGuys::iterator j = i;
-      ++j;
-      for (; j != bad_guys.end(); ++j)
+      if(rectcollision(first->base, second->base))
         {
-          if(j == i || (*j)->dying != DYING_NOT)
-            continue;
-
-          if(rectcollision((*i)->base, (*j)->base))
-            {
-              // We have detected a collision and now call the
-              // collision functions of the collided objects.
-              (*j)->collision(*i, CO_BADGUY);
-              (*i)->collision(*j, CO_BADGUY);
-            }
+          // We have detected a collision and now call the
+          // collision functions of the collided objects.
+          second->collision(first, CO_BADGUY);
+          first->collision(second, CO_BADGUY);
         }
     }
 
   if(tux.dying != DYING_NOT) return;
 
   // CO_BADGUY & CO_PLAYER check
-  for (BadGuys::iterator i = bad_guys.begin(); i != bad_guys.end(); ++i)
+  badguy_grid.query(tux.base, &candidates);
+  for (std::vector<BadGuy*>::iterator i = candidates.begin(); i != candidates.end(); ++i)
     {
       if((*i)->dying != DYING_NOT)
         continue;
@@ -512,6 +823,9 @@ World::collision_handler()
   // CO_UPGRADE & CO_PLAYER check
   for(unsigned int i = 0; i < upgrades.size(); ++i)
     {
+      if(upgrades.is_removed(i))
+        continue;
+
       if(rectcollision(upgrades[i].base, tux.base))
         {
           // We have detected a collision and now call the collision
@@ -526,7 +840,9 @@ World::add_score(float x, float y, int s)
 {
   player_status.score += s;
 
-  FloatingScore* new_floating_score = new FloatingScore();
+  FloatingScore* new_floating_score = floating_score_pool.allocate();
+  if (!new_floating_score)
+    return;
   new_floating_score->init(x,y,s);
   floating_scores.push_back(new_floating_score);
 }
@@ -534,7 +850,9 @@ World::add_score(float x, float y, int s)
 void
 World::add_bouncy_distro(float x, float y)
 {
-  BouncyDistro* new_bouncy_distro = new BouncyDistro();
+  BouncyDistro* new_bouncy_distro = bouncy_distro_pool.allocate();
+  if (!new_bouncy_distro)
+    return;
   new_bouncy_distro->init(x,y);
   bouncy_distros.push_back(new_bouncy_distro);
 }
@@ -552,7 +870,9 @@ World::add_broken_brick(Tile* tile, float x, float y)
 void
 World::add_broken_brick_piece(Tile* tile, float x, float y, float xm, float ym)
 {
-  BrokenBrick* new_broken_brick = new BrokenBrick();
+  BrokenBrick* new_broken_brick = broken_brick_pool.allocate();
+  if (!new_broken_brick)
+    return;
   new_broken_brick->init(tile, x, y, xm, ym);
   broken_bricks.push_back(new_broken_brick);
 }
@@ -560,7 +880,9 @@ World::add_broken_brick_piece(Tile* tile, float x, float y, float xm, float ym)
 void
 World::add_bouncy_brick(float x, float y)
 {
-  BouncyBrick* new_bouncy_brick = new BouncyBrick();
+  BouncyBrick* new_bouncy_brick = bouncy_brick_pool.allocate();
+  if (!new_bouncy_brick)
+    return;
   new_bouncy_brick->init(x,y);
   bouncy_bricks.push_back(new_bouncy_brick);
 }
@@ -568,8 +890,8 @@ World::add_bouncy_brick(float x, float y)
 BadGuy*
 World::add_bad_guy(float x, float y, BadGuyKind kind, bool stay_on_platform)
 {
-  BadGuy* badguy = new BadGuy(x,y,kind, stay_on_platform);
-  bad_guys.push_back(badguy);
+  BadGuy* badguy = bad_guy_slab.create(x,y,kind, stay_on_platform);
+  bad_guys_to_add.push_back(badguy);
   return badguy;
 }
 
@@ -578,20 +900,22 @@ World::add_upgrade(float x, float y, Direction dir, UpgradeKind kind)
 {
   Upgrade new_upgrade;
   new_upgrade.init(x,y,dir,kind);
-  upgrades.push_back(new_upgrade);
+  SwapHandle handle = upgrades.add(new_upgrade);
+  upgrades.get(handle)->handle = handle;
 }
 
 void
 World::add_bullet(float x, float y, float xm, Direction dir)
 {
-  if(bullets.size() > MAX_BULLETS-1)
+  if(bullets.live_size() > MAX_BULLETS-1)
     return;
 
   Bullet new_bullet;
   new_bullet.init(x,y,xm,dir);
-  bullets.push_back(new_bullet);
+  SwapHandle handle = bullets.add(new_bullet);
+  bullets.get(handle)->handle = handle;
   
-  play_sound(sounds[SND_SHOOT], SOUND_CENTER_SPEAKER);
+  play_sound(SND_SHOOT, x);
 }
 
 void
@@ -600,13 +924,13 @@ World::play_music(int musictype)
   currentmusic = musictype;
   switch(currentmusic) {
     case HURRYUP_MUSIC:
-      music_manager->play_music(get_level()->get_level_music_fast());
+      music_manager->play_music(get_level()->get_level_music_fast(), -1, MUSIC_FADE_TIME);
       break;
     case LEVEL_MUSIC:
-      music_manager->play_music(get_level()->get_level_music());
+      music_manager->play_music(get_level()->get_level_music(), -1, MUSIC_FADE_TIME);
       break;
     case HERRING_MUSIC:
-      music_manager->play_music(herring_song);
+      music_manager->play_music(herring_song, -1, MUSIC_FADE_TIME);
       break;
     default:
       music_manager->halt_music();
@@ -652,7 +976,7 @@ World::trybreakbrick(float x, float y, bool small, Direction col_side)
               plevel->change(x, y, TM_IA, tile->next_tile);
             }
 
-          play_sound(sounds[SND_DISTRO], SOUND_CENTER_SPEAKER);
+          play_sound(SND_DISTRO, x);
           player_status.score = player_status.score + SCORE_DISTRO;
           player_status.distros++;
         }
@@ -667,7 +991,7 @@ World::trybreakbrick(float x, float y, bool small, Direction col_side)
                                  (int)(y / 32) * 32);
 
           /* Get some score: */
-          play_sound(sounds[SND_BRICK], SOUND_CENTER_SPEAKER);
+          play_sound(SND_BRICK, x);
           player_status.score = player_status.score + SCORE_BRICK;
         }
     }
@@ -695,7 +1019,7 @@ World::tryemptybox(float x, float y, Direction col_side)
     {
     case 1: // Box with a distro!
       add_bouncy_distro(posx, posy);
-      play_sound(sounds[SND_DISTRO], SOUND_CENTER_SPEAKER);
+      play_sound(SND_DISTRO, x);
       player_status.score = player_status.score + SCORE_DISTRO;
       player_status.distros++;
       break;
@@ -705,7 +1029,7 @@ World::tryemptybox(float x, float y, Direction col_side)
         add_upgrade(posx, posy, col_side, UPGRADE_GROWUP);
       else     /* Tux is big, add an iceflower: */
         add_upgrade(posx, posy, col_side, UPGRADE_ICEFLOWER);
-      play_sound(sounds[SND_UPGRADE], SOUND_CENTER_SPEAKER);
+      play_sound(SND_UPGRADE, x);
       break;
 
     case 3: // Add a golden herring
@@ -731,7 +1055,7 @@ World::trygrabdistro(float x, float y, int bounciness)
   if (tile && tile->distro)
     {
       level->change(x, y, TM_IA, tile->next_tile);
-      play_sound(sounds[SND_DISTRO], SOUND_CENTER_SPEAKER);
+      play_sound(SND_DISTRO, x);
 
       if (bounciness == BOUNCE)
         {
@@ -754,6 +1078,7 @@ World::trybumpbadguy(float x, float y)
       if ((*i)->base.x >= x - 32 && (*i)->base.x <= x + 32 &&
           (*i)->base.y >= y - 16 && (*i)->base.y <= y + 16)
         {
+          (*i)->wake();
           (*i)->collision(&tux, CO_PLAYER, COLLISION_BUMP);
         }
     }
@@ -761,7 +1086,7 @@ World::trybumpbadguy(float x, float y)
   // Upgrades:
   for (unsigned int i = 0; i < upgrades.size(); i++)
     {
-      if (upgrades[i].base.height == 32 &&
+      if (!upgrades.is_removed(i) && upgrades[i].base.height == 32 &&
           upgrades[i].base.x >= x - 32 && upgrades[i].base.x <= x + 32 &&
           upgrades[i].base.y >= y - 16 && upgrades[i].base.y <= y + 16)
         {
@@ -29,7 +29,12 @@
 #include "special.h"
 #include "badguy.h"
 #include "particlesystem.h"
+#include "particle_emitters.h"
 #include "gameobjs.h"
+#include "tilemap_cache.h"
+#include "collision_grid.h"
+#include "object_pool.h"
+#include "object_registry.h"
 
 class Level;
 
@@ -38,29 +43,81 @@ class Level;
 class World
 {
 private:
-  typedef std::list<BadGuy*> BadGuys;
+  typedef std::vector<BadGuy*> BadGuys;
+
+  /** Storage of all badguys, they never move in memory, so a BadGuy*
+      stays a valid handle until the badguy is removed */
+  SlabPool<BadGuy> bad_guy_slab;
+
+  /** Badguys created since the last flush_bad_guys(), bad_guys itself is
+      never changed while it is being iterated */
   BadGuys bad_guys_to_add;
+  void flush_bad_guys();
+
+  /** Spawn data of the badguys that are still far ahead of the camera,
+      sorted by descending x so the next one to wake up is at the back.
+      A badguy is only created once the camera comes close. */
+  std::vector<BadGuyData> dormant_bad_guys;
+  void add_dormant_bad_guys();
+
+  /** Broadphase of collision_handler(), rebuilt every frame in action() */
+  CollisionGrid badguy_grid;
+  std::vector<BadGuy*> candidates;
+  std::vector<std::pair<BadGuy*, BadGuy*> > candidate_pairs;
+
+  /** When false, only badguys near the screen go into badguy_grid, see
+      set_offscreen_collisions() */
+  bool offscreen_collisions = true;
+  BadGuys visible_bad_guys;
   Level* level;
   Player tux;
 
   Timer scrolling_timer;
 
+  /** Pre-rendered chunks of the three tilemap layers */
+  TileMapCache bg_cache;
+  TileMapCache ia_cache;
+  TileMapCache fg_cache;
+
   int distro_counter;
   bool counting_distros;
   int currentmusic;
 
+  /** scroll_x at the start of the current logic step, and while drawing
+      interpolated the real value */
+  float step_scroll_x = 0;
+  float draw_scroll_x = 0;
+  bool interpolating = false;
+
+  /** Every game object of the world, by type, see register_objects() */
+  ObjectRegistry objects;
+  class PlayerGroup;
+  class BadGuyGroup;
+  void register_objects();
+
+  /** Storage of the short lived effect objects, an effect that doesn't
+      fit into its pool is simply not shown */
+  ObjectPool<BouncyDistro> bouncy_distro_pool{32};
+  ObjectPool<BrokenBrick> broken_brick_pool{64};
+  ObjectPool<BouncyBrick> bouncy_brick_pool{16};
+  ObjectPool<FloatingScore> floating_score_pool{32};
+
   static World* current_;
 public:
+  /** The active badguys, grouped by kind so that each kind's action runs
+      as one batch */
   BadGuys bad_guys;
   std::vector<BouncyDistro*> bouncy_distros;
   std::vector<BrokenBrick*>  broken_bricks;
   std::vector<BouncyBrick*>  bouncy_bricks;
   std::vector<FloatingScore*> floating_scores;
 
-  std::vector<Upgrade> upgrades;
-  std::vector<Bullet> bullets;
+  /** Removed objects stay in place until the end of action() */
+  SwapList<Upgrade> upgrades;
+  SwapList<Bullet> bullets;
   typedef std::vector<ParticleSystem*> ParticleSystems;
   ParticleSystems particle_systems;
+  ParticleEmitters emitters;
 
 public:
   static World* current() { return current_; }
@@ -68,7 +125,7 @@ public:
 
   World(const std::string& filename);
   World(const std::string& subset, int level_nr);
-  World() {};
+  World();
   ~World();
 
   void activate_world();
@@ -79,8 +136,21 @@ public:
 
   void set_defaults();
 
+  /** Whether badguys off the screen still collide with each other and
+      with bullets, on by default. The title demo turns it off. */
+  void set_offscreen_collisions(bool enabled) { offscreen_collisions = enabled; }
+
   void draw();
   void action(float frame_ratio);
+
+  /** Remember where everything is before a fixed logic step */
+  void begin_step();
+
+  /** Move everything alpha (0..1) of the way from its position before the
+      last logic step to its current one, for drawing between steps.
+      end_interpolation() puts everything back. */
+  void interpolate(float alpha);
+  void end_interpolation();
   void scrolling(float frame_ratio);   // camera scrolling
 
   void play_music(int musictype);
@@ -95,6 +165,13 @@ public:
   void activate_particle_systems();
   void activate_bad_guys();
 
+  /** Load the graphics and sounds the level is going to use, so they
+      don't have to be loaded while playing */
+  void preload_resources();
+
+  /** Move dormant badguys that came close to the camera into bad_guys */
+  void wake_bad_guys();
+
   void add_score(float x, float y, int s);
   void add_bouncy_distro(float x, float y);
   void add_broken_brick(Tile* tile, float x, float y);
@@ -122,6 +199,13 @@ public:
   /** Apply bonuses active in the player status, used to reactivate
       bonuses from former levels */
   void apply_bonuses();
+
+  /** Take over an edited level file while it is played. Tux and the
+      badguys that are awake stay, the dormant ones come from the file. */
+  bool reload_level();
+
+  /** Take over an edited tileset while the level is played */
+  bool reload_tileset();
 };
 
 /** FIXME: Workaround for the leveleditor mainly */
@@ -21,6 +21,7 @@
 #include <fstream>
 #include <vector>
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 #include <unistd.h>
 #include "globals.h"
@@ -31,6 +32,11 @@
 #include "setup.h"
 #include "worldmap.h"
 #include "resources.h"
+#include "music_manager.h"
+#include "level_preloader.h"
+#include "savegame.h"
+#include "frame_scheduler.h"
+#include "render_thread.h"
 
 #define DISPLAY_MAP_MESSAGE_TIME 2800
 
@@ -195,7 +201,7 @@ TileManager::TileManager()
           }
         }
 
-        tile->sprite = new Surface(datadir + "/images/worldmap/" + filename, USE_ALPHA);
+        tile->sprite = surface_manager->load_surface(datadir + "/images/worldmap/" + filename, USE_ALPHA);
         if (id >= int(tiles.size()))
         {
           tiles.resize(id + 1);
@@ -246,12 +252,14 @@ Tile* TileManager::get(int i)
  */
 Tux::Tux(WorldMap* worldmap_) : worldmap(worldmap_)
 {
-  largetux_sprite = new Surface(datadir + "/images/worldmap/tux.png", USE_ALPHA);
-  firetux_sprite = new Surface(datadir + "/images/worldmap/firetux.png", USE_ALPHA);
-  smalltux_sprite = new Surface(datadir + "/images/worldmap/smalltux.png", USE_ALPHA);
+  largetux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/tux.png", USE_ALPHA);
+  firetux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/firetux.png", USE_ALPHA);
+  smalltux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/smalltux.png", USE_ALPHA);
 
   offset = 0;
   moving = false;
+  walk_steps = 0;
+  fast_travel = false;
   tile_pos.x = worldmap->get_start_x();
   tile_pos.y = worldmap->get_start_y();
   direction = D_NONE;
@@ -271,9 +279,9 @@ Tux::~Tux()
  */
 void Tux::loadSprites()
 {
-  largetux_sprite = new Surface(datadir + "/images/worldmap/tux.png", USE_ALPHA);
-  firetux_sprite = new Surface(datadir + "/images/worldmap/firetux.png", USE_ALPHA);
-  smalltux_sprite = new Surface(datadir + "/images/worldmap/smalltux.png", USE_ALPHA);
+  largetux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/tux.png", USE_ALPHA);
+  firetux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/firetux.png", USE_ALPHA);
+  smalltux_sprite = surface_manager->load_surface(datadir + "/images/worldmap/smalltux.png", USE_ALPHA);
 }
 
 /**
@@ -281,21 +289,9 @@ void Tux::loadSprites()
  */
 void Tux::deleteSprites()
 {
-  if (smalltux_sprite)
-  {
-    delete smalltux_sprite;
-  }
-  if (firetux_sprite)
-  {
-    delete firetux_sprite;
-  }
-  if (largetux_sprite)
-  {
-    delete largetux_sprite;
-  }
-  smalltux_sprite = 0;
-  firetux_sprite = 0;
-  largetux_sprite = 0;
+  smalltux_sprite = SurfaceRef();
+  firetux_sprite = SurfaceRef();
+  largetux_sprite = SurfaceRef();
 }
 
 /**
@@ -373,6 +369,7 @@ void Tux::stop()
   offset = 0;
   direction = D_NONE;
   moving = false;
+  walk_steps = 0;
 }
 
 /**
@@ -391,10 +388,25 @@ void Tux::update(float delta)
       Point next_tile;
       if ((!level || level->solved || level->name.empty()) && worldmap->path_ok(input_direction, tile_pos, &next_tile))
       {
+        const Walk* walk = worldmap->get_walk(tile_pos, input_direction);
+        if (walk && (walk->length == 0 || !walk->quiet))
+        {
+          walk = nullptr;
+        }
+
+        if (walk && fast_travel)
+        {
+          // Nothing would be shown on the way, so go right to its end
+          tile_pos = walk->end;
+          back_direction = reverse_dir(walk->last_direction);
+          return;
+        }
+
         tile_pos = next_tile;
         moving = true;
         direction = input_direction;
         back_direction = reverse_dir(direction);
+        walk_steps = walk ? walk->length : 0;
       }
       else if (input_direction == back_direction)
       {
@@ -402,6 +414,7 @@ void Tux::update(float delta)
         direction = input_direction;
         tile_pos = worldmap->get_next_tile(tile_pos, direction);
         back_direction = reverse_dir(direction);
+        walk_steps = 0;
       }
     }
   }
@@ -415,6 +428,21 @@ void Tux::update(float delta)
       // We reached the next tile, so we check what to do now
       offset -= 32;
 
+      if (walk_steps > 0)
+      {
+        // On a quiet walk of the path graph, which ends after a known
+        // number of tiles and has no messages on the way
+        if (--walk_steps == 0)
+        {
+          stop();
+        }
+        else
+        {
+          walk_on();
+        }
+        return;
+      }
+
       WorldMap::Level* level = worldmap->at_level();
       if (level && level->name.empty() && !level->display_map_message.empty() && level->passive_message)
       {
@@ -437,55 +465,63 @@ void Tux::update(float delta)
       }
       else
       {
-        if (worldmap->at(tile_pos)->auto_walk)
-        {
-          // Turn to a new direction
-          Tile* tile = worldmap->at(tile_pos);
-          Direction dir = D_NONE;
+        walk_on();
+      }
+    }
+  }
+}
 
-          if (tile->north && back_direction != D_NORTH)
-          {
-            dir = D_NORTH;
-          }
-          else if (tile->south && back_direction != D_SOUTH)
-          {
-            dir = D_SOUTH;
-          }
-          else if (tile->east && back_direction != D_EAST)
-          {
-            dir = D_EAST;
-          }
-          else if (tile->west && back_direction != D_WEST)
-          {
-            dir = D_WEST;
-          }
+/**
+ * Lets Tux walk on from the tile he reached, turning on auto-walk tiles.
+ */
+void Tux::walk_on()
+{
+  if (worldmap->at(tile_pos)->auto_walk)
+  {
+    // Turn to a new direction
+    Tile* tile = worldmap->at(tile_pos);
+    Direction dir = D_NONE;
 
-          if (dir != D_NONE)
-          {
-            direction = dir;
-            back_direction = reverse_dir(direction);
-          }
-          else
-          {
-            // Should never be reached if tiledata is good
-            stop();
-            return;
-          }
-        }
+    if (tile->north && back_direction != D_NORTH)
+    {
+      dir = D_NORTH;
+    }
+    else if (tile->south && back_direction != D_SOUTH)
+    {
+      dir = D_SOUTH;
+    }
+    else if (tile->east && back_direction != D_EAST)
+    {
+      dir = D_EAST;
+    }
+    else if (tile->west && back_direction != D_WEST)
+    {
+      dir = D_WEST;
+    }
 
-        // Walk automatically to the next tile
-        Point next_tile;
-        if (worldmap->path_ok(direction, tile_pos, &next_tile))
-        {
-          tile_pos = next_tile;
-        }
-        else
-        {
-          stop();
-        }
-      }
+    if (dir != D_NONE)
+    {
+      direction = dir;
+      back_direction = reverse_dir(direction);
+    }
+    else
+    {
+      // Should never be reached if tiledata is good
+      stop();
+      return;
     }
   }
+
+  // Walk automatically to the next tile
+  Point next_tile;
+  if (worldmap->path_ok(direction, tile_pos, &next_tile))
+  {
+    tile_pos = next_tile;
+  }
+  else
+  {
+    stop();
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -497,11 +533,10 @@ Tile::Tile()
 }
 
 /**
- * Tile destructor, deletes the tile's sprite.
+ * Tile destructor.
  */
 Tile::~Tile()
 {
-  delete sprite;
 }
 
 //---------------------------------------------------------------------------
@@ -512,6 +547,14 @@ WorldMap::WorldMap()
 {
   tile_manager = new TileManager();
 
+  chunk_frame = 0;
+  for (Chunk& chunk : chunks)
+  {
+    chunk.x = chunk.y = -1;
+    chunk.surface = nullptr;
+    chunk.last_used = 0;
+  }
+
   width = (int)(20);
   height = (int)(15);
 
@@ -526,6 +569,8 @@ WorldMap::WorldMap()
 
   input_direction = D_NONE;
   enter_level = false;
+  fast_travel = false;
+  fast_travel_button = false;
 
   name = "<no file>";
   music = "salcon.mod";
@@ -536,7 +581,9 @@ WorldMap::WorldMap()
  */
 WorldMap::~WorldMap()
 {
+  LevelPreloader::cancel();
   delete tux;
+  clear_chunks();
   delete tile_manager;
 
   deleteSprites();
@@ -547,9 +594,9 @@ WorldMap::~WorldMap()
  */
 void WorldMap::loadSprites()
 {
-  leveldot_green = new Surface(datadir + "/images/worldmap/leveldot_green.png", USE_ALPHA);
-  leveldot_red = new Surface(datadir + "/images/worldmap/leveldot_red.png", USE_ALPHA);
-  leveldot_teleporter = new Surface(datadir + "/images/worldmap/teleporter.png", USE_ALPHA);
+  leveldot_green = surface_manager->load_surface(datadir + "/images/worldmap/leveldot_green.png", USE_ALPHA);
+  leveldot_red = surface_manager->load_surface(datadir + "/images/worldmap/leveldot_red.png", USE_ALPHA);
+  leveldot_teleporter = surface_manager->load_surface(datadir + "/images/worldmap/teleporter.png", USE_ALPHA);
 }
 
 /**
@@ -557,21 +604,9 @@ void WorldMap::loadSprites()
  */
 void WorldMap::deleteSprites()
 {
-  if (leveldot_green)
-  {
-    delete leveldot_green;
-  }
-  if (leveldot_red)
-  {
-    delete leveldot_red;
-  }
-  if (leveldot_teleporter)
-  {
-    delete leveldot_teleporter;
-  }
-  leveldot_green = 0;
-  leveldot_red = 0;
-  leveldot_teleporter = 0;
+  leveldot_green = SurfaceRef();
+  leveldot_red = SurfaceRef();
+  leveldot_teleporter = SurfaceRef();
 }
 
 /**
@@ -588,6 +623,8 @@ void WorldMap::set_map_file(std::string mapfile)
  */
 void WorldMap::load_map()
 {
+  clear_chunks();
+
   lisp_object_t* root_obj = lisp_read_from_file(map_file);
   if (!root_obj)
   {
@@ -674,6 +711,7 @@ void WorldMap::load_map()
   }
 
   lisp_free(root_obj);
+  build_path_graph();
   tux = new Tux(this);
 }
 
@@ -686,19 +724,13 @@ void WorldMap::get_level_title(Levels::pointer level)
   /** Get level's title */
   level->title = "<no title>";
 
-  FILE* fi;
-  lisp_object_t* root_obj = 0;
-  fi = fopen((datadir + "/levels/" + level->name).c_str(), "r");
-  if (fi == NULL)
+  lisp_object_t* root_obj = lisp_read_from_file(datadir + "/levels/" + level->name);
+  if (root_obj == NULL)
   {
     perror((datadir + "/levels/" + level->name).c_str());
     return;
   }
 
-  lisp_stream_t stream;
-  lisp_stream_init_file(&stream, fi);
-  root_obj = lisp_read(&stream);
-
   if (root_obj->type == LISP_TYPE_EOF || root_obj->type == LISP_TYPE_PARSE_ERROR)
   {
     printf("World: Parse Error in file %s", level->name.c_str());
@@ -711,7 +743,6 @@ void WorldMap::get_level_title(Levels::pointer level)
   }
 
   lisp_free(root_obj);
-  fclose(fi);
 }
 
 /**
@@ -736,6 +767,7 @@ void WorldMap::on_escape_press()
 void WorldMap::get_input()
 {
   enter_level = false;
+  fast_travel = false;
   input_direction = D_NONE;
 
   SDL_Event event;
@@ -864,6 +896,19 @@ void WorldMap::get_input()
           {
             on_escape_press();
           }
+          else if (event.jbutton.button == joystick_keymap.b_button)
+          {
+            fast_travel_button = true;
+          }
+          break;
+        }
+
+        case SDL_JOYBUTTONUP:
+        {
+          if (event.jbutton.button == joystick_keymap.b_button)
+          {
+            fast_travel_button = false;
+          }
           break;
         }
 
@@ -895,6 +940,9 @@ void WorldMap::get_input()
     {
       input_direction = D_SOUTH;
     }
+
+    // Held while choosing a direction, Tux skips quiet walks between levels
+    fast_travel = keystate[SDLK_LSHIFT] || keystate[SDLK_RSHIFT] || fast_travel_button;
   }
 }
 
@@ -945,52 +993,245 @@ Point WorldMap::get_next_tile(Point pos, Direction direction)
  */
 bool WorldMap::path_ok(Direction direction, Point old_pos, Point* new_pos)
 {
+  assert(direction != D_NONE);
+
   *new_pos = get_next_tile(old_pos, direction);
+  return (cells[width * old_pos.y + old_pos.x].moves & (1 << direction)) != 0;
+}
 
-  if (!(new_pos->x >= 0 && new_pos->x < width && new_pos->y >= 0 && new_pos->y < height))
-  { // New position is outside the tilemap
-    return false;
-  }
-  else if (at(*new_pos)->one_way != BOTH_WAYS)
+/**
+ * Tells whether Tux stops when he reaches a tile, like Tux::update()
+ * decides it.
+ * @param pos The position of the tile.
+ * @return True for stop tiles, level dots and teleporters.
+ */
+bool WorldMap::is_stop(Point pos) const
+{
+  const Cell& cell = cells[width * pos.y + pos.x];
+  if (cell.level != -1)
   {
-    if ((at(*new_pos)->one_way == NORTH_SOUTH_WAY && direction != D_SOUTH) ||
-        (at(*new_pos)->one_way == SOUTH_NORTH_WAY && direction != D_NORTH) ||
-        (at(*new_pos)->one_way == EAST_WEST_WAY && direction != D_WEST) ||
-        (at(*new_pos)->one_way == WEST_EAST_WAY && direction != D_EAST))
+    const Level& level = levels[cell.level];
+    if (!level.name.empty() || level.teleport_dest_x != -1)
     {
-      return false;
+      return true;
     }
-    return true;
   }
-  else
-  { // Check if the tile allows us to go to new_pos
-    switch (direction)
+  return tile_manager->get(tilemap[width * pos.y + pos.x])->stop;
+}
+
+/**
+ * Follows a path the way Tux walks it, turning on auto-walk tiles.
+ * @param pos The position to start from.
+ * @param direction The direction to start walking into.
+ * @return The walk, ending where Tux stops.
+ */
+Walk WorldMap::walk(Point pos, Direction direction)
+{
+  Walk result;
+  result.length = 0;
+  result.last_direction = direction;
+  result.quiet = true;
+
+  Direction back_direction = reverse_dir(direction);
+  Point next;
+
+  // Every tile can be entered from four directions, walking longer
+  // than that means the path is a loop without a stop
+  int steps = 4 * width * height;
+  for (; steps > 0 && path_ok(direction, pos, &next); --steps)
+  {
+    pos = next;
+    ++result.length;
+    result.last_direction = direction;
+
+    const Cell& cell = cells[width * pos.y + pos.x];
+    if (cell.level != -1)
     {
-      case D_WEST:
+      const Level& level = levels[cell.level];
+      if (level.name.empty() && !level.display_map_message.empty() && level.passive_message)
       {
-        return (at(old_pos)->west && at(*new_pos)->east);
+        result.quiet = false;
       }
-      case D_EAST:
+    }
+
+    if (is_stop(pos))
+    {
+      break;
+    }
+
+    Tile* tile = at(pos);
+    if (tile->auto_walk)
+    {
+      if (tile->north && back_direction != D_NORTH)
+      {
+        direction = D_NORTH;
+      }
+      else if (tile->south && back_direction != D_SOUTH)
+      {
+        direction = D_SOUTH;
+      }
+      else if (tile->east && back_direction != D_EAST)
+      {
+        direction = D_EAST;
+      }
+      else if (tile->west && back_direction != D_WEST)
+      {
+        direction = D_WEST;
+      }
+      else
       {
-        return (at(old_pos)->east && at(*new_pos)->west);
+        break;
       }
-      case D_NORTH:
+      back_direction = reverse_dir(direction);
+    }
+  }
+
+  if (steps == 0)
+  {
+    // Tux walks a loop like that tile by tile
+    result.length = 0;
+  }
+  result.end = pos;
+  return result;
+}
+
+/**
+ * Precomputes the possible steps of every tile, the level dot on it and
+ * the paths between stop tiles and level dots.
+ */
+void WorldMap::build_path_graph()
+{
+  Cell empty = { 0, -1, -1 };
+  cells.assign(width * height, empty);
+  path_nodes.clear();
+
+  for (unsigned int i = 0; i < levels.size(); ++i)
+  {
+    const Level& level = levels[i];
+    if (level.x >= 0 && level.x < width && level.y >= 0 && level.y < height &&
+        cells[width * level.y + level.x].level == -1)
+    {
+      cells[width * level.y + level.x].level = i;
+    }
+  }
+
+  static const Direction directions[] = { D_WEST, D_EAST, D_NORTH, D_SOUTH };
+
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      Tile* from = at(Point(x, y));
+      Cell& cell = cells[width * y + x];
+
+      for (Direction direction : directions)
       {
-        return (at(old_pos)->north && at(*new_pos)->south);
+        Point pos = get_next_tile(Point(x, y), direction);
+        if (!(pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height))
+        { // New position is outside the tilemap
+          continue;
+        }
+
+        Tile* to = at(pos);
+        bool ok;
+        if (to->one_way != BOTH_WAYS)
+        {
+          ok = !((to->one_way == NORTH_SOUTH_WAY && direction != D_SOUTH) ||
+                 (to->one_way == SOUTH_NORTH_WAY && direction != D_NORTH) ||
+                 (to->one_way == EAST_WEST_WAY && direction != D_WEST) ||
+                 (to->one_way == WEST_EAST_WAY && direction != D_EAST));
+        }
+        else
+        { // Check if the tile allows us to go to pos
+          switch (direction)
+          {
+            case D_WEST:
+              ok = from->west && to->east;
+              break;
+            case D_EAST:
+              ok = from->east && to->west;
+              break;
+            case D_NORTH:
+              ok = from->north && to->south;
+              break;
+            default:
+              ok = from->south && to->north;
+              break;
+          }
+        }
+
+        if (ok)
+        {
+          cell.moves |= 1 << direction;
+        }
       }
-      case D_SOUTH:
+    }
+  }
+
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      if (is_stop(Point(x, y)))
       {
-        return (at(old_pos)->south && at(*new_pos)->north);
+        cells[width * y + x].node = path_nodes.size();
+        path_nodes.push_back(PathNode());
       }
-      case D_NONE:
+    }
+  }
+
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      int node = cells[width * y + x].node;
+      if (node != -1)
       {
-        assert(!"path_ok() can't work if direction is NONE");
+        for (Direction direction : directions)
+        {
+          path_nodes[node].walks[direction - 1] = walk(Point(x, y), direction);
+        }
       }
     }
-    return false;
   }
 }
 
+/**
+ * Looks the end of a walk up in the path graph.
+ * @param pos The stop tile or level dot to start from.
+ * @param direction The direction to start walking into.
+ * @return The position where the walk ends.
+ */
+Point WorldMap::get_walk_end(Point pos, Direction direction)
+{
+  assert(direction != D_NONE);
+
+  int node = cells[width * pos.y + pos.x].node;
+  if (node == -1)
+  {
+    return walk(pos, direction).end;
+  }
+  return path_nodes[node].walks[direction - 1].end;
+}
+
+/**
+ * Looks a walk up in the path graph.
+ * @param pos The position to start from.
+ * @param direction The direction to start walking into.
+ * @return The walk, or nullptr if pos is no stop tile or level dot.
+ */
+const Walk* WorldMap::get_walk(Point pos, Direction direction) const
+{
+  assert(direction != D_NONE);
+
+  int node = cells[width * pos.y + pos.x].node;
+  if (node == -1)
+  {
+    return nullptr;
+  }
+  return &path_nodes[node].walks[direction - 1];
+}
+
 /**
  * Updates the world map and manages level interactions.
  * @param delta Time delta for frame update.
@@ -1011,7 +1252,6 @@ void WorldMap::update(float delta)
         tux->deleteSprites();
 
         GameSession* session = new GameSession(datadir + "/levels/" + level->name, 1, ST_GL_LOAD_LEVEL_FILE);
-        loadsounds();
 
         GameSession::ExitStatus result = session->run();
         bool coffee = session->get_world()->get_tux()->got_coffee;
@@ -1146,8 +1386,7 @@ void WorldMap::update(float delta)
     {
       if (level->x == tux->get_tile_pos().x && level->y == tux->get_tile_pos().y)
       {
-        loadsounds();  // FIXME: only doing it here because world bonus map warp sound
-        play_sound(sounds[SND_TELEPORT], SOUND_CENTER_SPEAKER);
+        play_sound(SND_TELEPORT);
         tux->back_direction = D_NONE;
         tux->set_tile_pos(Point(level->teleport_dest_x, level->teleport_dest_y));
         SDL_Delay(800);  // Delay for visual effect & sound completion before unloading
@@ -1163,6 +1402,17 @@ void WorldMap::update(float delta)
   {
     tux->update(delta);
     tux->set_direction(input_direction);
+    tux->set_fast_travel(fast_travel);
+
+    // Get a head start on the level tux is standing on
+    if (!tux->is_moving())
+    {
+      Level* level = at_level();
+      if (level && !level->name.empty())
+      {
+        LevelPreloader::request(datadir + "/levels/" + level->name);
+      }
+    }
   }
 
   Menu* menu = Menu::current();
@@ -1206,48 +1456,183 @@ Tile* WorldMap::at(Point p)
  */
 WorldMap::Level* WorldMap::at_level()
 {
-  for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
+  return level_at(tux->get_tile_pos());
+}
+
+/**
+ * Returns the Level at a position.
+ * @param pos The position to look at.
+ * @return The Level object at pos or null if no level is present.
+ */
+WorldMap::Level* WorldMap::level_at(Point pos)
+{
+  if (!(pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height))
+  {
+    return 0;
+  }
+
+  int index = cells[width * pos.y + pos.x].level;
+  return index == -1 ? 0 : &levels[index];
+}
+
+/**
+ * Frees all pre-rendered chunks, they get rebuilt on demand.
+ */
+void WorldMap::clear_chunks()
+{
+  for (Chunk& chunk : chunks)
+  {
+    delete chunk.surface;
+    chunk.surface = nullptr;
+    chunk.x = chunk.y = -1;
+  }
+}
+
+/**
+ * Finds the chunk at the given chunk position, building it if it isn't
+ * cached. The least recently used chunk makes room for a new one.
+ * @param x The column of the chunk, counted in chunks.
+ * @param y The row of the chunk, counted in chunks.
+ * @return The chunk.
+ */
+WorldMap::Chunk& WorldMap::get_chunk(int x, int y)
+{
+  Chunk* oldest = &chunks[0];
+
+  for (Chunk& chunk : chunks)
+  {
+    if (chunk.x == x && chunk.y == y)
+    {
+      chunk.last_used = chunk_frame;
+      return chunk;
+    }
+    if (chunk.last_used < oldest->last_used)
+    {
+      oldest = &chunk;
+    }
+  }
+
+  build_chunk(*oldest, x, y);
+  oldest->last_used = chunk_frame;
+  return *oldest;
+}
+
+/**
+ * Renders the tiles of a chunk into a new surface. The map doesn't change
+ * while it is shown, so a chunk stays valid until the next load_map().
+ * @param chunk The chunk to (re)build.
+ * @param x The column of the chunk, counted in chunks.
+ * @param y The row of the chunk, counted in chunks.
+ */
+void WorldMap::build_chunk(Chunk& chunk, int x, int y)
+{
+  // Copying the tiles changes their blit mapping and alpha, which the
+  // render thread may be using
+  RenderThread::finish();
+
+  delete chunk.surface;
+  chunk.surface = nullptr;
+  chunk.x = x;
+  chunk.y = y;
+
+  const int size = CHUNK_TILES * 32;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, size, size, 32,
+                                           0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+  SDL_Surface* temp = SDL_CreateRGBSurface(SDL_SWSURFACE, size, size, 32,
+                                           0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+  if (temp == nullptr)
   {
-    if (i->x == tux->get_tile_pos().x && i->y == tux->get_tile_pos().y)
+    st_abort("No memory left.", "");
+  }
+  SDL_FillRect(temp, NULL, 0);
+
+  int last_x = std::min((x + 1) * CHUNK_TILES, width);
+  int last_y = std::min((y + 1) * CHUNK_TILES, height);
+  for (int ty = y * CHUNK_TILES; ty < last_y; ++ty)
+  {
+    for (int tx = x * CHUNK_TILES; tx < last_x; ++tx)
     {
-      return &*i;
+      Tile* tile = at(Point(tx, ty));
+      if (!tile || !tile->sprite)
+      {
+        continue;
+      }
+
+      // Tiles don't overlap, so the tile (alpha channel included) can
+      // simply be copied into place
+      SDL_Surface* image = tile->sprite->impl->get_sdl_surface();
+      Uint32 saved_flags = image->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
+      Uint8 saved_alpha = image->format->alpha;
+      SDL_SetAlpha(image, 0, 0);
+
+      SDL_Rect dest;
+      dest.x = (tx - x * CHUNK_TILES) * 32;
+      dest.y = (ty - y * CHUNK_TILES) * 32;
+      dest.w = image->w;
+      dest.h = image->h;
+      SDL_BlitSurface(image, NULL, temp, &dest);
+
+      if ((saved_flags & SDL_SRCALPHA) == SDL_SRCALPHA)
+      {
+        Uint32 flags = SDL_SRCALPHA | ((saved_flags & SDL_RLEACCELOK) ? SDL_RLEACCEL : 0);
+        SDL_SetAlpha(image, flags, saved_alpha);
+      }
     }
   }
 
-  return 0;
+  chunk.surface = new Surface(temp, USE_ALPHA);
+  SDL_FreeSurface(temp);
 }
 
 /**
- * Draws the world map at the specified offset.
+ * Draws the world map at the specified offset. Only the chunks and level
+ * dots that touch the screen are drawn.
  * @param offset The point used to offset drawing on the screen.
  */
 void WorldMap::draw(const Point& offset)
 {
-  for (int y = 0; y < height; ++y)
+  ++chunk_frame;
+
+  const int size = CHUNK_TILES * 32;
+  int first_x = std::max(0, -offset.x / size);
+  int first_y = std::max(0, -offset.y / size);
+  int last_x = std::min((screen->w - offset.x - 1) / size, (width - 1) / CHUNK_TILES);
+  int last_y = std::min((screen->h - offset.y - 1) / size, (height - 1) / CHUNK_TILES);
+
+  for (int y = first_y; y <= last_y; ++y)
   {
-    for (int x = 0; x < width; ++x)
+    for (int x = first_x; x <= last_x; ++x)
     {
-      Tile* tile = at(Point(x, y));
-      tile->sprite->draw(x * 32 + offset.x, y * 32 + offset.y);
+      get_chunk(x, y).surface->draw(x * size + offset.x, y * size + offset.y);
     }
   }
 
   for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
   {
+    int x = i->x * 32 + offset.x;
+    int y = i->y * 32 + offset.y;
+    if (x <= -32 || y <= -32 || x >= screen->w || y >= screen->h)
+    {
+      continue;
+    }
+
     if (i->name.empty())
     {
       if ((i->teleport_dest_x != -1) && !i->invisible_teleporter)
       {
-        leveldot_teleporter->draw(i->x * 32 + offset.x, i->y * 32 + offset.y);
+        leveldot_teleporter->draw(x, y);
       }
     }
     else if (i->solved)
     {
-      leveldot_green->draw(i->x * 32 + offset.x, i->y * 32 + offset.y);
+      leveldot_green->draw(x, y);
     }
     else
     {
-      leveldot_red->draw(i->x * 32 + offset.x, i->y * 32 + offset.y);
+      leveldot_red->draw(x, y);
     }
   }
 
@@ -1287,29 +1672,25 @@ void WorldMap::draw_status()
 
   if (!tux->is_moving())
   {
-    for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
+    Levels::pointer i = at_level();
+    if (i)
     {
-      if (i->x == tux->get_tile_pos().x && i->y == tux->get_tile_pos().y)
+      if (!i->name.empty())
       {
-        if (!i->name.empty())
-        {
-          white_text->draw_align(i->title.c_str(), screen->w / 2, screen->h - offset_y, A_HMIDDLE, A_BOTTOM);
-        }
-        else if (i->teleport_dest_x != -1)
-        {
-          if (!i->teleport_message.empty())
-          {
-            gold_text->draw_align(i->teleport_message.c_str(), screen->w / 2, screen->h - offset_y, A_HMIDDLE, A_BOTTOM);
-          }
-        }
-
-        /* Display a message in the map, if any as been selected */
-        if (!i->display_map_message.empty() && !i->passive_message)
+        white_text->draw_align(i->title.c_str(), screen->w / 2, screen->h - offset_y, A_HMIDDLE, A_BOTTOM);
+      }
+      else if (i->teleport_dest_x != -1)
+      {
+        if (!i->teleport_message.empty())
         {
-          gold_text->draw_align(i->display_map_message.c_str(), screen->w / 2, screen->h - 30, A_HMIDDLE, A_BOTTOM);
+          gold_text->draw_align(i->teleport_message.c_str(), screen->w / 2, screen->h - offset_y, A_HMIDDLE, A_BOTTOM);
         }
+      }
 
-        break;
+      /* Display a message in the map, if any as been selected */
+      if (!i->display_map_message.empty() && !i->passive_message)
+      {
+        gold_text->draw_align(i->display_map_message.c_str(), screen->w / 2, screen->h - 30, A_HMIDDLE, A_BOTTOM);
       }
     }
   }
@@ -1337,6 +1718,7 @@ void WorldMap::display()
   unsigned int update_time;
 
   last_update_time = update_time = st_get_ticks();
+  FrameScheduler::reset();
 
   while (!quit)
   {
@@ -1398,6 +1780,12 @@ void WorldMap::display()
     }
 #endif
     flipscreen();
+
+    // Start the map's music once the previous one has faded out
+    music_manager->update();
+
+    // Nothing moves while a menu is open
+    FrameScheduler::wait(Menu::current() ? FrameScheduler::POWER_SAVE : FrameScheduler::NORMAL);
   }
 }
 
@@ -1410,7 +1798,7 @@ void WorldMap::savegame(const std::string& filename)
 #ifdef DEBUG
   std::cout << "savegame: " << filename << std::endl;
 #endif
-  std::ofstream out(filename.c_str());
+  SaveGameData data;
 
   int nb_solved_levels = 0;
   for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
@@ -1419,30 +1807,26 @@ void WorldMap::savegame(const std::string& filename)
     {
       ++nb_solved_levels;
     }
-  }
-
-  out << "(supertux-savegame\n"
-      << "  (version 1)\n"
-      << "  (title  \"" << name << " - " << nb_solved_levels << "/" << levels.size() << "\")\n"
-      << "  (lives   " << player_status.lives << ")\n"
-      << "  (score   " << player_status.score << ")\n"
-      << "  (distros " << player_status.distros << ")\n"
-      << "  (tux (x " << tux->get_tile_pos().x << ") (y " << tux->get_tile_pos().y << ")\n"
-      << "       (back \"" << direction_to_string(tux->back_direction) << "\")\n"
-      << "       (bonus \"" << bonus_to_string(player_status.bonus) <<  "\"))\n"
-      << "  (levels\n";
-
-  for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
-  {
-    if (i->solved && !i->name.empty())
+    if (!i->name.empty())
     {
-      out << "     (level (name \"" << i->name << "\")\n"
-          << "            (solved #t))\n";
+      data.level_hashes.push_back(SaveGame::hash_name(i->name));
+      data.solved.push_back(i->solved);
     }
   }
 
-  out << "   )\n"
-      << " )\n\n;; EOF ;;" << std::endl;
+  char title[32];
+  snprintf(title, sizeof(title), " - %d/%d", nb_solved_levels, int(levels.size()));
+  data.title = name + title;
+
+  data.lives = player_status.lives;
+  data.score = player_status.score;
+  data.distros = player_status.distros;
+  data.bonus = player_status.bonus;
+  data.tux_x = tux->get_tile_pos().x;
+  data.tux_y = tux->get_tile_pos().y;
+  data.back_direction = tux->back_direction;
+
+  SaveGame::write(filename, data);
 }
 
 /**
@@ -1456,9 +1840,52 @@ void WorldMap::loadgame(const std::string& filename)
 #endif
   savegame_file = filename;
 
-//  if (access(filename.c_str(), F_OK) != 0)
-//    return;
+  // A save of this slot may still be on its way to the disk
+  SaveGame::flush();
+
+  SaveGameData data;
+  if (SaveGame::read(filename, &data))
+  {
+    player_status.lives = data.lives;
+    player_status.score = data.score;
+    player_status.distros = data.distros;
+    if (player_status.lives < 0)
+    {
+      player_status.lives = START_LIVES;
+    }
+
+    if (data.bonus >= PlayerStatus::NO_BONUS && data.bonus <= PlayerStatus::FLOWER_BONUS)
+    {
+      player_status.bonus = static_cast<PlayerStatus::BonusType>(data.bonus);
+    }
+    if (data.back_direction >= D_NONE && data.back_direction <= D_SOUTH)
+    {
+      tux->back_direction = static_cast<Direction>(data.back_direction);
+    }
+    tux->set_tile_pos(Point(data.tux_x, data.tux_y));
+
+    for (Levels::iterator i = levels.begin(); i != levels.end(); ++i)
+    {
+      if (i->name.empty())
+      {
+        continue;
+      }
+
+      uint32_t hash = SaveGame::hash_name(i->name);
+      for (unsigned int j = 0; j < data.level_hashes.size(); ++j)
+      {
+        if (data.level_hashes[j] == hash)
+        {
+          i->solved = data.solved[j];
+          break;
+        }
+      }
+    }
+    return;
+  }
 
+  // Not a binary save, import it from the old S-expression format. It is
+  // replaced by the binary format once the game is saved.
   lisp_object_t* savegame = lisp_read_from_file(filename);
   if (!savegame)
   {
@@ -24,6 +24,7 @@
 #include <string>
 
 #include "musicref.h"
+#include "surfaceref.h"
 
 namespace WorldMapNS {
 
@@ -61,7 +62,7 @@ public:
   Tile();
   ~Tile();
 
-  Surface* sprite;
+  SurfaceRef sprite;
 
   // Directions in which Tux is allowed to walk from this tile
   bool north;
@@ -99,6 +100,16 @@ std::string direction_to_string(Direction d);
 Direction   string_to_direction(const std::string& d);
 Direction reverse_dir(Direction d);
 
+/** A walk of the path graph, from a stop tile or level dot to where Tux
+    stops again */
+struct Walk
+{
+  Point end;
+  int length;                // tiles walked, 0 if the walk isn't known
+  Direction last_direction;  // Tux's direction on the last tile
+  bool quiet;                // no passive messages on the way
+};
+
 class WorldMap;
 
 class Tux
@@ -107,9 +118,9 @@ public:
   Direction back_direction;
 private:
   WorldMap* worldmap;
-  Surface* largetux_sprite;
-  Surface* firetux_sprite;
-  Surface* smalltux_sprite;
+  SurfaceRef largetux_sprite;
+  SurfaceRef firetux_sprite;
+  SurfaceRef smalltux_sprite;
 
   Direction input_direction;
   Direction direction;
@@ -118,8 +129,13 @@ private:
       input_direction direction */
   float offset;
   bool  moving;
+  /** Tiles left of a quiet walk of the path graph, 0 when Tux checks
+      every tile he reaches */
+  int   walk_steps;
+  bool  fast_travel;
 
   void stop();
+  void walk_on();
 public: 
   Tux(WorldMap* worldmap_);
   ~Tux();
@@ -131,6 +147,8 @@ public:
   void update(float delta);
 
   void set_direction(Direction d) { input_direction = d; }
+  /** While set, Tux skips quiet walks instead of walking them */
+  void set_fast_travel(bool f) { fast_travel = f; }
 
   bool is_moving() const { return moving; }
   Point get_pos();
@@ -147,9 +165,9 @@ private:
   bool quit;
 
   Surface* level_sprite;
-  Surface* leveldot_green;
-  Surface* leveldot_red;
-  Surface* leveldot_teleporter;
+  SurfaceRef leveldot_green;
+  SurfaceRef leveldot_red;
+  SurfaceRef leveldot_teleporter;
 
   std::string name;
   std::string music;
@@ -163,6 +181,49 @@ private:
 
   TileManager* tile_manager;
 
+  /** Tiles per side of a pre-rendered map chunk */
+  static const int CHUNK_TILES = 8;
+
+  /** Chunks kept at once, enough to cover a 640x480 screen at any offset */
+  static const int MAX_CHUNKS = 12;
+
+  // The tiles of CHUNK_TILES x CHUNK_TILES cells rendered into one surface
+  struct Chunk
+  {
+    int x;                  // in chunks, -1 for unused chunks
+    int y;
+    Surface* surface;
+    unsigned int last_used;
+  };
+
+  Chunk chunks[MAX_CHUNKS];
+  unsigned int chunk_frame;
+
+  // What load_map() precomputes about every tile of the map
+  struct Cell
+  {
+    unsigned char moves;  // bit (1 << direction) set if Tux may step that way
+    int level;            // index into levels, -1 if there is no level dot
+    int node;             // index into path_nodes, -1 if Tux doesn't stop here
+  };
+
+  /** A stop tile or level dot of the path graph */
+  struct PathNode
+  {
+    Walk walks[4];        // by direction - 1
+  };
+
+  std::vector<Cell> cells;
+  std::vector<PathNode> path_nodes;
+
+  bool is_stop(Point pos) const;
+  Walk walk(Point pos, Direction direction);
+  void build_path_graph();
+
+  Chunk& get_chunk(int x, int y);
+  void build_chunk(Chunk& chunk, int x, int y);
+  void clear_chunks();
+
 public:
   struct Level
   {
@@ -214,6 +275,8 @@ private:
 
   Direction input_direction;
   bool enter_level;
+  bool fast_travel;
+  bool fast_travel_button;
 
   Point offset;
   std::string savegame_file;
@@ -247,6 +310,16 @@ public:
   Point get_next_tile(Point pos, Direction direction);
   Tile* at(Point pos);
   WorldMap::Level* at_level();
+  WorldMap::Level* level_at(Point pos);
+
+  /** Where Tux ends up when he starts walking into \a direction from the
+      stop tile or level dot at \a pos, pos itself if he can't walk there.
+      Answered from the path graph, e.g. for travelling between levels */
+  Point get_walk_end(Point pos, Direction direction);
+
+  /** The walk of the path graph starting at \a pos into \a direction,
+      nullptr if Tux doesn't stop at \a pos */
+  const Walk* get_walk(Point pos, Direction direction) const;
 
   /** Check if it is possible to walk from \a pos into \a direction,
       if possible, write the new position to \a new_pos */